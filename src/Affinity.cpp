@@ -0,0 +1,563 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Affinity.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- BOOL ParseAffinity(DWORD dwRole, const CHAR *szSpec);
+-- DWORD AffinityCpus(DWORD dwRole);
+-- VOID PlaceThread(DWORD dwRole, DWORD dwIndex);
+-- VOID PlaceTransfer(LPTransferProps props);
+-- VOID StopCoreSample(LPAffinityState a);
+-- VOID UnplaceTransfer(LPTransferProps props);
+-- INT FormatAffinityReport(CHAR *buf, size_t size, LPAffinityState a);
+-- static DWORD CountCpus(KAFFINITY mask);
+-- static BOOL RoleMask(DWORD dwRole, PGROUP_AFFINITY ga);
+-- static VOID QueryNicNode(SOCKET s, LPAffinityState a);
+-- static DWORD SampleCores(SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION *times);
+-- static INT DescribeRole(CHAR *buf, size_t size, DWORD dwRole);
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file places the program's threads and buffers on a dual-socket host. Without it the transfer workers,
+--			the multi-file writers and the buffer pool's slabs land wherever Windows puts them, which may be the
+--			other socket from the NIC: every packet then crosses the link between the sockets, once from the NIC's
+--			memory to the thread and again to the buffer.
+--
+--			-iocpus and -diskcpus take a NUMA node ("node1"), processors of group 0 ("0-7,16") or "auto". Workers
+--			given processors each get one of their own (and there is one worker per processor given); given a node,
+--			they may run on any of its processors. Auto asks each transfer's socket which processors receive-side
+--			scaling delivers its traffic to (SIO_QUERY_RSS_PROCESSOR_INFO) and moves the transfer's thread onto
+--			that node for the transfer; the writers of a multi-file transfer follow the last node found. -poolnode
+--			takes a node or "auto" and makes the pool's slabs there with VirtualAllocExNuma. Buffers the pool made
+--			before the NIC's node was known stay where they were, since slabs are never given back. The stack only
+--			answers the RSS query for connected sockets on adapters that do RSS, so a UDP client (whose socket
+--			isn't connected) or loopback transfer has no node to go by and auto leaves it alone. A thread pinned by
+--			-busypoll keeps its processor.
+--
+--			Every transfer's report gives where its thread ran against the NIC's node, and how busy each processor
+--			of that thread's group was over the transfer (from NtQuerySystemInformation, which only covers one group
+--			at a time), by node, so the cost of traffic crossing between the sockets shows up next to the throughput.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Affinity.h"
+
+#pragma comment(lib, "ntdll.lib")
+
+static AffinitySpec	specs[AFFINITY_ROLES];
+static volatile LONG lNicNode = -1;		// The node the last transfer's traffic arrived on
+static SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION startTimes[MAXIMUM_PROC_PER_GROUP];
+static DWORD		dwStartCpus = 0;
+static WORD			wStartGroup = 0;
+static LARGE_INTEGER liStart;
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CountCpus
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CountCpus(KAFFINITY mask)
+--
+-- RETURNS: The number of processors in mask.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD CountCpus(KAFFINITY mask)
+{
+	DWORD dwCount = 0;
+
+	for (; mask != 0; mask &= mask - 1)
+		dwCount++;
+	return dwCount;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ParseAffinity
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ParseAffinity(DWORD dwRole, const CHAR *szSpec)
+--							DWORD dwRole:		AFFINITY_IO, AFFINITY_DISK or AFFINITY_POOL.
+--							const CHAR *szSpec:	"auto", "node<n>", or (not for the pool) a list of processors and
+--												ranges such as "0-3,8".
+--
+-- RETURNS: FALSE if the spec isn't one of those or names a node or processor the host doesn't have; TRUE otherwise.
+--
+-- NOTES:
+-- Must be called before InitWorkers. A node given for the pool takes effect at once.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ParseAffinity(DWORD dwRole, const CHAR *szSpec)
+{
+	LPAffinitySpec	spec = &specs[dwRole];
+	ULONG			ulHighest;
+	GROUP_AFFINITY	ga;
+	unsigned long	ulFirst, ulLast;
+	CHAR			*szEnd;
+	KAFFINITY		mask = 0;
+
+	if (_stricmp(szSpec, "auto") == 0)
+	{
+		spec->dwMode = AFFINITY_AUTO;
+		return TRUE;
+	}
+
+	if (_strnicmp(szSpec, "node", 4) == 0)
+	{
+		ulFirst = strtoul(szSpec + 4, &szEnd, 10);
+		if (szSpec[4] == 0 || *szEnd != 0 || !GetNumaHighestNodeNumber(&ulHighest) || ulFirst > ulHighest ||
+			!GetNumaNodeProcessorMaskEx((USHORT)ulFirst, &ga) || ga.Mask == 0)
+			return FALSE;
+		spec->dwMode	= AFFINITY_NODE;
+		spec->wNode		= (USHORT)ulFirst;
+		if (dwRole == AFFINITY_POOL)
+			SetPoolNode(ulFirst);
+		return TRUE;
+	}
+
+	if (dwRole == AFFINITY_POOL)
+		return FALSE;
+
+	// A list of processors and ranges
+	do
+	{
+		ulFirst = ulLast = strtoul(szSpec, &szEnd, 10);
+		if (szEnd == szSpec)
+			return FALSE;
+		if (*szEnd == '-')
+		{
+			szSpec = szEnd + 1;
+			ulLast = strtoul(szSpec, &szEnd, 10);
+			if (szEnd == szSpec)
+				return FALSE;
+		}
+		if (ulFirst > ulLast || ulLast >= MAXIMUM_PROC_PER_GROUP)
+			return FALSE;
+		for (; ulFirst <= ulLast; ulFirst++)
+			mask |= (KAFFINITY)1 << ulFirst;
+		szSpec = szEnd + 1;
+	} while (*szEnd == ',');
+
+	if (*szEnd != 0)
+		return FALSE;
+	spec->dwMode	= AFFINITY_CPUS;
+	spec->mask		= mask;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AffinityCpus
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AffinityCpus(DWORD dwRole)
+--							DWORD dwRole:	AFFINITY_IO or AFFINITY_DISK.
+--
+-- RETURNS: The number of processors the role has been given, or 0 if it hasn't been given any in particular.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD AffinityCpus(DWORD dwRole)
+{
+	GROUP_AFFINITY ga;
+
+	if (specs[dwRole].dwMode == AFFINITY_CPUS)
+		return CountCpus(specs[dwRole].mask);
+	if (specs[dwRole].dwMode == AFFINITY_NODE && GetNumaNodeProcessorMaskEx(specs[dwRole].wNode, &ga))
+		return CountCpus(ga.Mask);
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RoleMask
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RoleMask(DWORD dwRole, PGROUP_AFFINITY ga)
+--							DWORD dwRole:		AFFINITY_IO or AFFINITY_DISK.
+--							PGROUP_AFFINITY ga:	Receives the processors the role's threads go on.
+--
+-- RETURNS: FALSE if the role's threads aren't placed (or auto and no NIC node has been found yet); TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL RoleMask(DWORD dwRole, PGROUP_AFFINITY ga)
+{
+	LPAffinitySpec	spec	= &specs[dwRole];
+	LONG			lNode	= lNicNode;
+
+	memset(ga, 0, sizeof(GROUP_AFFINITY));
+	switch (spec->dwMode)
+	{
+	case AFFINITY_CPUS:
+		ga->Mask = spec->mask;
+		return TRUE;
+	case AFFINITY_NODE:
+		return GetNumaNodeProcessorMaskEx(spec->wNode, ga);
+	case AFFINITY_AUTO:
+		return lNode >= 0 && GetNumaNodeProcessorMaskEx((USHORT)lNode, ga);
+	}
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PlaceThread
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PlaceThread(DWORD dwRole, DWORD dwIndex)
+--							DWORD dwRole:	AFFINITY_IO or AFFINITY_DISK.
+--							DWORD dwIndex:	Which of the role's threads this is, from 0, or AFFINITY_ANY.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called by the workers and writers as they start. Given processors, the nth thread is pinned to the nth of them
+-- (going round again if there are more threads); given a node, every thread may run anywhere on it. Auto I/O threads
+-- are placed by each transfer instead (see PlaceTransfer).
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID PlaceThread(DWORD dwRole, DWORD dwIndex)
+{
+	GROUP_AFFINITY	ga;
+	KAFFINITY		mask;
+	DWORD			dwSkip;
+
+	if ((dwRole == AFFINITY_IO && specs[dwRole].dwMode == AFFINITY_AUTO) || !RoleMask(dwRole, &ga))
+		return;
+
+	if (specs[dwRole].dwMode == AFFINITY_CPUS && dwIndex != AFFINITY_ANY)
+	{
+		for (mask = ga.Mask, dwSkip = dwIndex % CountCpus(ga.Mask); dwSkip > 0; dwSkip--)
+			mask &= mask - 1;
+		ga.Mask = mask & (~mask + 1);
+	}
+	SetThreadGroupAffinity(GetCurrentThread(), &ga, NULL);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: QueryNicNode
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: QueryNicNode(SOCKET s, LPAffinityState a)
+--							SOCKET s:			The transfer's socket.
+--							LPAffinityState a:	Receives the node most of the socket's receive processors are on.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID QueryNicNode(SOCKET s, LPAffinityState a)
+{
+	a->nNicNode		= -1;
+	a->dwNicCpus	= 0;
+#ifdef SIO_QUERY_RSS_PROCESSOR_INFO
+	SOCKET_PROCESSOR_AFFINITY	procs[MAXIMUM_PROC_PER_GROUP];
+	DWORD						dwBytes = 0, dwCount, i, j, dwVotes, dwBest = 0;
+
+	if (WSAIoctl(s, SIO_QUERY_RSS_PROCESSOR_INFO, NULL, 0, procs, sizeof(procs), &dwBytes, NULL, NULL) == SOCKET_ERROR ||
+		(dwCount = dwBytes / sizeof(SOCKET_PROCESSOR_AFFINITY)) == 0)
+		return;
+
+	for (i = 0; i < dwCount; i++)
+	{
+		for (dwVotes = 0, j = 0; j < dwCount; j++)
+			dwVotes += procs[j].NumaNodeId == procs[i].NumaNodeId;
+		if (dwVotes > dwBest)
+		{
+			dwBest		= dwVotes;
+			a->nNicNode	= procs[i].NumaNodeId;
+		}
+	}
+	a->dwNicCpus = dwCount;
+#endif
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SampleCores
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SampleCores(SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION *times)
+--							SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION *times:	Receives the idle, kernel and user time of
+--																				each processor in the calling thread's
+--																				group (MAXIMUM_PROC_PER_GROUP entries).
+--
+-- RETURNS: The number of processors sampled, or 0 if they couldn't be.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD SampleCores(SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION *times)
+{
+	ULONG ulBytes = 0;
+
+	if (!NT_SUCCESS(NtQuerySystemInformation(SystemProcessorPerformanceInformation, times,
+		MAXIMUM_PROC_PER_GROUP * sizeof(SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION), &ulBytes)))
+		return 0;
+	return ulBytes / sizeof(SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PlaceTransfer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PlaceTransfer(LPTransferProps props)
+--							LPTransferProps props:	The transfer, whose socket has just been connected or accepted (or
+--													has had its first datagram), on its own thread.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Finds the NIC's node from the socket, moves the thread and the pool there if they're on auto, and starts measuring
+-- the processors. Each transfer of a session calls it again.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID PlaceTransfer(LPTransferProps props)
+{
+	LPAffinityState	a = &props->affinity;
+	GROUP_AFFINITY	ga;
+	PROCESSOR_NUMBER pn;
+
+	QueryNicNode(props->socket, a);
+	if (a->nNicNode >= 0)
+	{
+		InterlockedExchange(&lNicNode, a->nNicNode);
+		if (specs[AFFINITY_POOL].dwMode == AFFINITY_AUTO)
+			SetPoolNode((DWORD)a->nNicNode);
+		if (specs[AFFINITY_IO].dwMode == AFFINITY_AUTO && !a->bPlaced && !props->poll.bPinned &&
+			GetNumaNodeProcessorMaskEx((USHORT)a->nNicNode, &ga) &&
+			SetThreadGroupAffinity(GetCurrentThread(), &ga, &a->oldAffinity))
+			a->bPlaced = TRUE;
+	}
+
+	GetCurrentProcessorNumberEx(&pn);
+	wStartGroup	= pn.Group;
+	dwStartCpus	= SampleCores(startTimes);
+	a->bSampled	= dwStartCpus != 0;
+	a->dwCpus	= 0;
+	QueryPerformanceCounter(&liStart);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StopCoreSample
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StopCoreSample(LPAffinityState a)
+--							LPAffinityState a:	The transfer's placement; receives how busy each processor was.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called on the transfer's thread once the transfer is over, before its report. Nothing is measured if the thread
+-- has moved to another processor group since the transfer started.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID StopCoreSample(LPAffinityState a)
+{
+	SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION	endTimes[MAXIMUM_PROC_PER_GROUP];
+	PROCESSOR_NUMBER							pn;
+	LARGE_INTEGER								liNow;
+	LONGLONG									llTotal, llIdle;
+	USHORT										wNode;
+	DWORD										i;
+
+	a->dwCpus = 0;
+	if (!a->bSampled)
+		return;
+	a->bSampled = FALSE;
+
+	GetCurrentProcessorNumberEx(&a->endCpu);
+	if (!GetNumaProcessorNodeEx(&a->endCpu, &a->wEndNode))
+		a->wEndNode = 0;
+	if (a->endCpu.Group != wStartGroup || SampleCores(endTimes) != dwStartCpus)
+		return;
+
+	QueryPerformanceCounter(&liNow);
+	a->dWallMs = TicksToSeconds(liNow.QuadPart - liStart.QuadPart) * 1000;
+	for (i = 0; i < dwStartCpus; i++)
+	{
+		// Kernel time includes the idle time
+		llTotal	= (endTimes[i].KernelTime.QuadPart - startTimes[i].KernelTime.QuadPart) +
+			(endTimes[i].UserTime.QuadPart - startTimes[i].UserTime.QuadPart);
+		llIdle	= endTimes[i].IdleTime.QuadPart - startTimes[i].IdleTime.QuadPart;
+		a->busy[i] = llTotal > 0 ? (BYTE)(100 * max(llTotal - llIdle, (LONGLONG)0) / llTotal) : 0;
+
+		pn.Group	= wStartGroup;
+		pn.Number	= (BYTE)i;
+		pn.Reserved	= 0;
+		a->nodes[i] = GetNumaProcessorNodeEx(&pn, &wNode) ? (BYTE)wNode : 0;
+	}
+	a->dwCpus = dwStartCpus;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: UnplaceTransfer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: UnplaceTransfer(LPTransferProps props)
+--							LPTransferProps props:	The transfer that has finished.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Gives the worker back the affinity it had before PlaceTransfer moved it.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID UnplaceTransfer(LPTransferProps props)
+{
+	LPAffinityState a = &props->affinity;
+
+	a->bSampled = FALSE;
+	if (!a->bPlaced)
+		return;
+	SetThreadGroupAffinity(GetCurrentThread(), &a->oldAffinity, NULL);
+	a->bPlaced = FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DescribeRole
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DescribeRole(CHAR *buf, size_t size, DWORD dwRole)
+--
+-- RETURNS: The number of characters written: where the role was asked to go.
+---------------------------------------------------------------------------------------------------------------------------*/
+static INT DescribeRole(CHAR *buf, size_t size, DWORD dwRole)
+{
+	LPAffinitySpec	spec	= &specs[dwRole];
+	INT				written	= 0;
+	DWORD			i, j;
+
+	switch (spec->dwMode)
+	{
+	case AFFINITY_AUTO:
+		return sprintf_s(buf, size, "auto");
+	case AFFINITY_NODE:
+		return sprintf_s(buf, size, "node %u", spec->wNode);
+	case AFFINITY_CPUS:
+		written += sprintf_s(buf, size, "processors");
+		for (i = 0; i < MAXIMUM_PROC_PER_GROUP; i = j)
+		{
+			for (; i < MAXIMUM_PROC_PER_GROUP && !(spec->mask & ((KAFFINITY)1 << i)); i++)
+				;
+			if (i == MAXIMUM_PROC_PER_GROUP)
+				break;
+			for (j = i; j < MAXIMUM_PROC_PER_GROUP && (spec->mask & ((KAFFINITY)1 << j)); j++)
+				;
+			written += j - 1 == i ? sprintf_s(buf + written, size - written, " %lu", i) :
+				sprintf_s(buf + written, size - written, " %lu-%lu", i, j - 1);
+		}
+		return written;
+	}
+	return sprintf_s(buf, size, "not placed");
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatAffinityReport
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatAffinityReport(CHAR *buf, size_t size, LPAffinityState a)
+--							CHAR *buf:			The buffer to write the report section into.
+--							size_t size:		The space left in buf.
+--							LPAffinityState a:	Where the transfer ran.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The processors are listed by node; the one the transfer's thread ended on is marked with a *.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatAffinityReport(CHAR *buf, size_t size, LPAffinityState a)
+{
+	INT		written = 0;
+	DWORD	dwNode, dwLastNode = 0, dwOnNode, dwBusy, i;
+
+	if (a->dwCpus == 0)
+		return 0;
+
+	written += sprintf_s(buf, size, "Placement: I/O threads ");
+	written += DescribeRole(buf + written, size - written, AFFINITY_IO);
+	written += sprintf_s(buf + written, size - written, ", disk writers ");
+	written += DescribeRole(buf + written, size - written, AFFINITY_DISK);
+	written += sprintf_s(buf + written, size - written, ", buffer pool ");
+	written += DescribeRole(buf + written, size - written, AFFINITY_POOL);
+	written += sprintf_s(buf + written, size - written, "\r\n");
+
+	if (a->nNicNode >= 0)
+		written += sprintf_s(buf + written, size - written,
+			"NIC traffic arrives on node %d (%lu receive processors); the transfer ran on processor %u:%u, node %u%s\r\n",
+			a->nNicNode, a->dwNicCpus, a->endCpu.Group, a->endCpu.Number, a->wEndNode,
+			a->wEndNode == a->nNicNode ? "" : " (across nodes from the NIC)");
+	else
+		written += sprintf_s(buf + written, size - written,
+			"NIC's node unknown (no RSS information for this socket); the transfer ran on processor %u:%u, node %u\r\n",
+			a->endCpu.Group, a->endCpu.Number, a->wEndNode);
+
+	for (i = 0; i < a->dwCpus; i++)
+		dwLastNode = max(dwLastNode, (DWORD)a->nodes[i]);
+	for (dwNode = 0; dwNode <= dwLastNode; dwNode++)
+	{
+		for (dwOnNode = 0, dwBusy = 0, i = 0; i < a->dwCpus; i++)
+			if (a->nodes[i] == dwNode)
+			{
+				dwOnNode++;
+				dwBusy += a->busy[i];
+			}
+		if (dwOnNode == 0)
+			continue;
+
+		written += sprintf_s(buf + written, size - written, "Node %lu, group %u: %lu%% busy on average over %.0fms",
+			dwNode, a->endCpu.Group, dwBusy / dwOnNode, a->dWallMs);
+		for (dwOnNode = 0, i = 0; i < a->dwCpus; i++)
+		{
+			if (a->nodes[i] != dwNode)
+				continue;
+			written += sprintf_s(buf + written, size - written, "%s%lu:%u%%%s",
+				dwOnNode++ % AFFINITY_PER_LINE == 0 ? "\r\n\t" : " ", i, a->busy[i], i == a->endCpu.Number ? "*" : "");
+		}
+		written += sprintf_s(buf + written, size - written, "\r\n");
+	}
+	return written;
+}
@@ -0,0 +1,45 @@
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <Winternl.h>
+#include <mstcpip.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Pool.h"
+
+#define AFFINITY_IO			0			// The transfer workers (-iocpus)
+#define AFFINITY_DISK		1			// The multi-file writers (-diskcpus)
+#define AFFINITY_POOL		2			// The buffer pool's slabs (-poolnode)
+#define AFFINITY_ROLES		3
+
+#define AFFINITY_NONE		0			// Left where Windows puts it
+#define AFFINITY_AUTO		1			// On the NIC's NUMA node, once a transfer's socket says which that is
+#define AFFINITY_NODE		2			// On a chosen node
+#define AFFINITY_CPUS		3			// On chosen processors of group 0, one each where there are several threads
+
+#define AFFINITY_ANY		0xFFFFFFFF	// PlaceThread: the thread may use all of the role's processors
+
+#define AFFINITY_PER_LINE	16			// Processors per line of the report
+
+/* Where one role's threads or memory go. */
+typedef struct _AffinitySpec
+{
+	DWORD		dwMode;
+	USHORT		wNode;		// AFFINITY_NODE
+	KAFFINITY	mask;		// AFFINITY_CPUS
+} AffinitySpec, *LPAffinitySpec;
+
+BOOL ParseAffinity(DWORD dwRole, const CHAR *szSpec);
+DWORD AffinityCpus(DWORD dwRole);
+VOID PlaceThread(DWORD dwRole, DWORD dwIndex);
+VOID PlaceTransfer(LPTransferProps props);
+VOID StopCoreSample(LPAffinityState a);
+VOID UnplaceTransfer(LPTransferProps props);
+INT FormatAffinityReport(CHAR *buf, size_t size, LPAffinityState a);
+
+#endif
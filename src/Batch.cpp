@@ -0,0 +1,1015 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Batch.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- BOOL IsBatchPath(const TCHAR *szPath);
+-- BOOL IsDirectoryPath(const TCHAR *szPath);
+-- BOOL LoadBatch(LPBatchSource src, const TCHAR *szPaths, LPBatchState state);
+-- BOOL ReadBatch(LPBatchSource src, BYTE *buf, DWORD dwLen, LPBatchState state);
+-- VOID FreeBatchSource(LPBatchSource src);
+-- BOOL StartBatchSink(LPBatchSink sink, const TCHAR *szRoot, LPBatchState state);
+-- BOOL ReceiveBatchData(LPBatchSink sink, ULONGLONG qwOffset, const BYTE *data, DWORD dwLen);
+-- VOID FinishBatchSink(LPBatchSink sink);
+-- VOID FreeBatchSink(LPBatchSink sink);
+-- INT FormatBatchReport(CHAR *buf, size_t size, LPBatchState state, double dSeconds, BOOL bReceiver);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file sends a directory tree, or several files, over a single connection. The sender walks the tree
+--			and builds a list of every file and directory with its size and relative path. The transfer is then one
+--			stream: the list followed by the contents of the files back to back. That stream is cut into chunks
+--			exactly like a single file (see ClientTransfer.cpp), so small files share chunks and compression,
+--			checksums and the whole-file digest all work unchanged.
+--
+--			The receiver creates the directories as soon as the list has arrived, then splits each chunk at file
+--			boundaries and hands the pieces to a few writer threads. Each file always goes to the same writer, so
+--			its pieces are written in order, while creating and closing many small files, which costs far more
+--			than writing them, happens in parallel.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Batch.h"
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsDirectoryPath
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsDirectoryPath(const TCHAR *szPath)
+--
+-- RETURNS: TRUE if the path is an existing directory or ends in a path separator.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsDirectoryPath(const TCHAR *szPath)
+{
+	DWORD	dwAttrs	= GetFileAttributes(szPath);
+	size_t	len		= _tcslen(szPath);
+
+	if (dwAttrs != INVALID_FILE_ATTRIBUTES && (dwAttrs & FILE_ATTRIBUTE_DIRECTORY))
+		return TRUE;
+	return len > 0 && (szPath[len - 1] == TEXT('\\') || szPath[len - 1] == TEXT('/'));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsBatchPath
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsBatchPath(const TCHAR *szPath)
+--
+-- RETURNS: TRUE if the path to send is a directory or a list of paths separated by BATCH_SEPARATOR.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsBatchPath(const TCHAR *szPath)
+{
+	return _tcschr(szPath, BATCH_SEPARATOR) != NULL || IsDirectoryPath(szPath);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Reserve
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Reserve(VOID **pp, DWORD *pdwCap, DWORD dwNeed, size_t elemSize)
+--							VOID **pp:			The array.
+--							DWORD *pdwCap:		Its capacity, in elements.
+--							DWORD dwNeed:		The number of elements it must hold.
+--							size_t elemSize:	The size of an element.
+--
+-- RETURNS: FALSE if the array couldn't be grown; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL Reserve(VOID **pp, DWORD *pdwCap, DWORD dwNeed, size_t elemSize)
+{
+	DWORD	dwCap = *pdwCap ? *pdwCap : 256;
+	VOID	*p;
+
+	if (dwNeed <= *pdwCap)
+		return TRUE;
+
+	while (dwCap < dwNeed)
+		dwCap *= 2;
+
+	if ((p = realloc(*pp, dwCap * elemSize)) == NULL)
+		return FALSE;
+
+	*pp = p;
+	*pdwCap = dwCap;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NameToUtf8
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NameToUtf8(const TCHAR *szName, CHAR *buf, INT nSize)
+--
+-- RETURNS: The length of the converted name, or 0 if it doesn't fit.
+---------------------------------------------------------------------------------------------------------------------------*/
+static INT NameToUtf8(const TCHAR *szName, CHAR *buf, INT nSize)
+{
+#ifdef UNICODE
+	INT nLen = WideCharToMultiByte(CP_UTF8, 0, szName, -1, buf, nSize, NULL, NULL);
+	return nLen > 0 ? nLen - 1 : 0;
+#else
+	return strcpy_s(buf, nSize, szName) == 0 ? (INT)strlen(buf) : 0;
+#endif
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Utf8ToName
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Utf8ToName(const CHAR *src, INT nLen, TCHAR *buf, INT nSize)
+--
+-- RETURNS: The length of the converted (and NUL-terminated) name, or 0 if it isn't valid.
+---------------------------------------------------------------------------------------------------------------------------*/
+static INT Utf8ToName(const CHAR *src, INT nLen, TCHAR *buf, INT nSize)
+{
+#ifdef UNICODE
+	INT nOut = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, src, nLen, buf, nSize - 1);
+#else
+	INT nOut = (nLen < nSize) ? nLen : 0;
+	memcpy(buf, src, nOut);
+#endif
+	buf[nOut] = 0;
+	return nOut;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsSafeName
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsSafeName(const TCHAR *szName)
+--
+-- RETURNS: TRUE if the path stays inside the destination directory.
+--
+-- NOTES:
+-- The names come from the other end of the connection, so absolute paths, drive letters and ".." are refused.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL IsSafeName(const TCHAR *szName)
+{
+	const TCHAR *p = szName;
+
+	if (_tcschr(szName, TEXT(':')) != NULL)
+		return FALSE;
+
+	for (;;)
+	{
+		const TCHAR *end = p;
+
+		while (*end != 0 && *end != TEXT('\\') && *end != TEXT('/'))
+			end++;
+
+		// Empty components catch leading, trailing and doubled separators
+		if (end == p || (end - p == 1 && p[0] == TEXT('.')) || (end - p == 2 && p[0] == TEXT('.') && p[1] == TEXT('.')))
+			return FALSE;
+		if (*end == 0)
+			return TRUE;
+		p = end + 1;
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AddEntry
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AddEntry(LPBatchSource src, const TCHAR *szFull, const TCHAR *szRel, ULONGLONG qwSize, DWORD dwFlags,
+--						LPBatchState state)
+--							LPBatchSource src:	The sender's batch.
+--							TCHAR *szFull:		The path to read the file from.
+--							TCHAR *szRel:		Its path relative to the root, as the receiver will see it.
+--							ULONGLONG qwSize:	Its size (zero for a directory).
+--							DWORD dwFlags:		BATCH_DIRECTORY or 0.
+--							LPBatchState state:	The sender's counters.
+--
+-- RETURNS: FALSE if the name is too long or memory ran out; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL AddEntry(LPBatchSource src, const TCHAR *szFull, const TCHAR *szRel, ULONGLONG qwSize, DWORD dwFlags,
+	LPBatchState state)
+{
+	CHAR			szUtf8[BATCH_MAXNAME];
+	BatchListEntry	le;
+	DWORD			dwFullLen	= (DWORD)_tcslen(szFull) + 1;
+	INT				nNameLen	= NameToUtf8(szRel, szUtf8, BATCH_MAXNAME);
+
+	if (nNameLen == 0 || src->dwListLen + sizeof(le) + nNameLen > BATCH_MAXLIST)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Can't Send File"), TEXT("The path of %s is too long, or there are too many files."),
+			szFull);
+		return FALSE;
+	}
+
+	if (!Reserve((VOID **)&src->entries, &src->dwEntryCap, src->dwEntries + 1, sizeof(BatchEntry)) ||
+		!Reserve((VOID **)&src->names, &src->dwNamesCap, src->dwNamesLen + dwFullLen, sizeof(TCHAR)) ||
+		!Reserve((VOID **)&src->list, &src->dwListCap, src->dwListLen + sizeof(le) + nNameLen, 1))
+	{
+		MessageBox(NULL, TEXT("Couldn't allocate the file list."), TEXT("No Memory Allocated"), MB_ICONERROR);
+		return FALSE;
+	}
+
+	src->entries[src->dwEntries].qwStart	= 0;
+	src->entries[src->dwEntries].qwSize		= qwSize;
+	src->entries[src->dwEntries].dwFlags	= dwFlags;
+	src->entries[src->dwEntries].dwName		= src->dwNamesLen;
+	memcpy(src->names + src->dwNamesLen, szFull, dwFullLen * sizeof(TCHAR));
+	src->dwNamesLen += dwFullLen;
+	src->dwEntries++;
+
+	le.qwSize	= qwSize;
+	le.wFlags	= (WORD)dwFlags;
+	le.wNameLen	= (WORD)nNameLen;
+	memcpy(src->list + src->dwListLen, &le, sizeof(le));
+	memcpy(src->list + src->dwListLen + sizeof(le), szUtf8, nNameLen);
+	src->dwListLen += sizeof(le) + nNameLen;
+
+	if (dwFlags & BATCH_DIRECTORY)
+		state->dwDirs++;
+	else
+		state->dwFiles++;
+	state->qwDataBytes += qwSize;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AddTree
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AddTree(LPBatchSource src, TCHAR *szFull, size_t fullLen, TCHAR *szRel, size_t relLen, LPBatchState state)
+--							LPBatchSource src:	The sender's batch.
+--							TCHAR *szFull:		The directory's path, in a BATCH_PATH_SIZE buffer.
+--							size_t fullLen:		Its length.
+--							TCHAR *szRel:		Its path relative to the root (empty for the root), in a BATCH_PATH_SIZE buffer.
+--							size_t relLen:		Its length.
+--							LPBatchState state:	The sender's counters.
+--
+-- RETURNS: FALSE if an entry couldn't be added; TRUE otherwise.
+--
+-- NOTES:
+-- Adds everything under a directory, each directory before its contents. The two path buffers are extended in place
+-- for each entry and put back afterwards. Reparse points are skipped so that a link can't loop the walk.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL AddTree(LPBatchSource src, TCHAR *szFull, size_t fullLen, TCHAR *szRel, size_t relLen, LPBatchState state)
+{
+	WIN32_FIND_DATA	fd;
+	HANDLE			hFind;
+	BOOL			bOk		= TRUE;
+
+	_stprintf_s(szFull + fullLen, BATCH_PATH_SIZE - fullLen, TEXT("\\*"));
+	hFind = FindFirstFile(szFull, &fd);
+	szFull[fullLen] = 0;
+	if (hFind == INVALID_HANDLE_VALUE)
+		return TRUE; // Empty or unreadable; the directory entry itself has already been added
+
+	do
+	{
+		size_t newFull, newRel;
+
+		if (_tcscmp(fd.cFileName, TEXT(".")) == 0 || _tcscmp(fd.cFileName, TEXT("..")) == 0 ||
+			(fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+			continue;
+
+		if (_stprintf_s(szFull + fullLen, BATCH_PATH_SIZE - fullLen, TEXT("\\%s"), fd.cFileName) < 0 ||
+			_stprintf_s(szRel + relLen, BATCH_PATH_SIZE - relLen, relLen ? TEXT("\\%s") : TEXT("%s"), fd.cFileName) < 0)
+		{
+			MessageBoxPrintf(MB_ICONERROR, TEXT("Can't Send File"), TEXT("The path of %s is too long."), fd.cFileName);
+			bOk = FALSE;
+			break;
+		}
+		newFull	= _tcslen(szFull);
+		newRel	= _tcslen(szRel);
+
+		if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			bOk = AddEntry(src, szFull, szRel, 0, BATCH_DIRECTORY, state) &&
+				AddTree(src, szFull, newFull, szRel, newRel, state);
+		else
+			bOk = AddEntry(src, szFull, szRel, ((ULONGLONG)fd.nFileSizeHigh << 32) | fd.nFileSizeLow, 0, state);
+
+		szFull[fullLen]	= 0;
+		szRel[relLen]	= 0;
+	} while (bOk && FindNextFile(hFind, &fd));
+
+	FindClose(hFind);
+	return bOk;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LoadBatch
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LoadBatch(LPBatchSource src, const TCHAR *szPaths, LPBatchState state)
+--							LPBatchSource src:	The batch to fill.
+--							TCHAR *szPaths:		A directory, or paths separated by BATCH_SEPARATOR.
+--							LPBatchState state:	The sender's counters.
+--
+-- RETURNS: FALSE if a path doesn't exist or the list couldn't be built; TRUE otherwise.
+--
+-- NOTES:
+-- A single directory sends its contents, so they land directly in the receiver's directory. Each path in a list is
+-- sent under its own name. Once everything has been found, each file's offset in the stream is worked out.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL LoadBatch(LPBatchSource src, const TCHAR *szPaths, LPBatchState state)
+{
+	TCHAR				szList[FILENAME_SIZE];
+	TCHAR				szFull[BATCH_PATH_SIZE];
+	TCHAR				szRel[BATCH_PATH_SIZE];
+	TCHAR				*context = NULL;
+	TCHAR				*szPath;
+	TCHAR				szSep[2] = { BATCH_SEPARATOR, 0 };
+	BOOL				bSingle = _tcschr(szPaths, BATCH_SEPARATOR) == NULL;
+	BatchListHeader		hdr;
+	ULONGLONG			qwOffset;
+	DWORD				i;
+
+	FreeBatchSource(src);
+	memset(state, 0, sizeof(BatchState));
+	src->hCur = INVALID_HANDLE_VALUE;
+
+	if (!Reserve((VOID **)&src->list, &src->dwListCap, sizeof(hdr), 1))
+		return FALSE;
+	src->dwListLen = sizeof(hdr);
+
+	_tcscpy_s(szList, szPaths);
+	for (szPath = _tcstok_s(szList, szSep, &context); szPath != NULL; szPath = _tcstok_s(NULL, szSep, &context))
+	{
+		WIN32_FILE_ATTRIBUTE_DATA	fad;
+		TCHAR						*szName;
+		size_t						len;
+
+		while (*szPath == TEXT(' '))
+			szPath++;
+		len = _tcslen(szPath);
+		while (len > 0 && (szPath[len - 1] == TEXT(' ') || szPath[len - 1] == TEXT('\\') || szPath[len - 1] == TEXT('/')))
+			szPath[--len] = 0;
+
+		if (len == 0)
+			continue;
+
+		if (!GetFileAttributesEx(szPath, GetFileExInfoStandard, &fad))
+		{
+			MessageBoxPrintf(MB_ICONERROR, TEXT("Couldn't Open File"), TEXT("Could not find %s. System Error: %d"), szPath,
+				GetLastError());
+			return FALSE;
+		}
+
+		szName = szPath + len;
+		while (szName > szPath && szName[-1] != TEXT('\\') && szName[-1] != TEXT('/'))
+			szName--;
+
+		_tcscpy_s(szFull, szPath);
+		if (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			_tcscpy_s(szRel, bSingle ? TEXT("") : szName);
+			if ((!bSingle && !AddEntry(src, szFull, szRel, 0, BATCH_DIRECTORY, state)) ||
+				!AddTree(src, szFull, _tcslen(szFull), szRel, _tcslen(szRel), state))
+				return FALSE;
+		}
+		else if (!AddEntry(src, szFull, szName, ((ULONGLONG)fad.nFileSizeHigh << 32) | fad.nFileSizeLow, 0, state))
+			return FALSE;
+	}
+
+	hdr.dwMagic		= BATCH_MAGIC;
+	hdr.dwEntries	= src->dwEntries;
+	hdr.qwListBytes	= src->dwListLen;
+	hdr.qwDataBytes	= state->qwDataBytes;
+	memcpy(src->list, &hdr, sizeof(hdr));
+
+	qwOffset = src->dwListLen;
+	for (i = 0; i < src->dwEntries; i++)
+	{
+		src->entries[i].qwStart = qwOffset;
+		qwOffset += src->entries[i].qwSize;
+	}
+
+	src->qwTotal		= qwOffset;
+	src->qwPos			= 0;
+	src->dwCur			= 0;
+	src->bActive		= TRUE;
+	state->qwListBytes	= src->dwListLen;
+	state->bActive		= TRUE;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReadBatch
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReadBatch(LPBatchSource src, BYTE *buf, DWORD dwLen, LPBatchState state)
+--							LPBatchSource src:	The sender's batch.
+--							BYTE *buf:			Receives the next dwLen bytes of the stream.
+--							DWORD dwLen:		How much to read; it mustn't run past qwTotal.
+--							LPBatchState state:	The sender's counters.
+--
+-- RETURNS: FALSE if a file couldn't be read or has changed size since the list was built; TRUE otherwise.
+--
+-- NOTES:
+-- Reads the list, then each file in turn, opening it when the stream reaches it and closing it at its end. A read
+-- that crosses the end of one file carries on into the next, which is how small files end up sharing a chunk.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ReadBatch(LPBatchSource src, BYTE *buf, DWORD dwLen, LPBatchState state)
+{
+	DWORD dwFiles = 0;
+
+	while (dwLen > 0)
+	{
+		LPBatchEntry	e;
+		DWORD			dwPart, dwRead;
+
+		if (src->qwPos < src->dwListLen)
+		{
+			dwPart = (DWORD)min((ULONGLONG)dwLen, src->dwListLen - src->qwPos);
+			memcpy(buf, src->list + src->qwPos, dwPart);
+		}
+		else
+		{
+			// Directories and empty files take up no room in the stream
+			while (src->dwCur < src->dwEntries &&
+				src->qwPos >= src->entries[src->dwCur].qwStart + src->entries[src->dwCur].qwSize)
+				src->dwCur++;
+			if (src->dwCur >= src->dwEntries)
+				return FALSE;
+
+			e = &src->entries[src->dwCur];
+			if (src->hCur == INVALID_HANDLE_VALUE)
+			{
+				src->hCur = CreateFile(src->names + e->dwName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+					FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+				if (src->hCur == INVALID_HANDLE_VALUE)
+				{
+					MessageBoxPrintf(MB_ICONERROR, TEXT("Couldn't Open File"), TEXT("Could not open %s. System Error: %d"),
+						src->names + e->dwName, GetLastError());
+					state->dwFailed++;
+					return FALSE;
+				}
+			}
+
+			dwPart = (DWORD)min((ULONGLONG)dwLen, e->qwStart + e->qwSize - src->qwPos);
+			if (!TraceReadFile(src->hCur, buf, dwPart, &dwRead) || dwRead != dwPart)
+			{
+				MessageBoxPrintf(MB_ICONERROR, TEXT("ReadFile Failed"), TEXT("Could not read %s; it may have changed while being sent. Error %d"),
+					src->names + e->dwName, GetLastError());
+				state->dwFailed++;
+				return FALSE;
+			}
+
+			if (src->qwPos + dwPart == e->qwStart + e->qwSize)
+			{
+				CloseHandle(src->hCur);
+				src->hCur = INVALID_HANDLE_VALUE;
+			}
+			dwFiles++;
+		}
+
+		src->qwPos += dwPart;
+		buf += dwPart;
+		dwLen -= dwPart;
+	}
+
+	if (dwFiles > 1)
+		state->dwSharedChunks++;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FreeBatchSource
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FreeBatchSource(LPBatchSource src)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FreeBatchSource(LPBatchSource src)
+{
+	if (src->bActive && src->hCur != INVALID_HANDLE_VALUE)
+		CloseHandle(src->hCur);
+	free(src->entries);
+	free(src->names);
+	free(src->list);
+	memset(src, 0, sizeof(BatchSource));
+	src->hCur = INVALID_HANDLE_VALUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BatchWriterProc
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BatchWriterProc(VOID *param)
+--							VOID *param:	The thread's LPBatchWriter.
+--
+-- RETURNS: 0.
+--
+-- NOTES:
+-- Takes writes off the queue until it's told to stop. A file is created when its first piece arrives and closed once
+-- its last byte has been written. A file that can't be created or written is counted as failed and the rest of its
+-- pieces are dropped. The thread goes where -diskcpus says first (see Affinity.cpp).
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD WINAPI BatchWriterProc(VOID *param)
+{
+	LPBatchWriter	w		= (LPBatchWriter)param;
+	LPBatchSink		sink	= w->sink;
+	HANDLE			hFile	= INVALID_HANDLE_VALUE;
+	DWORD			dwFile	= BATCH_STOP;
+	ULONGLONG		qwPos	= 0;
+	BOOL			bFailed	= FALSE;
+	TCHAR			szPath[BATCH_PATH_SIZE];
+
+	PlaceThread(AFFINITY_DISK, (DWORD)(w - sink->writers));
+	NameTraceThread("Writer", (DWORD)(w - sink->writers));
+	for (;;)
+	{
+		BatchWrite		item;
+		LPBatchEntry	e;
+		LARGE_INTEGER	liOffset;
+		DWORD			dwWritten;
+
+		WaitForSingleObject(w->hItems, INFINITE);
+		item = w->queue[w->dwHead];
+		w->dwHead = (w->dwHead + 1) % BATCH_QUEUELEN;
+		ReleaseSemaphore(w->hSlots, 1, NULL);
+
+		if (item.dwEntry == BATCH_STOP)
+			break;
+
+		e = &sink->entries[item.dwEntry];
+		if (item.dwEntry != dwFile)
+		{
+			if (hFile != INVALID_HANDLE_VALUE)
+				CloseHandle(hFile);
+
+			dwFile	= item.dwEntry;
+			qwPos	= 0;
+			_stprintf_s(szPath, BATCH_PATH_SIZE, TEXT("%s\\%s"), sink->szRoot, sink->names + e->dwName);
+			hFile = CreateFile(szPath, GENERIC_WRITE, 0, NULL, item.qwOffset == 0 ? CREATE_ALWAYS : OPEN_ALWAYS,
+				FILE_ATTRIBUTE_NORMAL, NULL);
+			if ((bFailed = (hFile == INVALID_HANDLE_VALUE)))
+				InterlockedIncrement(&sink->lFailed);
+		}
+
+		if (!bFailed && item.dwLen != 0)
+		{
+			liOffset.QuadPart = item.qwOffset;
+			if ((item.qwOffset != qwPos && !SetFilePointerEx(hFile, liOffset, NULL, FILE_BEGIN)) ||
+				!TraceWriteFile(hFile, item.data, item.dwLen, &dwWritten) || dwWritten != item.dwLen)
+			{
+				InterlockedIncrement(&sink->lFailed);
+				CloseHandle(hFile);
+				hFile = INVALID_HANDLE_VALUE;
+				bFailed = TRUE;
+			}
+			qwPos = item.qwOffset + item.dwLen;
+		}
+		PoolFree(item.data);
+
+		if (hFile != INVALID_HANDLE_VALUE && item.qwOffset + item.dwLen >= e->qwSize)
+		{
+			CloseHandle(hFile);
+			hFile	= INVALID_HANDLE_VALUE;
+			dwFile	= BATCH_STOP;
+		}
+	}
+
+	if (hFile != INVALID_HANDLE_VALUE)
+		CloseHandle(hFile);
+	PoolFlushThread();
+	DetachTrace();
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PostWrite
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PostWrite(LPBatchWriter w, DWORD dwEntry, ULONGLONG qwOffset, const BYTE *data, DWORD dwLen)
+--							LPBatchWriter w:		The writer to queue it on.
+--							DWORD dwEntry:			The entry to write to, or BATCH_STOP.
+--							ULONGLONG qwOffset:		Where in the file.
+--							BYTE *data:				The data; it's copied, since the chunk buffer is about to be reused.
+--							DWORD dwLen:			Its length.
+--
+-- RETURNS: FALSE if the copy couldn't be allocated; TRUE otherwise.
+--
+-- NOTES:
+-- Waits if the writer's queue is full, which holds up the receive and so slows the sender to the disk's pace.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL PostWrite(LPBatchWriter w, DWORD dwEntry, ULONGLONG qwOffset, const BYTE *data, DWORD dwLen)
+{
+	BatchWrite item;
+
+	item.dwEntry	= dwEntry;
+	item.qwOffset	= qwOffset;
+	item.dwLen		= dwLen;
+	item.data		= NULL;
+	if (dwLen != 0)
+	{
+		if ((item.data = (BYTE *)PoolAlloc(dwLen)) == NULL)
+			return FALSE;
+		memcpy(item.data, data, dwLen);
+	}
+
+	WaitForSingleObject(w->hSlots, INFINITE);
+	w->queue[w->dwTail] = item;
+	w->dwTail = (w->dwTail + 1) % BATCH_QUEUELEN;
+	ReleaseSemaphore(w->hItems, 1, NULL);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StartBatchSink
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StartBatchSink(LPBatchSink sink, const TCHAR *szRoot, LPBatchState state)
+--							LPBatchSink sink:	The receiver's batch.
+--							TCHAR *szRoot:		The directory to recreate the tree in; it's created if need be.
+--							LPBatchState state:	The receiver's counters.
+--
+-- RETURNS: FALSE if the directory couldn't be created or no writer thread could be started; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL StartBatchSink(LPBatchSink sink, const TCHAR *szRoot, LPBatchState state)
+{
+	size_t	len;
+	DWORD	i;
+
+	FreeBatchSink(sink);
+	memset(state, 0, sizeof(BatchState));
+
+	_tcscpy_s(sink->szRoot, szRoot);
+	len = _tcslen(sink->szRoot);
+	while (len > 0 && (sink->szRoot[len - 1] == TEXT('\\') || sink->szRoot[len - 1] == TEXT('/')))
+		sink->szRoot[--len] = 0;
+
+	if (!CreateDirectory(sink->szRoot, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("CreateDirectory Failed"), TEXT("Could not create %s, error %d"), sink->szRoot,
+			GetLastError());
+		return FALSE;
+	}
+
+	sink->qwListBytes = sizeof(BatchListHeader);
+	if ((sink->list = (BYTE *)malloc(sizeof(BatchListHeader))) == NULL)
+		return FALSE;
+
+	for (i = 0; i < BATCH_WRITERS; i++)
+	{
+		LPBatchWriter w = &sink->writers[sink->dwWriters];
+
+		w->sink		= sink;
+		w->dwHead	= 0;
+		w->dwTail	= 0;
+		w->hSlots	= CreateSemaphore(NULL, BATCH_QUEUELEN, BATCH_QUEUELEN, NULL);
+		w->hItems	= CreateSemaphore(NULL, 0, BATCH_QUEUELEN, NULL);
+		w->hThread	= (w->hSlots && w->hItems) ? CreateThread(NULL, 0, BatchWriterProc, w, 0, NULL) : NULL;
+		if (w->hThread == NULL)
+		{
+			if (w->hSlots)
+				CloseHandle(w->hSlots);
+			if (w->hItems)
+				CloseHandle(w->hItems);
+			break;
+		}
+		sink->dwWriters++;
+	}
+
+	sink->state		= state;
+	sink->bActive	= TRUE;
+	state->bActive	= TRUE;
+	state->dwWriters = sink->dwWriters;
+	return sink->dwWriters > 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ParseBatchList
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ParseBatchList(LPBatchSink sink)
+--
+-- RETURNS: FALSE if the list is malformed or names a path outside the destination; TRUE otherwise.
+--
+-- NOTES:
+-- Called once the whole list has arrived. Directories are created here, in list order so parents come first, and
+-- empty files are queued straight away since no data will arrive for them.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL ParseBatchList(LPBatchSink sink)
+{
+	LPBatchListHeader	hdr			= (LPBatchListHeader)sink->list;
+	ULONGLONG			qwOffset	= sink->qwListBytes;
+	ULONGLONG			qwData		= 0;
+	DWORD				dwPos		= sizeof(BatchListHeader);
+	DWORD				dwNames		= 0;
+	TCHAR				szPath[BATCH_PATH_SIZE];
+	DWORD				i;
+
+	sink->names = (TCHAR *)malloc(((size_t)sink->qwListBytes + hdr->dwEntries) * sizeof(TCHAR));
+	if (sink->names == NULL)
+		return FALSE;
+
+	for (i = 0; i < hdr->dwEntries; i++)
+	{
+		BatchListEntry	le;
+		LPBatchEntry	e = &sink->entries[i];
+		INT				nLen;
+
+		if (dwPos + sizeof(le) > sink->qwListBytes)
+			return FALSE;
+		memcpy(&le, sink->list + dwPos, sizeof(le));
+		dwPos += sizeof(le);
+
+		if (le.wNameLen == 0 || le.wNameLen >= BATCH_MAXNAME || dwPos + le.wNameLen > sink->qwListBytes ||
+			((le.wFlags & BATCH_DIRECTORY) && le.qwSize != 0))
+			return FALSE;
+
+		nLen = Utf8ToName((CHAR *)sink->list + dwPos, le.wNameLen, sink->names + dwNames, BATCH_MAXNAME);
+		if (nLen == 0 || !IsSafeName(sink->names + dwNames))
+			return FALSE;
+		dwPos += le.wNameLen;
+
+		e->qwStart	= qwOffset;
+		e->qwSize	= le.qwSize;
+		e->dwFlags	= le.wFlags;
+		e->dwName	= dwNames;
+		dwNames += nLen + 1;
+		qwOffset += le.qwSize;
+		qwData += le.qwSize;
+		sink->dwEntries++;
+
+		if (e->dwFlags & BATCH_DIRECTORY)
+		{
+			sink->state->dwDirs++;
+			_stprintf_s(szPath, BATCH_PATH_SIZE, TEXT("%s\\%s"), sink->szRoot, sink->names + e->dwName);
+			if (!CreateDirectory(szPath, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+				InterlockedIncrement(&sink->lFailed);
+		}
+		else
+		{
+			sink->state->dwFiles++;
+			if (e->qwSize == 0 && !PostWrite(&sink->writers[i % sink->dwWriters], i, 0, NULL, 0))
+				return FALSE;
+		}
+	}
+
+	if (dwPos != sink->qwListBytes || qwData != hdr->qwDataBytes)
+		return FALSE;
+
+	sink->state->qwDataBytes	= qwData;
+	sink->state->qwListBytes	= sink->qwListBytes;
+	sink->bListDone				= TRUE;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReceiveBatchData
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReceiveBatchData(LPBatchSink sink, ULONGLONG qwOffset, const BYTE *data, DWORD dwLen)
+--							LPBatchSink sink:		The receiver's batch.
+--							ULONGLONG qwOffset:		The stream offset of the data.
+--							BYTE *data:				A verified chunk of the stream.
+--							DWORD dwLen:			Its length.
+--
+-- RETURNS: FALSE if the list is malformed, incomplete or doesn't account for the data; TRUE otherwise.
+--
+-- NOTES:
+-- Collects the list until it's complete, then splits the data that follows at file boundaries and queues each piece
+-- on its file's writer. A chunk that failed its CRC leaves a gap; the list can't be parsed without it, but later data
+-- can still be placed by its offset (the transfer will be reported as failed either way).
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ReceiveBatchData(LPBatchSink sink, ULONGLONG qwOffset, const BYTE *data, DWORD dwLen)
+{
+	if (qwOffset != sink->qwNext && !sink->bListDone)
+		return FALSE;
+	sink->qwNext = qwOffset + dwLen;
+
+	while (dwLen > 0)
+	{
+		DWORD dwPart;
+
+		if (!sink->bListDone)
+		{
+			dwPart = (DWORD)min((ULONGLONG)dwLen, sink->qwListBytes - qwOffset);
+			memcpy(sink->list + qwOffset, data, dwPart);
+
+			// The header says how long the rest of the list is
+			if (sink->entries == NULL && qwOffset + dwPart == sizeof(BatchListHeader))
+			{
+				LPBatchListHeader	hdr = (LPBatchListHeader)sink->list;
+				BYTE				*list;
+
+				if (hdr->dwMagic != BATCH_MAGIC || hdr->qwListBytes < sizeof(BatchListHeader) ||
+					hdr->qwListBytes > BATCH_MAXLIST || hdr->dwEntries > hdr->qwListBytes / sizeof(BatchListEntry))
+					return FALSE;
+
+				sink->qwListBytes = hdr->qwListBytes;
+				sink->entries = (LPBatchEntry)malloc((hdr->dwEntries + 1) * sizeof(BatchEntry));
+				if (sink->entries == NULL || (list = (BYTE *)realloc(sink->list, (size_t)sink->qwListBytes)) == NULL)
+					return FALSE;
+				sink->list = list;
+			}
+
+			if (sink->entries != NULL && qwOffset + dwPart == sink->qwListBytes && !ParseBatchList(sink))
+				return FALSE;
+		}
+		else
+		{
+			LPBatchEntry e;
+
+			while (sink->dwCur < sink->dwEntries &&
+				qwOffset >= sink->entries[sink->dwCur].qwStart + sink->entries[sink->dwCur].qwSize)
+				sink->dwCur++;
+			if (sink->dwCur >= sink->dwEntries)
+				return FALSE;
+
+			e = &sink->entries[sink->dwCur];
+			dwPart = (DWORD)min((ULONGLONG)dwLen, e->qwStart + e->qwSize - qwOffset);
+			if (!PostWrite(&sink->writers[sink->dwCur % sink->dwWriters], sink->dwCur, qwOffset - e->qwStart, data, dwPart))
+				return FALSE;
+		}
+
+		qwOffset += dwPart;
+		data += dwPart;
+		dwLen -= dwPart;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FinishBatchSink
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FinishBatchSink(LPBatchSink sink)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Tells the writers to stop once their queues are empty and waits for them, so every file is closed when it returns.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FinishBatchSink(LPBatchSink sink)
+{
+	HANDLE	hThreads[BATCH_WRITERS];
+	DWORD	i;
+
+	if (!sink->bActive)
+		return;
+
+	for (i = 0; i < sink->dwWriters; i++)
+	{
+		PostWrite(&sink->writers[i], BATCH_STOP, 0, NULL, 0);
+		hThreads[i] = sink->writers[i].hThread;
+	}
+
+	if (sink->dwWriters)
+		WaitForMultipleObjects(sink->dwWriters, hThreads, TRUE, INFINITE);
+
+	for (i = 0; i < sink->dwWriters; i++)
+	{
+		CloseHandle(sink->writers[i].hThread);
+		CloseHandle(sink->writers[i].hSlots);
+		CloseHandle(sink->writers[i].hItems);
+	}
+
+	sink->state->dwFailed += sink->lFailed;
+	sink->dwWriters	= 0;
+	sink->bActive	= FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FreeBatchSink
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FreeBatchSink(LPBatchSink sink)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FreeBatchSink(LPBatchSink sink)
+{
+	FinishBatchSink(sink);
+	free(sink->list);
+	free(sink->entries);
+	free(sink->names);
+	memset(sink, 0, sizeof(BatchSink));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatBatchReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatBatchReport(CHAR *buf, size_t size, LPBatchState state, double dSeconds, BOOL bReceiver)
+--							CHAR *buf:			The buffer to write the report section into.
+--							size_t size:		The space left in buf.
+--							LPBatchState state:	The batch counters at the end of the transfer.
+--							double dSeconds:	The transfer time.
+--							BOOL bReceiver:		Whether this end received the files.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- Files per second and bytes per second are reported separately: with many small files the first is limited by
+-- creating and closing files, and the second by the link.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatBatchReport(CHAR *buf, size_t size, LPBatchState state, double dSeconds, BOOL bReceiver)
+{
+	INT written = 0;
+
+	written += sprintf_s(buf, size, "Files: %lu files in %lu directories, %llu bytes (%llu-byte list)\r\n",
+		state->dwFiles, state->dwDirs, state->qwDataBytes, state->qwListBytes);
+	written += sprintf_s(buf + written, size - written, "File rate: %.0f files/s, %.2f MB/s\r\n",
+		dSeconds > 0.0 ? state->dwFiles / dSeconds : 0.0, dSeconds > 0.0 ? state->qwDataBytes / dSeconds / 1e6 : 0.0);
+	if (bReceiver)
+		written += sprintf_s(buf + written, size - written, "Writers: %lu, %lu files failed\r\n", state->dwWriters,
+			state->dwFailed);
+	else
+		written += sprintf_s(buf + written, size - written, "Shared chunks: %lu\r\n", state->dwSharedChunks);
+	return written;
+}
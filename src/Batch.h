@@ -0,0 +1,133 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <tchar.h>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Pool.h"
+#include "Affinity.h"
+#include "Trace.h"
+
+#define BATCH_MAGIC			0x48435442	// "BTCH"; sent in place of MANIFEST_MAGIC to start a multi-file transfer
+#define BATCH_SEPARATOR		TEXT('|')	// Separates the paths of a multi-file transfer (it can't appear in a name)
+#define BATCH_DIRECTORY		0x0001		// The entry is a directory
+#define BATCH_MAXNAME		1024		// Longest relative path in the list (UTF-8 bytes)
+#define BATCH_MAXLIST		(64 << 20)	// Largest file list the receiver will accept
+#define BATCH_PATH_SIZE		(FILENAME_SIZE + BATCH_MAXNAME)
+#define BATCH_WRITERS		4			// Threads creating and writing files on the receiver
+#define BATCH_QUEUELEN		256			// Writes queued per writer before the receiver waits for it
+#define BATCH_STOP			0xFFFFFFFF	// Entry number that tells a writer to exit
+
+#pragma pack(push, 1)
+
+/* Starts the stream of a multi-file transfer. The list of entries follows, then the contents of the files in list
+   order, with no padding between them. */
+typedef struct _BatchListHeader
+{
+	DWORD		dwMagic;
+	DWORD		dwEntries;
+	ULONGLONG	qwListBytes;	// This header and the entries
+	ULONGLONG	qwDataBytes;	// Total size of the files
+} BatchListHeader, *LPBatchListHeader;
+
+/* One file or directory in the list; wNameLen bytes of UTF-8 path, relative to the root and using '\', follow it.
+   Directories come before anything inside them. */
+typedef struct _BatchListEntry
+{
+	ULONGLONG	qwSize;
+	WORD		wFlags;			// BATCH_DIRECTORY
+	WORD		wNameLen;
+} BatchListEntry, *LPBatchListEntry;
+
+#pragma pack(pop)
+
+/* A file or directory on either end. */
+typedef struct _BatchEntry
+{
+	ULONGLONG	qwStart;		// Stream offset of the file's first byte
+	ULONGLONG	qwSize;
+	DWORD		dwFlags;
+	DWORD		dwName;			// Offset of the path in the name pool
+} BatchEntry, *LPBatchEntry;
+
+/* The sender's side: the files found, the encoded list, and where it is in the stream. */
+typedef struct _BatchSource
+{
+	BOOL			bActive;
+	LPBatchEntry	entries;
+	DWORD			dwEntries;
+	DWORD			dwEntryCap;
+	TCHAR			*names;			// Full source paths, each NUL-terminated
+	DWORD			dwNamesLen;
+	DWORD			dwNamesCap;
+	BYTE			*list;			// The list as it's sent
+	DWORD			dwListLen;
+	DWORD			dwListCap;
+	ULONGLONG		qwTotal;		// List plus data
+	ULONGLONG		qwPos;			// Stream offset of the next read
+	DWORD			dwCur;			// Entry being read
+	HANDLE			hCur;
+} BatchSource, *LPBatchSource;
+
+/* A write handed to one of the receiver's writer threads. */
+typedef struct _BatchWrite
+{
+	DWORD			dwEntry;		// BATCH_STOP to end the thread
+	ULONGLONG		qwOffset;		// Offset within the file
+	DWORD			dwLen;
+	BYTE			*data;			// Freed by the writer
+} BatchWrite, *LPBatchWrite;
+
+struct _BatchSink;
+
+/* One writer thread and its queue. There's one producer (the receiving thread) and one consumer, so the two
+   semaphores are all the synchronisation it needs. */
+typedef struct _BatchWriter
+{
+	HANDLE				hThread;
+	HANDLE				hSlots;		// Free places in the queue
+	HANDLE				hItems;		// Writes waiting in the queue
+	BatchWrite			queue[BATCH_QUEUELEN];
+	DWORD				dwHead;		// Next write to take (writer only)
+	DWORD				dwTail;		// Next place to fill (receiving thread only)
+	struct _BatchSink	*sink;
+} BatchWriter, *LPBatchWriter;
+
+/* The receiver's side: the list as it arrives, the entries parsed from it and the writer threads. */
+typedef struct _BatchSink
+{
+	BOOL			bActive;
+	TCHAR			szRoot[FILENAME_SIZE];
+	BYTE			*list;
+	ULONGLONG		qwListBytes;
+	ULONGLONG		qwNext;			// Stream offset expected next
+	BOOL			bListDone;
+	LPBatchEntry	entries;
+	DWORD			dwEntries;
+	TCHAR			*names;			// Relative paths, each NUL-terminated
+	DWORD			dwCur;			// Entry the next data belongs to
+	BatchWriter		writers[BATCH_WRITERS];
+	DWORD			dwWriters;
+	LPBatchState	state;
+	volatile LONG	lFailed;		// Files that couldn't be created or written
+} BatchSink, *LPBatchSink;
+
+BOOL IsBatchPath(const TCHAR *szPath);
+BOOL IsDirectoryPath(const TCHAR *szPath);
+
+BOOL LoadBatch(LPBatchSource src, const TCHAR *szPaths, LPBatchState state);
+BOOL ReadBatch(LPBatchSource src, BYTE *buf, DWORD dwLen, LPBatchState state);
+VOID FreeBatchSource(LPBatchSource src);
+
+BOOL StartBatchSink(LPBatchSink sink, const TCHAR *szRoot, LPBatchState state);
+BOOL ReceiveBatchData(LPBatchSink sink, ULONGLONG qwOffset, const BYTE *data, DWORD dwLen);
+VOID FinishBatchSink(LPBatchSink sink);
+VOID FreeBatchSink(LPBatchSink sink);
+
+INT FormatBatchReport(CHAR *buf, size_t size, LPBatchState state, double dSeconds, BOOL bReceiver);
+
+#endif
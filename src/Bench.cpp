@@ -0,0 +1,956 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Bench.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- INT RunBenchmarks(LPTransferProps props);
+-- static VOID BenchCreateBuffer(DWORD dwIters, DWORD dwSize);
+-- static VOID BenchBuildPayload(DWORD dwIters, DWORD dwSize);
+-- static VOID BenchCheckPacket(DWORD dwIters, DWORD dwSize);
+-- static VOID BenchCheckStream(DWORD dwIters, DWORD dwPacketSize);
+-- static VOID BenchChunkEncode(DWORD dwIters, DWORD bCompress);
+-- static VOID BenchChunkDecode(DWORD dwIters, DWORD bCompress);
+-- static VOID BenchChunkReader(DWORD dwIters, DWORD dwPiece);
+-- static VOID BenchChunkWrite(DWORD dwIters, DWORD dwUnused);
+-- static VOID BenchChunkSeal(DWORD dwIters, DWORD dwCipher);
+-- static VOID BenchDedupCut(DWORD dwIters, DWORD dwUnused);
+-- static VOID BenchTraceEvent(DWORD dwIters, DWORD dwUnused);
+-- static VOID BenchTimestamp(DWORD dwIters, DWORD dwUnused);
+-- static VOID BenchFormatLog(DWORD dwIters, DWORD dwUnused);
+-- static BOOL SetUpFixtures(LPTransferProps props);
+-- static VOID TearDownFixtures();
+-- static double ReferenceNs();
+-- static DWORD PinAndSettle(double *pdRefNs);
+-- static int CompareDoubles(const void *a, const void *b);
+-- static double Median(double *sorted, DWORD dwCount);
+-- static VOID Measure(const BenchKernel *kernel, LPBenchResult result);
+-- static DWORD LoadBaseline(FILE *file, CHAR names[][32], double *ns, DWORD dwMax);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file times the per-packet code on its own, away from the network, so a change that slows one of
+--			the hot paths shows up even when the link hides it. Each kernel is the work one completion routine (or
+--			report) does, called through the same functions the transfer uses:
+--				create_buffer	- CreateBuffer and PoolFree (the send buffer for test packets)
+--				build_payload	- BuildPayload, which is what TCPSendCompletion/UDPSendCompletion do per test packet
+--								  besides posting the next send
+--				check_packet	- CheckPayloadPacket, UDPRecvCompletion's work per test packet
+--				check_stream	- CheckPayloadStream, TCPRecvCompletion's work per receive
+--				chunk_encode	- header encode, CRC and copy (or LZ compression) of a file chunk, as PackChunk does
+--				chunk_decode	- IsValidChunk, DecodeChunk and the CRC check of a received chunk
+--				chunk_reader	- reassembling a chunk from MSS-sized receives
+--				chunk_write		- writing a decoded chunk at its offset in a file (the OS cache, not the disk)
+--				chunk_seal		- SealChunk with AES-GCM or ChaCha20-Poly1305, what -psk adds to each chunk sent (a
+--								  processor without AES-NI does nothing in the AES-GCM kernel)
+--				dedup_cut		- finding the content-defined chunk boundaries and hashing the chunks, the sender's
+--								  work per 64 KB of a -dedup file before the transfer starts
+--				trace_event		- TraceEvent, what -trace adds to each post, completion, wait and file read or write
+--				timestamp		- CreateTimestamp
+--				format_log		- FormatTransferLog, the report behind LogTransferInfo
+--
+--			Each kernel is run in samples of about BENCH_SAMPLE_US; the samples more than BENCH_MAD_CUT scaled median
+--			absolute deviations from the median are dropped and the rest averaged. Before measuring, the thread is
+--			pinned to one processor at high priority and a reference loop is run until its time stops changing, so
+--			the core is at its working clock; the loop is timed again at the end, and if the clock moved the results
+--			are marked unreliable rather than compared. Windows doesn't let a program fix the clock itself; for
+--			the steadiest numbers use the High Performance power plan.
+--
+--			The results are written to <baseline>.csv. If the baseline file doesn't exist it's created from this
+--			run; otherwise each kernel is compared with it, and the run fails if any is more than the tolerance
+--			slower. Delete the baseline to take a new one.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Bench.h"
+
+static TransferProps	fix;				// A transfer's worth of state for the kernels to work on
+static PayloadState		sendPayload;
+static PayloadState		recvPacket;
+static PayloadState		recvStream;
+static ChunkReader		reader;
+static BYTE				*sendBuf;			// CHUNK_BUFSIZE each
+static BYTE				*packet;			// One 1 KB test packet, seq 0
+static BYTE				*stream;			// The first CHUNK_MAXPAYLOAD bytes of a 1 KB packet TCP stream
+static BYTE				*randomData;		// Incompressible file data
+static BYTE				*textData;			// File data LZ compresses to about half
+static BYTE				*plainChunk;		// A complete uncompressed chunk of randomData
+static BYTE				*lzChunk;			// A complete compressed chunk of textData
+static BYTE				*scratch;
+static CryptState		sealGcm;			// Keyed with a fixed key, as the handshake would
+static CryptState		sealChaCha;
+static HANDLE			hFile = INVALID_HANDLE_VALUE;
+static SYSTEMTIME		stNow;
+static CHAR				szOut[LOG_SIZE];
+static volatile DWORD	dwSink;				// Keeps the compiler from dropping work whose result isn't used
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchCreateBuffer
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchCreateBuffer(DWORD dwIters, DWORD dwSize)
+--						DWORD dwIters:	How many buffers to create and free.
+--						DWORD dwSize:	The packet size.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchCreateBuffer(DWORD dwIters, DWORD dwSize)
+{
+	CHAR *buf;
+
+	fix.nPacketSize = dwSize;
+	while (dwIters-- != 0)
+	{
+		if ((buf = CreateBuffer('a', &fix)) == NULL)
+			return;
+		dwSink += buf[dwSize - 1];
+		PoolFree(buf);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchBuildPayload
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchBuildPayload(DWORD dwIters, DWORD dwSize)
+--						DWORD dwIters:	How many packets to build.
+--						DWORD dwSize:	The packet size.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchBuildPayload(DWORD dwIters, DWORD dwSize)
+{
+	DWORD i;
+
+	for (i = 0; i < dwIters; i++)
+		BuildPayload(sendBuf, dwSize, i, &sendPayload);
+	dwSink += sendBuf[dwSize - 1];
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchCheckPacket
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchCheckPacket(DWORD dwIters, DWORD dwSize)
+--						DWORD dwIters:	How many times to check the packet.
+--						DWORD dwSize:	Its size.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchCheckPacket(DWORD dwIters, DWORD dwSize)
+{
+	while (dwIters-- != 0)
+		CheckPayloadPacket(&recvPacket, packet, dwSize);
+	dwSink += recvPacket.dwBadPackets;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchCheckStream
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchCheckStream(DWORD dwIters, DWORD dwPacketSize)
+--						DWORD dwIters:			How many times to check the stream.
+--						DWORD dwPacketSize:		The size of the packets in it.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Each pass starts the stream over, so the same bytes are checked against the same sequence numbers every time.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchCheckStream(DWORD dwIters, DWORD dwPacketSize)
+{
+	while (dwIters-- != 0)
+	{
+		recvStream.qwStreamOffset = 0;
+		CheckPayloadStream(&recvStream, stream, CHUNK_MAXPAYLOAD, dwPacketSize);
+	}
+	dwSink += recvStream.dwBadPackets;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchChunkEncode
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchChunkEncode(DWORD dwIters, DWORD bCompress)
+--						DWORD dwIters:		How many chunks to build.
+--						DWORD bCompress:	Whether to compress them.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchChunkEncode(DWORD dwIters, DWORD bCompress)
+{
+	LPChunkHeader	hdr		= (LPChunkHeader)sendBuf;
+	BYTE			*payload	= (BYTE *)(hdr + 1);
+	const BYTE		*data	= bCompress ? textData : randomData;
+	DWORD			dwPacked;
+	DWORD			i;
+
+	for (i = 0; i < dwIters; i++)
+	{
+		InitChunkHeader(hdr, CHUNK_DATA, i, (ULONGLONG)i * CHUNK_MAXPAYLOAD);
+		hdr->dwLogicalLen	= CHUNK_MAXPAYLOAD;
+		hdr->dwCrc			= ChecksumChunk(&fix.integrity, hdr->qwOffset, data, CHUNK_MAXPAYLOAD);
+		hdr->dwWireLen		= CHUNK_MAXPAYLOAD;
+		if (bCompress && (dwPacked = LZCompress(data, CHUNK_MAXPAYLOAD, payload, CHUNK_MAXPAYLOAD - 1)) != 0)
+		{
+			hdr->wFlags |= CHUNK_COMPRESSED;
+			hdr->dwWireLen = dwPacked;
+		}
+		else
+			memcpy(payload, data, CHUNK_MAXPAYLOAD);
+	}
+	dwSink += hdr->dwWireLen;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchChunkDecode
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchChunkDecode(DWORD dwIters, DWORD bCompress)
+--						DWORD dwIters:		How many times to decode the chunk.
+--						DWORD bCompress:	Whether to decode the compressed one.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchChunkDecode(DWORD dwIters, DWORD bCompress)
+{
+	LPChunkHeader	hdr	= (LPChunkHeader)(bCompress ? lzChunk : plainChunk);
+	BYTE			*data;
+
+	while (dwIters-- != 0)
+	{
+		if (!IsValidChunk((BYTE *)hdr, sizeof(ChunkHeader) + hdr->dwWireLen) ||
+			(data = DecodeChunk(hdr, scratch, &fix.compress)) == NULL)
+			return;
+		if (ChecksumChunk(&fix.integrity, hdr->qwOffset, data, hdr->dwLogicalLen) != hdr->dwCrc)
+			dwSink++;
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchChunkReader
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchChunkReader(DWORD dwIters, DWORD dwPiece)
+--						DWORD dwIters:	How many chunks to reassemble.
+--						DWORD dwPiece:	The size of each receive.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchChunkReader(DWORD dwIters, DWORD dwPiece)
+{
+	DWORD			dwLen	= sizeof(ChunkHeader) + ((LPChunkHeader)plainChunk)->dwWireLen;
+	DWORD			dwFed, dwTook;
+	LPChunkHeader	hdr;
+
+	while (dwIters-- != 0)
+	{
+		for (dwFed = 0; dwFed < dwLen; dwFed += dwTook)
+		{
+			dwTook = ChunkReaderFeed(&reader, plainChunk + dwFed, min(dwPiece, dwLen - dwFed));
+			while ((hdr = ChunkReaderNext(&reader)) != NULL)
+				dwSink += hdr->dwSeq;
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchChunkWrite
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchChunkWrite(DWORD dwIters, DWORD dwUnused)
+--						DWORD dwIters:	How many chunks to write.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Writes go round BENCH_FILESPAN of the file, which stays in the cache, so this is the cost of the call and the copy
+-- into the cache rather than of the disk.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchChunkWrite(DWORD dwIters, DWORD dwUnused)
+{
+	LARGE_INTEGER	liOffset;
+	DWORD			dwWritten;
+	DWORD			i;
+
+	for (i = 0; i < dwIters; i++)
+	{
+		liOffset.QuadPart = (ULONGLONG)(i % (BENCH_FILESPAN / CHUNK_MAXPAYLOAD)) * CHUNK_MAXPAYLOAD;
+		if (!SetFilePointerEx(hFile, liOffset, NULL, FILE_BEGIN) ||
+			!WriteFile(hFile, randomData, CHUNK_MAXPAYLOAD, &dwWritten, NULL))
+			return;
+	}
+	dwSink += dwWritten;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchTimestamp
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchTimestamp(DWORD dwIters, DWORD dwUnused)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchTimestamp(DWORD dwIters, DWORD dwUnused)
+{
+	while (dwIters-- != 0)
+		CreateTimestamp(szOut, &stNow);
+	dwSink += szOut[0];
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchFormatLog
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchFormatLog(DWORD dwIters, DWORD dwUnused)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchFormatLog(DWORD dwIters, DWORD dwUnused)
+{
+	while (dwIters-- != 0)
+		dwSink += FormatTransferLog(szOut, LOG_SIZE, &fix, (ULONGLONG)fix.nPacketSize * fix.nNumToSend,
+			ID_HOSTTYPE_SERVER);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchChunkSeal
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchChunkSeal(DWORD dwIters, DWORD dwCipher)
+--						DWORD dwIters:		How many chunks to seal.
+--						DWORD dwCipher:		CRYPT_AESGCM or CRYPT_CHACHA.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- The chunk is sealed over and over in place; only its header is put back each time.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchChunkSeal(DWORD dwIters, DWORD dwCipher)
+{
+	LPChunkHeader	hdr		= (LPChunkHeader)sendBuf;
+	LPCryptState	c		= dwCipher == CRYPT_AESGCM ? &sealGcm : &sealChaCha;
+	WSABUF			wsaBuf;
+
+	if (!IsCipherAvailable(dwCipher))
+		return;
+	wsaBuf.buf = (CHAR *)sendBuf;
+	while (dwIters-- != 0)
+	{
+		InitChunkHeader(hdr, CHUNK_DATA, 0, 0);
+		hdr->dwLogicalLen = hdr->dwWireLen = CHUNK_MAXPAYLOAD;
+		SealChunk(c, &wsaBuf);
+	}
+	dwSink += wsaBuf.len;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchDedupCut
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchDedupCut(DWORD dwIters, DWORD dwUnused)
+--						DWORD dwIters:	How many times to cut up the random data.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- The same work CutDedupChunks does per chunk, without the file reads: a cut point, a Hash64 and a CRC.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchDedupCut(DWORD dwIters, DWORD dwUnused)
+{
+	DWORD dwPos, dwLen;
+
+	while (dwIters-- != 0)
+	{
+		for (dwPos = 0; dwPos < CHUNK_MAXPAYLOAD; dwPos += dwLen)
+		{
+			dwLen = NextCutPoint(randomData + dwPos, CHUNK_MAXPAYLOAD - dwPos);
+			dwSink += (DWORD)Hash64(randomData + dwPos, dwLen, DEDUP_HASHSEED) + Crc32c(0, randomData + dwPos, dwLen);
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BenchTraceEvent
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BenchTraceEvent(DWORD dwIters, DWORD dwUnused)
+--						DWORD dwIters:	How many events to record.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Posts and completions by turns, so the outstanding count stays put; the ring wraps many times over.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID BenchTraceEvent(DWORD dwIters, DWORD dwUnused)
+{
+	while (dwIters-- != 0)
+		TraceEvent((dwIters & 1) ? TRACE_POST : TRACE_RECV_DONE, 1460, sendBuf);
+}
+
+static const BenchKernel kernels[] =
+{
+	{ "create_buffer_1k",	1024,				1024,				BenchCreateBuffer },
+	{ "create_buffer_64k",	65536,				65536,				BenchCreateBuffer },
+	{ "build_payload_1k",	1024,				1024,				BenchBuildPayload },
+	{ "build_payload_64k",	65536,				65536,				BenchBuildPayload },
+	{ "check_packet_1k",	1024,				1024,				BenchCheckPacket },
+	{ "check_stream_64k",	CHUNK_MAXPAYLOAD,	1024,				BenchCheckStream },
+	{ "chunk_encode_64k",	CHUNK_MAXPAYLOAD,	FALSE,				BenchChunkEncode },
+	{ "chunk_encode_lz_64k", CHUNK_MAXPAYLOAD,	TRUE,				BenchChunkEncode },
+	{ "chunk_decode_64k",	CHUNK_MAXPAYLOAD,	FALSE,				BenchChunkDecode },
+	{ "chunk_decode_lz_64k", CHUNK_MAXPAYLOAD,	TRUE,				BenchChunkDecode },
+	{ "chunk_reader_64k",	CHUNK_MAXPAYLOAD,	1460,				BenchChunkReader },
+	{ "chunk_write_64k",	CHUNK_MAXPAYLOAD,	0,					BenchChunkWrite },
+	{ "chunk_seal_gcm_64k",	CHUNK_MAXPAYLOAD,	CRYPT_AESGCM,		BenchChunkSeal },
+	{ "chunk_seal_chacha_64k", CHUNK_MAXPAYLOAD, CRYPT_CHACHA,		BenchChunkSeal },
+	{ "dedup_cut_64k",		CHUNK_MAXPAYLOAD,	0,					BenchDedupCut },
+	{ "trace_event",		0,					0,					BenchTraceEvent },
+	{ "timestamp",			0,					0,					BenchTimestamp },
+	{ "format_log",			0,					0,					BenchFormatLog },
+};
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SetUpFixtures
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SetUpFixtures(LPTransferProps props)
+--						LPTransferProps props:	The settings from the command line, copied for the kernels to use.
+--
+-- RETURNS: FALSE if a buffer or the scratch file couldn't be made; TRUE otherwise.
+--
+-- NOTES:
+-- Builds the data the kernels work on ahead of time, so none of it is timed: a test packet and a stream of them with
+-- a fixed seed, random and text-like file data and a chunk of each, and the sealing kernels' keys. Everything is the
+-- same from run to run.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL SetUpFixtures(LPTransferProps props)
+{
+	static const CHAR	*words[] = { "the ", "packet ", "chunk ", "server ", "client ", "of ", "and ", "transfer ", "to ",
+									 "a ", "file ", "is ", "sent ", "received ", "socket ", "in ", "time ", ".\r\n" };
+	TCHAR				szDir[MAX_PATH], szPath[MAX_PATH];
+	LPChunkHeader		hdr;
+	DWORD				dwPacked, dwLen;
+	DWORD				dwRng	= 1;
+	DWORD				i;
+
+	memcpy(&fix, props, sizeof(TransferProps));
+	fix.szFileName[0]	= 0;
+	fix.nSockType		= SOCK_STREAM;
+	fix.nPacketSize		= 1024;
+	fix.nNumToSend		= 1000;
+	fix.sim.bEnabled	= FALSE;
+	GetSystemTime(&fix.startTime);
+	fix.endTime = stNow = fix.startTime;
+	InitCompressState(&fix.compress, fix.tuning.dwLinkMbps);
+	InitIntegrityState(&fix.integrity);
+
+	sendBuf		= (BYTE *)PoolAlloc(CHUNK_BUFSIZE);
+	packet		= (BYTE *)PoolAlloc(CHUNK_BUFSIZE);
+	stream		= (BYTE *)PoolAlloc(CHUNK_BUFSIZE);
+	randomData	= (BYTE *)PoolAlloc(CHUNK_BUFSIZE);
+	textData	= (BYTE *)PoolAlloc(CHUNK_BUFSIZE);
+	plainChunk	= (BYTE *)PoolAlloc(CHUNK_BUFSIZE);
+	lzChunk		= (BYTE *)PoolAlloc(CHUNK_BUFSIZE);
+	scratch		= (BYTE *)PoolAlloc(CHUNK_BUFSIZE);
+	if (sendBuf == NULL || packet == NULL || stream == NULL || randomData == NULL || textData == NULL ||
+		plainChunk == NULL || lzChunk == NULL || scratch == NULL || !InitChunkReader(&reader))
+		return FALSE;
+
+	// Test packets, with the same seed every run
+	InitPayloadState(&sendPayload);
+	sendPayload.dwSeed		= 0x5EED;
+	sendPayload.bSeedGiven	= TRUE;
+	StartPayload(&sendPayload, 1024);
+	for (i = 0; i < CHUNK_MAXPAYLOAD / 1024; i++)
+	{
+		((DWORD *)(stream + i * 1024))[0] = fix.nNumToSend;
+		((DWORD *)(stream + i * 1024))[1] = 1024;
+		BuildPayload(stream + i * 1024, 1024, i, &sendPayload);
+	}
+	memcpy(packet, stream, 1024);
+	InitPayloadState(&recvPacket);
+	InitPayloadState(&recvStream);
+	StartPayload(&sendPayload, 65536);
+
+	// File data: the random test packets, and text made of words picked at random
+	memcpy(randomData, stream, CHUNK_MAXPAYLOAD);
+	for (i = 0, dwLen = 0; i < CHUNK_MAXPAYLOAD; i += dwLen)
+	{
+		dwRng = dwRng * 1103515245 + 12345;
+		dwLen = min((DWORD)strlen(words[(dwRng >> 16) % BENCH_WORDS]), CHUNK_MAXPAYLOAD - i);
+		memcpy(textData + i, words[(dwRng >> 16) % BENCH_WORDS], dwLen);
+	}
+
+	hdr = (LPChunkHeader)plainChunk;
+	InitChunkHeader(hdr, CHUNK_DATA, 0, 0);
+	hdr->dwLogicalLen	= hdr->dwWireLen = CHUNK_MAXPAYLOAD;
+	hdr->dwCrc			= ChecksumChunk(&fix.integrity, 0, randomData, CHUNK_MAXPAYLOAD);
+	memcpy(hdr + 1, randomData, CHUNK_MAXPAYLOAD);
+
+	hdr = (LPChunkHeader)lzChunk;
+	InitChunkHeader(hdr, CHUNK_DATA, 0, 0);
+	hdr->dwLogicalLen	= CHUNK_MAXPAYLOAD;
+	hdr->dwCrc			= ChecksumChunk(&fix.integrity, 0, textData, CHUNK_MAXPAYLOAD);
+	if ((dwPacked = LZCompress(textData, CHUNK_MAXPAYLOAD, (BYTE *)(hdr + 1), CHUNK_MAXPAYLOAD - 1)) == 0)
+		return FALSE;
+	hdr->wFlags		|= CHUNK_COMPRESSED;
+	hdr->dwWireLen	= dwPacked;
+
+	// The sealing kernels' key is the start of the random data; it's only there to be used
+	InitCryptState(&sealGcm);
+	InitCryptState(&sealChaCha);
+	if (IsCipherAvailable(CRYPT_AESGCM))
+		KeyCrypt(&sealGcm, CRYPT_AESGCM, randomData, randomData + CRYPT_KEY_SIZE);
+	if (IsCipherAvailable(CRYPT_CHACHA))
+		KeyCrypt(&sealChaCha, CRYPT_CHACHA, randomData, randomData + CRYPT_KEY_SIZE);
+
+	// The trace kernel records events as -trace does, only with nowhere to write them
+	StartTracing(NULL);
+
+	// The chunk write kernel's file goes away when it's closed
+	if (GetTempPath(MAX_PATH, szDir) == 0 || GetTempFileName(szDir, TEXT("bch"), 0, szPath) == 0)
+		return FALSE;
+	hFile = CreateFile(szPath, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+	return hFile != INVALID_HANDLE_VALUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TearDownFixtures
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TearDownFixtures()
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID TearDownFixtures()
+{
+	PoolFree(sendBuf);
+	PoolFree(packet);
+	PoolFree(stream);
+	PoolFree(randomData);
+	PoolFree(textData);
+	PoolFree(plainChunk);
+	PoolFree(lzChunk);
+	PoolFree(scratch);
+	FreeChunkReader(&reader);
+	EndCrypt(&sealGcm);
+	EndCrypt(&sealChaCha);
+	if (hFile != INVALID_HANDLE_VALUE)
+		CloseHandle(hFile);
+	hFile = INVALID_HANDLE_VALUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReferenceNs
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReferenceNs()
+--
+-- RETURNS: How long the reference loop took, in nanoseconds.
+--
+-- NOTES:
+-- The loop is a chain of dependent multiplies, so its time depends only on the core's clock.
+---------------------------------------------------------------------------------------------------------------------------*/
+static double ReferenceNs()
+{
+	LARGE_INTEGER	liStart, liEnd;
+	ULONGLONG		x = dwSink;
+	DWORD			i;
+
+	QueryPerformanceCounter(&liStart);
+	for (i = 0; i < BENCH_REF_ITERS; i++)
+		x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+	QueryPerformanceCounter(&liEnd);
+	dwSink += (DWORD)x;
+	return TicksToSeconds(liEnd.QuadPart - liStart.QuadPart) * 1e9;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PinAndSettle
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PinAndSettle(double *pdRefNs)
+--						double *pdRefNs:	Receives the reference loop's settled time.
+--
+-- RETURNS: The processor the thread was pinned to.
+--
+-- NOTES:
+-- Uses the highest-numbered processor the process may run on, since processor 0 takes most of the interrupts. The
+-- reference loop is run for at least BENCH_WARMUP_MS, and until two runs in a row are within BENCH_SETTLE_PCT or
+-- BENCH_SETTLE_MS has gone by.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD PinAndSettle(double *pdRefNs)
+{
+	DWORD_PTR	dwProcessMask, dwSystemMask;
+	DWORD		dwCpu	= 0;
+	DWORD		dwStart	= GetTickCount();
+	double		dLast	= 0;
+	double		dNow;
+
+	if (GetProcessAffinityMask(GetCurrentProcess(), &dwProcessMask, &dwSystemMask) && dwProcessMask != 0)
+	{
+		for (dwCpu = sizeof(DWORD_PTR) * 8 - 1; !(dwProcessMask & ((DWORD_PTR)1 << dwCpu)); dwCpu--)
+			;
+		SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << dwCpu);
+	}
+	SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+	for (;;)
+	{
+		dNow = ReferenceNs();
+		if (GetTickCount() - dwStart >= BENCH_SETTLE_MS || (GetTickCount() - dwStart >= BENCH_WARMUP_MS &&
+			fabs(dNow - dLast) * 100 <= BENCH_SETTLE_PCT * dLast))
+			break;
+		dLast = dNow;
+	}
+	*pdRefNs = dNow;
+	return dwCpu;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CompareDoubles
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CompareDoubles(const void *a, const void *b)
+--
+-- RETURNS: qsort's ordering for doubles.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int CompareDoubles(const void *a, const void *b)
+{
+	double d = *(const double *)a - *(const double *)b;
+	return (d > 0) - (d < 0);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Median
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Median(double *sorted, DWORD dwCount)
+--
+-- RETURNS: The median of the sorted values.
+---------------------------------------------------------------------------------------------------------------------------*/
+static double Median(double *sorted, DWORD dwCount)
+{
+	return dwCount % 2 ? sorted[dwCount / 2] : (sorted[dwCount / 2 - 1] + sorted[dwCount / 2]) / 2;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Measure
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Measure(const BenchKernel *kernel, LPBenchResult result)
+--						const BenchKernel *kernel:	The kernel to time.
+--						LPBenchResult result:		Receives the measurement.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- After one untimed call, the operations per sample are doubled until a sample takes a quarter of BENCH_SAMPLE_US, then
+-- scaled up to it; that also warms the caches and the pool. The median absolute deviation is scaled by 1.4826 so that for normally
+-- distributed samples it estimates the standard deviation; preemptions and interrupts only ever make a sample slower,
+-- so they land far above the median and are cut.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID Measure(const BenchKernel *kernel, LPBenchResult result)
+{
+	double			samples[BENCH_SAMPLES], sorted[BENCH_SAMPLES], dev[BENCH_SAMPLES];
+	double			dMedian, dMad, dSum = 0, dUs;
+	LARGE_INTEGER	liStart, liEnd;
+	DWORD			dwIters = 1;
+	DWORD			i;
+
+	// The first call pays for page faults and slab allocations the rest don't
+	kernel->run(1, kernel->dwArg);
+	for (;;)
+	{
+		QueryPerformanceCounter(&liStart);
+		kernel->run(dwIters, kernel->dwArg);
+		QueryPerformanceCounter(&liEnd);
+		dUs = TicksToSeconds(liEnd.QuadPart - liStart.QuadPart) * 1e6;
+		if (dUs >= BENCH_SAMPLE_US / 4 || dwIters >= 0x40000000)
+			break;
+		dwIters *= 2;
+	}
+	if (dUs > 0 && dUs < BENCH_SAMPLE_US)
+		dwIters = (DWORD)(dwIters * (BENCH_SAMPLE_US / dUs));
+
+	for (i = 0; i < BENCH_SAMPLES; i++)
+	{
+		QueryPerformanceCounter(&liStart);
+		kernel->run(dwIters, kernel->dwArg);
+		QueryPerformanceCounter(&liEnd);
+		samples[i] = sorted[i] = TicksToSeconds(liEnd.QuadPart - liStart.QuadPart) * 1e9 / dwIters;
+	}
+
+	qsort(sorted, BENCH_SAMPLES, sizeof(double), CompareDoubles);
+	dMedian = Median(sorted, BENCH_SAMPLES);
+	for (i = 0; i < BENCH_SAMPLES; i++)
+		dev[i] = fabs(samples[i] - dMedian);
+	qsort(dev, BENCH_SAMPLES, sizeof(double), CompareDoubles);
+	dMad = 1.4826 * Median(dev, BENCH_SAMPLES);
+
+	result->dwKept = 0;
+	for (i = 0; i < BENCH_SAMPLES; i++)
+	{
+		if (fabs(samples[i] - dMedian) <= BENCH_MAD_CUT * dMad)
+		{
+			dSum += samples[i];
+			result->dwKept++;
+		}
+	}
+	result->dNsPerOp	= dSum / result->dwKept;	// The median itself is always kept
+	result->dSpreadPct	= dMedian > 0 ? dMad * 100 / dMedian : 0;
+	result->dwIters		= dwIters;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LoadBaseline
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LoadBaseline(FILE *file, CHAR names[][32], double *ns, DWORD dwMax)
+--						FILE *file:			The baseline file.
+--						CHAR names[][32]:	Receives the kernel names.
+--						double *ns:			Receives their times.
+--						DWORD dwMax:		The space in names and ns.
+--
+-- RETURNS: The number of kernels read.
+--
+-- NOTES:
+-- Each line is "<kernel> <ns/op>"; lines that aren't, including '#' comments, are skipped.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD LoadBaseline(FILE *file, CHAR names[][32], double *ns, DWORD dwMax)
+{
+	CHAR	szLine[128];
+	DWORD	dwCount = 0;
+
+	while (dwCount < dwMax && fgets(szLine, sizeof(szLine), file) != NULL)
+	{
+		if (szLine[0] != '#' && sscanf_s(szLine, "%31s %lf", names[dwCount], 32, &ns[dwCount]) == 2 &&
+			ns[dwCount] > 0)
+			dwCount++;
+	}
+	return dwCount;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RunBenchmarks
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RunBenchmarks(LPTransferProps props)
+--						LPTransferProps props:	The command line settings; props->bench names the baseline and tolerance.
+--
+-- RETURNS: The process exit code: BENCH_OK, BENCH_REGRESSED if a kernel is slower than its baseline by more than the
+--			tolerance, BENCH_UNRELIABLE if the clock changed during the run, or BENCH_ERROR if the run couldn't be set up.
+--
+-- NOTES:
+-- Runs headless, so it can be scripted; the results file has a row per kernel and a closing comment with the
+-- processor used and the reference loop times.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT RunBenchmarks(LPTransferProps props)
+{
+	static CHAR		names[BENCH_MAX_KERNELS][32];
+	double			baseNs[BENCH_MAX_KERNELS];
+	DWORD			dwBase		= 0;
+	BOOL			bHaveBase	= FALSE;
+	BenchResult		results[sizeof(kernels) / sizeof(kernels[0])];
+	CHAR			szResults[FILENAME_SIZE + 8];
+	const CHAR		*szStatus;
+	FILE			*file;
+	double			dRefBefore, dRefAfter, dDrift, dBase, dChange;
+	DWORD			dwCpu, i, j;
+	INT				nResult	= BENCH_OK;
+
+	if (fopen_s(&file, props->bench.szBaseline, "r") == 0 && file != NULL)
+	{
+		dwBase = LoadBaseline(file, names, baseNs, BENCH_MAX_KERNELS);
+		bHaveBase = TRUE;
+		fclose(file);
+	}
+
+	if (!SetUpFixtures(props))
+	{
+		TearDownFixtures();
+		MessageBox(NULL, TEXT("Couldn't set up the benchmarks (out of memory, or no temporary file)."),
+			TEXT("Benchmark Failed"), MB_ICONERROR);
+		return BENCH_ERROR;
+	}
+
+	dwCpu = PinAndSettle(&dRefBefore);
+	for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+		Measure(&kernels[i], &results[i]);
+	dRefAfter = ReferenceNs();
+	dDrift = fabs(dRefAfter - dRefBefore) * 100 / dRefBefore;
+	TearDownFixtures();
+
+	sprintf_s(szResults, sizeof(szResults), "%s.csv", props->bench.szBaseline);
+	if (fopen_s(&file, szResults, "w") != 0 || file == NULL)
+	{
+		MessageBoxA(NULL, szResults, "Couldn't Create Results File", MB_ICONERROR);
+		return BENCH_ERROR;
+	}
+
+	fprintf(file, "kernel,ns_per_op,mb_per_s,spread_pct,samples_kept,ops_per_sample,baseline_ns,change_pct,status\n");
+	for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+	{
+		dBase = 0;
+		for (j = 0; j < dwBase; j++)
+		{
+			if (strcmp(names[j], kernels[i].szName) == 0)
+				dBase = baseNs[j];
+		}
+
+		dChange = dBase > 0 ? (results[i].dNsPerOp - dBase) * 100 / dBase : 0;
+		if (dBase == 0)
+			szStatus = "new";
+		else if (dDrift > BENCH_DRIFT_PCT)
+			szStatus = "unreliable";
+		else if (dChange > props->bench.dwTolerance)
+		{
+			szStatus = "REGRESSED";
+			nResult = BENCH_REGRESSED;
+		}
+		else
+			szStatus = "ok";
+
+		fprintf(file, "%s,%.1f,%.1f,%.2f,%lu,%lu,%.1f,%+.1f,%s\n", kernels[i].szName, results[i].dNsPerOp,
+			kernels[i].dwBytes != 0 ? kernels[i].dwBytes * 1e3 / results[i].dNsPerOp : 0.0, results[i].dSpreadPct,
+			results[i].dwKept, results[i].dwIters, dBase, dChange, szStatus);
+	}
+	fprintf(file, "# processor %lu, reference loop %.0f ns before and %.0f ns after (%.1f%% drift), tolerance %lu%%%s\n",
+		dwCpu, dRefBefore, dRefAfter, dDrift, props->bench.dwTolerance,
+		dDrift > BENCH_DRIFT_PCT ? "; the clock changed, so nothing was compared" : "");
+	fclose(file);
+
+	if (dDrift > BENCH_DRIFT_PCT && bHaveBase)
+		return BENCH_UNRELIABLE;
+
+	// The first run becomes the baseline
+	if (!bHaveBase)
+	{
+		if (fopen_s(&file, props->bench.szBaseline, "w") != 0 || file == NULL)
+		{
+			MessageBoxA(NULL, props->bench.szBaseline, "Couldn't Create Baseline", MB_ICONERROR);
+			return BENCH_ERROR;
+		}
+		fprintf(file, "# kernel ns/op; delete this file to take a new baseline\n");
+		for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+			fprintf(file, "%s %.1f\n", kernels[i].szName, results[i].dNsPerOp);
+		fclose(file);
+	}
+	return nResult;
+}
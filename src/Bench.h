@@ -0,0 +1,60 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Pool.h"
+#include "Payload.h"
+#include "Checksum.h"
+#include "Compress.h"
+#include "Chunk.h"
+#include "ClientTransfer.h"
+#include "Crypt.h"
+#include "Dedup.h"
+#include "Trace.h"
+
+#define BENCH_SAMPLES		31				// Timed samples per kernel
+#define BENCH_SAMPLE_US		2000			// Each sample runs the kernel for about this long
+#define BENCH_WARMUP_MS		250				// Least time spent bringing the core up to speed before measuring
+#define BENCH_SETTLE_MS		2000			// Most time spent waiting for the clock to settle
+#define BENCH_SETTLE_PCT	1.0				// Two reference runs this close together mean the clock has settled
+#define BENCH_DRIFT_PCT		3.0				// Reference runs further apart than this before and after mean it changed
+#define BENCH_REF_ITERS		1000000			// Steps in the reference loop
+#define BENCH_MAD_CUT		3.0				// Samples more than this many deviations from the median are outliers
+#define BENCH_DEF_TOL		10				// Percent slower than its baseline a kernel may get
+#define BENCH_FILESPAN		(16 << 20)		// The chunk write kernel cycles through this much of its file
+#define BENCH_MAX_KERNELS	32
+#define BENCH_WORDS			18				// Words the text-like file data is made of
+
+#define BENCH_OK			0				// Exit codes
+#define BENCH_ERROR			1
+#define BENCH_REGRESSED		2
+#define BENCH_UNRELIABLE	3				// The clock changed during the run, so nothing was compared
+
+/* A hot path timed on its own. The kernel runs its operation dwIters times. */
+typedef struct _BenchKernel
+{
+	const CHAR	*szName;
+	DWORD		dwBytes;		// Bytes each operation handles, for the throughput column (0 for none)
+	DWORD		dwArg;			// Passed to the kernel (a size, or a flag)
+	VOID		(*run)(DWORD dwIters, DWORD dwArg);
+} BenchKernel, *LPBenchKernel;
+
+/* One kernel's measurement. */
+typedef struct _BenchResult
+{
+	double		dNsPerOp;		// Mean of the samples left after outliers are dropped
+	double		dSpreadPct;		// Their scaled median absolute deviation, as a percentage of the median
+	DWORD		dwKept;
+	DWORD		dwIters;		// Operations per sample
+} BenchResult, *LPBenchResult;
+
+INT RunBenchmarks(LPTransferProps props);
+
+#endif
@@ -0,0 +1,477 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: BusyPoll.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitPollState(LPPollState p);
+-- BOOL ParsePollCpu(const CHAR *szValue, LPPollState p);
+-- VOID BeginPolling(LPTransferProps props);
+-- VOID ResetPollStats(LPPollState p);
+-- LPWSAOVERLAPPED_COMPLETION_ROUTINE PollPost(LPTransferProps props, LPWSAOVERLAPPED_COMPLETION_ROUTINE routine);
+-- VOID NoteCompletion(LPPollState p);
+-- DWORD WaitForTransfer(LPTransferProps props, DWORD dwMs);
+-- VOID StopPollStats(LPPollState p);
+-- VOID EndPolling(LPTransferProps props);
+-- INT FormatPollReport(CHAR *buf, size_t size, LPPollState p);
+-- static VOID ThreadCpu(PULONGLONG pqwUser, PULONGLONG pqwKernel);
+-- static int CompareDwords(const void *a, const void *b);
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file is the busy-poll mode for latency runs (-busypoll). Normally a transfer's thread sleeps in an
+--			alertable wait and Windows wakes it to run a completion routine as an APC when each send or receive
+--			finishes, so every packet pays for the thread being scheduled again. In busy-poll mode the transfer's
+--			sends and receives are posted without a completion routine, and the thread spins on the status word of
+--			the transfer's OVERLAPPED until the kernel marks the I/O done, then calls the same completion routine
+--			itself. The thread never sleeps while the transfer runs, and it's pinned to one processor (the
+--			highest-numbered one the process may use, since processor 0 takes most of the interrupts, or the one
+--			given) at raised priority, so the spinning doesn't migrate or get preempted. Spinning on the OVERLAPPED is
+--			Windows' nearest thing to spinning on a non-blocking socket, without a failed receive call for every
+--			empty poll. Every POLL_APC_SPINS polls the thread also runs any other APCs (the duplex direction, the
+--			scheduler's timer and Stop Transfer still complete that way) and checks the time.
+--
+--			Both modes record, for every completion after the first, the time from the I/O being posted to its
+--			routine running, and the CPU the transfer's thread used from the first completion to the end of the
+--			transfer (thread times are counted in clock ticks, so a short transfer's CPU is only roughly measured).
+--			The report gives the percentiles beside the CPU cost, so a busy-poll run can be compared with a normal
+--			one. On the server the turnaround of a receive includes waiting for the datagram to be sent; the
+--			client's sends, and the duplex RTT, show the difference more directly.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "BusyPoll.h"
+
+static DWORD	samples[POLL_SAMPLES];	// Turnarounds in performance counter ticks, thinned out as in Duplex.cpp
+static DWORD	sorted[POLL_SAMPLES];
+static DWORD	dwOffered	= 0;
+static DWORD	dwMaxTicks	= 0;
+static DWORD	dwRng		= 1;
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitPollState
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitPollState(LPPollState p)
+--							LPPollState p:	The busy-poll state to initialise.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitPollState(LPPollState p)
+{
+	memset(p, 0, sizeof(PollState));
+	p->nCpu = -1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ParsePollCpu
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ParsePollCpu(const CHAR *szValue, LPPollState p)
+--							const CHAR *szValue:	The value given to -busypoll: a processor number or "auto".
+--							LPPollState p:			Receives it, and busy-poll mode is turned on.
+--
+-- RETURNS: FALSE if the value isn't a processor number; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ParsePollCpu(const CHAR *szValue, LPPollState p)
+{
+	CHAR			*szEnd;
+	unsigned long	ulCpu;
+
+	if (_stricmp(szValue, "auto") == 0)
+		p->nCpu = -1;
+	else
+	{
+		ulCpu = strtoul(szValue, &szEnd, 10);
+		if (*szValue == 0 || *szEnd != 0 || ulCpu >= sizeof(DWORD_PTR) * 8)
+			return FALSE;
+		p->nCpu = (INT)ulCpu;
+	}
+	p->bEnabled = TRUE;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ThreadCpu
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ThreadCpu(PULONGLONG pqwUser, PULONGLONG pqwKernel)
+--							PULONGLONG pqwUser:		Receives the user time the calling thread has used (100ns units).
+--							PULONGLONG pqwKernel:	Receives its kernel time.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID ThreadCpu(PULONGLONG pqwUser, PULONGLONG pqwKernel)
+{
+	FILETIME ftCreate, ftExit, ftKernel, ftUser;
+
+	if (!GetThreadTimes(GetCurrentThread(), &ftCreate, &ftExit, &ftKernel, &ftUser))
+	{
+		*pqwUser = *pqwKernel = 0;
+		return;
+	}
+	*pqwUser	= ((ULONGLONG)ftUser.dwHighDateTime << 32) | ftUser.dwLowDateTime;
+	*pqwKernel	= ((ULONGLONG)ftKernel.dwHighDateTime << 32) | ftKernel.dwLowDateTime;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ResetPollStats
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ResetPollStats(LPPollState p)
+--							LPPollState p:	The busy-poll state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called before each transfer, including each transfer of a session.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID ResetPollStats(LPPollState p)
+{
+	p->pending			= NULL;
+	p->dwCompletions	= 0;
+	p->qwEmptyPolls		= 0;
+	p->qwCpuUser		= 0;
+	p->qwCpuKernel		= 0;
+	p->dWallUs			= 0;
+	dwOffered			= 0;
+	dwMaxTicks			= 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BeginPolling
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BeginPolling(LPTransferProps props)
+--							LPTransferProps props:	The transfer about to start, on its own thread.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Clears the last transfer's figures and, in busy-poll mode, pins the worker to its processor until EndPolling.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID BeginPolling(LPTransferProps props)
+{
+	LPPollState	p = &props->poll;
+	DWORD_PTR	dwProcessMask, dwSystemMask, dwOldMask;
+	DWORD		dwCpu;
+
+	ResetPollStats(p);
+	if (!p->bEnabled || p->bPinned)
+		return;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &dwProcessMask, &dwSystemMask) || dwProcessMask == 0)
+		return;
+
+	if (p->nCpu >= 0)
+		dwCpu = (DWORD)p->nCpu;
+	else
+		for (dwCpu = sizeof(DWORD_PTR) * 8 - 1; !(dwProcessMask & ((DWORD_PTR)1 << dwCpu)); dwCpu--)
+			;
+	if (!(dwProcessMask & ((DWORD_PTR)1 << dwCpu)) ||
+		(dwOldMask = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << dwCpu)) == 0)
+		return;
+
+	p->dwOldMask	= dwOldMask;
+	p->nOldPriority	= GetThreadPriority(GetCurrentThread());
+	p->dwPinnedCpu	= dwCpu;
+	p->bPinned		= TRUE;
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PollPost
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PollPost(LPTransferProps props, LPWSAOVERLAPPED_COMPLETION_ROUTINE routine)
+--							LPTransferProps props:		The transfer, whose OVERLAPPED the I/O is about to be posted with.
+--							LPWSAOVERLAPPED_COMPLETION_ROUTINE routine:	The routine to run when it completes.
+--
+-- RETURNS: The completion routine to post the I/O with: routine, or NULL in busy-poll mode, where WaitForTransfer
+--			runs it instead.
+--
+-- NOTES:
+-- Passed as the last argument of each WSASend/WSARecv on the transfer's OVERLAPPED, so it runs just before the I/O is
+-- posted. The OVERLAPPED is marked pending here rather than by the kernel, so that a post which fails at once isn't
+-- taken for a completion of the one before it.
+---------------------------------------------------------------------------------------------------------------------------*/
+LPWSAOVERLAPPED_COMPLETION_ROUTINE PollPost(LPTransferProps props, LPWSAOVERLAPPED_COMPLETION_ROUTINE routine)
+{
+	QueryPerformanceCounter(&props->poll.liPosted);
+	TraceEvent(TRACE_POST, 0, NULL);
+	if (!props->poll.bEnabled)
+		return routine;
+
+	props->wsaOverlapped.Internal = STATUS_PENDING;
+	props->poll.pending = routine;
+	return NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NoteCompletion
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NoteCompletion(LPPollState p)
+--							LPPollState p:	The busy-poll state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called at the top of the transfer's completion routines. The first completion only starts the clock, since its
+-- I/O was posted before the other end had started; every later one is a turnaround sample, kept or not as
+-- AddSample in Duplex.cpp does.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID NoteCompletion(LPPollState p)
+{
+	LARGE_INTEGER	liNow;
+	DWORD			dwTicks, dwSlot;
+
+	QueryPerformanceCounter(&liNow);
+	if (p->dwCompletions++ == 0)
+	{
+		p->liFirst = liNow;
+		ThreadCpu(&p->qwUserFirst, &p->qwKernelFirst);
+		return;
+	}
+
+	dwTicks = (DWORD)min(liNow.QuadPart - p->liPosted.QuadPart, (LONGLONG)0xFFFFFFFF);
+	dwMaxTicks = max(dwMaxTicks, dwTicks);
+	if (dwOffered < POLL_SAMPLES)
+		samples[dwOffered] = dwTicks;
+	else
+	{
+		dwRng = dwRng * 1664525 + 1013904223;
+		if ((dwSlot = dwRng % (dwOffered + 1)) < POLL_SAMPLES)
+			samples[dwSlot] = dwTicks;
+	}
+	dwOffered++;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: WaitForTransfer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: WaitForTransfer(LPTransferProps props, DWORD dwMs)
+--							LPTransferProps props:	The transfer.
+--							DWORD dwMs:				How long to wait for a completion (or INFINITE).
+--
+-- RETURNS: WAIT_IO_COMPLETION if a completion routine ran; 0 if none did in dwMs, as SleepEx returns.
+--
+-- NOTES:
+-- The transfer threads' wait for their completion routines. Outside busy-poll mode it's the alertable SleepEx they
+-- always used. With -trace the wait is recorded; in busy-poll mode it ends before the routine is called, where
+-- SleepEx runs the routine inside it.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD WaitForTransfer(LPTransferProps props, DWORD dwMs)
+{
+	LPPollState							p		= &props->poll;
+	DWORD								dwStart	= GetTickCount();
+	LPWSAOVERLAPPED_COMPLETION_ROUTINE	routine;
+	DWORD								dwSpins, dwBytes, dwFlags, dwRet;
+
+	TraceEvent(TRACE_WAIT_BEGIN, 0, NULL);
+	if (!p->bEnabled)
+	{
+		dwRet = SleepEx(dwMs, TRUE);
+		TraceEvent(TRACE_WAIT_END, 0, NULL);
+		return dwRet;
+	}
+
+	for (dwSpins = 1;; dwSpins++)
+	{
+		if (p->pending != NULL && HasOverlappedIoCompleted(&props->wsaOverlapped))
+		{
+			TraceEvent(TRACE_WAIT_END, 0, NULL);
+			routine		= p->pending;
+			p->pending	= NULL;
+			dwBytes		= 0;
+			dwFlags		= 0;
+			if (WSAGetOverlappedResult(props->socket, &props->wsaOverlapped, &dwBytes, FALSE, &dwFlags))
+				routine(0, dwBytes, &props->wsaOverlapped, dwFlags);
+			else
+				routine(WSAGetLastError(), dwBytes, &props->wsaOverlapped, dwFlags);
+			return WAIT_IO_COMPLETION;
+		}
+		p->qwEmptyPolls++;
+
+		if (dwSpins % POLL_APC_SPINS == 0)
+		{
+			if ((dwRet = SleepEx(0, TRUE)) == WAIT_IO_COMPLETION || (dwMs != INFINITE && GetTickCount() - dwStart >= dwMs))
+			{
+				TraceEvent(TRACE_WAIT_END, 0, NULL);
+				return dwRet;
+			}
+		}
+		YieldProcessor();
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StopPollStats
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StopPollStats(LPPollState p)
+--							LPPollState p:	The busy-poll state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called on the transfer's thread once the transfer is over, before its report.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID StopPollStats(LPPollState p)
+{
+	LARGE_INTEGER	liNow;
+	ULONGLONG		qwUser, qwKernel;
+
+	if (p->dwCompletions == 0)
+		return;
+	QueryPerformanceCounter(&liNow);
+	ThreadCpu(&qwUser, &qwKernel);
+	p->qwCpuUser	= qwUser - p->qwUserFirst;
+	p->qwCpuKernel	= qwKernel - p->qwKernelFirst;
+	p->dWallUs		= TicksToSeconds(liNow.QuadPart - p->liFirst.QuadPart) * 1e6;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: EndPolling
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: EndPolling(LPTransferProps props)
+--							LPTransferProps props:	The transfer that has finished.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Gives the worker back its affinity and priority for the transfers that follow.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID EndPolling(LPTransferProps props)
+{
+	LPPollState p = &props->poll;
+
+	p->pending = NULL;
+	if (!p->bPinned)
+		return;
+	SetThreadAffinityMask(GetCurrentThread(), p->dwOldMask);
+	SetThreadPriority(GetCurrentThread(), p->nOldPriority);
+	p->bPinned = FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CompareDwords
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CompareDwords(const void *a, const void *b)
+--
+-- RETURNS: qsort's ordering for DWORDs.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int CompareDwords(const void *a, const void *b)
+{
+	DWORD x = *(const DWORD *)a, y = *(const DWORD *)b;
+	return (x > y) - (x < y);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatPollReport
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatPollReport(CHAR *buf, size_t size, LPPollState p)
+--							CHAR *buf:			The buffer to write the report section into.
+--							size_t size:		The space left in buf.
+--							LPPollState p:		How the transfer's completions were waited for.
+--
+-- RETURNS: The number of characters written.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatPollReport(CHAR *buf, size_t size, LPPollState p)
+{
+	INT		written = 0;
+	DWORD	dwCount = min(dwOffered, (DWORD)POLL_SAMPLES);
+	double	dCpuMs	= (p->qwCpuUser + p->qwCpuKernel) / 1e4;
+
+	if (dwCount == 0)
+		return 0;
+
+	if (!p->bEnabled)
+		written += sprintf_s(buf, size, "Completions: %lu, run as APCs from alertable waits\r\n", p->dwCompletions);
+	else if (p->bPinned)
+		written += sprintf_s(buf, size, "Completions: %lu, busy-polled on processor %lu; %.1f empty polls each\r\n",
+			p->dwCompletions, p->dwPinnedCpu, (double)p->qwEmptyPolls / p->dwCompletions);
+	else
+		written += sprintf_s(buf, size, "Completions: %lu, busy-polled (not pinned); %.1f empty polls each\r\n",
+			p->dwCompletions, (double)p->qwEmptyPolls / p->dwCompletions);
+
+	memcpy(sorted, samples, dwCount * sizeof(DWORD));
+	qsort(sorted, dwCount, sizeof(DWORD), CompareDwords);
+	written += sprintf_s(buf + written, size - written,
+		"Completion turnaround: median %.1fus, p99 %.1fus, p99.9 %.1fus, max %.1fus (%lu samples)\r\n",
+		TicksToSeconds(sorted[dwCount / 2]) * 1e6, TicksToSeconds(sorted[(DWORD)(dwCount * 0.99)]) * 1e6,
+		TicksToSeconds(sorted[(DWORD)(dwCount * 0.999)]) * 1e6, TicksToSeconds(dwMaxTicks) * 1e6, dwOffered);
+
+	if (p->dWallUs > 0)
+		written += sprintf_s(buf + written, size - written,
+			"Transfer thread CPU: %.1fms user + %.1fms kernel in %.1fms (%.0f%% of a processor), %.2fus per completion\r\n",
+			p->qwCpuUser / 1e4, p->qwCpuKernel / 1e4, p->dWallUs / 1e3, dCpuMs * 1e5 / p->dWallUs,
+			dCpuMs * 1e3 / p->dwCompletions);
+	return written;
+}
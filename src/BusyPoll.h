@@ -0,0 +1,28 @@
+#ifndef BUSY_POLL_H
+#define BUSY_POLL_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Connect.h"
+#include "Trace.h"
+
+#define POLL_SAMPLES		16384		// Turnaround samples kept for the percentiles
+#define POLL_APC_SPINS		256			// Polls between runs of the other completion routines and checks of the time
+
+VOID InitPollState(LPPollState p);
+BOOL ParsePollCpu(const CHAR *szValue, LPPollState p);
+VOID BeginPolling(LPTransferProps props);
+VOID ResetPollStats(LPPollState p);
+LPWSAOVERLAPPED_COMPLETION_ROUTINE PollPost(LPTransferProps props, LPWSAOVERLAPPED_COMPLETION_ROUTINE routine);
+VOID NoteCompletion(LPPollState p);
+DWORD WaitForTransfer(LPTransferProps props, DWORD dwMs);
+VOID StopPollStats(LPPollState p);
+VOID EndPolling(LPTransferProps props);
+INT FormatPollReport(CHAR *buf, size_t size, LPPollState p);
+
+#endif
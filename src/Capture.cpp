@@ -0,0 +1,728 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Capture.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitCaptureState(LPCaptureState c);
+-- VOID StartCapture(LPCaptureState c, DWORD nSockType);
+-- VOID CaptureArrival(LPCaptureState c, DWORD dwBytes);
+-- VOID EndCapture(LPCaptureState c);
+-- INT FormatCaptureReport(CHAR *buf, size_t size, LPCaptureState c);
+-- VOID InitReplayState(LPReplayState r);
+-- BOOL LoadCapture(LPReplayState r, const CHAR *szFile);
+-- VOID StartReplay(LPReplayState r, SchedResume resume, VOID *ctx);
+-- DWORD NextReplaySize(LPReplayState r);
+-- BOOL ReplayPace(LPReplayState r);
+-- VOID EndReplay(LPReplayState r);
+-- INT FormatReplayReport(CHAR *buf, size_t size, LPReplayState r);
+-- static BYTE *PutVarint(BYTE *p, DWORD dwValue);
+-- static const BYTE *GetVarint(const BYTE *p, const BYTE *end, LPDWORD pdwValue);
+-- static VOID FlushCapture(LPCaptureState c);
+-- static ULONGLONG ReplayClock(LPReplayState r);
+-- static VOID CALLBACK ReplayTimer(LPVOID lpArg, DWORD dwTimerLow, DWORD dwTimerHigh);
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file records the shape of the traffic a server receives and plays it back from a client, so that a
+--			throughput or loss problem seen with real traffic can be reproduced on demand instead of with the
+--			uniform stream of test packets the client otherwise sends.
+--
+--			With -capture the server records each data datagram (UDP) or each receive completion (TCP) as it
+--			arrives: its size and the time since the one before it, each as a varint after a CaptureHeader, so a
+--			typical record takes three or four bytes. Records are gathered in a CAPTURE_BUFSIZE buffer and written
+--			when it fills, and the header's totals are filled in once the transfer ends. Every transfer rewrites
+--			the file. A TCP capture is of how the stream arrived, which depends on the receiver as much as on the
+--			sender, but it keeps the bursts and pauses that matter for load.
+--
+--			With -replay the client loads a capture and, for test-packet transfers, sends a test packet of each
+--			recorded size in turn over UDP, or over TCP cuts the usual stream of packets into sends of the
+--			recorded sizes (the last is padded out to a whole packet, so the server checks the stream as always).
+--			Each send is due at the recorded time from the first, divided by -replayspeed; with -replayspeed max
+--			nothing is held back. A send due more than REPLAY_SPIN_US away is held on a waitable timer, whose APC
+--			runs on the transfer's thread and wakes a little early, and the rest of the wait is spun out. A
+--			high-resolution timer is used where Windows has one; otherwise a tick's worth of lateness shows up in
+--			the report, which says how many sends were more than REPLAY_LATE_US late and by how much.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Capture.h"
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitCaptureState
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitCaptureState(LPCaptureState c)
+--							LPCaptureState c:	The state to initialise.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitCaptureState(LPCaptureState c)
+{
+	memset(c, 0, sizeof(CaptureState));
+	c->hFile = INVALID_HANDLE_VALUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PutVarint
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PutVarint(BYTE *p, DWORD dwValue)
+--							BYTE *p:		Where to write it; there must be room for 5 bytes.
+--							DWORD dwValue:	The value.
+--
+-- RETURNS: The byte after the varint.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BYTE *PutVarint(BYTE *p, DWORD dwValue)
+{
+	while (dwValue >= 0x80)
+	{
+		*p++ = (BYTE)(dwValue | 0x80);
+		dwValue >>= 7;
+	}
+	*p++ = (BYTE)dwValue;
+	return p;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GetVarint
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GetVarint(const BYTE *p, const BYTE *end, LPDWORD pdwValue)
+--							BYTE *p:			The varint.
+--							BYTE *end:			The end of the data it's in.
+--							LPDWORD pdwValue:	Set to its value.
+--
+-- RETURNS: The byte after the varint, or NULL if it runs past end or is longer than a DWORD's.
+---------------------------------------------------------------------------------------------------------------------------*/
+static const BYTE *GetVarint(const BYTE *p, const BYTE *end, LPDWORD pdwValue)
+{
+	DWORD dwValue = 0, dwShift = 0;
+
+	while (p < end && dwShift < 35)
+	{
+		dwValue |= (DWORD)(*p & 0x7F) << dwShift;
+		if ((*p++ & 0x80) == 0)
+		{
+			*pdwValue = dwValue;
+			return p;
+		}
+		dwShift += 7;
+	}
+	return NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FlushCapture
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FlushCapture(LPCaptureState c)
+--							LPCaptureState c:	The server's capture state, with its file open.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Writes the gathered records. If they can't be written the capture is abandoned: the file is closed and deleted, so
+-- there's no partial recording for -replay to mistake for the whole transfer.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID FlushCapture(LPCaptureState c)
+{
+	DWORD dwWritten;
+
+	if (c->dwUsed != 0 && (!WriteFile(c->hFile, c->buf, c->dwUsed, &dwWritten, NULL) || dwWritten != c->dwUsed))
+	{
+		CloseHandle(c->hFile);
+		c->hFile = INVALID_HANDLE_VALUE;
+		DeleteFileA(c->szFile);
+		c->bFailed = TRUE;
+	}
+	c->qwFileBytes += c->dwUsed;
+	c->dwUsed = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StartCapture
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StartCapture(LPCaptureState c, DWORD nSockType)
+--							LPCaptureState c:	The server's capture state.
+--							DWORD nSockType:	SOCK_STREAM or SOCK_DGRAM.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called by the server before each transfer; does nothing without -capture. The file is created (or emptied) now so
+-- that nothing slow happens once the data starts arriving. If it can't be, the transfer goes ahead unrecorded and the
+-- report says so.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID StartCapture(LPCaptureState c, DWORD nSockType)
+{
+	CaptureHeader	hdr;
+	DWORD			dwWritten;
+
+	if (c->szFile[0] == 0)
+		return;
+
+	EndCapture(c);
+	c->nSockType	= nSockType;
+	c->dwUsed		= 0;
+	c->dwRecords	= 0;
+	c->qwBytes		= 0;
+	c->qwLastUs		= 0;
+	c->qwFileBytes	= 0;
+	c->bFull		= FALSE;
+	c->bFailed		= FALSE;
+	c->bRecorded	= TRUE;
+
+	if (c->buf == NULL && (c->buf = (BYTE *)malloc(CAPTURE_BUFSIZE)) == NULL)
+	{
+		c->bFailed = TRUE;
+		return;
+	}
+
+	// The header is written again with the totals at the end
+	memset(&hdr, 0, sizeof(hdr));
+	c->hFile = CreateFileA(c->szFile, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN,
+		NULL);
+	if (c->hFile == INVALID_HANDLE_VALUE)
+		c->bFailed = TRUE;
+	else if (!WriteFile(c->hFile, &hdr, sizeof(hdr), &dwWritten, NULL) || dwWritten != sizeof(hdr))
+	{
+		CloseHandle(c->hFile);
+		c->hFile = INVALID_HANDLE_VALUE;
+		c->bFailed = TRUE;
+	}
+	else
+		c->qwFileBytes = sizeof(hdr);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CaptureArrival
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CaptureArrival(LPCaptureState c, DWORD dwBytes)
+--							LPCaptureState c:	The server's capture state.
+--							DWORD dwBytes:		The size of the datagram or receive that just completed.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called from the server's completion routines. The gaps are taken from the time since the first arrival, so their
+-- rounding doesn't add up over a long recording.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID CaptureArrival(LPCaptureState c, DWORD dwBytes)
+{
+	LARGE_INTEGER	liNow;
+	ULONGLONG		qwNowUs;
+	BYTE			*p;
+
+	if (c->hFile == INVALID_HANDLE_VALUE || dwBytes == 0)
+		return;
+	if (c->dwRecords == CAPTURE_MAXRECORDS)
+	{
+		c->bFull = TRUE;
+		return;
+	}
+
+	QueryPerformanceCounter(&liNow);
+	if (c->dwRecords == 0)
+		c->liFirst = liNow;
+	qwNowUs = (ULONGLONG)(TicksToSeconds(liNow.QuadPart - c->liFirst.QuadPart) * 1e6);
+
+	if (c->dwUsed > CAPTURE_BUFSIZE - CAPTURE_MAXRECORD)
+	{
+		FlushCapture(c);
+		if (c->bFailed)
+			return;
+	}
+	p = PutVarint(c->buf + c->dwUsed, dwBytes);
+	p = PutVarint(p, (DWORD)min(qwNowUs - c->qwLastUs, (ULONGLONG)MAXDWORD));
+	c->dwUsed = (DWORD)(p - c->buf);
+	c->qwLastUs = qwNowUs;
+	c->dwRecords++;
+	c->qwBytes += dwBytes;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: EndCapture
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: EndCapture(LPCaptureState c)
+--							LPCaptureState c:	The server's capture state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called by the server once a transfer is over, before it's reported. Writes the last of the records and the
+-- header's totals, and closes the file.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID EndCapture(LPCaptureState c)
+{
+	CaptureHeader	hdr;
+	DWORD			dwWritten;
+
+	if (c->hFile == INVALID_HANDLE_VALUE)
+		return;
+	FlushCapture(c);
+	if (c->bFailed)
+		return;
+
+	hdr.dwMagic			= CAPTURE_MAGIC;
+	hdr.wVersion		= CAPTURE_VERSION;
+	hdr.wSockType		= (WORD)c->nSockType;
+	hdr.dwRecords		= c->dwRecords;
+	hdr.qwBytes			= c->qwBytes;
+	hdr.qwDurationUs	= c->qwLastUs;
+	if (SetFilePointer(c->hFile, 0, NULL, FILE_BEGIN) == INVALID_SET_FILE_POINTER ||
+		!WriteFile(c->hFile, &hdr, sizeof(hdr), &dwWritten, NULL) || dwWritten != sizeof(hdr))
+		c->bFailed = TRUE;
+	CloseHandle(c->hFile);
+	c->hFile = INVALID_HANDLE_VALUE;
+	if (c->bFailed)
+		DeleteFileA(c->szFile);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatCaptureReport
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatCaptureReport(CHAR *buf, size_t size, LPCaptureState c)
+--							CHAR *buf:			Where to write the report.
+--							size_t size:		The space left in buf.
+--							LPCaptureState c:	The server's capture state.
+--
+-- RETURNS: The number of characters written; 0 if the transfer wasn't recorded.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatCaptureReport(CHAR *buf, size_t size, LPCaptureState c)
+{
+	INT written;
+
+	if (!c->bRecorded)
+		return 0;
+	if (c->bFailed)
+		return sprintf_s(buf, size, "Capture: couldn't write %s; the transfer wasn't recorded\r\n", c->szFile);
+
+	written = sprintf_s(buf, size, "Capture: %lu %s (%llu bytes over %.3fs) written to %s in %llu bytes\r\n",
+		c->dwRecords, c->nSockType == SOCK_DGRAM ? "datagrams" : "receives", c->qwBytes, c->qwLastUs / 1e6, c->szFile,
+		c->qwFileBytes);
+	if (c->bFull)
+		written += sprintf_s(buf + written, size - written, "Capture: stopped recording after %lu arrivals\r\n",
+			(DWORD)CAPTURE_MAXRECORDS);
+	return written;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitReplayState
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitReplayState(LPReplayState r)
+--							LPReplayState r:	The state to initialise.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitReplayState(LPReplayState r)
+{
+	memset(r, 0, sizeof(ReplayState));
+	r->dSpeed = 1.0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LoadCapture
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LoadCapture(LPReplayState r, const CHAR *szFile)
+--							LPReplayState r:	The client's replay state.
+--							CHAR *szFile:		The capture file (-replay).
+--
+-- RETURNS: FALSE if the file couldn't be read, isn't a capture, or is damaged; TRUE otherwise.
+--
+-- NOTES:
+-- The whole recording is decoded into r->sizes and r->gaps, so nothing is read or decoded while it's replayed. A
+-- capture that doesn't add up to its header's totals is refused rather than replayed in part.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL LoadCapture(LPReplayState r, const CHAR *szFile)
+{
+	HANDLE			hFile;
+	CaptureHeader	hdr;
+	LARGE_INTEGER	liSize;
+	BYTE			*data	= NULL;
+	DWORD			*sizes	= NULL;
+	DWORD			*gaps	= NULL;
+	const BYTE		*p, *end;
+	DWORD			dwLen, dwRead, dwMaxSize = 0, i;
+	ULONGLONG		qwBytes = 0, qwUs = 0;
+	BOOL			bOk = FALSE;
+
+	hFile = CreateFileA(szFile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return FALSE;
+
+	if (!GetFileSizeEx(hFile, &liSize) || !ReadFile(hFile, &hdr, sizeof(hdr), &dwRead, NULL) || dwRead != sizeof(hdr) ||
+		hdr.dwMagic != CAPTURE_MAGIC || hdr.wVersion != CAPTURE_VERSION || hdr.dwRecords == 0 ||
+		hdr.dwRecords > CAPTURE_MAXRECORDS || (hdr.wSockType != SOCK_STREAM && hdr.wSockType != SOCK_DGRAM) ||
+		(ULONGLONG)liSize.QuadPart - sizeof(hdr) > (ULONGLONG)hdr.dwRecords * CAPTURE_MAXRECORD)
+	{
+		CloseHandle(hFile);
+		return FALSE;
+	}
+
+	dwLen = (DWORD)(liSize.QuadPart - sizeof(hdr));
+	data	= (BYTE *)malloc(dwLen);
+	sizes	= (DWORD *)malloc(hdr.dwRecords * sizeof(DWORD));
+	gaps	= (DWORD *)malloc(hdr.dwRecords * sizeof(DWORD));
+	if (data != NULL && sizes != NULL && gaps != NULL && ReadFile(hFile, data, dwLen, &dwRead, NULL) && dwRead == dwLen)
+	{
+		p = data;
+		end = data + dwLen;
+		for (i = 0; i < hdr.dwRecords && p != NULL; i++)
+		{
+			if ((p = GetVarint(p, end, &sizes[i])) != NULL)
+				p = GetVarint(p, end, &gaps[i]);
+			if (p != NULL && (sizes[i] == 0 || sizes[i] > CAPTURE_MAXSIZE))
+				p = NULL;
+			if (p != NULL)
+			{
+				qwBytes += sizes[i];
+				qwUs += gaps[i];
+				dwMaxSize = max(dwMaxSize, sizes[i]);
+			}
+		}
+		bOk = p == end && qwBytes == hdr.qwBytes && qwUs == hdr.qwDurationUs;
+	}
+	CloseHandle(hFile);
+	free(data);
+	if (!bOk)
+	{
+		free(sizes);
+		free(gaps);
+		return FALSE;
+	}
+
+	// The first send starts the clock, whatever the recording says
+	gaps[0] = 0;
+
+	free(r->sizes);
+	free(r->gaps);
+	strncpy_s(r->szFile, FILENAME_SIZE, szFile, _TRUNCATE);
+	r->sizes		= sizes;
+	r->gaps			= gaps;
+	r->dwCount		= hdr.dwRecords;
+	r->dwMaxSize	= dwMaxSize;
+	r->qwBytes		= hdr.qwBytes;
+	r->qwDurationUs	= hdr.qwDurationUs;
+	r->nSockType	= hdr.wSockType;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StartReplay
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StartReplay(LPReplayState r, SchedResume resume, VOID *ctx)
+--							LPReplayState r:		The client's replay state, with a capture loaded.
+--							SchedResume resume:		Posts a send that was held back; called on the transfer's thread.
+--							VOID *ctx:				Passed to resume.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called on the transfer's thread as a replay transfer starts. The clock starts with the first send (see ReplayPace).
+-- If no timer can be made at all, sends are spun for however far off they are.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID StartReplay(LPReplayState r, SchedResume resume, VOID *ctx)
+{
+	r->bActive				= TRUE;
+	r->resume				= resume;
+	r->ctx					= ctx;
+	r->bHeld				= FALSE;
+	r->liStart.QuadPart		= 0;
+	r->dwNext				= 0;
+	r->qwDueUs				= 0;
+	r->qwLastUs				= 0;
+	r->dwSent				= 0;
+	r->dwResized			= 0;
+	r->dwHeld				= 0;
+	r->dwLate				= 0;
+	r->qwLateUs				= 0;
+	r->dwMaxLateUs			= 0;
+
+	// A high-resolution timer wakes within a fraction of a millisecond instead of on the next clock tick
+	if (r->dSpeed != 0 && r->hTimer == NULL)
+	{
+		r->hTimer = CreateWaitableTimerEx(NULL, NULL,
+			CREATE_WAITABLE_TIMER_MANUAL_RESET | CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (r->hTimer == NULL)
+			r->hTimer = CreateWaitableTimer(NULL, TRUE, NULL);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NextReplaySize
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NextReplaySize(LPReplayState r)
+--							LPReplayState r:	The client's replay state.
+--
+-- RETURNS: The size of the next send, which ReplayPace then times; 0 once the recording has all been sent.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD NextReplaySize(LPReplayState r)
+{
+	if (r->dwNext >= r->dwCount)
+		return 0;
+	r->qwDueUs += r->gaps[r->dwNext];
+	return r->sizes[r->dwNext++];
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReplayClock
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReplayClock(LPReplayState r)
+--							LPReplayState r:	The client's replay state.
+--
+-- RETURNS: Microseconds since the first send was posted.
+---------------------------------------------------------------------------------------------------------------------------*/
+static ULONGLONG ReplayClock(LPReplayState r)
+{
+	LARGE_INTEGER liNow;
+
+	QueryPerformanceCounter(&liNow);
+	return (ULONGLONG)(TicksToSeconds(liNow.QuadPart - r->liStart.QuadPart) * 1e6);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReplayTimer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReplayTimer(LPVOID lpArg, DWORD dwTimerLow, DWORD dwTimerHigh)
+--							LPVOID lpArg:		The client's replay state.
+--							DWORD dwTimerLow:	Not used.
+--							DWORD dwTimerHigh:	Not used.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Runs as an APC on the transfer's thread shortly before a held send is due. Spins out the rest of the wait and posts
+-- it, or holds it again if the timer went off too early.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID CALLBACK ReplayTimer(LPVOID lpArg, DWORD dwTimerLow, DWORD dwTimerHigh)
+{
+	LPReplayState r = (LPReplayState)lpArg;
+
+	if (!r->bHeld)
+		return;
+	if (!ReplayPace(r))
+		r->resume(r->ctx);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReplayPace
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReplayPace(LPReplayState r)
+--							LPReplayState r:	The client's replay state.
+--
+-- RETURNS: TRUE if the send has been held back, in which case it's posted through the resume callback given to
+--			StartReplay; FALSE if it should be posted now.
+--
+-- NOTES:
+-- Called before each send of a replay is posted, after NextReplaySize; does nothing for any other transfer. The first
+-- call starts the replay's clock. A send is due at its recorded time divided by the speed, counted from the first
+-- send rather than the one before it, so a send that goes late doesn't push back the ones after it.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ReplayPace(LPReplayState r)
+{
+	LARGE_INTEGER	liDue;
+	ULONGLONG		qwDueUs, qwNowUs, qwLateUs;
+
+	if (!r->bActive)
+		return FALSE;
+	if (r->liStart.QuadPart == 0)
+		QueryPerformanceCounter(&r->liStart);
+	qwNowUs = ReplayClock(r);
+
+	if (r->dSpeed != 0)
+	{
+		qwDueUs = (ULONGLONG)(r->qwDueUs / r->dSpeed);
+
+		// The timer is set to go off early, and the rest of the wait is spun out
+		if (r->hTimer != NULL && qwNowUs + REPLAY_SPIN_US < qwDueUs)
+		{
+			liDue.QuadPart = -(LONGLONG)(qwDueUs - qwNowUs - REPLAY_SPIN_US / 2) * 10;
+			if (SetWaitableTimer(r->hTimer, &liDue, 0, ReplayTimer, r, FALSE))
+			{
+				if (!r->bHeld)
+					r->dwHeld++;
+				r->bHeld = TRUE;
+				return TRUE;
+			}
+		}
+		while (qwNowUs < qwDueUs)
+		{
+			YieldProcessor();
+			qwNowUs = ReplayClock(r);
+		}
+
+		qwLateUs = qwNowUs - qwDueUs;
+		r->qwLateUs += qwLateUs;
+		r->dwMaxLateUs = (DWORD)max((ULONGLONG)r->dwMaxLateUs, min(qwLateUs, (ULONGLONG)MAXDWORD));
+		if (qwLateUs > REPLAY_LATE_US)
+			r->dwLate++;
+	}
+
+	r->bHeld = FALSE;
+	r->qwLastUs = qwNowUs;
+	r->dwSent++;
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: EndReplay
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: EndReplay(LPReplayState r)
+--							LPReplayState r:	The client's replay state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called on the transfer's thread once it's over. Drops any send still held back; the recording stays loaded for the
+-- next transfer.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID EndReplay(LPReplayState r)
+{
+	if (r->hTimer != NULL)
+	{
+		CancelWaitableTimer(r->hTimer);
+		CloseHandle(r->hTimer);
+		r->hTimer = NULL;
+	}
+	r->bHeld	= FALSE;
+	r->bActive	= FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatReplayReport
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatReplayReport(CHAR *buf, size_t size, LPReplayState r)
+--							CHAR *buf:			Where to write the report.
+--							size_t size:		The space left in buf.
+--							LPReplayState r:	The client's replay state.
+--
+-- RETURNS: The number of characters written; 0 if the transfer wasn't a replay.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatReplayReport(CHAR *buf, size_t size, LPReplayState r)
+{
+	INT written;
+
+	if (!r->bActive)
+		return 0;
+
+	written = sprintf_s(buf, size, "Replay: %lu of %lu %s from %s (%llu bytes over %.3fs as recorded)",
+		r->dwSent, r->dwCount, r->nSockType == SOCK_DGRAM ? "datagrams" : "receives", r->szFile, r->qwBytes,
+		r->qwDurationUs / 1e6);
+	if (r->dSpeed == 0)
+		written += sprintf_s(buf + written, size - written, " sent flat out in %.3fs", r->qwLastUs / 1e6);
+	else
+		written += sprintf_s(buf + written, size - written, " sent at %.2fx in %.3fs", r->dSpeed, r->qwLastUs / 1e6);
+	written += sprintf_s(buf + written, size - written, "\r\n");
+
+	if (r->dSpeed != 0 && r->dwSent != 0)
+		written += sprintf_s(buf + written, size - written,
+			"Replay: %lu sends more than %.1fms late (mean %.3fms, worst %.3fms); %lu held on the timer\r\n",
+			r->dwLate, REPLAY_LATE_US / 1000.0, r->qwLateUs / 1000.0 / r->dwSent, r->dwMaxLateUs / 1000.0, r->dwHeld);
+	if (r->dwResized != 0)
+		written += sprintf_s(buf + written, size - written,
+			"Replay: %lu records resized to fit a UDP test packet (%lu to %lu bytes)\r\n", r->dwResized,
+			(DWORD)sizeof(PayloadHeader), (DWORD)REPLAY_MAX_DATAGRAM);
+	return written;
+}
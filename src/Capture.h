@@ -0,0 +1,51 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <Windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Payload.h"
+
+#define CAPTURE_MAGIC		0x54504143	// "CAPT"
+#define CAPTURE_VERSION		1
+#define CAPTURE_BUFSIZE		65536		// Records gathered before they're written
+#define CAPTURE_MAXRECORD	10			// The longest record: two varints of up to 5 bytes each
+#define CAPTURE_MAXRECORDS	(1 << 24)	// Most arrivals recorded per transfer, and loaded by -replay
+#define CAPTURE_MAXSIZE		(16 << 20)	// Largest arrival -replay accepts; a bigger one means a damaged file
+#define REPLAY_SPIN_US		1000		// A send due sooner than this is spun for instead of held on the timer
+#define REPLAY_LATE_US		1000		// A send posted later than this after it was due is counted late
+#define REPLAY_MAX_DATAGRAM	65507		// The largest UDP payload over IPv4
+
+#pragma pack(push, 1)
+
+/* The start of a capture file. Each arrival follows as two varints (7 bits a byte, low bits first): its size in bytes
+   and the microseconds since the arrival before it (0 for the first). */
+typedef struct _CaptureHeader
+{
+	DWORD		dwMagic;
+	WORD		wVersion;
+	WORD		wSockType;		// SOCK_DGRAM (each arrival a datagram) or SOCK_STREAM (each one a receive completion)
+	DWORD		dwRecords;
+	ULONGLONG	qwBytes;
+	ULONGLONG	qwDurationUs;	// From the first arrival to the last
+} CaptureHeader, *LPCaptureHeader;
+
+#pragma pack(pop)
+
+VOID InitCaptureState(LPCaptureState c);
+VOID StartCapture(LPCaptureState c, DWORD nSockType);
+VOID CaptureArrival(LPCaptureState c, DWORD dwBytes);
+VOID EndCapture(LPCaptureState c);
+INT FormatCaptureReport(CHAR *buf, size_t size, LPCaptureState c);
+VOID InitReplayState(LPReplayState r);
+BOOL LoadCapture(LPReplayState r, const CHAR *szFile);
+VOID StartReplay(LPReplayState r, SchedResume resume, VOID *ctx);
+DWORD NextReplaySize(LPReplayState r);
+BOOL ReplayPace(LPReplayState r);
+VOID EndReplay(LPReplayState r);
+INT FormatReplayReport(CHAR *buf, size_t size, LPReplayState r);
+
+#endif
@@ -0,0 +1,626 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Checksum.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitChecksum();
+-- BOOL HasHardwareCrc32c();
+-- DWORD Crc32c(DWORD dwCrc, const BYTE *data, size_t len);
+-- ULONGLONG Hash64(const BYTE *data, size_t len, ULONGLONG qwSeed);
+-- VOID InitIntegrityState(LPIntegrityState state);
+-- DWORD ChecksumChunk(LPIntegrityState state, ULONGLONG qwOffset, const BYTE *data, DWORD dwLen);
+-- VOID FoldChunkDigest(LPIntegrityState state, ULONGLONG qwOffset, DWORD dwLen, DWORD dwCrc);
+-- VOID FinishIntegrity(LPIntegrityState state, DWORD dwPeerChunks, ULONGLONG qwPeerDigest);
+-- INT FormatIntegrityReport(CHAR *buf, size_t size, LPIntegrityState state, BOOL bReceiver);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file contains the end-to-end integrity checks for file transfers. Both ends take the CRC32C of each
+--			chunk's file data as it passes through (before compression on the sender, after decompression on the
+--			receiver), so the file never has to be read a second time to verify it.
+--
+--			On processors with SSE4.2 the CRC uses the crc32 instruction. The instruction has a latency of three
+--			cycles but can start one every cycle, so long buffers are split into three lanes which are checksummed
+--			together and then joined; shifting a CRC past a lane is a multiplication by x^(8 * CRC32C_LANE) modulo
+--			the polynomial. Older processors fall back to a slicing-by-8 table.
+--
+--			Hash64 is XXH64, for places that need a stronger check than 32 bits, such as telling blocks apart.
+--
+--			The whole-file digest is the sum of a 64-bit mix of each chunk's offset, length and CRC. A sum doesn't
+--			depend on the order the chunks arrive in, which matters over UDP, but a missing, repeated or altered
+--			chunk still changes it.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Checksum.h"
+
+static DWORD	crcTable[8][256];		// Slicing-by-8 tables
+static DWORD	dwLaneShift;			// x^(8 * CRC32C_LANE) mod P
+static BOOL		bHardwareCrc = FALSE;	// Whether the processor has the SSE4.2 crc32 instruction
+static BOOL		bInitialised = FALSE;
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: MultModP
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: MultModP(DWORD a, DWORD b)
+--						DWORD a, b: Two polynomials in the bit-reflected CRC representation; a must not be zero.
+--
+-- RETURNS: a * b modulo the CRC32C polynomial.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD MultModP(DWORD a, DWORD b)
+{
+	DWORD m = 1u << 31;
+	DWORD p = 0;
+
+	for (;;)
+	{
+		if (a & m)
+		{
+			p ^= b;
+			if ((a & (m - 1)) == 0)
+				break;
+		}
+		m >>= 1;
+		b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+	}
+	return p;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: XPowModP
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: XPowModP(ULONGLONG n)
+--
+-- RETURNS: x^n modulo the CRC32C polynomial. Multiplying a CRC register by x^(8k) gives the register after k more
+--			zero bytes.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD XPowModP(ULONGLONG n)
+{
+	DWORD p = 1u << 31;	// x^0
+	DWORD x = 1u << 30;	// x^1
+
+	for (; n != 0; n >>= 1)
+	{
+		if (n & 1)
+			p = MultModP(x, p);
+		x = MultModP(x, x);
+	}
+	return p;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitChecksum
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitChecksum()
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Builds the tables and checks the processor. This is called from WinMain before any transfer thread exists.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitChecksum()
+{
+	INT		cpuInfo[4];
+	DWORD	i, k, crc;
+
+	for (i = 0; i < 256; i++)
+	{
+		crc = i;
+		for (k = 0; k < 8; k++)
+			crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+		crcTable[0][i] = crc;
+	}
+
+	for (i = 0; i < 256; i++)
+		for (k = 1; k < 8; k++)
+			crcTable[k][i] = (crcTable[k - 1][i] >> 8) ^ crcTable[0][crcTable[k - 1][i] & 0xFF];
+
+	dwLaneShift = XPowModP(8ULL * CRC32C_LANE);
+
+	__cpuid(cpuInfo, 1);
+	bHardwareCrc = (cpuInfo[2] & (1 << 20)) != 0; // ECX bit 20: SSE4.2
+	bInitialised = TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: HasHardwareCrc32c
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: HasHardwareCrc32c()
+--
+-- RETURNS: TRUE if Crc32c uses the SSE4.2 instruction; FALSE if it uses the tables.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL HasHardwareCrc32c()
+{
+	if (!bInitialised)
+		InitChecksum();
+	return bHardwareCrc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Load64
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Load64(const BYTE *p)
+--
+-- RETURNS: The eight (possibly unaligned) bytes at p.
+---------------------------------------------------------------------------------------------------------------------------*/
+static __forceinline ULONGLONG Load64(const BYTE *p)
+{
+	ULONGLONG v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Crc32cStep
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Crc32cStep(ULONGLONG crc, ULONGLONG v)
+--
+-- RETURNS: The CRC register after eight more bytes. 32-bit builds don't have the 64-bit form of the instruction, so
+--			they use two 32-bit ones.
+---------------------------------------------------------------------------------------------------------------------------*/
+static __forceinline ULONGLONG Crc32cStep(ULONGLONG crc, ULONGLONG v)
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return _mm_crc32_u64(crc, v);
+#else
+	crc = _mm_crc32_u32((DWORD)crc, (DWORD)v);
+	return _mm_crc32_u32((DWORD)crc, (DWORD)(v >> 32));
+#endif
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Crc32cHardware
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Crc32cHardware(DWORD crc, const BYTE *data, size_t len)
+--						DWORD crc:		The CRC register (not inverted).
+--						BYTE *data:		The bytes to add.
+--						size_t len:		How many there are.
+--
+-- RETURNS: The updated CRC register.
+--
+-- NOTES:
+-- Each block of three lanes is checksummed as three independent streams, the second and third starting from zero.
+-- Because the CRC is linear, the register for the whole block is the first lane's shifted past the second, plus the
+-- second's, shifted past the third, plus the third's.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD Crc32cHardware(DWORD crc, const BYTE *data, size_t len)
+{
+	while (len >= 3 * CRC32C_LANE)
+	{
+		ULONGLONG	c0		= crc, c1 = 0, c2 = 0;
+		const BYTE	*end	= data + CRC32C_LANE;
+
+		for (; data < end; data += 8)
+		{
+			c0 = Crc32cStep(c0, Load64(data));
+			c1 = Crc32cStep(c1, Load64(data + CRC32C_LANE));
+			c2 = Crc32cStep(c2, Load64(data + 2 * CRC32C_LANE));
+		}
+
+		crc = MultModP(dwLaneShift, (DWORD)c0) ^ (DWORD)c1;
+		crc = MultModP(dwLaneShift, crc) ^ (DWORD)c2;
+		data += 2 * CRC32C_LANE;
+		len -= 3 * CRC32C_LANE;
+	}
+
+	for (; len >= 8; data += 8, len -= 8)
+		crc = (DWORD)Crc32cStep(crc, Load64(data));
+
+	for (; len > 0; data++, len--)
+		crc = _mm_crc32_u8(crc, *data);
+	return crc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Crc32cTable
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Crc32cTable(DWORD crc, const BYTE *data, size_t len)
+--						DWORD crc:		The CRC register (not inverted).
+--						BYTE *data:		The bytes to add.
+--						size_t len:		How many there are.
+--
+-- RETURNS: The updated CRC register.
+--
+-- NOTES:
+-- Slicing-by-8: eight bytes are looked up in eight tables at once. Assumes a little-endian processor.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD Crc32cTable(DWORD crc, const BYTE *data, size_t len)
+{
+	for (; len >= 8; data += 8, len -= 8)
+	{
+		ULONGLONG	v	= Load64(data);
+		DWORD		lo	= (DWORD)v ^ crc;
+		DWORD		hi	= (DWORD)(v >> 32);
+
+		crc = crcTable[7][lo & 0xFF] ^ crcTable[6][(lo >> 8) & 0xFF] ^ crcTable[5][(lo >> 16) & 0xFF] ^
+			crcTable[4][lo >> 24] ^ crcTable[3][hi & 0xFF] ^ crcTable[2][(hi >> 8) & 0xFF] ^
+			crcTable[1][(hi >> 16) & 0xFF] ^ crcTable[0][hi >> 24];
+	}
+
+	for (; len > 0; data++, len--)
+		crc = (crc >> 8) ^ crcTable[0][(crc ^ *data) & 0xFF];
+	return crc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Crc32c
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Crc32c(DWORD dwCrc, const BYTE *data, size_t len)
+--						DWORD dwCrc:	The CRC of the preceding data, or 0 to start a new one.
+--						BYTE *data:		The data.
+--						size_t len:		Its length.
+--
+-- RETURNS: The CRC32C of the preceding data followed by this data.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD Crc32c(DWORD dwCrc, const BYTE *data, size_t len)
+{
+	if (!bInitialised)
+		InitChecksum();
+
+	dwCrc = ~dwCrc;
+	dwCrc = bHardwareCrc ? Crc32cHardware(dwCrc, data, len) : Crc32cTable(dwCrc, data, len);
+	return ~dwCrc;
+}
+
+#define XXH_PRIME1	0x9E3779B185EBCA87ULL
+#define XXH_PRIME2	0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME3	0x165667B19E3779F9ULL
+#define XXH_PRIME4	0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME5	0x27D4EB2F165667C5ULL
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: XxhRound
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: XxhRound(ULONGLONG acc, ULONGLONG v)
+--
+-- RETURNS: The XXH64 accumulator after taking in eight more bytes.
+---------------------------------------------------------------------------------------------------------------------------*/
+static __forceinline ULONGLONG XxhRound(ULONGLONG acc, ULONGLONG v)
+{
+	acc += v * XXH_PRIME2;
+	acc = _rotl64(acc, 31);
+	return acc * XXH_PRIME1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: XxhMerge
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: XxhMerge(ULONGLONG h, ULONGLONG acc)
+--
+-- RETURNS: The hash with one of the four lane accumulators merged in.
+---------------------------------------------------------------------------------------------------------------------------*/
+static __forceinline ULONGLONG XxhMerge(ULONGLONG h, ULONGLONG acc)
+{
+	h ^= XxhRound(0, acc);
+	return h * XXH_PRIME1 + XXH_PRIME4;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Hash64
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Hash64(const BYTE *data, size_t len, ULONGLONG qwSeed)
+--						BYTE *data:			The data.
+--						size_t len:			Its length.
+--						ULONGLONG qwSeed:	The seed.
+--
+-- RETURNS: The XXH64 hash of the data.
+---------------------------------------------------------------------------------------------------------------------------*/
+ULONGLONG Hash64(const BYTE *data, size_t len, ULONGLONG qwSeed)
+{
+	const BYTE	*end = data + len;
+	ULONGLONG	h;
+	DWORD		v32;
+
+	if (len >= 32)
+	{
+		ULONGLONG	v1 = qwSeed + XXH_PRIME1 + XXH_PRIME2;
+		ULONGLONG	v2 = qwSeed + XXH_PRIME2;
+		ULONGLONG	v3 = qwSeed;
+		ULONGLONG	v4 = qwSeed - XXH_PRIME1;
+
+		for (; data + 32 <= end; data += 32)
+		{
+			v1 = XxhRound(v1, Load64(data));
+			v2 = XxhRound(v2, Load64(data + 8));
+			v3 = XxhRound(v3, Load64(data + 16));
+			v4 = XxhRound(v4, Load64(data + 24));
+		}
+
+		h = _rotl64(v1, 1) + _rotl64(v2, 7) + _rotl64(v3, 12) + _rotl64(v4, 18);
+		h = XxhMerge(h, v1);
+		h = XxhMerge(h, v2);
+		h = XxhMerge(h, v3);
+		h = XxhMerge(h, v4);
+	}
+	else
+		h = qwSeed + XXH_PRIME5;
+
+	h += len;
+
+	for (; data + 8 <= end; data += 8)
+	{
+		h ^= XxhRound(0, Load64(data));
+		h = _rotl64(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+	}
+
+	if (data + 4 <= end)
+	{
+		memcpy(&v32, data, sizeof(v32));
+		h ^= v32 * XXH_PRIME1;
+		h = _rotl64(h, 23) * XXH_PRIME2 + XXH_PRIME3;
+		data += 4;
+	}
+
+	for (; data < end; data++)
+	{
+		h ^= *data * XXH_PRIME5;
+		h = _rotl64(h, 11) * XXH_PRIME1;
+	}
+
+	h ^= h >> 33;
+	h *= XXH_PRIME2;
+	h ^= h >> 29;
+	h *= XXH_PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Mix64
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Mix64(ULONGLONG x)
+--
+-- RETURNS: x with its bits thoroughly mixed (the SplitMix64 finaliser).
+---------------------------------------------------------------------------------------------------------------------------*/
+static ULONGLONG Mix64(ULONGLONG x)
+{
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ULL;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+	return x;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitIntegrityState
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitIntegrityState(LPIntegrityState state)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called at the start of every file transfer.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitIntegrityState(LPIntegrityState state)
+{
+	memset(state, 0, sizeof(IntegrityState));
+	state->dwResult = INTEGRITY_UNKNOWN;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ChecksumChunk
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ChecksumChunk(LPIntegrityState state, ULONGLONG qwOffset, const BYTE *data, DWORD dwLen)
+--							LPIntegrityState state:	The transfer's integrity state.
+--							ULONGLONG qwOffset:		Where the chunk goes in the file.
+--							BYTE *data:				The chunk's file data (uncompressed).
+--							DWORD dwLen:			Its length.
+--
+-- RETURNS: The chunk's CRC32C.
+--
+-- NOTES:
+-- Also folds the chunk into the whole-file digest and times the work so the report can show what it cost.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD ChecksumChunk(LPIntegrityState state, ULONGLONG qwOffset, const BYTE *data, DWORD dwLen)
+{
+	LARGE_INTEGER	liStart, liEnd;
+	DWORD			dwCrc;
+
+	QueryPerformanceCounter(&liStart);
+	dwCrc = Crc32c(0, data, dwLen);
+	QueryPerformanceCounter(&liEnd);
+
+	FoldChunkDigest(state, qwOffset, dwLen, dwCrc);
+	state->qwBytes += dwLen;
+	state->qwHashTicks += liEnd.QuadPart - liStart.QuadPart;
+	return dwCrc;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FoldChunkDigest
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FoldChunkDigest(LPIntegrityState state, ULONGLONG qwOffset, DWORD dwLen, DWORD dwCrc)
+--							LPIntegrityState state:	The transfer's integrity state.
+--							ULONGLONG qwOffset:		Where the chunk goes in the file.
+--							DWORD dwLen:			Its length.
+--							DWORD dwCrc:			Its CRC32C.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Adds a chunk to the whole-file digest. ChecksumChunk does this for chunks that are sent; resumed transfers call it
+-- directly for the chunks the receiver already had.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FoldChunkDigest(LPIntegrityState state, ULONGLONG qwOffset, DWORD dwLen, DWORD dwCrc)
+{
+	state->qwDigest += Mix64(Mix64(qwOffset) ^ (((ULONGLONG)dwCrc << 32) | dwLen));
+	state->dwChunks++;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FinishIntegrity
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FinishIntegrity(LPIntegrityState state, DWORD dwPeerChunks, ULONGLONG qwPeerDigest)
+--							LPIntegrityState state:	The receiver's integrity state.
+--							DWORD dwPeerChunks:		The number of data chunks the sender sent.
+--							ULONGLONG qwPeerDigest:	The sender's whole-file digest.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called by the receiver when the CHUNK_END arrives to decide whether the file is intact.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FinishIntegrity(LPIntegrityState state, DWORD dwPeerChunks, ULONGLONG qwPeerDigest)
+{
+	state->dwPeerChunks = dwPeerChunks;
+	state->qwPeerDigest = qwPeerDigest;
+
+	if (state->dwBadChunks == 0 && state->dwChunks == dwPeerChunks && state->qwDigest == qwPeerDigest)
+		state->dwResult = INTEGRITY_VERIFIED;
+	else
+		state->dwResult = INTEGRITY_FAILED;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatIntegrityReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatIntegrityReport(CHAR *buf, size_t size, LPIntegrityState state, BOOL bReceiver)
+--							CHAR *buf:				The buffer to write the report section into.
+--							size_t size:			The space left in buf.
+--							LPIntegrityState state:	The integrity state at the end of the transfer.
+--							BOOL bReceiver:			Whether this end received the file.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The sender never learns the result, so its report just gives the digest it sent.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatIntegrityReport(CHAR *buf, size_t size, LPIntegrityState state, BOOL bReceiver)
+{
+	INT		written = 0;
+	double	dSeconds = TicksToSeconds(state->qwHashTicks);
+
+	if (!bReceiver)
+		written += sprintf_s(buf, size, "Integrity: digest %016llx sent\r\n", state->qwDigest);
+	else if (state->dwResult == INTEGRITY_VERIFIED)
+		written += sprintf_s(buf, size, "Integrity: verified (digest %016llx)\r\n", state->qwDigest);
+	else if (state->dwResult == INTEGRITY_FAILED)
+		written += sprintf_s(buf, size, "Integrity: FAILED (%lu bad chunks, %lu of %lu chunks received, digest %016llx, "
+			"expected %016llx)\r\n", state->dwBadChunks, state->dwChunks, state->dwPeerChunks, state->qwDigest,
+			state->qwPeerDigest);
+	else
+		written += sprintf_s(buf, size, "Integrity: unknown (the end of the file never arrived; %lu bad chunks)\r\n",
+			state->dwBadChunks);
+
+	if (state->dwResumedChunks != 0)
+		written += sprintf_s(buf + written, size - written, "Resumed: %lu chunks were already at the receiver\r\n",
+			state->dwResumedChunks);
+
+	written += sprintf_s(buf + written, size - written, "Checksum: CRC32C (%s), %lu chunks, %.1fms (%.0f MB/s)\r\n",
+		HasHardwareCrc32c() ? "SSE4.2" : "table", state->dwChunks, dSeconds * 1000.0,
+		dSeconds > 0.0 ? state->qwBytes / dSeconds / 1e6 : 0.0);
+	return written;
+}
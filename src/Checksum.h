@@ -0,0 +1,26 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <Windows.h>
+#include <intrin.h>
+#include <nmmintrin.h>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+
+#define CRC32C_POLY			0x82F63B78	// The Castagnoli polynomial, bit-reflected
+#define CRC32C_LANE			8192		// Bytes per lane when the hardware CRC runs three streams side by side
+
+VOID InitChecksum();
+BOOL HasHardwareCrc32c();
+DWORD Crc32c(DWORD dwCrc, const BYTE *data, size_t len);
+ULONGLONG Hash64(const BYTE *data, size_t len, ULONGLONG qwSeed);
+
+VOID InitIntegrityState(LPIntegrityState state);
+DWORD ChecksumChunk(LPIntegrityState state, ULONGLONG qwOffset, const BYTE *data, DWORD dwLen);
+VOID FoldChunkDigest(LPIntegrityState state, ULONGLONG qwOffset, DWORD dwLen, DWORD dwCrc);
+VOID FinishIntegrity(LPIntegrityState state, DWORD dwPeerChunks, ULONGLONG qwPeerDigest);
+INT FormatIntegrityReport(CHAR *buf, size_t size, LPIntegrityState state, BOOL bReceiver);
+
+#endif
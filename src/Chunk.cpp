@@ -0,0 +1,261 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Chunk.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitChunkHeader(LPChunkHeader hdr, WORD wType, DWORD dwSeq, ULONGLONG qwOffset);
+-- BOOL IsValidChunk(const BYTE *buf, DWORD dwLen);
+-- BYTE *DecodeChunk(LPChunkHeader hdr, BYTE *scratch, LPCompressState state);
+-- BOOL InitChunkReader(LPChunkReader reader);
+-- VOID FreeChunkReader(LPChunkReader reader);
+-- DWORD ChunkReaderFeed(LPChunkReader reader, const BYTE *data, DWORD dwLen);
+-- LPChunkHeader ChunkReaderNext(LPChunkReader reader);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	File transfers are sent as a series of chunks, each a ChunkHeader followed by its payload, and finished
+--			with a CHUNK_END. Over UDP every datagram is exactly one chunk. Over TCP the chunks are reassembled from
+--			the byte stream with a ChunkReader. Because every chunk carries its own file offset, the receiver can
+--			write chunks in whatever order they arrive.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Chunk.h"
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitChunkHeader
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitChunkHeader(LPChunkHeader hdr, WORD wType, DWORD dwSeq, ULONGLONG qwOffset)
+--							LPChunkHeader hdr:		The header to fill.
+--							WORD wType:				The chunk type.
+--							DWORD dwSeq:			The chunk number.
+--							ULONGLONG qwOffset:		The file offset of the payload.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- The lengths and flags are left at zero for the caller to fill in once the payload is known.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitChunkHeader(LPChunkHeader hdr, WORD wType, DWORD dwSeq, ULONGLONG qwOffset)
+{
+	memset(hdr, 0, sizeof(ChunkHeader));
+	hdr->dwMagic	= CHUNK_MAGIC;
+	hdr->wType		= wType;
+	hdr->dwSeq		= dwSeq;
+	hdr->qwOffset	= qwOffset;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsValidHeader
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsValidHeader(const ChunkHeader *hdr)
+--
+-- RETURNS: TRUE if the header could have been produced by a sender.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL IsValidHeader(const ChunkHeader *hdr)
+{
+	DWORD dwMaxWire = CHUNK_MAXPAYLOAD + ((hdr->wFlags & CHUNK_SEALED) ? CHUNK_SEALSIZE : 0);
+
+	return hdr->dwMagic == CHUNK_MAGIC && hdr->dwWireLen <= dwMaxWire && hdr->dwLogicalLen <= CHUNK_MAXPAYLOAD;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsValidChunk
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsValidChunk(const BYTE *buf, DWORD dwLen)
+--							BYTE *buf:		A received datagram.
+--							DWORD dwLen:	Its length.
+--
+-- RETURNS: TRUE if the datagram holds exactly one well-formed chunk.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsValidChunk(const BYTE *buf, DWORD dwLen)
+{
+	const ChunkHeader *hdr = (const ChunkHeader *)buf;
+
+	if (dwLen < sizeof(ChunkHeader) || !IsValidHeader(hdr))
+		return FALSE;
+	return dwLen == sizeof(ChunkHeader) + hdr->dwWireLen;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DecodeChunk
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DecodeChunk(LPChunkHeader hdr, BYTE *scratch, LPCompressState state)
+--							LPChunkHeader hdr:		A complete data chunk.
+--							BYTE *scratch:			CHUNK_MAXPAYLOAD bytes to decompress into if necessary.
+--							LPCompressState state:	The receiver's compression counters.
+--
+-- RETURNS: A pointer to the dwLogicalLen bytes of file data, or NULL if the payload is corrupt.
+--
+-- NOTES:
+-- Uncompressed payloads are returned in place, so the common case costs no copy.
+---------------------------------------------------------------------------------------------------------------------------*/
+BYTE *DecodeChunk(LPChunkHeader hdr, BYTE *scratch, LPCompressState state)
+{
+	BYTE			*payload = (BYTE *)(hdr + 1);
+	LARGE_INTEGER	liStart, liEnd;
+
+	state->dwChunks++;
+	state->qwLogicalBytes += hdr->dwLogicalLen;
+	state->qwWireBytes += sizeof(ChunkHeader) + hdr->dwWireLen;
+
+	if (!(hdr->wFlags & CHUNK_COMPRESSED))
+		return (hdr->dwWireLen == hdr->dwLogicalLen) ? payload : NULL;
+
+	QueryPerformanceCounter(&liStart);
+	if (LZDecompress(payload, hdr->dwWireLen, scratch, CHUNK_MAXPAYLOAD) != hdr->dwLogicalLen)
+		return NULL;
+	QueryPerformanceCounter(&liEnd);
+
+	state->dwCompressed++;
+	state->qwCodecTicks += liEnd.QuadPart - liStart.QuadPart;
+	return scratch;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitChunkReader
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitChunkReader(LPChunkReader reader)
+--							LPChunkReader reader: The reader to initialise.
+--
+-- RETURNS: FALSE if the reassembly buffer couldn't be allocated; TRUE otherwise.
+--
+-- NOTES:
+-- The buffer holds two maximum-sized chunks so a whole chunk always fits behind a partial one.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL InitChunkReader(LPChunkReader reader)
+{
+	reader->dwCap		= 2 * CHUNK_BUFSIZE;
+	reader->dwStart		= 0;
+	reader->dwEnd		= 0;
+	reader->bCorrupt	= FALSE;
+	reader->buf			= (BYTE *)PoolAlloc(reader->dwCap);
+	return reader->buf != NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FreeChunkReader
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FreeChunkReader(LPChunkReader reader)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FreeChunkReader(LPChunkReader reader)
+{
+	PoolFree(reader->buf);
+	reader->buf = NULL;
+	reader->dwStart = reader->dwEnd = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ChunkReaderFeed
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ChunkReaderFeed(LPChunkReader reader, const BYTE *data, DWORD dwLen)
+--							LPChunkReader reader:	The reader.
+--							BYTE *data:				Bytes received from the stream.
+--							DWORD dwLen:			How many there are.
+--
+-- RETURNS: The number of bytes taken; the caller must drain the reader with ChunkReaderNext and feed the rest.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD ChunkReaderFeed(LPChunkReader reader, const BYTE *data, DWORD dwLen)
+{
+	DWORD dwTaken;
+
+	if (reader->dwStart == reader->dwEnd)
+		reader->dwStart = reader->dwEnd = 0;
+	else if (reader->dwStart > 0 && reader->dwCap - reader->dwEnd < dwLen)
+	{
+		memmove(reader->buf, reader->buf + reader->dwStart, reader->dwEnd - reader->dwStart);
+		reader->dwEnd -= reader->dwStart;
+		reader->dwStart = 0;
+	}
+
+	dwTaken = min(dwLen, reader->dwCap - reader->dwEnd);
+	memcpy(reader->buf + reader->dwEnd, data, dwTaken);
+	reader->dwEnd += dwTaken;
+	return dwTaken;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ChunkReaderNext
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ChunkReaderNext(LPChunkReader reader)
+--							LPChunkReader reader: The reader.
+--
+-- RETURNS: The next complete chunk, or NULL if there isn't one yet (or the stream is corrupt; check bCorrupt).
+--
+-- NOTES:
+-- The returned chunk lives in the reader's buffer and is only valid until the next call to ChunkReaderFeed.
+---------------------------------------------------------------------------------------------------------------------------*/
+LPChunkHeader ChunkReaderNext(LPChunkReader reader)
+{
+	LPChunkHeader	hdr		= (LPChunkHeader)(reader->buf + reader->dwStart);
+	DWORD			dwHave	= reader->dwEnd - reader->dwStart;
+
+	if (reader->bCorrupt || dwHave < sizeof(ChunkHeader))
+		return NULL;
+
+	if (!IsValidHeader(hdr))
+	{
+		reader->bCorrupt = TRUE;
+		return NULL;
+	}
+
+	if (dwHave < sizeof(ChunkHeader) + hdr->dwWireLen)
+		return NULL;
+
+	reader->dwStart += sizeof(ChunkHeader) + hdr->dwWireLen;
+	return hdr;
+}
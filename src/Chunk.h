@@ -0,0 +1,76 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <Windows.h>
+#include <cstring>
+#include "WinStorage.h"
+#include "Compress.h"
+#include "Pool.h"
+
+#define CHUNK_MAGIC			0x4B4E4843	// "CHNK"
+#define CHUNK_MAXPAYLOAD	65536		// The largest payload a chunk may carry
+#define CHUNK_SEALSIZE		28			// What sealing adds to a payload: the CRC and the record trailer (see Crypt.cpp)
+#define CHUNK_BUFSIZE		(sizeof(ChunkHeader) + CHUNK_MAXPAYLOAD + CHUNK_SEALSIZE)
+
+// Chunk types
+#define CHUNK_DATA			1			// A piece of the file at qwOffset
+#define CHUNK_END			2			// The last chunk of a transfer; the payload is a ChunkEnd
+#define CHUNK_COPY			3			// Data the receiver already has; the payload is a ChunkCopy (see Delta.cpp)
+
+// Chunk flags
+#define CHUNK_COMPRESSED	0x0001		// The payload is LZ compressed
+#define CHUNK_SEALED		0x0002		// The payload is encrypted and authenticated; the CRC is inside it
+
+#pragma pack(push, 1)
+
+/* Every chunk of a file transfer starts with this header; dwWireLen bytes of payload follow it. Both ends are x86
+   Windows, so the fields are sent in host order. */
+typedef struct _ChunkHeader
+{
+	DWORD		dwMagic;
+	WORD		wType;
+	WORD		wFlags;
+	DWORD		dwSeq;			// Chunk number, starting at 0
+	DWORD		dwLogicalLen;	// Payload length once decoded
+	DWORD		dwWireLen;		// Payload length as sent
+	DWORD		dwCrc;			// CRC32C of the decoded payload
+	ULONGLONG	qwOffset;		// Where the decoded payload goes in the file
+} ChunkHeader, *LPChunkHeader;
+
+/* The payload of a CHUNK_END. */
+typedef struct _ChunkEnd
+{
+	ULONGLONG	qwFileSize;
+	DWORD		dwChunks;		// Data chunks sent
+	ULONGLONG	qwDigest;		// Digest of the whole file (see Checksum.cpp)
+} ChunkEnd, *LPChunkEnd;
+
+/* The payload of a CHUNK_COPY: dwLogicalLen bytes of the receiver's existing file, starting at qwSrcOffset, go at
+   qwOffset. The CRC is of those bytes. */
+typedef struct _ChunkCopy
+{
+	ULONGLONG	qwSrcOffset;
+} ChunkCopy, *LPChunkCopy;
+
+#pragma pack(pop)
+
+/* Reassembles chunks from a byte stream (TCP delivers them split and joined arbitrarily). */
+typedef struct _ChunkReader
+{
+	BYTE		*buf;
+	DWORD		dwCap;
+	DWORD		dwStart;		// Start of the unconsumed data
+	DWORD		dwEnd;			// End of the unconsumed data
+	BOOL		bCorrupt;		// Set once a bad header has been seen; the stream can't be resynchronised
+} ChunkReader, *LPChunkReader;
+
+VOID InitChunkHeader(LPChunkHeader hdr, WORD wType, DWORD dwSeq, ULONGLONG qwOffset);
+BOOL IsValidChunk(const BYTE *buf, DWORD dwLen);
+BYTE *DecodeChunk(LPChunkHeader hdr, BYTE *scratch, LPCompressState state);
+
+BOOL InitChunkReader(LPChunkReader reader);
+VOID FreeChunkReader(LPChunkReader reader);
+DWORD ChunkReaderFeed(LPChunkReader reader, const BYTE *data, DWORD dwLen);
+LPChunkHeader ChunkReaderNext(LPChunkReader reader);
+
+#endif
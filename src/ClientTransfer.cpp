@@ -15,8 +15,27 @@
 -- VOID CALLBACK TCPSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
 --		LPOVERLAPPED lpOverlapped, DWORD dwFlags);
 --
--- BOOL LoadFile(LPWSABUF wsaBuf, const TCHAR *szFileName, char **buf, LPDWORD lpdwFileSize, LPTransferProps props);
--- BOOL PopulateBuffer(LPWSABUF pwsaBuf, LPTransferProps props, LPDWORD lpdwFileSize);
+-- BOOL LoadFile(const TCHAR *szFileName, PULONGLONG lpqwFileSize, LPTransferProps props);
+-- BOOL PopulateBuffer(LPWSABUF pwsaBuf, LPTransferProps props);
+-- BOOL BuildNextChunk(LPWSABUF pwsaBuf, LPTransferProps props);
+-- BOOL BuildRepair(LPWSABUF pwsaBuf, DWORD dwSeq, LPTransferProps props);
+-- BOOL ResumeQuery(LPTransferProps props);
+-- BOOL DeltaQuery(LPTransferProps props);
+-- BOOL DedupQuery(LPTransferProps props);
+-- BOOL BatchQuery(LPTransferProps props);
+-- static BOOL ConnectToServer(LPTransferProps props);
+-- static BOOL SendFileQuery(LPTransferProps props);
+-- static BOOL SizeToPathMtu(LPWSABUF pwsaBuf, LPTransferProps props);
+-- static VOID SealNextSend(LPTransferProps props);
+-- static BOOL PrepareNextSend(LPTransferProps props, DWORD dwLastSent);
+-- static VOID ResumeSend(VOID *ctx);
+-- static VOID ReplayResume(VOID *ctx);
+-- static BOOL BuildReplaySend(LPWSABUF pwsaBuf, LPTransferProps props);
+-- static BOOL PopulateReplay(LPWSABUF pwsaBuf, LPTransferProps props);
+-- static VOID PackChunk(LPWSABUF pwsaBuf, const BYTE *data, DWORD dwLen, BOOL bCompress, LPTransferProps props);
+-- static BOOL BuildEndChunk(LPWSABUF pwsaBuf, LPTransferProps props);
+-- static BOOL BuildDeltaChunk(LPWSABUF pwsaBuf, LPTransferProps props);
+-- static BOOL BuildDedupChunk(LPWSABUF pwsaBuf, LPTransferProps props);
 -- CHAR *CreateBuffer(CHAR data, LPTransferProps props);
 --
 --
@@ -28,13 +47,46 @@
 --
 -- NOTES:	Functions in this file compose the client side of the program. ClientSendData where the data is transferred,
 --			ClientInitSocket preps a socket for sending, and ClientCleanup frees all allocated memory and the two callback functions are completion routines called by
---			Windows when data was sent, and LoadFile loads a user-specified file into the sending buffer.
+--			Windows when data was sent, and LoadFile opens a user-specified file for sending. Files are sent as a
+--			series of chunks (see Chunk.cpp) which BuildNextChunk reads, and optionally compresses, one at a time.
+--			Over TCP, ResumeQuery first asks the server which chunks it already has (see Manifest.cpp), or for a delta
+--			transfer DeltaQuery asks for the signatures of the server's copy (see Delta.cpp), or DedupQuery offers the
+--			hashes of the file's content-defined chunks and only those the server lacks are sent (see Dedup.cpp). A
+--			directory or a list of files separated by '|' is sent as a single stream over one connection (see
+--			Batch.cpp). In session mode the connection is kept for the next transfer, and each transfer waits for the
+--			server's acknowledgement before it's reported (see Session.cpp). The server's name is looked up in the background and the connection
+--			raced across its IPv4 and IPv6 addresses by ConnectToServer (see Connect.cpp). Test packets are
+--			generated one by one from a seed and their sequence number (see Payload.cpp). After the data the client
+--			marks the end of the transfer and waits briefly for the server's totals (see Control.cpp). A UDP
+--			transfer first probes the path MTU, and may size its datagrams so they aren't fragmented (see Pmtu.cpp). In
+--			duplex mode the server sends test packets back while the client sends, and the client receives and checks
+--			them alongside its own sends (see Duplex.cpp). Sent to a multicast group, the transfer reaches every
+--			server that has joined it, and the end-of-stream exchange is replaced by a round of NACKs and repairs
+--			(see Multicast.cpp). Sends are paced by the host's scheduler, which may hold one back until it's the
+--			transfer's turn, and Stop Transfer can end the transfer early (see Sched.cpp). With -psk every chunk or
+--			test packet is encrypted and authenticated just before it's sent, after a key exchange (see Crypt.cpp).
+--			With -trace the sends, their completions and the file reads are recorded, and written out as a timeline
+--			before the transfer is reported (see Trace.cpp). With -replay the test packets take the sizes and timing
+--			of a recording the server made with -capture, instead of being sent back to back (see Capture.cpp).
 -------------------------------------------------------------------------------------------------------------------------*/
 
 #include "ClientTransfer.h"
 
-static DWORD	sent = 0;	// The number of bytes or packets sent
-static WSABUF	wsaBuf;		// A buffer containing the data to be sent
+static ULONGLONG		sent = 0;						// The number of bytes or packets sent
+static WSABUF			wsaBuf;							// A buffer containing the data to be sent
+static HANDLE			srcFile = INVALID_HANDLE_VALUE;	// The file being sent (if any)
+static ULONGLONG		qwFileSize = 0;					// Its size
+static ULONGLONG		qwNextOffset = 0;				// The file offset of the next chunk
+static DWORD			dwNextSeq = 0;					// The sequence number of the next chunk
+static BOOL				bEndSent = FALSE;				// Whether the CHUNK_END has been built
+static BYTE				*rawBuf = NULL;					// Holds a chunk's file data while it's compressed
+static LARGE_INTEGER	liPosted;						// When the last send was posted
+static ULONGLONG		qwFileId = 0;					// The file's last write time
+static Manifest			peer;							// The chunks the server already has
+static DeltaScanner		scanner;						// Finds the blocks the server already has (delta transfers)
+static DedupOffer		offer;							// The file's chunks and which the server has (dedup transfers)
+static BatchSource		batchSrc;						// The files being sent (directory and multi-file transfers)
+static ULONGLONG		qwReplayOffset = 0;				// How much of the test stream a TCP replay has sent
 
 /*-------------------------------------------------------------------------------------------------------------------------
 -- FUNCTION: ClientInitSocket
@@ -48,68 +100,255 @@ static WSABUF	wsaBuf;		// A buffer containing the data to be sent
 --							LPTransferProps props:	Pointer to a TransferProps structure containing information about the
 --													packet size and number, server IP/host name, etc.
 --
--- RETURNS: False if the socket can't be created or the host name can't be resovled; true otherwise.
+-- RETURNS: False if there's no server to send to; true otherwise.
 --
 -- NOTES:
--- Preps a socket for sending. Resolves the host name if there is one and creates the socket, storing it in props->socket.
--- If the socket can't be created, props->socket is set to INVALID_SOCKET.
+-- Preps for sending. This runs on the window's thread, so it only starts looking up the host name (if there is one);
+-- the lookup and the connection are finished by ConnectToServer on the transfer thread. props->socket is
+-- INVALID_SOCKET until then.
 ---------------------------------------------------------------------------------------------------------------------------*/
 BOOL ClientInitSocket(LPTransferProps props)
 {
+	memset(&props->connect, 0, sizeof(ConnectState));
+	QueryPerformanceCounter(&props->connect.liBegin);
+	InitControlState(&props->control);
+	props->socket = INVALID_SOCKET;
+
 	if (props->szHostName[0] != 0) // They specified a host name
 	{
-		struct hostent *hp;
-		char		   name[HOSTNAME_SIZE];
+		StartResolve(props->szHostName);
+		return TRUE;
+	}
+
+	if (props->nAddrLen == 0)
+	{
+		MessageBox(NULL, TEXT("No IP address or host name entered. Check connection settings."), TEXT("No Destination"),
+			MB_ICONERROR);
+		return FALSE;
+	}
+	return TRUE;
+}
 
-		TCHAR_2_CHAR(name, props->szHostName, HOSTNAME_SIZE);
-		hp = gethostbyname(name);
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ConnectToServer
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ConnectToServer(LPTransferProps props)
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the host name couldn't be resolved or no connection could be made; TRUE otherwise.
+--
+-- NOTES:
+-- Waits for the host name to resolve (usually it already has; see Connect.cpp), then connects to whichever of its
+-- addresses answers first and stores the socket in props->socket and the address in props->addr. In session mode the
+-- last transfer's connection is used instead if it goes to one of those addresses and is still good.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL ConnectToServer(LPTransferProps props)
+{
+	ResolvedHost	host;
+	LARGE_INTEGER	liResolve;
+	DWORD			dwWinner;
+	DWORD			i;
 
-		if (hp == NULL)
+	if (props->szHostName[0] != 0)
+	{
+		props->connect.bNamed = TRUE;
+		QueryPerformanceCounter(&liResolve);
+		if (!ResolveHost(props->szHostName, &host, &props->connect.bCached, RESOLVE_TIMEOUT))
 		{
-			props->socket = INVALID_SOCKET;
-			switch (h_errno)
+			switch (host.nError)
 			{
-			case HOST_NOT_FOUND:
+			case WSAHOST_NOT_FOUND:
 				MessageBoxPrintf(MB_ICONERROR, TEXT("Host Not Found"),
 					TEXT("Could not find host %s. Check connection settings."), props->szHostName);
 				return FALSE;
-			case TRY_AGAIN:
+			case WSATRY_AGAIN:
+			case WSAETIMEDOUT:
 				MessageBoxPrintf(MB_ICONERROR, TEXT("Try Again"), TEXT("Unable to connect. Try again later."));
 				return FALSE;
-			case NO_RECOVERY:
+			case WSANO_RECOVERY:
 				MessageBoxPrintf(MB_ICONERROR, TEXT("DNS Error"), TEXT("DNS error. Try again later."));
 				return FALSE;
-			case NO_ADDRESS:
+			case WSANO_DATA:
 				MessageBoxPrintf(MB_ICONERROR, TEXT("No IP"), TEXT("No IP address for host %s. Check connection settings."),
 					props->szHostName);
 				return FALSE;
 			default:
-				MessageBoxPrintf(MB_ICONERROR, TEXT("Unknown Error"), TEXT("Unkown error %d."), h_errno);
+				MessageBoxPrintf(MB_ICONERROR, TEXT("Unknown Error"), TEXT("Unkown error %d."), host.nError);
 				return FALSE;
 			}
 		}
-		props->paddr_in->sin_addr.s_addr = (ULONG)hp->h_addr_list[0];
+		props->connect.dwResolveUs = ElapsedUs(&liResolve);
+	}
+	else
+	{
+		host.nError = 0;
+		host.dwAddrs = 1;
+		host.addrs[0] = props->addr;
+		host.lens[0] = props->nAddrLen;
 	}
-	
-	if (props->paddr_in->sin_addr.s_addr != 0)
+
+	props->connect.dwAddrs = host.dwAddrs;
+	for (i = 0; i < host.dwAddrs; i++)
+		SetAddressPort(&host.addrs[i], props->usPort);
+
+	// A session keeps the last transfer's connection; use it again if it's still good
+	if (props->nSockType == SOCK_STREAM && props->session.bEnabled && ReuseSession(&props->session, &host))
 	{
-		SOCKET s;
-		if ((s = WSASocket(PF_INET, props->nSockType, 0, NULL, NULL, WSA_FLAG_OVERLAPPED)) < 0)
-		{
+		props->socket = props->session.conn;
+		props->addr = props->session.peer;
+		props->nAddrLen = props->addr.ss_family == AF_INET6 ? sizeof(SOCKADDR_IN6) : sizeof(SOCKADDR_IN);
+		props->connect.nFamily = props->addr.ss_family;
+		FormatAddress(&props->addr, props->connect.szPeer, sizeof(props->connect.szPeer));
+		return TRUE;
+	}
+	CloseSession(&props->session);
+
+	if (!ConnectFirst(&host, props->nSockType, &props->tuning, &props->socket, &dwWinner, &props->connect))
+	{
+		props->socket = INVALID_SOCKET;
+		if (props->nSockType == SOCK_STREAM)
+			MessageBox(NULL, TEXT("Could not connect. Check settings and try again."),
+				TEXT("Could not connect to socket"), MB_ICONERROR);
+		else
 			MessageBox(NULL, TEXT("Could not create socket."), TEXT("No Socket"), MB_ICONERROR);
-			props->socket = INVALID_SOCKET;
-			return FALSE;
-		}
+		return FALSE;
+	}
+
+	props->addr = host.addrs[dwWinner];
+	props->nAddrLen = host.lens[dwWinner];
+	if (props->nSockType == SOCK_STREAM && props->session.bEnabled)
+		StartSession(&props->session, props->socket, &props->addr, props->connect.dwConnectUs);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SizeToPathMtu
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SizeToPathMtu(LPWSABUF pwsaBuf, LPTransferProps props)
+--							LPWSABUF pwsaBuf:		The send buffer, holding the first test packet.
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the test packet buffer couldn't be rebuilt; TRUE otherwise.
+--
+-- NOTES:
+-- Probes the path MTU (see Pmtu.cpp) unless -pmtu off was given. With -pmtu auto, or "Path MTU" as the packet size,
+-- the datagrams are then shrunk to the largest that goes unfragmented. A file's chunks get smaller. Test packets
+-- chosen as "Path MTU" keep their number; ones fitted from a bigger size keep the number of bytes sent. If the server
+-- doesn't answer the probes the datagrams are fitted to PMTU_BASE, which every path is assumed to carry. Room is left
+-- for what -psk adds to each datagram.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL SizeToPathMtu(LPWSABUF pwsaBuf, LPTransferProps props)
+{
+	LPPmtuState	pmtu = &props->pmtu;
+	ULONGLONG	qwBytes;
+	DWORD		dwPayload;
+
+	pmtu->dwProbes = 0;
+	pmtu->bFit = FALSE;
+	if (pmtu->dwMode == PMTU_OFF && !pmtu->bPathSize)
+		return TRUE;
+
+	// Probes to a group would be answered by every receiver, or by none
+	if (!props->multicast.bActive && DiscoverPathMtu(props->socket, &props->addr, props->nAddrLen, pmtu))
+		dwPayload = pmtu->dwPayload;
+	else
+		dwPayload = PMTU_BASE - PMTU_UDP_HDR - (props->addr.ss_family == AF_INET6 ? PMTU_IPV6_HDR : PMTU_IPV4_HDR);
+	if ((pmtu->dwMode != PMTU_AUTO && !pmtu->bPathSize) || props->replay.bActive)
+		return TRUE; // A replay's datagrams are the sizes that were recorded
+	pmtu->bFit = TRUE;
 
-		props->socket = s;
+	// Sealing hasn't started yet, but it will add its trailer to every datagram
+	if (props->crypt.bEnabled)
+		dwPayload -= props->szFileName[0] != 0 ? CHUNK_SEALSIZE : CRYPT_TRAILER;
+
+	if (props->szFileName[0] != 0)
+	{
+		pmtu->dwRequested = sizeof(ChunkHeader) + props->nPacketSize;
+		props->nPacketSize = min(props->nPacketSize, dwPayload - (DWORD)sizeof(ChunkHeader));
+		props->nNumToSend = (DWORD)((qwFileSize + props->nPacketSize - 1) / props->nPacketSize);
 		return TRUE;
 	}
+
+	if (pmtu->bPathSize)
+		pmtu->dwRequested = 0;
 	else
 	{
-		MessageBox(NULL, TEXT("No IP address or host name entered. Check connection settings."), TEXT("No Destination"),
-			MB_ICONERROR);
-		return FALSE;
+		pmtu->dwRequested = props->nPacketSize;
+		if (props->nPacketSize <= dwPayload)
+			return TRUE;
+		qwBytes = (ULONGLONG)props->nPacketSize * props->nNumToSend;
+		props->nNumToSend = (DWORD)((qwBytes + dwPayload - 1) / dwPayload);
 	}
+	props->nPacketSize = dwPayload;
+
+	PoolFree(pwsaBuf->buf);
+	pwsaBuf->buf = NULL;
+	return PopulateBuffer(pwsaBuf, props);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ResumeSend
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ResumeSend(VOID *ctx)
+--							VOID *ctx:	The client's transfer properties.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Posts the send the scheduler held back in a completion routine (see Sched.cpp), unless the transfer has ended since.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID ResumeSend(VOID *ctx)
+{
+	LPTransferProps props = (LPTransferProps)ctx;
+
+	if (props->dwTimeout == 0)
+		return;
+	if (props->nSockType == SOCK_DGRAM)
+		WSASendTo(props->socket, &wsaBuf, 1, NULL, 0, (sockaddr *)&props->addr, props->nAddrLen, (LPOVERLAPPED)props,
+			PollPost(props, UDPSendCompletion));
+	else
+		WSASend(props->socket, &wsaBuf, 1, NULL, 0, (LPOVERLAPPED)props, PollPost(props, TCPSendCompletion));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReplayResume
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReplayResume(VOID *ctx)
+--							VOID *ctx:	The client's transfer properties.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Posts a replay's send once it's due (see Capture.cpp), unless the scheduler holds it back further.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID ReplayResume(VOID *ctx)
+{
+	LPTransferProps props = (LPTransferProps)ctx;
+
+	if (!SchedPace(&props->sched, wsaBuf.len))
+		ResumeSend(props);
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------
@@ -127,24 +366,47 @@ BOOL ClientInitSocket(LPTransferProps props)
 --			allocated. Returns 0 on successful sending. 
 --
 -- NOTES:
--- Sends either a chosen file (if there is one) or a specified number of packets of the specified size.
+-- Sends either a chosen file (if there is one) or a specified number of packets of the specified size, then collects
+-- the server's totals for the report. A duplex transfer receives the server's packets too, and waits for the last of
+-- them before the end of the transfer is exchanged. A multicast transfer repairs what its receivers missed instead.
+-- A transfer stopped by the user skips the session acknowledgement and the repairs. With -busypoll the thread spins on
+-- its sends instead of sleeping between them (see BusyPoll.cpp). A replay can't go to a multicast group, whose repairs
+-- are rebuilt at the transfer's one packet size.
 ---------------------------------------------------------------------------------------------------------------------------*/
 DWORD WINAPI ClientSendData(VOID *params)
 {
 	HWND			hwnd		= (HWND)params;
 	LPTransferProps props		= (LPTransferProps)GetWindowLongPtr(hwnd, GWLP_TRANSFERPROPS);
-	BOOL			set			= TRUE;
 	SOCKET			s			= props->socket;
-	DWORD			dwFileSize	= 0;
 	DWORD			sleepRet;
+	DWORD			dwSize		= props->nPacketSize;
+	DWORD			dwCount		= props->nNumToSend;
 	const char		*logFile	= "SendLog.txt";
 
-	if (!PopulateBuffer(&wsaBuf, props, &dwFileSize))
+	BeginPolling(props);
+	if (!PrepareDuplex(props) || !PopulateBuffer(&wsaBuf, props) || !ConnectToServer(props) ||
+		!PrepareMulticast(props))
+	{
+		ClientCleanup(props);
+		return 1;
+	}
+
+	if (props->replay.bActive && props->multicast.bActive)
 	{
+		MessageBox(NULL, TEXT("A recording can't be replayed to a multicast group."), TEXT("Can't Replay"), MB_ICONERROR);
 		ClientCleanup(props);
 		return 1;
 	}
 
+	SchedJoin(&props->sched, ResumeSend, props);
+	PlaceTransfer(props);
+
+	if (props->nSockType == SOCK_DGRAM && !SizeToPathMtu(&wsaBuf, props))
+	{
+		ClientCleanup(props);
+		return 4;
+	}
+
 	if (props->nSockType == SOCK_STREAM && !TCPSendFirst(props))
 	{
 		ClientCleanup(props);
@@ -156,9 +418,15 @@ DWORD WINAPI ClientSendData(VOID *params)
 		return 3;
 	}
 
+	if (props->duplex.bActive && !StartDuplexReceive(props))
+	{
+		ClientCleanup(props);
+		return 5;
+	}
+
 	while (props->dwTimeout)
 	{
-		sleepRet = SleepEx(COMM_TIMEOUT, TRUE);
+		sleepRet = WaitForTransfer(props, COMM_TIMEOUT);
 
 		if (sleepRet != WAIT_IO_COMPLETION)
 		{
@@ -166,14 +434,97 @@ DWORD WINAPI ClientSendData(VOID *params)
 			props->dwTimeout = 0;
 		}
 	}
+	FinishDuplex(&props->duplex);
 
-	if (props->szFileName[0] == 0) // We didn't use a file, so log the stats
-		LogTransferInfo(logFile, props, sent, hwnd);
-	
+	// A stopped transfer has left the session's stream out of step (its connection is dropped), and has no use for
+	// repairs
+	if (props->nSockType == SOCK_STREAM && props->session.bEnabled)
+	{
+		if (!props->sched.bStopped)
+		{
+			RecvSessionAck(props->socket, &props->session, COMM_TIMEOUT);
+			EndSessionTransfer(&props->session, sent, props->tuning.dwRttUs);
+		}
+	}
+	else if (props->multicast.bActive)
+	{
+		if (!props->sched.bStopped)
+			RunMulticastRepair(props, props->szFileName[0] != 0 ? dwNextSeq + 1 : props->nNumToSend, &wsaBuf,
+				BuildRepair);
+	}
+	else
+		ExchangeEndOfStream(props, sent);
+
+	StopPollStats(&props->poll);
+	StopCoreSample(&props->affinity);
+	ExportTrace(&props->trace);
+	LogTransferInfo(logFile, props, sent, hwnd);
+
+	// Fitting to the path is redone for each transfer, so the dialog keeps what was chosen
+	if (props->szFileName[0] == 0)
+	{
+		props->nPacketSize = dwSize;
+		props->nNumToSend = dwCount;
+	}
 	ClientCleanup(props);
 	return 0;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendFileQuery
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendFileQuery(LPTransferProps props)
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the exchange failed; TRUE otherwise.
+--
+-- NOTES:
+-- Every TCP file transfer opens with one exchange with the server: a multi-file transfer announces itself, a delta
+-- transfer asks for signatures, a dedup transfer offers its chunk hashes, and anything else asks what can be resumed.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL SendFileQuery(LPTransferProps props)
+{
+	if (batchSrc.bActive)
+		return BatchQuery(props);
+	if (props->delta.bEnabled)
+		return DeltaQuery(props);
+	if (props->dedup.bEnabled)
+		return DedupQuery(props);
+	return ResumeQuery(props);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SealNextSend
+-- October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SealNextSend(LPTransferProps props)
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Encrypts the chunk or test packet in wsaBuf if the transfer has a key (see Crypt.cpp). This is the last thing done
+-- to a send, so the compressor, the CRC and the payload generator never see ciphertext.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID SealNextSend(LPTransferProps props)
+{
+	if (!props->crypt.bActive)
+		return;
+	if (props->szFileName[0] != 0)
+		SealChunk(&props->crypt, &wsaBuf);
+	else
+		SealPacket(&props->crypt, &wsaBuf, props->nPacketSize);
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------
 -- FUNCTION: ClientSendData
 -- Febrary 1st, 2014
@@ -193,28 +544,40 @@ DWORD WINAPI ClientSendData(VOID *params)
 ---------------------------------------------------------------------------------------------------------------------------*/
 BOOL TCPSendFirst(LPTransferProps props)
 {
-	DWORD error;
-	DWORD firstSent;
+	DWORD			error;
+	DWORD			firstSent;
 
-	WSAConnect(props->socket, (sockaddr *)props->paddr_in, sizeof(sockaddr), NULL, NULL, NULL, NULL);
 	GetSystemTime(&props->startTime);
-	error = WSAGetLastError();
 
-	if (error)
+	// The handshake time is the RTT estimate of last resort if the stack won't report its own; a reused session
+	// connection has no handshake to go on
+	AutoTuneSocket(props->socket, &props->tuning, SOCK_STREAM, props->session.bReused ? 0 : props->connect.dwConnectUs);
+
+	if (props->session.bEnabled && !SendSessionHeader(props->socket, &props->session,
+		props->szFileName[0] != 0 ? 0 : (ULONGLONG)props->nPacketSize * props->nNumToSend))
 	{
-		MessageBox(NULL, TEXT("Could not connect. Check settings and try again."),
-			TEXT("Could not connect to socket"), MB_ICONERROR);
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Session Failed"), TEXT("Couldn't start the transfer; error %d"),
+			WSAGetLastError());
 		return FALSE;
 	}
-	else
+
+	if (props->crypt.bEnabled && !SendCryptHello(props))
+		return FALSE;
+
+	if (props->szFileName[0] != 0 && (!SendFileQuery(props) || !BuildNextChunk(&wsaBuf, props)))
+		return FALSE;
+
+	props->connect.dwTtfbUs = ElapsedUs(&props->connect.liBegin);
+	QueryPerformanceCounter(&liPosted);
+	StampDuplexPacket(&props->duplex, (BYTE *)wsaBuf.buf, wsaBuf.len);
+	SealNextSend(props);
+	ReplayPace(&props->replay); // Starts a replay's clock; the first send is never held
+	WSASend(props->socket, &wsaBuf, 1, &firstSent, 0, (LPOVERLAPPED)props, PollPost(props, TCPSendCompletion));
+	error = WSAGetLastError();
+	if (error && error != WSA_IO_PENDING)
 	{
-		WSASend(props->socket, &wsaBuf, 1, &firstSent, 0, (LPOVERLAPPED)props, TCPSendCompletion);
-		error = WSAGetLastError();
-		if (error && error != WSA_IO_PENDING)
-		{
-			MessageBoxPrintf(MB_ICONERROR, TEXT("WSASend() Failed"), TEXT("WSASend failed with error %d"), error);
-			return FALSE;
-		}
+		MessageBoxPrintf(MB_ICONERROR, TEXT("WSASend() Failed"), TEXT("WSASend failed with error %d"), error);
+		return FALSE;
 	}
 	return TRUE;
 }
@@ -241,9 +604,22 @@ BOOL UDPSendFirst(LPTransferProps props)
 	DWORD firstSent;
 	DWORD error;
 
-	setsockopt(props->socket, SOL_SOCKET, SO_SNDBUF, wsaBuf.buf, props->nPacketSize);
+	AutoTuneSocket(props->socket, &props->tuning, SOCK_DGRAM, 0);
+
+	if (props->crypt.bEnabled && !SendCryptHello(props))
+		return FALSE;
+
+	if (props->szFileName[0] != 0 && !BuildNextChunk(&wsaBuf, props))
+		return FALSE;
+
 	GetSystemTime(&props->startTime);
-	WSASendTo(props->socket, &wsaBuf, 1, &firstSent, 0, (sockaddr *)props->paddr_in, sizeof(sockaddr), (LPOVERLAPPED)props, UDPSendCompletion);
+	props->connect.dwTtfbUs = ElapsedUs(&props->connect.liBegin);
+	QueryPerformanceCounter(&liPosted);
+	StampDuplexPacket(&props->duplex, (BYTE *)wsaBuf.buf, wsaBuf.len);
+	SealNextSend(props);
+	ReplayPace(&props->replay); // Starts a replay's clock; the first send is never held
+	WSASendTo(props->socket, &wsaBuf, 1, &firstSent, 0, (sockaddr *)&props->addr, props->nAddrLen, (LPOVERLAPPED)props,
+		PollPost(props, UDPSendCompletion));
 	error = WSAGetLastError();
 
 	if (error && error != WSA_IO_PENDING)
@@ -256,6 +632,115 @@ BOOL UDPSendFirst(LPTransferProps props)
 	return TRUE;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BuildReplaySend
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BuildReplaySend(LPWSABUF pwsaBuf, LPTransferProps props)
+--							LPWSABUF pwsaBuf:		The send buffer (see PopulateReplay for its size).
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE once the whole recording has been sent; TRUE if pwsaBuf holds the next send.
+--
+-- NOTES:
+-- Over UDP each recorded arrival is one test packet of its size, numbered by its place in the recording; a size too
+-- small for the packet header or too big for a datagram is sent at the nearest one that fits. Over TCP the stream is
+-- still made of packets of the chosen size, so the server checks it as usual, and each send is the next piece of it:
+-- the packets it touches are built whole and the piece moved down to the start of the buffer. The last send runs to
+-- the end of the last packet.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL BuildReplaySend(LPWSABUF pwsaBuf, LPTransferProps props)
+{
+	LPReplayState	r = &props->replay;
+	DWORD			dwLen, dwFirst, dwSeq;
+	ULONGLONG		qwEnd, qwTotal;
+	BYTE			*packet;
+
+	if ((dwLen = NextReplaySize(r)) == 0)
+		return FALSE;
+
+	if (props->nSockType == SOCK_DGRAM)
+	{
+		if (dwLen < sizeof(PayloadHeader) || dwLen > REPLAY_MAX_DATAGRAM)
+		{
+			dwLen = min(max(dwLen, (DWORD)sizeof(PayloadHeader)), (DWORD)REPLAY_MAX_DATAGRAM);
+			r->dwResized++;
+		}
+		((DWORD *)pwsaBuf->buf)[0] = props->nNumToSend;
+		((DWORD *)pwsaBuf->buf)[1] = dwLen;
+		BuildPayload((BYTE *)pwsaBuf->buf, dwLen, r->dwNext - 1, &props->payload);
+		pwsaBuf->len = dwLen;
+		return TRUE;
+	}
+
+	qwTotal = (ULONGLONG)props->nPacketSize * props->nNumToSend;
+	qwEnd = r->dwNext == r->dwCount ? qwTotal : min(qwReplayOffset + dwLen, qwTotal);
+	dwFirst = (DWORD)(qwReplayOffset / props->nPacketSize);
+	for (dwSeq = dwFirst; (ULONGLONG)dwSeq * props->nPacketSize < qwEnd; dwSeq++)
+	{
+		packet = (BYTE *)pwsaBuf->buf + (dwSeq - dwFirst) * props->nPacketSize;
+		((DWORD *)packet)[0] = props->nNumToSend;
+		((DWORD *)packet)[1] = props->nPacketSize;
+		BuildPayload(packet, props->nPacketSize, dwSeq, &props->payload);
+	}
+	pwsaBuf->len = (DWORD)(qwEnd - qwReplayOffset);
+	memmove(pwsaBuf->buf, pwsaBuf->buf + qwReplayOffset % props->nPacketSize, pwsaBuf->len);
+	qwReplayOffset = qwEnd;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PrepareNextSend
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PrepareNextSend(LPTransferProps props, DWORD dwLastSent)
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--							DWORD dwLastSent:		The number of bytes in the send that just completed.
+--
+-- RETURNS: FALSE if there's nothing left to send; TRUE if wsaBuf holds the next send.
+--
+-- NOTES:
+-- Test packets reuse the same buffer, so there's only the count to check; a replay builds its next send from the
+-- recording instead. For files the completed send is timed to keep the compressor's estimate of the link rate
+-- current, and the next chunk is built. Either is then sealed if the transfer is encrypted.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL PrepareNextSend(LPTransferProps props, DWORD dwLastSent)
+{
+	LARGE_INTEGER liNow;
+
+	// Each test packet is generated afresh from its sequence number so the server can check it
+	if (props->szFileName[0] == 0)
+	{
+		if (props->replay.bActive)
+			return BuildReplaySend(&wsaBuf, props);
+		if (sent / props->nPacketSize >= props->nNumToSend)
+			return FALSE;
+		BuildPayload((BYTE *)wsaBuf.buf, props->nPacketSize, (DWORD)(sent / props->nPacketSize), &props->payload);
+		StampDuplexPacket(&props->duplex, (BYTE *)wsaBuf.buf, props->nPacketSize);
+		SealNextSend(props);
+		return TRUE;
+	}
+
+	QueryPerformanceCounter(&liNow);
+	RecordSendRate(&props->compress, dwLastSent, liNow.QuadPart - liPosted.QuadPart);
+
+	if (!BuildNextChunk(&wsaBuf, props))
+		return FALSE;
+	SealNextSend(props);
+
+	QueryPerformanceCounter(&liPosted);
+	return TRUE;
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------
 -- FUNCTION: UDPSendCompletion
 -- Febrary 2nd, 2014
@@ -283,6 +768,12 @@ VOID CALLBACK UDPSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfer
 {
 	LPTransferProps props = (LPTransferProps)lpOverlapped;
 
+	TraceEvent(TRACE_SEND_DONE, dwNumberOfBytesTransfered, wsaBuf.buf);
+
+	// The socket was closed under it at the end of the transfer; there's nothing to report
+	if (dwErrorCode == WSA_OPERATION_ABORTED)
+		return;
+	NoteCompletion(&props->poll);
 	if (dwErrorCode != 0)
 	{
 		MessageBoxPrintf(MB_ICONERROR, TEXT("WSASend error"), TEXT("WSASendTo encountered error %d"), dwErrorCode);
@@ -290,15 +781,24 @@ VOID CALLBACK UDPSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfer
 		return;
 	}
 
+	// What sealing added isn't counted, so the totals compare with a plaintext transfer
+	dwNumberOfBytesTransfered -= SealOverhead(&props->crypt, props->szFileName[0] != 0);
 	sent += dwNumberOfBytesTransfered;
-	if (sent / props->nPacketSize >= props->nNumToSend) // Finished sending
+	props->control.dwDatagrams++;
+	NoteDuplexSend(&props->duplex, dwNumberOfBytesTransfered);
+	if (!PrepareNextSend(props, dwNumberOfBytesTransfered)) // Finished sending
 	{
 		GetSystemTime(&props->endTime);
 		props->dwTimeout = 0;
 		return;
 	}
 
-	WSASendTo(props->socket, &wsaBuf, 1, NULL, 0, (sockaddr *)props->paddr_in, sizeof(sockaddr), (LPOVERLAPPED)props, UDPSendCompletion);
+	if (ReplayPace(&props->replay))
+		return; // Posted by ReplayResume when it's due
+	if (SchedPace(&props->sched, wsaBuf.len))
+		return; // The scheduler posts it when it's the transfer's turn
+	WSASendTo(props->socket, &wsaBuf, 1, NULL, 0, (sockaddr *)&props->addr, props->nAddrLen, (LPOVERLAPPED)props,
+		PollPost(props, UDPSendCompletion));
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------
@@ -328,22 +828,34 @@ VOID CALLBACK TCPSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfer
 {
 	LPTransferProps props	= (LPTransferProps)lpOverlapped;
 
+	TraceEvent(TRACE_SEND_DONE, dwNumberOfBytesTransfered, wsaBuf.buf);
+
+	// The socket was closed under it at the end of the transfer; there's nothing to report
+	if (dwErrorCode == WSA_OPERATION_ABORTED)
+		return;
+	NoteCompletion(&props->poll);
 	if (dwErrorCode != 0) // Something's gone wrong; display an error message and get out of there
 	{
 		MessageBoxPrintf(MB_ICONERROR, TEXT("WSASend() error"), TEXT("WSASend failed with socket error %d."), dwErrorCode);
 		props->dwTimeout = 0;
 		return;
 	}
+	dwNumberOfBytesTransfered -= SealOverhead(&props->crypt, props->szFileName[0] != 0);
 	sent += dwNumberOfBytesTransfered;
+	NoteDuplexSend(&props->duplex, dwNumberOfBytesTransfered);
 
-	if (sent / props->nPacketSize >= props->nNumToSend) // We're finished sending
+	if (!PrepareNextSend(props, dwNumberOfBytesTransfered)) // We're finished sending
 	{
 		props->dwTimeout = 0;
 		GetSystemTime(&props->endTime);
 		return;
 	}
 
-	WSASend(props->socket, &wsaBuf, 1, NULL, 0, (LPOVERLAPPED)props, TCPSendCompletion); // Post another send
+	if (ReplayPace(&props->replay))
+		return; // Posted by ReplayResume when it's due
+	if (SchedPace(&props->sched, wsaBuf.len))
+		return; // The scheduler posts it when it's the transfer's turn
+	WSASend(props->socket, &wsaBuf, 1, NULL, 0, (LPOVERLAPPED)props, PollPost(props, TCPSendCompletion)); // Post another send
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------
@@ -354,44 +866,560 @@ VOID CALLBACK TCPSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfer
 --
 -- PROGRAMMER: Shane Spoor
 --
--- INTERFACE: LoadFile(LPWSABUF wsaBuf, const TCHAR *szFileName, char **buf, LPDWORD lpdwFileSize, LPTransferProps)
---						LPWSABUF wsaBuf:		Pointer to a WSABUF structure which will contain the file in its buffer.
---						TCHAR *szFileName:		Name of the file to load.
---						LPDWORD lpdwFileSize:	Pointer to a DWORD which will hold the file size.
---						LPTransferProps props:	Pointer to the TransferProps structure containing information about the 
+-- INTERFACE: LoadFile(const TCHAR *szFileName, PULONGLONG lpqwFileSize, LPTransferProps)
+--						TCHAR *szFileName:			Name of the file to load.
+--						PULONGLONG lpqwFileSize:	Pointer to a ULONGLONG which will hold the file size.
+--						LPTransferProps props:		Pointer to the TransferProps structure containing information about the 
 -												current transfer.
 --
--- RETURNS: FALSE if the file couldn't be loaded; TRUE otherwise.
+-- RETURNS: FALSE if the file couldn't be opened; TRUE otherwise.
 --
 -- NOTES:
--- Loads the file into the buffer pointed to by buf, and assigns a pointer to that buffer to wsaBuf->buf. This will later
--- be iterated over to send the appropriate packets.
+-- Opens the file for sending and works out how many chunks it will take. The file is read a chunk at a time as it's
+-- sent (see BuildNextChunk) rather than all at once, so its size isn't limited by the address space.
 ---------------------------------------------------------------------------------------------------------------------------*/
-BOOL LoadFile(LPWSABUF wsaBuf, const TCHAR *szFileName, LPDWORD lpdwFileSize, LPTransferProps props)
+BOOL LoadFile(const TCHAR *szFileName, PULONGLONG lpqwFileSize, LPTransferProps props)
 {
-	DWORD dwFileSize;
-	HANDLE hFile;
-	DWORD dwRead;
-	hFile = CreateFile(props->szFileName, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER	liFileSize;
+	FILETIME		ftWrite;
+
+	srcFile = CreateFile(szFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
 
-	if (hFile == INVALID_HANDLE_VALUE)
+	if (srcFile == INVALID_HANDLE_VALUE)
 	{
 		MessageBoxPrintf(MB_ICONERROR, TEXT("Couldn't Open File"),
 			TEXT("Could not open file %s. Please check the spelling or select a different file. System Error: %d"), 
+			szFileName, GetLastError());
+		return FALSE;
+	}
+
+	GetFileSizeEx(srcFile, &liFileSize);
+	GetFileTime(srcFile, NULL, NULL, &ftWrite);
+	*lpqwFileSize = liFileSize.QuadPart;
+	qwFileId = ((ULONGLONG)ftWrite.dwHighDateTime << 32) | ftWrite.dwLowDateTime;
+
+	props->nPacketSize = (props->nSockType == SOCK_STREAM) ? FILE_CHUNKSIZE : FILE_PACKETSIZE;
+	props->nNumToSend = (DWORD)((liFileSize.QuadPart + props->nPacketSize - 1) / props->nPacketSize);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PackChunk
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PackChunk(LPWSABUF pwsaBuf, const BYTE *data, DWORD dwLen, BOOL bCompress, LPTransferProps props)
+--							LPWSABUF pwsaBuf:		The send buffer; its header has already been filled in.
+--							BYTE *data:				The file data, either in rawBuf or already in the payload.
+--							DWORD dwLen:			Its length.
+--							BOOL bCompress:			Whether to try compressing it.
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Takes the CRC while the data is still in the cache, then compresses it into the payload if asked to and if the
+-- result is actually smaller.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID PackChunk(LPWSABUF pwsaBuf, const BYTE *data, DWORD dwLen, BOOL bCompress, LPTransferProps props)
+{
+	LPChunkHeader	hdr			= (LPChunkHeader)pwsaBuf->buf;
+	BYTE			*payload	= (BYTE *)(hdr + 1);
+
+	hdr->dwLogicalLen	= dwLen;
+	hdr->dwCrc			= ChecksumChunk(&props->integrity, hdr->qwOffset, data, dwLen);
+	hdr->dwWireLen		= dwLen;
+
+	if (bCompress)
+	{
+		LARGE_INTEGER	liStart, liEnd;
+		DWORD			dwPacked;
+
+		// The compressor gives up as soon as its output can't be smaller
+		QueryPerformanceCounter(&liStart);
+		dwPacked = LZCompress(data, dwLen, payload, dwLen - 1);
+		QueryPerformanceCounter(&liEnd);
+		RecordCompression(&props->compress, dwLen, dwPacked, liEnd.QuadPart - liStart.QuadPart);
+
+		if (dwPacked != 0)
+		{
+			hdr->wFlags |= CHUNK_COMPRESSED;
+			hdr->dwWireLen = dwPacked;
+			props->compress.dwCompressed++;
+		}
+	}
+
+	if (!(hdr->wFlags & CHUNK_COMPRESSED) && data != payload)
+		memcpy(payload, data, dwLen);
+
+	pwsaBuf->len = sizeof(ChunkHeader) + hdr->dwWireLen;
+
+	props->compress.dwChunks++;
+	props->compress.qwLogicalBytes += dwLen;
+	props->compress.qwWireBytes += pwsaBuf->len;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BuildEndChunk
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BuildEndChunk(LPWSABUF pwsaBuf, LPTransferProps props)
+--							LPWSABUF pwsaBuf:		The send buffer to build the chunk in.
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the CHUNK_END has already been sent; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL BuildEndChunk(LPWSABUF pwsaBuf, LPTransferProps props)
+{
+	LPChunkHeader	hdr	= (LPChunkHeader)pwsaBuf->buf;
+	LPChunkEnd		end	= (LPChunkEnd)(hdr + 1);
+
+	if (bEndSent)
+		return FALSE;
+
+	InitChunkHeader(hdr, CHUNK_END, dwNextSeq, qwFileSize);
+	end->qwFileSize		= qwFileSize;
+	end->dwChunks		= dwNextSeq;
+	end->qwDigest		= props->integrity.qwDigest;
+	hdr->dwLogicalLen	= hdr->dwWireLen = sizeof(ChunkEnd);
+	pwsaBuf->len		= sizeof(ChunkHeader) + sizeof(ChunkEnd);
+	bEndSent = TRUE;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BuildDeltaChunk
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BuildDeltaChunk(LPWSABUF pwsaBuf, LPTransferProps props)
+--							LPWSABUF pwsaBuf:		The send buffer to build the chunk in.
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE once the CHUNK_END has been sent, or if the file can't be read; TRUE otherwise.
+--
+-- NOTES:
+-- Turns the scanner's next operation into a chunk: a block the server already has becomes a CHUNK_COPY carrying only
+-- its source offset, and anything else is sent as ordinary (possibly compressed) data.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL BuildDeltaChunk(LPWSABUF pwsaBuf, LPTransferProps props)
+{
+	LPChunkHeader	hdr	= (LPChunkHeader)pwsaBuf->buf;
+	DeltaOp			op;
+
+	if (!DeltaNext(&scanner, &op, &props->delta))
+	{
+		if (scanner.bError)
+		{
+			MessageBoxPrintf(MB_ICONERROR, TEXT("ReadFile Failed"), TEXT("Could not read %s, error %d"), props->szFileName,
+				GetLastError());
+			return FALSE;
+		}
+		return BuildEndChunk(pwsaBuf, props);
+	}
+
+	if (op.dwType == DELTA_COPY)
+	{
+		InitChunkHeader(hdr, CHUNK_COPY, dwNextSeq++, op.qwOffset);
+		((LPChunkCopy)(hdr + 1))->qwSrcOffset = op.qwSrcOffset;
+		hdr->dwLogicalLen	= op.dwLen;
+		hdr->dwWireLen		= sizeof(ChunkCopy);
+		hdr->dwCrc			= ChecksumChunk(&props->integrity, op.qwOffset, op.data, op.dwLen);
+		pwsaBuf->len		= sizeof(ChunkHeader) + sizeof(ChunkCopy);
+		return TRUE;
+	}
+
+	InitChunkHeader(hdr, CHUNK_DATA, dwNextSeq++, op.qwOffset);
+	PackChunk(pwsaBuf, op.data, op.dwLen, ShouldCompress(&props->compress), props);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BuildDedupChunk
+-- October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BuildDedupChunk(LPWSABUF pwsaBuf, LPTransferProps props)
+--							LPWSABUF pwsaBuf:		The send buffer to build the chunk in.
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE once the CHUNK_END has been sent, or if the file can't be read; TRUE otherwise.
+--
+-- NOTES:
+-- Sends the next of the file's content-defined chunks that the server doesn't have in its store, as an ordinary
+-- data chunk whose sequence number is its place in the offer. The chunks skipped still count toward the digest.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL BuildDedupChunk(LPWSABUF pwsaBuf, LPTransferProps props)
+{
+	LPChunkHeader	hdr			= (LPChunkHeader)pwsaBuf->buf;
+	BYTE			*data;
+	DWORD			dwLen;
+	DWORD			dwRead;
+	BOOL			bCompress;
+	BOOL			bSkipped	= FALSE;
+	LARGE_INTEGER	liOffset;
+
+	while (dwNextSeq < offer.dwChunks && IsChunkHeld(&offer, dwNextSeq))
+	{
+		FoldChunkDigest(&props->integrity, offer.offsets[dwNextSeq], offer.refs[dwNextSeq].dwLen,
+			offer.refs[dwNextSeq].dwCrc);
+		dwNextSeq++;
+		bSkipped = TRUE;
+	}
+
+	if (dwNextSeq >= offer.dwChunks)
+		return BuildEndChunk(pwsaBuf, props);
+
+	qwNextOffset = offer.offsets[dwNextSeq];
+	if (bSkipped)
+	{
+		liOffset.QuadPart = qwNextOffset;
+		SetFilePointerEx(srcFile, liOffset, NULL, FILE_BEGIN);
+	}
+
+	dwLen = offer.refs[dwNextSeq].dwLen;
+	bCompress = ShouldCompress(&props->compress);
+	data = bCompress ? rawBuf : (BYTE *)(hdr + 1);
+	if (!TraceReadFile(srcFile, data, dwLen, &dwRead) || dwRead != dwLen)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("ReadFile Failed"), TEXT("Could not read %s, error %d"), props->szFileName,
+			GetLastError());
+		return FALSE;
+	}
+
+	InitChunkHeader(hdr, CHUNK_DATA, dwNextSeq++, qwNextOffset);
+	PackChunk(pwsaBuf, data, dwLen, bCompress, props);
+	qwNextOffset += dwLen;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BuildNextChunk
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BuildNextChunk(LPWSABUF pwsaBuf, LPTransferProps props)
+--							LPWSABUF pwsaBuf:		The send buffer (CHUNK_BUFSIZE bytes) to build the chunk in.
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE once the CHUNK_END has been sent, or if the file can't be read; TRUE otherwise.
+--
+-- NOTES:
+-- Reads the next piece of the file into a chunk, compressing it if the compression policy says it's worth it. File
+-- data goes straight into the send buffer unless it's being compressed. Chunks the server said it already has are
+-- skipped. After the last data chunk comes the CHUNK_END, which carries the whole-file digest. Delta transfers take
+-- their chunks from the scanner instead (see BuildDeltaChunk), and dedup transfers from the chunks offered (see
+-- BuildDedupChunk). A directory or list of files is read as one stream (see Batch.cpp) and chunked the same way.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL BuildNextChunk(LPWSABUF pwsaBuf, LPTransferProps props)
+{
+	LPChunkHeader	hdr			= (LPChunkHeader)pwsaBuf->buf;
+	BYTE			*payload	= (BYTE *)(hdr + 1);
+	BYTE			*data;
+	DWORD			dwLen;
+	DWORD			dwRead;
+	BOOL			bCompress;
+	BOOL			bSkipped	= FALSE;
+	LARGE_INTEGER	liOffset;
+
+	if (scanner.bActive)
+		return BuildDeltaChunk(pwsaBuf, props);
+	if (offer.bActive)
+		return BuildDedupChunk(pwsaBuf, props);
+
+	// Chunks the server already has aren't sent, but they still count toward the digest
+	while (qwNextOffset < qwFileSize && IsChunkPresent(&peer, dwNextSeq))
+	{
+		dwLen = (DWORD)min((ULONGLONG)props->nPacketSize, qwFileSize - qwNextOffset);
+		FoldChunkDigest(&props->integrity, qwNextOffset, dwLen, peer.crcs[dwNextSeq]);
+		props->integrity.dwResumedChunks++;
+		qwNextOffset += dwLen;
+		dwNextSeq++;
+		bSkipped = TRUE;
+	}
+
+	if (bSkipped)
+	{
+		liOffset.QuadPart = qwNextOffset;
+		SetFilePointerEx(srcFile, liOffset, NULL, FILE_BEGIN);
+	}
+
+	if (qwNextOffset >= qwFileSize)
+		return BuildEndChunk(pwsaBuf, props);
+
+	dwLen = (DWORD)min((ULONGLONG)props->nPacketSize, qwFileSize - qwNextOffset);
+	bCompress = ShouldCompress(&props->compress);
+	data = bCompress ? rawBuf : payload;
+
+	if (batchSrc.bActive)
+	{
+		if (!ReadBatch(&batchSrc, data, dwLen, &props->batch))
+			return FALSE;
+	}
+	else if (!TraceReadFile(srcFile, data, dwLen, &dwRead) || dwRead != dwLen)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("ReadFile Failed"), TEXT("Could not read %s, error %d"), props->szFileName,
+			GetLastError());
+		return FALSE;
+	}
+
+	InitChunkHeader(hdr, CHUNK_DATA, dwNextSeq++, qwNextOffset);
+	PackChunk(pwsaBuf, data, dwLen, bCompress, props);
+	qwNextOffset += dwLen;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BuildRepair
+-- October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BuildRepair(LPWSABUF pwsaBuf, DWORD dwSeq, LPTransferProps props)
+--							LPWSABUF pwsaBuf:		The send buffer to build the datagram in.
+--							DWORD dwSeq:			The sequence number of the datagram to send again.
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the file can't be read; TRUE otherwise.
+--
+-- NOTES:
+-- Builds a datagram a multicast receiver asked for again (see Multicast.cpp). A test packet is generated again from
+-- its sequence number. A chunk is read again from the file and sent uncompressed; its CRC is taken afresh rather than
+-- folded into the digest a second time.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL BuildRepair(LPWSABUF pwsaBuf, DWORD dwSeq, LPTransferProps props)
+{
+	LPChunkHeader	hdr			= (LPChunkHeader)pwsaBuf->buf;
+	BYTE			*payload	= (BYTE *)(hdr + 1);
+	DWORD			dwLen;
+	DWORD			dwRead;
+	LARGE_INTEGER	liOffset;
+
+	if (props->szFileName[0] == 0)
+	{
+		BuildPayload((BYTE *)pwsaBuf->buf, props->nPacketSize, dwSeq, &props->payload);
+		pwsaBuf->len = props->nPacketSize;
+		return TRUE;
+	}
+
+	if (dwSeq == dwNextSeq)
+	{
+		bEndSent = FALSE;
+		return BuildEndChunk(pwsaBuf, props);
+	}
+
+	liOffset.QuadPart = (ULONGLONG)dwSeq * props->nPacketSize;
+	if (dwSeq > dwNextSeq || (ULONGLONG)liOffset.QuadPart >= qwFileSize)
+		return FALSE;
+	dwLen = (DWORD)min((ULONGLONG)props->nPacketSize, qwFileSize - liOffset.QuadPart);
+	if (!SetFilePointerEx(srcFile, liOffset, NULL, FILE_BEGIN) || !ReadFile(srcFile, payload, dwLen, &dwRead, NULL) ||
+		dwRead != dwLen)
+		return FALSE;
+
+	InitChunkHeader(hdr, CHUNK_DATA, dwSeq, liOffset.QuadPart);
+	hdr->dwLogicalLen	= hdr->dwWireLen = dwLen;
+	hdr->dwCrc			= Crc32c(0, payload, dwLen);
+	pwsaBuf->len		= sizeof(ChunkHeader) + dwLen;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ResumeQuery
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ResumeQuery(LPTransferProps props)
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the server didn't answer; TRUE otherwise.
+--
+-- NOTES:
+-- Tells the server which file is about to be sent and reads back the manifest of the chunks it already has from an
+-- earlier attempt. The exchange uses blocking calls with a timeout since the overlapped transfer hasn't started yet.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ResumeQuery(LPTransferProps props)
+{
+	ManifestHeader	query;
+	DWORD			dwTimeout	= COMM_TIMEOUT;
+	DWORD			dwNoTimeout	= 0;
+	BOOL			bOk;
+
+	InitManifestHeader(&query, qwFileSize, props->nPacketSize, qwFileId);
+
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+	bOk = SendAll(props->socket, (CHAR *)&query, sizeof(query)) && RecvManifest(props->socket, &peer, &query);
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+
+	if (!bOk)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Resume Query Failed"),
+			TEXT("The server didn't say which parts of the file it has; error %d"), WSAGetLastError());
+		FreeManifest(&peer);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DeltaQuery
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DeltaQuery(LPTransferProps props)
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the server didn't send its signatures; TRUE otherwise.
+--
+-- NOTES:
+-- Asks the server for the block signatures of its copy of the file (see Delta.cpp) in place of the resume query, then
+-- starts scanning the file against them.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL DeltaQuery(LPTransferProps props)
+{
+	ManifestHeader	query;
+	DWORD			dwTimeout	= COMM_TIMEOUT;
+	DWORD			dwNoTimeout	= 0;
+	BOOL			bOk;
+
+	InitManifestHeader(&query, qwFileSize, 0, qwFileId);
+	query.dwMagic = DELTA_MAGIC;
+
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+	bOk = SendAll(props->socket, (CHAR *)&query, sizeof(query)) &&
+		RecvSignatures(props->socket, &scanner, &props->delta);
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+
+	if (!bOk)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Delta Query Failed"),
+			TEXT("The server didn't send the signatures of its copy; error %d"), WSAGetLastError());
+		FreeDeltaScanner(&scanner);
+		return FALSE;
+	}
+
+	if (!StartDeltaScan(&scanner, srcFile, qwFileSize))
+	{
+		MessageBox(NULL, TEXT("Couldn't allocate the delta window."), TEXT("No Memory Allocated"), MB_ICONERROR);
+		FreeDeltaScanner(&scanner);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DedupQuery
+-- October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DedupQuery(LPTransferProps props)
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the file couldn't be chunked or the server didn't answer; TRUE otherwise.
+--
+-- NOTES:
+-- Cuts the file into content-defined chunks and offers their hashes to the server in place of the resume query (see
+-- Dedup.cpp). The server answers with the chunks it already has in its store, and only the rest are sent.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL DedupQuery(LPTransferProps props)
+{
+	ManifestHeader	query;
+	DWORD			dwTimeout	= COMM_TIMEOUT;
+	DWORD			dwNoTimeout	= 0;
+	BOOL			bOk;
+
+	if (!CutDedupChunks(&offer, srcFile, qwFileSize, &props->dedup))
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Dedup Query Failed"), TEXT("Could not read %s into chunks, error %d"),
 			props->szFileName, GetLastError());
+		FreeDedupOffer(&offer);
 		return FALSE;
 	}
 
-	dwFileSize = GetFileSize(hFile, NULL);
-	wsaBuf->buf = (CHAR *)malloc(dwFileSize);
-	ReadFile(hFile, wsaBuf->buf, dwFileSize, &dwRead, NULL);
-	wsaBuf->len = dwFileSize;
-	*lpdwFileSize = dwFileSize;
+	InitManifestHeader(&query, qwFileSize, DEDUP_AVGCHUNK, qwFileId);
+	query.dwMagic	= DEDUP_MAGIC;
+	query.dwChunks	= offer.dwChunks;
 
-	props->nNumToSend = dwFileSize / FILE_PACKETSIZE;
-	props->nPacketSize = FILE_PACKETSIZE;
-	CloseHandle(hFile);
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+	bOk = SendDedupOffer(props->socket, &offer, &query, &props->dedup) &&
+		RecvDedupReply(props->socket, &offer, &props->dedup);
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
 
+	if (!bOk)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Dedup Query Failed"),
+			TEXT("The server didn't say which chunks of the file it has; error %d"), WSAGetLastError());
+		FreeDedupOffer(&offer);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BatchQuery
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BatchQuery(LPTransferProps props)
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the server won't take a multi-file transfer; TRUE otherwise.
+--
+-- NOTES:
+-- Tells the server that a directory or list of files is coming rather than a single file, and waits for it to agree
+-- (it must have been given a directory to save to).
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL BatchQuery(LPTransferProps props)
+{
+	ManifestHeader	query;
+	ManifestHeader	reply;
+	DWORD			dwTimeout	= COMM_TIMEOUT;
+	DWORD			dwNoTimeout	= 0;
+	BOOL			bOk;
+
+	InitManifestHeader(&query, qwFileSize, props->nPacketSize, 0);
+	query.dwMagic = BATCH_MAGIC;
+
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+	bOk = SendAll(props->socket, (CHAR *)&query, sizeof(query)) && RecvAll(props->socket, (CHAR *)&reply, sizeof(reply)) &&
+		reply.dwMagic == BATCH_MAGIC;
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+
+	if (!bOk)
+	{
+		MessageBox(NULL, TEXT("The server won't accept several files; make sure it's saving to a directory."),
+			TEXT("Multi-File Transfer Refused"), MB_ICONERROR);
+		return FALSE;
+	}
 	return TRUE;
 }
 
@@ -414,7 +1442,8 @@ BOOL LoadFile(LPWSABUF wsaBuf, const TCHAR *szFileName, LPDWORD lpdwFileSize, LP
 ---------------------------------------------------------------------------------------------------------------------------*/
 CHAR *CreateBuffer(CHAR data, LPTransferProps props)
 {
-	CHAR *buf = (CHAR *)malloc(props->nPacketSize);
+	// A sealed packet's trailer goes on the end of it in the same buffer
+	CHAR *buf = (CHAR *)PoolAlloc(props->nPacketSize + (props->crypt.bEnabled ? CRYPT_TRAILER : 0));
 	if (buf == NULL)
 	{
 		MessageBoxPrintf(MB_ICONERROR, TEXT("No Memory Allocated"), TEXT("Windows couldn't allocate memory, error %d"), WSAGetLastError());
@@ -428,6 +1457,58 @@ CHAR *CreateBuffer(CHAR data, LPTransferProps props)
 	return buf;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PopulateReplay
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PopulateReplay(LPWSABUF pwsaBuf, LPTransferProps props)
+--							LPWSABUF pwsaBuf:		The WSA buffer to populate with the first send.
+--							LPTransferProps props:	Pointer to the TransferProps structure containing details about the transfer.
+--
+-- RETURNS: FALSE if the buffer couldn't be allocated; TRUE otherwise.
+--
+-- NOTES:
+-- Sets the transfer up to replay the recording loaded with -replay (see Capture.cpp). Over UDP there's a datagram for
+-- each recorded arrival, and the packet size reported is their average. Over TCP the packet size chosen is kept, and
+-- there are as many packets as the recording's bytes fill. The buffer has room for the largest send and the packets
+-- either side of it.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL PopulateReplay(LPWSABUF pwsaBuf, LPTransferProps props)
+{
+	LPReplayState	r = &props->replay;
+	DWORD			dwBufSize;
+
+	if (props->nSockType == SOCK_DGRAM)
+	{
+		props->nNumToSend = r->dwCount;
+		props->nPacketSize = max((DWORD)(r->qwBytes / r->dwCount), (DWORD)sizeof(PayloadHeader));
+		dwBufSize = REPLAY_MAX_DATAGRAM;
+	}
+	else
+	{
+		props->nNumToSend = (DWORD)((r->qwBytes + props->nPacketSize - 1) / props->nPacketSize);
+		dwBufSize = (r->dwMaxSize / props->nPacketSize + 4) * props->nPacketSize;
+	}
+
+	if ((pwsaBuf->buf = (CHAR *)PoolAlloc(dwBufSize)) == NULL)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("No Memory Allocated"), TEXT("Windows couldn't allocate memory, error %d"),
+			GetLastError());
+		return FALSE;
+	}
+	memset(pwsaBuf->buf, 'a', dwBufSize);
+
+	qwReplayOffset = 0;
+	StartPayload(&props->payload, props->nPacketSize);
+	StartReplay(r, ReplayResume, props);
+	return BuildReplaySend(pwsaBuf, props);
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------
 -- FUNCTION: PopulateBuffer
 -- Febrary 1st, 2014
@@ -436,29 +1517,74 @@ CHAR *CreateBuffer(CHAR data, LPTransferProps props)
 --
 -- PROGRAMMER: Shane Spoor
 --
--- INTERFACE: PopulateBuffer(LPWSABUF pwsaBuf, LPTransferProps props, LPDWORD lpdwFileSize)
+-- INTERFACE: PopulateBuffer(LPWSABUF pwsaBuf, LPTransferProps props)
 --							LPWSABUF wsaBuf:		The WSA buffer to populate with data.
 --							LPTransferProps props:	Pointer to the TransferProps structure containing details about the transfer.
---							LPDWORD dwFileSize:		Pointer to a DWORD to store the file size.
 --
 -- RETURNS: False if the one of the functions failed; true otherwise.
 --
 -- NOTES:
--- Populates the send buffer with either a file or random data.
+-- Populates the send buffer with the first test packet (see Payload.cpp) or the first send of a replay, or opens the
+-- file to be sent. The first chunk of a file is built once
+-- the connection is up (see TCPSendFirst), since over TCP the server may already have some of it.
 ---------------------------------------------------------------------------------------------------------------------------*/
-BOOL PopulateBuffer(LPWSABUF pwsaBuf, LPTransferProps props, LPDWORD lpdwFileSize)
+BOOL PopulateBuffer(LPWSABUF pwsaBuf, LPTransferProps props)
 {
 	if (props->szFileName[0] != 0)
 	{
-		props->nPacketSize = FILE_PACKETSIZE;
-		if (!LoadFile(pwsaBuf, props->szFileName, lpdwFileSize, props))
+		if (IsBatchPath(props->szFileName))
+		{
+			if (props->nSockType != SOCK_STREAM)
+			{
+				MessageBox(NULL, TEXT("Directories and lists of files can only be sent over TCP."),
+					TEXT("Can't Send Files"), MB_ICONERROR);
+				return FALSE;
+			}
+			if (!LoadBatch(&batchSrc, props->szFileName, &props->batch))
+				return FALSE;
+
+			qwFileSize = batchSrc.qwTotal;
+			qwFileId = 0;
+			props->nPacketSize = FILE_CHUNKSIZE;
+			props->nNumToSend = (DWORD)((qwFileSize + FILE_CHUNKSIZE - 1) / FILE_CHUNKSIZE);
+		}
+		else
+		{
+			FreeBatchSource(&batchSrc);
+			memset(&props->batch, 0, sizeof(BatchState));
+			if (!LoadFile(props->szFileName, &qwFileSize, props))
+				return FALSE;
+		}
+
+		pwsaBuf->buf = (CHAR *)PoolAlloc(CHUNK_BUFSIZE);
+		rawBuf = (BYTE *)PoolAlloc(CHUNK_MAXPAYLOAD);
+		if (pwsaBuf->buf == NULL || rawBuf == NULL)
+		{
+			MessageBox(NULL, TEXT("Couldn't allocate the chunk buffers."), TEXT("No Memory Allocated"), MB_ICONERROR);
 			return FALSE;
+		}
+
+		qwNextOffset = 0;
+		dwNextSeq = 0;
+		bEndSent = FALSE;
+		InitCompressState(&props->compress, props->tuning.dwLinkMbps);
+		InitIntegrityState(&props->integrity);
+		InitDeltaState(&props->delta);
+		InitDedupState(&props->dedup);
+		FreeManifest(&peer);
+		FreeDeltaScanner(&scanner);
+		FreeDedupOffer(&offer);
 	}
+	else if (props->replay.dwCount != 0)
+		return PopulateReplay(pwsaBuf, props);
 	else
 	{
 		if ((pwsaBuf->buf = CreateBuffer('a', props)) == NULL)
 			return FALSE;
 
+		StartPayload(&props->payload, props->nPacketSize);
+		BuildPayload((BYTE *)pwsaBuf->buf, props->nPacketSize, 0, &props->payload);
+
 		pwsaBuf->len = props->nPacketSize;
 	}
 	return TRUE;
@@ -483,11 +1609,37 @@ BOOL PopulateBuffer(LPWSABUF pwsaBuf, LPTransferProps props, LPDWORD lpdwFileSiz
 VOID ClientCleanup(LPTransferProps props)
 {
 	DWORD error;
-	free(wsaBuf.buf);
-	closesocket(props->socket);
+	PoolFree(wsaBuf.buf);
+	PoolFree(rawBuf);
+	FreeManifest(&peer);
+	FreeDeltaScanner(&scanner);
+	FreeDedupOffer(&offer);
+	FreeBatchSource(&batchSrc);
+	FreeDuplex(&props->duplex);
+	ResetMulticast(&props->multicast);
+	SchedLeave(&props->sched);
+	EndPolling(props);
+	UnplaceTransfer(props);
+	EndCrypt(&props->crypt);
+	EndReplay(&props->replay);
+	wsaBuf.buf = NULL;
+	rawBuf = NULL;
+	if (srcFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(srcFile);
+		srcFile = INVALID_HANDLE_VALUE;
+	}
+
+	// A transfer that didn't finish leaves the stream out of step, so its connection can't carry another
+	if (props->session.conn == props->socket && !props->session.bFinished)
+		props->session.conn = INVALID_SOCKET;
+	if (props->socket != props->session.conn)
+		closesocket(props->socket);
 	error = WSAGetLastError();
 	memset(&props->startTime, 0, sizeof(SYSTEMTIME));
 	memset(&props->endTime, 0, sizeof(SYSTEMTIME));
 	props->dwTimeout = COMM_TIMEOUT;
 	sent = 0;
+	qwReplayOffset = 0;
+	PoolFlushThread();
 }
@@ -9,8 +9,31 @@
 #include <time.h>
 #include "WinStorage.h"
 #include "Utils.h"
+#include "SocketTuning.h"
+#include "Compress.h"
+#include "Chunk.h"
+#include "Checksum.h"
+#include "Manifest.h"
+#include "Delta.h"
+#include "Dedup.h"
+#include "Batch.h"
+#include "Session.h"
+#include "Connect.h"
+#include "Payload.h"
+#include "Control.h"
+#include "Pmtu.h"
+#include "Duplex.h"
+#include "Multicast.h"
+#include "Pool.h"
+#include "Sched.h"
+#include "BusyPoll.h"
+#include "Affinity.h"
+#include "Crypt.h"
+#include "Trace.h"
+#include "Capture.h"
 
-#define FILE_PACKETSIZE 4096
+#define FILE_PACKETSIZE 4096		// Logical bytes per file chunk over UDP (one chunk per datagram)
+#define FILE_CHUNKSIZE	32768		// Logical bytes per file chunk over TCP
 
 #ifndef COMM_TIMEOUT
 	#define COMM_TIMEOUT 5000	// Time to wait before giving up
@@ -24,9 +47,15 @@ VOID CALLBACK UDPSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfer
 	LPOVERLAPPED lpOverlapped, DWORD dwFlags);
 VOID CALLBACK TCPSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered, 
 	LPOVERLAPPED lpOverlapped, DWORD dwFlags);
-BOOL LoadFile(LPWSABUF wsaBuf, const TCHAR *szFileName, LPDWORD lpdwFileSize, LPTransferProps props);
+BOOL LoadFile(const TCHAR *szFileName, PULONGLONG lpqwFileSize, LPTransferProps props);
 CHAR *CreateBuffer(CHAR data, LPTransferProps props);
-BOOL PopulateBuffer(LPWSABUF pwsaBuf, LPTransferProps props, LPDWORD lpdwFileSize);
+BOOL PopulateBuffer(LPWSABUF pwsaBuf, LPTransferProps props);
+BOOL BuildNextChunk(LPWSABUF pwsaBuf, LPTransferProps props);
+BOOL BuildRepair(LPWSABUF pwsaBuf, DWORD dwSeq, LPTransferProps props);
+BOOL ResumeQuery(LPTransferProps props);
+BOOL DeltaQuery(LPTransferProps props);
+BOOL DedupQuery(LPTransferProps props);
+BOOL BatchQuery(LPTransferProps props);
 VOID ClientCleanup(LPTransferProps props);
 
 #endif
\ No newline at end of file
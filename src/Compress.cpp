@@ -0,0 +1,511 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Compress.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- DWORD LZCompress(const BYTE *src, DWORD dwSrcLen, BYTE *dst, DWORD dwDstCap);
+-- DWORD LZDecompress(const BYTE *src, DWORD dwSrcLen, BYTE *dst, DWORD dwDstCap);
+-- VOID InitCompressState(LPCompressState state, DWORD dwLinkMbps);
+-- BOOL ShouldCompress(LPCompressState state);
+-- VOID RecordCompression(LPCompressState state, DWORD dwRawLen, DWORD dwPackedLen, ULONGLONG qwTicks);
+-- VOID RecordSendRate(LPCompressState state, DWORD dwBytes, ULONGLONG qwTicks);
+-- INT FormatCompressReport(CHAR *buf, size_t size, LPCompressState state);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file contains the chunk compressor and the policy that decides whether to use it. The codec is a small
+--			LZ77 variant in the LZ4 style: each sequence is a token byte (literal length in the high nibble, match
+--			length in the low), the literals, then a 16-bit match offset. It favours speed over ratio, which is the
+--			right trade for compressing in front of a network link.
+--
+--			In adaptive mode the sender keeps running averages of the compression ratio r, the compression cost c
+--			(seconds per raw byte) and the link rate R (bytes per second). Sending a byte raw costs 1/R; compressing it
+--			first costs c + r/R, so a chunk is compressed only while c * R < 1 - r. Raw chunks are still compressed
+--			every COMPRESS_PROBE_INTERVAL chunks so that a change in the data or the link is noticed.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Compress.h"
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReadU32
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReadU32(const BYTE *p)
+--
+-- RETURNS: The (possibly unaligned) four bytes at p.
+---------------------------------------------------------------------------------------------------------------------------*/
+static inline DWORD ReadU32(const BYTE *p)
+{
+	DWORD v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LZHash
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LZHash(DWORD v)
+--
+-- RETURNS: The match finder's hash table index for a four byte sequence (Knuth's multiplicative hash).
+---------------------------------------------------------------------------------------------------------------------------*/
+static inline DWORD LZHash(DWORD v)
+{
+	return (v * 2654435761U) >> (32 - LZ_HASHBITS);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: WriteLength
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: WriteLength(BYTE *op, DWORD dwLen)
+--							BYTE *op:		Where to write the length extension.
+--							DWORD dwLen:	The part of the length that didn't fit in the token's nibble.
+--
+-- RETURNS: A pointer past the extension bytes.
+---------------------------------------------------------------------------------------------------------------------------*/
+static inline BYTE *WriteLength(BYTE *op, DWORD dwLen)
+{
+	while (dwLen >= 255)
+	{
+		*op++ = 255;
+		dwLen -= 255;
+	}
+	*op++ = (BYTE)dwLen;
+	return op;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LZCompress
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LZCompress(const BYTE *src, DWORD dwSrcLen, BYTE *dst, DWORD dwDstCap)
+--							BYTE *src:			The data to compress (at most LZ_MAXINPUT bytes).
+--							DWORD dwSrcLen:		The length of src.
+--							BYTE *dst:			The buffer to compress into.
+--							DWORD dwDstCap:		The size of dst.
+--
+-- RETURNS: The compressed length, or 0 if the output wouldn't fit in dwDstCap bytes.
+--
+-- NOTES:
+-- Passing dwDstCap < dwSrcLen makes the compressor give up as soon as it's clear the block won't shrink, which is how
+-- the sender avoids wasting time on incompressible chunks. The match search skips ahead faster the longer it goes
+-- without finding anything, for the same reason.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD LZCompress(const BYTE *src, DWORD dwSrcLen, BYTE *dst, DWORD dwDstCap)
+{
+	WORD		table[1 << LZ_HASHBITS];
+	const BYTE	*ip			= src;
+	const BYTE	*anchor		= src;
+	const BYTE	*iend		= src + dwSrcLen;
+	const BYTE	*mflimit	= iend - LZ_MFLIMIT;
+	const BYTE	*matchlimit	= iend - LZ_LASTLITERALS;
+	BYTE		*op			= dst;
+	BYTE		*oend		= dst + dwDstCap;
+	BYTE		*token;
+	DWORD		dwLitLen;
+
+	if (dwSrcLen > LZ_MAXINPUT)
+		return 0;
+
+	if (dwSrcLen > LZ_MFLIMIT)
+	{
+		memset(table, 0, sizeof(table));
+		table[LZHash(ReadU32(ip))] = 0;
+		ip++;
+
+		for (;;)
+		{
+			const BYTE	*match;
+			const BYTE	*mstart;
+			DWORD		dwStep		= 1;
+			DWORD		dwSearches	= 1 << 6;
+			DWORD		dwMatchLen;
+			DWORD		dwOffset;
+
+			// Find a four byte match within the 64K window
+			for (;;)
+			{
+				DWORD h;
+
+				if (ip > mflimit)
+					goto last_literals;
+
+				h = LZHash(ReadU32(ip));
+				match = src + table[h];
+				table[h] = (WORD)(ip - src);
+
+				if (match < ip && ip - match <= 0xFFFF && ReadU32(match) == ReadU32(ip))
+					break;
+
+				ip += dwStep;
+				dwStep = dwSearches++ >> 6;
+			}
+
+			// Pull the match back over any literals that also match
+			while (ip > anchor && match > src && ip[-1] == match[-1])
+			{
+				ip--;
+				match--;
+			}
+
+			mstart = ip;
+			dwOffset = (DWORD)(ip - match);
+			ip += LZ_MINMATCH;
+			match += LZ_MINMATCH;
+			while (ip < matchlimit && *ip == *match)
+			{
+				ip++;
+				match++;
+			}
+
+			dwLitLen = (DWORD)(mstart - anchor);
+			dwMatchLen = (DWORD)(ip - mstart) - LZ_MINMATCH;
+
+			// Worst case: token, literal length extension, literals, offset, match length extension
+			if ((DWORD)(oend - op) < 1 + dwLitLen / 255 + 1 + dwLitLen + 2 + dwMatchLen / 255 + 1)
+				return 0;
+
+			token = op++;
+			if (dwLitLen >= 15)
+			{
+				*token = 15 << 4;
+				op = WriteLength(op, dwLitLen - 15);
+			}
+			else
+				*token = (BYTE)(dwLitLen << 4);
+
+			memcpy(op, anchor, dwLitLen);
+			op += dwLitLen;
+
+			*op++ = (BYTE)dwOffset;
+			*op++ = (BYTE)(dwOffset >> 8);
+
+			if (dwMatchLen >= 15)
+			{
+				*token |= 15;
+				op = WriteLength(op, dwMatchLen - 15);
+			}
+			else
+				*token |= (BYTE)dwMatchLen;
+
+			anchor = ip;
+			if (ip > mflimit)
+				break;
+
+			// Index a position inside the match so that runs find themselves again
+			table[LZHash(ReadU32(ip - 2))] = (WORD)(ip - 2 - src);
+		}
+	}
+
+last_literals:
+	dwLitLen = (DWORD)(iend - anchor);
+	if ((DWORD)(oend - op) < 1 + dwLitLen / 255 + 1 + dwLitLen)
+		return 0;
+
+	token = op++;
+	if (dwLitLen >= 15)
+	{
+		*token = 15 << 4;
+		op = WriteLength(op, dwLitLen - 15);
+	}
+	else
+		*token = (BYTE)(dwLitLen << 4);
+
+	memcpy(op, anchor, dwLitLen);
+	op += dwLitLen;
+	return (DWORD)(op - dst);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReadLength
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReadLength(const BYTE **pip, const BYTE *iend, LPDWORD lpdwLen)
+--							BYTE **pip:			The read position; advanced past the extension bytes.
+--							BYTE *iend:			The end of the input.
+--							LPDWORD lpdwLen:	The length so far (15); the extension is added to it.
+--
+-- RETURNS: FALSE if the input ended in the middle of the extension; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static inline BOOL ReadLength(const BYTE **pip, const BYTE *iend, LPDWORD lpdwLen)
+{
+	BYTE b;
+	do
+	{
+		if (*pip >= iend)
+			return FALSE;
+		b = *(*pip)++;
+		*lpdwLen += b;
+	} while (b == 255);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LZDecompress
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LZDecompress(const BYTE *src, DWORD dwSrcLen, BYTE *dst, DWORD dwDstCap)
+--							BYTE *src:			The compressed block.
+--							DWORD dwSrcLen:		The length of src.
+--							BYTE *dst:			The buffer to decompress into.
+--							DWORD dwDstCap:		The size of dst.
+--
+-- RETURNS: The decompressed length, or LZ_ERROR if the block is corrupt or wouldn't fit in dst.
+--
+-- NOTES:
+-- Every length and offset is checked against both buffers, since the block came off the network.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD LZDecompress(const BYTE *src, DWORD dwSrcLen, BYTE *dst, DWORD dwDstCap)
+{
+	const BYTE	*ip		= src;
+	const BYTE	*iend	= src + dwSrcLen;
+	BYTE		*op		= dst;
+	BYTE		*oend	= dst + dwDstCap;
+
+	while (ip < iend)
+	{
+		BYTE		token = *ip++;
+		DWORD		dwLen = token >> 4;
+		DWORD		dwOffset;
+		const BYTE	*match;
+
+		if (dwLen == 15 && !ReadLength(&ip, iend, &dwLen))
+			return LZ_ERROR;
+		if ((DWORD)(iend - ip) < dwLen || (DWORD)(oend - op) < dwLen)
+			return LZ_ERROR;
+
+		memcpy(op, ip, dwLen);
+		op += dwLen;
+		ip += dwLen;
+
+		if (ip == iend) // The last sequence has no match
+			break;
+
+		if (iend - ip < 2)
+			return LZ_ERROR;
+		dwOffset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (dwOffset == 0 || dwOffset > (DWORD)(op - dst))
+			return LZ_ERROR;
+
+		dwLen = token & 15;
+		if (dwLen == 15 && !ReadLength(&ip, iend, &dwLen))
+			return LZ_ERROR;
+		dwLen += LZ_MINMATCH;
+		if ((DWORD)(oend - op) < dwLen)
+			return LZ_ERROR;
+
+		match = op - dwOffset;
+		if (dwOffset >= dwLen)
+		{
+			memcpy(op, match, dwLen);
+			op += dwLen;
+		}
+		else // Overlapping copy; this is how runs are encoded, so it has to go a byte at a time
+		{
+			while (dwLen--)
+				*op++ = *match++;
+		}
+	}
+	return (DWORD)(op - dst);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitCompressState
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitCompressState(LPCompressState state, DWORD dwLinkMbps)
+--							LPCompressState state:	The state to reset; dwMode is left alone.
+--							DWORD dwLinkMbps:		The nominal link rate, used until a send rate has been measured.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called at the start of every transfer. The ratio starts at 1 and the cost at 0, so the first chunk is always
+-- compressed to get real samples.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitCompressState(LPCompressState state, DWORD dwLinkMbps)
+{
+	state->dRatio			= 1.0;
+	state->dCostPerByte		= 0.0;
+	state->dLinkRate		= dwLinkMbps * 125000.0;
+	state->dwSinceProbe		= 0;
+	state->dwChunks			= 0;
+	state->dwCompressed		= 0;
+	state->qwLogicalBytes	= 0;
+	state->qwWireBytes		= 0;
+	state->qwCodecTicks		= 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ShouldCompress
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ShouldCompress(LPCompressState state)
+--							LPCompressState state: The sender's compression state.
+--
+-- RETURNS: TRUE if the next chunk should be compressed.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ShouldCompress(LPCompressState state)
+{
+	switch (state->dwMode)
+	{
+	case COMPRESS_OFF:
+		return FALSE;
+	case COMPRESS_ON:
+		return TRUE;
+	}
+
+	if (state->dCostPerByte == 0.0 || state->dCostPerByte * state->dLinkRate < 1.0 - state->dRatio)
+	{
+		state->dwSinceProbe = 0;
+		return TRUE;
+	}
+
+	if (++state->dwSinceProbe >= COMPRESS_PROBE_INTERVAL)
+	{
+		state->dwSinceProbe = 0;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RecordCompression
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RecordCompression(LPCompressState state, DWORD dwRawLen, DWORD dwPackedLen, ULONGLONG qwTicks)
+--							LPCompressState state:	The sender's compression state.
+--							DWORD dwRawLen:			The chunk's length before compression.
+--							DWORD dwPackedLen:		Its compressed length, or 0 if it didn't shrink.
+--							ULONGLONG qwTicks:		How long the compressor took (QueryPerformanceCounter ticks).
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID RecordCompression(LPCompressState state, DWORD dwRawLen, DWORD dwPackedLen, ULONGLONG qwTicks)
+{
+	double dRatio	= dwPackedLen ? (double)dwPackedLen / dwRawLen : 1.0;
+	double dCost	= TicksToSeconds(qwTicks) / (dwRawLen ? dwRawLen : 1);
+
+	if (state->dCostPerByte == 0.0)
+		state->dCostPerByte = dCost;
+
+	state->dRatio		+= COMPRESS_EWMA_WEIGHT * (dRatio - state->dRatio);
+	state->dCostPerByte	+= COMPRESS_EWMA_WEIGHT * (dCost - state->dCostPerByte);
+	state->qwCodecTicks	+= qwTicks;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RecordSendRate
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RecordSendRate(LPCompressState state, DWORD dwBytes, ULONGLONG qwTicks)
+--							LPCompressState state:	The sender's compression state.
+--							DWORD dwBytes:			The bytes in the completed send.
+--							ULONGLONG qwTicks:		The time from posting the send to its completion.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Sends complete as soon as the socket buffer takes them, so the first few samples are much faster than the link; the
+-- average settles on the link rate once the buffer is full.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID RecordSendRate(LPCompressState state, DWORD dwBytes, ULONGLONG qwTicks)
+{
+	double dSeconds = TicksToSeconds(qwTicks);
+
+	if (dSeconds <= 0.0 || dwBytes == 0)
+		return;
+	state->dLinkRate += COMPRESS_EWMA_WEIGHT * (dwBytes / dSeconds - state->dLinkRate);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatCompressReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatCompressReport(CHAR *buf, size_t size, LPCompressState state)
+--							CHAR *buf:				The buffer to write the report section into.
+--							size_t size:			The space left in buf.
+--							LPCompressState state:	The compression state at the end of the transfer.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The codec time is compression time on the client and decompression time on the server.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatCompressReport(CHAR *buf, size_t size, LPCompressState state)
+{
+	static const char	*modes[] = { "off", "on", "adaptive" };
+	INT					written = 0;
+	double				dSeconds = TicksToSeconds(state->qwCodecTicks);
+
+	written += sprintf_s(buf, size, "Compression: %s (%lu of %lu chunks compressed)\r\n",
+		modes[state->dwMode], state->dwCompressed, state->dwChunks);
+	written += sprintf_s(buf + written, size - written, "Logical bytes: %llu\r\nWire bytes: %llu (%.1f%%)\r\n",
+		state->qwLogicalBytes, state->qwWireBytes,
+		state->qwLogicalBytes ? 100.0 * state->qwWireBytes / state->qwLogicalBytes : 100.0);
+	written += sprintf_s(buf + written, size - written, "Codec CPU: %.1fms (%.2fns/byte)\r\n", dSeconds * 1000.0,
+		state->qwLogicalBytes ? dSeconds * 1e9 / state->qwLogicalBytes : 0.0);
+	return written;
+}
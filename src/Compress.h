@@ -0,0 +1,29 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <Windows.h>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+
+#define LZ_ERROR				((DWORD)-1)	// Returned by LZDecompress for corrupt input
+#define LZ_MAXINPUT				65536		// Matches use 16-bit offsets, so a block can't be longer than this
+#define LZ_MINMATCH				4			// Shortest match worth encoding
+#define LZ_HASHBITS				12			// log2 of the match finder's hash table size
+#define LZ_LASTLITERALS			5			// The last bytes of a block are always literals
+#define LZ_MFLIMIT				12			// No match may start within this many bytes of the end
+
+#define COMPRESS_PROBE_INTERVAL	16			// Raw chunks sent before compression is tried again
+#define COMPRESS_EWMA_WEIGHT	0.125		// Weight of the newest sample in the running averages
+
+DWORD LZCompress(const BYTE *src, DWORD dwSrcLen, BYTE *dst, DWORD dwDstCap);
+DWORD LZDecompress(const BYTE *src, DWORD dwSrcLen, BYTE *dst, DWORD dwDstCap);
+
+VOID InitCompressState(LPCompressState state, DWORD dwLinkMbps);
+BOOL ShouldCompress(LPCompressState state);
+VOID RecordCompression(LPCompressState state, DWORD dwRawLen, DWORD dwPackedLen, ULONGLONG qwTicks);
+VOID RecordSendRate(LPCompressState state, DWORD dwBytes, ULONGLONG qwTicks);
+INT FormatCompressReport(CHAR *buf, size_t size, LPCompressState state);
+
+#endif
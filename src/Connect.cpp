@@ -0,0 +1,774 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Connect.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitResolver();
+-- VOID StartResolve(const TCHAR *szHost);
+-- BOOL ResolveHost(const TCHAR *szHost, LPResolvedHost host, LPBOOL pbCached, DWORD dwTimeout);
+-- BOOL ParseAddress(const TCHAR *szText, LPSOCKADDR_STORAGE addr, INT *pnLen);
+-- VOID SetAddressPort(LPSOCKADDR_STORAGE addr, USHORT usPort);
+-- BOOL SameAddress(const SOCKADDR_STORAGE *a, const SOCKADDR_STORAGE *b);
+-- VOID AddressToText(const SOCKADDR_STORAGE *addr, TCHAR *buf, size_t size);
+-- VOID FormatAddress(const SOCKADDR_STORAGE *addr, CHAR *buf, size_t size);
+-- BOOL ConnectFirst(LPResolvedHost host, DWORD nSockType, LPSocketTuning tuning, SOCKET *pSocket, DWORD *pdwWinner,
+--		LPConnectState state);
+-- VOID NotePeer(SOCKET s, LPConnectState state);
+-- DWORD ElapsedUs(const LARGE_INTEGER *liSince);
+-- INT FormatConnectReport(CHAR *buf, size_t size, LPConnectState state, BOOL bReceiver);
+-- static LPResolveEntry FindEntry(const TCHAR *szHost);
+-- static DWORD QueryTtl(const TCHAR *szHost);
+-- static VOID OrderAddresses(LPResolvedHost host);
+-- static DWORD WINAPI ResolverProc(VOID *param);
+-- static SOCKET OpenSocket(const SOCKADDR_STORAGE *addr, DWORD nSockType, LPSocketTuning tuning);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file gets the client from a host name to a connected socket. Names are looked up with GetAddrInfoW on
+--			a thread of their own, so neither the window nor the transfer thread blocks on DNS, and the answers are
+--			cached for their TTL (read back from the system's DNS cache, since getaddrinfo doesn't report it). A name
+--			is looked up as soon as it's entered in the transfer dialog, so by the time "Begin Transfer" is clicked
+--			the answer is usually already there.
+--
+--			A name can resolve to both IPv4 and IPv6 addresses. The addresses are ordered to alternate between the
+--			two families, and ConnectFirst races connections to them "happy eyeballs" style (RFC 8305): each attempt
+--			gets CONNECT_DELAY to succeed before the next one starts, the first to connect wins and the others are
+--			abandoned. A family that's broken on this network therefore costs a quarter of a second, not a timeout.
+--
+--			The time taken by each step, and the time from "Begin Transfer" to the first byte of data, go in the
+--			report.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Connect.h"
+
+#pragma comment(lib, "Dnsapi.lib")
+
+static ResolveEntry		cache[RESOLVE_CACHESIZE];	// The names looked up so far
+static CRITICAL_SECTION	csCache;					// Guards the cache; lookups finish on their own threads
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitResolver
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitResolver()
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Sets up the resolver cache. This must be called once before any other function in this file.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitResolver()
+{
+	DWORD i;
+
+	InitializeCriticalSection(&csCache);
+	memset(cache, 0, sizeof(cache));
+	for (i = 0; i < RESOLVE_CACHESIZE; i++)
+		cache[i].hDone = CreateEvent(NULL, TRUE, TRUE, NULL);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FindEntry
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FindEntry(const TCHAR *szHost)
+--
+-- RETURNS: The cache entry for the name, or NULL if it isn't cached. The caller must hold csCache.
+---------------------------------------------------------------------------------------------------------------------------*/
+static LPResolveEntry FindEntry(const TCHAR *szHost)
+{
+	DWORD i;
+
+	for (i = 0; i < RESOLVE_CACHESIZE; i++)
+	{
+		if (cache[i].szHost[0] != 0 && _tcsicmp(cache[i].szHost, szHost) == 0)
+			return &cache[i];
+	}
+	return NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: QueryTtl
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: QueryTtl(const TCHAR *szHost)
+--
+-- RETURNS: How many seconds the answer for the name may be kept.
+--
+-- NOTES:
+-- getaddrinfo has just put the name's records in the system's DNS cache, so they're read back from there (without
+-- another query going out) for their TTL. Names that don't come from DNS, such as those in the hosts file, get
+-- RESOLVE_DEF_TTL.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD QueryTtl(const TCHAR *szHost)
+{
+	static const WORD	types[] = { DNS_TYPE_AAAA, DNS_TYPE_A };
+	PDNS_RECORD			records, rec;
+	DWORD				dwTtl = MAXDWORD;
+	DWORD				i;
+
+	for (i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+	{
+		if (DnsQuery(szHost, types[i], DNS_QUERY_NO_WIRE_QUERY, NULL, &records, NULL) != 0)
+			continue;
+		for (rec = records; rec != NULL; rec = rec->pNext)
+		{
+			if (rec->wType == types[i] && rec->dwTtl < dwTtl)
+				dwTtl = rec->dwTtl;
+		}
+		DnsRecordListFree(records, DnsFreeRecordList);
+	}
+
+	if (dwTtl == MAXDWORD)
+		return RESOLVE_DEF_TTL;
+	return max(RESOLVE_MIN_TTL, min(dwTtl, RESOLVE_MAX_TTL));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: OrderAddresses
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: OrderAddresses(LPResolvedHost host)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- getaddrinfo already sorts the addresses by preference (RFC 6724). They're interleaved by family here, keeping that
+-- order within each family and starting with the family of the most preferred, so that the second connection attempt
+-- always tries the other family.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID OrderAddresses(LPResolvedHost host)
+{
+	ResolvedHost	sorted;
+	DWORD			dwNext[2] = { 0, 0 };	// Next address to take of the preferred family and of the other
+	DWORD			i, j, k;
+	INT				nFirst;
+
+	if (host->dwAddrs < 2)
+		return;
+
+	nFirst = host->addrs[0].ss_family;
+	sorted.nError = host->nError;
+	sorted.dwAddrs = 0;
+	for (i = 0; sorted.dwAddrs < host->dwAddrs; i ^= 1)
+	{
+		// Find the next address of family i (0 is the preferred family); if there are none left, take the other
+		for (k = 0; k < 2; k++, i ^= 1)
+		{
+			for (j = dwNext[i]; j < host->dwAddrs && (host->addrs[j].ss_family == nFirst) != (i == 0); j++)
+				;
+			if (j < host->dwAddrs)
+				break;
+			dwNext[i] = j;
+		}
+
+		sorted.addrs[sorted.dwAddrs] = host->addrs[j];
+		sorted.lens[sorted.dwAddrs++] = host->lens[j];
+		dwNext[i] = j + 1;
+	}
+	*host = sorted;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ResolverProc
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ResolverProc(VOID *param)
+--						VOID *param:	The cache entry to fill, as an LPResolveEntry.
+--
+-- RETURNS: 0.
+--
+-- NOTES:
+-- Looks up one name. A name that doesn't resolve is remembered for RESOLVE_NEG_TTL so a string of transfers to a
+-- mistyped name doesn't wait on DNS every time. The entry can't be reused while the lookup is pending, so its name is
+-- safe to read without the lock.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD WINAPI ResolverProc(VOID *param)
+{
+	LPResolveEntry	entry	= (LPResolveEntry)param;
+	ADDRINFOW		hints;
+	ADDRINFOW		*res, *ai;
+	ResolvedHost	result;
+	DWORD			dwTtl	= RESOLVE_NEG_TTL;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;	// Only so each address comes back once, not once per socket type
+	hints.ai_flags = AI_ADDRCONFIG;
+
+	memset(&result, 0, sizeof(result));
+	if ((result.nError = GetAddrInfoW(entry->szHost, NULL, &hints, &res)) == 0)
+	{
+		for (ai = res; ai != NULL && result.dwAddrs < RESOLVE_MAXADDRS; ai = ai->ai_next)
+		{
+			if ((ai->ai_family == AF_INET || ai->ai_family == AF_INET6) && ai->ai_addrlen <= sizeof(SOCKADDR_STORAGE))
+			{
+				memcpy(&result.addrs[result.dwAddrs], ai->ai_addr, ai->ai_addrlen);
+				result.lens[result.dwAddrs++] = (INT)ai->ai_addrlen;
+			}
+		}
+		FreeAddrInfoW(res);
+
+		if (result.dwAddrs == 0)
+			result.nError = WSANO_DATA;
+		else
+		{
+			OrderAddresses(&result);
+			dwTtl = QueryTtl(entry->szHost);
+		}
+	}
+
+	EnterCriticalSection(&csCache);
+	entry->result = result;
+	entry->qwExpires = GetTickCount64() + (ULONGLONG)dwTtl * 1000;
+	entry->bPending = FALSE;
+	SetEvent(entry->hDone);
+	LeaveCriticalSection(&csCache);
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StartResolve
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StartResolve(const TCHAR *szHost)
+--						TCHAR *szHost:	The name to look up.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Starts looking up a name unless a lookup is already under way or the cached answer is still good, and returns
+-- without waiting. When the cache is full the least recently used name is dropped.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID StartResolve(const TCHAR *szHost)
+{
+	LPResolveEntry	entry;
+	ULONGLONG		qwNow	= GetTickCount64();
+	HANDLE			hThread;
+	DWORD			i;
+
+	EnterCriticalSection(&csCache);
+	if ((entry = FindEntry(szHost)) != NULL && (entry->bPending || qwNow < entry->qwExpires))
+	{
+		LeaveCriticalSection(&csCache);
+		return;
+	}
+
+	for (i = 0; entry == NULL && i < RESOLVE_CACHESIZE; i++)
+	{
+		if (!cache[i].bPending && cache[i].szHost[0] == 0)
+			entry = &cache[i];
+	}
+	for (i = 0; entry == NULL && i < RESOLVE_CACHESIZE; i++)
+	{
+		if (!cache[i].bPending && (entry == NULL || cache[i].qwLastUsed < entry->qwLastUsed))
+			entry = &cache[i];
+	}
+	if (entry == NULL) // Every entry has a lookup in progress; this one will be started when it's needed
+	{
+		LeaveCriticalSection(&csCache);
+		return;
+	}
+
+	_tcscpy_s(entry->szHost, szHost);
+	entry->bPending = TRUE;
+	entry->qwLastUsed = qwNow;
+	ResetEvent(entry->hDone);
+	LeaveCriticalSection(&csCache);
+
+	if ((hThread = CreateThread(NULL, 0, ResolverProc, entry, 0, NULL)) == NULL)
+	{
+		EnterCriticalSection(&csCache);
+		entry->result.nError = WSATRY_AGAIN;
+		entry->result.dwAddrs = 0;
+		entry->qwExpires = 0;
+		entry->bPending = FALSE;
+		SetEvent(entry->hDone);
+		LeaveCriticalSection(&csCache);
+		return;
+	}
+	CloseHandle(hThread);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ResolveHost
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ResolveHost(const TCHAR *szHost, LPResolvedHost host, LPBOOL pbCached, DWORD dwTimeout)
+--						TCHAR *szHost:			The name to look up.
+--						LPResolvedHost host:	Receives the addresses, or the error in host->nError.
+--						LPBOOL pbCached:		Set to TRUE if the answer was already in the cache.
+--						DWORD dwTimeout:		How long to wait for a lookup, in milliseconds.
+--
+-- RETURNS: TRUE if the name resolved to at least one address; FALSE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ResolveHost(const TCHAR *szHost, LPResolvedHost host, LPBOOL pbCached, DWORD dwTimeout)
+{
+	LPResolveEntry	entry;
+	HANDLE			hDone	= NULL;
+
+	EnterCriticalSection(&csCache);
+	entry = FindEntry(szHost);
+	*pbCached = entry != NULL && !entry->bPending && GetTickCount64() < entry->qwExpires;
+	LeaveCriticalSection(&csCache);
+
+	if (!*pbCached)
+		StartResolve(szHost);
+
+	EnterCriticalSection(&csCache);
+	if ((entry = FindEntry(szHost)) != NULL)
+		hDone = entry->hDone;
+	LeaveCriticalSection(&csCache);
+
+	host->dwAddrs = 0;
+	if (hDone == NULL || WaitForSingleObject(hDone, dwTimeout) != WAIT_OBJECT_0)
+	{
+		host->nError = WSATRY_AGAIN;
+		return FALSE;
+	}
+
+	// The entry may have been given to another name while this thread waited
+	EnterCriticalSection(&csCache);
+	if ((entry = FindEntry(szHost)) != NULL && !entry->bPending)
+	{
+		*host = entry->result;
+		entry->qwLastUsed = GetTickCount64();
+	}
+	else
+		host->nError = WSATRY_AGAIN;
+	LeaveCriticalSection(&csCache);
+
+	return host->nError == 0 && host->dwAddrs > 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ParseAddress
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ParseAddress(const TCHAR *szText, LPSOCKADDR_STORAGE addr, INT *pnLen)
+--						TCHAR *szText:				The text entered for the server.
+--						LPSOCKADDR_STORAGE addr:	Receives the address (the port is left at 0).
+--						INT *pnLen:					Receives the length of the sockaddr.
+--
+-- RETURNS: TRUE if the text is an IPv4 or IPv6 address; FALSE if it should be treated as a host name.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ParseAddress(const TCHAR *szText, LPSOCKADDR_STORAGE addr, INT *pnLen)
+{
+	SOCKADDR_STORAGE parsed;
+
+	memset(&parsed, 0, sizeof(parsed));
+	if (InetPton(AF_INET, szText, &((LPSOCKADDR_IN)&parsed)->sin_addr) == 1)
+	{
+		parsed.ss_family = AF_INET;
+		*pnLen = sizeof(SOCKADDR_IN);
+	}
+	else if (InetPton(AF_INET6, szText, &((LPSOCKADDR_IN6)&parsed)->sin6_addr) == 1)
+	{
+		parsed.ss_family = AF_INET6;
+		*pnLen = sizeof(SOCKADDR_IN6);
+	}
+	else
+		return FALSE;
+
+	*addr = parsed;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SetAddressPort
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SetAddressPort(LPSOCKADDR_STORAGE addr, USHORT usPort)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID SetAddressPort(LPSOCKADDR_STORAGE addr, USHORT usPort)
+{
+	if (addr->ss_family == AF_INET6)
+		((LPSOCKADDR_IN6)addr)->sin6_port = htons(usPort);
+	else
+		((LPSOCKADDR_IN)addr)->sin_port = htons(usPort);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SameAddress
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SameAddress(const SOCKADDR_STORAGE *a, const SOCKADDR_STORAGE *b)
+--
+-- RETURNS: TRUE if the two addresses and ports are the same.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SameAddress(const SOCKADDR_STORAGE *a, const SOCKADDR_STORAGE *b)
+{
+	if (a->ss_family != b->ss_family)
+		return FALSE;
+	if (a->ss_family == AF_INET6)
+		return ((LPSOCKADDR_IN6)a)->sin6_port == ((LPSOCKADDR_IN6)b)->sin6_port &&
+			memcmp(&((LPSOCKADDR_IN6)a)->sin6_addr, &((LPSOCKADDR_IN6)b)->sin6_addr, sizeof(IN6_ADDR)) == 0;
+	return ((LPSOCKADDR_IN)a)->sin_port == ((LPSOCKADDR_IN)b)->sin_port &&
+		((LPSOCKADDR_IN)a)->sin_addr.s_addr == ((LPSOCKADDR_IN)b)->sin_addr.s_addr;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AddressToText
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AddressToText(const SOCKADDR_STORAGE *addr, TCHAR *buf, size_t size)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Writes just the address, without the port, as it would be typed into the transfer dialog.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID AddressToText(const SOCKADDR_STORAGE *addr, TCHAR *buf, size_t size)
+{
+	const VOID *bytes;
+
+	if (addr->ss_family == AF_INET6)
+		bytes = &((LPSOCKADDR_IN6)addr)->sin6_addr;
+	else
+		bytes = &((LPSOCKADDR_IN)addr)->sin_addr;
+
+	if (InetNtop(addr->ss_family, bytes, buf, size) == NULL)
+		buf[0] = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatAddress
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatAddress(const SOCKADDR_STORAGE *addr, CHAR *buf, size_t size)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Writes the address and port for the report, with IPv6 addresses in brackets.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FormatAddress(const SOCKADDR_STORAGE *addr, CHAR *buf, size_t size)
+{
+	TCHAR	szText[INET6_ADDRSTRLEN];
+	CHAR	szAddr[INET6_ADDRSTRLEN];
+
+	AddressToText(addr, szText, INET6_ADDRSTRLEN);
+	TCHAR_2_CHAR(szAddr, szText, INET6_ADDRSTRLEN);
+
+	if (addr->ss_family == AF_INET6)
+		sprintf_s(buf, size, "[%s]:%u", szAddr, ntohs(((LPSOCKADDR_IN6)addr)->sin6_port));
+	else
+		sprintf_s(buf, size, "%s:%u", szAddr, ntohs(((LPSOCKADDR_IN)addr)->sin_port));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: OpenSocket
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: OpenSocket(const SOCKADDR_STORAGE *addr, DWORD nSockType, LPSocketTuning tuning)
+--
+-- RETURNS: An overlapped socket of the address's family with the tuning profile applied, or INVALID_SOCKET.
+---------------------------------------------------------------------------------------------------------------------------*/
+static SOCKET OpenSocket(const SOCKADDR_STORAGE *addr, DWORD nSockType, LPSocketTuning tuning)
+{
+	SOCKET s = WSASocket(addr->ss_family, nSockType, 0, NULL, 0, WSA_FLAG_OVERLAPPED);
+
+	if (s != INVALID_SOCKET)
+		ApplySocketTuning(s, tuning, nSockType);
+	return s;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ConnectFirst
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ConnectFirst(LPResolvedHost host, DWORD nSockType, LPSocketTuning tuning, SOCKET *pSocket,
+--							DWORD *pdwWinner, LPConnectState state)
+--						LPResolvedHost host:	The server's addresses, with the port set, in the order to try them.
+--						DWORD nSockType:		SOCK_STREAM or SOCK_DGRAM.
+--						LPSocketTuning tuning:	The tuning profile to apply to the sockets.
+--						SOCKET *pSocket:		Receives the socket.
+--						DWORD *pdwWinner:		Receives the index of the address it's connected to.
+--						LPConnectState state:	Receives the number of attempts and the time they took.
+--
+-- RETURNS: FALSE if no connection could be made (or, for UDP, no socket created); TRUE otherwise.
+--
+-- NOTES:
+-- Starts a non-blocking connect to the first address, and another to the next address every CONNECT_DELAY until one
+-- of them completes; an attempt that fails outright starts the next at once. The winner is put back into blocking mode
+-- (the control exchanges use blocking sends and receives) and every other attempt is closed. UDP has no handshake to
+-- race, so a socket is just created for the first address.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ConnectFirst(LPResolvedHost host, DWORD nSockType, LPSocketTuning tuning, SOCKET *pSocket, DWORD *pdwWinner,
+	LPConnectState state)
+{
+	SOCKET			socks[RESOLVE_MAXADDRS];
+	DWORD			dwStarted	= 0;
+	DWORD			dwFailed	= 0;
+	DWORD			dwWinner	= RESOLVE_MAXADDRS;
+	ULONGLONG		qwNow, qwNextStart, qwDeadline, qwWait;
+	LARGE_INTEGER	liStart;
+	fd_set			writable, failed;
+	timeval			tv;
+	ULONG			ulNonBlocking = 1;
+	ULONG			ulBlocking = 0;
+	DWORD			i;
+
+	QueryPerformanceCounter(&liStart);
+	state->dwAttempts = 0;
+
+	if (nSockType == SOCK_DGRAM)
+	{
+		if ((*pSocket = OpenSocket(&host->addrs[0], SOCK_DGRAM, tuning)) == INVALID_SOCKET)
+			return FALSE;
+		dwWinner = 0;
+	}
+	else
+	{
+		qwNextStart = GetTickCount64();
+		qwDeadline = qwNextStart + CONNECT_TIMEOUT;
+		while (dwWinner == RESOLVE_MAXADDRS && (qwNow = GetTickCount64()) < qwDeadline)
+		{
+			if (dwStarted < host->dwAddrs && (qwNow >= qwNextStart || dwFailed == dwStarted))
+			{
+				socks[dwStarted] = OpenSocket(&host->addrs[dwStarted], SOCK_STREAM, tuning);
+				state->dwAttempts++;
+				if (socks[dwStarted] != INVALID_SOCKET)
+				{
+					ioctlsocket(socks[dwStarted], FIONBIO, &ulNonBlocking);
+					if (WSAConnect(socks[dwStarted], (sockaddr *)&host->addrs[dwStarted], host->lens[dwStarted], NULL, NULL,
+						NULL, NULL) == 0)
+						dwWinner = dwStarted;
+					else if (WSAGetLastError() != WSAEWOULDBLOCK)
+					{
+						closesocket(socks[dwStarted]);
+						socks[dwStarted] = INVALID_SOCKET;
+					}
+				}
+				if (socks[dwStarted] == INVALID_SOCKET)
+					dwFailed++;
+				dwStarted++;
+				qwNextStart = qwNow + CONNECT_DELAY;
+				continue;
+			}
+
+			if (dwFailed == host->dwAddrs)
+				break;
+
+			FD_ZERO(&writable);
+			FD_ZERO(&failed);
+			for (i = 0; i < dwStarted; i++)
+			{
+				if (socks[i] != INVALID_SOCKET)
+				{
+					FD_SET(socks[i], &writable);
+					FD_SET(socks[i], &failed);
+				}
+			}
+
+			// Wake up for the next attempt, unless they've all been started
+			qwWait = (dwStarted < host->dwAddrs ? min(qwNextStart, qwDeadline) : qwDeadline) - qwNow;
+			tv.tv_sec = (LONG)(qwWait / 1000);
+			tv.tv_usec = (LONG)(qwWait % 1000 * 1000);
+			if (select(0, NULL, &writable, &failed, &tv) == SOCKET_ERROR)
+				break;
+
+			for (i = 0; i < dwStarted && dwWinner == RESOLVE_MAXADDRS; i++)
+			{
+				if (socks[i] == INVALID_SOCKET)
+					continue;
+				if (FD_ISSET(socks[i], &failed))
+				{
+					closesocket(socks[i]);
+					socks[i] = INVALID_SOCKET;
+					dwFailed++;
+				}
+				else if (FD_ISSET(socks[i], &writable))
+					dwWinner = i;
+			}
+		}
+
+		for (i = 0; i < dwStarted; i++)
+		{
+			if (i != dwWinner && socks[i] != INVALID_SOCKET)
+				closesocket(socks[i]);
+		}
+		if (dwWinner == RESOLVE_MAXADDRS)
+			return FALSE;
+
+		ioctlsocket(socks[dwWinner], FIONBIO, &ulBlocking);
+		*pSocket = socks[dwWinner];
+	}
+
+	*pdwWinner = dwWinner;
+	state->nFamily = host->addrs[dwWinner].ss_family;
+	state->dwConnectUs = ElapsedUs(&liStart);
+	FormatAddress(&host->addrs[dwWinner], state->szPeer, sizeof(state->szPeer));
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NotePeer
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NotePeer(SOCKET s, LPConnectState state)
+--						SOCKET s:				A socket the server has just accepted.
+--						LPConnectState state:	Receives the client's address; the time to first byte is measured from now.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID NotePeer(SOCKET s, LPConnectState state)
+{
+	SOCKADDR_STORAGE	peer;
+	INT					nLen = sizeof(peer);
+
+	memset(state, 0, sizeof(ConnectState));
+	QueryPerformanceCounter(&state->liBegin);
+	if (getpeername(s, (sockaddr *)&peer, &nLen) == 0)
+	{
+		state->nFamily = peer.ss_family;
+		FormatAddress(&peer, state->szPeer, sizeof(state->szPeer));
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ElapsedUs
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ElapsedUs(const LARGE_INTEGER *liSince)
+--
+-- RETURNS: The microseconds since a QueryPerformanceCounter reading (at least 1, so 0 can mean "not measured").
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD ElapsedUs(const LARGE_INTEGER *liSince)
+{
+	LARGE_INTEGER liNow;
+
+	QueryPerformanceCounter(&liNow);
+	return max(1, (DWORD)(TicksToSeconds(liNow.QuadPart - liSince->QuadPart) * 1e6));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatConnectReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatConnectReport(CHAR *buf, size_t size, LPConnectState state, BOOL bReceiver)
+--							CHAR *buf:				The buffer to write the report section into.
+--							size_t size:			The space left in buf.
+--							LPConnectState state:	How the connection was set up.
+--							BOOL bReceiver:			Whether this is the server.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The time to first byte is reported on its own because it's what a user waiting on a small transfer actually sees;
+-- on the client it covers the lookup, the connection and any query exchange before the data.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatConnectReport(CHAR *buf, size_t size, LPConnectState state, BOOL bReceiver)
+{
+	INT written = 0;
+
+	if (state->szPeer[0] == 0)
+		return 0;
+
+	written += sprintf_s(buf, size, "%s: %s (%s)\r\n", bReceiver ? "Client" : "Server", state->szPeer,
+		state->nFamily == AF_INET6 ? "IPv6" : "IPv4");
+	if (!bReceiver)
+	{
+		if (state->bNamed)
+			written += sprintf_s(buf + written, size - written, "Name lookup: %.2fms (%s), %lu addresses\r\n",
+				state->dwResolveUs / 1e3, state->bCached ? "cached" : "resolved", state->dwAddrs);
+		if (state->dwAttempts != 0)
+			written += sprintf_s(buf + written, size - written, "Connect: %.2fms, %lu of %lu addresses tried\r\n",
+				state->dwConnectUs / 1e3, state->dwAttempts, state->dwAddrs);
+	}
+	if (state->dwTtfbUs != 0)
+		written += sprintf_s(buf + written, size - written, "Time to first byte: %.2fms\r\n", state->dwTtfbUs / 1e3);
+	return written;
+}
@@ -0,0 +1,59 @@
+#ifndef CONNECT_H
+#define CONNECT_H
+
+#include <WinSock2.h>
+#include <Ws2tcpip.h>
+#include <windns.h>
+#include <Windows.h>
+#include <tchar.h>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "SocketTuning.h"
+
+#define RESOLVE_MAXADDRS	8			// Addresses kept for a name
+#define RESOLVE_CACHESIZE	16			// Names the resolver remembers
+#define RESOLVE_DEF_TTL		60			// Seconds to keep an answer whose TTL isn't known
+#define RESOLVE_MIN_TTL		5			// Shortest time an answer is kept, whatever its TTL
+#define RESOLVE_MAX_TTL		3600		// Longest time an answer is kept
+#define RESOLVE_NEG_TTL		5			// Seconds to remember that a name didn't resolve
+#define RESOLVE_TIMEOUT		10000		// Longest a transfer waits for a name to resolve
+#define CONNECT_DELAY		250			// Milliseconds each connection attempt gets before the next is started (RFC 8305)
+#define CONNECT_TIMEOUT		10000		// Longest all the attempts together may take
+
+/* The addresses a name resolved to, in the order they should be tried. */
+typedef struct _ResolvedHost
+{
+	INT					nError;		// 0, or the getaddrinfo error
+	DWORD				dwAddrs;
+	SOCKADDR_STORAGE	addrs[RESOLVE_MAXADDRS];
+	INT					lens[RESOLVE_MAXADDRS];
+} ResolvedHost, *LPResolvedHost;
+
+/* A name in the resolver cache. The event is set whenever no lookup is in progress. */
+typedef struct _ResolveEntry
+{
+	TCHAR				szHost[HOSTNAME_SIZE];
+	ResolvedHost		result;
+	ULONGLONG			qwExpires;	// GetTickCount64 when the answer goes stale
+	ULONGLONG			qwLastUsed;
+	BOOL				bPending;	// A lookup is in progress
+	HANDLE				hDone;
+} ResolveEntry, *LPResolveEntry;
+
+VOID InitResolver();
+VOID StartResolve(const TCHAR *szHost);
+BOOL ResolveHost(const TCHAR *szHost, LPResolvedHost host, LPBOOL pbCached, DWORD dwTimeout);
+BOOL ParseAddress(const TCHAR *szText, LPSOCKADDR_STORAGE addr, INT *pnLen);
+VOID SetAddressPort(LPSOCKADDR_STORAGE addr, USHORT usPort);
+BOOL SameAddress(const SOCKADDR_STORAGE *a, const SOCKADDR_STORAGE *b);
+VOID AddressToText(const SOCKADDR_STORAGE *addr, TCHAR *buf, size_t size);
+VOID FormatAddress(const SOCKADDR_STORAGE *addr, CHAR *buf, size_t size);
+BOOL ConnectFirst(LPResolvedHost host, DWORD nSockType, LPSocketTuning tuning, SOCKET *pSocket, DWORD *pdwWinner,
+	LPConnectState state);
+VOID NotePeer(SOCKET s, LPConnectState state);
+DWORD ElapsedUs(const LARGE_INTEGER *liSince);
+INT FormatConnectReport(CHAR *buf, size_t size, LPConnectState state, BOOL bReceiver);
+
+#endif
@@ -0,0 +1,339 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Control.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitControlState(LPControlState c);
+-- VOID NoteDataArrival(LPControlState c);
+-- BOOL IsControlMsg(const BYTE *data, DWORD dwLen, DWORD dwMagic);
+-- BOOL ExchangeEndOfStream(LPTransferProps props, ULONGLONG qwSent);
+-- BOOL AnswerEndOfStream(SOCKET s, const SOCKADDR_STORAGE *to, INT nToLen, LPTransferProps props, ULONGLONG qwRecvd);
+-- VOID FillControlAnswer(LPControlMsg reply, LPTransferProps props, ULONGLONG qwRecvd);
+-- INT FormatControlReport(CHAR *buf, size_t size, LPControlState c, LPTransferProps props, ULONGLONG qwBytes,
+--		BOOL bReceiver);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file ends transfers explicitly. A UDP receiver used to know it was done only when the packet count in
+--			the first packet had arrived, so after any loss it sat out COMM_TIMEOUT before reporting, and the sender
+--			never learned what had arrived at all.
+--
+--			Now the sender follows its data with an end-of-stream marker carrying its own totals, and the receiver
+--			answers it with what it received: bytes, datagrams, corrupt packets or chunks, the file's integrity result
+--			and the time from its first data to its last. The marker and the answer are datagrams on the transfer's own
+--			socket, told apart from data by their size and magic number. Either can be lost, so the marker is sent up
+--			to CONTROL_TRIES times, and the receiver stays for CONTROL_LINGER_MS after the data ends to answer repeats.
+--			If every marker is lost the receiver falls back on its timeout. The receiver's times come from the data
+--			itself, so neither the timeout nor the linger is counted in the transfer time.
+--
+--			Over TCP the end of the stream (or a file's CHUNK_END) already marks the end of the data, so the sender
+--			just shuts down its side of the connection and reads the receiver's answer. A session connection can't be
+--			shut down, and its acknowledgement already carries the receiver's byte count (see Session.cpp).
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Control.h"
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitControlState
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitControlState(LPControlState c)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Clears the counters and picks an ID for the next transfer. The receiver takes the ID from the sender's marker.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitControlState(LPControlState c)
+{
+	LARGE_INTEGER liNow;
+
+	QueryPerformanceCounter(&liNow);
+	memset(c, 0, sizeof(ControlState));
+	c->dwTransferId = GetTickCount() ^ liNow.LowPart;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NoteDataArrival
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NoteDataArrival(LPControlState c)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called by the receiver as each piece of data arrives, so the receive time runs from the first to the last.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID NoteDataArrival(LPControlState c)
+{
+	QueryPerformanceCounter(&c->liLast);
+	if (c->liFirst.QuadPart == 0)
+		c->liFirst = c->liLast;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsControlMsg
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsControlMsg(const BYTE *data, DWORD dwLen, DWORD dwMagic)
+--							const BYTE *data:	A received datagram.
+--							DWORD dwLen:		Its length.
+--							DWORD dwMagic:		CONTROL_EOS_MAGIC or CONTROL_STATS_MAGIC.
+--
+-- RETURNS: TRUE if the datagram is that kind of control message rather than data.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsControlMsg(const BYTE *data, DWORD dwLen, DWORD dwMagic)
+{
+	return dwLen == sizeof(ControlMsg) && ((const ControlMsg *)data)->dwMagic == dwMagic;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ExchangeEndOfStream
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ExchangeEndOfStream(LPTransferProps props, ULONGLONG qwSent)
+--							LPTransferProps props:	The transfer whose data has all been sent.
+--							ULONGLONG qwSent:		Bytes sent.
+--
+-- RETURNS: TRUE if the receiver's totals arrived (they're in props->control); FALSE otherwise.
+--
+-- NOTES:
+-- Over UDP, sends the end-of-stream marker and waits CONTROL_RETRY_MS for the answer, up to CONTROL_TRIES times.
+-- Answers to other transfers are skipped. Over TCP, shuts down the sending side and waits for the answer the receiver
+-- sends once it has read to the end.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ExchangeEndOfStream(LPTransferProps props, ULONGLONG qwSent)
+{
+	LPControlState	c			= &props->control;
+	ControlMsg		msg;
+	ControlMsg		reply;
+	LARGE_INTEGER	liStart;
+	DWORD			dwTimeout;
+	DWORD			dwNoTimeout	= 0;
+	INT				nRecvd;
+
+	c->bPeer = FALSE;
+	if (props->socket == INVALID_SOCKET)
+		return FALSE;
+	QueryPerformanceCounter(&liStart);
+
+	if (props->nSockType == SOCK_STREAM)
+	{
+		dwTimeout = COMM_TIMEOUT;
+		setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+		shutdown(props->socket, SD_SEND);
+		c->bPeer = RecvAll(props->socket, (CHAR *)&reply, sizeof(reply)) && reply.dwMagic == CONTROL_STATS_MAGIC;
+	}
+	else
+	{
+		memset(&msg, 0, sizeof(msg));
+		msg.dwMagic			= CONTROL_EOS_MAGIC;
+		msg.dwTransferId	= c->dwTransferId;
+		msg.qwBytes			= qwSent;
+		msg.dwDatagrams		= c->dwDatagrams;
+
+		dwTimeout = CONTROL_RETRY_MS;
+		setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+		for (c->dwTries = 0; c->dwTries < CONTROL_TRIES && !c->bPeer; c->dwTries++)
+		{
+			if (sendto(props->socket, (CHAR *)&msg, sizeof(msg), 0, (sockaddr *)&props->addr, props->nAddrLen) ==
+				SOCKET_ERROR)
+				break;
+
+			// A timeout, or an ICMP error from a receiver that isn't there, moves on to the next try
+			while ((nRecvd = recv(props->socket, (CHAR *)&reply, sizeof(reply), 0)) != SOCKET_ERROR)
+			{
+				if (IsControlMsg((BYTE *)&reply, nRecvd, CONTROL_STATS_MAGIC) && reply.dwTransferId == c->dwTransferId)
+				{
+					c->bPeer = TRUE;
+					break;
+				}
+			}
+		}
+	}
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+
+	if (c->bPeer)
+	{
+		c->dwReplyUs		= ElapsedUs(&liStart);
+		c->qwPeerBytes		= reply.qwBytes;
+		c->dwPeerDatagrams	= reply.dwDatagrams;
+		c->dwPeerBad		= reply.dwBad;
+		c->dwPeerResult		= reply.dwResult;
+		c->dwPeerElapsedUs	= reply.dwElapsedUs;
+	}
+	return c->bPeer;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AnswerEndOfStream
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AnswerEndOfStream(SOCKET s, const SOCKADDR_STORAGE *to, INT nToLen, LPTransferProps props,
+--								ULONGLONG qwRecvd)
+--							SOCKET s:					The receiving socket.
+--							const SOCKADDR_STORAGE *to:	Where the marker came from (UDP), or NULL (TCP).
+--							INT nToLen:					The length of the address.
+--							LPTransferProps props:		The transfer that has ended.
+--							ULONGLONG qwRecvd:			Bytes received.
+--
+-- RETURNS: FALSE if the answer couldn't be sent; TRUE otherwise.
+--
+-- NOTES:
+-- Sends the receiver's totals, tagged with the ID from the sender's marker.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL AnswerEndOfStream(SOCKET s, const SOCKADDR_STORAGE *to, INT nToLen, LPTransferProps props, ULONGLONG qwRecvd)
+{
+	ControlMsg reply;
+
+	FillControlAnswer(&reply, props, qwRecvd);
+	props->control.dwTries++;
+
+	if (to == NULL)
+		return SendAll(s, (CHAR *)&reply, sizeof(reply));
+	return sendto(s, (CHAR *)&reply, sizeof(reply), 0, (const sockaddr *)to, nToLen) != SOCKET_ERROR;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FillControlAnswer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FillControlAnswer(LPControlMsg reply, LPTransferProps props, ULONGLONG qwRecvd)
+--							LPControlMsg reply:		Receives the totals.
+--							LPTransferProps props:	The transfer that has ended.
+--							ULONGLONG qwRecvd:		Bytes received.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Fills in the receiver's answer, tagged with the ID from the sender's marker. Multicast receivers send it inside
+-- their own message (see Multicast.cpp).
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FillControlAnswer(LPControlMsg reply, LPTransferProps props, ULONGLONG qwRecvd)
+{
+	LPControlState c = &props->control;
+
+	memset(reply, 0, sizeof(ControlMsg));
+	reply->dwMagic		= CONTROL_STATS_MAGIC;
+	reply->dwTransferId	= c->dwTransferId;
+	reply->qwBytes		= qwRecvd;
+	reply->dwDatagrams	= c->dwDatagrams;
+	reply->dwBad		= props->szFileName[0] != 0 ? props->integrity.dwBadChunks : props->payload.dwBadPackets;
+	reply->dwResult		= props->integrity.dwResult;
+	if (c->liFirst.QuadPart != 0)
+		reply->dwElapsedUs = (DWORD)(TicksToSeconds(c->liLast.QuadPart - c->liFirst.QuadPart) * 1e6);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatControlReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatControlReport(CHAR *buf, size_t size, LPControlState c, LPTransferProps props, ULONGLONG qwBytes,
+--									BOOL bReceiver)
+--							CHAR *buf:				The buffer to write the report section into.
+--							size_t size:			The space left in buf.
+--							LPControlState c:		The end of the transfer.
+--							LPTransferProps props:	The transfer.
+--							ULONGLONG qwBytes:		Bytes sent or received here.
+--							BOOL bReceiver:			Whether this end received the transfer.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The receiver reports how it knew the data was over and, over UDP, what the sender says it sent. The sender reports
+-- the receiver's totals, and for UDP the loss they imply.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatControlReport(CHAR *buf, size_t size, LPControlState c, LPTransferProps props, ULONGLONG qwBytes,
+	BOOL bReceiver)
+{
+	static const CHAR	*szEnds[] = { "timed out (no end-of-stream marker)", "end-of-stream marker",
+									  "every packet arrived", "end of the stream" };
+	static const CHAR	*szResults[] = { "incomplete", "verified", "FAILED" };
+	INT					written		= 0;
+	LONG				lLost;
+	DWORD				dwSent;
+	double				dUs;
+
+	if (bReceiver)
+	{
+		dUs = c->liFirst.QuadPart != 0 ? TicksToSeconds(c->liLast.QuadPart - c->liFirst.QuadPart) * 1e6 : 0.0;
+		written += sprintf_s(buf, size, "End of data: %s; first to last data %.3fms\r\n", szEnds[c->dwEnd], dUs / 1e3);
+
+		// Only a marker says what the sender sent
+		if (props->nSockType == SOCK_DGRAM && c->dwTries != 0)
+		{
+			lLost = (LONG)(c->dwPeerDatagrams - c->dwDatagrams);
+			written += sprintf_s(buf + written, size - written,
+				"Sender sent: %llu bytes in %lu datagrams; %ld lost (%.2f%%), %lu markers answered\r\n",
+				c->qwPeerBytes, c->dwPeerDatagrams, lLost,
+				c->dwPeerDatagrams != 0 ? lLost * 100.0 / c->dwPeerDatagrams : 0.0, c->dwTries);
+		}
+		return written;
+	}
+
+	if (!c->bPeer)
+	{
+		if (props->nSockType == SOCK_DGRAM)
+			return sprintf_s(buf, size, "Receiver's totals: no answer to %lu end-of-stream markers\r\n", c->dwTries);
+		return sprintf_s(buf, size, "Receiver's totals: no answer\r\n");
+	}
+
+	dUs = c->dwPeerElapsedUs;
+	written += sprintf_s(buf, size, "Receiver got: %llu of %llu bytes in %.3fms (%.2f MB/s), %lu corrupt%s%s\r\n",
+		c->qwPeerBytes, qwBytes, dUs / 1e3, dUs > 0.0 ? c->qwPeerBytes / dUs : 0.0, c->dwPeerBad,
+		props->szFileName[0] != 0 ? ", file " : "",
+		props->szFileName[0] != 0 && c->dwPeerResult <= INTEGRITY_FAILED ? szResults[c->dwPeerResult] : "");
+	if (props->nSockType == SOCK_DGRAM)
+	{
+		dwSent = c->dwDatagrams;
+		lLost = (LONG)(dwSent - c->dwPeerDatagrams);
+		written += sprintf_s(buf + written, size - written, "Lost: %ld of %lu datagrams (%.2f%%)\r\n", lLost, dwSent,
+			dwSent != 0 ? lLost * 100.0 / dwSent : 0.0);
+		written += sprintf_s(buf + written, size - written, "Totals arrived: %.2fms after the data (%lu markers)\r\n",
+			c->dwReplyUs / 1e3, c->dwTries);
+	}
+	else
+		written += sprintf_s(buf + written, size - written, "Totals arrived: %.2fms after the data\r\n",
+			c->dwReplyUs / 1e3);
+	return written;
+}
@@ -0,0 +1,48 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Connect.h"
+
+#ifndef COMM_TIMEOUT
+	#define COMM_TIMEOUT 5000
+#endif
+
+#define CONTROL_EOS_MAGIC	0x21534F45	// "EOS!"
+#define CONTROL_STATS_MAGIC	0x54415453	// "STAT"
+#define CONTROL_TRIES		5			// End-of-stream markers sent before the sender gives up on the receiver's totals
+#define CONTROL_RETRY_MS	200			// Time allowed for the totals to come back after each marker
+#define CONTROL_LINGER_MS	500			// How long the receiver keeps answering markers after the data has ended
+
+#pragma pack(push, 1)
+
+/* The end-of-stream marker the sender puts after its data (CONTROL_EOS_MAGIC), and the totals the receiver answers it
+   with (CONTROL_STATS_MAGIC). Over TCP only the answer is sent; the end of the data is the end of the stream. */
+typedef struct _ControlMsg
+{
+	DWORD		dwMagic;
+	DWORD		dwTransferId;
+	ULONGLONG	qwBytes;		// Bytes of data sent or received
+	DWORD		dwDatagrams;	// UDP datagrams of data sent or received (0 over TCP)
+	DWORD		dwBad;			// Answer: test packets or chunks that arrived corrupt
+	DWORD		dwResult;		// Answer: INTEGRITY_* for a file
+	DWORD		dwElapsedUs;	// Answer: time from the first data to the last
+} ControlMsg, *LPControlMsg;
+
+#pragma pack(pop)
+
+VOID InitControlState(LPControlState c);
+VOID NoteDataArrival(LPControlState c);
+BOOL IsControlMsg(const BYTE *data, DWORD dwLen, DWORD dwMagic);
+BOOL ExchangeEndOfStream(LPTransferProps props, ULONGLONG qwSent);
+BOOL AnswerEndOfStream(SOCKET s, const SOCKADDR_STORAGE *to, INT nToLen, LPTransferProps props, ULONGLONG qwRecvd);
+VOID FillControlAnswer(LPControlMsg reply, LPTransferProps props, ULONGLONG qwRecvd);
+INT FormatControlReport(CHAR *buf, size_t size, LPControlState c, LPTransferProps props, ULONGLONG qwBytes,
+	BOOL bReceiver);
+
+#endif
@@ -0,0 +1,1820 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Crypt.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- BOOL InitCrypt();
+-- BOOL IsCipherAvailable(DWORD dwCipher);
+-- VOID InitCryptState(LPCryptState c);
+-- BOOL LoadPsk(LPCryptState c, const CHAR *szValue);
+-- VOID KeyCrypt(LPCryptState c, DWORD dwCipher, const BYTE *key, const BYTE *salt);
+-- BOOL SendCryptHello(LPTransferProps props);
+-- BOOL AcceptCryptHello(LPTransferProps props);
+-- BOOL IsCryptHello(const BYTE *data, DWORD dwLen);
+-- VOID AnswerCryptHello(LPTransferProps props, const SOCKADDR_STORAGE *to, INT nToLen, const BYTE *data, DWORD dwLen);
+-- DWORD SealOverhead(LPCryptState c, BOOL bChunks);
+-- VOID SealChunk(LPCryptState c, LPWSABUF pwsaBuf);
+-- VOID SealPacket(LPCryptState c, LPWSABUF pwsaBuf, DWORD dwLen);
+-- BOOL OpenChunk(LPCryptState c, LPChunkHeader hdr);
+-- BOOL OpenPacket(LPCryptState c, BYTE *data, DWORD dwLen);
+-- DWORD FeedRecord(LPCryptState c, const BYTE *data, DWORD dwLen, BYTE **ppPlain);
+-- VOID EndCrypt(LPCryptState c);
+-- INT FormatCryptReport(CHAR *buf, size_t size, LPCryptState c, double dTransferSec, BOOL bReceiver);
+-- static __m128i ExpandLow(__m128i k, __m128i assist);
+-- static __m128i ExpandHigh(__m128i k, __m128i low);
+-- static VOID AesExpand256(const BYTE *key, __m128i *rk);
+-- static __m128i AesBlock(const __m128i *rk, __m128i b);
+-- static VOID ClMul(__m128i a, __m128i b, __m128i *lo, __m128i *mid, __m128i *hi);
+-- static __m128i GfReduce(__m128i lo, __m128i mid, __m128i hi);
+-- static __m128i GfMul(__m128i a, __m128i b);
+-- static VOID GcmKey(BYTE *state, const BYTE *key);
+-- static VOID GcmCrypt(const BYTE *state, const BYTE *iv, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen,
+--		BOOL bSeal, BYTE *tag);
+-- static VOID ChaChaBlock(const DWORD *in, DWORD *out);
+-- static VOID ChaChaXor(const BYTE *key, const BYTE *iv, DWORD dwCounter, BYTE *data, DWORD dwLen);
+-- static VOID PolyInit(LPPoly1305 p, const BYTE *key);
+-- static VOID PolyBlocks(LPPoly1305 p, const BYTE *m, DWORD dwLen);
+-- static VOID PolyPadded(LPPoly1305 p, const BYTE *m, DWORD dwLen);
+-- static VOID PolyFinish(LPPoly1305 p, BYTE *tag);
+-- static VOID ChaChaPolyCrypt(const BYTE *key, const BYTE *iv, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen,
+--		BOOL bSeal, BYTE *tag);
+-- static VOID Aead(LPCryptState c, ULONGLONG qwSeq, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen, BOOL bSeal,
+--		BYTE *tag);
+-- static BOOL SelfTest(DWORD dwCipher);
+-- static BOOL Hmac(const BYTE *key, DWORD dwKeyLen, const BYTE *a, DWORD dwA, const BYTE *b, DWORD dwB, BYTE *mac);
+-- static BOOL DeriveKeys(LPCryptState c, DWORD dwCipher, const CryptHello *hello, LPCryptReply reply);
+-- static BOOL MakeReply(LPCryptState c, const CryptHello *hello, LPCryptReply reply);
+-- static VOID Seal(LPCryptState c, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen);
+-- static BOOL IsReplay(LPCryptState c, ULONGLONG qwSeq);
+-- static BOOL Open(LPCryptState c, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen);
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file encrypts transfers between two ends that share a key (-psk), so the program can be used on
+--			links between sites. Every record the client sends, a file chunk or a test packet, is sealed on its
+--			own with an AEAD cipher: AES-256-GCM where both ends have AES-NI and PCLMULQDQ, otherwise
+--			ChaCha20-Poly1305. A record carries its 64-bit counter and a 16-byte tag after it; with a 4-byte salt
+--			from the handshake the counter makes the 96-bit nonce, so records can be opened in any order and a
+--			lost datagram costs nothing but itself. A chunk's header stays in the clear, authenticated as
+--			associated data, since the receiver needs it to find the chunk in the stream; its CRC would say
+--			something about the data, so it travels inside the ciphertext instead. Over TCP a test packet stream
+--			is a run of fixed-size records (each packet and its trailer). A receiver drops a UDP datagram that
+--			doesn't open, or whose counter it has already seen or is more than CRYPT_WINDOW behind; over TCP the
+--			transfer is abandoned.
+--
+--			The handshake is one exchange before the data (after the session header, before the file query): the
+--			client's hello carries a random nonce and the ciphers it will use, and the server's reply its own
+--			nonce, its choice and a proof. HKDF-SHA256 over the key with both nonces as salt gives the record key,
+--			the salt and a confirmation key; the proof is a MAC with the confirmation key over the hello and the
+--			reply, so a client whose key differs finds out at once, and every transfer has a fresh key whatever the
+--			counters do. A server whose key differs finds out at the first record. Over UDP the hello is sent
+--			again if the reply doesn't come, and a repeated hello gets the same reply.
+--
+--			AES-GCM encrypts four blocks at a time, so each AESENC's latency is covered by the other three, and
+--			folds four ciphertext blocks into GHASH with one reduction, using H through H^4 computed with the key.
+--			ChaCha20 and Poly1305 are portable C. Both are checked against the published test vectors when the
+--			program starts; a cipher that fails isn't offered. HMAC and the random nonces come from CNG. Only the
+--			client's data is sealed: duplex packets and multicast, which has no single peer to agree a key with,
+--			are refused with -psk. The end-of-stream and session messages and the file query are not encrypted.
+--			Byte counts in the report leave out what sealing adds, so they compare with a plaintext transfer.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Crypt.h"
+
+#pragma comment(lib, "bcrypt.lib")
+
+static BOOL					bAesHardware	= FALSE;	// AES-NI, PCLMULQDQ and SSSE3, and the AES-GCM self-test passed
+static BOOL					bChaChaOk		= FALSE;
+static BCRYPT_ALG_HANDLE	hHmac			= NULL;		// HMAC-SHA256
+
+static const BYTE			kdfLabel[]		= "Assn2 record key";
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ExpandLow
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ExpandLow(__m128i k, __m128i assist)
+--							__m128i k:		The round key two before the one being made.
+--							__m128i assist:	AESKEYGENASSIST of the round key before it, with the round constant.
+--
+-- RETURNS: The next even-numbered AES-256 round key.
+---------------------------------------------------------------------------------------------------------------------------*/
+static __m128i ExpandLow(__m128i k, __m128i assist)
+{
+	k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+	k = _mm_xor_si128(k, _mm_slli_si128(k, 8));
+	return _mm_xor_si128(k, _mm_shuffle_epi32(assist, 0xFF));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ExpandHigh
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ExpandHigh(__m128i k, __m128i low)
+--							__m128i k:		The round key two before the one being made.
+--							__m128i low:	The round key just made by ExpandLow.
+--
+-- RETURNS: The next odd-numbered AES-256 round key.
+---------------------------------------------------------------------------------------------------------------------------*/
+static __m128i ExpandHigh(__m128i k, __m128i low)
+{
+	k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+	k = _mm_xor_si128(k, _mm_slli_si128(k, 8));
+	return _mm_xor_si128(k, _mm_shuffle_epi32(_mm_aeskeygenassist_si128(low, 0x00), 0xAA));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AesExpand256
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AesExpand256(const BYTE *key, __m128i *rk)
+--							const BYTE *key:	A 256-bit key.
+--							__m128i *rk:		Receives the 15 round keys.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- AESKEYGENASSIST takes its round constant as an immediate, so the rounds are written out.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID AesExpand256(const BYTE *key, __m128i *rk)
+{
+	rk[0]	= _mm_loadu_si128((const __m128i *)key);
+	rk[1]	= _mm_loadu_si128((const __m128i *)(key + 16));
+	rk[2]	= ExpandLow(rk[0], _mm_aeskeygenassist_si128(rk[1], 0x01));
+	rk[3]	= ExpandHigh(rk[1], rk[2]);
+	rk[4]	= ExpandLow(rk[2], _mm_aeskeygenassist_si128(rk[3], 0x02));
+	rk[5]	= ExpandHigh(rk[3], rk[4]);
+	rk[6]	= ExpandLow(rk[4], _mm_aeskeygenassist_si128(rk[5], 0x04));
+	rk[7]	= ExpandHigh(rk[5], rk[6]);
+	rk[8]	= ExpandLow(rk[6], _mm_aeskeygenassist_si128(rk[7], 0x08));
+	rk[9]	= ExpandHigh(rk[7], rk[8]);
+	rk[10]	= ExpandLow(rk[8], _mm_aeskeygenassist_si128(rk[9], 0x10));
+	rk[11]	= ExpandHigh(rk[9], rk[10]);
+	rk[12]	= ExpandLow(rk[10], _mm_aeskeygenassist_si128(rk[11], 0x20));
+	rk[13]	= ExpandHigh(rk[11], rk[12]);
+	rk[14]	= ExpandLow(rk[12], _mm_aeskeygenassist_si128(rk[13], 0x40));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AesBlock
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AesBlock(const __m128i *rk, __m128i b)
+--							const __m128i *rk:	The round keys.
+--							__m128i b:			A block.
+--
+-- RETURNS: The block encrypted with AES-256.
+---------------------------------------------------------------------------------------------------------------------------*/
+static __m128i AesBlock(const __m128i *rk, __m128i b)
+{
+	INT i;
+
+	b = _mm_xor_si128(b, rk[0]);
+	for (i = 1; i < 14; i++)
+		b = _mm_aesenc_si128(b, rk[i]);
+	return _mm_aesenclast_si128(b, rk[14]);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ClMul
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ClMul(__m128i a, __m128i b, __m128i *lo, __m128i *mid, __m128i *hi)
+--							__m128i a, b:		Field elements, byte-reversed.
+--							__m128i *lo, *hi:	Accumulate the low and high halves of the 256-bit carry-less product.
+--							__m128i *mid:		Accumulates the two cross terms, which straddle them.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Reduction is linear, so GCM's four-block aggregation sums the unreduced products and reduces once.
+---------------------------------------------------------------------------------------------------------------------------*/
+static inline VOID ClMul(__m128i a, __m128i b, __m128i *lo, __m128i *mid, __m128i *hi)
+{
+	*lo		= _mm_xor_si128(*lo, _mm_clmulepi64_si128(a, b, 0x00));
+	*mid	= _mm_xor_si128(*mid, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01)));
+	*hi		= _mm_xor_si128(*hi, _mm_clmulepi64_si128(a, b, 0x11));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GfReduce
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GfReduce(__m128i lo, __m128i mid, __m128i hi)
+--							__m128i lo, mid, hi:	A product (or sum of products) from ClMul.
+--
+-- RETURNS: The product in GF(2^128), byte-reversed.
+--
+-- NOTES:
+-- GCM's bits are reflected, so the 256-bit product is shifted left a bit before being reduced modulo
+-- x^128 + x^7 + x^2 + x + 1 (Intel's carry-less multiplication white paper, algorithm 5).
+---------------------------------------------------------------------------------------------------------------------------*/
+static __m128i GfReduce(__m128i lo, __m128i mid, __m128i hi)
+{
+	__m128i t2, t3, t4, t5, t6, t7, t8, t9;
+
+	t3 = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+	t6 = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+	t7 = _mm_srli_epi32(t3, 31);
+	t8 = _mm_srli_epi32(t6, 31);
+	t3 = _mm_slli_epi32(t3, 1);
+	t6 = _mm_slli_epi32(t6, 1);
+	t9 = _mm_srli_si128(t7, 12);
+	t8 = _mm_slli_si128(t8, 4);
+	t7 = _mm_slli_si128(t7, 4);
+	t3 = _mm_or_si128(t3, t7);
+	t6 = _mm_or_si128(_mm_or_si128(t6, t8), t9);
+
+	t7 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(t3, 31), _mm_slli_epi32(t3, 30)), _mm_slli_epi32(t3, 25));
+	t8 = _mm_srli_si128(t7, 4);
+	t7 = _mm_slli_si128(t7, 12);
+	t3 = _mm_xor_si128(t3, t7);
+
+	t2 = _mm_srli_epi32(t3, 1);
+	t4 = _mm_srli_epi32(t3, 2);
+	t5 = _mm_srli_epi32(t3, 7);
+	t2 = _mm_xor_si128(_mm_xor_si128(t2, t4), _mm_xor_si128(t5, t8));
+	t3 = _mm_xor_si128(t3, t2);
+	return _mm_xor_si128(t6, t3);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GfMul
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GfMul(__m128i a, __m128i b)
+--							__m128i a, b:	Field elements, byte-reversed.
+--
+-- RETURNS: Their product, byte-reversed.
+---------------------------------------------------------------------------------------------------------------------------*/
+static __m128i GfMul(__m128i a, __m128i b)
+{
+	__m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+
+	ClMul(a, b, &lo, &mid, &hi);
+	return GfReduce(lo, mid, hi);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GcmKey
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GcmKey(BYTE *state, const BYTE *key)
+--							BYTE *state:		CRYPT_KEY_STATE bytes; receives the round keys, then H, H^2, H^3 and H^4.
+--							const BYTE *key:	A 256-bit key.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID GcmKey(BYTE *state, const BYTE *key)
+{
+	const __m128i	bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i			rk[15];
+	__m128i			h[4];
+	INT				i;
+
+	AesExpand256(key, rk);
+	h[0] = _mm_shuffle_epi8(AesBlock(rk, _mm_setzero_si128()), bswap);
+	for (i = 1; i < 4; i++)
+		h[i] = GfMul(h[i - 1], h[0]);
+
+	for (i = 0; i < 15; i++)
+		_mm_storeu_si128((__m128i *)state + i, rk[i]);
+	for (i = 0; i < 4; i++)
+		_mm_storeu_si128((__m128i *)state + 15 + i, h[i]);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GcmCrypt
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GcmCrypt(const BYTE *state, const BYTE *iv, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen,
+--						BOOL bSeal, BYTE *tag)
+--							const BYTE *state:	The key, from GcmKey.
+--							const BYTE *iv:		The 96-bit nonce.
+--							const BYTE *aad:	Data authenticated but not encrypted (may be NULL if dwAad is 0).
+--							DWORD dwAad:		Its length.
+--							BYTE *data:			The data, encrypted or decrypted in place.
+--							DWORD dwLen:		Its length.
+--							BOOL bSeal:			TRUE to encrypt, FALSE to decrypt.
+--							BYTE *tag:			Receives the 16-byte tag (of the ciphertext, either way).
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- The counter is kept byte-reversed so its last word can be incremented with a plain add. Whole groups of four blocks
+-- go through AES side by side and into GHASH together; what's left goes a block at a time, the last one padded.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID GcmCrypt(const BYTE *state, const BYTE *iv, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen,
+	BOOL bSeal, BYTE *tag)
+{
+	const __m128i	bswap	= _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i	one		= _mm_set_epi32(0, 0, 0, 1);
+	__m128i			rk[15], h[4];
+	__m128i			j0, ctr, x, lo, mid, hi;
+	__m128i			k0, k1, k2, k3, d0, d1, d2, d3;
+	BYTE			block[16];
+	DWORD			i, r, dwRem;
+
+	for (i = 0; i < 15; i++)
+		rk[i] = _mm_loadu_si128((const __m128i *)state + i);
+	for (i = 0; i < 4; i++)
+		h[i] = _mm_loadu_si128((const __m128i *)state + 15 + i);
+
+	memcpy(block, iv, 12);
+	block[12] = block[13] = block[14] = 0;
+	block[15] = 1;
+	j0 = _mm_loadu_si128((const __m128i *)block);
+	ctr = _mm_shuffle_epi8(j0, bswap);
+	x = _mm_setzero_si128();
+
+	for (i = 0; i + 16 <= dwAad; i += 16)
+		x = GfMul(_mm_xor_si128(x, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(aad + i)), bswap)), h[0]);
+	if (i < dwAad)
+	{
+		memset(block, 0, sizeof(block));
+		memcpy(block, aad + i, dwAad - i);
+		x = GfMul(_mm_xor_si128(x, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)block), bswap)), h[0]);
+	}
+
+	for (i = 0; i + 64 <= dwLen; i += 64)
+	{
+		k0 = _mm_xor_si128(_mm_shuffle_epi8(ctr = _mm_add_epi32(ctr, one), bswap), rk[0]);
+		k1 = _mm_xor_si128(_mm_shuffle_epi8(ctr = _mm_add_epi32(ctr, one), bswap), rk[0]);
+		k2 = _mm_xor_si128(_mm_shuffle_epi8(ctr = _mm_add_epi32(ctr, one), bswap), rk[0]);
+		k3 = _mm_xor_si128(_mm_shuffle_epi8(ctr = _mm_add_epi32(ctr, one), bswap), rk[0]);
+		for (r = 1; r < 14; r++)
+		{
+			k0 = _mm_aesenc_si128(k0, rk[r]);
+			k1 = _mm_aesenc_si128(k1, rk[r]);
+			k2 = _mm_aesenc_si128(k2, rk[r]);
+			k3 = _mm_aesenc_si128(k3, rk[r]);
+		}
+		k0 = _mm_aesenclast_si128(k0, rk[14]);
+		k1 = _mm_aesenclast_si128(k1, rk[14]);
+		k2 = _mm_aesenclast_si128(k2, rk[14]);
+		k3 = _mm_aesenclast_si128(k3, rk[14]);
+
+		d0 = _mm_loadu_si128((const __m128i *)(data + i));
+		d1 = _mm_loadu_si128((const __m128i *)(data + i + 16));
+		d2 = _mm_loadu_si128((const __m128i *)(data + i + 32));
+		d3 = _mm_loadu_si128((const __m128i *)(data + i + 48));
+		k0 = _mm_xor_si128(k0, d0);
+		k1 = _mm_xor_si128(k1, d1);
+		k2 = _mm_xor_si128(k2, d2);
+		k3 = _mm_xor_si128(k3, d3);
+		_mm_storeu_si128((__m128i *)(data + i), k0);
+		_mm_storeu_si128((__m128i *)(data + i + 16), k1);
+		_mm_storeu_si128((__m128i *)(data + i + 32), k2);
+		_mm_storeu_si128((__m128i *)(data + i + 48), k3);
+
+		// GHASH is over the ciphertext: what was just written when sealing, what was read when opening
+		if (bSeal)
+		{
+			d0 = k0;
+			d1 = k1;
+			d2 = k2;
+			d3 = k3;
+		}
+		lo = mid = hi = _mm_setzero_si128();
+		ClMul(_mm_xor_si128(x, _mm_shuffle_epi8(d0, bswap)), h[3], &lo, &mid, &hi);
+		ClMul(_mm_shuffle_epi8(d1, bswap), h[2], &lo, &mid, &hi);
+		ClMul(_mm_shuffle_epi8(d2, bswap), h[1], &lo, &mid, &hi);
+		ClMul(_mm_shuffle_epi8(d3, bswap), h[0], &lo, &mid, &hi);
+		x = GfReduce(lo, mid, hi);
+	}
+
+	for (; i < dwLen; i += 16)
+	{
+		dwRem = min(dwLen - i, (DWORD)16);
+		memset(block, 0, sizeof(block));
+		memcpy(block, data + i, dwRem);
+		d0 = _mm_loadu_si128((const __m128i *)block);
+		k0 = _mm_xor_si128(AesBlock(rk, _mm_shuffle_epi8(ctr = _mm_add_epi32(ctr, one), bswap)), d0);
+		_mm_storeu_si128((__m128i *)block, k0);
+		memcpy(data + i, block, dwRem);
+
+		// The padding of a short last block is zeros, not keystream
+		if (bSeal)
+		{
+			memset(block + dwRem, 0, sizeof(block) - dwRem);
+			d0 = _mm_loadu_si128((const __m128i *)block);
+		}
+		x = GfMul(_mm_xor_si128(x, _mm_shuffle_epi8(d0, bswap)), h[0]);
+	}
+
+	// The lengths in bits, already in GHASH's byte order
+	x = GfMul(_mm_xor_si128(x, _mm_set_epi32(dwAad >> 29, dwAad << 3, dwLen >> 29, dwLen << 3)), h[0]);
+	_mm_storeu_si128((__m128i *)tag, _mm_xor_si128(AesBlock(rk, j0), _mm_shuffle_epi8(x, bswap)));
+}
+
+#define CHACHA_QR(a, b, c, d) \
+	a += b; d ^= a; d = _rotl(d, 16); \
+	c += d; b ^= c; b = _rotl(b, 12); \
+	a += b; d ^= a; d = _rotl(d, 8); \
+	c += d; b ^= c; b = _rotl(b, 7);
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ChaChaBlock
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ChaChaBlock(const DWORD *in, DWORD *out)
+--							const DWORD *in:	The 16-word state: constants, key, counter and nonce.
+--							DWORD *out:			Receives 64 bytes of keystream.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID ChaChaBlock(const DWORD *in, DWORD *out)
+{
+	DWORD	x[16];
+	INT		i;
+
+	memcpy(x, in, sizeof(x));
+	for (i = 0; i < 10; i++)
+	{
+		CHACHA_QR(x[0], x[4], x[8], x[12]);
+		CHACHA_QR(x[1], x[5], x[9], x[13]);
+		CHACHA_QR(x[2], x[6], x[10], x[14]);
+		CHACHA_QR(x[3], x[7], x[11], x[15]);
+		CHACHA_QR(x[0], x[5], x[10], x[15]);
+		CHACHA_QR(x[1], x[6], x[11], x[12]);
+		CHACHA_QR(x[2], x[7], x[8], x[13]);
+		CHACHA_QR(x[3], x[4], x[9], x[14]);
+	}
+	for (i = 0; i < 16; i++)
+		out[i] = x[i] + in[i];
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ChaChaXor
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ChaChaXor(const BYTE *key, const BYTE *iv, DWORD dwCounter, BYTE *data, DWORD dwLen)
+--							const BYTE *key:	A 256-bit key.
+--							const BYTE *iv:		The 96-bit nonce.
+--							DWORD dwCounter:	The first block's number.
+--							BYTE *data:			The data to XOR with the keystream, in place.
+--							DWORD dwLen:		Its length.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Both ends are little-endian x86, so the key, nonce and data are read as words directly.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID ChaChaXor(const BYTE *key, const BYTE *iv, DWORD dwCounter, BYTE *data, DWORD dwLen)
+{
+	DWORD	state[16], ks[16];
+	DWORD	dwWord;
+	DWORD	i, n;
+
+	state[0] = 0x61707865;	// "expand 32-byte k"
+	state[1] = 0x3320646E;
+	state[2] = 0x79622D32;
+	state[3] = 0x6B206574;
+	memcpy(state + 4, key, CRYPT_KEY_SIZE);
+	state[12] = dwCounter;
+	memcpy(state + 13, iv, 12);
+
+	for (; dwLen >= 64; data += 64, dwLen -= 64)
+	{
+		ChaChaBlock(state, ks);
+		state[12]++;
+		for (i = 0; i < 16; i++)
+		{
+			memcpy(&dwWord, data + 4 * i, sizeof(DWORD));
+			dwWord ^= ks[i];
+			memcpy(data + 4 * i, &dwWord, sizeof(DWORD));
+		}
+	}
+
+	if (dwLen > 0)
+	{
+		ChaChaBlock(state, ks);
+		for (n = 0; n < dwLen; n++)
+			data[n] ^= ((BYTE *)ks)[n];
+	}
+	SecureZeroMemory(ks, sizeof(ks));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PolyInit
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PolyInit(LPPoly1305 p, const BYTE *key)
+--							LPPoly1305 p:		The MAC to start.
+--							const BYTE *key:	Its one-time 32-byte key: r, then the pad s.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID PolyInit(LPPoly1305 p, const BYTE *key)
+{
+	DWORD	w[4];
+	INT		i;
+
+	// r is clamped as it's split into limbs
+	memcpy(w, key, 16);
+	p->r[0] = w[0] & 0x3FFFFFF;
+	p->r[1] = ((w[0] >> 26) | (w[1] << 6)) & 0x3FFFF03;
+	p->r[2] = ((w[1] >> 20) | (w[2] << 12)) & 0x3FFC0FF;
+	p->r[3] = ((w[2] >> 14) | (w[3] << 18)) & 0x3F03FFF;
+	p->r[4] = (w[3] >> 8) & 0x00FFFFF;
+	for (i = 0; i < 5; i++)
+		p->h[i] = 0;
+	memcpy(p->pad, key + 16, 16);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PolyBlocks
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PolyBlocks(LPPoly1305 p, const BYTE *m, DWORD dwLen)
+--							LPPoly1305 p:		The MAC.
+--							const BYTE *m:		Whole 16-byte blocks of the message.
+--							DWORD dwLen:		Their length (a multiple of 16).
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- h = (h + block + 2^128) * r mod 2^130 - 5, with the 2^130 wrapping round as a multiple of 5 (poly1305-donna).
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID PolyBlocks(LPPoly1305 p, const BYTE *m, DWORD dwLen)
+{
+	DWORD		r0 = p->r[0], r1 = p->r[1], r2 = p->r[2], r3 = p->r[3], r4 = p->r[4];
+	DWORD		s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+	DWORD		h0 = p->h[0], h1 = p->h[1], h2 = p->h[2], h3 = p->h[3], h4 = p->h[4];
+	DWORD		w[4];
+	DWORD		c;
+	ULONGLONG	d0, d1, d2, d3, d4;
+
+	for (; dwLen >= 16; m += 16, dwLen -= 16)
+	{
+		memcpy(w, m, 16);
+		h0 += w[0] & 0x3FFFFFF;
+		h1 += ((w[0] >> 26) | (w[1] << 6)) & 0x3FFFFFF;
+		h2 += ((w[1] >> 20) | (w[2] << 12)) & 0x3FFFFFF;
+		h3 += ((w[2] >> 14) | (w[3] << 18)) & 0x3FFFFFF;
+		h4 += (w[3] >> 8) | (1 << 24);
+
+		d0 = (ULONGLONG)h0 * r0 + (ULONGLONG)h1 * s4 + (ULONGLONG)h2 * s3 + (ULONGLONG)h3 * s2 + (ULONGLONG)h4 * s1;
+		d1 = (ULONGLONG)h0 * r1 + (ULONGLONG)h1 * r0 + (ULONGLONG)h2 * s4 + (ULONGLONG)h3 * s3 + (ULONGLONG)h4 * s2;
+		d2 = (ULONGLONG)h0 * r2 + (ULONGLONG)h1 * r1 + (ULONGLONG)h2 * r0 + (ULONGLONG)h3 * s4 + (ULONGLONG)h4 * s3;
+		d3 = (ULONGLONG)h0 * r3 + (ULONGLONG)h1 * r2 + (ULONGLONG)h2 * r1 + (ULONGLONG)h3 * r0 + (ULONGLONG)h4 * s4;
+		d4 = (ULONGLONG)h0 * r4 + (ULONGLONG)h1 * r3 + (ULONGLONG)h2 * r2 + (ULONGLONG)h3 * r1 + (ULONGLONG)h4 * r0;
+
+		c = (DWORD)(d0 >> 26);	h0 = (DWORD)d0 & 0x3FFFFFF;
+		d1 += c;	c = (DWORD)(d1 >> 26);	h1 = (DWORD)d1 & 0x3FFFFFF;
+		d2 += c;	c = (DWORD)(d2 >> 26);	h2 = (DWORD)d2 & 0x3FFFFFF;
+		d3 += c;	c = (DWORD)(d3 >> 26);	h3 = (DWORD)d3 & 0x3FFFFFF;
+		d4 += c;	c = (DWORD)(d4 >> 26);	h4 = (DWORD)d4 & 0x3FFFFFF;
+		h0 += c * 5;	c = h0 >> 26;	h0 &= 0x3FFFFFF;
+		h1 += c;
+	}
+
+	p->h[0] = h0;
+	p->h[1] = h1;
+	p->h[2] = h2;
+	p->h[3] = h3;
+	p->h[4] = h4;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PolyPadded
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PolyPadded(LPPoly1305 p, const BYTE *m, DWORD dwLen)
+--							LPPoly1305 p:		The MAC.
+--							const BYTE *m:		A part of the AEAD's MAC input (the associated data or ciphertext).
+--							DWORD dwLen:		Its length.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- RFC 8439 pads each part with zeros to a whole block.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID PolyPadded(LPPoly1305 p, const BYTE *m, DWORD dwLen)
+{
+	BYTE block[16];
+
+	PolyBlocks(p, m, dwLen & ~15);
+	if (dwLen & 15)
+	{
+		memset(block, 0, sizeof(block));
+		memcpy(block, m + (dwLen & ~15), dwLen & 15);
+		PolyBlocks(p, block, 16);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PolyFinish
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PolyFinish(LPPoly1305 p, BYTE *tag)
+--							LPPoly1305 p:		The MAC, with the whole message added.
+--							BYTE *tag:			Receives the 16-byte tag.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Fully reduces h (choosing h or h - p without a branch), then adds the pad modulo 2^128.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID PolyFinish(LPPoly1305 p, BYTE *tag)
+{
+	DWORD		h0 = p->h[0], h1 = p->h[1], h2 = p->h[2], h3 = p->h[3], h4 = p->h[4];
+	DWORD		g0, g1, g2, g3, g4;
+	DWORD		c, mask;
+	DWORD		w[4];
+	ULONGLONG	f;
+
+	c = h1 >> 26;	h1 &= 0x3FFFFFF;
+	h2 += c;	c = h2 >> 26;	h2 &= 0x3FFFFFF;
+	h3 += c;	c = h3 >> 26;	h3 &= 0x3FFFFFF;
+	h4 += c;	c = h4 >> 26;	h4 &= 0x3FFFFFF;
+	h0 += c * 5;	c = h0 >> 26;	h0 &= 0x3FFFFFF;
+	h1 += c;
+
+	g0 = h0 + 5;	c = g0 >> 26;	g0 &= 0x3FFFFFF;
+	g1 = h1 + c;	c = g1 >> 26;	g1 &= 0x3FFFFFF;
+	g2 = h2 + c;	c = g2 >> 26;	g2 &= 0x3FFFFFF;
+	g3 = h3 + c;	c = g3 >> 26;	g3 &= 0x3FFFFFF;
+	g4 = h4 + c - (1 << 26);
+
+	mask = (g4 >> 31) - 1;
+	h0 = (h0 & ~mask) | (g0 & mask);
+	h1 = (h1 & ~mask) | (g1 & mask);
+	h2 = (h2 & ~mask) | (g2 & mask);
+	h3 = (h3 & ~mask) | (g3 & mask);
+	h4 = (h4 & ~mask) | (g4 & mask);
+
+	f = (ULONGLONG)(h0 | (h1 << 26)) + p->pad[0];						w[0] = (DWORD)f;
+	f = (ULONGLONG)((h1 >> 6) | (h2 << 20)) + p->pad[1] + (f >> 32);	w[1] = (DWORD)f;
+	f = (ULONGLONG)((h2 >> 12) | (h3 << 14)) + p->pad[2] + (f >> 32);	w[2] = (DWORD)f;
+	f = (ULONGLONG)((h3 >> 18) | (h4 << 8)) + p->pad[3] + (f >> 32);	w[3] = (DWORD)f;
+	memcpy(tag, w, CRYPT_TAG_SIZE);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ChaChaPolyCrypt
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ChaChaPolyCrypt(const BYTE *key, const BYTE *iv, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen,
+--								BOOL bSeal, BYTE *tag)
+--							Arguments as for GcmCrypt, with the 256-bit key itself.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- RFC 8439's AEAD: the first keystream block is the Poly1305 key and the data is encrypted from block 1. The MAC is
+-- over the ciphertext, so it's taken after encrypting and before decrypting.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID ChaChaPolyCrypt(const BYTE *key, const BYTE *iv, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen,
+	BOOL bSeal, BYTE *tag)
+{
+	Poly1305	p;
+	BYTE		polyKey[64];
+	DWORD		lens[4];
+
+	memset(polyKey, 0, sizeof(polyKey));
+	ChaChaXor(key, iv, 0, polyKey, sizeof(polyKey));
+	PolyInit(&p, polyKey);
+
+	if (bSeal)
+		ChaChaXor(key, iv, 1, data, dwLen);
+	PolyPadded(&p, aad, dwAad);
+	PolyPadded(&p, data, dwLen);
+	lens[0] = dwAad;
+	lens[1] = 0;
+	lens[2] = dwLen;
+	lens[3] = 0;
+	PolyBlocks(&p, (BYTE *)lens, sizeof(lens));
+	PolyFinish(&p, tag);
+	if (!bSeal)
+		ChaChaXor(key, iv, 1, data, dwLen);
+
+	SecureZeroMemory(polyKey, sizeof(polyKey));
+	SecureZeroMemory(&p, sizeof(p));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Aead
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Aead(LPCryptState c, ULONGLONG qwSeq, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen, BOOL bSeal,
+--					BYTE *tag)
+--							LPCryptState c:		The transfer's key and cipher.
+--							ULONGLONG qwSeq:	The record's counter; with the salt, its nonce.
+--							Other arguments as for GcmCrypt.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID Aead(LPCryptState c, ULONGLONG qwSeq, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen, BOOL bSeal,
+	BYTE *tag)
+{
+	BYTE iv[12];
+
+	memcpy(iv, c->salt, CRYPT_SALT_SIZE);
+	memcpy(iv + CRYPT_SALT_SIZE, &qwSeq, CRYPT_SEQ_SIZE);
+	if (c->dwCipher == CRYPT_AESGCM)
+		GcmCrypt(c->key, iv, aad, dwAad, data, dwLen, bSeal, tag);
+	else
+		ChaChaPolyCrypt(c->key, iv, aad, dwAad, data, dwLen, bSeal, tag);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SelfTest
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SelfTest(DWORD dwCipher)
+--							DWORD dwCipher:		CRYPT_AESGCM or CRYPT_CHACHA.
+--
+-- RETURNS: TRUE if the cipher gives the published tag for its test vector and opens what it sealed.
+--
+-- NOTES:
+-- AES-GCM uses test case 16 of the GCM specification (a 60-byte message, so the last block is short), ChaCha20-
+-- Poly1305 the example in section 2.8.2 of RFC 8439. The tag covers the ciphertext, so matching it checks both.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL SelfTest(DWORD dwCipher)
+{
+	static const BYTE gcmKey[32] = {
+		0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C, 0x6D, 0x6A, 0x8F, 0x94, 0x67, 0x30, 0x83, 0x08,
+		0xFE, 0xFF, 0xE9, 0x92, 0x86, 0x65, 0x73, 0x1C, 0x6D, 0x6A, 0x8F, 0x94, 0x67, 0x30, 0x83, 0x08 };
+	static const BYTE gcmIv[12] = { 0xCA, 0xFE, 0xBA, 0xBE, 0xFA, 0xCE, 0xDB, 0xAD, 0xDE, 0xCA, 0xF8, 0x88 };
+	static const BYTE gcmAad[20] = {
+		0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED, 0xFA, 0xCE, 0xDE, 0xAD, 0xBE, 0xEF,
+		0xAB, 0xAD, 0xDA, 0xD2 };
+	static const BYTE gcmText[60] = {
+		0xD9, 0x31, 0x32, 0x25, 0xF8, 0x84, 0x06, 0xE5, 0xA5, 0x59, 0x09, 0xC5, 0xAF, 0xF5, 0x26, 0x9A,
+		0x86, 0xA7, 0xA9, 0x53, 0x15, 0x34, 0xF7, 0xDA, 0x2E, 0x4C, 0x30, 0x3D, 0x8A, 0x31, 0x8A, 0x72,
+		0x1C, 0x3C, 0x0C, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2F, 0xCF, 0x0E, 0x24, 0x49, 0xA6, 0xB5, 0x25,
+		0xB1, 0x6A, 0xED, 0xF5, 0xAA, 0x0D, 0xE6, 0x57, 0xBA, 0x63, 0x7B, 0x39 };
+	static const BYTE gcmTag[16] = {
+		0x76, 0xFC, 0x6E, 0xCE, 0x0F, 0x4E, 0x17, 0x68, 0xCD, 0xDF, 0x88, 0x53, 0xBB, 0x2D, 0x55, 0x1B };
+	static const BYTE ccIv[12] = { 0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47 };
+	static const BYTE ccAad[12] = { 0x50, 0x51, 0x52, 0x53, 0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7 };
+	static const CHAR ccText[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the "
+		"future, sunscreen would be it.";
+	static const BYTE ccTag[16] = {
+		0x1A, 0xE1, 0x0B, 0x59, 0x4F, 0x09, 0xE2, 0x6A, 0x7E, 0x90, 0x2E, 0xCB, 0xD0, 0x60, 0x06, 0x91 };
+	BYTE		state[CRYPT_KEY_STATE];
+	BYTE		key[CRYPT_KEY_SIZE];
+	BYTE		buf[sizeof(ccText)];
+	BYTE		tag[CRYPT_TAG_SIZE], check[CRYPT_TAG_SIZE];
+	DWORD		dwLen;
+	INT			i;
+
+	if (dwCipher == CRYPT_AESGCM)
+	{
+		dwLen = sizeof(gcmText);
+		memcpy(buf, gcmText, dwLen);
+		GcmKey(state, gcmKey);
+		GcmCrypt(state, gcmIv, gcmAad, sizeof(gcmAad), buf, dwLen, TRUE, tag);
+		if (memcmp(tag, gcmTag, sizeof(tag)) != 0)
+			return FALSE;
+		GcmCrypt(state, gcmIv, gcmAad, sizeof(gcmAad), buf, dwLen, FALSE, check);
+		return memcmp(check, tag, sizeof(tag)) == 0 && memcmp(buf, gcmText, dwLen) == 0;
+	}
+
+	for (i = 0; i < CRYPT_KEY_SIZE; i++)
+		key[i] = (BYTE)(0x80 + i);
+	dwLen = sizeof(ccText) - 1;
+	memcpy(buf, ccText, dwLen);
+	ChaChaPolyCrypt(key, ccIv, ccAad, sizeof(ccAad), buf, dwLen, TRUE, tag);
+	if (memcmp(tag, ccTag, sizeof(tag)) != 0)
+		return FALSE;
+	ChaChaPolyCrypt(key, ccIv, ccAad, sizeof(ccAad), buf, dwLen, FALSE, check);
+	return memcmp(check, tag, sizeof(tag)) == 0 && memcmp(buf, ccText, dwLen) == 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitCrypt
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitCrypt()
+--
+-- RETURNS: FALSE if neither cipher can be used (ChaCha20-Poly1305 failed its self-test, or CNG has no HMAC-SHA256).
+--
+-- NOTES:
+-- Checks the processor and runs the self-tests. This is called from WinMain before any transfer thread exists.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL InitCrypt()
+{
+	INT cpuInfo[4];
+
+	__cpuid(cpuInfo, 1);
+	// ECX bit 25: AES-NI; bit 1: PCLMULQDQ; bit 9: SSSE3 (PSHUFB, for GHASH's byte order)
+	bAesHardware = (cpuInfo[2] & (1 << 25)) && (cpuInfo[2] & (1 << 1)) && (cpuInfo[2] & (1 << 9));
+	if (bAesHardware)
+		bAesHardware = SelfTest(CRYPT_AESGCM);
+	bChaChaOk = SelfTest(CRYPT_CHACHA);
+
+	if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&hHmac, BCRYPT_SHA256_ALGORITHM, NULL,
+		BCRYPT_ALG_HANDLE_HMAC_FLAG)))
+		hHmac = NULL;
+	return hHmac != NULL && bChaChaOk;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsCipherAvailable
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsCipherAvailable(DWORD dwCipher)
+--							DWORD dwCipher:		CRYPT_AESGCM or CRYPT_CHACHA.
+--
+-- RETURNS: TRUE if this end can use the cipher.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsCipherAvailable(DWORD dwCipher)
+{
+	if (hHmac == NULL)
+		return FALSE;
+	return dwCipher == CRYPT_AESGCM ? bAesHardware : bChaChaOk;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitCryptState
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitCryptState(LPCryptState c)
+--							LPCryptState c:		The state to set to its defaults (no encryption).
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitCryptState(LPCryptState c)
+{
+	memset(c, 0, sizeof(CryptState));
+	c->dwCiphers = CRYPT_AUTO;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LoadPsk
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LoadPsk(LPCryptState c, const CHAR *szValue)
+--							LPCryptState c:		Receives the key, and encryption is turned on.
+--							const CHAR *szValue:	-psk's value: the key, or @<file> for a file whose first line is.
+--
+-- RETURNS: FALSE if the file can't be read or the key is shorter than CRYPT_PSK_MIN or longer than CRYPT_PSK_SIZE.
+--
+-- NOTES:
+-- A key on the command line can be seen by anyone who can list the processes, so a file is the better choice.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL LoadPsk(LPCryptState c, const CHAR *szValue)
+{
+	CHAR	szLine[CRYPT_PSK_SIZE + 2];
+	FILE	*file;
+	size_t	len;
+
+	if (szValue[0] == '@')
+	{
+		if (fopen_s(&file, szValue + 1, "r") != 0)
+			return FALSE;
+		if (fgets(szLine, sizeof(szLine), file) == NULL)
+			szLine[0] = 0;
+		fclose(file);
+		szLine[strcspn(szLine, "\r\n")] = 0;
+		szValue = szLine;
+	}
+
+	len = strlen(szValue);
+	if (len >= CRYPT_PSK_MIN && len <= CRYPT_PSK_SIZE)
+	{
+		memcpy(c->psk, szValue, len);
+		c->dwPskLen = (DWORD)len;
+		c->bEnabled = TRUE;
+	}
+	SecureZeroMemory(szLine, sizeof(szLine));
+	return c->bEnabled;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: KeyCrypt
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: KeyCrypt(LPCryptState c, DWORD dwCipher, const BYTE *key, const BYTE *salt)
+--							LPCryptState c:		The state to key.
+--							DWORD dwCipher:		CRYPT_AESGCM or CRYPT_CHACHA.
+--							const BYTE *key:	The 256-bit record key.
+--							const BYTE *salt:	The CRYPT_SALT_SIZE bytes every nonce starts with.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Starts the counters and statistics afresh; the handshake calls this once it has the key (and -bench with its own).
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID KeyCrypt(LPCryptState c, DWORD dwCipher, const BYTE *key, const BYTE *salt)
+{
+	c->dwCipher = dwCipher;
+	if (dwCipher == CRYPT_AESGCM)
+		GcmKey(c->key, key);
+	else
+		memcpy(c->key, key, CRYPT_KEY_SIZE);
+	memcpy(c->salt, salt, CRYPT_SALT_SIZE);
+	c->qwNextSeq	= 0;
+	c->qwTopSeq		= 0;
+	c->qwSeen		= 0;
+	c->dwRecords	= 0;
+	c->qwBytes		= 0;
+	c->qwTicks		= 0;
+	c->dwRejected	= 0;
+	c->bActive		= TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Hmac
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Hmac(const BYTE *key, DWORD dwKeyLen, const BYTE *a, DWORD dwA, const BYTE *b, DWORD dwB, BYTE *mac)
+--							const BYTE *key:	The MAC key.
+--							DWORD dwKeyLen:		Its length.
+--							const BYTE *a, *b:	The message, in two parts (b may be empty).
+--							DWORD dwA, dwB:		Their lengths.
+--							BYTE *mac:			Receives the 32-byte HMAC-SHA256.
+--
+-- RETURNS: FALSE if CNG failed.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL Hmac(const BYTE *key, DWORD dwKeyLen, const BYTE *a, DWORD dwA, const BYTE *b, DWORD dwB, BYTE *mac)
+{
+	BCRYPT_HASH_HANDLE	hHash = NULL;
+	BOOL				bOk;
+
+	if (!BCRYPT_SUCCESS(BCryptCreateHash(hHmac, &hHash, NULL, 0, (PUCHAR)key, dwKeyLen, 0)))
+		return FALSE;
+	bOk = BCRYPT_SUCCESS(BCryptHashData(hHash, (PUCHAR)a, dwA, 0)) &&
+		(dwB == 0 || BCRYPT_SUCCESS(BCryptHashData(hHash, (PUCHAR)b, dwB, 0))) &&
+		BCRYPT_SUCCESS(BCryptFinishHash(hHash, mac, 32, 0));
+	BCryptDestroyHash(hHash);
+	return bOk;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DeriveKeys
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DeriveKeys(LPCryptState c, DWORD dwCipher, const CryptHello *hello, LPCryptReply reply)
+--							LPCryptState c:				The pre-shared key; receives the record key.
+--							DWORD dwCipher:				The cipher agreed on.
+--							const CryptHello *hello:	The client's hello.
+--							LPCryptReply reply:			The server's reply; its proof is filled in.
+--
+-- RETURNS: FALSE if CNG failed.
+--
+-- NOTES:
+-- HKDF-SHA256 (RFC 5869): extract with both nonces as the salt, then expand to the record key, the salt and the
+-- confirmation key. The label names the cipher, so the two ciphers never share a key.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL DeriveKeys(LPCryptState c, DWORD dwCipher, const CryptHello *hello, LPCryptReply reply)
+{
+	BYTE	nonces[2 * CRYPT_NONCE_SIZE];
+	BYTE	prk[32];
+	BYTE	okm[3 * 32];
+	BYTE	info[32 + sizeof(kdfLabel) + 1];
+	BYTE	mac[32];
+	DWORD	dwInfo;
+	DWORD	i;
+	BOOL	bOk;
+
+	memcpy(nonces, hello->nonce, CRYPT_NONCE_SIZE);
+	memcpy(nonces + CRYPT_NONCE_SIZE, reply->nonce, CRYPT_NONCE_SIZE);
+	bOk = Hmac(nonces, sizeof(nonces), c->psk, c->dwPskLen, NULL, 0, prk);
+
+	// T(i) = HMAC(PRK, T(i - 1) | label | cipher | i)
+	for (i = 0; bOk && i < 3; i++)
+	{
+		dwInfo = 0;
+		if (i > 0)
+		{
+			memcpy(info, okm + 32 * (i - 1), 32);
+			dwInfo = 32;
+		}
+		memcpy(info + dwInfo, kdfLabel, sizeof(kdfLabel) - 1);
+		dwInfo += sizeof(kdfLabel) - 1;
+		info[dwInfo++] = (BYTE)dwCipher;
+		info[dwInfo++] = (BYTE)(i + 1);
+		bOk = Hmac(prk, sizeof(prk), info, dwInfo, NULL, 0, okm + 32 * i);
+	}
+
+	// The record key, the salt, then the confirmation key
+	if (bOk)
+	{
+		KeyCrypt(c, dwCipher, okm, okm + CRYPT_KEY_SIZE);
+		bOk = Hmac(okm + 2 * 32, 32, (const BYTE *)hello, sizeof(CryptHello), (const BYTE *)reply,
+			offsetof(CryptReply, proof), mac);
+		memcpy(reply->proof, mac, CRYPT_TAG_SIZE);
+	}
+
+	SecureZeroMemory(prk, sizeof(prk));
+	SecureZeroMemory(okm, sizeof(okm));
+	SecureZeroMemory(info, sizeof(info));
+	return bOk;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendCryptHello
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendCryptHello(LPTransferProps props)
+--							LPTransferProps props:	The client's transfer, connected (TCP) or with its server's address.
+--
+-- RETURNS: FALSE (having said why) if the server didn't answer, chose no cipher this end offered, or doesn't have the
+--			same key; TRUE once the record key is in place.
+--
+-- NOTES:
+-- The exchange uses blocking calls with a timeout since the overlapped transfer hasn't started yet. Over UDP the hello
+-- goes up to CRYPT_TRIES times.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SendCryptHello(LPTransferProps props)
+{
+	LPCryptState	c			= &props->crypt;
+	CryptHello		hello;
+	CryptReply		reply;
+	BYTE			proof[CRYPT_TAG_SIZE];
+	LARGE_INTEGER	liStart;
+	DWORD			dwTimeout	= props->nSockType == SOCK_STREAM ? COMM_TIMEOUT : CRYPT_WAIT_MS;
+	DWORD			dwNoTimeout	= 0;
+	DWORD			dwDiff		= 0;
+	BOOL			bOk			= FALSE;
+	INT				nRecvd;
+	DWORD			i;
+
+	if (props->multicast.bActive || props->duplex.bActive)
+	{
+		MessageBox(NULL, TEXT("Multicast and duplex transfers can't be encrypted."), TEXT("Can't Encrypt"),
+			MB_ICONERROR);
+		return FALSE;
+	}
+
+	hello.dwMagic		= CRYPT_HELLO_MAGIC;
+	hello.wVersion		= CRYPT_VERSION;
+	hello.wCiphers		= (WORD)(c->dwCiphers & ((IsCipherAvailable(CRYPT_AESGCM) ? CRYPT_AESGCM : 0) |
+		(IsCipherAvailable(CRYPT_CHACHA) ? CRYPT_CHACHA : 0)));
+	hello.dwRecordLen	= props->nSockType == SOCK_STREAM && props->szFileName[0] == 0 ? props->nPacketSize : 0;
+	if (hello.dwRecordLen > CRYPT_MAX_RECORD || hello.wCiphers == 0 ||
+		!BCRYPT_SUCCESS(BCryptGenRandom(NULL, hello.nonce, CRYPT_NONCE_SIZE, BCRYPT_USE_SYSTEM_PREFERRED_RNG)))
+	{
+		MessageBox(NULL, TEXT("Couldn't start the key exchange (or the test packets are too big to seal over TCP)."),
+			TEXT("Can't Encrypt"), MB_ICONERROR);
+		return FALSE;
+	}
+
+	QueryPerformanceCounter(&liStart);
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+	if (props->nSockType == SOCK_STREAM)
+		bOk = SendAll(props->socket, (CHAR *)&hello, sizeof(hello)) &&
+			RecvAll(props->socket, (CHAR *)&reply, sizeof(reply)) && reply.dwMagic == CRYPT_REPLY_MAGIC;
+	else
+	{
+		for (i = 0; i < CRYPT_TRIES && !bOk; i++)
+		{
+			sendto(props->socket, (CHAR *)&hello, sizeof(hello), 0, (const sockaddr *)&props->addr, props->nAddrLen);
+			while ((nRecvd = recv(props->socket, (CHAR *)&reply, sizeof(reply), 0)) != SOCKET_ERROR)
+			{
+				if (nRecvd == sizeof(reply) && reply.dwMagic == CRYPT_REPLY_MAGIC)
+				{
+					bOk = TRUE;
+					break;
+				}
+			}
+		}
+	}
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+
+	if (!bOk)
+	{
+		MessageBox(NULL, TEXT("The server didn't answer the key exchange; it must be given -psk as well."),
+			TEXT("Key Exchange Failed"), MB_ICONERROR);
+		return FALSE;
+	}
+	if ((reply.wCipher != CRYPT_AESGCM && reply.wCipher != CRYPT_CHACHA) || !(reply.wCipher & hello.wCiphers))
+	{
+		MessageBox(NULL, TEXT("The server won't use any cipher this end offered (see -cipher)."),
+			TEXT("Key Exchange Failed"), MB_ICONERROR);
+		return FALSE;
+	}
+
+	// The reply's proof is checked against one made here, without the timing of the comparison depending on where
+	// they differ
+	memcpy(proof, reply.proof, CRYPT_TAG_SIZE);
+	if (!DeriveKeys(c, reply.wCipher, &hello, &reply))
+	{
+		EndCrypt(c);
+		MessageBox(NULL, TEXT("Couldn't derive the transfer's key."), TEXT("Key Exchange Failed"), MB_ICONERROR);
+		return FALSE;
+	}
+	for (i = 0; i < CRYPT_TAG_SIZE; i++)
+		dwDiff |= proof[i] ^ reply.proof[i];
+	if (dwDiff != 0)
+	{
+		EndCrypt(c);
+		MessageBox(NULL, TEXT("The server's key isn't the same as this end's (-psk)."), TEXT("Key Exchange Failed"),
+			MB_ICONERROR);
+		return FALSE;
+	}
+
+	c->dwHandshakeUs = ElapsedUs(&liStart);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: MakeReply
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: MakeReply(LPCryptState c, const CryptHello *hello, LPCryptReply reply)
+--							LPCryptState c:				The server's state, with its nonce for this hello in ownNonce.
+--							const CryptHello *hello:	The client's hello.
+--							LPCryptReply reply:			Receives the reply.
+--
+-- RETURNS: FALSE if there's no cipher both ends will use (the reply then says so); TRUE once the record key is in
+--			place.
+--
+-- NOTES:
+-- A client only offers AES-GCM if it has the instructions, so it's chosen whenever this end has them too.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL MakeReply(LPCryptState c, const CryptHello *hello, LPCryptReply reply)
+{
+	DWORD dwCiphers = hello->wCiphers & c->dwCiphers;
+
+	reply->dwMagic		= CRYPT_REPLY_MAGIC;
+	reply->wReserved	= 0;
+	if ((dwCiphers & CRYPT_AESGCM) && IsCipherAvailable(CRYPT_AESGCM))
+		reply->wCipher = CRYPT_AESGCM;
+	else if ((dwCiphers & CRYPT_CHACHA) && IsCipherAvailable(CRYPT_CHACHA))
+		reply->wCipher = CRYPT_CHACHA;
+	else
+		reply->wCipher = 0;
+	memcpy(reply->nonce, c->ownNonce, CRYPT_NONCE_SIZE);
+	memset(reply->proof, 0, CRYPT_TAG_SIZE);
+
+	if (hello->wVersion != CRYPT_VERSION || reply->wCipher == 0 || !DeriveKeys(c, reply->wCipher, hello, reply))
+	{
+		reply->wCipher = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AcceptCryptHello
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AcceptCryptHello(LPTransferProps props)
+--							LPTransferProps props:	The server's transfer, on its accepted TCP connection.
+--
+-- RETURNS: FALSE (having said why) if the client didn't start the exchange or no cipher suits both ends; TRUE
+--			otherwise.
+--
+-- NOTES:
+-- A client sending test packets says how big they are, so the stream can be cut into records before the first
+-- packet (which says the same thing) has been opened.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL AcceptCryptHello(LPTransferProps props)
+{
+	LPCryptState	c			= &props->crypt;
+	CryptHello		hello;
+	CryptReply		reply;
+	LARGE_INTEGER	liStart;
+	DWORD			dwTimeout	= COMM_TIMEOUT;
+	DWORD			dwNoTimeout	= 0;
+	BOOL			bOk;
+
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+	bOk = RecvAll(props->socket, (CHAR *)&hello, sizeof(hello)) && hello.dwMagic == CRYPT_HELLO_MAGIC;
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+	if (!bOk || hello.dwRecordLen > CRYPT_MAX_RECORD)
+	{
+		MessageBox(NULL, TEXT("The client didn't start an encrypted transfer; it must be given -psk as well."),
+			TEXT("Key Exchange Failed"), MB_ICONERROR);
+		return FALSE;
+	}
+
+	QueryPerformanceCounter(&liStart);
+	if (!BCRYPT_SUCCESS(BCryptGenRandom(NULL, c->ownNonce, CRYPT_NONCE_SIZE, BCRYPT_USE_SYSTEM_PREFERRED_RNG)))
+		return FALSE;
+	bOk = MakeReply(c, &hello, &reply);
+	if (!SendAll(props->socket, (CHAR *)&reply, sizeof(reply)))
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Key Exchange Failed"), TEXT("Couldn't answer the client; error %d"),
+			WSAGetLastError());
+		return FALSE;
+	}
+	if (!bOk)
+	{
+		MessageBox(NULL, TEXT("The client won't use any cipher this end allows (see -cipher)."),
+			TEXT("Key Exchange Failed"), MB_ICONERROR);
+		return FALSE;
+	}
+
+	c->dwRecordLen = hello.dwRecordLen;
+	c->dwHave = 0;
+	c->bCorrupt = FALSE;
+	if (c->dwRecordLen != 0 && (c->record = (BYTE *)PoolAlloc(c->dwRecordLen + CRYPT_TRAILER)) == NULL)
+	{
+		MessageBox(NULL, TEXT("Couldn't allocate the record buffer."), TEXT("No Memory Allocated"), MB_ICONERROR);
+		return FALSE;
+	}
+	c->dwHandshakeUs = ElapsedUs(&liStart);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsCryptHello
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsCryptHello(const BYTE *data, DWORD dwLen)
+--							const BYTE *data:	A received datagram.
+--							DWORD dwLen:		Its length.
+--
+-- RETURNS: TRUE if the datagram is a client's hello rather than data.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsCryptHello(const BYTE *data, DWORD dwLen)
+{
+	return dwLen == sizeof(CryptHello) && ((const CryptHello *)data)->dwMagic == CRYPT_HELLO_MAGIC;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AnswerCryptHello
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AnswerCryptHello(LPTransferProps props, const SOCKADDR_STORAGE *to, INT nToLen, const BYTE *data,
+--								DWORD dwLen)
+--							LPTransferProps props:		The server's UDP transfer.
+--							const SOCKADDR_STORAGE *to:	Where the hello came from.
+--							INT nToLen:					The length of the address.
+--							const BYTE *data:			The hello.
+--							DWORD dwLen:				Its length.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- A hello the client sent again because the reply was lost is answered with the same nonce, so both ends still arrive
+-- at the same key. Once data has arrived the key is settled and hellos are ignored.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID AnswerCryptHello(LPTransferProps props, const SOCKADDR_STORAGE *to, INT nToLen, const BYTE *data, DWORD dwLen)
+{
+	LPCryptState		c		= &props->crypt;
+	const CryptHello	*hello	= (const CryptHello *)data;
+	CryptReply			reply;
+	LARGE_INTEGER		liStart;
+
+	if (!c->bEnabled || props->dwTimeout != INFINITE)
+		return;
+
+	QueryPerformanceCounter(&liStart);
+	if (!c->bActive || memcmp(hello->nonce, c->peerNonce, CRYPT_NONCE_SIZE) != 0)
+	{
+		if (!BCRYPT_SUCCESS(BCryptGenRandom(NULL, c->ownNonce, CRYPT_NONCE_SIZE, BCRYPT_USE_SYSTEM_PREFERRED_RNG)))
+			return;
+		memcpy(c->peerNonce, hello->nonce, CRYPT_NONCE_SIZE);
+	}
+	if (!MakeReply(c, hello, &reply))
+		c->bActive = FALSE;
+	sendto(props->socket, (CHAR *)&reply, sizeof(reply), 0, (const sockaddr *)to, nToLen);
+	c->dwHandshakeUs = ElapsedUs(&liStart);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SealOverhead
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SealOverhead(LPCryptState c, BOOL bChunks)
+--							LPCryptState c:		The transfer's encryption state.
+--							BOOL bChunks:		Whether the records are file chunks rather than test packets.
+--
+-- RETURNS: The bytes sealing adds to each record, or 0 if the transfer isn't encrypted.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD SealOverhead(LPCryptState c, BOOL bChunks)
+{
+	if (!c->bActive)
+		return 0;
+	return bChunks ? CHUNK_SEALSIZE : CRYPT_TRAILER;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Seal
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Seal(LPCryptState c, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen)
+--							LPCryptState c:		The client's encryption state.
+--							const BYTE *aad:	Data to authenticate but leave in the clear (NULL if dwAad is 0).
+--							DWORD dwAad:		Its length.
+--							BYTE *data:			The record, encrypted in place; CRYPT_TRAILER bytes after it must be
+--												free for the counter and tag.
+--							DWORD dwLen:		Its length.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID Seal(LPCryptState c, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen)
+{
+	LARGE_INTEGER liStart, liEnd;
+
+	QueryPerformanceCounter(&liStart);
+	memcpy(data + dwLen, &c->qwNextSeq, CRYPT_SEQ_SIZE);
+	Aead(c, c->qwNextSeq++, aad, dwAad, data, dwLen, TRUE, data + dwLen + CRYPT_SEQ_SIZE);
+	QueryPerformanceCounter(&liEnd);
+
+	c->dwRecords++;
+	c->qwBytes += dwLen;
+	c->qwTicks += liEnd.QuadPart - liStart.QuadPart;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsReplay
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsReplay(LPCryptState c, ULONGLONG qwSeq)
+--							LPCryptState c:		The server's encryption state.
+--							ULONGLONG qwSeq:	A record's counter.
+--
+-- RETURNS: TRUE if a record with that counter has already been opened, or it's too far behind the newest to tell.
+--
+-- NOTES:
+-- The sliding window of IPsec (RFC 4303): a bit for each of the CRYPT_WINDOW counters up to the highest seen.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL IsReplay(LPCryptState c, ULONGLONG qwSeq)
+{
+	if (qwSeq >= c->qwTopSeq)
+		return FALSE;
+	if (c->qwTopSeq - qwSeq > CRYPT_WINDOW)
+		return TRUE;
+	return (c->qwSeen >> (c->qwTopSeq - 1 - qwSeq)) & 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Open
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Open(LPCryptState c, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen)
+--							LPCryptState c:		The server's encryption state.
+--							const BYTE *aad:	The associated data, as received.
+--							DWORD dwAad:		Its length.
+--							BYTE *data:			The record, decrypted in place; its trailer follows it.
+--							DWORD dwLen:		Its length, not counting the trailer.
+--
+-- RETURNS: FALSE (and the record is counted as rejected) if there's no key yet, the tag doesn't match or the record
+--			is a replay; TRUE otherwise.
+--
+-- NOTES:
+-- The data is garbage after a failed open; the caller drops it. The tag is compared without the timing depending on
+-- where it differs.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL Open(LPCryptState c, const BYTE *aad, DWORD dwAad, BYTE *data, DWORD dwLen)
+{
+	LARGE_INTEGER	liStart, liEnd;
+	ULONGLONG		qwSeq;
+	BYTE			tag[CRYPT_TAG_SIZE];
+	DWORD			dwDiff = 0;
+	DWORD			i;
+
+	memcpy(&qwSeq, data + dwLen, CRYPT_SEQ_SIZE);
+	if (!c->bActive || IsReplay(c, qwSeq))
+	{
+		c->dwRejected++;
+		return FALSE;
+	}
+
+	QueryPerformanceCounter(&liStart);
+	Aead(c, qwSeq, aad, dwAad, data, dwLen, FALSE, tag);
+	for (i = 0; i < CRYPT_TAG_SIZE; i++)
+		dwDiff |= tag[i] ^ data[dwLen + CRYPT_SEQ_SIZE + i];
+	QueryPerformanceCounter(&liEnd);
+	c->qwTicks += liEnd.QuadPart - liStart.QuadPart;
+
+	if (dwDiff != 0)
+	{
+		c->dwRejected++;
+		return FALSE;
+	}
+
+	if (qwSeq >= c->qwTopSeq)
+	{
+		c->qwSeen = qwSeq - c->qwTopSeq + 1 >= 64 ? 0 : c->qwSeen << (qwSeq - c->qwTopSeq + 1);
+		c->qwSeen |= 1;
+		c->qwTopSeq = qwSeq + 1;
+	}
+	else
+		c->qwSeen |= 1ULL << (c->qwTopSeq - 1 - qwSeq);
+
+	c->dwRecords++;
+	c->qwBytes += dwLen;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SealChunk
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SealChunk(LPCryptState c, LPWSABUF pwsaBuf)
+--							LPCryptState c:		The client's encryption state.
+--							LPWSABUF pwsaBuf:	A built chunk (in a CHUNK_BUFSIZE buffer); its length is updated.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- The CRC goes on the end of the payload and is encrypted with it; the header, with the CRC zeroed and the sealed
+-- length and flag set, is the associated data.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID SealChunk(LPCryptState c, LPWSABUF pwsaBuf)
+{
+	LPChunkHeader	hdr			= (LPChunkHeader)pwsaBuf->buf;
+	BYTE			*payload	= (BYTE *)(hdr + 1);
+	DWORD			dwLen		= hdr->dwWireLen;
+
+	memcpy(payload + dwLen, &hdr->dwCrc, sizeof(DWORD));
+	dwLen += sizeof(DWORD);
+	hdr->dwCrc		= 0;
+	hdr->wFlags		|= CHUNK_SEALED;
+	hdr->dwWireLen	= dwLen + CRYPT_TRAILER;
+	Seal(c, (const BYTE *)hdr, sizeof(ChunkHeader), payload, dwLen);
+	pwsaBuf->len = sizeof(ChunkHeader) + hdr->dwWireLen;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SealPacket
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SealPacket(LPCryptState c, LPWSABUF pwsaBuf, DWORD dwLen)
+--							LPCryptState c:		The client's encryption state.
+--							LPWSABUF pwsaBuf:	A built test packet, with CRYPT_TRAILER bytes free after it; its
+--												length is updated.
+--							DWORD dwLen:		The packet size.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID SealPacket(LPCryptState c, LPWSABUF pwsaBuf, DWORD dwLen)
+{
+	Seal(c, NULL, 0, (BYTE *)pwsaBuf->buf, dwLen);
+	pwsaBuf->len = dwLen + CRYPT_TRAILER;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: OpenChunk
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: OpenChunk(LPCryptState c, LPChunkHeader hdr)
+--							LPCryptState c:		The server's encryption state.
+--							LPChunkHeader hdr:	A received chunk, whole.
+--
+-- RETURNS: FALSE if the chunk isn't sealed or doesn't open; TRUE once it's an ordinary chunk again, with its CRC
+--			back in the header.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL OpenChunk(LPCryptState c, LPChunkHeader hdr)
+{
+	BYTE	*payload	= (BYTE *)(hdr + 1);
+	DWORD	dwLen;
+
+	if (!(hdr->wFlags & CHUNK_SEALED) || hdr->dwWireLen < CHUNK_SEALSIZE)
+	{
+		c->dwRejected++;
+		return FALSE;
+	}
+
+	dwLen = hdr->dwWireLen - CRYPT_TRAILER;
+	if (!Open(c, (const BYTE *)hdr, sizeof(ChunkHeader), payload, dwLen))
+		return FALSE;
+
+	dwLen -= sizeof(DWORD);
+	memcpy(&hdr->dwCrc, payload + dwLen, sizeof(DWORD));
+	hdr->dwWireLen = dwLen;
+	hdr->wFlags &= ~CHUNK_SEALED;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: OpenPacket
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: OpenPacket(LPCryptState c, BYTE *data, DWORD dwLen)
+--							LPCryptState c:		The server's encryption state.
+--							BYTE *data:			A received test packet datagram, opened in place.
+--							DWORD dwLen:		Its length, trailer included.
+--
+-- RETURNS: FALSE if it doesn't open; TRUE if its first dwLen - CRYPT_TRAILER bytes are the packet.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL OpenPacket(LPCryptState c, BYTE *data, DWORD dwLen)
+{
+	if (dwLen < CRYPT_TRAILER)
+	{
+		c->dwRejected++;
+		return FALSE;
+	}
+	return Open(c, NULL, 0, data, dwLen - CRYPT_TRAILER);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FeedRecord
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FeedRecord(LPCryptState c, const BYTE *data, DWORD dwLen, BYTE **ppPlain)
+--							LPCryptState c:		The server's encryption state, with a record size from the hello.
+--							const BYTE *data:	Bytes received from a sealed TCP stream of test packets.
+--							DWORD dwLen:		How many.
+--							BYTE **ppPlain:		Receives the opened packet (dwRecordLen bytes) if this completed one,
+--												or NULL.
+--
+-- RETURNS: How many of the bytes were taken; the rest belong to the next record.
+--
+-- NOTES:
+-- TCP splits and joins the records arbitrarily, so each is gathered whole before it's opened. Once one fails to open
+-- the stream is marked corrupt and everything after it is swallowed.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD FeedRecord(LPCryptState c, const BYTE *data, DWORD dwLen, BYTE **ppPlain)
+{
+	DWORD dwTaken;
+
+	*ppPlain = NULL;
+	if (c->bCorrupt || c->record == NULL)
+	{
+		c->bCorrupt = TRUE;
+		return dwLen;
+	}
+
+	dwTaken = min(dwLen, c->dwRecordLen + CRYPT_TRAILER - c->dwHave);
+	memcpy(c->record + c->dwHave, data, dwTaken);
+	c->dwHave += dwTaken;
+	if (c->dwHave == c->dwRecordLen + CRYPT_TRAILER)
+	{
+		c->dwHave = 0;
+		if (Open(c, NULL, 0, c->record, c->dwRecordLen))
+			*ppPlain = c->record;
+		else
+			c->bCorrupt = TRUE;
+	}
+	return dwTaken;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: EndCrypt
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: EndCrypt(LPCryptState c)
+--							LPCryptState c:		The transfer's encryption state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Wipes the transfer's key, frees the record buffer and clears the statistics; both ends call it once the transfer
+-- has been reported, so the next transfer starts with nothing agreed.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID EndCrypt(LPCryptState c)
+{
+	PoolFree(c->record);
+	c->record			= NULL;
+	c->dwRecordLen		= 0;
+	c->dwHave			= 0;
+	c->bCorrupt			= FALSE;
+	c->bActive			= FALSE;
+	c->dwCipher			= 0;
+	c->dwRecords		= 0;
+	c->qwBytes			= 0;
+	c->qwTicks			= 0;
+	c->dwRejected		= 0;
+	c->dwHandshakeUs	= 0;
+	SecureZeroMemory(c->key, sizeof(c->key));
+	SecureZeroMemory(c->salt, sizeof(c->salt));
+	memset(c->peerNonce, 0, sizeof(c->peerNonce));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatCryptReport
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatCryptReport(CHAR *buf, size_t size, LPCryptState c, double dTransferSec, BOOL bReceiver)
+--							CHAR *buf:			The buffer to write the report to.
+--							size_t size:		Its size.
+--							LPCryptState c:		The transfer's encryption state.
+--							double dTransferSec: How long the transfer took.
+--							BOOL bReceiver:		Whether this end opened the records rather than sealing them.
+--
+-- RETURNS: The number of characters written (nothing unless -psk was given).
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatCryptReport(CHAR *buf, size_t size, LPCryptState c, double dTransferSec, BOOL bReceiver)
+{
+	INT		written = 0;
+	double	dSec;
+
+	if (!c->bEnabled)
+		return 0;
+	if (c->dwCipher == 0)
+		return sprintf_s(buf, size, "Encryption: no key was agreed; %u records rejected\r\n", c->dwRejected);
+
+	dSec = TicksToSeconds(c->qwTicks);
+	written += sprintf_s(buf, size, "Encryption: %s, %u records (%.1f MB) %s, key exchange %.2f ms\r\n",
+		c->dwCipher == CRYPT_AESGCM ? "AES-256-GCM (AES-NI, PCLMULQDQ)" : "ChaCha20-Poly1305", c->dwRecords,
+		c->qwBytes / 1e6, bReceiver ? "opened" : "sealed", c->dwHandshakeUs / 1000.0);
+	if (c->qwBytes != 0)
+		written += sprintf_s(buf + written, size - written,
+			"Crypto cost: %.3f ns/byte (%.0f MB/s on one core), %.1f%% of the transfer time\r\n",
+			dSec * 1e9 / c->qwBytes, dSec > 0 ? c->qwBytes / dSec / 1e6 : 0.0,
+			dTransferSec > 0 ? 100.0 * dSec / dTransferSec : 0.0);
+	if (c->dwRejected != 0)
+		written += sprintf_s(buf + written, size - written,
+			"Records rejected: %u (didn't authenticate, or were replayed)\r\n", c->dwRejected);
+	return written;
+}
@@ -0,0 +1,88 @@
+#ifndef CRYPT_H
+#define CRYPT_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <bcrypt.h>
+#include <intrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Connect.h"
+#include "Chunk.h"
+#include "Pool.h"
+
+#ifndef COMM_TIMEOUT
+	#define COMM_TIMEOUT 5000
+#endif
+
+#define CRYPT_HELLO_MAGIC	0x4F4C4548	// "HELO"
+#define CRYPT_REPLY_MAGIC	0x594C5052	// "RPLY"
+#define CRYPT_VERSION		1
+#define CRYPT_KEY_SIZE		32			// Both ciphers take 256-bit keys
+#define CRYPT_SALT_SIZE		4			// The fixed part of each record's 96-bit nonce
+#define CRYPT_SEQ_SIZE		8			// And the counter sent with each record
+#define CRYPT_TAG_SIZE		16
+#define CRYPT_TRAILER		(CRYPT_SEQ_SIZE + CRYPT_TAG_SIZE)	// What sealing adds after a record
+#define CRYPT_NONCE_SIZE	16			// Each end's random contribution to the keys
+#define CRYPT_PSK_MIN		16			// The shortest key -psk accepts
+#define CRYPT_MAX_RECORD	(1 << 20)	// The largest test packet sealed as a TCP record
+#define CRYPT_TRIES			4			// Hellos sent over UDP before giving up
+#define CRYPT_WAIT_MS		500			// Time allowed for each answer
+#define CRYPT_WINDOW		64			// Records a UDP receiver accepts out of order before they count as replays
+
+#pragma pack(push, 1)
+
+/* The client's half of the handshake. */
+typedef struct _CryptHello
+{
+	DWORD		dwMagic;
+	WORD		wVersion;
+	WORD		wCiphers;		// CRYPT_AESGCM and/or CRYPT_CHACHA: the ones the client will use
+	DWORD		dwRecordLen;	// TCP test packets: the size of each record (a packet); otherwise 0
+	BYTE		nonce[CRYPT_NONCE_SIZE];
+} CryptHello, *LPCryptHello;
+
+/* The server's half; the proof is a MAC over both halves with a key only the pre-shared key gives. */
+typedef struct _CryptReply
+{
+	DWORD		dwMagic;
+	WORD		wCipher;		// The one chosen, or 0 if the server will use none of the client's
+	WORD		wReserved;
+	BYTE		nonce[CRYPT_NONCE_SIZE];
+	BYTE		proof[CRYPT_TAG_SIZE];
+} CryptReply, *LPCryptReply;
+
+#pragma pack(pop)
+
+/* A Poly1305 MAC in progress: the accumulator and key in 26-bit limbs, so every product fits in 64 bits. */
+typedef struct _Poly1305
+{
+	DWORD		r[5];
+	DWORD		h[5];
+	DWORD		pad[4];
+} Poly1305, *LPPoly1305;
+
+BOOL InitCrypt();
+BOOL IsCipherAvailable(DWORD dwCipher);
+VOID InitCryptState(LPCryptState c);
+BOOL LoadPsk(LPCryptState c, const CHAR *szValue);
+VOID KeyCrypt(LPCryptState c, DWORD dwCipher, const BYTE *key, const BYTE *salt);
+BOOL SendCryptHello(LPTransferProps props);
+BOOL AcceptCryptHello(LPTransferProps props);
+BOOL IsCryptHello(const BYTE *data, DWORD dwLen);
+VOID AnswerCryptHello(LPTransferProps props, const SOCKADDR_STORAGE *to, INT nToLen, const BYTE *data, DWORD dwLen);
+DWORD SealOverhead(LPCryptState c, BOOL bChunks);
+VOID SealChunk(LPCryptState c, LPWSABUF pwsaBuf);
+VOID SealPacket(LPCryptState c, LPWSABUF pwsaBuf, DWORD dwLen);
+BOOL OpenChunk(LPCryptState c, LPChunkHeader hdr);
+BOOL OpenPacket(LPCryptState c, BYTE *data, DWORD dwLen);
+DWORD FeedRecord(LPCryptState c, const BYTE *data, DWORD dwLen, BYTE **ppPlain);
+VOID EndCrypt(LPCryptState c);
+INT FormatCryptReport(CHAR *buf, size_t size, LPCryptState c, double dTransferSec, BOOL bReceiver);
+
+#endif
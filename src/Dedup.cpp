@@ -0,0 +1,846 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Dedup.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitDedup();
+-- VOID InitDedupState(LPDedupState state);
+-- DWORD NextCutPoint(const BYTE *data, DWORD dwLen);
+-- BOOL CutDedupChunks(LPDedupOffer o, HANDLE hFile, ULONGLONG qwFileSize, LPDedupState state);
+-- BOOL SendDedupOffer(SOCKET s, LPDedupOffer o, const ManifestHeader *query, LPDedupState state);
+-- BOOL RecvDedupReply(SOCKET s, LPDedupOffer o, LPDedupState state);
+-- BOOL RecvDedupOffer(SOCKET s, LPDedupOffer o, const ManifestHeader *query, LPDedupState state);
+-- BOOL SendDedupReply(SOCKET s, LPDedupOffer o, LPDedupState state);
+-- BOOL IsChunkHeld(LPDedupOffer o, DWORD dwChunk);
+-- BOOL IsOfferedChunk(LPDedupOffer o, DWORD dwChunk, ULONGLONG qwOffset, DWORD dwLen);
+-- VOID FreeDedupOffer(LPDedupOffer o);
+-- BOOL OpenDedupStore(LPDedupStore st, const TCHAR *szDir, LPDedupState state);
+-- BOOL FillFromStore(LPDedupStore st, LPDedupOffer o, HANDLE hDest, LPIntegrityState integrity, LPDedupState state);
+-- VOID AddToStore(LPDedupStore st, const DedupRef *ref, const BYTE *data, LPDedupState state);
+-- VOID CloseDedupStore(LPDedupStore st);
+-- INT FormatDedupReport(CHAR *buf, size_t size, LPDedupState state, ULONGLONG qwChunkWireBytes, BOOL bReceiver);
+-- static BOOL AllocOffer(LPDedupOffer o, DWORD dwCap);
+-- static DWORD FindEntry(LPDedupStore st, const DedupRef *ref);
+-- static BOOL IndexEntries(LPDedupStore st, DWORD dwEntries);
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file implements deduplicated transfers. The sender cuts the file into chunks at points chosen by the
+--			content rather than by offset, so an insertion or deletion only changes the chunks around it, and sends
+--			the hash of every chunk. The receiver keeps each chunk it has ever been sent in a store and answers
+--			with the ones it already has; it writes those into the destination itself, and the sender sends only
+--			the rest, as ordinary data chunks at their offsets.
+--
+--			Cut points come from a gear hash: h = (h << 1) + gear[byte], where gear is a table of 256 random 64-bit
+--			values. Each shift pushes the oldest byte further up, so the top bits of h depend on the last 64 bytes
+--			only, and a cut is made where enough of them are zero. As in FastCDC, nothing is looked at in the first
+--			DEDUP_MINCHUNK bytes of a chunk, a stricter mask is used before DEDUP_AVGCHUNK and a looser one after, so
+--			chunk sizes bunch around the average, and a chunk is cut at DEDUP_MAXCHUNK regardless.
+--
+--			Chunks are known by their Hash64 and CRC32C. The CRCs of the chunks that aren't sent go into both ends'
+--			whole-file digests as they do for a resumed transfer (see Manifest.cpp), and the receiver checks the
+--			chunks it takes from the store against both before using them.
+--
+--			The store is a directory holding an append-only pack file of chunk data and an index of DedupEntries.
+--			A chunk's data is written before its index entry, so the index never refers to data that isn't there;
+--			at worst a crash leaves some unreferenced data at the end of the pack. The index is read into an
+--			open-addressed hash table when a transfer starts.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Dedup.h"
+
+static ULONGLONG gear[256];	// The gear hash's table, the same in every instance so both ends cut alike
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitDedup
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitDedup()
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Fills the gear table from a fixed seed with SplitMix64. Called once when the program starts.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitDedup()
+{
+	ULONGLONG	x = DEDUP_GEARSEED;
+	ULONGLONG	z;
+	DWORD		i;
+
+	for (i = 0; i < 256; i++)
+	{
+		z = (x += 0x9E3779B97F4A7C15);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+		gear[i] = z ^ (z >> 31);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitDedupState
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitDedupState(LPDedupState state)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called at the start of every file transfer. Clears the counters but leaves the user's settings.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitDedupState(LPDedupState state)
+{
+	BOOL	bEnabled = state->bEnabled;
+	TCHAR	szStoreDir[FILENAME_SIZE];
+
+	_tcscpy_s(szStoreDir, state->szStoreDir);
+	memset(state, 0, sizeof(DedupState));
+	state->bEnabled = bEnabled;
+	_tcscpy_s(state->szStoreDir, szStoreDir);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NextCutPoint
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NextCutPoint(const BYTE *data, DWORD dwLen)
+--							BYTE *data:		The file data from the start of the next chunk.
+--							DWORD dwLen:	How much of it there is; at least DEDUP_MAXCHUNK unless the file ends sooner.
+--
+-- RETURNS: The length of the chunk.
+--
+-- NOTES:
+-- The loop is one shift, one add, one load and one test per byte; the table is 2 KB and stays in L1.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD NextCutPoint(const BYTE *data, DWORD dwLen)
+{
+	ULONGLONG	h		= 0;
+	DWORD		dwEnd	= min(dwLen, DEDUP_MAXCHUNK);
+	DWORD		dwMid	= min(dwEnd, DEDUP_AVGCHUNK);
+	DWORD		i;
+
+	if (dwEnd <= DEDUP_MINCHUNK)
+		return dwEnd;
+
+	for (i = DEDUP_MINCHUNK; i < dwMid; i++)
+	{
+		h = (h << 1) + gear[data[i]];
+		if ((h & DEDUP_MASK_SMALL) == 0)
+			return i + 1;
+	}
+	for (; i < dwEnd; i++)
+	{
+		h = (h << 1) + gear[data[i]];
+		if ((h & DEDUP_MASK_LARGE) == 0)
+			return i + 1;
+	}
+	return dwEnd;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AllocOffer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AllocOffer(LPDedupOffer o, DWORD dwCap)
+--							LPDedupOffer o:	The offer.
+--							DWORD dwCap:	The number of chunks it must have room for.
+--
+-- RETURNS: FALSE if there isn't enough memory; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL AllocOffer(LPDedupOffer o, DWORD dwCap)
+{
+	LPDedupRef	refs	= (LPDedupRef)realloc(o->refs, ((size_t)dwCap + 1) * sizeof(DedupRef));
+	ULONGLONG	*offsets;
+
+	if (refs == NULL)
+		return FALSE;
+	o->refs = refs;
+
+	if ((offsets = (ULONGLONG *)realloc(o->offsets, ((size_t)dwCap + 1) * sizeof(ULONGLONG))) == NULL)
+		return FALSE;
+	o->offsets = offsets;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CutDedupChunks
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CutDedupChunks(LPDedupOffer o, HANDLE hFile, ULONGLONG qwFileSize, LPDedupState state)
+--							LPDedupOffer o:			The offer to fill.
+--							HANDLE hFile:			The file to send.
+--							ULONGLONG qwFileSize:	Its size.
+--							LPDedupState state:		The sender's dedup state.
+--
+-- RETURNS: FALSE if the file couldn't be read or there isn't enough memory; TRUE otherwise.
+--
+-- NOTES:
+-- Reads the whole file once, cutting it into chunks and hashing each, and leaves the file pointer at the start for
+-- the transfer. The buffer is topped up whenever less than a whole chunk is left in it, so every cut point is found
+-- with DEDUP_MAXCHUNK bytes in view.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL CutDedupChunks(LPDedupOffer o, HANDLE hFile, ULONGLONG qwFileSize, LPDedupState state)
+{
+	BYTE			*buf;
+	DWORD			dwStart = 0, dwEnd = 0, dwCap, dwLen, dwWant, dwRead;
+	ULONGLONG		qwRead = 0, qwPos = 0;
+	LARGE_INTEGER	liZero, liStart, liEnd;
+	BOOL			bOk = TRUE;
+
+	FreeDedupOffer(o);
+	liZero.QuadPart = 0;
+	dwCap = (DWORD)min(qwFileSize / DEDUP_AVGCHUNK + 16, (ULONGLONG)DEDUP_MAXCHUNKS);
+	if ((buf = (BYTE *)malloc(DEDUP_READSIZE)) == NULL || !AllocOffer(o, dwCap) ||
+		!SetFilePointerEx(hFile, liZero, NULL, FILE_BEGIN))
+	{
+		free(buf);
+		return FALSE;
+	}
+
+	QueryPerformanceCounter(&liStart);
+	while (qwPos < qwFileSize)
+	{
+		if (dwEnd - dwStart < DEDUP_MAXCHUNK && qwRead < qwFileSize)
+		{
+			memmove(buf, buf + dwStart, dwEnd - dwStart);
+			dwEnd -= dwStart;
+			dwStart = 0;
+			dwWant = (DWORD)min((ULONGLONG)(DEDUP_READSIZE - dwEnd), qwFileSize - qwRead);
+			if (!ReadFile(hFile, buf + dwEnd, dwWant, &dwRead, NULL) || dwRead != dwWant)
+			{
+				bOk = FALSE;
+				break;
+			}
+			dwEnd += dwRead;
+			qwRead += dwRead;
+		}
+
+		if (o->dwChunks == dwCap &&
+			(dwCap == DEDUP_MAXCHUNKS || !AllocOffer(o, dwCap = min(dwCap * 2, DEDUP_MAXCHUNKS))))
+		{
+			bOk = FALSE;
+			break;
+		}
+
+		dwLen = NextCutPoint(buf + dwStart, dwEnd - dwStart);
+		o->refs[o->dwChunks].qwHash		= Hash64(buf + dwStart, dwLen, DEDUP_HASHSEED);
+		o->refs[o->dwChunks].dwLen		= dwLen;
+		o->refs[o->dwChunks].dwCrc		= Crc32c(0, buf + dwStart, dwLen);
+		o->offsets[o->dwChunks++]		= qwPos;
+		qwPos	+= dwLen;
+		dwStart	+= dwLen;
+	}
+	QueryPerformanceCounter(&liEnd);
+
+	free(buf);
+	o->qwFileSize			= qwFileSize;
+	state->dwChunks			= o->dwChunks;
+	state->qwFileBytes		= qwFileSize;
+	state->qwWorkBytes		= qwPos;
+	state->qwWorkTicks		= liEnd.QuadPart - liStart.QuadPart;
+	return bOk && SetFilePointerEx(hFile, liZero, NULL, FILE_BEGIN);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendDedupOffer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendDedupOffer(SOCKET s, LPDedupOffer o, const ManifestHeader *query, LPDedupState state)
+--							SOCKET s:				The connected socket.
+--							LPDedupOffer o:			The chunks of the file.
+--							ManifestHeader *query:	Describes the file, with DEDUP_MAGIC and the number of chunks.
+--							LPDedupState state:		The sender's dedup state.
+--
+-- RETURNS: FALSE if the offer couldn't be sent; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SendDedupOffer(SOCKET s, LPDedupOffer o, const ManifestHeader *query, LPDedupState state)
+{
+	state->qwOfferBytes = sizeof(ManifestHeader) + (ULONGLONG)o->dwChunks * sizeof(DedupRef);
+	return SendAll(s, (const CHAR *)query, sizeof(ManifestHeader)) &&
+		SendAll(s, (const CHAR *)o->refs, o->dwChunks * sizeof(DedupRef));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RecvDedupReply
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RecvDedupReply(SOCKET s, LPDedupOffer o, LPDedupState state)
+--							SOCKET s:			The connected socket.
+--							LPDedupOffer o:		The chunks offered; receives the bitmap of those the receiver has.
+--							LPDedupState state:	The sender's dedup state.
+--
+-- RETURNS: FALSE if the reply couldn't be read or doesn't match the offer; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL RecvDedupReply(SOCKET s, LPDedupOffer o, LPDedupState state)
+{
+	ManifestHeader	reply;
+	DWORD			dwBitmap = (o->dwChunks + 7) / 8;
+	DWORD			i;
+
+	if (!RecvAll(s, (CHAR *)&reply, sizeof(reply)) || reply.dwMagic != DEDUP_MAGIC || reply.dwChunks != o->dwChunks ||
+		reply.qwFileSize != o->qwFileSize)
+		return FALSE;
+
+	if ((o->have = (BYTE *)calloc(dwBitmap + 1, 1)) == NULL || !RecvAll(s, (CHAR *)o->have, dwBitmap))
+		return FALSE;
+
+	for (i = 0; i < o->dwChunks; i++)
+	{
+		if (IsChunkHeld(o, i))
+		{
+			state->dwDupChunks++;
+			state->qwDupBytes += o->refs[i].dwLen;
+		}
+	}
+	state->qwReplyBytes	= sizeof(reply) + dwBitmap;
+	state->bActive		= TRUE;
+	o->bActive			= TRUE;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RecvDedupOffer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RecvDedupOffer(SOCKET s, LPDedupOffer o, const ManifestHeader *query, LPDedupState state)
+--							SOCKET s:				The connected socket.
+--							LPDedupOffer o:			Receives the chunks offered.
+--							ManifestHeader *query:	The query that began the offer.
+--							LPDedupState state:		The receiver's dedup state.
+--
+-- RETURNS: FALSE if the chunk list couldn't be read, or its chunks don't make up the file; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL RecvDedupOffer(SOCKET s, LPDedupOffer o, const ManifestHeader *query, LPDedupState state)
+{
+	ULONGLONG	qwPos = 0;
+	DWORD		i;
+
+	FreeDedupOffer(o);
+	if (query->dwChunks > query->qwFileSize / DEDUP_MINCHUNK + 1 || query->dwChunks > DEDUP_MAXCHUNKS ||
+		!AllocOffer(o, query->dwChunks) ||
+		(o->have = (BYTE *)calloc((query->dwChunks + 7) / 8 + 1, 1)) == NULL ||
+		!RecvAll(s, (CHAR *)o->refs, query->dwChunks * sizeof(DedupRef)))
+		return FALSE;
+
+	for (i = 0; i < query->dwChunks; i++)
+	{
+		if (o->refs[i].dwLen == 0 || o->refs[i].dwLen > DEDUP_MAXCHUNK)
+			return FALSE;
+		o->offsets[i] = qwPos;
+		qwPos += o->refs[i].dwLen;
+	}
+	if (qwPos != query->qwFileSize)
+		return FALSE;
+
+	o->dwChunks				= query->dwChunks;
+	o->qwFileSize			= query->qwFileSize;
+	o->bActive				= TRUE;
+	state->bActive			= TRUE;
+	state->dwChunks			= o->dwChunks;
+	state->qwFileBytes		= o->qwFileSize;
+	state->qwOfferBytes		= sizeof(ManifestHeader) + (ULONGLONG)o->dwChunks * sizeof(DedupRef);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendDedupReply
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendDedupReply(SOCKET s, LPDedupOffer o, LPDedupState state)
+--							SOCKET s:			The connected socket.
+--							LPDedupOffer o:		The chunks offered, marked with those taken from the store.
+--							LPDedupState state:	The receiver's dedup state.
+--
+-- RETURNS: FALSE if the reply couldn't be sent; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SendDedupReply(SOCKET s, LPDedupOffer o, LPDedupState state)
+{
+	ManifestHeader	reply;
+	DWORD			dwBitmap = (o->dwChunks + 7) / 8;
+
+	InitManifestHeader(&reply, o->qwFileSize, DEDUP_AVGCHUNK, 0);
+	reply.dwMagic	= DEDUP_MAGIC;
+	reply.dwChunks	= o->dwChunks;
+	reply.dwPresent	= state->dwDupChunks;
+
+	state->qwReplyBytes = sizeof(reply) + dwBitmap;
+	return SendAll(s, (CHAR *)&reply, sizeof(reply)) && SendAll(s, (CHAR *)o->have, dwBitmap);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsChunkHeld
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsChunkHeld(LPDedupOffer o, DWORD dwChunk)
+--
+-- RETURNS: TRUE if the receiver had the chunk in its store; FALSE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsChunkHeld(LPDedupOffer o, DWORD dwChunk)
+{
+	if (o->have == NULL || dwChunk >= o->dwChunks)
+		return FALSE;
+	return (o->have[dwChunk / 8] >> (dwChunk % 8)) & 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsOfferedChunk
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsOfferedChunk(LPDedupOffer o, DWORD dwChunk, ULONGLONG qwOffset, DWORD dwLen)
+--							LPDedupOffer o:		The chunks offered.
+--							DWORD dwChunk:		A received chunk's sequence number,
+--							ULONGLONG qwOffset:	its offset,
+--							DWORD dwLen:		and its length.
+--
+-- RETURNS: TRUE if the chunk is one of those offered that the receiver asked for; FALSE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsOfferedChunk(LPDedupOffer o, DWORD dwChunk, ULONGLONG qwOffset, DWORD dwLen)
+{
+	return dwChunk < o->dwChunks && o->offsets[dwChunk] == qwOffset && o->refs[dwChunk].dwLen == dwLen &&
+		!IsChunkHeld(o, dwChunk);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FreeDedupOffer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FreeDedupOffer(LPDedupOffer o)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FreeDedupOffer(LPDedupOffer o)
+{
+	free(o->refs);
+	free(o->offsets);
+	free(o->have);
+	memset(o, 0, sizeof(DedupOffer));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FindEntry
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FindEntry(LPDedupStore st, const DedupRef *ref)
+--							LPDedupStore st:	The store.
+--							DedupRef *ref:		The chunk to look for.
+--
+-- RETURNS: The chunk's entry number, or DEDUP_NONE if the store doesn't have it.
+--
+-- NOTES:
+-- The hash is already uniform, so its low bits pick the slot. A chunk has to match on length and CRC as well as hash.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD FindEntry(LPDedupStore st, const DedupRef *ref)
+{
+	DWORD	dwSlot;
+	DWORD	e;
+
+	if (st->table == NULL)
+		return DEDUP_NONE;
+
+	for (dwSlot = (DWORD)ref->qwHash & st->dwTableMask; (e = st->table[dwSlot]) != DEDUP_NONE;
+		dwSlot = (dwSlot + 1) & st->dwTableMask)
+	{
+		if (st->entries[e].qwHash == ref->qwHash && st->entries[e].dwLen == ref->dwLen &&
+			st->entries[e].dwCrc == ref->dwCrc)
+			return e;
+	}
+	return DEDUP_NONE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IndexEntries
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IndexEntries(LPDedupStore st, DWORD dwEntries)
+--							LPDedupStore st:	The store.
+--							DWORD dwEntries:	The number of entries the table must have room for.
+--
+-- RETURNS: FALSE if there isn't enough memory; TRUE otherwise.
+--
+-- NOTES:
+-- (Re)builds the hash table with at least twice as many slots as there will be entries, so probes stay short.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL IndexEntries(LPDedupStore st, DWORD dwEntries)
+{
+	DWORD	dwSlots = 1024;
+	DWORD	*table;
+	DWORD	e, dwSlot;
+
+	while (dwSlots < 2 * dwEntries && dwSlots < 0x80000000)
+		dwSlots *= 2;
+
+	if ((table = (DWORD *)malloc((size_t)dwSlots * sizeof(DWORD))) == NULL)
+		return FALSE;
+	memset(table, 0xFF, (size_t)dwSlots * sizeof(DWORD));
+
+	free(st->table);
+	st->table		= table;
+	st->dwTableMask	= dwSlots - 1;
+	for (e = 0; e < st->dwEntries; e++)
+	{
+		for (dwSlot = (DWORD)st->entries[e].qwHash & st->dwTableMask; table[dwSlot] != DEDUP_NONE;
+			dwSlot = (dwSlot + 1) & st->dwTableMask)
+			;
+		table[dwSlot] = e;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: OpenDedupStore
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: OpenDedupStore(LPDedupStore st, const TCHAR *szDir, LPDedupState state)
+--							LPDedupStore st:	The store to open.
+--							TCHAR *szDir:		The directory it's kept in; created if it doesn't exist.
+--							LPDedupState state:	The receiver's dedup state.
+--
+-- RETURNS: FALSE if the store's files couldn't be opened or read; TRUE otherwise.
+--
+-- NOTES:
+-- Index entries that refer past the end of the pack, and a partly written entry at the end of the index, are cut off
+-- rather than trusted.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL OpenDedupStore(LPDedupStore st, const TCHAR *szDir, LPDedupState state)
+{
+	TCHAR			szPath[DEDUP_PATH_SIZE];
+	LARGE_INTEGER	liSize;
+	DWORD			dwEntries, dwRead, e;
+
+	CloseDedupStore(st);
+	if (!CreateDirectory(szDir, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+		return FALSE;
+
+	_stprintf_s(szPath, DEDUP_PATH_SIZE, TEXT("%s\\%s"), szDir, DEDUP_PACK_NAME);
+	if ((st->hPack = CreateFile(szPath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, 0, NULL)) ==
+		INVALID_HANDLE_VALUE || !GetFileSizeEx(st->hPack, &liSize))
+		return FALSE;
+	st->qwPackSize = liSize.QuadPart;
+
+	_stprintf_s(szPath, DEDUP_PATH_SIZE, TEXT("%s\\%s"), szDir, DEDUP_INDEX_NAME);
+	if ((st->hIndex = CreateFile(szPath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, 0, NULL)) ==
+		INVALID_HANDLE_VALUE || !GetFileSizeEx(st->hIndex, &liSize) ||
+		liSize.QuadPart / sizeof(DedupEntry) >= DEDUP_MAXCHUNKS)
+		return FALSE;
+
+	dwEntries	= (DWORD)(liSize.QuadPart / sizeof(DedupEntry));
+	st->dwCap	= max(dwEntries * 2, 1024u);
+	if ((st->entries = (LPDedupEntry)malloc((size_t)st->dwCap * sizeof(DedupEntry))) == NULL ||
+		!ReadFile(st->hIndex, st->entries, dwEntries * sizeof(DedupEntry), &dwRead, NULL) ||
+		dwRead != dwEntries * sizeof(DedupEntry))
+		return FALSE;
+
+	for (e = 0; e < dwEntries && st->entries[e].qwPackOffset + st->entries[e].dwLen <= st->qwPackSize; e++)
+		;
+	st->dwEntries = e;
+
+	liSize.QuadPart = (ULONGLONG)e * sizeof(DedupEntry);
+	if (!SetFilePointerEx(st->hIndex, liSize, NULL, FILE_BEGIN) || !SetEndOfFile(st->hIndex) ||
+		!IndexEntries(st, st->dwCap))
+		return FALSE;
+
+	state->dwStoreChunks = st->dwEntries;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FillFromStore
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FillFromStore(LPDedupStore st, LPDedupOffer o, HANDLE hDest, LPIntegrityState integrity,
+--							LPDedupState state)
+--							LPDedupStore st:				The store.
+--							LPDedupOffer o:					The chunks offered; those found are marked in its bitmap.
+--							HANDLE hDest:					The destination file.
+--							LPIntegrityState integrity:		The receiver's integrity state.
+--							LPDedupState state:				The receiver's dedup state.
+--
+-- RETURNS: FALSE if the destination couldn't be written; TRUE otherwise.
+--
+-- NOTES:
+-- Writes every offered chunk the store has into the destination and folds it into the digest. A chunk whose data
+-- in the pack can't be read or no longer matches its hash and CRC is left for the sender to send.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL FillFromStore(LPDedupStore st, LPDedupOffer o, HANDLE hDest, LPIntegrityState integrity, LPDedupState state)
+{
+	BYTE			*buf;
+	LARGE_INTEGER	liOffset, liStart, liEnd;
+	DWORD			i, e, dwDone;
+	BOOL			bOk = TRUE;
+
+	if ((buf = (BYTE *)malloc(DEDUP_MAXCHUNK)) == NULL)
+		return FALSE;
+
+	QueryPerformanceCounter(&liStart);
+	for (i = 0; i < o->dwChunks && bOk; i++)
+	{
+		if ((e = FindEntry(st, &o->refs[i])) == DEDUP_NONE)
+			continue;
+
+		liOffset.QuadPart = st->entries[e].qwPackOffset;
+		if (!SetFilePointerEx(st->hPack, liOffset, NULL, FILE_BEGIN) ||
+			!ReadFile(st->hPack, buf, o->refs[i].dwLen, &dwDone, NULL) || dwDone != o->refs[i].dwLen ||
+			Crc32c(0, buf, dwDone) != o->refs[i].dwCrc || Hash64(buf, dwDone, DEDUP_HASHSEED) != o->refs[i].qwHash)
+			continue;
+
+		liOffset.QuadPart = o->offsets[i];
+		if (!SetFilePointerEx(hDest, liOffset, NULL, FILE_BEGIN) || !WriteFile(hDest, buf, dwDone, &dwDone, NULL))
+		{
+			bOk = FALSE;
+			break;
+		}
+
+		FoldChunkDigest(integrity, o->offsets[i], o->refs[i].dwLen, o->refs[i].dwCrc);
+		o->have[i / 8] |= (BYTE)(1 << (i % 8));
+		state->dwDupChunks++;
+		state->qwDupBytes += o->refs[i].dwLen;
+	}
+	QueryPerformanceCounter(&liEnd);
+
+	state->qwWorkBytes = state->qwDupBytes;
+	state->qwWorkTicks = liEnd.QuadPart - liStart.QuadPart;
+	free(buf);
+	return bOk;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AddToStore
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AddToStore(LPDedupStore st, const DedupRef *ref, const BYTE *data, LPDedupState state)
+--							LPDedupStore st:	The store.
+--							DedupRef *ref:		The chunk as the sender offered it.
+--							BYTE *data:			Its data, as received (and already checked against its CRC).
+--							LPDedupState state:	The receiver's dedup state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Keeps a chunk the receiver was just sent for later transfers. The data is only stored under the sender's hash if
+-- it matches it. A failed write isn't fatal to the transfer, but the store isn't added to again until the next one.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID AddToStore(LPDedupStore st, const DedupRef *ref, const BYTE *data, LPDedupState state)
+{
+	LPDedupEntry	entries;
+	LPDedupEntry	entry;
+	LARGE_INTEGER	liOffset;
+	DWORD			dwDone;
+
+	if (st->hPack == NULL || st->bFailed || FindEntry(st, ref) != DEDUP_NONE ||
+		Hash64(data, ref->dwLen, DEDUP_HASHSEED) != ref->qwHash)
+		return;
+
+	if (st->dwEntries == st->dwCap)
+	{
+		if ((entries = (LPDedupEntry)realloc(st->entries, (size_t)st->dwCap * 2 * sizeof(DedupEntry))) == NULL)
+		{
+			st->bFailed = TRUE;
+			return;
+		}
+		st->entries = entries;
+		st->dwCap *= 2;
+		if (!IndexEntries(st, st->dwCap))
+		{
+			st->bFailed = TRUE;
+			return;
+		}
+	}
+
+	entry				= &st->entries[st->dwEntries];
+	entry->qwHash		= ref->qwHash;
+	entry->qwPackOffset	= st->qwPackSize;
+	entry->dwLen		= ref->dwLen;
+	entry->dwCrc		= ref->dwCrc;
+
+	// The data goes in before the index entry that refers to it
+	liOffset.QuadPart = st->qwPackSize;
+	if (!SetFilePointerEx(st->hPack, liOffset, NULL, FILE_BEGIN) ||
+		!WriteFile(st->hPack, data, ref->dwLen, &dwDone, NULL) || dwDone != ref->dwLen)
+	{
+		st->bFailed = TRUE;
+		return;
+	}
+	st->qwPackSize += ref->dwLen;
+
+	liOffset.QuadPart = 0;
+	if (!SetFilePointerEx(st->hIndex, liOffset, NULL, FILE_END) ||
+		!WriteFile(st->hIndex, entry, sizeof(DedupEntry), &dwDone, NULL) || dwDone != sizeof(DedupEntry))
+	{
+		st->bFailed = TRUE;
+		return;
+	}
+
+	for (dwDone = (DWORD)entry->qwHash & st->dwTableMask; st->table[dwDone] != DEDUP_NONE;
+		dwDone = (dwDone + 1) & st->dwTableMask)
+		;
+	st->table[dwDone] = st->dwEntries++;
+	state->dwAddedChunks++;
+	state->qwAddedBytes += ref->dwLen;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CloseDedupStore
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CloseDedupStore(LPDedupStore st)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Closes the store's files and frees its table. Safe to call on a store that was never opened.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID CloseDedupStore(LPDedupStore st)
+{
+	if (st->hPack != NULL && st->hPack != INVALID_HANDLE_VALUE)
+		CloseHandle(st->hPack);
+	if (st->hIndex != NULL && st->hIndex != INVALID_HANDLE_VALUE)
+		CloseHandle(st->hIndex);
+	free(st->entries);
+	free(st->table);
+	memset(st, 0, sizeof(DedupStore));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatDedupReport
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatDedupReport(CHAR *buf, size_t size, LPDedupState state, ULONGLONG qwChunkWireBytes, BOOL bReceiver)
+--							CHAR *buf:					The buffer to write the report section into.
+--							size_t size:				The space left in buf.
+--							LPDedupState state:			The dedup state at the end of the transfer.
+--							ULONGLONG qwChunkWireBytes:	Bytes of data chunks sent or received, headers included.
+--							BOOL bReceiver:				Whether this end received the file.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The dedup ratio is the file's size over the bytes of it that had to be sent. The bytes on the wire add the chunk
+-- list and the reply to the chunks themselves (after any compression).
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatDedupReport(CHAR *buf, size_t size, LPDedupState state, ULONGLONG qwChunkWireBytes, BOOL bReceiver)
+{
+	INT			written		= 0;
+	double		dSeconds	= TicksToSeconds(state->qwWorkTicks);
+	ULONGLONG	qwSent		= state->qwFileBytes - state->qwDupBytes;
+	ULONGLONG	qwWire		= state->qwOfferBytes + state->qwReplyBytes + qwChunkWireBytes;
+
+	written += sprintf_s(buf, size, "Dedup: %lu chunks averaging %llu bytes, %lu (%llu bytes) already at the receiver\r\n",
+		state->dwChunks, state->dwChunks ? state->qwFileBytes / state->dwChunks : 0, state->dwDupChunks,
+		state->qwDupBytes);
+	if (qwSent != 0)
+		written += sprintf_s(buf + written, size - written, "Dedup ratio: %.2f:1 (%llu of %llu bytes sent)\r\n",
+			(double)state->qwFileBytes / qwSent, qwSent, state->qwFileBytes);
+	else
+		written += sprintf_s(buf + written, size - written, "Dedup ratio: every chunk was at the receiver already\r\n");
+	written += sprintf_s(buf + written, size - written,
+		"Bytes on the wire: %llu (%llu chunk list, %llu reply, %llu chunks), %.1f%% of the file\r\n",
+		qwWire, state->qwOfferBytes, state->qwReplyBytes, qwChunkWireBytes,
+		state->qwFileBytes ? 100.0 * qwWire / state->qwFileBytes : 0.0);
+	if (bReceiver)
+		written += sprintf_s(buf + written, size - written, "Chunk store: %lu chunks before, %lu added (%llu bytes)\r\n",
+			state->dwStoreChunks, state->dwAddedChunks, state->qwAddedBytes);
+	written += sprintf_s(buf + written, size - written, "%s: %.1fms (%.0f MB/s)\r\n",
+		bReceiver ? "Store copy" : "Chunking", dSeconds * 1000.0,
+		dSeconds > 0.0 ? state->qwWorkBytes / dSeconds / 1e6 : 0.0);
+	return written;
+}
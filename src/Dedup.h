@@ -0,0 +1,93 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <tchar.h>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Checksum.h"
+#include "Manifest.h"
+
+#define DEDUP_MAGIC			0x50554444			// "DDUP"; sent in place of MANIFEST_MAGIC to offer chunk hashes
+#define DEDUP_MINCHUNK		2048				// No cut point is looked for before this many bytes
+#define DEDUP_AVGCHUNK		8192				// The chunk size the cut points aim for
+#define DEDUP_MAXCHUNK		65536				// A chunk is cut here regardless (it must fit in one file chunk)
+#define DEDUP_MASK_SMALL	0xFFFE000000000000	// 15 bits: cuts are rare until the chunk reaches the average size
+#define DEDUP_MASK_LARGE	0xFFE0000000000000	// 11 bits: and common after it
+#define DEDUP_READSIZE		(1 << 20)			// How much of the file the sender reads at once while cutting it
+#define DEDUP_HASHSEED		0xDD5EED			// Seed for the chunk hash
+#define DEDUP_GEARSEED		0x6745A5C3			// Seed the gear table is generated from
+#define DEDUP_DEF_STORE		TEXT("ChunkStore")	// The receiver's store if -dedupstore isn't given
+#define DEDUP_INDEX_NAME	TEXT("chunks.idx")
+#define DEDUP_PACK_NAME		TEXT("chunks.pack")
+#define DEDUP_PATH_SIZE		(FILENAME_SIZE + 16)
+#define DEDUP_MAXCHUNKS		0x08000000			// Most chunks in one file (or the store), so the lists fit in a DWORD
+#define DEDUP_NONE			0xFFFFFFFF
+
+#pragma pack(push, 1)
+
+/* One chunk of the file the sender offers. Chunk i starts where chunk i - 1 ends. */
+typedef struct _DedupRef
+{
+	ULONGLONG	qwHash;			// Hash64 of the chunk
+	DWORD		dwLen;
+	DWORD		dwCrc;			// CRC32C, so a chunk that isn't sent still counts toward the digest
+} DedupRef, *LPDedupRef;
+
+/* A chunk in the receiver's store. The index file is a list of these; the data is in the pack file. */
+typedef struct _DedupEntry
+{
+	ULONGLONG	qwHash;
+	ULONGLONG	qwPackOffset;
+	DWORD		dwLen;
+	DWORD		dwCrc;
+} DedupEntry, *LPDedupEntry;
+
+#pragma pack(pop)
+
+/* The chunks of the file being sent, and which of them the receiver has. Both ends keep one. */
+typedef struct _DedupOffer
+{
+	BOOL		bActive;
+	LPDedupRef	refs;
+	ULONGLONG	*offsets;		// Where each chunk starts
+	BYTE		*have;			// Bitmap of the chunks the receiver had, (dwChunks + 7) / 8 bytes
+	DWORD		dwChunks;
+	ULONGLONG	qwFileSize;
+} DedupOffer, *LPDedupOffer;
+
+/* The receiver's chunk store, kept between transfers. */
+typedef struct _DedupStore
+{
+	HANDLE		hIndex;
+	HANDLE		hPack;
+	ULONGLONG	qwPackSize;
+	LPDedupEntry entries;
+	DWORD		dwEntries;
+	DWORD		dwCap;
+	DWORD		*table;			// Open-addressed hash table of entry numbers, DEDUP_NONE when empty
+	DWORD		dwTableMask;
+	BOOL		bFailed;		// A write failed; the store isn't added to for the rest of the transfer
+} DedupStore, *LPDedupStore;
+
+VOID InitDedup();
+VOID InitDedupState(LPDedupState state);
+DWORD NextCutPoint(const BYTE *data, DWORD dwLen);
+BOOL CutDedupChunks(LPDedupOffer o, HANDLE hFile, ULONGLONG qwFileSize, LPDedupState state);
+BOOL SendDedupOffer(SOCKET s, LPDedupOffer o, const ManifestHeader *query, LPDedupState state);
+BOOL RecvDedupReply(SOCKET s, LPDedupOffer o, LPDedupState state);
+BOOL RecvDedupOffer(SOCKET s, LPDedupOffer o, const ManifestHeader *query, LPDedupState state);
+BOOL SendDedupReply(SOCKET s, LPDedupOffer o, LPDedupState state);
+BOOL IsChunkHeld(LPDedupOffer o, DWORD dwChunk);
+BOOL IsOfferedChunk(LPDedupOffer o, DWORD dwChunk, ULONGLONG qwOffset, DWORD dwLen);
+VOID FreeDedupOffer(LPDedupOffer o);
+BOOL OpenDedupStore(LPDedupStore st, const TCHAR *szDir, LPDedupState state);
+BOOL FillFromStore(LPDedupStore st, LPDedupOffer o, HANDLE hDest, LPIntegrityState integrity, LPDedupState state);
+VOID AddToStore(LPDedupStore st, const DedupRef *ref, const BYTE *data, LPDedupState state);
+VOID CloseDedupStore(LPDedupStore st);
+INT FormatDedupReport(CHAR *buf, size_t size, LPDedupState state, ULONGLONG qwChunkWireBytes, BOOL bReceiver);
+
+#endif
@@ -0,0 +1,711 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Delta.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitDeltaState(LPDeltaState state);
+-- DWORD DeltaBlockSize(ULONGLONG qwBasisSize);
+-- DWORD WeakChecksum(const BYTE *data, DWORD dwLen);
+-- BOOL SendSignatures(SOCKET s, HANDLE hBasis, LPDeltaState state);
+-- BOOL RecvSignatures(SOCKET s, LPDeltaScanner sc, LPDeltaState state);
+-- BOOL StartDeltaScan(LPDeltaScanner sc, HANDLE hFile, ULONGLONG qwFileSize);
+-- BOOL DeltaNext(LPDeltaScanner sc, LPDeltaOp op, LPDeltaState state);
+-- VOID FreeDeltaScanner(LPDeltaScanner sc);
+-- INT FormatDeltaReport(CHAR *buf, size_t size, LPDeltaState state, BOOL bReceiver);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file implements delta transfers in the style of rsync. The receiver splits its existing copy of the
+--			file into blocks and sends the signature of each: a weak rolling checksum and a strong 64-bit hash. The
+--			sender slides a block-sized window over the new file one byte at a time, updating the weak checksum in
+--			constant time, and only hashes the window when the weak checksum matches a block. Matched blocks are sent
+--			as references (CHUNK_COPY); everything else is sent as ordinary data chunks.
+--
+--			The receiver rebuilds the file in place, writing the new file over the old one in order. Once a region
+--			has been written its old contents are gone, so, as with rsync --inplace, a block may only be referenced
+--			if it lies at or after the point being written. Unchanged data and deletions are handled well; data
+--			inserted near the start of a file defeats matching for the rest of it. A block that's already in the right
+--			place is only read back to verify its CRC.
+--
+--			The weak checksum is rsync's: a is the sum of the bytes and b the sum of each byte weighted by its
+--			distance from the end of the block, both modulo 2^16. Signing the receiver's blocks and checksumming the
+--			first window are done with SSE2, sixteen bytes at a time.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Delta.h"
+
+#define WEAK(a, b) (((a) & 0xFFFF) | ((b) << 16))
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitDeltaState
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitDeltaState(LPDeltaState state)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called at the start of every file transfer. Clears the counters but leaves the user's setting.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitDeltaState(LPDeltaState state)
+{
+	BOOL bEnabled = state->bEnabled;
+
+	memset(state, 0, sizeof(DeltaState));
+	state->bEnabled = bEnabled;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DeltaBlockSize
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DeltaBlockSize(ULONGLONG qwBasisSize)
+--							ULONGLONG qwBasisSize: The size of the receiver's existing copy.
+--
+-- RETURNS: The block size to sign it with.
+--
+-- NOTES:
+-- Like rsync, the block size grows with the square root of the file size: small blocks find more matches but cost
+-- more signatures.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD DeltaBlockSize(ULONGLONG qwBasisSize)
+{
+	DWORD dwBlock = ((DWORD)sqrt((double)qwBasisSize) + 15) & ~15u;
+
+	return max(DELTA_MINBLOCK, min(DELTA_MAXBLOCK, dwBlock));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: WeakSums
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: WeakSums(const BYTE *data, DWORD dwLen, DWORD *pa, DWORD *pb)
+--							BYTE *data:		The block.
+--							DWORD dwLen:	Its length.
+--							DWORD *pa:		Receives the sum of the bytes.
+--							DWORD *pb:		Receives the weighted sum.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- b = sum((len - i) * x[i]) = len * a - sum(i * x[i]). Splitting the block into 16-byte pieces, sum(i * x[i]) is
+-- 16 * sum(k * S[k]) + sum(T[k]), where S[k] is the sum of piece k and T[k] its bytes weighted by their position in
+-- the piece. psadbw gives S[k], pmaddwd gives T[k], and sum(k * S[k]) comes from keeping a running total of the
+-- running sum. The sums wrap modulo 2^32, which doesn't matter since only the low 16 bits are kept.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID WeakSums(const BYTE *data, DWORD dwLen, DWORD *pa, DWORD *pb)
+{
+	const __m128i	zero	= _mm_setzero_si128();
+	const __m128i	wlo		= _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m128i	whi		= _mm_setr_epi16(8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i			vA		= zero, vRun = zero, vT = zero;
+	DWORD			dwPieces = dwLen / 16;
+	DWORD			a, run, t, sumIx, i;
+
+	for (i = 0; i < dwPieces; i++)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *)(data + 16 * i));
+
+		vRun	= _mm_add_epi32(vRun, vA);
+		vA		= _mm_add_epi32(vA, _mm_sad_epu8(x, zero));
+		vT		= _mm_add_epi32(vT, _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(x, zero), wlo),
+			_mm_madd_epi16(_mm_unpackhi_epi8(x, zero), whi)));
+	}
+
+	// psadbw leaves its sums in 32-bit lanes 0 and 2
+	a	= (DWORD)_mm_cvtsi128_si32(vA) + (DWORD)_mm_cvtsi128_si32(_mm_srli_si128(vA, 8));
+	run	= (DWORD)_mm_cvtsi128_si32(vRun) + (DWORD)_mm_cvtsi128_si32(_mm_srli_si128(vRun, 8));
+	vT	= _mm_add_epi32(vT, _mm_srli_si128(vT, 8));
+	vT	= _mm_add_epi32(vT, _mm_srli_si128(vT, 4));
+	t	= (DWORD)_mm_cvtsi128_si32(vT);
+
+	sumIx = dwPieces ? 16 * ((dwPieces - 1) * a - run) + t : 0;
+
+	for (i = 16 * dwPieces; i < dwLen; i++)
+	{
+		a += data[i];
+		sumIx += i * data[i];
+	}
+
+	*pa = a;
+	*pb = dwLen * a - sumIx;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: WeakChecksum
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: WeakChecksum(const BYTE *data, DWORD dwLen)
+--
+-- RETURNS: The rolling checksum of the block.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD WeakChecksum(const BYTE *data, DWORD dwLen)
+{
+	DWORD a, b;
+
+	WeakSums(data, dwLen, &a, &b);
+	return WEAK(a, b);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendSignatures
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendSignatures(SOCKET s, HANDLE hBasis, LPDeltaState state)
+--							SOCKET s:			The connected socket.
+--							HANDLE hBasis:		The receiver's existing copy (opened for reading).
+--							LPDeltaState state:	The receiver's delta state.
+--
+-- RETURNS: FALSE if the copy couldn't be read or the signatures couldn't be sent; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SendSignatures(SOCKET s, HANDLE hBasis, LPDeltaState state)
+{
+	DeltaSigHeader	hdr;
+	LPBlockSig		sigs;
+	BYTE			*buf;
+	LARGE_INTEGER	liSize, liZero, liStart, liEnd;
+	DWORD			dwPerRead, dwRead, i, j;
+	BOOL			bOk;
+
+	liZero.QuadPart = 0;
+	GetFileSizeEx(hBasis, &liSize);
+	SetFilePointerEx(hBasis, liZero, NULL, FILE_BEGIN);
+
+	hdr.dwMagic		= DELTA_MAGIC;
+	hdr.dwBlockSize	= DeltaBlockSize(liSize.QuadPart);
+	hdr.qwBasisSize	= liSize.QuadPart;
+	hdr.dwBlocks	= (DWORD)(liSize.QuadPart / hdr.dwBlockSize);
+
+	dwPerRead	= (DELTA_READSIZE / hdr.dwBlockSize) * hdr.dwBlockSize;
+	sigs		= (LPBlockSig)malloc((hdr.dwBlocks + 1) * sizeof(BlockSig));
+	buf			= (BYTE *)malloc(dwPerRead);
+	if (sigs == NULL || buf == NULL)
+	{
+		free(sigs);
+		free(buf);
+		return FALSE;
+	}
+
+	QueryPerformanceCounter(&liStart);
+	for (i = 0; i < hdr.dwBlocks; i += dwRead / hdr.dwBlockSize)
+	{
+		DWORD dwWant = min(dwPerRead, (hdr.dwBlocks - i) * hdr.dwBlockSize);
+
+		if (!ReadFile(hBasis, buf, dwWant, &dwRead, NULL) || dwRead != dwWant)
+			break;
+
+		for (j = 0; j < dwRead / hdr.dwBlockSize; j++)
+		{
+			sigs[i + j].dwWeak		= WeakChecksum(buf + j * hdr.dwBlockSize, hdr.dwBlockSize);
+			sigs[i + j].qwStrong	= Hash64(buf + j * hdr.dwBlockSize, hdr.dwBlockSize, DELTA_HASHSEED);
+		}
+	}
+	QueryPerformanceCounter(&liEnd);
+
+	bOk = (i >= hdr.dwBlocks) && SendAll(s, (CHAR *)&hdr, sizeof(hdr)) &&
+		SendAll(s, (CHAR *)sigs, hdr.dwBlocks * sizeof(BlockSig));
+
+	state->dwBlockSize	= hdr.dwBlockSize;
+	state->qwBasisSize	= hdr.qwBasisSize;
+	state->dwBlocks		= hdr.dwBlocks;
+	state->qwScanBytes	= (ULONGLONG)hdr.dwBlocks * hdr.dwBlockSize;
+	state->qwScanTicks	= liEnd.QuadPart - liStart.QuadPart;
+
+	free(sigs);
+	free(buf);
+	return bOk;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Bucket
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Bucket(LPDeltaScanner sc, DWORD dwWeak)
+--
+-- RETURNS: The hash table bucket for a weak checksum (Fibonacci hashing, since b's low bits carry little).
+---------------------------------------------------------------------------------------------------------------------------*/
+static __forceinline DWORD Bucket(LPDeltaScanner sc, DWORD dwWeak)
+{
+	return (DWORD)((dwWeak * 0x9E3779B1u) >> sc->dwHashShift);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RecvSignatures
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RecvSignatures(SOCKET s, LPDeltaScanner sc, LPDeltaState state)
+--							SOCKET s:			The connected socket.
+--							LPDeltaScanner sc:	The scanner to load the signatures into.
+--							LPDeltaState state:	The sender's delta state.
+--
+-- RETURNS: FALSE if the signatures couldn't be read or stored; TRUE otherwise.
+--
+-- NOTES:
+-- The table has at least twice as many buckets as blocks, so most windows that match nothing find an empty bucket
+-- and never touch the signatures.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL RecvSignatures(SOCKET s, LPDeltaScanner sc, LPDeltaState state)
+{
+	DeltaSigHeader	hdr;
+	DWORD			dwBits = 1;
+	DWORD			i, dwBucket;
+
+	FreeDeltaScanner(sc);
+
+	if (!RecvAll(s, (CHAR *)&hdr, sizeof(hdr)) || hdr.dwMagic != DELTA_MAGIC || hdr.dwBlockSize < DELTA_MINBLOCK ||
+		hdr.dwBlockSize > DELTA_MAXBLOCK || (ULONGLONG)hdr.dwBlocks * hdr.dwBlockSize > hdr.qwBasisSize)
+		return FALSE;
+
+	while (dwBits < 31 && (1u << dwBits) < 2 * hdr.dwBlocks)
+		dwBits++;
+
+	sc->dwBlockSize	= hdr.dwBlockSize;
+	sc->dwBlocks	= hdr.dwBlocks;
+	sc->dwHashShift	= 32 - dwBits;
+	sc->sigs		= (LPBlockSig)malloc((hdr.dwBlocks + 1) * sizeof(BlockSig));
+	sc->next		= (DWORD *)malloc((hdr.dwBlocks + 1) * sizeof(DWORD));
+	sc->heads		= (DWORD *)malloc(((size_t)1 << dwBits) * sizeof(DWORD));
+	if (sc->sigs == NULL || sc->next == NULL || sc->heads == NULL)
+		return FALSE;
+
+	if (!RecvAll(s, (CHAR *)sc->sigs, hdr.dwBlocks * sizeof(BlockSig)))
+		return FALSE;
+
+	memset(sc->heads, 0xFF, ((size_t)1 << dwBits) * sizeof(DWORD));
+	for (i = hdr.dwBlocks; i-- > 0;)
+	{
+		dwBucket = Bucket(sc, sc->sigs[i].dwWeak);
+		sc->next[i] = sc->heads[dwBucket];
+		sc->heads[dwBucket] = i;
+	}
+
+	state->dwBlockSize	= hdr.dwBlockSize;
+	state->qwBasisSize	= hdr.qwBasisSize;
+	state->dwBlocks		= hdr.dwBlocks;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StartDeltaScan
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StartDeltaScan(LPDeltaScanner sc, HANDLE hFile, ULONGLONG qwFileSize)
+--							LPDeltaScanner sc:		A scanner holding the receiver's signatures.
+--							HANDLE hFile:			The new file.
+--							ULONGLONG qwFileSize:	Its size.
+--
+-- RETURNS: FALSE if the window couldn't be allocated; TRUE otherwise.
+--
+-- NOTES:
+-- The window holds a read's worth of the file plus the unsent literals and the block being checked, which are kept
+-- when the window is refilled.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL StartDeltaScan(LPDeltaScanner sc, HANDLE hFile, ULONGLONG qwFileSize)
+{
+	LARGE_INTEGER liZero;
+
+	sc->hFile		= hFile;
+	sc->qwFileSize	= qwFileSize;
+	sc->dwWinCap	= DELTA_READSIZE + DELTA_MAXLITERAL + DELTA_MAXBLOCK;
+	sc->dwWinEnd	= 0;
+	sc->qwWinOffset	= 0;
+	sc->qwPos		= 0;
+	sc->qwLitStart	= 0;
+	sc->bEof		= FALSE;
+	sc->bTail		= FALSE;
+	sc->bError		= FALSE;
+	sc->bRolling	= FALSE;
+	sc->dwPending	= DELTA_NOBLOCK;
+	sc->window		= (BYTE *)malloc(sc->dwWinCap);
+
+	liZero.QuadPart = 0;
+	SetFilePointerEx(hFile, liZero, NULL, FILE_BEGIN);
+
+	sc->bActive = sc->window != NULL;
+	return sc->bActive;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FillWindow
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FillWindow(LPDeltaScanner sc)
+--
+-- RETURNS: FALSE if the file couldn't be read; TRUE otherwise.
+--
+-- NOTES:
+-- Reads more of the file once there's no longer a byte to roll in past the current block. Everything before the
+-- unsent literals is discarded to make room.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL FillWindow(LPDeltaScanner sc)
+{
+	DWORD dwKeep, dwRead;
+
+	if (sc->bEof || sc->qwWinOffset + sc->dwWinEnd - sc->qwPos > sc->dwBlockSize)
+		return TRUE;
+
+	dwKeep = (DWORD)(sc->qwLitStart - sc->qwWinOffset);
+	memmove(sc->window, sc->window + dwKeep, sc->dwWinEnd - dwKeep);
+	sc->qwWinOffset += dwKeep;
+	sc->dwWinEnd -= dwKeep;
+
+	if (!ReadFile(sc->hFile, sc->window + sc->dwWinEnd, sc->dwWinCap - sc->dwWinEnd, &dwRead, NULL))
+	{
+		sc->bError = TRUE;
+		return FALSE;
+	}
+
+	sc->dwWinEnd += dwRead;
+	if (dwRead == 0 || sc->qwWinOffset + sc->dwWinEnd >= sc->qwFileSize)
+		sc->bEof = TRUE;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FindBlock
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FindBlock(LPDeltaScanner sc, const BYTE *p, ULONGLONG qwPos, DWORD dwWeak)
+--							LPDeltaScanner sc:	The scanner.
+--							BYTE *p:			The window's data at qwPos.
+--							ULONGLONG qwPos:	The file offset being checked.
+--							DWORD dwWeak:		The weak checksum of the block there.
+--
+-- RETURNS: The receiver's block with the same contents, or DELTA_NOBLOCK.
+--
+-- NOTES:
+-- Blocks before qwPos will have been overwritten by the time this one is written, so they can't be used. A block
+-- already at qwPos is preferred since it needn't be moved. The strong hash is only computed once a weak checksum
+-- matches.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD FindBlock(LPDeltaScanner sc, const BYTE *p, ULONGLONG qwPos, DWORD dwWeak)
+{
+	ULONGLONG	qwStrong	= 0;
+	BOOL		bHashed		= FALSE;
+	DWORD		dwBest		= DELTA_NOBLOCK;
+	DWORD		i;
+
+	for (i = sc->heads[Bucket(sc, dwWeak)]; i != DELTA_NOBLOCK; i = sc->next[i])
+	{
+		ULONGLONG qwSrc = (ULONGLONG)i * sc->dwBlockSize;
+
+		if (sc->sigs[i].dwWeak != dwWeak || qwSrc < qwPos)
+			continue;
+
+		if (!bHashed)
+		{
+			qwStrong = Hash64(p, sc->dwBlockSize, DELTA_HASHSEED);
+			bHashed = TRUE;
+		}
+
+		if (sc->sigs[i].qwStrong != qwStrong)
+			continue;
+		if (qwSrc == qwPos)
+			return i;
+		if (dwBest == DELTA_NOBLOCK)
+			dwBest = i;
+	}
+	return dwBest;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: EmitLiteral
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: EmitLiteral(LPDeltaScanner sc, LPDeltaOp op, DWORD dwLen)
+--
+-- RETURNS: TRUE (for the caller to return).
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL EmitLiteral(LPDeltaScanner sc, LPDeltaOp op, DWORD dwLen)
+{
+	op->dwType		= DELTA_LITERAL;
+	op->qwOffset	= sc->qwLitStart;
+	op->qwSrcOffset	= 0;
+	op->dwLen		= dwLen;
+	op->data		= sc->window + (sc->qwLitStart - sc->qwWinOffset);
+
+	sc->qwLitStart += dwLen;
+	if (sc->qwPos < sc->qwLitStart)
+		sc->qwPos = sc->qwLitStart;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: EmitCopy
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: EmitCopy(LPDeltaScanner sc, LPDeltaOp op)
+--
+-- RETURNS: TRUE (for the caller to return).
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL EmitCopy(LPDeltaScanner sc, LPDeltaOp op)
+{
+	op->dwType		= DELTA_COPY;
+	op->qwOffset	= sc->qwPos;
+	op->qwSrcOffset	= (ULONGLONG)sc->dwPending * sc->dwBlockSize;
+	op->dwLen		= sc->dwBlockSize;
+	op->data		= sc->window + (sc->qwPos - sc->qwWinOffset);
+
+	sc->qwPos		+= sc->dwBlockSize;
+	sc->qwLitStart	= sc->qwPos;
+	sc->bRolling	= FALSE;
+	sc->dwPending	= DELTA_NOBLOCK;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DeltaStep
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DeltaStep(LPDeltaScanner sc, LPDeltaOp op)
+--
+-- RETURNS: FALSE at the end of the file (or on a read error); TRUE if op holds the next operation.
+--
+-- NOTES:
+-- The inner loop rolls the weak checksum forward a byte at a time: the byte leaving the window is subtracted from a,
+-- the byte entering is added, and b changes by the new a less blocksize times the byte that left. It stops when a
+-- block matches, when the literal run reaches DELTA_MAXLITERAL, or when the window runs out.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL DeltaStep(LPDeltaScanner sc, LPDeltaOp op)
+{
+	const DWORD bs = sc->dwBlockSize;
+
+	for (;;)
+	{
+		ULONGLONG	qwWinEnd, qwLimit, pos;
+		const BYTE	*p;
+		DWORD		a, b, dwBlock = DELTA_NOBLOCK;
+
+		if (sc->dwPending != DELTA_NOBLOCK)
+			return EmitCopy(sc, op);
+
+		if (!FillWindow(sc))
+			return FALSE;
+		qwWinEnd = sc->qwWinOffset + sc->dwWinEnd;
+
+		// Nothing more can match, so the rest is literal data
+		if (sc->bTail || sc->dwBlocks == 0 || qwWinEnd - sc->qwPos < bs)
+		{
+			if (sc->qwLitStart >= qwWinEnd)
+				return FALSE;
+			sc->bRolling = FALSE;
+			return EmitLiteral(sc, op, (DWORD)min((ULONGLONG)DELTA_MAXLITERAL, qwWinEnd - sc->qwLitStart));
+		}
+
+		if (sc->qwPos - sc->qwLitStart >= DELTA_MAXLITERAL)
+			return EmitLiteral(sc, op, (DWORD)(sc->qwPos - sc->qwLitStart));
+
+		p = sc->window + (sc->qwPos - sc->qwWinOffset);
+		if (!sc->bRolling)
+		{
+			WeakSums(p, bs, &sc->a, &sc->b);
+			sc->bRolling = TRUE;
+			if (sc->heads[Bucket(sc, WEAK(sc->a, sc->b))] != DELTA_NOBLOCK)
+				dwBlock = FindBlock(sc, p, sc->qwPos, WEAK(sc->a, sc->b));
+		}
+
+		a		= sc->a;
+		b		= sc->b;
+		pos		= sc->qwPos;
+		qwLimit	= min(sc->qwLitStart + DELTA_MAXLITERAL, qwWinEnd - bs);
+
+		while (dwBlock == DELTA_NOBLOCK && pos < qwLimit)
+		{
+			DWORD dwOut = p[0];
+
+			a += p[bs] - dwOut;
+			b += a - bs * dwOut;
+			p++;
+			pos++;
+
+			if (sc->heads[Bucket(sc, WEAK(a, b))] != DELTA_NOBLOCK)
+				dwBlock = FindBlock(sc, p, pos, WEAK(a, b));
+		}
+
+		sc->a		= a;
+		sc->b		= b;
+		sc->qwPos	= pos;
+
+		if (dwBlock != DELTA_NOBLOCK)
+		{
+			sc->dwPending = dwBlock;
+			if (pos > sc->qwLitStart)
+				return EmitLiteral(sc, op, (DWORD)(pos - sc->qwLitStart));
+		}
+		else if (sc->bEof && pos + bs >= qwWinEnd)
+			sc->bTail = TRUE;
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DeltaNext
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DeltaNext(LPDeltaScanner sc, LPDeltaOp op, LPDeltaState state)
+--							LPDeltaScanner sc:	The scanner.
+--							LPDeltaOp op:		Receives the next operation.
+--							LPDeltaState state:	The sender's delta counters.
+--
+-- RETURNS: FALSE once the whole file has been described (check sc->bError); TRUE if op holds the next operation.
+--
+-- NOTES:
+-- Operations come out in file order: each starts where the last ended.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL DeltaNext(LPDeltaScanner sc, LPDeltaOp op, LPDeltaState state)
+{
+	LARGE_INTEGER	liStart, liEnd;
+	BOOL			bMore;
+
+	QueryPerformanceCounter(&liStart);
+	bMore = DeltaStep(sc, op);
+	QueryPerformanceCounter(&liEnd);
+
+	state->qwScanTicks += liEnd.QuadPart - liStart.QuadPart;
+	state->qwScanBytes = sc->qwPos;
+
+	if (bMore && op->dwType == DELTA_COPY)
+	{
+		state->dwMatches++;
+		state->qwMatchedBytes += op->dwLen;
+		if (op->qwSrcOffset == op->qwOffset)
+			state->qwInPlaceBytes += op->dwLen;
+	}
+	else if (bMore)
+		state->qwLiteralBytes += op->dwLen;
+	return bMore;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FreeDeltaScanner
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FreeDeltaScanner(LPDeltaScanner sc)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FreeDeltaScanner(LPDeltaScanner sc)
+{
+	free(sc->sigs);
+	free(sc->heads);
+	free(sc->next);
+	free(sc->window);
+	memset(sc, 0, sizeof(DeltaScanner));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatDeltaReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatDeltaReport(CHAR *buf, size_t size, LPDeltaState state, BOOL bReceiver)
+--							CHAR *buf:			The buffer to write the report section into.
+--							size_t size:		The space left in buf.
+--							LPDeltaState state:	The delta state at the end of the transfer.
+--							BOOL bReceiver:		Whether this end received the file.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The timing is the scan of the new file on the sender and the signing of the old one on the receiver.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatDeltaReport(CHAR *buf, size_t size, LPDeltaState state, BOOL bReceiver)
+{
+	INT			written		= 0;
+	double		dSeconds	= TicksToSeconds(state->qwScanTicks);
+	ULONGLONG	qwTotal		= state->qwMatchedBytes + state->qwLiteralBytes;
+
+	written += sprintf_s(buf, size, "Delta: %lu-byte blocks, %lu matched of %lu in a %llu-byte copy\r\n",
+		state->dwBlockSize, state->dwMatches, state->dwBlocks, state->qwBasisSize);
+	written += sprintf_s(buf + written, size - written,
+		"Delta bytes: %llu sent, %llu referenced (%llu already in place), %.1f%% saved\r\n",
+		state->qwLiteralBytes, state->qwMatchedBytes, state->qwInPlaceBytes,
+		qwTotal ? 100.0 * state->qwMatchedBytes / qwTotal : 0.0);
+	written += sprintf_s(buf + written, size - written, "%s: %.1fms (%.0f MB/s)\r\n",
+		bReceiver ? "Signing" : "Delta scan", dSeconds * 1000.0,
+		dSeconds > 0.0 ? state->qwScanBytes / dSeconds / 1e6 : 0.0);
+	return written;
+}
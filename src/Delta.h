@@ -0,0 +1,92 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <emmintrin.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Checksum.h"
+
+#define DELTA_MAGIC			0x41544C44	// "DLTA"; sent in place of MANIFEST_MAGIC to ask for signatures
+#define DELTA_MINBLOCK		2048		// Smallest block the receiver will sign
+#define DELTA_MAXBLOCK		32768		// Largest block (a block must fit in one chunk)
+#define DELTA_MAXLITERAL	32768		// Longest run of literal data sent as one chunk
+#define DELTA_READSIZE		(1 << 20)	// How much of the new file the sender reads at once
+#define DELTA_NOBLOCK		0xFFFFFFFF
+#define DELTA_HASHSEED		0x5EED		// Seed for the strong block hash
+
+// Operation types returned by DeltaNext
+#define DELTA_LITERAL		1			// Send the data
+#define DELTA_COPY			2			// The receiver already has the data at qwSrcOffset
+
+#pragma pack(push, 1)
+
+/* Precedes the block signatures the receiver sends. */
+typedef struct _DeltaSigHeader
+{
+	DWORD		dwMagic;
+	DWORD		dwBlockSize;
+	ULONGLONG	qwBasisSize;	// Size of the receiver's existing copy
+	DWORD		dwBlocks;		// Full blocks in it; a shorter tail isn't signed
+} DeltaSigHeader, *LPDeltaSigHeader;
+
+/* The signature of one block of the receiver's copy. Block i starts at i * dwBlockSize. */
+typedef struct _BlockSig
+{
+	DWORD		dwWeak;			// Rolling checksum
+	ULONGLONG	qwStrong;		// Hash64 of the block
+} BlockSig, *LPBlockSig;
+
+#pragma pack(pop)
+
+/* One step of the delta: either literal data or a reference to a block the receiver has. */
+typedef struct _DeltaOp
+{
+	DWORD		dwType;			// DELTA_LITERAL or DELTA_COPY
+	ULONGLONG	qwOffset;		// Where the data goes in the new file
+	ULONGLONG	qwSrcOffset;	// Where it is in the receiver's copy (copies only)
+	DWORD		dwLen;
+	const BYTE	*data;			// The data itself; valid until the next call to DeltaNext
+} DeltaOp, *LPDeltaOp;
+
+/* The sender's state while it scans the new file against the receiver's signatures. */
+typedef struct _DeltaScanner
+{
+	BOOL		bActive;
+	BOOL		bError;			// A read failed
+	HANDLE		hFile;
+	ULONGLONG	qwFileSize;
+	DWORD		dwBlockSize;
+	DWORD		dwBlocks;
+	LPBlockSig	sigs;
+	DWORD		*heads;			// Hash table of the signatures, keyed on the weak checksum
+	DWORD		*next;			// Next signature in the same bucket
+	DWORD		dwHashShift;	// 32 - log2 of the table size
+	BYTE		*window;		// The part of the new file being scanned
+	DWORD		dwWinCap;
+	DWORD		dwWinEnd;
+	ULONGLONG	qwWinOffset;	// File offset of window[0]
+	BOOL		bEof;			// The window reaches the end of the file
+	BOOL		bTail;			// No block can match past this point
+	ULONGLONG	qwPos;			// Start of the block being checked
+	ULONGLONG	qwLitStart;		// Start of the literal data not yet sent
+	BOOL		bRolling;		// a and b hold the checksum of the block at qwPos
+	DWORD		a, b;
+	DWORD		dwPending;		// A match found at qwPos, sent once the literals before it have been
+} DeltaScanner, *LPDeltaScanner;
+
+VOID InitDeltaState(LPDeltaState state);
+DWORD DeltaBlockSize(ULONGLONG qwBasisSize);
+DWORD WeakChecksum(const BYTE *data, DWORD dwLen);
+BOOL SendSignatures(SOCKET s, HANDLE hBasis, LPDeltaState state);
+BOOL RecvSignatures(SOCKET s, LPDeltaScanner sc, LPDeltaState state);
+BOOL StartDeltaScan(LPDeltaScanner sc, HANDLE hFile, ULONGLONG qwFileSize);
+BOOL DeltaNext(LPDeltaScanner sc, LPDeltaOp op, LPDeltaState state);
+VOID FreeDeltaScanner(LPDeltaScanner sc);
+INT FormatDeltaReport(CHAR *buf, size_t size, LPDeltaState state, BOOL bReceiver);
+
+#endif
@@ -0,0 +1,1053 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Duplex.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- BOOL PrepareDuplex(LPTransferProps props);
+-- VOID ResetDuplexState(LPDuplexState d);
+-- BOOL StartDuplexReceive(LPTransferProps props);
+-- BOOL StartDuplexSend(LPTransferProps props, const SOCKADDR_STORAGE *to, INT nToLen);
+-- VOID StampDuplexPacket(LPDuplexState d, BYTE *buf, DWORD dwLen);
+-- VOID NoteDuplexSend(LPDuplexState d, DWORD dwBytes);
+-- VOID NoteDuplexPacket(LPDuplexState d, const BYTE *data, DWORD dwLen);
+-- VOID NoteDuplexStream(LPDuplexState d, const BYTE *data, DWORD dwLen, ULONGLONG qwOffset, DWORD dwPacketSize);
+-- VOID FinishDuplex(LPDuplexState d);
+-- VOID FreeDuplex(LPDuplexState d);
+-- INT FormatDuplexReport(CHAR *buf, size_t size, LPDuplexState d);
+-- VOID CALLBACK DuplexSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
+--		LPOVERLAPPED lpOverlapped, DWORD dwFlags);
+-- VOID CALLBACK DuplexRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
+--		LPOVERLAPPED lpOverlapped, DWORD dwFlags);
+-- static DWORD NowUs();
+-- static BOOL IsBusy(LPDuplexDir dir);
+-- static VOID NoteEvent(LPDuplexDir dir, LPDuplexDir other, DWORD dwBytes, BOOL bSend);
+-- static VOID AddSample(LPReservoir r, INT nSample);
+-- static VOID ReadStamp(LPDuplexState d, const PayloadStamp *stamp);
+-- static BOOL PostDuplexSend(LPDuplexState d);
+-- static BOOL PostDuplexRecv(LPDuplexState d);
+-- static VOID StopDuplex(LPDuplexState d);
+-- static int CompareInts(const void *a, const void *b);
+-- static DWORD SortSamples(const Reservoir *r, INT *sorted);
+-- static VOID RateText(CHAR *out, size_t size, ULONGLONG qwBytes, ULONGLONG qwTicks);
+-- static INT FormatDirection(CHAR *buf, size_t size, LPDuplexDir dir, const CHAR *szName, const CHAR *szOther);
+-- static INT FormatDelays(CHAR *buf, size_t size, INT *sorted);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file runs the reverse direction of a duplex transfer, in which the server sends test packets back to the
+--			client while the client's are still arriving, over the same TCP connection or UDP socket. The client asks
+--			for it with PAYLOAD_FLAG_DUPLEX in its packets' header, and the server mirrors the client's packet size and
+--			count. The reverse direction has its own overlapped structure and completion routines, which run on the
+--			same thread as the forward direction's since both ends wait alertably.
+--
+--			Packets in both directions are stamped as they're sent (see Payload.h): the sender's clock, and the last
+--			stamp it had from the other end plus how long it held it. Arrival time minus the send stamp is the one-way
+--			delay plus a constant clock offset, so its rise above the smallest seen is the queuing delay in that
+--			direction. The echo gives the round trip under load.
+--
+--			Each end splits the time between its sends and between its arrivals by whether the other direction was
+--			busy, which gives each direction's throughput with and without the other competing. TCP data acks travel
+--			behind the reverse data and arrive in bunches (ACK compression), which shows as send completions bunching
+--			up. Both directions sharing the sockets' buffers, the NIC or the radio shows as lower throughput and longer
+--			queues while both are busy.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Duplex.h"
+
+static Reservoir	owdBusy;		// Delay of the direction this end receives, while it was sending too
+static Reservoir	owdIdle;		// And while it wasn't
+static Reservoir	rtt;			// Round trips from the echoed stamps
+static DWORD		dwRng = 1;		// Picks which samples a full reservoir keeps
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NowUs
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NowUs()
+--
+-- RETURNS: The performance counter in microseconds, wrapping every 71 minutes; only differences are used.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD NowUs()
+{
+	static double	dUsPerTick = 0.0;
+	LARGE_INTEGER	liNow;
+
+	if (dUsPerTick == 0.0)
+	{
+		QueryPerformanceFrequency(&liNow);
+		dUsPerTick = 1e6 / liNow.QuadPart;
+	}
+	QueryPerformanceCounter(&liNow);
+	return (DWORD)(ULONGLONG)(liNow.QuadPart * dUsPerTick);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsBusy
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsBusy(LPDuplexDir dir)
+--							LPDuplexDir dir:	One direction of the transfer.
+--
+-- RETURNS: TRUE if it has started, hasn't finished, and has had traffic in the last DUPLEX_IDLE_MS.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL IsBusy(LPDuplexDir dir)
+{
+	return dir->liFirst.QuadPart != 0 && !dir->bDone && ElapsedUs(&dir->liLast) < DUPLEX_IDLE_MS * 1000;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NoteEvent
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NoteEvent(LPDuplexDir dir, LPDuplexDir other, DWORD dwBytes, BOOL bSend)
+--							LPDuplexDir dir:	The direction that moved data.
+--							LPDuplexDir other:	The opposite direction.
+--							DWORD dwBytes:		How much.
+--							BOOL bSend:			Whether this was a send completion, whose gaps are kept.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- The time since the direction's last event, and the bytes this one moved, go in the busy or idle bin depending on the
+-- other direction. The first event only starts the clock.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID NoteEvent(LPDuplexDir dir, LPDuplexDir other, DWORD dwBytes, BOOL bSend)
+{
+	LARGE_INTEGER	liNow;
+	ULONGLONG		qwTicks;
+	double			dGapUs;
+	DWORD			dwBin = IsBusy(other) ? 1 : 0;
+
+	QueryPerformanceCounter(&liNow);
+	if (dir->liFirst.QuadPart == 0)
+		dir->liFirst = liNow;
+	else
+	{
+		qwTicks = liNow.QuadPart - dir->liLast.QuadPart;
+		dir->qwBinTicks[dwBin] += qwTicks;
+		dir->qwBinBytes[dwBin] += dwBytes;
+		if (bSend)
+		{
+			dGapUs = TicksToSeconds(qwTicks) * 1e6;
+			dir->dGapSum[dwBin] += dGapUs;
+			dir->dGapSq[dwBin] += dGapUs * dGapUs;
+			dir->dwGaps[dwBin]++;
+		}
+	}
+	dir->liLast = liNow;
+	dir->qwBytes += dwBytes;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AddSample
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AddSample(LPReservoir r, INT nSample)
+--							LPReservoir r:	The samples.
+--							INT nSample:	A delay in microseconds.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Once the reservoir is full, sample n replaces a random one with probability DUPLEX_SAMPLES / n, so every sample
+-- offered is equally likely to be kept.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID AddSample(LPReservoir r, INT nSample)
+{
+	DWORD dwSlot;
+
+	if (r->dwCount == 0 || nSample < r->nMin)
+		r->nMin = nSample;
+	if (r->dwCount < DUPLEX_SAMPLES)
+		r->samples[r->dwCount] = nSample;
+	else
+	{
+		dwRng = dwRng * 1664525 + 1013904223;
+		if ((dwSlot = dwRng % (r->dwCount + 1)) < DUPLEX_SAMPLES)
+			r->samples[dwSlot] = nSample;
+	}
+	r->dwCount++;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReadStamp
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReadStamp(LPDuplexState d, const PayloadStamp *stamp)
+--							LPDuplexState d:			The duplex state.
+--							const PayloadStamp *stamp:	A packet's stamp, just arrived.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID ReadStamp(LPDuplexState d, const PayloadStamp *stamp)
+{
+	DWORD dwNow = NowUs();
+
+	AddSample(IsBusy(&d->send) ? &owdBusy : &owdIdle, (INT)(dwNow - stamp->dwSendUs));
+	if (stamp->dwEchoUs != 0)
+		AddSample(&rtt, (INT)(dwNow - stamp->dwEchoUs));
+	d->dwPeerStamp = stamp->dwSendUs;
+	QueryPerformanceCounter(&d->liPeerStamp);
+	d->recv.dwPackets++;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PostDuplexSend
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PostDuplexSend(LPDuplexState d)
+--							LPDuplexState d:	The server's duplex state.
+--
+-- RETURNS: FALSE if the send couldn't be posted; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL PostDuplexSend(LPDuplexState d)
+{
+	DWORD	dwSent;
+	INT		nRet;
+
+	BuildPayload((BYTE *)d->wsaBuf.buf, d->nPacketSize, d->dwNextSeq, &d->payload);
+	StampDuplexPacket(d, (BYTE *)d->wsaBuf.buf, d->nPacketSize);
+
+	d->bPosted = TRUE;
+	if (d->nSockType == SOCK_STREAM)
+		nRet = WSASend(d->s, &d->wsaBuf, 1, &dwSent, 0, &d->ov, DuplexSendCompletion);
+	else
+		nRet = WSASendTo(d->s, &d->wsaBuf, 1, &dwSent, 0, (sockaddr *)&d->peer, d->nPeerLen, &d->ov,
+			DuplexSendCompletion);
+
+	if (nRet == SOCKET_ERROR && WSAGetLastError() != WSA_IO_PENDING)
+	{
+		d->bPosted = FALSE;
+		d->send.bDone = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PostDuplexRecv
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PostDuplexRecv(LPDuplexState d)
+--							LPDuplexState d:	The client's duplex state.
+--
+-- RETURNS: FALSE if the receive couldn't be posted; TRUE otherwise.
+--
+-- NOTES:
+-- Over TCP the server's totals follow the reverse data (see Control.cpp), so no more than the data is asked for.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL PostDuplexRecv(LPDuplexState d)
+{
+	DWORD	flags = 0;
+	INT		nRet;
+
+	d->wsaBuf.len = DUPLEX_RECVBUF;
+	if (d->nSockType == SOCK_STREAM && d->qwExpected < DUPLEX_RECVBUF)
+		d->wsaBuf.len = (DWORD)d->qwExpected;
+
+	d->bPosted = TRUE;
+	if (d->nSockType == SOCK_STREAM)
+		nRet = WSARecv(d->s, &d->wsaBuf, 1, NULL, &flags, &d->ov, DuplexRecvCompletion);
+	else
+		nRet = WSARecvFrom(d->s, &d->wsaBuf, 1, NULL, &flags, NULL, NULL, &d->ov, DuplexRecvCompletion);
+
+	if (nRet == SOCKET_ERROR && WSAGetLastError() != WSA_IO_PENDING)
+	{
+		d->bPosted = FALSE;
+		d->recv.bDone = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PrepareDuplex
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PrepareDuplex(LPTransferProps props)
+--							LPTransferProps props:	The client's transfer properties.
+--
+-- RETURNS: FALSE if -duplex was given for a transfer that can't be duplex; TRUE otherwise.
+--
+-- NOTES:
+-- Called before the client builds its first packet. Duplex transfers are test packets only, since the reverse
+-- direction mirrors them, and the packets need a payload header to carry the request and the stamps.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL PrepareDuplex(LPTransferProps props)
+{
+	LPDuplexState d = &props->duplex;
+
+	ResetDuplexState(d);
+	props->payload.dwFlags = 0;
+	if (!d->bRequested)
+		return TRUE;
+
+	if (props->szFileName[0] != 0 || (props->session.bEnabled && props->nSockType == SOCK_STREAM) ||
+		props->payload.dwKind == PAYLOAD_FILL)
+	{
+		MessageBox(NULL, TEXT("Duplex transfers send generated test packets (not fill), without -session."),
+			TEXT("Can't Run Duplex"), MB_ICONERROR);
+		return FALSE;
+	}
+	if (props->nPacketSize < PAYLOAD_STAMPED_START || props->nNumToSend == 0)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Can't Run Duplex"), TEXT("Duplex packets must be at least %d bytes."),
+			(INT)PAYLOAD_STAMPED_START);
+		return FALSE;
+	}
+
+	d->bActive = TRUE;
+	props->payload.dwFlags = PAYLOAD_FLAG_STAMPED | PAYLOAD_FLAG_DUPLEX;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ResetDuplexState
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ResetDuplexState(LPDuplexState d)
+--							LPDuplexState d:	The duplex state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Clears everything but the -duplex setting, along with the delay samples. The buffer must have been freed.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID ResetDuplexState(LPDuplexState d)
+{
+	BOOL bRequested = d->bRequested;
+
+	memset(d, 0, sizeof(DuplexState));
+	d->bRequested = bRequested;
+	d->s = INVALID_SOCKET;
+	owdBusy.dwCount = owdIdle.dwCount = rtt.dwCount = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StartDuplexReceive
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StartDuplexReceive(LPTransferProps props)
+--							LPTransferProps props:	The client's transfer properties.
+--
+-- RETURNS: FALSE if the buffer couldn't be allocated or the receive couldn't be posted; TRUE otherwise.
+--
+-- NOTES:
+-- Called once the first packet has been sent; a UDP socket has no port to receive on until then.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL StartDuplexReceive(LPTransferProps props)
+{
+	LPDuplexState d = &props->duplex;
+
+	d->s = props->socket;
+	d->nSockType = props->nSockType;
+	d->nPacketSize = props->nPacketSize;
+	d->nNumToSend = props->nNumToSend;
+	d->qwExpected = (ULONGLONG)d->nPacketSize * d->nNumToSend;
+	InitPayloadState(&d->payload);
+
+	if ((d->wsaBuf.buf = (CHAR *)PoolAlloc(DUPLEX_RECVBUF)) == NULL)
+	{
+		MessageBox(NULL, TEXT("Couldn't allocate the duplex receive buffer."), TEXT("No Memory Allocated"), MB_ICONERROR);
+		return FALSE;
+	}
+	if (!PostDuplexRecv(d))
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Duplex Failed"), TEXT("Couldn't receive the reverse direction; error %d"),
+			WSAGetLastError());
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StartDuplexSend
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StartDuplexSend(LPTransferProps props, const SOCKADDR_STORAGE *to, INT nToLen)
+--							LPTransferProps props:			The server's transfer properties, with the client's packet
+--															size, count and payload settings.
+--							const SOCKADDR_STORAGE *to:		The client (UDP), or NULL (TCP).
+--							INT nToLen:						The length of its address.
+--
+-- RETURNS: FALSE if the reverse direction couldn't start; TRUE otherwise.
+--
+-- NOTES:
+-- Called when the first of the client's duplex packets arrives. The reverse packets are generated the same way as the
+-- client's, from the next seed. A server that can't start just receives, and the client times out waiting.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL StartDuplexSend(LPTransferProps props, const SOCKADDR_STORAGE *to, INT nToLen)
+{
+	LPDuplexState d = &props->duplex;
+
+	d->bActive = TRUE;
+	d->bServer = TRUE;
+	d->s = props->socket;
+	d->nSockType = props->nSockType;
+	if (to != NULL)
+	{
+		d->peer = *to;
+		d->nPeerLen = nToLen;
+	}
+	d->nPacketSize = props->nPacketSize;
+	d->nNumToSend = props->nNumToSend;
+	d->dwNextSeq = 0;
+
+	InitPayloadState(&d->payload);
+	d->payload.dwKind = props->payload.dwKind;
+	d->payload.dwBits = props->payload.dwBits;
+	d->payload.dwSeed = props->payload.dwSeed + 1;
+	d->payload.bSeedGiven = TRUE;
+	StartPayload(&d->payload, d->nPacketSize);
+	d->payload.dwFlags = PAYLOAD_FLAG_STAMPED;
+
+	if (d->nPacketSize < PAYLOAD_STAMPED_START || d->nNumToSend == 0 ||
+		(d->wsaBuf.buf = (CHAR *)PoolAlloc(d->nPacketSize)) == NULL)
+	{
+		d->send.bDone = TRUE;
+		return FALSE;
+	}
+	d->wsaBuf.len = d->nPacketSize;
+	((DWORD *)d->wsaBuf.buf)[0] = d->nNumToSend;
+	((DWORD *)d->wsaBuf.buf)[1] = d->nPacketSize;
+	return PostDuplexSend(d);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StampDuplexPacket
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StampDuplexPacket(LPDuplexState d, BYTE *buf, DWORD dwLen)
+--							LPDuplexState d:	The duplex state.
+--							BYTE *buf:			A test packet about to be sent.
+--							DWORD dwLen:		Its length.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Does nothing unless the transfer is duplex, so the client calls it for every packet.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID StampDuplexPacket(LPDuplexState d, BYTE *buf, DWORD dwLen)
+{
+	LPPayloadStamp stamp = (LPPayloadStamp)(buf + sizeof(PayloadHeader));
+
+	if (!d->bActive || dwLen < PAYLOAD_STAMPED_START)
+		return;
+	stamp->dwSendUs = NowUs();
+	stamp->dwEchoUs = d->liPeerStamp.QuadPart != 0 ? d->dwPeerStamp + ElapsedUs(&d->liPeerStamp) : 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NoteDuplexSend
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NoteDuplexSend(LPDuplexState d, DWORD dwBytes)
+--							LPDuplexState d:	The duplex state.
+--							DWORD dwBytes:		The bytes a forward send completion sent (client).
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID NoteDuplexSend(LPDuplexState d, DWORD dwBytes)
+{
+	if (!d->bActive)
+		return;
+	NoteEvent(&d->send, &d->recv, dwBytes, TRUE);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NoteDuplexPacket
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NoteDuplexPacket(LPDuplexState d, const BYTE *data, DWORD dwLen)
+--							LPDuplexState d:	The duplex state.
+--							const BYTE *data:	A stamped datagram, just received.
+--							DWORD dwLen:		Its length.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID NoteDuplexPacket(LPDuplexState d, const BYTE *data, DWORD dwLen)
+{
+	PayloadStamp stamp;
+
+	if (!d->bActive)
+		return;
+	NoteEvent(&d->recv, &d->send, dwLen, FALSE);
+	if (dwLen >= PAYLOAD_STAMPED_START)
+	{
+		memcpy(&stamp, data + sizeof(PayloadHeader), sizeof(stamp));
+		ReadStamp(d, &stamp);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NoteDuplexStream
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NoteDuplexStream(LPDuplexState d, const BYTE *data, DWORD dwLen, ULONGLONG qwOffset, DWORD dwPacketSize)
+--							LPDuplexState d:		The duplex state.
+--							const BYTE *data:		Bytes just received on the TCP stream.
+--							DWORD dwLen:			How many.
+--							ULONGLONG qwOffset:		Where in the stream they start.
+--							DWORD dwPacketSize:		The size of the packets the stream is made of.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- A packet's stamp may be split across receives, so its bytes are gathered in d->stamp until the last one arrives.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID NoteDuplexStream(LPDuplexState d, const BYTE *data, DWORD dwLen, ULONGLONG qwOffset, DWORD dwPacketSize)
+{
+	DWORD dwPos, n;
+
+	if (!d->bActive || dwLen == 0)
+		return;
+	NoteEvent(&d->recv, &d->send, dwLen, FALSE);
+	if (dwPacketSize < PAYLOAD_STAMPED_START)
+		return;
+
+	while (dwLen != 0)
+	{
+		dwPos = (DWORD)(qwOffset % dwPacketSize);
+		if (dwPos < sizeof(PayloadHeader))
+			n = min((DWORD)sizeof(PayloadHeader) - dwPos, dwLen);
+		else if (dwPos < PAYLOAD_STAMPED_START)
+		{
+			n = min((DWORD)PAYLOAD_STAMPED_START - dwPos, dwLen);
+			memcpy(d->stamp + dwPos - sizeof(PayloadHeader), data, n);
+			if (dwPos + n == PAYLOAD_STAMPED_START)
+				ReadStamp(d, (const PayloadStamp *)d->stamp);
+		}
+		else
+			n = min(dwPacketSize - dwPos, dwLen);
+
+		data += n;
+		dwLen -= n;
+		qwOffset += n;
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DuplexSendCompletion
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DuplexSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered, LPOVERLAPPED lpOverlapped,
+--									DWORD dwFlags)
+--							DWORD dwErrorCode:					0 if there were no errors; otherwise, a socket error code.
+--							DWORD dwNumberOfBytesTransferred:	The number of bytes sent.
+--							LPOVERLAPPED lpOverlapped:			The duplex state's overlapped structure.
+--							DWORD dwFlags:						Not used.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Windows calls this on the server thread whenever a reverse packet has been sent. It posts the next one until they've
+-- all gone. An error just ends the reverse direction; the forward one carries on.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID CALLBACK DuplexSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
+	LPOVERLAPPED lpOverlapped, DWORD dwFlags)
+{
+	LPDuplexState d = (LPDuplexState)lpOverlapped;
+
+	d->bPosted = FALSE;
+	if (dwErrorCode != 0)
+	{
+		d->send.bDone = TRUE;
+		return;
+	}
+
+	NoteEvent(&d->send, &d->recv, dwNumberOfBytesTransfered, TRUE);
+	if (++d->dwNextSeq >= d->nNumToSend || d->bStop)
+	{
+		d->send.bDone = TRUE;
+		return;
+	}
+	PostDuplexSend(d);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DuplexRecvCompletion
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DuplexRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered, LPOVERLAPPED lpOverlapped,
+--									DWORD dwFlags)
+--							DWORD dwErrorCode:					0 if there were no errors; otherwise, a socket error code.
+--							DWORD dwNumberOfBytesTransferred:	The number of bytes received.
+--							LPOVERLAPPED lpOverlapped:			The duplex state's overlapped structure.
+--							DWORD dwFlags:						Not used.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Windows calls this on the client thread whenever reverse data arrives. The data is checked and its stamps read, and
+-- another receive posted until all of it is in. Datagrams that aren't reverse packets (answers to the forward
+-- direction that turn up late) are skipped, as are ICMP port unreachable reports.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID CALLBACK DuplexRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
+	LPOVERLAPPED lpOverlapped, DWORD dwFlags)
+{
+	LPDuplexState	d	= (LPDuplexState)lpOverlapped;
+	const BYTE		*data = (const BYTE *)d->wsaBuf.buf;
+	ULONGLONG		qwOffset;
+
+	d->bPosted = FALSE;
+	if (d->recv.bDone || (dwErrorCode != 0 && (d->nSockType == SOCK_STREAM || dwErrorCode != WSAECONNRESET)))
+	{
+		d->recv.bDone = TRUE;
+		return;
+	}
+
+	if (d->nSockType == SOCK_STREAM)
+	{
+		if (dwNumberOfBytesTransfered == 0)
+		{
+			d->recv.bDone = TRUE;
+			return;
+		}
+		qwOffset = d->payload.qwStreamOffset;
+		CheckPayloadStream(&d->payload, data, dwNumberOfBytesTransfered, d->nPacketSize);
+		NoteDuplexStream(d, data, dwNumberOfBytesTransfered, qwOffset, d->nPacketSize);
+		if ((d->qwExpected -= dwNumberOfBytesTransfered) == 0)
+		{
+			d->recv.bDone = TRUE;
+			return;
+		}
+	}
+	else if (dwErrorCode == 0 && dwNumberOfBytesTransfered == d->nPacketSize &&
+		((const PayloadHeader *)data)->dwMagic == PAYLOAD_MAGIC)
+	{
+		CheckPayloadPacket(&d->payload, data, dwNumberOfBytesTransfered);
+		NoteDuplexPacket(d, data, dwNumberOfBytesTransfered);
+		if (d->recv.dwPackets >= d->nNumToSend)
+		{
+			d->recv.bDone = TRUE;
+			return;
+		}
+	}
+	PostDuplexRecv(d);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StopDuplex
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StopDuplex(LPDuplexState d)
+--							LPDuplexState d:	The duplex state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Cancels the outstanding reverse receive, or lets the outstanding send finish, and waits for its completion routine
+-- so the buffer can be freed.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID StopDuplex(LPDuplexState d)
+{
+	LARGE_INTEGER liStart;
+
+	d->bStop = TRUE;
+	d->recv.bDone = TRUE;
+	if (!d->bPosted)
+		return;
+	if (!d->bServer)
+		CancelIoEx((HANDLE)d->s, &d->ov);
+
+	QueryPerformanceCounter(&liStart);
+	while (d->bPosted && ElapsedUs(&liStart) < COMM_TIMEOUT * 1000)
+		SleepEx(DUPLEX_POLL_MS, TRUE);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FinishDuplex
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FinishDuplex(LPDuplexState d)
+--							LPDuplexState d:	The duplex state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called once the forward data is over, before the end of the transfer is exchanged (see Control.cpp). Each end waits
+-- for the direction it still has going to finish, or to stall. The client waits for the rest of the reverse data: over
+-- TCP for all of it, since the server's totals come after it on the stream; over UDP until nothing has arrived for
+-- DUPLEX_IDLE_MS, since lost datagrams never will. The server finishes sending the reverse packets, giving up once no
+-- send has completed for COMM_TIMEOUT.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FinishDuplex(LPDuplexState d)
+{
+	LPDuplexDir		dir		= d->bServer ? &d->send : &d->recv;
+	DWORD			dwWaitMs = !d->bServer && d->nSockType == SOCK_DGRAM ? DUPLEX_IDLE_MS : COMM_TIMEOUT;
+	LARGE_INTEGER	liStart, liSince;
+
+	if (!d->bActive)
+		return;
+
+	(d->bServer ? &d->recv : &d->send)->bDone = TRUE;
+	QueryPerformanceCounter(&liStart);
+	while (d->bPosted && !dir->bDone)
+	{
+		liSince = dir->liLast.QuadPart > liStart.QuadPart ? dir->liLast : liStart;
+		if (ElapsedUs(&liSince) >= dwWaitMs * 1000)
+			break;
+		SleepEx(DUPLEX_POLL_MS, TRUE);
+	}
+	StopDuplex(d);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FreeDuplex
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FreeDuplex(LPDuplexState d)
+--							LPDuplexState d:	The duplex state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Stops the reverse direction if a transfer was cut short, and frees its buffer. The counters are left for the
+-- report.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FreeDuplex(LPDuplexState d)
+{
+	StopDuplex(d);
+	PoolFree(d->wsaBuf.buf);
+	d->wsaBuf.buf = NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CompareInts
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CompareInts(const void *a, const void *b)
+--
+-- RETURNS: qsort's ordering for ints.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int CompareInts(const void *a, const void *b)
+{
+	INT x = *(const INT *)a, y = *(const INT *)b;
+	return (x > y) - (x < y);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SortSamples
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SortSamples(const Reservoir *r, INT *sorted)
+--							const Reservoir *r:		The samples.
+--							INT *sorted:			Receives them in order (DUPLEX_SAMPLES entries).
+--
+-- RETURNS: The number of samples.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD SortSamples(const Reservoir *r, INT *sorted)
+{
+	DWORD dwCount = min(r->dwCount, (DWORD)DUPLEX_SAMPLES);
+
+	memcpy(sorted, r->samples, dwCount * sizeof(INT));
+	qsort(sorted, dwCount, sizeof(INT), CompareInts);
+	return dwCount;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RateText
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RateText(CHAR *out, size_t size, ULONGLONG qwBytes, ULONGLONG qwTicks)
+--							CHAR *out:			Receives the rate.
+--							size_t size:		The size of out.
+--							ULONGLONG qwBytes:	Bytes moved.
+--							ULONGLONG qwTicks:	In this long.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID RateText(CHAR *out, size_t size, ULONGLONG qwBytes, ULONGLONG qwTicks)
+{
+	if (qwTicks == 0)
+		sprintf_s(out, size, "n/a");
+	else
+		sprintf_s(out, size, "%.1f Mbit/s", qwBytes * 8 / TicksToSeconds(qwTicks) / 1e6);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatDirection
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatDirection(CHAR *buf, size_t size, LPDuplexDir dir, const CHAR *szName, const CHAR *szOther)
+--							CHAR *buf:				The buffer to write the line into.
+--							size_t size:			The space left in buf.
+--							LPDuplexDir dir:		The direction.
+--							const CHAR *szName:		What this end does in it ("sending" or "receiving").
+--							const CHAR *szOther:	What this end does in the other.
+--
+-- RETURNS: The number of characters written.
+---------------------------------------------------------------------------------------------------------------------------*/
+static INT FormatDirection(CHAR *buf, size_t size, LPDuplexDir dir, const CHAR *szName, const CHAR *szOther)
+{
+	CHAR szAll[32], szBusy[32], szIdle[32];
+
+	RateText(szAll, sizeof(szAll), dir->qwBinBytes[0] + dir->qwBinBytes[1], dir->qwBinTicks[0] + dir->qwBinTicks[1]);
+	RateText(szBusy, sizeof(szBusy), dir->qwBinBytes[1], dir->qwBinTicks[1]);
+	RateText(szIdle, sizeof(szIdle), dir->qwBinBytes[0], dir->qwBinTicks[0]);
+	return sprintf_s(buf, size, "Duplex %s: %.2f MB in %.1fms, %s; %s while %s, %s alone\r\n", szName,
+		dir->qwBytes / 1e6, TicksToSeconds(dir->qwBinTicks[0] + dir->qwBinTicks[1]) * 1e3, szAll, szBusy, szOther,
+		szIdle);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatDelays
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatDelays(CHAR *buf, size_t size, INT *sorted)
+--							CHAR *buf:		The buffer to write the line into.
+--							size_t size:	The space left in buf.
+--							INT *sorted:	Scratch space for DUPLEX_SAMPLES samples.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The one-way delays include the difference between the two ends' clocks, so only their rise above the smallest is
+-- reported. Over a long transfer the clocks' drift creeps into it, by tens of microseconds a second at most.
+---------------------------------------------------------------------------------------------------------------------------*/
+static INT FormatDelays(CHAR *buf, size_t size, INT *sorted)
+{
+	INT			written = 0;
+	INT			nBase;
+	DWORD		dwCount;
+	LPReservoir	r[2] = { &owdBusy, &owdIdle };
+	DWORD		i;
+
+	if (owdBusy.dwCount == 0 && owdIdle.dwCount == 0)
+		return 0;
+	if (owdBusy.dwCount == 0)
+		nBase = owdIdle.nMin;
+	else if (owdIdle.dwCount == 0)
+		nBase = owdBusy.nMin;
+	else
+		nBase = min(owdBusy.nMin, owdIdle.nMin);
+
+	written += sprintf_s(buf, size, "Duplex queuing delay (receiving):");
+	for (i = 0; i < 2; i++)
+	{
+		if ((dwCount = SortSamples(r[i], sorted)) == 0)
+			written += sprintf_s(buf + written, size - written, "%s none %s", i == 0 ? "" : ";",
+				i == 0 ? "while sending" : "alone");
+		else
+			written += sprintf_s(buf + written, size - written, "%s median %.2fms, p99 %.2fms %s", i == 0 ? "" : ";",
+				(sorted[dwCount / 2] - nBase) / 1e3, (sorted[(DWORD)(dwCount * 0.99)] - nBase) / 1e3,
+				i == 0 ? "while sending" : "alone");
+	}
+	written += sprintf_s(buf + written, size - written, "\r\n");
+
+	if ((dwCount = SortSamples(&rtt, sorted)) != 0)
+		written += sprintf_s(buf + written, size - written,
+			"Duplex RTT under load: min %.2fms, median %.2fms, p99 %.2fms (%lu samples)\r\n", max(sorted[0], 0) / 1e3,
+			max(sorted[dwCount / 2], 0) / 1e3, max(sorted[(DWORD)(dwCount * 0.99)], 0) / 1e3, rtt.dwCount);
+	return written;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatDuplexReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatDuplexReport(CHAR *buf, size_t size, LPDuplexState d)
+--							CHAR *buf:			The buffer to write the report section into.
+--							size_t size:		The space left in buf.
+--							LPDuplexState d:	The duplex state.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- Both ends report both directions from where they stand. The interference line compares each direction's throughput
+-- while the other was busy with its throughput alone; with equal loads the directions mostly overlap, so "alone" is the
+-- start and the tail. The spread of the gaps between send completions (their standard deviation over their mean)
+-- rising while receiving is the sign of ACK compression over TCP.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatDuplexReport(CHAR *buf, size_t size, LPDuplexState d)
+{
+	INT			written = 0;
+	INT			*sorted;
+	LPDuplexDir	dirs[2] = { &d->send, &d->recv };
+	double		dRate[2], dMean, dCv[2];
+	DWORD		i, j;
+
+	if (!d->bActive)
+		return 0;
+
+	written += sprintf_s(buf, size, "Duplex: %lu-byte packets both ways, %lu received of %lu\r\n", d->nPacketSize,
+		d->recv.dwPackets, d->nNumToSend);
+	written += FormatDirection(buf + written, size - written, &d->send, "sending", "receiving");
+	written += FormatDirection(buf + written, size - written, &d->recv, "receiving", "sending");
+
+	written += sprintf_s(buf + written, size - written, "Duplex interference:");
+	for (i = 0; i < 2; i++)
+	{
+		for (j = 0; j < 2; j++)
+			dRate[j] = dirs[i]->qwBinTicks[j] != 0 ? dirs[i]->qwBinBytes[j] / TicksToSeconds(dirs[i]->qwBinTicks[j]) : 0.0;
+		if (dRate[0] > 0.0 && dirs[i]->qwBinTicks[1] != 0)
+			written += sprintf_s(buf + written, size - written, " %s %+.1f%%%s", i == 0 ? "sending" : "receiving",
+				(dRate[1] / dRate[0] - 1.0) * 100, i == 0 ? "," : "");
+		else
+			written += sprintf_s(buf + written, size - written, " %s n/a%s", i == 0 ? "sending" : "receiving",
+				i == 0 ? "," : "");
+	}
+	written += sprintf_s(buf + written, size - written, " throughput with both directions busy\r\n");
+
+	for (j = 0; j < 2; j++)
+	{
+		dCv[j] = 0.0;
+		if (d->send.dwGaps[j] > 1 && (dMean = d->send.dGapSum[j] / d->send.dwGaps[j]) > 0.0)
+			dCv[j] = sqrt(max(d->send.dGapSq[j] / d->send.dwGaps[j] - dMean * dMean, 0.0)) / dMean;
+	}
+	written += sprintf_s(buf + written, size - written,
+		"Duplex send completion spread: %.2f while receiving, %.2f alone\r\n", dCv[1], dCv[0]);
+
+	if ((sorted = (INT *)PoolAlloc(DUPLEX_SAMPLES * sizeof(INT))) != NULL)
+	{
+		written += FormatDelays(buf + written, size - written, sorted);
+		PoolFree(sorted);
+	}
+
+	if (!d->bServer && d->payload.bActive)
+	{
+		if (d->payload.dwBadPackets == 0)
+			written += sprintf_s(buf + written, size - written, "Duplex payload check: %lu packets verified\r\n",
+				d->payload.dwPackets);
+		else
+			written += sprintf_s(buf + written, size - written,
+				"Duplex payload check: FAILED, %lu of %lu packets corrupt (first: packet %lu)\r\n",
+				d->payload.dwBadPackets, d->payload.dwPackets, d->payload.dwFirstBad);
+	}
+	return written;
+}
@@ -0,0 +1,48 @@
+#ifndef DUPLEX_H
+#define DUPLEX_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Connect.h"
+#include "Payload.h"
+#include "Control.h"
+#include "Pool.h"
+
+#define DUPLEX_IDLE_MS		300			// A direction this long without traffic is idle; the client waits this long for
+										// the last reverse datagrams
+#define DUPLEX_LINGER_MS	(CONTROL_LINGER_MS + DUPLEX_IDLE_MS)	// So the server outlasts that wait
+#define DUPLEX_POLL_MS		10			// How often the ends check on the reverse direction while finishing
+#define DUPLEX_RECVBUF		65536		// The client's reverse receive buffer
+#define DUPLEX_SAMPLES		16384		// Delay samples kept for each percentile
+
+/* Delay samples, thinned out evenly once there are more than it holds so the percentiles cover the whole transfer. */
+typedef struct _Reservoir
+{
+	DWORD		dwCount;		// Samples offered
+	INT			nMin;			// The smallest offered, kept or not
+	INT			samples[DUPLEX_SAMPLES];
+} Reservoir, *LPReservoir;
+
+BOOL PrepareDuplex(LPTransferProps props);
+VOID ResetDuplexState(LPDuplexState d);
+BOOL StartDuplexReceive(LPTransferProps props);
+BOOL StartDuplexSend(LPTransferProps props, const SOCKADDR_STORAGE *to, INT nToLen);
+VOID StampDuplexPacket(LPDuplexState d, BYTE *buf, DWORD dwLen);
+VOID NoteDuplexSend(LPDuplexState d, DWORD dwBytes);
+VOID NoteDuplexPacket(LPDuplexState d, const BYTE *data, DWORD dwLen);
+VOID NoteDuplexStream(LPDuplexState d, const BYTE *data, DWORD dwLen, ULONGLONG qwOffset, DWORD dwPacketSize);
+VOID FinishDuplex(LPDuplexState d);
+VOID FreeDuplex(LPDuplexState d);
+INT FormatDuplexReport(CHAR *buf, size_t size, LPDuplexState d);
+VOID CALLBACK DuplexSendCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
+	LPOVERLAPPED lpOverlapped, DWORD dwFlags);
+VOID CALLBACK DuplexRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
+	LPOVERLAPPED lpOverlapped, DWORD dwFlags);
+
+#endif
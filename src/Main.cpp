@@ -5,6 +5,7 @@
 --
 -- FUNCTIONS:
 -- LPTransferProps CreateTransferProps();
+-- BOOL ParseCmdArgs(LPSTR lpszCmdArgs, LPTransferProps props);
 -- int WINAPI WinMain(HINSTANCE hPrevInstance, HINSTANCE hInstance, LPSTR lpszCmdArgs, int iCmdShow);
 --
 -- DATE: February 1st, 2014
@@ -14,7 +15,7 @@
 -- PROGRAMMER: Shane Spoor
 --
 -- NOTES: This file contains functions that set up the window and transfer properties for use. It is also the entry point
---		  to the program.
+--		  to the program. Options with no place in the transfer dialog are taken from the command line.
 -------------------------------------------------------------------------------------------------------------------------*/
 
 #include "Main.h"
@@ -66,6 +67,11 @@ int WINAPI WinMain(HINSTANCE hPrevInstance, HINSTANCE hInstance, LPSTR lpszCmdAr
 	}
 
 	WSAStartup(MAKEWORD(2, 2), &wsaData);
+	InitChecksum();
+	InitResolver();
+	InitPayload();
+	InitCrypt();
+	InitDedup();
 
 	if ((props = CreateTransferProps()) == NULL)
 	{
@@ -73,6 +79,27 @@ int WINAPI WinMain(HINSTANCE hPrevInstance, HINSTANCE hInstance, LPSTR lpszCmdAr
 		return -1;
 	}
 
+	if (!ParseCmdArgs(lpszCmdArgs, props))
+		return -1;
+
+	// Sweeps and benchmarks run unattended; there's no window to show, and no transfers for the workers
+	if (props->sim.szSweep[0] != 0)
+	{
+		INT nResult = RunSimSweep(props);
+		WSACleanup();
+		return nResult;
+	}
+	if (props->bench.szBaseline[0] != 0)
+	{
+		INT nResult = RunBenchmarks(props);
+		WSACleanup();
+		return nResult;
+	}
+
+	if (!InitWorkers())
+		MessageBox(NULL, TEXT("Could not start the worker threads; each transfer will have a thread of its own."),
+			TEXT("No Workers"), MB_ICONWARNING);
+
 	hwnd = CreateWindow(CLASS_NAME, TEXT("Test Program"), WS_OVERLAPPEDWINDOW,
 		0, 0, 600, 600, NULL, NULL, hInstance, NULL);
 
@@ -121,17 +148,9 @@ LPTransferProps CreateTransferProps()
 	props->nPacketSize = DEF_PACKETSIZE;
 	props->nNumToSend = DEF_NUMTOSEND;
 
-	props->paddr_in = (LPSOCKADDR_IN)malloc(sizeof(SOCKADDR_IN));
-	if(props->paddr_in == NULL)
-	{
-		free(props);
-		return NULL;
-	}
-
-	memset(props->paddr_in, 0, sizeof(sockaddr_in));
-	props->paddr_in->sin_addr.s_addr	= inet_addr("127.0.0.1");
-	props->paddr_in->sin_family			= AF_INET;
-	props->paddr_in->sin_port			= htons(DEF_PORTNUM);
+	ParseAddress(TEXT("127.0.0.1"), &props->addr, &props->nAddrLen);
+	props->usPort = DEF_PORTNUM;
+	memset(&props->connect, 0, sizeof(ConnectState));
 	
 	props->socket = 0;
 	props->nSockType = SOCK_STREAM;
@@ -142,5 +161,478 @@ LPTransferProps CreateTransferProps()
 	memset(&props->endTime, 0, sizeof(SYSTEMTIME));
 
 	props->dwTimeout = COMM_TIMEOUT;
+
+	memset(&props->tuning, 0, sizeof(SocketTuning));
+	LoadTuningProfile(&props->tuning, TEXT("default"));
+
+	memset(&props->compress, 0, sizeof(CompressState));
+	props->compress.dwMode = COMPRESS_OFF;
+
+	memset(&props->integrity, 0, sizeof(IntegrityState));
+	memset(&props->delta, 0, sizeof(DeltaState));
+	memset(&props->dedup, 0, sizeof(DedupState));
+	_tcscpy_s(props->dedup.szStoreDir, DEDUP_DEF_STORE);
+	memset(&props->batch, 0, sizeof(BatchState));
+	InitSessionState(&props->session);
+	InitPayloadState(&props->payload);
+	InitControlState(&props->control);
+	memset(&props->pmtu, 0, sizeof(PmtuState));
+	props->pmtu.dwMode = PMTU_PROBE;
+	memset(&props->duplex, 0, sizeof(DuplexState));
+	memset(&props->multicast, 0, sizeof(MulticastState));
+	props->multicast.dwHops = MCAST_DEF_HOPS;
+	props->multicast.s = INVALID_SOCKET;
+	memset(&props->worker, 0, sizeof(WorkerStats));
+	InitSchedState(&props->sched);
+	InitPollState(&props->poll);
+	memset(&props->affinity, 0, sizeof(AffinityState));
+	InitCryptState(&props->crypt);
+	memset(&props->trace, 0, sizeof(TraceState));
+	InitCaptureState(&props->capture);
+	InitReplayState(&props->replay);
+	memset(&props->sim, 0, sizeof(SimState));
+	memset(&props->bench, 0, sizeof(BenchState));
+	props->bench.dwTolerance = BENCH_DEF_TOL;
 	return props;
 }
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NextArg
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NextArg(CHAR **context, const CHAR *szOpt)
+--						CHAR **context:		The strtok_s context for the command line.
+--						CHAR *szOpt:		The option whose value is being read (for the error message).
+--
+-- RETURNS: The option's value, or NULL if the command line ended first.
+---------------------------------------------------------------------------------------------------------------------------*/
+static CHAR *NextArg(CHAR **context, const CHAR *szOpt)
+{
+	CHAR *szValue = strtok_s(NULL, " \t", context);
+	if (szValue == NULL)
+		MessageBoxA(NULL, szOpt, "Missing Option Value", MB_ICONERROR);
+	return szValue;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ParseCmdArgs
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ParseCmdArgs(LPSTR lpszCmdArgs, LPTransferProps props)
+--						LPSTR lpszCmdArgs:		The command line passed to WinMain (modified in place).
+--						LPTransferProps props:	The transfer properties to fill.
+--
+-- RETURNS: FALSE if an option is unknown or has a bad value; TRUE otherwise.
+--
+-- NOTES:
+-- Reads the options that have no control in the transfer dialog:
+--		-tune <profile>		Socket tuning profile: default, nonagle, bulk, lowlatency or auto.
+--		-linkmbps <n>		Link rate (Mbit/s) the auto profile multiplies the RTT by.
+--		-compress <mode>	File chunk compression: off, on or auto.
+--		-delta				Send only what differs from the server's copy of the file (TCP).
+--		-dedup				Offer the hashes of the file's chunks and send only those the server's store lacks (TCP).
+--		-dedupstore <dir>	Where the server keeps the chunks of dedup transfers (default ChunkStore).
+--		-session <seconds>	Keep the TCP connection for the next transfer, closing it after this long idle.
+--		-payload <kind>		Test packet contents: random, pattern, entropy or fill.
+--		-entropy <bits>		Bits of entropy per byte of an entropy payload (1-8); implies -payload entropy.
+--		-seed <n>			Seed for the test packets, instead of a new one per transfer.
+--		-hugepages			Back the packet buffer pool with large pages, if the user may lock pages in memory.
+--		-pmtu <mode>		Path MTU discovery before UDP transfers: off, probe or auto (size datagrams to fit).
+--		-duplex				Have the server send test packets back while the client sends, and report both ways.
+--		-multicast <group>	Join this multicast group and receive what's sent to it (UDP server).
+--		-mchops <n>			How many routers datagrams sent to a multicast group may cross (default 1).
+--		-workers <n>		Transfer worker threads, instead of one per core; 0 starts a thread per transfer.
+--		-weight <n>			The client's weight when transfers on this host share its limit (default 100).
+--		-ratecap <Mbit/s>	Limit the client's sending to this rate.
+--		-hostcap <Mbit/s>	Limit every transfer sending from this host together to this rate (0: no limit).
+--		-busypoll <cpu>		Spin on each transfer's I/O, pinned to this processor (or auto), instead of sleeping.
+--		-iocpus <where>		Run transfers on these processors or NUMA node ("0-3,8", "node1", or auto for the NIC's node).
+--		-diskcpus <where>	The same for the multi-file writers.
+--		-poolnode <node>	Make the buffer pool's memory on this NUMA node ("node1", or auto for the NIC's node).
+--		-psk <key>			Encrypt and authenticate the transfer with this shared key, or @<file> to read it from a file.
+--		-cipher <name>		The cipher -psk uses: auto, aesgcm or chacha.
+--		-trace <file>		Record each thread's I/O events and write them to this Chrome/Perfetto timeline after each transfer.
+--		-capture <file>		Record the size and arrival time of each datagram or receive the server gets to this file.
+--		-replay <file>		Send test packets with the sizes and timing recorded in this -capture file.
+--		-replayspeed <x>	How fast to replay: 1 as recorded (the default), 2 twice as fast, or max for flat out.
+--		-sim <link>			Simulate transfers over <Mbit/s>,<RTT ms>[,<loss %>[,<queue KB>]] instead of the network.
+--		-simsweep <file>	Simulate every link profile in the file, write the results to <file>.csv and exit.
+--		-bench <file>		Time the hot paths against the baseline in the file (made if missing) and exit.
+--		-benchtol <%>		How much slower than its baseline a benchmark may get before the run fails.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ParseCmdArgs(LPSTR lpszCmdArgs, LPTransferProps props)
+{
+	CHAR *context = NULL;
+	CHAR *szOpt;
+	CHAR *szValue;
+
+	for (szOpt = strtok_s(lpszCmdArgs, " \t", &context); szOpt != NULL; szOpt = strtok_s(NULL, " \t", &context))
+	{
+		if (_stricmp(szOpt, "-tune") == 0)
+		{
+			TCHAR szProfile[PROFILE_SIZE];
+
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			CHAR_2_TCHAR(szProfile, szValue, PROFILE_SIZE);
+			if (!LoadTuningProfile(&props->tuning, szProfile))
+			{
+				MessageBoxPrintf(MB_ICONERROR, TEXT("Unknown Profile"), TEXT("There is no socket tuning profile named %s."),
+					szProfile);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-linkmbps") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if ((props->tuning.dwLinkMbps = strtoul(szValue, NULL, 10)) == 0)
+			{
+				MessageBox(NULL, TEXT("The link rate must be a positive number of Mbit/s."), TEXT("Invalid Link Rate"),
+					MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-compress") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if (_stricmp(szValue, "off") == 0)
+				props->compress.dwMode = COMPRESS_OFF;
+			else if (_stricmp(szValue, "on") == 0)
+				props->compress.dwMode = COMPRESS_ON;
+			else if (_stricmp(szValue, "auto") == 0)
+				props->compress.dwMode = COMPRESS_ADAPTIVE;
+			else
+			{
+				MessageBoxA(NULL, szValue, "Unknown Compression Mode", MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-delta") == 0)
+			props->delta.bEnabled = TRUE;
+		else if (_stricmp(szOpt, "-dedup") == 0)
+			props->dedup.bEnabled = TRUE;
+		else if (_stricmp(szOpt, "-dedupstore") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			CHAR_2_TCHAR(props->dedup.szStoreDir, szValue, FILENAME_SIZE);
+		}
+		else if (_stricmp(szOpt, "-session") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if ((props->session.dwIdleMs = strtoul(szValue, NULL, 10) * 1000) == 0)
+			{
+				MessageBox(NULL, TEXT("The session idle timeout must be a positive number of seconds."),
+					TEXT("Invalid Idle Timeout"), MB_ICONERROR);
+				return FALSE;
+			}
+			props->session.bEnabled = TRUE;
+		}
+		else if (_stricmp(szOpt, "-payload") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if (_stricmp(szValue, "random") == 0)
+				props->payload.dwKind = PAYLOAD_RANDOM;
+			else if (_stricmp(szValue, "pattern") == 0)
+				props->payload.dwKind = PAYLOAD_PATTERN;
+			else if (_stricmp(szValue, "entropy") == 0)
+				props->payload.dwKind = PAYLOAD_ENTROPY;
+			else if (_stricmp(szValue, "fill") == 0)
+				props->payload.dwKind = PAYLOAD_FILL;
+			else
+			{
+				MessageBoxA(NULL, szValue, "Unknown Payload", MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-entropy") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			props->payload.dwBits = strtoul(szValue, NULL, 10);
+			if (props->payload.dwBits == 0 || props->payload.dwBits > 8)
+			{
+				MessageBox(NULL, TEXT("The entropy must be between 1 and 8 bits per byte."), TEXT("Invalid Entropy"),
+					MB_ICONERROR);
+				return FALSE;
+			}
+			props->payload.dwKind = PAYLOAD_ENTROPY;
+		}
+		else if (_stricmp(szOpt, "-seed") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			props->payload.dwSeed = strtoul(szValue, NULL, 0);
+			props->payload.bSeedGiven = TRUE;
+		}
+		else if (_stricmp(szOpt, "-hugepages") == 0)
+		{
+			// Not fatal; the pool just uses normal pages
+			if (!UsePoolHugePages())
+				MessageBox(NULL, TEXT("Large pages need the \"Lock pages in memory\" right; using normal pages instead."),
+					TEXT("Large Pages Unavailable"), MB_ICONWARNING);
+		}
+		else if (_stricmp(szOpt, "-pmtu") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if (_stricmp(szValue, "off") == 0)
+				props->pmtu.dwMode = PMTU_OFF;
+			else if (_stricmp(szValue, "probe") == 0)
+				props->pmtu.dwMode = PMTU_PROBE;
+			else if (_stricmp(szValue, "auto") == 0)
+				props->pmtu.dwMode = PMTU_AUTO;
+			else
+			{
+				MessageBoxA(NULL, szValue, "Unknown Path MTU Mode", MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-duplex") == 0)
+			props->duplex.bRequested = TRUE;
+		else if (_stricmp(szOpt, "-multicast") == 0)
+		{
+			TCHAR	szGroup[HOSTNAME_SIZE];
+			INT		nLen;
+
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			CHAR_2_TCHAR(szGroup, szValue, HOSTNAME_SIZE);
+			if (!ParseAddress(szGroup, &props->multicast.group, &nLen) || !IsMulticastAddress(&props->multicast.group))
+			{
+				MessageBoxPrintf(MB_ICONERROR, TEXT("Invalid Group"), TEXT("%s is not a multicast group address."),
+					szGroup);
+				return FALSE;
+			}
+			props->multicast.bJoin = TRUE;
+		}
+		else if (_stricmp(szOpt, "-mchops") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			props->multicast.dwHops = strtoul(szValue, NULL, 10);
+			if (props->multicast.dwHops == 0 || props->multicast.dwHops > 255)
+			{
+				MessageBox(NULL, TEXT("The multicast hop limit must be between 1 and 255."), TEXT("Invalid Hop Limit"),
+					MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-workers") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			SetWorkerCount(strtoul(szValue, NULL, 10));
+		}
+		else if (_stricmp(szOpt, "-weight") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			props->sched.dwWeight = strtoul(szValue, NULL, 10);
+			if (props->sched.dwWeight == 0 || props->sched.dwWeight > SCHED_MAX_WEIGHT)
+			{
+				MessageBox(NULL, TEXT("The weight must be between 1 and 10000."), TEXT("Invalid Weight"), MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-ratecap") == 0 || _stricmp(szOpt, "-hostcap") == 0)
+		{
+			double dMbps;
+
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			dMbps = atof(szValue);
+			if (dMbps < 0 || dMbps > 4000000 || (dMbps == 0 && _stricmp(szOpt, "-ratecap") == 0))
+			{
+				MessageBox(NULL, TEXT("The rate limit must be a positive number of Mbit/s (or 0 for -hostcap)."),
+					TEXT("Invalid Rate Limit"), MB_ICONERROR);
+				return FALSE;
+			}
+			if (_stricmp(szOpt, "-ratecap") == 0)
+				props->sched.dwCapKbps = max((DWORD)(dMbps * 1000), (DWORD)1);
+			else
+				props->sched.dwHostKbps = dMbps == 0 ? 0 : max((DWORD)(dMbps * 1000), (DWORD)1);
+		}
+		else if (_stricmp(szOpt, "-busypoll") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if (!ParsePollCpu(szValue, &props->poll))
+			{
+				MessageBox(NULL, TEXT("-busypoll takes a processor number or auto."), TEXT("Invalid Processor"),
+					MB_ICONERROR);
+				return FALSE;
+			}
+			props->tuning.bBusyPoll = TRUE;
+		}
+		else if (_stricmp(szOpt, "-iocpus") == 0 || _stricmp(szOpt, "-diskcpus") == 0 ||
+			_stricmp(szOpt, "-poolnode") == 0)
+		{
+			DWORD dwRole = _stricmp(szOpt, "-iocpus") == 0 ? AFFINITY_IO :
+				_stricmp(szOpt, "-diskcpus") == 0 ? AFFINITY_DISK : AFFINITY_POOL;
+
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if (!ParseAffinity(dwRole, szValue))
+			{
+				MessageBox(NULL, dwRole == AFFINITY_POOL ? TEXT("-poolnode takes node<n> or auto.") :
+					TEXT("Processors are given as a list such as 0-3,8 (group 0), node<n> or auto."),
+					TEXT("Invalid Placement"), MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-psk") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if (!IsCipherAvailable(CRYPT_CHACHA))
+			{
+				MessageBox(NULL, TEXT("Encryption isn't available: a cipher failed its self-test or Windows has no HMAC-SHA256."),
+					TEXT("Can't Encrypt"), MB_ICONERROR);
+				return FALSE;
+			}
+			if (!LoadPsk(&props->crypt, szValue))
+			{
+				MessageBox(NULL, TEXT("The key must be 16 to 128 characters, given directly or as @<file>."),
+					TEXT("Invalid Key"), MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-cipher") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if (_stricmp(szValue, "auto") == 0)
+				props->crypt.dwCiphers = CRYPT_AUTO;
+			else if (_stricmp(szValue, "aesgcm") == 0)
+				props->crypt.dwCiphers = CRYPT_AESGCM;
+			else if (_stricmp(szValue, "chacha") == 0)
+				props->crypt.dwCiphers = CRYPT_CHACHA;
+			else
+			{
+				MessageBoxA(NULL, szValue, "Unknown Cipher", MB_ICONERROR);
+				return FALSE;
+			}
+			if (props->crypt.dwCiphers == CRYPT_AESGCM && !IsCipherAvailable(CRYPT_AESGCM))
+			{
+				MessageBox(NULL, TEXT("AES-GCM needs a processor with AES-NI and PCLMULQDQ."), TEXT("Can't Use AES-GCM"),
+					MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-trace") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			StartTracing(szValue);
+		}
+		else if (_stricmp(szOpt, "-capture") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			strncpy_s(props->capture.szFile, FILENAME_SIZE, szValue, _TRUNCATE);
+		}
+		else if (_stricmp(szOpt, "-replay") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if (!LoadCapture(&props->replay, szValue))
+			{
+				MessageBox(NULL, TEXT("The capture file couldn't be read, or wasn't written by -capture."),
+					TEXT("Can't Replay"), MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-replayspeed") == 0)
+		{
+			CHAR *szEnd;
+
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if (_stricmp(szValue, "max") == 0)
+				props->replay.dSpeed = 0;
+			else if ((props->replay.dSpeed = strtod(szValue, &szEnd)) <= 0 || *szEnd != 0)
+			{
+				MessageBox(NULL, TEXT("The replay speed must be a positive multiple of the recorded speed, or max."),
+					TEXT("Invalid Replay Speed"), MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else if (_stricmp(szOpt, "-sim") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if (!ParseSimLink(szValue, &props->sim))
+			{
+				MessageBox(NULL, TEXT("The simulated link must be <Mbit/s>,<RTT ms>[,<loss %>[,<queue KB>]]."),
+					TEXT("Invalid Simulated Link"), MB_ICONERROR);
+				return FALSE;
+			}
+			props->sim.bEnabled = TRUE;
+		}
+		else if (_stricmp(szOpt, "-simsweep") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			strncpy_s(props->sim.szSweep, FILENAME_SIZE, szValue, _TRUNCATE);
+		}
+		else if (_stricmp(szOpt, "-bench") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			strncpy_s(props->bench.szBaseline, FILENAME_SIZE, szValue, _TRUNCATE);
+		}
+		else if (_stricmp(szOpt, "-benchtol") == 0)
+		{
+			if ((szValue = NextArg(&context, szOpt)) == NULL)
+				return FALSE;
+			if ((props->bench.dwTolerance = strtoul(szValue, NULL, 10)) == 0)
+			{
+				MessageBox(NULL, TEXT("The benchmark tolerance must be a positive percentage."), TEXT("Invalid Tolerance"),
+					MB_ICONERROR);
+				return FALSE;
+			}
+		}
+		else
+		{
+			MessageBoxA(NULL, szOpt, "Unknown Option", MB_ICONERROR);
+			return FALSE;
+		}
+	}
+
+	// Only the client's data is sealed, and a group has no single peer to agree a key with
+	if (props->crypt.bEnabled && (props->duplex.bRequested || props->multicast.bJoin))
+	{
+		MessageBox(NULL, TEXT("-psk can't be used with -duplex or -multicast."), TEXT("Can't Encrypt"), MB_ICONERROR);
+		return FALSE;
+	}
+
+	// Sealing and the duplex stamps work on whole packets of the one size, which a replay's sends aren't
+	if (props->replay.dwCount != 0 && (props->crypt.bEnabled || props->duplex.bRequested))
+	{
+		MessageBox(NULL, TEXT("-replay can't be used with -psk or -duplex."), TEXT("Can't Replay"), MB_ICONERROR);
+		return FALSE;
+	}
+
+	// Both replace the resume query, and each rebuilds the file its own way
+	if (props->delta.bEnabled && props->dedup.bEnabled)
+	{
+		MessageBox(NULL, TEXT("-delta and -dedup can't be used together."), TEXT("Conflicting Options"), MB_ICONERROR);
+		return FALSE;
+	}
+	return TRUE;
+}
@@ -5,6 +5,24 @@
 #include <Windows.h>
 #include <cstring>
 #include "WinStorage.h"
+#include "SocketTuning.h"
+#include "Checksum.h"
+#include "Session.h"
+#include "Connect.h"
+#include "Payload.h"
+#include "Control.h"
+#include "Multicast.h"
+#include "Pool.h"
+#include "Sim.h"
+#include "Bench.h"
+#include "Workers.h"
+#include "Sched.h"
+#include "BusyPoll.h"
+#include "Affinity.h"
+#include "Crypt.h"
+#include "Dedup.h"
+#include "Trace.h"
+#include "Capture.h"
 
 // Name constants
 #define CLASS_NAME	TEXT("Assn2")
@@ -15,6 +33,7 @@
 #define DEF_NUMTOSEND	10
 
 LPTransferProps CreateTransferProps();
+BOOL ParseCmdArgs(LPSTR lpszCmdArgs, LPTransferProps props);
 int WINAPI WinMain(HINSTANCE hPrevInstance, HINSTANCE hInstance, LPSTR lpszCmdArgs, int iCmdShow);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,387 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Manifest.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitManifestHeader(LPManifestHeader hdr, ULONGLONG qwFileSize, DWORD dwChunkSize, ULONGLONG qwFileId);
+-- BOOL CreateManifest(LPManifest m, const ManifestHeader *hdr);
+-- VOID FreeManifest(LPManifest m);
+-- BOOL LoadManifest(LPManifest m, const TCHAR *szDestFile, const ManifestHeader *query);
+-- BOOL SaveManifest(LPManifest m, HANDLE hDataFile);
+-- VOID CheckpointManifest(LPManifest m, HANDLE hDataFile);
+-- VOID DeleteManifest(LPManifest m);
+-- BOOL IsChunkPresent(LPManifest m, DWORD dwChunk);
+-- VOID MarkChunkPresent(LPManifest m, DWORD dwChunk, DWORD dwCrc);
+-- BOOL SendManifest(SOCKET s, LPManifest m);
+-- BOOL RecvManifest(SOCKET s, LPManifest m, const ManifestHeader *query);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file lets an interrupted TCP file transfer pick up where it left off. While receiving, the server keeps
+--			a bitmap of the chunks it has written and verified, along with their CRCs, and saves it beside the
+--			destination file (as <file>.manifest) every MANIFEST_CHECKPOINT_MS. The destination is flushed before
+--			each save, so the manifest never claims a chunk that isn't on disk.
+--
+--			When a transfer starts, the client sends the file's size, chunk size and last write time. If the server
+--			has a manifest that matches, it replies with it and the client sends only the missing chunks. The CRCs of
+--			the chunks that were skipped still go into both ends' whole-file digests, so the result is verified
+--			just as if the whole file had been sent. Once the transfer finishes the manifest is deleted.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Manifest.h"
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BitmapSize
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BitmapSize(const ManifestHeader *hdr)
+--
+-- RETURNS: The size of the manifest's chunk bitmap in bytes.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD BitmapSize(const ManifestHeader *hdr)
+{
+	return (hdr->dwChunks + 7) / 8;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitManifestHeader
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitManifestHeader(LPManifestHeader hdr, ULONGLONG qwFileSize, DWORD dwChunkSize, ULONGLONG qwFileId)
+--							LPManifestHeader hdr:	The header to fill.
+--							ULONGLONG qwFileSize:	The size of the file being sent.
+--							DWORD dwChunkSize:		Logical bytes per chunk.
+--							ULONGLONG qwFileId:		The file's last write time.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitManifestHeader(LPManifestHeader hdr, ULONGLONG qwFileSize, DWORD dwChunkSize, ULONGLONG qwFileId)
+{
+	hdr->dwMagic		= MANIFEST_MAGIC;
+	hdr->dwChunkSize	= dwChunkSize;
+	hdr->qwFileSize		= qwFileSize;
+	hdr->qwFileId		= qwFileId;
+	hdr->dwChunks		= (DWORD)((qwFileSize + dwChunkSize - 1) / dwChunkSize);
+	hdr->dwPresent		= 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CreateManifest
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CreateManifest(LPManifest m, const ManifestHeader *hdr)
+--							LPManifest m:			The manifest to create.
+--							ManifestHeader *hdr:	The file it describes.
+--
+-- RETURNS: FALSE if the bitmap or CRCs couldn't be allocated; TRUE otherwise.
+--
+-- NOTES:
+-- The new manifest has no chunks present. Any bitmap it already had is freed first.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL CreateManifest(LPManifest m, const ManifestHeader *hdr)
+{
+	FreeManifest(m);
+	m->hdr			= *hdr;
+	m->hdr.dwPresent = 0;
+	m->bitmap		= (BYTE *)calloc(BitmapSize(hdr) + 1, 1);
+	m->crcs			= (DWORD *)calloc(hdr->dwChunks + 1, sizeof(DWORD));
+	m->dwLastSave	= GetTickCount();
+	m->bDirty		= FALSE;
+	return m->bitmap != NULL && m->crcs != NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FreeManifest
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FreeManifest(LPManifest m)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID FreeManifest(LPManifest m)
+{
+	free(m->bitmap);
+	free(m->crcs);
+	m->bitmap = NULL;
+	m->crcs = NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LoadManifest
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LoadManifest(LPManifest m, const TCHAR *szDestFile, const ManifestHeader *query)
+--							LPManifest m:			The manifest to fill.
+--							TCHAR *szDestFile:		The destination file.
+--							ManifestHeader *query:	The file the client is about to send.
+--
+-- RETURNS: FALSE if memory couldn't be allocated; TRUE otherwise.
+--
+-- NOTES:
+-- Reads the checkpoint left by an earlier attempt at the same transfer. If there isn't one, or it's for a different
+-- file or chunk size, or it's damaged, the manifest starts empty and the whole file is sent.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL LoadManifest(LPManifest m, const TCHAR *szDestFile, const ManifestHeader *query)
+{
+	HANDLE			hFile;
+	ManifestHeader	saved;
+	DWORD			dwRead, dwBitmapRead = 0, dwCrcRead = 0;
+	DWORD			i;
+
+	_stprintf_s(m->szPath, MANIFEST_PATH_SIZE, TEXT("%s%s"), szDestFile, MANIFEST_EXT);
+	if (!CreateManifest(m, query))
+		return FALSE;
+
+	hFile = CreateFile(m->szPath, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return TRUE;
+
+	if (!ReadFile(hFile, &saved, sizeof(saved), &dwRead, NULL) || dwRead != sizeof(saved) ||
+		saved.dwMagic != MANIFEST_MAGIC || saved.dwChunkSize != query->dwChunkSize ||
+		saved.qwFileSize != query->qwFileSize || saved.qwFileId != query->qwFileId || saved.dwChunks != query->dwChunks)
+	{
+		CloseHandle(hFile);
+		return TRUE;
+	}
+
+	ReadFile(hFile, m->bitmap, BitmapSize(query), &dwBitmapRead, NULL);
+	ReadFile(hFile, m->crcs, query->dwChunks * sizeof(DWORD), &dwCrcRead, NULL);
+	CloseHandle(hFile);
+
+	if (dwBitmapRead != BitmapSize(query) || dwCrcRead != query->dwChunks * sizeof(DWORD))
+		return CreateManifest(m, query); // Truncated; don't trust any of it
+
+	for (i = 0; i < query->dwChunks; i++)
+		if (IsChunkPresent(m, i))
+			m->hdr.dwPresent++;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SaveManifest
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SaveManifest(LPManifest m, HANDLE hDataFile)
+--							LPManifest m:		The manifest to save.
+--							HANDLE hDataFile:	The destination file the manifest describes.
+--
+-- RETURNS: FALSE if the manifest couldn't be written; TRUE otherwise.
+--
+-- NOTES:
+-- The data is flushed first so that every chunk the manifest lists is really on disk. The manifest is written to a
+-- temporary file and moved over the old one, so a crash part way through leaves the previous checkpoint intact.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SaveManifest(LPManifest m, HANDLE hDataFile)
+{
+	TCHAR	szTmp[MANIFEST_PATH_SIZE];
+	HANDLE	hFile;
+	DWORD	dwWritten;
+	BOOL	bOk;
+	size_t	pathLen = _tcslen(m->szPath) - _tcslen(MANIFEST_EXT);
+
+	FlushFileBuffers(hDataFile);
+
+	_stprintf_s(szTmp, MANIFEST_PATH_SIZE, TEXT("%.*s%s"), (int)pathLen, m->szPath, MANIFEST_TMP_EXT);
+	hFile = CreateFile(szTmp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return FALSE;
+
+	bOk = WriteFile(hFile, &m->hdr, sizeof(ManifestHeader), &dwWritten, NULL) &&
+		WriteFile(hFile, m->bitmap, BitmapSize(&m->hdr), &dwWritten, NULL) &&
+		WriteFile(hFile, m->crcs, m->hdr.dwChunks * sizeof(DWORD), &dwWritten, NULL) &&
+		FlushFileBuffers(hFile);
+	CloseHandle(hFile);
+
+	if (!bOk || !MoveFileEx(szTmp, m->szPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		DeleteFile(szTmp);
+		return FALSE;
+	}
+
+	m->dwLastSave = GetTickCount();
+	m->bDirty = FALSE;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CheckpointManifest
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CheckpointManifest(LPManifest m, HANDLE hDataFile)
+--							LPManifest m:		The manifest.
+--							HANDLE hDataFile:	The destination file.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called after every chunk is written; saves the manifest if it's changed and the last save was long enough ago.
+-- Saving by time rather than by chunk count keeps the flushes from eating into fast transfers.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID CheckpointManifest(LPManifest m, HANDLE hDataFile)
+{
+	if (m->bDirty && GetTickCount() - m->dwLastSave >= MANIFEST_CHECKPOINT_MS)
+		SaveManifest(m, hDataFile);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DeleteManifest
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DeleteManifest(LPManifest m)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called once a transfer has finished, whether it was verified or not; a failed file is sent again from scratch.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID DeleteManifest(LPManifest m)
+{
+	if (m->szPath[0] != 0)
+		DeleteFile(m->szPath);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsChunkPresent
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsChunkPresent(LPManifest m, DWORD dwChunk)
+--
+-- RETURNS: TRUE if the receiver already has the chunk; FALSE if it doesn't or there's no manifest.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsChunkPresent(LPManifest m, DWORD dwChunk)
+{
+	if (m->bitmap == NULL || dwChunk >= m->hdr.dwChunks)
+		return FALSE;
+	return (m->bitmap[dwChunk / 8] >> (dwChunk % 8)) & 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: MarkChunkPresent
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: MarkChunkPresent(LPManifest m, DWORD dwChunk, DWORD dwCrc)
+--							LPManifest m:	The manifest.
+--							DWORD dwChunk:	The chunk that's been written and verified.
+--							DWORD dwCrc:	Its CRC32C.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID MarkChunkPresent(LPManifest m, DWORD dwChunk, DWORD dwCrc)
+{
+	if (m->bitmap == NULL || dwChunk >= m->hdr.dwChunks || IsChunkPresent(m, dwChunk))
+		return;
+
+	m->bitmap[dwChunk / 8] |= (BYTE)(1 << (dwChunk % 8));
+	m->crcs[dwChunk] = dwCrc;
+	m->hdr.dwPresent++;
+	m->bDirty = TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendManifest
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendManifest(SOCKET s, LPManifest m)
+--							SOCKET s:		The connected socket.
+--							LPManifest m:	The server's manifest.
+--
+-- RETURNS: FALSE if the send failed; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SendManifest(SOCKET s, LPManifest m)
+{
+	return SendAll(s, (CHAR *)&m->hdr, sizeof(ManifestHeader)) &&
+		SendAll(s, (CHAR *)m->bitmap, BitmapSize(&m->hdr)) &&
+		SendAll(s, (CHAR *)m->crcs, m->hdr.dwChunks * sizeof(DWORD));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RecvManifest
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RecvManifest(SOCKET s, LPManifest m, const ManifestHeader *query)
+--							SOCKET s:				The connected socket.
+--							LPManifest m:			Receives the server's manifest.
+--							ManifestHeader *query:	What the client asked about.
+--
+-- RETURNS: FALSE if the reply couldn't be read or doesn't answer the query; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL RecvManifest(SOCKET s, LPManifest m, const ManifestHeader *query)
+{
+	ManifestHeader reply;
+
+	if (!RecvAll(s, (CHAR *)&reply, sizeof(reply)) || reply.dwMagic != MANIFEST_MAGIC ||
+		reply.dwChunks != query->dwChunks || reply.dwChunkSize != query->dwChunkSize)
+		return FALSE;
+
+	if (!CreateManifest(m, &reply))
+		return FALSE;
+	m->hdr.dwPresent = reply.dwPresent;
+
+	return RecvAll(s, (CHAR *)m->bitmap, BitmapSize(&reply)) &&
+		RecvAll(s, (CHAR *)m->crcs, reply.dwChunks * sizeof(DWORD));
+}
@@ -0,0 +1,59 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <tchar.h>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+
+#define MANIFEST_MAGIC			0x5453464D			// "MFST"
+#define MANIFEST_EXT			TEXT(".manifest")	// Appended to the destination file name
+#define MANIFEST_TMP_EXT		TEXT(".manifest.tmp")
+#define MANIFEST_PATH_SIZE		(FILENAME_SIZE + 16)
+#define MANIFEST_CHECKPOINT_MS	2000				// How often the receiver saves its progress
+
+#pragma pack(push, 1)
+
+/* Identifies a file and how it's split into chunks. The client sends one to ask what the server already has, the
+   server answers with one followed by the bitmap and CRCs, and the server's checkpoint file starts with one. */
+typedef struct _ManifestHeader
+{
+	DWORD		dwMagic;
+	DWORD		dwChunkSize;	// Logical bytes per chunk (the last may be shorter)
+	ULONGLONG	qwFileSize;
+	ULONGLONG	qwFileId;		// The source file's last write time, so a changed file isn't resumed
+	DWORD		dwChunks;
+	DWORD		dwPresent;		// Chunks already written and verified
+} ManifestHeader, *LPManifestHeader;
+
+#pragma pack(pop)
+
+/* Which chunks of a file the receiver has, and their CRCs. On disk and on the wire the header is followed by the
+   bitmap, (dwChunks + 7) / 8 bytes, then dwChunks CRCs. */
+typedef struct _Manifest
+{
+	ManifestHeader	hdr;
+	BYTE			*bitmap;
+	DWORD			*crcs;			// CRC32C of each present chunk (zero for the rest)
+	TCHAR			szPath[MANIFEST_PATH_SIZE];
+	DWORD			dwLastSave;		// GetTickCount at the last checkpoint
+	BOOL			bDirty;			// Chunks have been written since the last checkpoint
+} Manifest, *LPManifest;
+
+VOID InitManifestHeader(LPManifestHeader hdr, ULONGLONG qwFileSize, DWORD dwChunkSize, ULONGLONG qwFileId);
+BOOL CreateManifest(LPManifest m, const ManifestHeader *hdr);
+VOID FreeManifest(LPManifest m);
+BOOL LoadManifest(LPManifest m, const TCHAR *szDestFile, const ManifestHeader *query);
+BOOL SaveManifest(LPManifest m, HANDLE hDataFile);
+VOID CheckpointManifest(LPManifest m, HANDLE hDataFile);
+VOID DeleteManifest(LPManifest m);
+
+BOOL IsChunkPresent(LPManifest m, DWORD dwChunk);
+VOID MarkChunkPresent(LPManifest m, DWORD dwChunk, DWORD dwCrc);
+
+BOOL SendManifest(SOCKET s, LPManifest m);
+BOOL RecvManifest(SOCKET s, LPManifest m, const ManifestHeader *query);
+
+#endif
@@ -0,0 +1,934 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Multicast.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- BOOL IsMulticastAddress(const SOCKADDR_STORAGE *addr);
+-- BOOL PrepareMulticast(LPTransferProps props);
+-- BOOL RunMulticastRepair(LPTransferProps props, DWORD dwSeqs, LPWSABUF pwsaBuf, RepairBuilder build);
+-- BOOL JoinMulticastGroup(SOCKET s, LPMulticastState m);
+-- BOOL IsMulticastEnd(const BYTE *data, DWORD dwLen);
+-- BOOL AcceptMulticastData(LPMulticastState m, const BYTE *data, DWORD dwLen, BOOL bFile,
+--		const SOCKADDR_STORAGE *from, INT nFromLen);
+-- LPChunkHeader ReleaseEndChunk(LPMulticastState m);
+-- VOID HandleMulticastEnd(LPTransferProps props, const BYTE *data, const SOCKADDR_STORAGE *from, INT nFromLen,
+--		ULONGLONG qwRecvd);
+-- VOID ResetMulticast(LPMulticastState m);
+-- INT FormatMulticastReport(CHAR *buf, size_t size, LPMulticastState m, ULONGLONG qwSent, BOOL bReceiver);
+-- static BOOL IsSeqPresent(LPMulticastState m, DWORD dwSeq);
+-- static BOOL GrowBitmap(LPMulticastState m, DWORD dwNeed);
+-- static DWORD CountMissing(LPMulticastState m);
+-- static BOOL IsComplete(LPMulticastState m);
+-- static VOID ScheduleNack(LPMulticastState m);
+-- static VOID CALLBACK NackTimer(LPVOID lpArg, DWORD dwTimerLow, DWORD dwTimerHigh);
+-- static VOID SendNack(LPMulticastState m);
+-- static LPMcastReceiver FindReceiver(LPMulticastState m, DWORD dwId, const SOCKADDR_STORAGE *from);
+-- static BOOL AllReceiversDone(LPMulticastState m);
+-- static VOID RepairRanges(LPTransferProps props, const McastNack *nack, DWORD dwRanges, LPWSABUF pwsaBuf,
+--		RepairBuilder build);
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file distributes one transfer to many receivers at once. The client sends to a multicast group (by
+--			giving the group as the host) instead of a single server, so its uplink carries the data once however many
+--			servers have joined the group (-multicast on the server). Datagrams are sent exactly as for a UDP transfer
+--			to one server; each receiver tells them apart by their sequence number, drops repeats, and keeps a bitmap
+--			of what has arrived.
+--
+--			Loss is repaired with NACKs. After the data the sender multicasts an end marker every MCAST_ROUND_MS,
+--			carrying the number of datagrams in the transfer. A receiver that's missing some waits a random
+--			MCAST_NACK_MIN_MS to MCAST_NACK_MIN_MS + MCAST_NACK_SPREAD_MS, then sends the sender a NACK listing its
+--			gaps. Repairs are multicast, so they reach every receiver that missed the same datagrams; a receiver
+--			whose gaps fill while it waits drops them from its NACK, or doesn't send it at all. That suppression
+--			is what keeps forty receivers that lost the same burst from sending forty NACKs for it. Receivers NACK
+--			at most once every MCAST_NACK_GAP_MS, and the sender ignores requests for a datagram it resent within
+--			MCAST_HOLDOFF_MS, since the NACKs crossing that repair on the way were asking for the same thing.
+--
+--			A receiver that has everything answers each marker with its totals. The sender stops repairing once
+--			every receiver it has heard from is done and none has NACKed for MCAST_QUIET_MS, or nothing has been
+--			asked for in COMM_TIMEOUT. Receivers that never send anything are invisible to it.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Multicast.h"
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsMulticastAddress
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsMulticastAddress(const SOCKADDR_STORAGE *addr)
+--
+-- RETURNS: TRUE if the address is an IPv4 (224.0.0.0/4) or IPv6 (ff00::/8) multicast group.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsMulticastAddress(const SOCKADDR_STORAGE *addr)
+{
+	if (addr->ss_family == AF_INET6)
+		return ((const SOCKADDR_IN6 *)addr)->sin6_addr.s6_addr[0] == 0xFF;
+	if (addr->ss_family == AF_INET)
+		return (ntohl(((const SOCKADDR_IN *)addr)->sin_addr.s_addr) & 0xF0000000) == 0xE0000000;
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ResetMulticast
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ResetMulticast(LPMulticastState m)
+--							LPMulticastState m:	The multicast state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Frees everything one transfer used and clears its counters, keeping the settings. A receiver picks a new ID, and
+-- remembers the transfer it just had so that the sender's last few markers for it aren't taken for a new one.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID ResetMulticast(LPMulticastState m)
+{
+	BOOL				bJoin	= m->bJoin;
+	SOCKADDR_STORAGE	group	= m->group;
+	DWORD				dwHops	= m->dwHops;
+	DWORD				dwFinished = m->dwTransferId != 0 ? m->dwTransferId : m->dwFinishedId;
+	LARGE_INTEGER		liNow;
+
+	if (m->hTimer != NULL)
+	{
+		CancelWaitableTimer(m->hTimer);
+		CloseHandle(m->hTimer);
+	}
+	PoolFree(m->lastRepair);
+	PoolFree(m->bitmap);
+
+	memset(m, 0, sizeof(MulticastState));
+	m->bJoin = bJoin;
+	m->group = group;
+	m->dwHops = dwHops;
+	m->dwFinishedId = dwFinished;
+	m->s = INVALID_SOCKET;
+
+	QueryPerformanceCounter(&liNow);
+	m->dwId = liNow.LowPart ^ (GetCurrentProcessId() << 16) ^ GetTickCount();
+	m->dwRng = m->dwId | 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PrepareMulticast
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PrepareMulticast(LPTransferProps props)
+--							LPTransferProps props:	The client's transfer properties, with the socket open.
+--
+-- RETURNS: FALSE if the host is a group but the transfer can't be multicast; TRUE otherwise.
+--
+-- NOTES:
+-- Called once the destination is known. Sending to a group makes the transfer a multicast one. The receivers need
+-- something to tell the datagrams apart by, so fill test packets can't be multicast, and the repairs come back the
+-- same way as the data, so neither can duplex transfers.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL PrepareMulticast(LPTransferProps props)
+{
+	LPMulticastState m = &props->multicast;
+
+	ResetMulticast(m);
+	if (!IsMulticastAddress(&props->addr))
+		return TRUE;
+
+	if (props->nSockType != SOCK_DGRAM || props->duplex.bRequested ||
+		(props->szFileName[0] == 0 && props->payload.dwKind == PAYLOAD_FILL))
+	{
+		MessageBox(NULL, TEXT("Only UDP transfers of a file or generated test packets (not fill) can be sent to a ")
+			TEXT("multicast group, and not with -duplex."), TEXT("Can't Multicast"), MB_ICONERROR);
+		return FALSE;
+	}
+
+	if (props->addr.ss_family == AF_INET6)
+		setsockopt(props->socket, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, (CHAR *)&m->dwHops, sizeof(DWORD));
+	else
+		setsockopt(props->socket, IPPROTO_IP, IP_MULTICAST_TTL, (CHAR *)&m->dwHops, sizeof(DWORD));
+
+	m->bActive = TRUE;
+	QueryPerformanceCounter(&m->liStart);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FindReceiver
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FindReceiver(LPMulticastState m, DWORD dwId, const SOCKADDR_STORAGE *from)
+--							LPMulticastState m:				The sender's multicast state.
+--							DWORD dwId:						The receiver's ID.
+--							const SOCKADDR_STORAGE *from:	Where its message came from.
+--
+-- RETURNS: The receiver's entry, added if it's new, or NULL if there's no room for it.
+---------------------------------------------------------------------------------------------------------------------------*/
+static LPMcastReceiver FindReceiver(LPMulticastState m, DWORD dwId, const SOCKADDR_STORAGE *from)
+{
+	LPMcastReceiver	r;
+	DWORD			i;
+
+	for (i = 0; i < m->dwReceivers; i++)
+		if (m->receivers[i].dwId == dwId)
+			return &m->receivers[i];
+	if (m->dwReceivers == MCAST_MAXRECEIVERS)
+		return NULL;
+
+	r = &m->receivers[m->dwReceivers++];
+	memset(r, 0, sizeof(McastReceiver));
+	r->dwId = dwId;
+	r->addr = *from;
+	return r;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AllReceiversDone
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AllReceiversDone(LPMulticastState m)
+--
+-- RETURNS: TRUE if at least one receiver has been heard from and all of them have sent their totals.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL AllReceiversDone(LPMulticastState m)
+{
+	DWORD i;
+
+	for (i = 0; i < m->dwReceivers; i++)
+		if (!m->receivers[i].bDone)
+			return FALSE;
+	return m->dwReceivers != 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RepairRanges
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RepairRanges(LPTransferProps props, const McastNack *nack, DWORD dwRanges, LPWSABUF pwsaBuf,
+--							RepairBuilder build)
+--							LPTransferProps props:	The sender's transfer properties.
+--							const McastNack *nack:	A receiver's NACK.
+--							DWORD dwRanges:			How many of its ranges arrived.
+--							LPWSABUF pwsaBuf:		The send buffer to build repairs in.
+--							RepairBuilder build:	Builds a datagram again from its sequence number.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Multicasts each datagram asked for, unless it went out within MCAST_HOLDOFF_MS.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID RepairRanges(LPTransferProps props, const McastNack *nack, DWORD dwRanges, LPWSABUF pwsaBuf,
+	RepairBuilder build)
+{
+	LPMulticastState	m = &props->multicast;
+	DWORD				dwSeq, dwLeft;
+	DWORD				i;
+
+	for (i = 0; i < dwRanges; i++)
+	{
+		for (dwSeq = nack->ranges[i].dwFirst, dwLeft = nack->ranges[i].dwCount; dwLeft != 0 && dwSeq < m->dwSeqs;
+			dwSeq++, dwLeft--)
+		{
+			if (m->lastRepair[dwSeq] != 0 && GetTickCount() - m->lastRepair[dwSeq] < MCAST_HOLDOFF_MS)
+			{
+				m->dwHeldOff++;
+				continue;
+			}
+			if (!build(pwsaBuf, dwSeq, props) ||
+				sendto(props->socket, pwsaBuf->buf, pwsaBuf->len, 0, (sockaddr *)&props->addr, props->nAddrLen) ==
+				SOCKET_ERROR)
+				continue;
+
+			m->lastRepair[dwSeq] = GetTickCount() | 1;
+			m->dwRepairs++;
+			m->qwRepairBytes += pwsaBuf->len;
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RunMulticastRepair
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RunMulticastRepair(LPTransferProps props, DWORD dwSeqs, LPWSABUF pwsaBuf, RepairBuilder build)
+--							LPTransferProps props:	The sender's transfer properties; the data has all been sent.
+--							DWORD dwSeqs:			Datagrams in the transfer.
+--							LPWSABUF pwsaBuf:		The send buffer to build repairs in.
+--							RepairBuilder build:	Builds a datagram again from its sequence number.
+--
+-- RETURNS: TRUE if every receiver that was heard from finished; FALSE otherwise.
+--
+-- NOTES:
+-- Takes the place of the end-of-stream exchange (see Control.cpp) for a multicast transfer. Uses blocking calls with a
+-- short timeout, like that exchange, since the overlapped sends are over.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL RunMulticastRepair(LPTransferProps props, DWORD dwSeqs, LPWSABUF pwsaBuf, RepairBuilder build)
+{
+	LPMulticastState	m			= &props->multicast;
+	McastEnd			end;
+	BYTE				msg[sizeof(McastNack)];
+	LPMcastNack			nack		= (LPMcastNack)msg;
+	LPMcastDone			done		= (LPMcastDone)msg;
+	LPMcastReceiver		r;
+	SOCKADDR_STORAGE	from;
+	INT					nFromLen;
+	INT					nRecvd;
+	LARGE_INTEGER		liRepair;
+	DWORD				dwTimeout	= MCAST_RECV_MS;
+	DWORD				dwNoTimeout	= 0;
+	DWORD				dwLastRound, dwLastNack, dwNow;
+	DWORD				dwRanges;
+
+	m->dwSeqs = dwSeqs;
+	if ((m->lastRepair = (DWORD *)PoolAlloc(max(dwSeqs, 1) * sizeof(DWORD))) == NULL)
+	{
+		MessageBox(NULL, TEXT("Couldn't allocate the repair table."), TEXT("No Memory Allocated"), MB_ICONERROR);
+		return FALSE;
+	}
+	memset(m->lastRepair, 0, max(dwSeqs, 1) * sizeof(DWORD));
+
+	end.dwMagic			= MCAST_END_MAGIC;
+	end.dwTransferId	= props->control.dwTransferId;
+	end.dwSeqs			= dwSeqs;
+
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+	QueryPerformanceCounter(&liRepair);
+	dwLastNack = GetTickCount();
+	dwLastRound = dwLastNack - MCAST_ROUND_MS;
+
+	for (;;)
+	{
+		dwNow = GetTickCount();
+		if (dwNow - dwLastRound >= MCAST_ROUND_MS)
+		{
+			end.dwRound = m->dwRounds++;
+			if (sendto(props->socket, (CHAR *)&end, sizeof(end), 0, (sockaddr *)&props->addr, props->nAddrLen) ==
+				SOCKET_ERROR)
+				break;
+			dwLastRound = dwNow;
+		}
+
+		// Done, or given up on: receivers that keep NACKing but never finish, or no receivers at all
+		if ((dwNow - dwLastNack >= MCAST_QUIET_MS && AllReceiversDone(m)) || dwNow - dwLastNack >= COMM_TIMEOUT ||
+			(m->dwReceivers == 0 && dwNow - dwLastNack >= CONTROL_TRIES * CONTROL_RETRY_MS))
+			break;
+
+		nFromLen = sizeof(from);
+		if ((nRecvd = recvfrom(props->socket, (CHAR *)msg, sizeof(msg), 0, (sockaddr *)&from, &nFromLen)) ==
+			SOCKET_ERROR)
+			continue;
+
+		if (nRecvd >= (INT)(sizeof(McastNack) - sizeof(nack->ranges)) && nack->dwMagic == MCAST_NACK_MAGIC &&
+			nack->dwTransferId == end.dwTransferId)
+		{
+			dwRanges = min(nack->dwRanges, (DWORD)(nRecvd - (sizeof(McastNack) - sizeof(nack->ranges))) /
+				(DWORD)sizeof(McastRange));
+			if ((r = FindReceiver(m, nack->dwReceiverId, &from)) != NULL)
+				r->dwNacks++;
+			m->dwNacksIn++;
+			dwLastNack = GetTickCount();
+			RepairRanges(props, nack, dwRanges, pwsaBuf, build);
+		}
+		else if (nRecvd == sizeof(McastDone) && done->dwMagic == MCAST_DONE_MAGIC &&
+			done->stats.dwTransferId == end.dwTransferId &&
+			(r = FindReceiver(m, done->dwReceiverId, &from)) != NULL && !r->bDone)
+		{
+			r->bDone	= TRUE;
+			r->dwDoneUs	= ElapsedUs(&m->liStart);
+			r->qwBytes	= done->stats.qwBytes;
+			r->dwBad	= done->stats.dwBad;
+			r->dwResult	= done->stats.dwResult;
+		}
+	}
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+
+	m->dwRepairUs = ElapsedUs(&liRepair);
+	return AllReceiversDone(m);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: JoinMulticastGroup
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: JoinMulticastGroup(SOCKET s, LPMulticastState m)
+--							SOCKET s:				The server's bound UDP socket.
+--							LPMulticastState m:		The group to join.
+--
+-- RETURNS: FALSE if the group couldn't be joined; TRUE otherwise.
+--
+-- NOTES:
+-- Joins on the default interface. The server's dual-stack socket takes either kind of group.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL JoinMulticastGroup(SOCKET s, LPMulticastState m)
+{
+	ip_mreq		mreq;
+	ipv6_mreq	mreq6;
+	INT			nRet;
+
+	if (m->group.ss_family == AF_INET6)
+	{
+		mreq6.ipv6mr_multiaddr = ((LPSOCKADDR_IN6)&m->group)->sin6_addr;
+		mreq6.ipv6mr_interface = 0;
+		nRet = setsockopt(s, IPPROTO_IPV6, IPV6_ADD_MEMBERSHIP, (CHAR *)&mreq6, sizeof(mreq6));
+	}
+	else
+	{
+		mreq.imr_multiaddr = ((LPSOCKADDR_IN)&m->group)->sin_addr;
+		mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+		nRet = setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP, (CHAR *)&mreq, sizeof(mreq));
+	}
+
+	if (nRet == SOCKET_ERROR)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Multicast Failed"), TEXT("Could not join the multicast group, error %d"),
+			WSAGetLastError());
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsMulticastEnd
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsMulticastEnd(const BYTE *data, DWORD dwLen)
+--
+-- RETURNS: TRUE if the datagram is a multicast sender's end marker.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsMulticastEnd(const BYTE *data, DWORD dwLen)
+{
+	return dwLen == sizeof(McastEnd) && ((const McastEnd *)data)->dwMagic == MCAST_END_MAGIC;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsSeqPresent
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsSeqPresent(LPMulticastState m, DWORD dwSeq)
+--
+-- RETURNS: TRUE if the datagram with this sequence number has arrived.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL IsSeqPresent(LPMulticastState m, DWORD dwSeq)
+{
+	return dwSeq < m->dwCap && (m->bitmap[dwSeq >> 3] & (1 << (dwSeq & 7))) != 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GrowBitmap
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GrowBitmap(LPMulticastState m, DWORD dwNeed)
+--							LPMulticastState m:	The receiver's multicast state.
+--							DWORD dwNeed:		Sequence numbers the bitmap must hold.
+--
+-- RETURNS: FALSE if it couldn't be made that big; TRUE otherwise.
+--
+-- NOTES:
+-- A file's length isn't known until its end arrives, so the bitmap doubles as the sequence numbers climb.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL GrowBitmap(LPMulticastState m, DWORD dwNeed)
+{
+	DWORD	dwCap = max(m->dwCap, (DWORD)65536);
+	BYTE	*bitmap;
+
+	if (dwNeed <= m->dwCap)
+		return TRUE;
+	while (dwCap < dwNeed)
+		dwCap *= 2;
+	if (m->dwSeqs != 0)
+		dwCap = max(dwNeed, m->dwSeqs);
+
+	if ((bitmap = (BYTE *)PoolAlloc(dwCap / 8 + 1)) == NULL)
+		return FALSE;
+	memset(bitmap, 0, dwCap / 8 + 1);
+	if (m->bitmap != NULL)
+		memcpy(bitmap, m->bitmap, m->dwCap / 8 + 1);
+	PoolFree(m->bitmap);
+	m->bitmap = bitmap;
+	m->dwCap = dwCap;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CountMissing
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CountMissing(LPMulticastState m)
+--
+-- RETURNS: Datagrams missing: of the whole transfer once its length is known, or below the highest seen until then.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD CountMissing(LPMulticastState m)
+{
+	DWORD dwLimit = m->dwSeqs != 0 ? m->dwSeqs : m->dwHighest;
+
+	return dwLimit > m->dwHave ? dwLimit - m->dwHave : 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsComplete
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsComplete(LPMulticastState m)
+--
+-- RETURNS: TRUE if every datagram of the transfer has arrived.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL IsComplete(LPMulticastState m)
+{
+	return m->dwSeqs != 0 && m->dwHave >= m->dwSeqs;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AcceptMulticastData
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AcceptMulticastData(LPMulticastState m, const BYTE *data, DWORD dwLen, BOOL bFile,
+--								const SOCKADDR_STORAGE *from, INT nFromLen)
+--							LPMulticastState m:				The receiver's multicast state.
+--							const BYTE *data:				A datagram of data.
+--							DWORD dwLen:					Its length.
+--							BOOL bFile:						Whether the transfer is a file (chunks) or test packets.
+--							const SOCKADDR_STORAGE *from:	Where it came from.
+--							INT nFromLen:					The length of that address.
+--
+-- RETURNS: TRUE if the datagram should be received as usual; FALSE if it's a repeat, or a file's CHUNK_END that has
+--			arrived before some of the chunks (see ReleaseEndChunk).
+--
+-- NOTES:
+-- A repaired datagram reaches every receiver in the group, including those that already had it, and a repeat would
+-- count twice in the totals and the file's digest. Datagrams without a sequence number are let through.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL AcceptMulticastData(LPMulticastState m, const BYTE *data, DWORD dwLen, BOOL bFile,
+	const SOCKADDR_STORAGE *from, INT nFromLen)
+{
+	DWORD	dwSeq;
+	DWORD	dwTotal	= 0;
+	BOOL	bEnd	= FALSE;
+
+	if (bFile)
+	{
+		if (!IsValidChunk(data, dwLen))
+			return TRUE;
+		dwSeq = ((const ChunkHeader *)data)->dwSeq;
+		if (((const ChunkHeader *)data)->wType == CHUNK_END)
+		{
+			bEnd = TRUE;
+			dwTotal = dwSeq + 1;
+		}
+	}
+	else
+	{
+		if (dwLen < sizeof(PayloadHeader) || ((const PayloadHeader *)data)->dwMagic != PAYLOAD_MAGIC)
+			return TRUE;
+		dwSeq = ((const PayloadHeader *)data)->dwSeq;
+		dwTotal = ((const PayloadHeader *)data)->dwNumToSend;
+	}
+
+	m->bActive = TRUE;
+	m->sender = *from;
+	m->nSenderLen = nFromLen;
+	if (m->dwSeqs == 0 && dwTotal != 0 && dwTotal <= MCAST_MAXSEQS)
+		m->dwSeqs = dwTotal;
+	if (dwSeq >= MCAST_MAXSEQS || (m->dwSeqs != 0 && dwSeq >= m->dwSeqs) || !GrowBitmap(m, dwSeq + 1))
+		return FALSE;
+
+	if (IsSeqPresent(m, dwSeq))
+	{
+		m->dwDuplicates++;
+		return FALSE;
+	}
+	m->bitmap[dwSeq >> 3] |= 1 << (dwSeq & 7);
+	m->dwHave++;
+	if (dwSeq >= m->dwHighest)
+		m->dwHighest = dwSeq + 1;
+	if (m->bEnded)
+		m->dwLate++;
+
+	if (bEnd && !IsComplete(m) && dwLen <= sizeof(m->endChunk))
+	{
+		memcpy(m->endChunk, data, dwLen);
+		m->bEndHeld = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReleaseEndChunk
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReleaseEndChunk(LPMulticastState m)
+--							LPMulticastState m:	The receiver's multicast state.
+--
+-- RETURNS: The file's CHUNK_END, once, when the last chunk before it has arrived; NULL otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+LPChunkHeader ReleaseEndChunk(LPMulticastState m)
+{
+	if (!m->bEndHeld || !IsComplete(m))
+		return NULL;
+	m->bEndHeld = FALSE;
+	return (LPChunkHeader)m->endChunk;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendNack
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendNack(LPMulticastState m)
+--							LPMulticastState m:	The receiver's multicast state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Lists the first MCAST_NACK_RANGES gaps; the rest are asked for once those are filled. Whatever filled while the
+-- NACK waited was repaired for another receiver, and isn't asked for.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID SendNack(LPMulticastState m)
+{
+	McastNack	nack;
+	DWORD		dwLimit		= m->dwSeqs != 0 ? m->dwSeqs : m->dwHighest;
+	DWORD		dwMissing	= CountMissing(m);
+	DWORD		dwAsked		= 0;
+	DWORD		dwSeq, dwFirst;
+
+	if (dwMissing < m->dwPendingMissing)
+		m->dwSuppressedSeqs += m->dwPendingMissing - dwMissing;
+	m->dwPendingMissing = 0;
+	if (dwMissing == 0)
+	{
+		m->dwSuppressed++;
+		return;
+	}
+
+	nack.dwMagic		= MCAST_NACK_MAGIC;
+	nack.dwTransferId	= m->dwTransferId;
+	nack.dwReceiverId	= m->dwId;
+	nack.dwRanges		= 0;
+	for (dwSeq = 0; dwSeq < dwLimit && nack.dwRanges < MCAST_NACK_RANGES; )
+	{
+		// Skip whole bytes of the bitmap that have arrived
+		if ((dwSeq & 7) == 0 && dwSeq + 8 <= m->dwCap && m->bitmap[dwSeq >> 3] == 0xFF)
+		{
+			dwSeq += 8;
+			continue;
+		}
+		if (IsSeqPresent(m, dwSeq))
+		{
+			dwSeq++;
+			continue;
+		}
+
+		for (dwFirst = dwSeq; dwSeq < dwLimit && !IsSeqPresent(m, dwSeq); dwSeq++)
+			;
+		nack.ranges[nack.dwRanges].dwFirst = dwFirst;
+		nack.ranges[nack.dwRanges].dwCount = dwSeq - dwFirst;
+		nack.dwRanges++;
+		dwAsked += dwSeq - dwFirst;
+	}
+
+	if (sendto(m->s, (CHAR *)&nack, sizeof(McastNack) - (MCAST_NACK_RANGES - nack.dwRanges) * sizeof(McastRange), 0,
+		(sockaddr *)&m->sender, m->nSenderLen) == SOCKET_ERROR)
+		return;
+	m->dwNacksOut++;
+	m->dwNackedSeqs += dwAsked;
+	m->dwLastNack = GetTickCount();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NackTimer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NackTimer(LPVOID lpArg, DWORD dwTimerLow, DWORD dwTimerHigh)
+--							LPVOID lpArg:		The receiver's multicast state.
+--							DWORD dwTimerLow:	Not used.
+--							DWORD dwTimerHigh:	Not used.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Windows calls this on the server thread, while it waits alertably, when a NACK's delay is up.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID CALLBACK NackTimer(LPVOID lpArg, DWORD dwTimerLow, DWORD dwTimerHigh)
+{
+	LPMulticastState m = (LPMulticastState)lpArg;
+
+	m->bNackPending = FALSE;
+	SendNack(m);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ScheduleNack
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ScheduleNack(LPMulticastState m)
+--							LPMulticastState m:	The receiver's multicast state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Sets the NACK going after a random delay, and no sooner than MCAST_NACK_GAP_MS after the last one, unless one is
+-- already waiting.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID ScheduleNack(LPMulticastState m)
+{
+	LARGE_INTEGER	liDue;
+	DWORD			dwDelay, dwSince;
+
+	if (m->bNackPending || IsComplete(m))
+		return;
+	if (m->hTimer == NULL && (m->hTimer = CreateWaitableTimer(NULL, TRUE, NULL)) == NULL)
+	{
+		SendNack(m);
+		return;
+	}
+
+	m->dwRng = m->dwRng * 1664525 + 1013904223;
+	dwDelay = MCAST_NACK_MIN_MS + (m->dwRng >> 16) % MCAST_NACK_SPREAD_MS;
+	dwSince = GetTickCount() - m->dwLastNack;
+	if (m->dwNacksOut != 0 && dwSince < MCAST_NACK_GAP_MS)
+		dwDelay = max(dwDelay, MCAST_NACK_GAP_MS - dwSince);
+
+	liDue.QuadPart = -(LONGLONG)dwDelay * 10000;
+	m->dwPendingMissing = CountMissing(m);
+	m->bNackPending = SetWaitableTimer(m->hTimer, &liDue, 0, NackTimer, m, FALSE);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: HandleMulticastEnd
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: HandleMulticastEnd(LPTransferProps props, const BYTE *data, const SOCKADDR_STORAGE *from, INT nFromLen,
+--								ULONGLONG qwRecvd)
+--							LPTransferProps props:			The server's transfer properties.
+--							const BYTE *data:				The sender's end marker.
+--							const SOCKADDR_STORAGE *from:	Where it came from.
+--							INT nFromLen:					The length of that address.
+--							ULONGLONG qwRecvd:				Bytes received so far.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- A receiver with everything answers with its totals; one missing datagrams gets a NACK ready. One that joined too
+-- late for any of the data asks for all of it.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID HandleMulticastEnd(LPTransferProps props, const BYTE *data, const SOCKADDR_STORAGE *from, INT nFromLen,
+	ULONGLONG qwRecvd)
+{
+	LPMulticastState	m	= &props->multicast;
+	const McastEnd		*end = (const McastEnd *)data;
+	McastDone			done;
+
+	if (!m->bEnded && end->dwTransferId == m->dwFinishedId)
+		return;
+
+	m->bActive = TRUE;
+	m->s = props->socket;
+	m->sender = *from;
+	m->nSenderLen = nFromLen;
+	m->dwTransferId = end->dwTransferId;
+	props->control.dwTransferId = end->dwTransferId;
+	if (m->dwSeqs == 0 && end->dwSeqs <= MCAST_MAXSEQS)
+		m->dwSeqs = end->dwSeqs;
+	if (!m->bEnded)
+	{
+		m->bEnded = TRUE;
+		m->dwMissingAtEnd = CountMissing(m);
+	}
+
+	if (IsComplete(m) && !m->bEndHeld)
+	{
+		done.dwMagic = MCAST_DONE_MAGIC;
+		done.dwReceiverId = m->dwId;
+		FillControlAnswer(&done.stats, props, qwRecvd);
+		sendto(props->socket, (CHAR *)&done, sizeof(done), 0, (const sockaddr *)from, nFromLen);
+		props->control.dwTries++;
+		return;
+	}
+	ScheduleNack(m);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatMulticastReport
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatMulticastReport(CHAR *buf, size_t size, LPMulticastState m, ULONGLONG qwSent, BOOL bReceiver)
+--							CHAR *buf:				The buffer to write the report section into.
+--							size_t size:			The space left in buf.
+--							LPMulticastState m:		The multicast state.
+--							ULONGLONG qwSent:		Bytes of data sent, not counting repairs (sender).
+--							BOOL bReceiver:			Whether this end received the transfer.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The sender's aggregate throughput is everything its receivers got over the time to the last of them finishing;
+-- divided by what it sent, that's how many unicast transfers the group was worth. The repair overhead is the bytes
+-- resent over the bytes of data.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatMulticastReport(CHAR *buf, size_t size, LPMulticastState m, ULONGLONG qwSent, BOOL bReceiver)
+{
+	INT				written		= 0;
+	ULONGLONG		qwDelivered	= 0;
+	DWORD			dwDone		= 0;
+	DWORD			dwLastUs	= 0;
+	CHAR			szAddr[64];
+	LPMcastReceiver	r;
+	DWORD			i;
+
+	if (!m->bActive)
+		return 0;
+
+	if (bReceiver)
+	{
+		written += sprintf_s(buf, size,
+			"Multicast receiver %08lX: %lu of %lu datagrams; %lu missing at the end of the data, %lu arrived after it; "
+			"%lu repeats dropped\r\n", m->dwId, m->dwHave, m->dwSeqs != 0 ? m->dwSeqs : m->dwHighest,
+			m->dwMissingAtEnd, m->dwLate, m->dwDuplicates);
+		written += sprintf_s(buf + written, size - written,
+			"Multicast NACKs: %lu sent asking for %lu datagrams; %lu not sent and %lu datagrams not asked for, "
+			"repaired for other receivers first\r\n", m->dwNacksOut, m->dwNackedSeqs, m->dwSuppressed,
+			m->dwSuppressedSeqs);
+		return written;
+	}
+
+	for (i = 0; i < m->dwReceivers; i++)
+	{
+		if (m->receivers[i].bDone)
+		{
+			dwDone++;
+			qwDelivered += m->receivers[i].qwBytes;
+			dwLastUs = max(dwLastUs, m->receivers[i].dwDoneUs);
+		}
+	}
+
+	written += sprintf_s(buf, size, "Multicast: %lu receivers heard from, %lu finished; %lu end markers over %.1fms\r\n",
+		m->dwReceivers, dwDone, m->dwRounds, m->dwRepairUs / 1e3);
+	if (dwDone != 0)
+		written += sprintf_s(buf + written, size - written,
+			"Multicast delivery: %.2f MB delivered for %.2f MB sent (%.1fx), %.1f Mbit/s aggregate; last receiver "
+			"finished after %.1fms\r\n", qwDelivered / 1e6, (qwSent + m->qwRepairBytes) / 1e6,
+			(double)qwDelivered / max(qwSent + m->qwRepairBytes, 1), dwLastUs != 0 ? qwDelivered * 8.0 / dwLastUs : 0.0,
+			dwLastUs / 1e3);
+	written += sprintf_s(buf + written, size - written,
+		"Multicast repairs: %lu NACKs, %lu datagrams resent (%.2f MB, %.1f%% overhead), %lu requests held off\r\n",
+		m->dwNacksIn, m->dwRepairs, m->qwRepairBytes / 1e6, qwSent != 0 ? m->qwRepairBytes * 100.0 / qwSent : 0.0,
+		m->dwHeldOff);
+
+	for (i = 0; i < m->dwReceivers && i < MCAST_LISTED; i++)
+	{
+		r = &m->receivers[i];
+		FormatAddress(&r->addr, szAddr, sizeof(szAddr));
+		if (!r->bDone)
+			written += sprintf_s(buf + written, size - written, "\t%s (%08lX): %lu NACKs, never finished\r\n", szAddr,
+				r->dwId, r->dwNacks);
+		else
+			written += sprintf_s(buf + written, size - written,
+				"\t%s (%08lX): %.2f MB, %lu NACKs, %s, finished after %.1fms\r\n", szAddr, r->dwId, r->qwBytes / 1e6,
+				r->dwNacks, r->dwResult == INTEGRITY_VERIFIED ? "file verified" :
+				r->dwResult == INTEGRITY_FAILED ? "file FAILED" : r->dwBad != 0 ? "corrupt packets" : "no corrupt packets",
+				r->dwDoneUs / 1e3);
+	}
+	if (m->dwReceivers > MCAST_LISTED)
+		written += sprintf_s(buf + written, size - written, "\tand %lu more\r\n", m->dwReceivers - MCAST_LISTED);
+	return written;
+}
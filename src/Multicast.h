@@ -0,0 +1,86 @@
+#ifndef MULTICAST_H
+#define MULTICAST_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <Ws2tcpip.h>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Connect.h"
+#include "Chunk.h"
+#include "Payload.h"
+#include "Control.h"
+#include "Pool.h"
+
+#define MCAST_END_MAGIC		0x444E454D	// "MEND"
+#define MCAST_NACK_MAGIC	0x4B43414E	// "NACK"
+#define MCAST_DONE_MAGIC	0x454E4F44	// "DONE"
+#define MCAST_DEF_HOPS		1			// Multicast stays on the local network unless -mchops says otherwise
+#define MCAST_ROUND_MS		50			// How often the sender repeats its end marker while repairing
+#define MCAST_RECV_MS		10			// How long the sender waits for each NACK or answer before checking the time
+#define MCAST_QUIET_MS		500			// The repairs are over once every receiver is done and none has NACKed for this long
+#define MCAST_HOLDOFF_MS	40			// A datagram resent this recently isn't resent again for another NACK
+#define MCAST_NACK_MIN_MS	5			// A receiver waits this long, plus up to MCAST_NACK_SPREAD_MS, before it NACKs
+#define MCAST_NACK_SPREAD_MS 30
+#define MCAST_NACK_GAP_MS	60			// And at least this long after its last NACK
+#define MCAST_NACK_RANGES	64			// Gaps a NACK can list
+#define MCAST_MAXSEQS		(1 << 26)	// Sequence numbers a receiver will track (a 256 GB file in 4 KB chunks)
+#define MCAST_LISTED		16			// Receivers listed one by one in the sender's report
+
+#pragma pack(push, 1)
+
+/* The sender's end-of-data marker, multicast to the group every MCAST_ROUND_MS while it repairs. */
+typedef struct _McastEnd
+{
+	DWORD		dwMagic;
+	DWORD		dwTransferId;
+	DWORD		dwSeqs;			// Sequence numbers in the transfer, so a receiver knows what it's missing at the end
+	DWORD		dwRound;
+} McastEnd, *LPMcastEnd;
+
+/* A run of missing sequence numbers. */
+typedef struct _McastRange
+{
+	DWORD		dwFirst;
+	DWORD		dwCount;
+} McastRange, *LPMcastRange;
+
+/* A receiver's request for what it's missing, sent to the sender; only dwRanges of the ranges are sent. */
+typedef struct _McastNack
+{
+	DWORD		dwMagic;
+	DWORD		dwTransferId;
+	DWORD		dwReceiverId;
+	DWORD		dwRanges;
+	McastRange	ranges[MCAST_NACK_RANGES];
+} McastNack, *LPMcastNack;
+
+/* A receiver's totals once it has everything, sent to the sender in answer to each end marker. */
+typedef struct _McastDone
+{
+	DWORD		dwMagic;
+	DWORD		dwReceiverId;
+	ControlMsg	stats;
+} McastDone, *LPMcastDone;
+
+#pragma pack(pop)
+
+/* Builds datagram dwSeq of the transfer again into pwsaBuf, for the sender's repairs (see ClientTransfer.cpp). */
+typedef BOOL (*RepairBuilder)(LPWSABUF pwsaBuf, DWORD dwSeq, LPTransferProps props);
+
+BOOL IsMulticastAddress(const SOCKADDR_STORAGE *addr);
+BOOL PrepareMulticast(LPTransferProps props);
+BOOL RunMulticastRepair(LPTransferProps props, DWORD dwSeqs, LPWSABUF pwsaBuf, RepairBuilder build);
+BOOL JoinMulticastGroup(SOCKET s, LPMulticastState m);
+BOOL IsMulticastEnd(const BYTE *data, DWORD dwLen);
+BOOL AcceptMulticastData(LPMulticastState m, const BYTE *data, DWORD dwLen, BOOL bFile,
+	const SOCKADDR_STORAGE *from, INT nFromLen);
+LPChunkHeader ReleaseEndChunk(LPMulticastState m);
+VOID HandleMulticastEnd(LPTransferProps props, const BYTE *data, const SOCKADDR_STORAGE *from, INT nFromLen,
+	ULONGLONG qwRecvd);
+VOID ResetMulticast(LPMulticastState m);
+INT FormatMulticastReport(CHAR *buf, size_t size, LPMulticastState m, ULONGLONG qwSent, BOOL bReceiver);
+
+#endif
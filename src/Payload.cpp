@@ -0,0 +1,691 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Payload.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitPayload();
+-- VOID InitPayloadState(LPPayloadState p);
+-- VOID ResetPayloadState(LPPayloadState p);
+-- VOID StartPayload(LPPayloadState p, DWORD dwPacketSize);
+-- VOID BuildPayload(BYTE *buf, DWORD dwLen, DWORD dwSeq, LPPayloadState p);
+-- VOID CheckPayloadPacket(LPPayloadState p, const BYTE *data, DWORD dwLen);
+-- VOID CheckPayloadStream(LPPayloadState p, const BYTE *data, DWORD dwLen, DWORD dwPacketSize);
+-- INT FormatPayloadReport(CHAR *buf, size_t size, LPPayloadState p, BOOL bReceiver);
+-- static DWORD Mix32(DWORD x);
+-- static DWORD PacketKey(DWORD dwSeed, DWORD dwSeq);
+-- static VOID RandomVectors(BYTE *out, DWORD dwFirstVec, DWORD dwVecs, DWORD dwKey, DWORD dwMask);
+-- static VOID GenerateVectors(BYTE *out, DWORD dwFirstVec, DWORD dwVecs, DWORD dwSeq, DWORD dwKey, LPPayloadState p);
+-- static VOID GenerateRange(BYTE *out, DWORD dwOffset, DWORD dwLen, DWORD dwSeq, LPPayloadState p);
+-- static VOID MakeHeader(LPPayloadHeader hdr, DWORD dwSeq, LPPayloadState p);
+-- static BOOL ReadPayloadHeader(LPPayloadState p, const BYTE *data, DWORD dwLen);
+-- static BOOL CheckRange(const BYTE *data, DWORD dwOffset, DWORD dwLen, DWORD dwSeq, LPPayloadState p);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file generates and checks the test packets sent when no file is chosen. Packets used to be all 'a',
+--			which links that compress (WAN optimisers, some VPNs) shrink to nothing, and which nobody checked. Now
+--			each packet starts with a PayloadHeader naming the kind of payload, the transfer's seed and the packet's
+--			sequence number, and the rest is generated from those:
+--				random	- incompressible pseudo-random bytes
+--				pattern	- a 16-byte pattern, repeated (and rotated by one byte per packet)
+--				entropy	- random bytes masked to dwBits bits each, so they compress to about dwBits/8 of their size
+--				fill	- the old 'a' packets, with no header, for comparing against earlier logs
+--
+--			The random bytes come from a counter-based generator: each 32-bit word is a hash (lowbias32) of its
+--			position in the packet, keyed by the seed and the sequence number. Any part of any packet can be made
+--			without making what comes before it, which is what lets the receiver check TCP data that arrives split
+--			at arbitrary points. With SSE4.1 four words are hashed at once; otherwise the same words are made one
+--			at a time. The receiver regenerates each piece of data as it arrives and compares, so nothing is stored
+--			and the check runs at memory speed. The time both ends spend on this is reported per GB.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Payload.h"
+
+#define GOLDEN	0x9E3779B9	// 2^32 / the golden ratio; spreads consecutive word positions across the hash's input
+
+static BOOL bSimd = FALSE;	// Whether the processor has SSE4.1 (for _mm_mullo_epi32)
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Mix32
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Mix32(DWORD x)
+--
+-- RETURNS: x hashed with lowbias32 (a xorshift-multiply mixer whose output bits each depend on every input bit).
+---------------------------------------------------------------------------------------------------------------------------*/
+static __forceinline DWORD Mix32(DWORD x)
+{
+	x ^= x >> 16;
+	x *= 0x7FEB352D;
+	x ^= x >> 15;
+	x *= 0x846CA68B;
+	x ^= x >> 16;
+	return x;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PacketKey
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PacketKey(DWORD dwSeed, DWORD dwSeq)
+--
+-- RETURNS: The key the words of one packet are hashed with.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD PacketKey(DWORD dwSeed, DWORD dwSeq)
+{
+	return Mix32(dwSeed + Mix32(dwSeq ^ 0x5BD1E995));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitPayload
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitPayload()
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Checks whether the vector generator can be used. This must be called once before any packets are generated.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitPayload()
+{
+	INT cpuInfo[4];
+
+	__cpuid(cpuInfo, 1);
+	bSimd = (cpuInfo[2] & (1 << 19)) != 0; // ECX bit 19: SSE4.1
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitPayloadState
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitPayloadState(LPPayloadState p)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Sets the default payload: random, with a new seed for each transfer.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitPayloadState(LPPayloadState p)
+{
+	memset(p, 0, sizeof(PayloadState));
+	p->dwKind = PAYLOAD_RANDOM;
+	p->dwBits = PAYLOAD_DEF_BITS;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ResetPayloadState
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ResetPayloadState(LPPayloadState p)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Clears the counters for a new transfer, keeping the settings.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID ResetPayloadState(LPPayloadState p)
+{
+	p->bActive = FALSE;
+	p->qwGenBytes = 0;
+	p->qwGenTicks = 0;
+	p->dwPackets = 0;
+	p->dwBadPackets = 0;
+	p->dwFirstBad = 0;
+	p->dwLastBad = 0;
+	p->qwStreamOffset = 0;
+	p->qwCheckBytes = 0;
+	p->qwCheckTicks = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StartPayload
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StartPayload(LPPayloadState p, DWORD dwPacketSize)
+--						LPPayloadState p:		The client's payload settings.
+--						DWORD dwPacketSize:		The size of the packets about to be sent.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Prepares the sender for a transfer, picking a seed unless one was given. Packets too small to hold the header are
+-- sent as fill.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID StartPayload(LPPayloadState p, DWORD dwPacketSize)
+{
+	LARGE_INTEGER liNow;
+
+	ResetPayloadState(p);
+	if (!p->bSeedGiven)
+	{
+		QueryPerformanceCounter(&liNow);
+		p->dwSeed = Mix32((DWORD)liNow.QuadPart ^ GetTickCount());
+	}
+	p->bActive = p->dwKind != PAYLOAD_FILL && dwPacketSize >= sizeof(PayloadHeader);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RandomVectors
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RandomVectors(BYTE *out, DWORD dwFirstVec, DWORD dwVecs, DWORD dwKey, DWORD dwMask)
+--						BYTE *out:			Receives dwVecs * 16 bytes (need not be aligned).
+--						DWORD dwFirstVec:	Which 16 bytes of the packet to start at.
+--						DWORD dwVecs:		How many 16 bytes to make.
+--						DWORD dwKey:		The packet's key.
+--						DWORD dwMask:		ANDed with every word (all ones for random data).
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Word w of a packet is Mix32(w * GOLDEN ^ key) & mask. The vector loop keeps the four w * GOLDEN values of the
+-- current vector in a register and steps them with an add.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID RandomVectors(BYTE *out, DWORD dwFirstVec, DWORD dwVecs, DWORD dwKey, DWORD dwMask)
+{
+	DWORD	dwWord = dwFirstVec * 4;
+	DWORD	dwEnd = (dwFirstVec + dwVecs) * 4;
+	DWORD	w;
+
+	if (bSimd)
+	{
+		__m128i ctr		= _mm_setr_epi32((INT)(dwWord * GOLDEN), (INT)((dwWord + 1) * GOLDEN),
+			(INT)((dwWord + 2) * GOLDEN), (INT)((dwWord + 3) * GOLDEN));
+		__m128i step	= _mm_set1_epi32((INT)(4 * GOLDEN));
+		__m128i key		= _mm_set1_epi32((INT)dwKey);
+		__m128i mask	= _mm_set1_epi32((INT)dwMask);
+		__m128i m1		= _mm_set1_epi32(0x7FEB352D);
+		__m128i m2		= _mm_set1_epi32((INT)0x846CA68B);
+		__m128i x;
+
+		for (; dwWord < dwEnd; dwWord += 4, out += 16)
+		{
+			x = _mm_xor_si128(ctr, key);
+			x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+			x = _mm_mullo_epi32(x, m1);
+			x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+			x = _mm_mullo_epi32(x, m2);
+			x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+			_mm_storeu_si128((__m128i *)out, _mm_and_si128(x, mask));
+			ctr = _mm_add_epi32(ctr, step);
+		}
+		return;
+	}
+
+	for (; dwWord < dwEnd; dwWord++, out += 4)
+	{
+		w = Mix32(dwWord * GOLDEN ^ dwKey) & dwMask;
+		memcpy(out, &w, sizeof(w));
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GenerateVectors
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GenerateVectors(BYTE *out, DWORD dwFirstVec, DWORD dwVecs, DWORD dwSeq, DWORD dwKey, LPPayloadState p)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Makes whole 16-byte pieces of a packet of whatever kind p describes. The pattern is taken from the transfer's first
+-- key so every packet repeats the same 16 bytes, rotated by the sequence number.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID GenerateVectors(BYTE *out, DWORD dwFirstVec, DWORD dwVecs, DWORD dwSeq, DWORD dwKey, LPPayloadState p)
+{
+	BYTE	pattern[16];
+	BYTE	rotated[16];
+	DWORD	i;
+
+	switch (p->dwKind)
+	{
+	case PAYLOAD_PATTERN:
+		RandomVectors(pattern, 0, 1, PacketKey(p->dwSeed, 0), 0xFFFFFFFF);
+		for (i = 0; i < 16; i++)
+			rotated[i] = pattern[(i + dwSeq) & 15];
+		for (i = 0; i < dwVecs; i++, out += 16)
+			memcpy(out, rotated, 16);
+		break;
+	case PAYLOAD_ENTROPY:
+		RandomVectors(out, dwFirstVec, dwVecs, dwKey, 0x01010101 * ((1u << p->dwBits) - 1));
+		break;
+	default:
+		RandomVectors(out, dwFirstVec, dwVecs, dwKey, 0xFFFFFFFF);
+		break;
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GenerateRange
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GenerateRange(BYTE *out, DWORD dwOffset, DWORD dwLen, DWORD dwSeq, LPPayloadState p)
+--						BYTE *out:			Receives the bytes.
+--						DWORD dwOffset:		Where in the packet to start.
+--						DWORD dwLen:		How many bytes to make.
+--						DWORD dwSeq:		The packet's sequence number.
+--						LPPayloadState p:	The payload settings.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Makes any run of bytes of a packet (ignoring the header, which is written over them). Partial vectors at either end
+-- are made whole in a scratch buffer and the part needed copied out.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID GenerateRange(BYTE *out, DWORD dwOffset, DWORD dwLen, DWORD dwSeq, LPPayloadState p)
+{
+	DWORD	dwKey	= PacketKey(p->dwSeed, dwSeq);
+	DWORD	dwVec	= dwOffset / 16;
+	DWORD	dwSkip	= dwOffset % 16;
+	DWORD	dwVecs, n;
+	BYTE	tmp[16];
+
+	if (dwSkip != 0 && dwLen != 0)
+	{
+		GenerateVectors(tmp, dwVec++, 1, dwSeq, dwKey, p);
+		n = min(16 - dwSkip, dwLen);
+		memcpy(out, tmp + dwSkip, n);
+		out += n;
+		dwLen -= n;
+	}
+
+	if ((dwVecs = dwLen / 16) != 0)
+	{
+		GenerateVectors(out, dwVec, dwVecs, dwSeq, dwKey, p);
+		dwVec += dwVecs;
+		out += dwVecs * 16;
+		dwLen -= dwVecs * 16;
+	}
+
+	if (dwLen != 0)
+	{
+		GenerateVectors(tmp, dwVec, 1, dwSeq, dwKey, p);
+		memcpy(out, tmp, dwLen);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: MakeHeader
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: MakeHeader(LPPayloadHeader hdr, DWORD dwSeq, LPPayloadState p)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Fills in everything but the packet count and size, which the caller knows and the receiver doesn't check.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID MakeHeader(LPPayloadHeader hdr, DWORD dwSeq, LPPayloadState p)
+{
+	hdr->dwMagic = PAYLOAD_MAGIC;
+	hdr->bKind = (BYTE)p->dwKind;
+	hdr->bBits = (BYTE)p->dwBits;
+	hdr->wFlags = (WORD)p->dwFlags;
+	hdr->dwSeed = p->dwSeed;
+	hdr->dwSeq = dwSeq;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BuildPayload
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BuildPayload(BYTE *buf, DWORD dwLen, DWORD dwSeq, LPPayloadState p)
+--						BYTE *buf:			The packet; its first two DWORDs (the count and size) are left alone.
+--						DWORD dwLen:		The packet size.
+--						DWORD dwSeq:		The packet's sequence number.
+--						LPPayloadState p:	The sender's payload state.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID BuildPayload(BYTE *buf, DWORD dwLen, DWORD dwSeq, LPPayloadState p)
+{
+	LARGE_INTEGER	liStart, liEnd;
+	DWORD			dwHdrStart = offsetof(PayloadHeader, dwMagic);
+
+	if (!p->bActive)
+		return;
+
+	QueryPerformanceCounter(&liStart);
+	GenerateRange(buf + sizeof(PayloadHeader), sizeof(PayloadHeader), dwLen - sizeof(PayloadHeader), dwSeq, p);
+	MakeHeader((LPPayloadHeader)buf, dwSeq, p);
+	QueryPerformanceCounter(&liEnd);
+
+	p->qwGenBytes += dwLen - dwHdrStart;
+	p->qwGenTicks += liEnd.QuadPart - liStart.QuadPart;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReadPayloadHeader
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReadPayloadHeader(LPPayloadState p, const BYTE *data, DWORD dwLen)
+--						LPPayloadState p:	The receiver's payload state.
+--						BYTE *data:			The start of the first packet.
+--						DWORD dwLen:		How much of it there is.
+--
+-- RETURNS: TRUE if the packet has a payload header, whose settings are copied into p; FALSE if it's a fill packet.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL ReadPayloadHeader(LPPayloadState p, const BYTE *data, DWORD dwLen)
+{
+	PayloadHeader hdr;
+
+	if (dwLen < sizeof(PayloadHeader))
+		return FALSE;
+	memcpy(&hdr, data, sizeof(hdr));
+	if (hdr.dwMagic != PAYLOAD_MAGIC || hdr.bKind == PAYLOAD_FILL || hdr.bKind > PAYLOAD_ENTROPY || hdr.bBits == 0 ||
+		hdr.bBits > 8)
+		return FALSE;
+
+	p->dwKind = hdr.bKind;
+	p->dwBits = hdr.bBits;
+	p->dwFlags = hdr.wFlags;
+	p->dwSeed = hdr.dwSeed;
+	p->bActive = TRUE;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CheckRange
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CheckRange(const BYTE *data, DWORD dwOffset, DWORD dwLen, DWORD dwSeq, LPPayloadState p)
+--						BYTE *data:			Bytes received.
+--						DWORD dwOffset:		Where in their packet they belong.
+--						DWORD dwLen:		How many there are.
+--						DWORD dwSeq:		Which packet they belong to.
+--						LPPayloadState p:	The receiver's payload state.
+--
+-- RETURNS: TRUE if the bytes are what the sender generated; FALSE otherwise.
+--
+-- NOTES:
+-- The packet count and size at the front of the packet aren't checked, since the receiver has no other source for
+-- them, and neither are a stamped packet's timestamps. The rest is regenerated a block at a time on the stack and compared.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL CheckRange(const BYTE *data, DWORD dwOffset, DWORD dwLen, DWORD dwSeq, LPPayloadState p)
+{
+	PayloadHeader	hdr;
+	BYTE			expected[PAYLOAD_CHECKBLOCK];
+	DWORD			dwHdrStart	= offsetof(PayloadHeader, dwMagic);
+	DWORD			n;
+
+	if (dwOffset < dwHdrStart)
+	{
+		n = min(dwHdrStart - dwOffset, dwLen);
+		data += n;
+		dwOffset += n;
+		dwLen -= n;
+	}
+
+	if (dwLen != 0 && dwOffset < sizeof(PayloadHeader))
+	{
+		MakeHeader(&hdr, dwSeq, p);
+		n = min(sizeof(PayloadHeader) - dwOffset, dwLen);
+		if (memcmp(data, (BYTE *)&hdr + dwOffset, n) != 0)
+			return FALSE;
+		data += n;
+		dwOffset += n;
+		dwLen -= n;
+	}
+
+	if (dwLen != 0 && (p->dwFlags & PAYLOAD_FLAG_STAMPED) && dwOffset < PAYLOAD_STAMPED_START)
+	{
+		n = min(PAYLOAD_STAMPED_START - dwOffset, dwLen);
+		data += n;
+		dwOffset += n;
+		dwLen -= n;
+	}
+
+	while (dwLen != 0)
+	{
+		n = min(dwLen, PAYLOAD_CHECKBLOCK);
+		GenerateRange(expected, dwOffset, n, dwSeq, p);
+		if (memcmp(data, expected, n) != 0)
+			return FALSE;
+		data += n;
+		dwOffset += n;
+		dwLen -= n;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CheckPayloadPacket
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CheckPayloadPacket(LPPayloadState p, const BYTE *data, DWORD dwLen)
+--						LPPayloadState p:	The receiver's payload state.
+--						BYTE *data:			A UDP datagram.
+--						DWORD dwLen:		Its length.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Each datagram is a whole packet carrying its own sequence number, so lost and reordered packets don't matter. The
+-- settings are taken from the first packet; if it has no header the client is sending fill and nothing is checked.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID CheckPayloadPacket(LPPayloadState p, const BYTE *data, DWORD dwLen)
+{
+	PayloadHeader	hdr;
+	LARGE_INTEGER	liStart, liEnd;
+	BOOL			bGood;
+
+	if (!p->bActive && (p->dwPackets != 0 || !ReadPayloadHeader(p, data, dwLen)))
+		return;
+
+	QueryPerformanceCounter(&liStart);
+	bGood = dwLen >= sizeof(PayloadHeader);
+	if (bGood)
+	{
+		memcpy(&hdr, data, sizeof(hdr));
+		bGood = CheckRange(data, 0, dwLen, hdr.dwSeq, p);
+	}
+	QueryPerformanceCounter(&liEnd);
+
+	if (!bGood && p->dwBadPackets++ == 0)
+		p->dwFirstBad = p->dwPackets;
+	p->dwPackets++;
+	p->qwCheckBytes += dwLen;
+	p->qwCheckTicks += liEnd.QuadPart - liStart.QuadPart;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CheckPayloadStream
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CheckPayloadStream(LPPayloadState p, const BYTE *data, DWORD dwLen, DWORD dwPacketSize)
+--						LPPayloadState p:		The receiver's payload state.
+--						BYTE *data:				Bytes just received on the TCP stream.
+--						DWORD dwLen:			How many.
+--						DWORD dwPacketSize:		The packet size the client sent.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- TCP doesn't keep packet boundaries, so each packet's sequence number and the offset into it come from the position
+-- in the stream. A packet is counted once it's complete, and counted as bad once however many pieces of it are. The
+-- first packet's header is gathered in p->head, since the settings in it are needed to check anything.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID CheckPayloadStream(LPPayloadState p, const BYTE *data, DWORD dwLen, DWORD dwPacketSize)
+{
+	LARGE_INTEGER	liStart, liEnd;
+	DWORD			dwSeq, dwOffset, n;
+
+	// The header may come in more than one piece; nothing can be checked until it's all here
+	if (p->qwStreamOffset < sizeof(PayloadHeader))
+	{
+		n = min(sizeof(PayloadHeader) - (DWORD)p->qwStreamOffset, dwLen);
+		memcpy(p->head + p->qwStreamOffset, data, n);
+		if (p->qwStreamOffset + n == sizeof(PayloadHeader) && ReadPayloadHeader(p, p->head, sizeof(PayloadHeader)) &&
+			dwPacketSize >= sizeof(PayloadHeader))
+		{
+			p->qwCheckBytes += sizeof(PayloadHeader);
+			if (!CheckRange(p->head, 0, sizeof(PayloadHeader), 0, p) && p->dwBadPackets++ == 0)
+			{
+				p->dwFirstBad = 0;
+				p->dwLastBad = 1;
+			}
+		}
+		data += n;
+		dwLen -= n;
+		p->qwStreamOffset += n;
+	}
+	if (!p->bActive || dwPacketSize < sizeof(PayloadHeader))
+	{
+		p->qwStreamOffset += dwLen;
+		return;
+	}
+
+	QueryPerformanceCounter(&liStart);
+	p->qwCheckBytes += dwLen;
+	while (dwLen != 0)
+	{
+		dwSeq = (DWORD)(p->qwStreamOffset / dwPacketSize);
+		dwOffset = (DWORD)(p->qwStreamOffset % dwPacketSize);
+		n = min(dwPacketSize - dwOffset, dwLen);
+
+		if (!CheckRange(data, dwOffset, n, dwSeq, p) && p->dwLastBad != dwSeq + 1)
+		{
+			if (p->dwBadPackets++ == 0)
+				p->dwFirstBad = dwSeq;
+			p->dwLastBad = dwSeq + 1;
+		}
+		if (dwOffset + n == dwPacketSize)
+			p->dwPackets++;
+
+		data += n;
+		dwLen -= n;
+		p->qwStreamOffset += n;
+	}
+	QueryPerformanceCounter(&liEnd);
+	p->qwCheckTicks += liEnd.QuadPart - liStart.QuadPart;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatPayloadReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatPayloadReport(CHAR *buf, size_t size, LPPayloadState p, BOOL bReceiver)
+--							CHAR *buf:			The buffer to write the report section into.
+--							size_t size:		The space left in buf.
+--							LPPayloadState p:	The payload counters.
+--							BOOL bReceiver:		Whether this is the receiving end.
+--
+-- RETURNS: The number of characters written.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatPayloadReport(CHAR *buf, size_t size, LPPayloadState p, BOOL bReceiver)
+{
+	static const CHAR	*kinds[] = { "fill", "random", "pattern", "entropy" };
+	ULONGLONG			qwBytes = bReceiver ? p->qwCheckBytes : p->qwGenBytes;
+	double				dSeconds = TicksToSeconds(bReceiver ? p->qwCheckTicks : p->qwGenTicks);
+	INT					written = 0;
+
+	if (!p->bActive)
+		return sprintf_s(buf, size, "Payload: fill (%s)\r\n", bReceiver ? "not checked" : "compressible, not checked");
+
+	written += sprintf_s(buf, size, "Payload: %s", kinds[p->dwKind]);
+	if (p->dwKind == PAYLOAD_ENTROPY)
+		written += sprintf_s(buf + written, size - written, " (%lu bits/byte)", p->dwBits);
+	written += sprintf_s(buf + written, size - written, ", seed 0x%08lX\r\n", p->dwSeed);
+
+	if (bReceiver)
+	{
+		if (p->dwBadPackets == 0)
+			written += sprintf_s(buf + written, size - written, "Payload check: %lu packets verified\r\n", p->dwPackets);
+		else
+			written += sprintf_s(buf + written, size - written,
+				"Payload check: FAILED, %lu of %lu packets corrupt (first: packet %lu)\r\n", p->dwBadPackets,
+				p->dwPackets, p->dwFirstBad);
+	}
+
+	if (qwBytes != 0 && dSeconds > 0.0)
+		written += sprintf_s(buf + written, size - written, "Payload %s: %.1fms/GB (%.2f GB/s, %s)\r\n",
+			bReceiver ? "verification" : "generation", dSeconds * 1e3 / (qwBytes / 1e9), qwBytes / 1e9 / dSeconds,
+			bSimd ? "SSE4.1" : "scalar");
+	return written;
+}
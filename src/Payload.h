@@ -0,0 +1,53 @@
+#ifndef PAYLOAD_H
+#define PAYLOAD_H
+
+#include <Windows.h>
+#include <intrin.h>
+#include <smmintrin.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+
+#define PAYLOAD_MAGIC		0x444C5950	// "PYLD"
+#define PAYLOAD_DEF_BITS	4			// Entropy per byte when -entropy isn't given
+#define PAYLOAD_CHECKBLOCK	4096		// Bytes regenerated at a time when checking
+#define PAYLOAD_FLAG_STAMPED	0x0001	// A PayloadStamp follows the header (duplex transfers; see Duplex.cpp)
+#define PAYLOAD_FLAG_DUPLEX		0x0002	// The client wants test packets sent back while it sends
+#define PAYLOAD_STAMPED_START	(sizeof(PayloadHeader) + sizeof(PayloadStamp))	// Where generated data starts then
+
+#pragma pack(push, 1)
+
+/* The start of every generated test packet. The first two fields are the ones test packets have always started with. */
+typedef struct _PayloadHeader
+{
+	DWORD		dwNumToSend;
+	DWORD		dwPacketSize;
+	DWORD		dwMagic;
+	BYTE		bKind;
+	BYTE		bBits;
+	WORD		wFlags;		// PAYLOAD_FLAG_*; always 0 from older clients
+	DWORD		dwSeed;
+	DWORD		dwSeq;		// The packet's position in the transfer, from 0
+} PayloadHeader, *LPPayloadHeader;
+
+/* Timestamps written into a stamped packet just before it's sent, so they aren't generated or checked. */
+typedef struct _PayloadStamp
+{
+	DWORD		dwSendUs;	// The sender's clock when it was sent
+	DWORD		dwEchoUs;	// The last of the receiver's own stamps the sender had, plus how long it had held it (0 if none)
+} PayloadStamp, *LPPayloadStamp;
+
+#pragma pack(pop)
+
+VOID InitPayload();
+VOID InitPayloadState(LPPayloadState p);
+VOID ResetPayloadState(LPPayloadState p);
+VOID StartPayload(LPPayloadState p, DWORD dwPacketSize);
+VOID BuildPayload(BYTE *buf, DWORD dwLen, DWORD dwSeq, LPPayloadState p);
+VOID CheckPayloadPacket(LPPayloadState p, const BYTE *data, DWORD dwLen);
+VOID CheckPayloadStream(LPPayloadState p, const BYTE *data, DWORD dwLen, DWORD dwPacketSize);
+INT FormatPayloadReport(CHAR *buf, size_t size, LPPayloadState p, BOOL bReceiver);
+
+#endif
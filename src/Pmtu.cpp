@@ -0,0 +1,371 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Pmtu.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- BOOL DiscoverPathMtu(SOCKET s, const SOCKADDR_STORAGE *addr, INT nAddrLen, LPPmtuState pmtu);
+-- BOOL IsPmtuProbe(const BYTE *data, DWORD dwLen);
+-- VOID AnswerPmtuProbe(SOCKET s, const SOCKADDR_STORAGE *to, INT nToLen, const BYTE *data, DWORD dwLen);
+-- DWORD FragmentsPerDatagram(DWORD dwDatagram, DWORD dwMtu, BOOL bIPv6);
+-- INT FormatPmtuReport(CHAR *buf, size_t size, LPPmtuState pmtu, LPControlState control, DWORD dwDatagram,
+--		BOOL bReceiver);
+-- static BOOL SetDontFragment(SOCKET s, BOOL bIPv6, BOOL bOn);
+-- static DWORD SendProbe(SOCKET s, const SOCKADDR_STORAGE *addr, INT nAddrLen, BYTE *buf, DWORD dwLen,
+--		DWORD dwWaitMs, DWORD dwNonce, LPPmtuState pmtu);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file finds the path MTU before a UDP transfer. A datagram bigger than the path MTU goes out as IP
+--			fragments, and losing any one of them loses the whole datagram, so a 61440-byte datagram over Ethernet
+--			(42 fragments) is lost roughly 42 times as often as a 1472-byte one. On a lossy link that swamps whatever
+--			the test was meant to measure.
+--
+--			The client sends probes with the don't-fragment flag set and the server echoes each one's length back.
+--			The search starts from RFC 8899's base size, which every path is assumed to carry, and tries 1500 bytes
+--			next, since most paths are exactly Ethernet. Then it binary searches up to PMTU_MAX. A probe the stack
+--			refuses to send (WSAEMSGSIZE) is too big for the interface, or for the path once an ICMP "fragmentation
+--			needed" has come back, as in classic PMTUD. A probe that goes unanswered PMTU_TRIES times is also taken
+--			to be too big, as in PLPMTUD, which still works when the ICMP messages are filtered. Each size gets
+--			PMTU_TRIES chances so one random loss doesn't pass for a black hole.
+--
+--			The don't-fragment flag is cleared again afterwards. With -pmtu auto, or "Path MTU" as the packet size,
+--			the transfer's datagrams are then sized to fit. Otherwise the report just estimates what fragmentation
+--			is costing.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Pmtu.h"
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SetDontFragment
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SetDontFragment(SOCKET s, BOOL bIPv6, BOOL bOn)
+--							SOCKET s:		A UDP socket.
+--							BOOL bIPv6:		Whether it's an IPv6 socket.
+--							BOOL bOn:		Whether the datagrams it sends may be fragmented.
+--
+-- RETURNS: FALSE if the stack doesn't support the option; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL SetDontFragment(SOCKET s, BOOL bIPv6, BOOL bOn)
+{
+	DWORD dwOn = bOn;
+
+	if (bIPv6)
+		return setsockopt(s, IPPROTO_IPV6, IPV6_DONTFRAG, (CHAR *)&dwOn, sizeof(dwOn)) != SOCKET_ERROR;
+	return setsockopt(s, IPPROTO_IP, IP_DONTFRAGMENT, (CHAR *)&dwOn, sizeof(dwOn)) != SOCKET_ERROR;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendProbe
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendProbe(SOCKET s, const SOCKADDR_STORAGE *addr, INT nAddrLen, BYTE *buf, DWORD dwLen, DWORD dwWaitMs,
+--						DWORD dwNonce, LPPmtuState pmtu)
+--							SOCKET s:						The client's UDP socket, with don't-fragment set.
+--							const SOCKADDR_STORAGE *addr:	The server.
+--							INT nAddrLen:					The length of its address.
+--							BYTE *buf:						At least dwLen bytes to send the probe from.
+--							DWORD dwLen:					The UDP payload size to test.
+--							DWORD dwWaitMs:					How long to wait for each answer.
+--							DWORD dwNonce:					Identifies this run's answers.
+--							LPPmtuState pmtu:				Receives the probe counts.
+--
+-- RETURNS: PROBE_ANSWERED, PROBE_UNANSWERED or PROBE_TOOBIG.
+--
+-- NOTES:
+-- Answers to sizes that were already given up on may still turn up while waiting; they're skipped.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD SendProbe(SOCKET s, const SOCKADDR_STORAGE *addr, INT nAddrLen, BYTE *buf, DWORD dwLen, DWORD dwWaitMs,
+	DWORD dwNonce, LPPmtuState pmtu)
+{
+	LPPmtuProbe	probe = (LPPmtuProbe)buf;
+	PmtuProbe	ack;
+	INT			nRecvd;
+	DWORD		i;
+
+	probe->dwMagic	= PMTU_PROBE_MAGIC;
+	probe->dwNonce	= dwNonce;
+	probe->dwLen	= dwLen;
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwWaitMs, sizeof(DWORD));
+
+	for (i = 0; i < PMTU_TRIES; i++)
+	{
+		pmtu->dwProbes++;
+		if (sendto(s, (CHAR *)buf, dwLen, 0, (const sockaddr *)addr, nAddrLen) == SOCKET_ERROR &&
+			WSAGetLastError() == WSAEMSGSIZE)
+		{
+			pmtu->dwTooBig++;
+			return PROBE_TOOBIG;
+		}
+
+		while ((nRecvd = recv(s, (CHAR *)&ack, sizeof(ack), 0)) != SOCKET_ERROR)
+		{
+			if (nRecvd == sizeof(ack) && ack.dwMagic == PMTU_ACK_MAGIC && ack.dwNonce == dwNonce && ack.dwLen == dwLen)
+				return PROBE_ANSWERED;
+		}
+		pmtu->dwUnanswered++;
+	}
+	return PROBE_UNANSWERED;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DiscoverPathMtu
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DiscoverPathMtu(SOCKET s, const SOCKADDR_STORAGE *addr, INT nAddrLen, LPPmtuState pmtu)
+--							SOCKET s:						The client's UDP socket.
+--							const SOCKADDR_STORAGE *addr:	The server.
+--							INT nAddrLen:					The length of its address.
+--							LPPmtuState pmtu:				Receives the MTU, the payload that fits it and the probe
+--															counts.
+--
+-- RETURNS: TRUE if the path MTU was found; FALSE if the server didn't answer the base probe or the socket doesn't
+--			support don't-fragment.
+--
+-- NOTES:
+-- The base probe's round trip sets how long later probes wait, so a slow path doesn't have every probe taken for too
+-- big, and a fast one isn't kept waiting.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL DiscoverPathMtu(SOCKET s, const SOCKADDR_STORAGE *addr, INT nAddrLen, LPPmtuState pmtu)
+{
+	LARGE_INTEGER	liStart, liProbe;
+	BYTE			*buf;
+	DWORD			dwOverhead;
+	DWORD			dwLo, dwHi, dwMid;
+	DWORD			dwWaitMs;
+	DWORD			dwNonce;
+	DWORD			dwNoTimeout	= 0;
+
+	pmtu->bFound = FALSE;
+	pmtu->bIPv6 = addr->ss_family == AF_INET6;
+	pmtu->dwMtu = pmtu->dwPayload = pmtu->dwProbes = pmtu->dwUnanswered = pmtu->dwTooBig = 0;
+	pmtu->dwRttUs = pmtu->dwProbeUs = 0;
+	dwOverhead = (pmtu->bIPv6 ? PMTU_IPV6_HDR : PMTU_IPV4_HDR) + PMTU_UDP_HDR;
+
+	if ((buf = (BYTE *)PoolAlloc(PMTU_MAX)) == NULL)
+		return FALSE;
+	memset(buf, 0, PMTU_MAX);
+	QueryPerformanceCounter(&liStart);
+	dwNonce = GetTickCount() ^ liStart.LowPart;
+
+	if (!SetDontFragment(s, pmtu->bIPv6, TRUE))
+	{
+		PoolFree(buf);
+		return FALSE;
+	}
+
+	// If the base size doesn't get through, the server isn't answering probes at all
+	QueryPerformanceCounter(&liProbe);
+	if (SendProbe(s, addr, nAddrLen, buf, PMTU_BASE - dwOverhead, PMTU_FIRST_WAIT_MS, dwNonce, pmtu) == PROBE_ANSWERED)
+	{
+		pmtu->dwRttUs = ElapsedUs(&liProbe);
+		dwWaitMs = max((DWORD)PMTU_MIN_WAIT_MS, min((DWORD)PMTU_MAX_WAIT_MS, pmtu->dwRttUs * 4 / 1000));
+		dwLo = PMTU_BASE - dwOverhead;
+		dwHi = PMTU_MAX - dwOverhead;
+
+		dwMid = PMTU_COMMON - dwOverhead;
+		if (SendProbe(s, addr, nAddrLen, buf, dwMid, dwWaitMs, dwNonce, pmtu) == PROBE_ANSWERED)
+			dwLo = dwMid;
+		else
+			dwHi = dwMid - 1;
+
+		while (dwLo < dwHi)
+		{
+			dwMid = dwLo + (dwHi - dwLo + 1) / 2;
+			if (SendProbe(s, addr, nAddrLen, buf, dwMid, dwWaitMs, dwNonce, pmtu) == PROBE_ANSWERED)
+				dwLo = dwMid;
+			else
+				dwHi = dwMid - 1;
+		}
+
+		pmtu->bFound = TRUE;
+		pmtu->dwPayload = dwLo;
+		pmtu->dwMtu = dwLo + dwOverhead;
+	}
+
+	SetDontFragment(s, pmtu->bIPv6, FALSE);
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+	pmtu->dwProbeUs = ElapsedUs(&liStart);
+	PoolFree(buf);
+	return pmtu->bFound;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsPmtuProbe
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsPmtuProbe(const BYTE *data, DWORD dwLen)
+--							const BYTE *data:	A received datagram.
+--							DWORD dwLen:		Its length.
+--
+-- RETURNS: TRUE if the datagram is a probe rather than data.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL IsPmtuProbe(const BYTE *data, DWORD dwLen)
+{
+	return dwLen >= sizeof(PmtuProbe) && ((const PmtuProbe *)data)->dwMagic == PMTU_PROBE_MAGIC &&
+		((const PmtuProbe *)data)->dwLen == dwLen;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AnswerPmtuProbe
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AnswerPmtuProbe(SOCKET s, const SOCKADDR_STORAGE *to, INT nToLen, const BYTE *data, DWORD dwLen)
+--							SOCKET s:					The server's UDP socket.
+--							const SOCKADDR_STORAGE *to:	Where the probe came from.
+--							INT nToLen:					The length of the address.
+--							const BYTE *data:			The probe.
+--							DWORD dwLen:				Its length.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID AnswerPmtuProbe(SOCKET s, const SOCKADDR_STORAGE *to, INT nToLen, const BYTE *data, DWORD dwLen)
+{
+	PmtuProbe ack;
+
+	ack.dwMagic	= PMTU_ACK_MAGIC;
+	ack.dwNonce	= ((const PmtuProbe *)data)->dwNonce;
+	ack.dwLen	= dwLen;
+	sendto(s, (CHAR *)&ack, sizeof(ack), 0, (const sockaddr *)to, nToLen);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FragmentsPerDatagram
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FragmentsPerDatagram(DWORD dwDatagram, DWORD dwMtu, BOOL bIPv6)
+--							DWORD dwDatagram:	UDP payload size.
+--							DWORD dwMtu:		The path MTU.
+--							BOOL bIPv6:			Whether the path is IPv6.
+--
+-- RETURNS: The number of IP packets a datagram of that size is sent as.
+--
+-- NOTES:
+-- Every fragment but the last carries a multiple of 8 bytes; IPv6 fragments also carry a fragment header.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD FragmentsPerDatagram(DWORD dwDatagram, DWORD dwMtu, BOOL bIPv6)
+{
+	DWORD dwHdr		= bIPv6 ? PMTU_IPV6_HDR : PMTU_IPV4_HDR;
+	DWORD dwTotal	= dwDatagram + PMTU_UDP_HDR;
+	DWORD dwPerFrag;
+
+	if (dwMtu == 0 || dwTotal + dwHdr <= dwMtu)
+		return 1;
+	dwPerFrag = (dwMtu - dwHdr - (bIPv6 ? PMTU_FRAG_HDR : 0)) & ~7UL;
+	return (dwTotal + dwPerFrag - 1) / dwPerFrag;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatPmtuReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatPmtuReport(CHAR *buf, size_t size, LPPmtuState pmtu, LPControlState control, DWORD dwDatagram,
+--								BOOL bReceiver)
+--							CHAR *buf:				The buffer to write the report section into.
+--							size_t size:			The space left in buf.
+--							LPPmtuState pmtu:		The probing results.
+--							LPControlState control:	The end of the transfer, with the receiver's totals (see Control.cpp).
+--							DWORD dwDatagram:		The largest datagram sent.
+--							BOOL bReceiver:			Whether this end received the transfer.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The datagram loss the receiver reported is put down to fragments being lost independently, which gives a loss rate
+-- per IP packet. From that, the loss at the other size is estimated: the size asked for, if the datagrams were fitted
+-- to the path, or the size that fits, if they were fragmented.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatPmtuReport(CHAR *buf, size_t size, LPPmtuState pmtu, LPControlState control, DWORD dwDatagram,
+	BOOL bReceiver)
+{
+	INT		written	= 0;
+	DWORD	dwFrags, dwOther, dwOtherFrags;
+	BOOL	bFitted	= pmtu->bFit && pmtu->dwRequested != 0 && pmtu->dwRequested != dwDatagram;
+	double	dLoss, dPacketLoss, dOtherLoss;
+
+	if (bReceiver)
+		return pmtu->dwAnswered != 0 ? sprintf_s(buf, size, "Path MTU probes answered: %lu\r\n", pmtu->dwAnswered) : 0;
+
+	if (pmtu->dwProbes == 0)
+		return 0;
+	if (!pmtu->bFound)
+		return sprintf_s(buf, size, "Path MTU: not found; no answer to a %d-byte probe (%lu sent)\r\n", PMTU_BASE,
+			pmtu->dwProbes);
+
+	written += sprintf_s(buf, size, "Path MTU: %lu bytes (%s), %lu-byte datagrams fit; %lu probes in %.2fms "
+		"(%lu unanswered, %lu refused by the stack), RTT %.2fms\r\n", pmtu->dwMtu, pmtu->bIPv6 ? "IPv6" : "IPv4",
+		pmtu->dwPayload, pmtu->dwProbes, pmtu->dwProbeUs / 1e3, pmtu->dwUnanswered, pmtu->dwTooBig,
+		pmtu->dwRttUs / 1e3);
+
+	dwFrags = FragmentsPerDatagram(dwDatagram, pmtu->dwMtu, pmtu->bIPv6);
+	if (bFitted)
+	{
+		dwOther = pmtu->dwRequested;
+		written += sprintf_s(buf + written, size - written,
+			"Datagrams: %lu bytes, %lu fragment(s) each (fitted from %lu bytes, %lu fragments)\r\n", dwDatagram, dwFrags,
+			dwOther, FragmentsPerDatagram(dwOther, pmtu->dwMtu, pmtu->bIPv6));
+	}
+	else
+	{
+		dwOther = dwFrags > 1 ? pmtu->dwPayload : 0;
+		written += sprintf_s(buf + written, size - written, "Datagrams: %lu bytes, %lu fragment(s) each\r\n",
+			dwDatagram, dwFrags);
+	}
+
+	if (dwOther == 0 || !control->bPeer || control->dwDatagrams == 0)
+		return written;
+
+	dLoss = control->dwDatagrams > control->dwPeerDatagrams ?
+		(double)(control->dwDatagrams - control->dwPeerDatagrams) / control->dwDatagrams : 0.0;
+	dPacketLoss = 1.0 - pow(1.0 - dLoss, 1.0 / dwFrags);
+	dwOtherFrags = FragmentsPerDatagram(dwOther, pmtu->dwMtu, pmtu->bIPv6);
+	dOtherLoss = 1.0 - pow(1.0 - dPacketLoss, (double)dwOtherFrags);
+
+	if (bFitted)
+		written += sprintf_s(buf + written, size - written, "Fragmentation loss avoided: est. %.2f%% of %lu-byte "
+			"datagrams would have been lost, against %.2f%% measured\r\n", dOtherLoss * 100, dwOther, dLoss * 100);
+	else
+		written += sprintf_s(buf + written, size - written, "Fragmentation loss: %.2f%% of datagrams lost; est. "
+			"%.2f%% at %lu bytes\r\n", dLoss * 100, dOtherLoss * 100, dwOther);
+	return written;
+}
@@ -0,0 +1,53 @@
+#ifndef PMTU_H
+#define PMTU_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <Ws2tcpip.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Connect.h"
+#include "Pool.h"
+
+#define PMTU_PROBE_MAGIC	0x424F5250	// "PROB"
+#define PMTU_ACK_MAGIC		0x4B435550	// "PUCK"
+#define PMTU_BASE			1200		// An IP packet size every path is assumed to carry (RFC 8899's BASE_PLPMTU)
+#define PMTU_COMMON			1500		// Ethernet; tried first, since most paths are exactly this
+#define PMTU_MAX			9216		// The largest jumbo frame searched for
+#define PMTU_TRIES			2			// Times a size is probed before it's taken to be too big
+#define PMTU_FIRST_WAIT_MS	500			// Time allowed for the answer to the base probe
+#define PMTU_MIN_WAIT_MS	20			// Time allowed for later answers: four round trips, within these bounds
+#define PMTU_MAX_WAIT_MS	250
+#define PMTU_IPV4_HDR		20
+#define PMTU_IPV6_HDR		40
+#define PMTU_UDP_HDR		8
+#define PMTU_FRAG_HDR		8			// IPv6 fragment extension header
+
+#define PROBE_ANSWERED		0
+#define PROBE_UNANSWERED	1
+#define PROBE_TOOBIG		2			// The stack refused it: bigger than the interface, or an ICMP said so
+
+#pragma pack(push, 1)
+
+/* Starts every probe, which is padded out to the size being tested; the answer is just this structure with
+   PMTU_ACK_MAGIC. */
+typedef struct _PmtuProbe
+{
+	DWORD		dwMagic;
+	DWORD		dwNonce;		// Ties answers to this run of probes
+	DWORD		dwLen;			// The probe's length, which the answer echoes
+} PmtuProbe, *LPPmtuProbe;
+
+#pragma pack(pop)
+
+BOOL DiscoverPathMtu(SOCKET s, const SOCKADDR_STORAGE *addr, INT nAddrLen, LPPmtuState pmtu);
+BOOL IsPmtuProbe(const BYTE *data, DWORD dwLen);
+VOID AnswerPmtuProbe(SOCKET s, const SOCKADDR_STORAGE *to, INT nToLen, const BYTE *data, DWORD dwLen);
+DWORD FragmentsPerDatagram(DWORD dwDatagram, DWORD dwMtu, BOOL bIPv6);
+INT FormatPmtuReport(CHAR *buf, size_t size, LPPmtuState pmtu, LPControlState control, DWORD dwDatagram,
+	BOOL bReceiver);
+
+#endif
@@ -0,0 +1,395 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Pool.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- BOOL UsePoolHugePages();
+-- VOID SetPoolNode(DWORD dwNode);
+-- VOID *PoolAlloc(size_t size);
+-- VOID PoolFree(VOID *p);
+-- VOID PoolFlushThread();
+-- INT FormatPoolReport(CHAR *buf, size_t size);
+-- static BOOL CALLBACK InitPoolOnce(PINIT_ONCE initOnce, VOID *param, VOID **context);
+-- static VOID RaisePeak(volatile LONG64 *pllPeak, LONG64 llValue);
+-- static BOOL AddSlab(DWORD dwClass);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file is the allocator for packet and chunk buffers, which used to be malloced and freed for every
+--			transfer (and, for multi-file transfers, for every piece of every file). Buffers come in a few size
+--			classes matched to the sizes the program uses: the packet sizes offered in the transfer dialog, a
+--			datagram or chunk payload, a whole chunk and the chunk reader's double buffer.
+--
+--			Each class is carved out of 2 MB slabs taken straight from VirtualAlloc, with a 64-byte header in front
+--			of each buffer so every buffer starts on a cache line. With -hugepages the slabs are large pages, so a
+--			whole slab needs a single TLB entry; that needs the "Lock pages in memory" right, and without it the
+--			pool quietly uses normal pages. Slabs are never given back; the pool only grows to the most buffers
+--			ever in use at once.
+--
+--			Freed buffers go on their class's free list, an SList, which threads push to and pop from with
+--			interlocked instructions and no lock, so a buffer freed on a different thread from the one that
+--			allocated it (the multi-file writers free what the receive thread allocates) costs no more than any
+--			other. In front of that each thread keeps a few buffers of each class for itself. A thread must call
+--			PoolFlushThread before it exits or the buffers in its cache are lost.
+--
+--			Slabs are made on the NUMA node SetPoolNode chooses (see Affinity.cpp), or wherever Windows puts the
+--			allocating thread's memory if none has been chosen.
+--
+--			Requests bigger than the largest class are allocated on their own and counted as misses. The report
+--			gives the share of allocations the pool satisfied from buffers already made, and the most memory in use
+--			and reserved at any time.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Pool.h"
+
+/* The free buffers a thread keeps for itself */
+typedef struct _PoolCache
+{
+	DWORD			dwCount[POOL_CLASSES];
+	LPPoolBlock		blocks[POOL_CLASSES][POOL_CACHESIZE];
+} PoolCache;
+
+static const DWORD	classSizes[POOL_CLASSES] = {
+	1024,				// Packet sizes offered in the transfer dialog
+	4096,
+	20480,
+	65536,				// 61440-byte packets, UDP datagrams and chunk payloads
+	65600,				// A chunk with its header
+	131200				// The chunk reader's buffer (two chunks)
+};
+
+static SLIST_HEADER		freeLists[POOL_CLASSES];
+static __declspec(thread) PoolCache cache;
+static INIT_ONCE		initOnce = INIT_ONCE_STATIC_INIT;
+static BOOL				bHugePages = FALSE;		// -hugepages was given and the privilege is held
+static SIZE_T			slabSize = POOL_SLABSIZE;
+static volatile LONG64	llAllocs = 0;			// Buffers handed out
+static volatile LONG64	llHits = 0;				// Of those, buffers that were already made
+static volatile LONG64	llInUse = 0;			// Bytes in buffers handed out and not yet freed
+static volatile LONG64	llPeakInUse = 0;
+static volatile LONG64	llReserved = 0;			// Bytes in slabs and large buffers
+static volatile LONG64	llPeakReserved = 0;
+static volatile LONG	lSlabs = 0;
+static volatile DWORD	dwPoolNode = NUMA_NO_PREFERRED_NODE;	// -poolnode
+static volatile LONG	lNodeSlabs = 0;			// Slabs made on that node
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitPoolOnce
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitPoolOnce(PINIT_ONCE initOnce, VOID *param, VOID **context)
+--
+-- RETURNS: TRUE.
+--
+-- NOTES:
+-- Sets up the free lists; InitOnceExecuteOnce makes sure this happens once whichever thread allocates first.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL CALLBACK InitPoolOnce(PINIT_ONCE initOnce, VOID *param, VOID **context)
+{
+	DWORD i;
+
+	for (i = 0; i < POOL_CLASSES; i++)
+		InitializeSListHead(&freeLists[i]);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: UsePoolHugePages
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: UsePoolHugePages()
+--
+-- RETURNS: TRUE if slabs will be large pages; FALSE if the process can't lock pages in memory.
+--
+-- NOTES:
+-- Large pages can only be allocated with SeLockMemoryPrivilege enabled, which the user must have been granted. This
+-- must be called before the first buffer is allocated.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL UsePoolHugePages()
+{
+	HANDLE				hToken;
+	TOKEN_PRIVILEGES	tp;
+	SIZE_T				large = GetLargePageMinimum();
+
+	if (large == 0 || !OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &hToken))
+		return FALSE;
+
+	tp.PrivilegeCount = 1;
+	tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	if (LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid) &&
+		AdjustTokenPrivileges(hToken, FALSE, &tp, 0, NULL, NULL) && GetLastError() == ERROR_SUCCESS)
+	{
+		bHugePages = TRUE;
+		slabSize = (POOL_SLABSIZE + large - 1) / large * large;
+	}
+	CloseHandle(hToken);
+	return bHugePages;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SetPoolNode
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SetPoolNode(DWORD dwNode)
+--							DWORD dwNode:	The NUMA node to make slabs on from now on.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Slabs already made stay where they are.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID SetPoolNode(DWORD dwNode)
+{
+	dwPoolNode = dwNode;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RaisePeak
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RaisePeak(volatile LONG64 *pllPeak, LONG64 llValue)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID RaisePeak(volatile LONG64 *pllPeak, LONG64 llValue)
+{
+	LONG64 llPeak;
+
+	while ((llPeak = *pllPeak) < llValue && InterlockedCompareExchange64(pllPeak, llValue, llPeak) != llPeak)
+		;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AddSlab
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AddSlab(DWORD dwClass)
+--
+-- RETURNS: FALSE if the memory couldn't be allocated; TRUE otherwise.
+--
+-- NOTES:
+-- Carves a new slab into buffers of the class and puts them all on its free list. If large pages can't be had (they
+-- need physically contiguous memory, which runs short on a long-running machine) a normal slab is used instead.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL AddSlab(DWORD dwClass)
+{
+	DWORD		dwStride	= POOL_HDRSIZE + classSizes[dwClass];
+	BYTE		*slab		= NULL;
+	SIZE_T		size		= slabSize;
+	DWORD		dwOnNode	= dwPoolNode;
+	SIZE_T		off;
+	LPPoolBlock	block;
+
+	if (bHugePages)
+		slab = (BYTE *)VirtualAllocExNuma(GetCurrentProcess(), NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+			PAGE_READWRITE, dwOnNode);
+	if (slab == NULL)
+	{
+		size = POOL_SLABSIZE;
+		slab = (BYTE *)VirtualAllocExNuma(GetCurrentProcess(), NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE,
+			dwOnNode);
+	}
+	if (slab == NULL)
+		return FALSE;
+	if (dwOnNode != NUMA_NO_PREFERRED_NODE)
+		InterlockedIncrement(&lNodeSlabs);
+
+	for (off = 0; off + dwStride <= size; off += dwStride)
+	{
+		block = (LPPoolBlock)(slab + off);
+		block->dwClass = dwClass;
+		block->dwSize = classSizes[dwClass];
+		InterlockedPushEntrySList(&freeLists[dwClass], &block->entry);
+	}
+
+	InterlockedIncrement(&lSlabs);
+	RaisePeak(&llPeakReserved, InterlockedExchangeAdd64(&llReserved, size) + size);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PoolAlloc
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PoolAlloc(size_t size)
+--						size_t size:	The number of bytes needed.
+--
+-- RETURNS: A cache-line-aligned buffer of at least size bytes, or NULL if there's no memory. It must be freed with
+--			PoolFree.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID *PoolAlloc(size_t size)
+{
+	LPPoolBlock	block	= NULL;
+	BOOL		bHit	= TRUE;
+	DWORD		dwClass;
+
+	InitOnceExecuteOnce(&initOnce, InitPoolOnce, NULL, NULL);
+
+	for (dwClass = 0; dwClass < POOL_CLASSES && classSizes[dwClass] < size; dwClass++)
+		;
+
+	if (dwClass == POOL_CLASSES)
+	{
+		if ((block = (LPPoolBlock)_aligned_malloc(POOL_HDRSIZE + size, POOL_HDRSIZE)) == NULL)
+			return NULL;
+		block->dwClass = POOL_LARGE;
+		block->dwSize = (DWORD)size;
+		bHit = FALSE;
+		RaisePeak(&llPeakReserved, InterlockedExchangeAdd64(&llReserved, size) + size);
+	}
+	else if (cache.dwCount[dwClass] != 0)
+		block = cache.blocks[dwClass][--cache.dwCount[dwClass]];
+	else
+	{
+		while ((block = (LPPoolBlock)InterlockedPopEntrySList(&freeLists[dwClass])) == NULL)
+		{
+			if (!AddSlab(dwClass))
+				return NULL;
+			bHit = FALSE;
+		}
+	}
+
+	InterlockedIncrement64(&llAllocs);
+	if (bHit)
+		InterlockedIncrement64(&llHits);
+	RaisePeak(&llPeakInUse, InterlockedExchangeAdd64(&llInUse, block->dwSize) + block->dwSize);
+	return (BYTE *)block + POOL_HDRSIZE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PoolFree
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PoolFree(VOID *p)
+--						VOID *p:	A buffer from PoolAlloc, or NULL.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Any thread may free a buffer. It goes in the thread's cache if there's room, or back on the shared free list.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID PoolFree(VOID *p)
+{
+	LPPoolBlock block;
+
+	if (p == NULL)
+		return;
+
+	block = (LPPoolBlock)((BYTE *)p - POOL_HDRSIZE);
+	InterlockedExchangeAdd64(&llInUse, -(LONG64)block->dwSize);
+
+	if (block->dwClass == POOL_LARGE)
+	{
+		InterlockedExchangeAdd64(&llReserved, -(LONG64)block->dwSize);
+		_aligned_free(block);
+	}
+	else if (cache.dwCount[block->dwClass] < POOL_CACHESIZE)
+		cache.blocks[block->dwClass][cache.dwCount[block->dwClass]++] = block;
+	else
+		InterlockedPushEntrySList(&freeLists[block->dwClass], &block->entry);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PoolFlushThread
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PoolFlushThread()
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Returns the calling thread's cached buffers to the free lists. Call this before a thread that has used the pool
+-- exits.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID PoolFlushThread()
+{
+	DWORD i;
+
+	for (i = 0; i < POOL_CLASSES; i++)
+	{
+		while (cache.dwCount[i] != 0)
+			InterlockedPushEntrySList(&freeLists[i], &cache.blocks[i][--cache.dwCount[i]]->entry);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatPoolReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatPoolReport(CHAR *buf, size_t size)
+--							CHAR *buf:		The buffer to write the report section into.
+--							size_t size:	The space left in buf.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- The figures are for the whole run so far, not just this transfer, since the point of the pool is that later
+-- transfers reuse what earlier ones allocated.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatPoolReport(CHAR *buf, size_t size)
+{
+	LONG64	llAllocCount = llAllocs;
+	INT		written;
+
+	if (llAllocCount == 0)
+		return 0;
+
+	written = sprintf_s(buf, size,
+		"Buffer pool: %lld allocations, %.1f%% hit rate; peak %.1f KB in use, %.1f KB reserved (%ld slabs, %s)\r\n",
+		llAllocCount, 100.0 * llHits / llAllocCount, llPeakInUse / 1024.0, llPeakReserved / 1024.0, lSlabs,
+		bHugePages ? "large pages" : "normal pages");
+	if (dwPoolNode != NUMA_NO_PREFERRED_NODE)
+		written += sprintf_s(buf + written, size - written, "Buffer pool slabs on node %lu: %ld of %ld\r\n", dwPoolNode,
+			lNodeSlabs, lSlabs);
+	return written;
+}
@@ -0,0 +1,32 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <Windows.h>
+#include <malloc.h>
+#include <cstdio>
+#include <cstring>
+#include "Utils.h"
+
+#define POOL_CLASSES		6			// Number of size classes
+#define POOL_HDRSIZE		64			// Header in front of every buffer; keeps the buffers cache-line aligned
+#define POOL_SLABSIZE		(2 << 20)	// Bytes carved into buffers at a time (one large page on x86/x64)
+#define POOL_CACHESIZE		8			// Buffers of each class a thread keeps for itself
+#define POOL_LARGE			0xFFFFFFFF	// Class of a buffer too big for the pool, allocated on its own
+
+/* The header in front of every pool buffer. It's padded to POOL_HDRSIZE so the buffer after it is cache-line aligned,
+   and the SLIST_ENTRY must come first and be 16-byte aligned for the interlocked list functions. */
+typedef struct DECLSPEC_ALIGN(16) _PoolBlock
+{
+	SLIST_ENTRY		entry;		// Links the buffer into its class's free list
+	DWORD			dwClass;	// Size class, or POOL_LARGE
+	DWORD			dwSize;		// Usable size
+} PoolBlock, *LPPoolBlock;
+
+BOOL UsePoolHugePages();
+VOID SetPoolNode(DWORD dwNode);
+VOID *PoolAlloc(size_t size);
+VOID PoolFree(VOID *p);
+VOID PoolFlushThread();
+INT FormatPoolReport(CHAR *buf, size_t size);
+
+#endif
@@ -0,0 +1,843 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Sched.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitSchedState(LPSchedState s);
+-- VOID SchedJoin(LPSchedState s, SchedResume resume, VOID *ctx);
+-- BOOL SchedPace(LPSchedState s, DWORD dwBytes);
+-- VOID SchedLeave(LPSchedState s);
+-- VOID SchedTogglePause(LPTransferProps props);
+-- VOID SchedReweight(LPTransferProps props, BOOL bUp);
+-- BOOL StopTransfer(LPTransferProps props);
+-- INT FormatSchedReport(CHAR *buf, size_t size, LPSchedState s);
+-- static BOOL CALLBACK InitSchedOnce(PINIT_ONCE initOnce, VOID *param, VOID **context);
+-- static BOOL LockTable();
+-- static VOID UpdateSlot(LPSchedState s);
+-- static DWORD WorkOutShare(LPSchedState s, LPDWORD pdwPeers);
+-- static VOID EndHold(LPSchedState s);
+-- static VOID CALLBACK SchedTimer(LPVOID lpArg, DWORD dwTimerLow, DWORD dwTimerHigh);
+-- static BOOL HoldSend(LPSchedState s, DWORD dwBytes, DWORD dwMs);
+-- static VOID CALLBACK PauseApc(ULONG_PTR param);
+-- static DWORD NextWeight(DWORD dwWeight, BOOL bUp);
+-- static VOID Reweight(LPTransferProps props, BOOL bUp);
+-- static VOID CALLBACK WeightUpApc(ULONG_PTR param);
+-- static VOID CALLBACK WeightDownApc(ULONG_PTR param);
+-- static VOID CALLBACK StopApc(ULONG_PTR param);
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file paces the client's sends so that transfers sharing a host share its bandwidth by weight, instead of
+--			each sending as fast as it can. Each instance of the program runs one transfer at a time, so the
+--			transfers to be scheduled belong to different processes; they share a table in a named file mapping
+--			(SCHED_MAPPING, guarded by the SCHED_MUTEX mutex) with a slot for each transfer that's sending.
+--
+--			The limits form a two-level hierarchy. At the root is the host's limit (-hostcap; the last instance to
+--			set it wins), shared by weight (-weight) among the transfers that have sent in the last SCHED_IDLE_MS
+--			and aren't paused. Below it each transfer may have a limit of its own (-ratecap). A transfer whose limit
+--			is below its weighted share gets its limit, and what it leaves is shared by weight among the rest, so
+--			bandwidth isn't wasted on a transfer that can't use it. Without a host limit only a transfer's own
+--			limit applies. Each transfer works out its share again every SCHED_SHARE_MS, so a transfer that finishes
+--			or is paused gives its share to the others almost at once.
+--
+--			A transfer is paced with a token bucket filled at its share and holding at most SCHED_BURST_MS of it,
+--			which covers the coarseness of the Windows timer. A send the bucket can't cover is held back on a
+--			waitable timer, whose APC posts it once there are tokens for it; the completion routines never block.
+--
+--			In the main window, 'p' pauses and resumes the transfer, and '+' and '-' double and halve its weight,
+--			all while it runs. A paused transfer still sends one packet every SCHED_TRICKLE_MS so the server doesn't
+--			give up on it. Transfer > Stop Transfer ends the transfer early on either side, and it's reported with
+--			what had been sent or received by then.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Sched.h"
+
+static INIT_ONCE	initOnce	= INIT_ONCE_STATIC_INIT;
+static HANDLE		hMapping	= NULL;
+static HANDLE		hLock		= NULL;
+static LPSchedTable	table		= NULL;		// The host's table; NULL if it couldn't be opened
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitSchedState
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitSchedState(LPSchedState s)
+--							LPSchedState s:	The scheduler state to initialise.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitSchedState(LPSchedState s)
+{
+	memset(s, 0, sizeof(SchedState));
+	s->dwWeight		= SCHED_DEF_WEIGHT;
+	s->dwHostKbps	= SCHED_HOST_KEEP;
+	s->nSlot		= -1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitSchedOnce
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitSchedOnce(PINIT_ONCE initOnce, VOID *param, VOID **context)
+--
+-- RETURNS: TRUE.
+--
+-- NOTES:
+-- Opens the host's table, creating it if this is the first instance. A new mapping is zeroed: no host limit and every
+-- slot free. If it can't be opened, transfers are held only to their own limits.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL CALLBACK InitSchedOnce(PINIT_ONCE initOnce, VOID *param, VOID **context)
+{
+	if ((hLock = CreateMutex(NULL, FALSE, SCHED_MUTEX)) == NULL)
+		return TRUE;
+	if ((hMapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SchedTable),
+		SCHED_MAPPING)) == NULL)
+	{
+		CloseHandle(hLock);
+		return TRUE;
+	}
+	if ((table = (LPSchedTable)MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SchedTable))) == NULL)
+	{
+		CloseHandle(hMapping);
+		CloseHandle(hLock);
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LockTable
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LockTable()
+--
+-- RETURNS: FALSE if there's no table; TRUE once the caller holds it, in which case it must call ReleaseMutex(hLock).
+--
+-- NOTES:
+-- An instance that died holding the table leaves it abandoned but usable; at worst its slot is half written, and it
+-- goes stale like any other it leaves behind.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL LockTable()
+{
+	DWORD dwWait;
+
+	InitOnceExecuteOnce(&initOnce, InitSchedOnce, NULL, NULL);
+	if (table == NULL)
+		return FALSE;
+	dwWait = WaitForSingleObject(hLock, INFINITE);
+	return dwWait == WAIT_OBJECT_0 || dwWait == WAIT_ABANDONED;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: UpdateSlot
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: UpdateSlot(LPSchedState s)
+--							LPSchedState s:	The transfer whose weight or pause has changed.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called on the transfer's thread, from the APCs queued by the main window. The slot is only written if it's still this
+-- instance's, since the table is shared with the other instances.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID UpdateSlot(LPSchedState s)
+{
+	INT			nSlot = s->nSlot;
+	LPSchedSlot	slot;
+
+	if (nSlot < 0 || !LockTable())
+		return;
+	slot = &table->slots[nSlot];
+	if (slot->dwPid == GetCurrentProcessId())
+	{
+		slot->dwWeight	= s->dwWeight;
+		slot->bPaused	= s->bPaused;
+	}
+	ReleaseMutex(hLock);
+	s->dwShareTick = GetTickCount() - SCHED_SHARE_MS; // Worked out again at the next send
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: WorkOutShare
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: WorkOutShare(LPSchedState s, LPDWORD pdwPeers)
+--							LPSchedState s:		The transfer, which has a slot and isn't paused.
+--							LPDWORD pdwPeers:	Receives how many other transfers are sending.
+--
+-- RETURNS: The transfer's share in kbit/s, or 0 if it's unlimited.
+--
+-- NOTES:
+-- Called with the table locked. Shares the host's limit by weight, first giving each transfer whose own limit is below
+-- its weighted share its limit and taking it out of what's left to share, until every transfer left wants at least its
+-- share.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD WorkOutShare(LPSchedState s, LPDWORD pdwPeers)
+{
+	BOOL		settled[SCHED_MAXFLOWS];
+	DWORD		dwNow	= GetTickCount();
+	DWORD		dwLeft	= table->dwHostKbps;
+	ULONGLONG	qwWeights;
+	LPSchedSlot	slot;
+	BOOL		bSettled;
+	INT			i;
+
+	*pdwPeers = 0;
+	for (i = 0; i < SCHED_MAXFLOWS; i++)
+	{
+		slot = &table->slots[i];
+		settled[i] = slot->dwPid == 0 || slot->bPaused || (i != s->nSlot && dwNow - slot->dwLastTick >= SCHED_IDLE_MS);
+		if (!settled[i] && i != s->nSlot)
+			(*pdwPeers)++;
+	}
+	if (dwLeft == 0)
+		return s->dwCapKbps;
+
+	do
+	{
+		bSettled = FALSE;
+		qwWeights = 0;
+		for (i = 0; i < SCHED_MAXFLOWS; i++)
+			if (!settled[i])
+				qwWeights += max(table->slots[i].dwWeight, (DWORD)1);
+
+		for (i = 0; i < SCHED_MAXFLOWS && !bSettled; i++)
+		{
+			slot = &table->slots[i];
+			if (settled[i] || slot->dwCapKbps == 0 ||
+				(ULONGLONG)slot->dwCapKbps * qwWeights > (ULONGLONG)dwLeft * max(slot->dwWeight, (DWORD)1))
+				continue;
+			if (i == s->nSlot)
+				return slot->dwCapKbps;
+			settled[i] = TRUE;
+			dwLeft -= slot->dwCapKbps;
+			bSettled = TRUE;
+		}
+	} while (bSettled);
+
+	return max((DWORD)((ULONGLONG)dwLeft * max(s->dwWeight, (DWORD)1) / qwWeights), (DWORD)1);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SchedJoin
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SchedJoin(LPSchedState s, SchedResume resume, VOID *ctx)
+--							LPSchedState s:			The transfer's scheduler state.
+--							SchedResume resume:		Posts the send the scheduler held back.
+--							VOID *ctx:				Its parameter.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called on the transfer's thread before its first send. Sets the host's limit if -hostcap was given, and takes a free
+-- slot in the table, or the one left stale the longest. If the table is full the transfer is held only to its own
+-- limit.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID SchedJoin(LPSchedState s, SchedResume resume, VOID *ctx)
+{
+	DWORD		dwNow		= GetTickCount();
+	DWORD		dwStalest	= 0;
+	INT			nFree		= -1;
+	INT			i;
+	LPSchedSlot	slot;
+
+	s->resume			= resume;
+	s->ctx				= ctx;
+	s->nSlot			= -1;
+	s->dTokens			= 0;
+	s->liHeld.QuadPart	= 0;
+	s->dwLastSend		= dwNow;
+	s->dwShareKbps		= s->dwCapKbps;
+	s->dwShareTick		= dwNow - SCHED_SHARE_MS;
+	s->dwHeld			= 0;
+	s->qwHeldUs			= 0;
+	s->dwPauses			= s->bPaused ? 1 : 0;
+	s->dwPauseStart		= dwNow;
+	s->dwPausedMs		= 0;
+	s->dwReweights		= 0;
+	s->dwMinShareKbps	= 0;
+	s->dwMaxShareKbps	= 0;
+	s->dwPeers			= 0;
+	QueryPerformanceCounter(&s->liRefill);
+
+	if (s->hTimer == NULL && (s->hTimer = CreateWaitableTimer(NULL, TRUE, NULL)) == NULL)
+	{
+		s->bJoined = FALSE;
+		MessageBox(NULL, TEXT("Could not create the scheduler's timer; the transfer can't be paced or paused."),
+			TEXT("No Scheduler"), MB_ICONWARNING);
+		return;
+	}
+	s->bJoined = TRUE;
+
+	if (!LockTable())
+		return;
+	if (s->dwHostKbps != SCHED_HOST_KEEP)
+		table->dwHostKbps = s->dwHostKbps;
+	for (i = 0; i < SCHED_MAXFLOWS; i++)
+	{
+		slot = &table->slots[i];
+		if (slot->dwPid == 0)
+		{
+			nFree = i;
+			break;
+		}
+		if (dwNow - slot->dwLastTick >= SCHED_STALE_MS && dwNow - slot->dwLastTick >= dwStalest)
+		{
+			nFree = i;
+			dwStalest = dwNow - slot->dwLastTick;
+		}
+	}
+	if (nFree >= 0)
+	{
+		slot = &table->slots[nFree];
+		slot->dwPid			= GetCurrentProcessId();
+		slot->dwWeight		= s->dwWeight;
+		slot->dwCapKbps		= s->dwCapKbps;
+		slot->bPaused		= s->bPaused;
+		slot->dwLastTick	= dwNow;
+		s->nSlot = nFree;
+	}
+	ReleaseMutex(hLock);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: EndHold
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: EndHold(LPSchedState s)
+--							LPSchedState s:	The transfer's scheduler state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Adds the time the send just let go was held back to the report.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID EndHold(LPSchedState s)
+{
+	if (s->liHeld.QuadPart == 0)
+		return;
+	s->qwHeldUs += ElapsedUs(&s->liHeld);
+	s->liHeld.QuadPart = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SchedTimer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SchedTimer(LPVOID lpArg, DWORD dwTimerLow, DWORD dwTimerHigh)
+--							LPVOID lpArg:		The transfer's scheduler state.
+--							DWORD dwTimerLow:	Not used.
+--							DWORD dwTimerHigh:	Not used.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Runs as an APC on the transfer's thread once a held send may have tokens for it. Posts it if it does; otherwise it's
+-- held back again (the transfer may have been paused or its share cut in the meantime).
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID CALLBACK SchedTimer(LPVOID lpArg, DWORD dwTimerLow, DWORD dwTimerHigh)
+{
+	LPSchedState s = (LPSchedState)lpArg;
+
+	if (s->bStopped || s->liHeld.QuadPart == 0)
+		return;
+	if (!SchedPace(s, s->dwPending))
+		s->resume(s->ctx);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: HoldSend
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: HoldSend(LPSchedState s, DWORD dwBytes, DWORD dwMs)
+--							LPSchedState s:	The transfer's scheduler state.
+--							DWORD dwBytes:	The size of the send.
+--							DWORD dwMs:		How long to hold it back.
+--
+-- RETURNS: FALSE if the timer couldn't be set, and the send should go now; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL HoldSend(LPSchedState s, DWORD dwBytes, DWORD dwMs)
+{
+	LARGE_INTEGER liDue;
+
+	liDue.QuadPart = -(LONGLONG)dwMs * 10000;
+	if (!SetWaitableTimer(s->hTimer, &liDue, 0, SchedTimer, s, FALSE))
+	{
+		EndHold(s);
+		return FALSE;
+	}
+	if (s->liHeld.QuadPart == 0)
+	{
+		QueryPerformanceCounter(&s->liHeld);
+		s->dwHeld++;
+	}
+	s->dwPending = dwBytes;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SchedPace
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SchedPace(LPSchedState s, DWORD dwBytes)
+--							LPSchedState s:	The transfer's scheduler state.
+--							DWORD dwBytes:	The size of the send about to be posted.
+--
+-- RETURNS: TRUE if the send has been held back, in which case the scheduler posts it through the resume callback
+--			given to SchedJoin; FALSE if it should be posted now.
+--
+-- NOTES:
+-- Called from the send completion routines before each send is posted.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SchedPace(LPSchedState s, DWORD dwBytes)
+{
+	DWORD	dwNow = GetTickCount();
+	DWORD	dwPeers, dwUs, dwMs;
+	double	dBurst;
+
+	if (!s->bJoined || s->bStopped)
+		return FALSE;
+
+	if (s->bPaused)
+	{
+		if (dwNow - s->dwLastSend < SCHED_TRICKLE_MS && HoldSend(s, dwBytes, SCHED_POLL_MS))
+			return TRUE;
+
+		// The trickle keeps the slot from going stale, and the pause doesn't bank a burst for when it ends
+		if (s->nSlot >= 0 && LockTable())
+		{
+			table->slots[s->nSlot].dwLastTick = dwNow;
+			ReleaseMutex(hLock);
+		}
+		EndHold(s);
+		s->dTokens = 0;
+		QueryPerformanceCounter(&s->liRefill);
+		s->dwLastSend = dwNow;
+		return FALSE;
+	}
+
+	if (s->nSlot >= 0 && dwNow - s->dwShareTick >= SCHED_SHARE_MS && LockTable())
+	{
+		table->slots[s->nSlot].dwLastTick = dwNow;
+		s->dwShareKbps = WorkOutShare(s, &dwPeers);
+		ReleaseMutex(hLock);
+		s->dwShareTick = dwNow;
+		s->dwPeers = max(s->dwPeers, dwPeers);
+		if (s->dwShareKbps != 0)
+		{
+			s->dwMinShareKbps = s->dwMinShareKbps == 0 ? s->dwShareKbps : min(s->dwMinShareKbps, s->dwShareKbps);
+			s->dwMaxShareKbps = max(s->dwMaxShareKbps, s->dwShareKbps);
+		}
+	}
+
+	if (s->dwShareKbps != 0)
+	{
+		// kbit/s is bits per millisecond, or kbps / 8000 bytes per microsecond
+		dwUs = ElapsedUs(&s->liRefill);
+		QueryPerformanceCounter(&s->liRefill);
+		dBurst = max((double)s->dwShareKbps * SCHED_BURST_MS / 8, (double)dwBytes);
+		s->dTokens = min(s->dTokens + (double)dwUs * s->dwShareKbps / 8000, dBurst);
+		if (s->dTokens < dwBytes)
+		{
+			dwMs = (DWORD)ceil((dwBytes - s->dTokens) * 8 / s->dwShareKbps);
+			if (HoldSend(s, dwBytes, max(dwMs, (DWORD)1)))
+				return TRUE;
+			s->dTokens = dwBytes;
+		}
+		s->dTokens -= dwBytes;
+	}
+
+	EndHold(s);
+	s->dwLastSend = dwNow;
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SchedLeave
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SchedLeave(LPSchedState s)
+--							LPSchedState s:	The transfer's scheduler state.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called on the transfer's thread once it's over. Drops any send still held back and frees the transfer's slot.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID SchedLeave(LPSchedState s)
+{
+	if (s->hTimer != NULL)
+	{
+		CancelWaitableTimer(s->hTimer);
+		CloseHandle(s->hTimer);
+		s->hTimer = NULL;
+	}
+	s->liHeld.QuadPart = 0;
+
+	if (s->nSlot >= 0 && LockTable())
+	{
+		if (table->slots[s->nSlot].dwPid == GetCurrentProcessId())
+			memset(&table->slots[s->nSlot], 0, sizeof(SchedSlot));
+		ReleaseMutex(hLock);
+	}
+	s->nSlot	= -1;
+	s->bJoined	= FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PauseApc
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PauseApc(ULONG_PTR param)
+--							ULONG_PTR param:	The transfer's properties.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Runs on the transfer's thread, so the pause counts can't be reset by SchedJoin while they're being updated. If the
+-- transfer it was meant for has already finished, the pause is kept for the next one, as it is between transfers.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID CALLBACK PauseApc(ULONG_PTR param)
+{
+	LPTransferProps props	= (LPTransferProps)param;
+	LPSchedState	s		= &props->sched;
+	DWORD			dwNow	= GetTickCount();
+
+	if (props->worker.dwJob != s->dwKeyJob || props->worker.dwThreadId != GetCurrentThreadId())
+	{
+		InterlockedExchange((volatile LONG *)&s->bPaused, !s->bPaused);
+		return;
+	}
+
+	if (!s->bPaused)
+	{
+		s->dwPauses++;
+		s->dwPauseStart = dwNow;
+	}
+	else
+		s->dwPausedMs += dwNow - s->dwPauseStart;
+	s->bPaused = !s->bPaused;
+	UpdateSlot(s);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SchedTogglePause
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SchedTogglePause(LPTransferProps props)
+--							LPTransferProps props:	The window's transfer properties.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called from the main window's thread ('p'). A running transfer is paused or resumed on its own thread (see PauseApc)
+-- and notices within SCHED_POLL_MS of being resumed; a transfer paused before it begins starts paused.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID SchedTogglePause(LPTransferProps props)
+{
+	props->sched.dwKeyJob = props->worker.dwJob;
+	if (!SignalTransfer(&props->worker, PauseApc, (ULONG_PTR)props))
+		InterlockedExchange((volatile LONG *)&props->sched.bPaused, !props->sched.bPaused);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NextWeight
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NextWeight(DWORD dwWeight, BOOL bUp)
+--							DWORD dwWeight:	The current weight.
+--							BOOL bUp:		Whether to double it ('+') or halve it ('-').
+--
+-- RETURNS: The new weight, between 1 and SCHED_MAX_WEIGHT.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD NextWeight(DWORD dwWeight, BOOL bUp)
+{
+	return bUp ? min(dwWeight * 2, (DWORD)SCHED_MAX_WEIGHT) : max(dwWeight / 2, (DWORD)1);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Reweight
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Reweight(LPTransferProps props, BOOL bUp)
+--							LPTransferProps props:	The transfer's properties.
+--							BOOL bUp:				Whether to double the weight or halve it.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Runs on the transfer's thread, from WeightUpApc and WeightDownApc. If the transfer it was meant for has already
+-- finished, the weight is kept for the next one, as it is between transfers.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID Reweight(LPTransferProps props, BOOL bUp)
+{
+	LPSchedState s = &props->sched;
+
+	if (props->worker.dwJob != s->dwKeyJob || props->worker.dwThreadId != GetCurrentThreadId())
+	{
+		InterlockedExchange((volatile LONG *)&s->dwWeight, (LONG)NextWeight(s->dwWeight, bUp));
+		return;
+	}
+
+	s->dwWeight = NextWeight(s->dwWeight, bUp);
+	s->dwReweights++;
+	UpdateSlot(s);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: WeightUpApc
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: WeightUpApc(ULONG_PTR param)
+--							ULONG_PTR param:	The transfer's properties.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID CALLBACK WeightUpApc(ULONG_PTR param)
+{
+	Reweight((LPTransferProps)param, TRUE);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: WeightDownApc
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: WeightDownApc(ULONG_PTR param)
+--							ULONG_PTR param:	The transfer's properties.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID CALLBACK WeightDownApc(ULONG_PTR param)
+{
+	Reweight((LPTransferProps)param, FALSE);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SchedReweight
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SchedReweight(LPTransferProps props, BOOL bUp)
+--							LPTransferProps props:	The window's transfer properties.
+--							BOOL bUp:				Whether to double the weight ('+') or halve it ('-').
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Called from the main window's thread. A running transfer is reweighted on its own thread, and every transfer on the
+-- host picks up the new weight within SCHED_SHARE_MS. Between transfers the weight is just kept for the next one.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID SchedReweight(LPTransferProps props, BOOL bUp)
+{
+	props->sched.dwKeyJob = props->worker.dwJob;
+	if (!SignalTransfer(&props->worker, bUp ? WeightUpApc : WeightDownApc, (ULONG_PTR)props))
+		InterlockedExchange((volatile LONG *)&props->sched.dwWeight, (LONG)NextWeight(props->sched.dwWeight, bUp));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StopApc
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StopApc(ULONG_PTR param)
+--							ULONG_PTR param:	The transfer's properties.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Runs on the transfer's thread. Ends its wait for completions and cancels the I/O it has outstanding, whose
+-- completion routines see WSA_OPERATION_ABORTED and post nothing more. Does nothing if the transfer it was meant for
+-- has already finished.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID CALLBACK StopApc(ULONG_PTR param)
+{
+	LPTransferProps props = (LPTransferProps)param;
+
+	if (props->worker.dwJob != props->sched.dwStopJob || props->worker.dwThreadId != GetCurrentThreadId())
+		return;
+
+	props->sched.bStopped = TRUE;
+	if (props->sched.hTimer != NULL)
+		CancelWaitableTimer(props->sched.hTimer);
+	if (props->dwTimeout != 0 && props->startTime.wYear != 0)
+		GetSystemTime(&props->endTime);
+	props->dwTimeout = 0;
+	CancelIo((HANDLE)props->socket);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StopTransfer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StopTransfer(LPTransferProps props)
+--							LPTransferProps props:	The window's transfer properties.
+--
+-- RETURNS: FALSE if no transfer is running; TRUE otherwise.
+--
+-- NOTES:
+-- Called from the main window's thread (Transfer > Stop Transfer). The transfer is stopped on its own thread, the next
+-- time it waits for a completion.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL StopTransfer(LPTransferProps props)
+{
+	props->sched.dwStopJob = props->worker.dwJob;
+	return SignalTransfer(&props->worker, StopApc, (ULONG_PTR)props);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatSchedReport
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatSchedReport(CHAR *buf, size_t size, LPSchedState s)
+--							CHAR *buf:			The buffer to write the report section into.
+--							size_t size:		The space left in buf.
+--							LPSchedState s:		What the scheduler did to the transfer.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- Only transfers that were stopped, or that had a limit, a pause or a change of weight, have anything to report.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatSchedReport(CHAR *buf, size_t size, LPSchedState s)
+{
+	INT		written		= 0;
+	DWORD	dwHostKbps	= table != NULL ? table->dwHostKbps : 0;
+	DWORD	dwPausedMs	= s->dwPausedMs + (s->bPaused ? GetTickCount() - s->dwPauseStart : 0);
+
+	if (s->bStopped)
+		written += sprintf_s(buf, size, "Stopped by the user before the end of the transfer\r\n");
+	if (!s->bJoined || (s->dwCapKbps == 0 && dwHostKbps == 0 && s->dwPauses == 0 && s->dwReweights == 0))
+		return written;
+
+	written += sprintf_s(buf + written, size - written, "Scheduler: weight %lu", s->dwWeight);
+	if (s->dwReweights != 0)
+		written += sprintf_s(buf + written, size - written, " (changed %lu times)", s->dwReweights);
+	if (s->dwCapKbps != 0)
+		written += sprintf_s(buf + written, size - written, ", own limit %.1f Mbit/s", s->dwCapKbps / 1000.0);
+	if (dwHostKbps != 0)
+		written += sprintf_s(buf + written, size - written, ", host limit %.1f Mbit/s", dwHostKbps / 1000.0);
+	if (s->nSlot < 0 && dwHostKbps != 0)
+		written += sprintf_s(buf + written, size - written, " (not applied: the host's table was full)");
+	written += sprintf_s(buf + written, size - written, "\r\n");
+
+	if (s->dwMaxShareKbps != 0)
+		written += sprintf_s(buf + written, size - written,
+			"Scheduler: share %.1f to %.1f Mbit/s, alongside at most %lu other transfers\r\n",
+			s->dwMinShareKbps / 1000.0, s->dwMaxShareKbps / 1000.0, s->dwPeers);
+	written += sprintf_s(buf + written, size - written, "Scheduler: %lu sends held back for %.1fms in all",
+		s->dwHeld, s->qwHeldUs / 1000.0);
+	if (s->dwPauses != 0)
+		written += sprintf_s(buf + written, size - written, "; paused %lu times for %.1fs", s->dwPauses,
+			dwPausedMs / 1000.0);
+	written += sprintf_s(buf + written, size - written, "\r\n");
+	return written;
+}
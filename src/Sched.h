@@ -0,0 +1,53 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Connect.h"
+#include "Workers.h"
+
+#define SCHED_MAXFLOWS		32			// Transfers the host's table has room for
+#define SCHED_DEF_WEIGHT	100
+#define SCHED_MAX_WEIGHT	10000
+#define SCHED_HOST_KEEP		0xFFFFFFFF	// -hostcap wasn't given; the host's limit is left as it is
+#define SCHED_BURST_MS		20			// A transfer may catch up on this much of its share at once
+#define SCHED_SHARE_MS		10			// How often a transfer works its share out again
+#define SCHED_IDLE_MS		200			// A transfer that hasn't sent for this long isn't counted when shares are worked out
+#define SCHED_STALE_MS		3000		// And its slot may be taken after this long (its program may have died)
+#define SCHED_POLL_MS		50			// How often a paused transfer checks whether it's been resumed
+#define SCHED_TRICKLE_MS	1000		// A paused transfer still sends this often, so its receiver doesn't time out
+#define SCHED_MAPPING		TEXT("Local\\Assn2Sched")
+#define SCHED_MUTEX			TEXT("Local\\Assn2SchedLock")
+
+/* A transfer's entry in the table every instance on the host shares. */
+typedef struct _SchedSlot
+{
+	DWORD		dwPid;			// The program sending (0: the slot is free)
+	DWORD		dwWeight;
+	DWORD		dwCapKbps;		// Its own limit (0: none)
+	BOOL		bPaused;
+	DWORD		dwLastTick;		// GetTickCount when it last sent
+} SchedSlot, *LPSchedSlot;
+
+/* The root of the hierarchy: the host's limit, shared by weight among the transfers below it. */
+typedef struct _SchedTable
+{
+	DWORD		dwHostKbps;		// 0: none
+	SchedSlot	slots[SCHED_MAXFLOWS];
+} SchedTable, *LPSchedTable;
+
+VOID InitSchedState(LPSchedState s);
+VOID SchedJoin(LPSchedState s, SchedResume resume, VOID *ctx);
+BOOL SchedPace(LPSchedState s, DWORD dwBytes);
+VOID SchedLeave(LPSchedState s);
+VOID SchedTogglePause(LPTransferProps props);
+VOID SchedReweight(LPTransferProps props, BOOL bUp);
+BOOL StopTransfer(LPTransferProps props);
+INT FormatSchedReport(CHAR *buf, size_t size, LPSchedState s);
+
+#endif
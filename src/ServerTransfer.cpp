@@ -9,6 +9,13 @@
 -- VOID ServerCleanup(LPTransferProps props);
 -- BOOL ListenTCP(LPTransferProps props);
 -- BOOL ListenUDP(LPTransferProps props);
+-- BOOL ProcessChunk(LPChunkHeader hdr, LPTransferProps props);
+-- BOOL ResumeReply(LPTransferProps props);
+-- BOOL NextSessionTransfer(LPTransferProps props);
+-- static BOOL OpenDestination(LPTransferProps props);
+-- static VOID ResetReceive(LPTransferProps props);
+-- static BOOL CopyChunk(LPChunkHeader hdr, LPTransferProps props);
+-- static VOID CheckTestStream(LPTransferProps props, BYTE *data, DWORD dwLen);
 -- 
 -- VOID CALLBACK UDPRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
 --		LPOVERLAPPED lpOverlapped, DWORD dwFlags);
@@ -24,15 +31,43 @@
 -- NOTES:	Functions in this file compose the server side of the program. Serve is the server thread, ServerInitSocket
 --			initialises a server socket, and ServerCleanup resets the transfer state variables to their defaults. The two
 --			Listen functions handle incoming connections for TCP and UDP. The two callback functions are completion 
---			routines called by Windows when the server receives data.
+--			routines called by Windows when the server receives data. When receiving a file, ProcessChunk writes
+--			each chunk the client sends (see Chunk.cpp) at its offset in the destination file. Over TCP, ResumeReply
+--			first tells the client which chunks are left from an earlier attempt (see Manifest.cpp), or sends the
+--			signatures of the existing file for a delta transfer (see Delta.cpp), whose CHUNK_COPYs CopyChunk applies.
+--			For a dedup transfer it writes the chunks the client offers that are in its chunk store, asks for the
+--			rest, and adds those to the store as they arrive (see Dedup.cpp).
+--			When the destination is a directory, the chunks are handed to the multi-file receiver (see Batch.cpp).
+--			In session mode the connection and listener are kept, and NextSessionTransfer starts each transfer that
+--			arrives until the session goes idle (see Session.cpp). The server listens on IPv6 and IPv4 at once, and notes
+--			each client's address and its time to first byte for the report (see Connect.cpp). Test packets are checked
+--			against the client's generator as they arrive (see Payload.cpp). The client marks the end of its data and
+--			the server answers with what it received, so a lossy UDP transfer ends without waiting out the timeout
+--			(see Control.cpp). Before a UDP transfer the server echoes the client's path MTU probes (see Pmtu.cpp). A
+--			duplex client's packets ask the server to send test packets back while it receives (see Duplex.cpp).
+--			With -multicast the server joins a group and receives alongside the group's other members, dropping
+--			repeated datagrams and NACKing the ones it missed once the sender marks the end (see Multicast.cpp).
+--			With -psk the client's key exchange is answered before the data, and each chunk or test packet is
+--			authenticated and decrypted as it arrives (see Crypt.cpp). With -trace the receives, their completions and
+--			the file writes are recorded, and written out as a timeline before each transfer is reported (see
+--			Trace.cpp). With -capture the size and arrival time of each datagram or receive are recorded, for a
+--			client to replay with -replay (see Capture.cpp).
 -------------------------------------------------------------------------------------------------------------------------*/
 
 #include "ServerTransfer.h"
 
 // "Global" variables (used only in this file)
-static DWORD	recvd	= 0;	// The number of bytes or packets received
+static ULONGLONG	recvd	= 0;	// The number of bytes or packets received
 static WSABUF	wsaBuf;			// A buffer to contain the received data
-static HANDLE	destFile;		// A file to store the transferred data (if specified by the user)
+static HANDLE	destFile = INVALID_HANDLE_VALUE;	// A file to store the transferred data (if specified by the user)
+static ChunkReader	reader;		// Reassembles file chunks from the TCP stream
+static BYTE		*decodeBuf;		// Holds a decompressed chunk
+static Manifest	manifest;		// The chunks of the destination file that have been written (TCP only)
+static BatchSink	sink;		// Recreates the files of a directory or multi-file transfer (TCP only)
+static DedupOffer	offered;	// The chunks a dedup transfer's client offered (TCP only)
+static DedupStore	store;		// The chunks kept from earlier transfers, while a dedup transfer is open
+static SOCKADDR_STORAGE	client;	// Where the last UDP packet came from; it must outlive each WSARecvFrom
+static INT		client_size;
 
 /*-------------------------------------------------------------------------------------------------------------------------
 -- FUNCTION: ServerInitSocket
@@ -51,16 +86,38 @@ static HANDLE	destFile;		// A file to store the transferred data (if specified b
 -- NOTES:
 -- Preps a socket for receiving. This will socket will listen for packets (TCP) or receive the initial packet (UDP) when
 -- the server is listening. The socket is created and bound here. The function also prevents the user from creating another
--- listening thread (it will return an error message if the address is already bound).
+-- listening thread (it will return an error message if the address is already bound). The socket is dual-stack so
+-- clients can reach it over IPv4 or IPv6; where IPv6 isn't available it's an IPv4 socket. A UDP socket given a
+-- multicast group joins it, and shares its port so several receivers can run on one host.
 ---------------------------------------------------------------------------------------------------------------------------*/
 BOOL ServerInitSocket(LPTransferProps props)
 {
-	SOCKET s = WSASocket(AF_INET, props->nSockType, 0, NULL, NULL, WSA_FLAG_OVERLAPPED);
-	BOOL set = TRUE;
+	SOCKADDR_STORAGE	local;
+	INT					nLocalLen;
+	DWORD				dwV6Only = 0;
+	DWORD				dwReuse = 1;
+	SOCKET				s = WSASocket(AF_INET6, props->nSockType, 0, NULL, NULL, WSA_FLAG_OVERLAPPED);
 	props->nPacketSize = 0;
 	props->nNumToSend = 0;
 
-	props->paddr_in->sin_addr.s_addr = htonl(INADDR_ANY);
+	memset(&local, 0, sizeof(local));
+	if (s != INVALID_SOCKET &&
+		setsockopt(s, IPPROTO_IPV6, IPV6_V6ONLY, (CHAR *)&dwV6Only, sizeof(dwV6Only)) != SOCKET_ERROR)
+	{
+		((LPSOCKADDR_IN6)&local)->sin6_family = AF_INET6;
+		((LPSOCKADDR_IN6)&local)->sin6_addr = in6addr_any;
+		nLocalLen = sizeof(SOCKADDR_IN6);
+	}
+	else
+	{
+		if (s != INVALID_SOCKET)
+			closesocket(s);
+		s = WSASocket(AF_INET, props->nSockType, 0, NULL, NULL, WSA_FLAG_OVERLAPPED);
+		((LPSOCKADDR_IN)&local)->sin_family = AF_INET;
+		((LPSOCKADDR_IN)&local)->sin_addr.s_addr = htonl(INADDR_ANY);
+		nLocalLen = sizeof(SOCKADDR_IN);
+	}
+	SetAddressPort(&local, props->usPort);
 
 	if (s == INVALID_SOCKET)
 	{
@@ -68,15 +125,76 @@ BOOL ServerInitSocket(LPTransferProps props)
 		return FALSE;
 	}
 
-	if (bind(s, (sockaddr *)props->paddr_in, sizeof(sockaddr)) == SOCKET_ERROR)
+	ApplySocketTuning(s, &props->tuning, props->nSockType);
+	if (props->nSockType == SOCK_DGRAM && props->multicast.bJoin)
+		setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (CHAR *)&dwReuse, sizeof(dwReuse));
+
+	if (bind(s, (sockaddr *)&local, nLocalLen) == SOCKET_ERROR)
 	{
 		MessageBoxPrintf(MB_ICONERROR, TEXT("bind Failed"), TEXT("Could not bind socket, error %d"), WSAGetLastError());
 		return FALSE;
 	}
+	if (props->nSockType == SOCK_DGRAM && props->multicast.bJoin && !JoinMulticastGroup(s, &props->multicast))
+	{
+		closesocket(s);
+		return FALSE;
+	}
 	props->socket = s;
 	return TRUE;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: OpenDestination
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: OpenDestination(LPTransferProps props)
+--							LPTransferProps props:  Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the destination can't be opened or the buffers can't be allocated; TRUE otherwise.
+--
+-- NOTES:
+-- Opens the file being received (if any) and resets the file transfer counters. A directory isn't opened; the files
+-- are created in it once the client has listed them.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL OpenDestination(LPTransferProps props)
+{
+	memset(&props->batch, 0, sizeof(BatchState));
+	if (props->szFileName[0] == 0)
+		return TRUE;
+
+	if (IsDirectoryPath(props->szFileName))
+	{
+		if (props->nSockType != SOCK_STREAM)
+		{
+			MessageBox(NULL, TEXT("Files can only be received into a directory over TCP."), TEXT("Can't Receive Files"),
+				MB_ICONERROR);
+			return FALSE;
+		}
+	}
+	else if ((destFile = CreateFile(props->szFileName, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, 0, NULL)) ==
+		INVALID_HANDLE_VALUE)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("CreateFile Failed"), TEXT("CreateFile failed with error %d"), GetLastError());
+		return FALSE;
+	}
+
+	decodeBuf = (BYTE *)PoolAlloc(CHUNK_MAXPAYLOAD);
+	if (decodeBuf == NULL || !InitChunkReader(&reader))
+	{
+		MessageBox(NULL, TEXT("Couldn't allocate the chunk buffers."), TEXT("No Memory Allocated"), MB_ICONERROR);
+		return FALSE;
+	}
+	InitCompressState(&props->compress, props->tuning.dwLinkMbps);
+	InitIntegrityState(&props->integrity);
+	InitDeltaState(&props->delta);
+	InitDedupState(&props->dedup);
+	return TRUE;
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------
 -- FUNCTION: Serve
 -- Febrary 6th, 2014
@@ -94,27 +212,30 @@ BOOL ServerInitSocket(LPTransferProps props)
 -- NOTES:
 -- Listens for incoming connection requests/packets. Once a connection has been established or a packet received, the
 -- thread continues to receive the packets until there are no more to receive (UDP) or the client sends FIN, ACK (TCP).
+-- In session mode the thread goes on to serve transfer after transfer until the session has been idle for its timeout.
+-- Transfer > Stop Transfer ends the transfer where it is, and the session with it (see Sched.cpp).
+-- With -busypoll the thread spins on its receives rather than sleeping between them (see BusyPoll.cpp).
 ---------------------------------------------------------------------------------------------------------------------------*/
 DWORD WINAPI Serve(VOID *hwnd)
 {
-	BOOL			set		= TRUE;
 	DWORD			flags	= 0;
 	LPTransferProps props	= (LPTransferProps)GetWindowLongPtr((HWND)hwnd, GWLP_TRANSFERPROPS);
 	DWORD			dwSleepRet;
-	SOCKADDR_IN		client;
-	char			buf[UDP_MAXPACKET];
+	BOOL			bSession = props->session.bEnabled && props->nSockType == SOCK_STREAM;
 
-	wsaBuf.buf = buf;
+	if ((wsaBuf.buf = (CHAR *)PoolAlloc(UDP_MAXPACKET)) == NULL)
+	{
+		MessageBox(NULL, TEXT("Couldn't allocate the receive buffer."), TEXT("No Memory Allocated"), MB_ICONERROR);
+		return -1;
+	}
 	wsaBuf.len = UDP_MAXPACKET;
+	BeginPolling(props);
 
-	if (props->szFileName[0])
+	// A session opens the destination as each transfer arrives (see NextSessionTransfer)
+	if (!bSession && !OpenDestination(props))
 	{
-		destFile = CreateFile(props->szFileName, GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, 0, NULL);
-		if (destFile == INVALID_HANDLE_VALUE)
-		{
-			MessageBoxPrintf(MB_ICONERROR, TEXT("CreateFile Failed"), TEXT("CreateFile failed with error %d"), GetLastError());
-			return -1;
-		}
+		ServerCleanup(props);
+		return -1;
 	}
 
 	if (props->nSockType == SOCK_STREAM && !ListenTCP(props))
@@ -122,21 +243,54 @@ DWORD WINAPI Serve(VOID *hwnd)
 		ServerCleanup(props);
 		return 1;
 	}
-	else if (props->nSockType == SOCK_DGRAM && !ListenUDP(props, &client))
+	else if (props->nSockType == SOCK_DGRAM && !ListenUDP(props))
 	{
 		ServerCleanup(props);
 		return 2;
 	}
 
-	while (props->dwTimeout)
+	do
 	{
-		dwSleepRet = SleepEx(props->dwTimeout, TRUE);
-		if (dwSleepRet != WAIT_IO_COMPLETION)
-			break; // We've lost some packets; just exit the loop
-	}
+		StartCapture(&props->capture, props->nSockType);
+		while (props->dwTimeout)
+		{
+			dwSleepRet = WaitForTransfer(props, props->dwTimeout);
+			if (dwSleepRet != WAIT_IO_COMPLETION)
+				break; // We've lost some packets; just exit the loop
+		}
+		FinishDuplex(&props->duplex);
 
-	if (props->szFileName[0] == 0)
+		// Acknowledge the transfer before the report goes up so the client isn't left waiting on it. A transfer
+		// stopped here isn't acknowledged; the client finds out when the connection closes under it.
+		if (props->sched.bStopped)
+			;
+		else if (props->nSockType == SOCK_STREAM && !bSession)
+			AnswerEndOfStream(props->socket, NULL, 0, props, recvd);
+		else if (bSession)
+		{
+			if (!SendSessionAck(props->socket, &props->session, recvd))
+			{
+				closesocket(props->socket);
+				props->socket = INVALID_SOCKET;
+			}
+			EndSessionTransfer(&props->session, recvd, props->tuning.dwRttUs);
+		}
+
+		// Keep the checkpoint if the transfer was cut off; otherwise it's served its purpose
+		if (manifest.bitmap != NULL)
+		{
+			if (props->integrity.dwResult == INTEGRITY_UNKNOWN)
+				SaveManifest(&manifest, destFile);
+			else
+				DeleteManifest(&manifest);
+		}
+
+		StopPollStats(&props->poll);
+		StopCoreSample(&props->affinity);
+		ExportTrace(&props->trace);
+		EndCapture(&props->capture);
 		LogTransferInfo("ReceiveLog.txt", props, recvd, (HWND)hwnd);
+	} while (bSession && !props->sched.bStopped && NextSessionTransfer(props));
 
 	ServerCleanup(props);
 	return 0;
@@ -161,48 +315,224 @@ DWORD WINAPI Serve(VOID *hwnd)
 --
 -- NOTES:
 -- Windows calls this function whenever a UDP packet is received. It increments the number of packets received and posts another
--- WSARecvFrom. If there are no packets left to receive, it obtains the end time and returns. If there is an error, it displays
--- the appropriate error message and returns.
+-- WSARecvFrom. Path MTU probes and the key exchange, which come before the data, are answered and not counted. With
+-- -psk each datagram is opened (or dropped) before anything else looks at it. Once the client's end-of-stream marker arrives, or there are no packets left to receive, the data is over
+-- and the server stays only long enough to answer the client's markers. A multicast receiver drops repeats, and answers
+-- the sender's end markers with NACKs or its totals (see Multicast.cpp). If there is an error, it displays the
+-- appropriate error message and returns.
 ---------------------------------------------------------------------------------------------------------------------------*/
 VOID CALLBACK UDPRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
 	LPOVERLAPPED lpOverlapped, DWORD dwFlags)
 {
 	LPTransferProps props = (LPTransferProps)lpOverlapped;
-	static BOOL		useFile = props->szFileName[0] != 0;
+	LPControlState	control = &props->control;
+	BOOL			useFile = props->szFileName[0] != 0;
+	LPChunkHeader	hdr;
 	DWORD flags = 0;
-	SOCKADDR_IN client;
-	INT client_size = sizeof(client);
 
+	TraceEvent(TRACE_RECV_DONE, dwNumberOfBytesTransfered, wsaBuf.buf);
+
+	// The socket was closed under it at the end of the transfer; there's nothing to report
+	if (dwErrorCode == WSA_OPERATION_ABORTED)
+		return;
+	NoteCompletion(&props->poll);
 	if (dwErrorCode != 0)
 	{
 		MessageBoxPrintf(MB_ICONERROR, TEXT("UDP Recv Error"), TEXT("Error receiving UDP packet; error code %d"), dwErrorCode);
 		props->dwTimeout = 0;
 		return;
 	}
-	recvd += dwNumberOfBytesTransfered;
 
-	props->nNumToSend = ((DWORD *)wsaBuf.buf)[0];
-	props->nPacketSize = dwNumberOfBytesTransfered;
-	GetSystemTime(&props->endTime);
+	// The client probing the path MTU before it starts; just echo the size back
+	if (IsPmtuProbe((BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered))
+	{
+		AnswerPmtuProbe(props->socket, &client, client_size, (BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered);
+		props->pmtu.dwAnswered++;
+		client_size = sizeof(client);
+		WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)&client, &client_size, (LPOVERLAPPED)props,
+			PollPost(props, UDPRecvCompletion));
+		return;
+	}
 
-	if (useFile)
-		WriteFile(destFile, (VOID *)wsaBuf.buf, dwNumberOfBytesTransfered, &dwNumberOfBytesTransfered, NULL);
-	
-	// Finished receiving
-	if (!useFile && recvd/dwNumberOfBytesTransfered == props->nNumToSend)
+	// The client's key exchange, which also comes before the data
+	if (IsCryptHello((BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered))
 	{
-		props->dwTimeout = 0;
+		AnswerCryptHello(props, &client, client_size, (BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered);
+		client_size = sizeof(client);
+		WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)&client, &client_size, (LPOVERLAPPED)props,
+			PollPost(props, UDPRecvCompletion));
+		return;
+	}
+
+	// A multicast sender's end marker asks for what this receiver is missing, or its totals once it has everything
+	if (props->multicast.bJoin && IsMulticastEnd((BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered))
+	{
+		HandleMulticastEnd(props, (BYTE *)wsaBuf.buf, &client, client_size, recvd);
+		client_size = sizeof(client);
+		WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)&client, &client_size, (LPOVERLAPPED)props,
+			PollPost(props, UDPRecvCompletion));
 		return;
 	}
 
+	// The client's end-of-stream marker; one that comes before any data is left over from an earlier transfer
+	if (IsControlMsg((BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered, CONTROL_EOS_MAGIC))
+	{
+		if (props->dwTimeout != INFINITE)
+		{
+			if (control->dwEnd == CONTROL_END_TIMEOUT)
+				control->dwEnd = CONTROL_END_MARKER;
+			control->dwTransferId		= ((LPControlMsg)wsaBuf.buf)->dwTransferId;
+			control->qwPeerBytes		= ((LPControlMsg)wsaBuf.buf)->qwBytes;
+			control->dwPeerDatagrams	= ((LPControlMsg)wsaBuf.buf)->dwDatagrams;
+			AnswerEndOfStream(props->socket, &client, client_size, props, recvd);
+			props->dwTimeout = props->duplex.bActive ? DUPLEX_LINGER_MS : CONTROL_LINGER_MS;
+		}
+		client_size = sizeof(client);
+		WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)&client, &client_size, (LPOVERLAPPED)props,
+			PollPost(props, UDPRecvCompletion));
+		return;
+	}
+
+	// Once the data is over the server only stays to answer markers; anything else is a straggler
+	if (control->dwEnd != CONTROL_END_TIMEOUT)
+	{
+		client_size = sizeof(client);
+		WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)&client, &client_size, (LPOVERLAPPED)props,
+			PollPost(props, UDPRecvCompletion));
+		return;
+	}
+
+	// Repairs go to the whole group, so a multicast receiver gets repeats of what it already has
+	if (props->multicast.bJoin && !AcceptMulticastData(&props->multicast, (BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered,
+		useFile, &client, client_size))
+	{
+		client_size = sizeof(client);
+		WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)&client, &client_size, (LPOVERLAPPED)props,
+			PollPost(props, UDPRecvCompletion));
+		return;
+	}
+
+	// A sealed datagram that doesn't open is dropped like a damaged one; it isn't counted, so a wrong key shows up
+	// as a transfer that received nothing
+	if (props->crypt.bEnabled)
+	{
+		if (useFile ? !IsValidChunk((BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered) ||
+			!OpenChunk(&props->crypt, (LPChunkHeader)wsaBuf.buf) :
+			!OpenPacket(&props->crypt, (BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered))
+		{
+			client_size = sizeof(client);
+			WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)&client, &client_size,
+				(LPOVERLAPPED)props, PollPost(props, UDPRecvCompletion));
+			return;
+		}
+		dwNumberOfBytesTransfered -= SealOverhead(&props->crypt, useFile);
+	}
+
+	recvd += dwNumberOfBytesTransfered;
+	control->dwDatagrams++;
+	NoteDataArrival(control);
+	CaptureArrival(&props->capture, dwNumberOfBytesTransfered);
+	GetSystemTime(&props->endTime);
+
 	// This is the first packet
 	if (props->dwTimeout == INFINITE)
 	{
 		props->dwTimeout = COMM_TIMEOUT;
 		GetSystemTime(&props->startTime);
+		PlaceTransfer(props);
+		props->connect.nFamily = client.ss_family;
+		FormatAddress(&client, props->connect.szPeer, sizeof(props->connect.szPeer));
 	}
 
-	WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)&client, &client_size, (LPOVERLAPPED)props, UDPRecvCompletion);
+	if (useFile)
+	{
+		// Each datagram is one chunk; anything that isn't is dropped
+		if (IsValidChunk((BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered))
+		{
+			props->nPacketSize = dwNumberOfBytesTransfered;
+			if (!ProcessChunk((LPChunkHeader)wsaBuf.buf, props))
+			{
+				// The file is done, but the client's marker follows the CHUNK_END
+				if (((LPChunkHeader)wsaBuf.buf)->wType != CHUNK_END)
+					return;
+				props->dwTimeout = props->duplex.bActive ? DUPLEX_LINGER_MS : CONTROL_LINGER_MS;
+			}
+		}
+
+		// A multicast CHUNK_END that overtook some of the chunks is written once the last of them is repaired
+		if (props->multicast.bJoin && (hdr = ReleaseEndChunk(&props->multicast)) != NULL)
+		{
+			recvd += sizeof(ChunkHeader) + hdr->dwWireLen;
+			control->dwDatagrams++;
+			ProcessChunk(hdr, props);
+			props->dwTimeout = CONTROL_LINGER_MS;
+		}
+	}
+	else
+	{
+		props->nNumToSend = ((DWORD *)wsaBuf.buf)[0];
+		props->nPacketSize = dwNumberOfBytesTransfered;
+		CheckPayloadPacket(&props->payload, (BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered);
+
+		// A duplex client's first packet starts the packets going back to it
+		if (props->payload.bActive && (props->payload.dwFlags & PAYLOAD_FLAG_DUPLEX))
+		{
+			if (!props->duplex.bActive)
+				StartDuplexSend(props, &client, client_size);
+			NoteDuplexPacket(&props->duplex, (BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered);
+		}
+
+		// Finished receiving, but stay to answer the client's marker. A replay's datagrams aren't all one size, so
+		// they're counted rather than divided out.
+		if (control->dwDatagrams == props->nNumToSend)
+		{
+			control->dwEnd = CONTROL_END_COUNT;
+			props->dwTimeout = props->duplex.bActive ? DUPLEX_LINGER_MS : CONTROL_LINGER_MS;
+		}
+	}
+
+	client_size = sizeof(client);
+	WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)&client, &client_size, (LPOVERLAPPED)props,
+		PollPost(props, UDPRecvCompletion));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CheckTestStream
+-- October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CheckTestStream(LPTransferProps props, BYTE *data, DWORD dwLen)
+--							LPTransferProps props:	Pointer to the TransferProps structure for this transfer.
+--							BYTE *data:				The next bytes of the TCP stream of test packets, in the clear.
+--							DWORD dwLen:			How many.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Takes the packet size and count from the start of the stream, checks the bytes against the client's generator and
+-- hands a duplex client's packets to Duplex.cpp.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID CheckTestStream(LPTransferProps props, BYTE *data, DWORD dwLen)
+{
+	ULONGLONG qwOffset;
+
+	if (props->nPacketSize == 0)
+	{
+		props->nNumToSend	= ((DWORD *)data)[0]; // extract the original number to send
+		props->nPacketSize	= ((DWORD *)data)[1]; // extract the original packet size
+	}
+
+	qwOffset = props->payload.qwStreamOffset;
+	CheckPayloadStream(&props->payload, data, dwLen, props->nPacketSize);
+	if (props->payload.bActive && (props->payload.dwFlags & PAYLOAD_FLAG_DUPLEX))
+	{
+		if (!props->duplex.bActive)
+			StartDuplexSend(props, NULL, 0);
+		NoteDuplexStream(&props->duplex, data, dwLen, qwOffset, props->nPacketSize);
+	}
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------
@@ -225,15 +555,25 @@ VOID CALLBACK UDPRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfer
 -- NOTES:
 -- Windows calls this function whenever a TCP packet is received. It increments the number of bytes received and posts another
 -- WSARecv. If there are no packets left to receive, it obtains the end time and returns. If there is an error, it displays the
--- appropriate error message and returns.
+-- appropriate error message and returns. With -psk a chunk or packet that fails authentication ends the transfer, since
+-- the stream can't be trusted past it.
 ---------------------------------------------------------------------------------------------------------------------------*/
 VOID CALLBACK TCPRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
 	LPOVERLAPPED lpOverlapped, DWORD dwFlags)
 {
 	LPTransferProps props	= (LPTransferProps)lpOverlapped;
-	static BOOL		useFile = props->szFileName[0] != 0;
+	BOOL			useFile = props->szFileName[0] != 0;
 	DWORD			flags	= 0;
+	DWORD			dwFed	= 0;
+	BYTE			*plain;
+	LPChunkHeader	hdr;
 
+	TraceEvent(TRACE_RECV_DONE, dwNumberOfBytesTransfered, wsaBuf.buf);
+
+	// The socket was closed under it at the end of the transfer; there's nothing to report
+	if (dwErrorCode == WSA_OPERATION_ABORTED)
+		return;
+	NoteCompletion(&props->poll);
 	if (dwErrorCode != 0)
 	{
 		MessageBoxPrintf(MB_ICONERROR, TEXT("TCP Recv Error"), TEXT("Error receiving TCP packet; error code %d"), dwErrorCode);
@@ -241,24 +581,131 @@ VOID CALLBACK TCPRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfer
 		return;
 	}
 
-	if (useFile)
-		WriteFile(destFile, (VOID *)wsaBuf.buf, dwNumberOfBytesTransfered, &dwNumberOfBytesTransfered, NULL);
+	if (recvd == 0 && dwNumberOfBytesTransfered != 0)
+		props->connect.dwTtfbUs = ElapsedUs(&props->connect.liBegin);
+	if (dwNumberOfBytesTransfered != 0)
+	{
+		NoteDataArrival(&props->control);
+		CaptureArrival(&props->capture, dwNumberOfBytesTransfered);
+	}
 
-	if (props->nPacketSize == 0)
+	// Sealed test packets are counted as they're opened
+	if (useFile || !props->crypt.bEnabled)
+		recvd += dwNumberOfBytesTransfered;
+
+	// Chunks arrive split across and joined within receives, so reassemble them before writing
+	while (useFile && dwFed < dwNumberOfBytesTransfered)
+	{
+		dwFed += ChunkReaderFeed(&reader, (BYTE *)wsaBuf.buf + dwFed, dwNumberOfBytesTransfered - dwFed);
+		while ((hdr = ChunkReaderNext(&reader)) != NULL)
+		{
+			if (props->crypt.bEnabled)
+			{
+				if (!OpenChunk(&props->crypt, hdr))
+				{
+					MessageBox(NULL, TEXT("A chunk failed authentication (is -psk the same at both ends?); the transfer has been abandoned."),
+						TEXT("Bad Chunk"), MB_ICONERROR);
+					props->dwTimeout = 0;
+					return;
+				}
+				recvd -= CHUNK_SEALSIZE;
+			}
+			if (!ProcessChunk(hdr, props))
+				return;
+		}
+
+		if (reader.bCorrupt)
+		{
+			MessageBox(NULL, TEXT("Received a malformed chunk; the transfer has been abandoned."), TEXT("Bad Chunk"), MB_ICONERROR);
+			props->dwTimeout = 0;
+			return;
+		}
+	}
+
+	// A sealed stream is a run of records, one per packet, each opened once it's all here
+	while (!useFile && props->crypt.bEnabled && dwFed < dwNumberOfBytesTransfered)
 	{
-		props->nNumToSend	= ((DWORD *)wsaBuf.buf)[0]; // extract the original number to send
-		props->nPacketSize	= ((DWORD *)wsaBuf.buf)[1]; // extract the original packet size
+		dwFed += FeedRecord(&props->crypt, (BYTE *)wsaBuf.buf + dwFed, dwNumberOfBytesTransfered - dwFed, &plain);
+		if (plain != NULL)
+		{
+			recvd += props->crypt.dwRecordLen;
+			CheckTestStream(props, plain, props->crypt.dwRecordLen);
+		}
+
+		if (props->crypt.bCorrupt)
+		{
+			MessageBox(NULL, TEXT("A packet failed authentication (is -psk the same at both ends?); the transfer has been abandoned."),
+				TEXT("Bad Packet"), MB_ICONERROR);
+			props->dwTimeout = 0;
+			return;
+		}
+	}
+	if (!useFile && !props->crypt.bEnabled)
+		CheckTestStream(props, (BYTE *)wsaBuf.buf, dwNumberOfBytesTransfered);
+
+	// A session connection stays open after the data, so the client says up front how much there is
+	if (!useFile && props->session.qwExpected != 0 && recvd >= props->session.qwExpected)
+	{
+		props->session.bFinished = TRUE;
+		props->control.dwEnd = CONTROL_END_STREAM;
+		GetSystemTime(&props->endTime);
+		props->dwTimeout = 0;
+		return;
 	}
 
 	if (dwNumberOfBytesTransfered == 0)
 	{
+		props->control.dwEnd = CONTROL_END_STREAM;
 		GetSystemTime(&props->endTime);
 		props->dwTimeout = 0;
 		return;
 	}
 
-	recvd += dwNumberOfBytesTransfered;
-	WSARecv(props->socket, &wsaBuf, 1, NULL, &flags, (LPOVERLAPPED)props, TCPRecvCompletion);
+	WSARecv(props->socket, &wsaBuf, 1, NULL, &flags, (LPOVERLAPPED)props, PollPost(props, TCPRecvCompletion));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ResetReceive
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ResetReceive(LPTransferProps props)
+--							LPTransferProps props:  Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Closes the destination and frees everything used to receive one transfer, leaving the sockets alone.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID ResetReceive(LPTransferProps props)
+{
+	recvd = 0;
+	props->nPacketSize = 0;
+	props->nNumToSend = 0;
+	props->dwTimeout = COMM_TIMEOUT;
+	ResetPayloadState(&props->payload);
+	InitControlState(&props->control);
+	props->pmtu.dwAnswered = 0;
+	FreeDuplex(&props->duplex);
+	ResetDuplexState(&props->duplex);
+	ResetMulticast(&props->multicast);
+	ResetPollStats(&props->poll);
+	EndCrypt(&props->crypt);
+	if (destFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(destFile);
+		destFile = INVALID_HANDLE_VALUE;
+	}
+	FreeChunkReader(&reader);
+	FreeManifest(&manifest);
+	FreeBatchSink(&sink);
+	FreeDedupOffer(&offered);
+	CloseDedupStore(&store);
+	PoolFree(decodeBuf);
+	decodeBuf = NULL;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------
@@ -276,18 +723,347 @@ VOID CALLBACK TCPRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfer
 -- RETURNS: void
 --
 -- NOTES:
--- Resets all parameters used in the transfer to their default values in preparation for receiving again.
+-- Resets all parameters used in the transfer to their default values in preparation for receiving again, and closes the
+-- connection along with anything a session was holding.
 ---------------------------------------------------------------------------------------------------------------------------*/
 VOID ServerCleanup(LPTransferProps props)
 {
-	recvd = 0;
+	ResetReceive(props);
 	closesocket(props->socket);
 	DWORD error = WSAGetLastError();
-	props->nPacketSize = 0;
-	props->nNumToSend = 0;
-	props->dwTimeout = COMM_TIMEOUT;
-	closesocket(props->socket);
-	CloseHandle(destFile);
+	CloseSession(&props->session);
+	EndPolling(props);
+	UnplaceTransfer(props);
+	PoolFree(wsaBuf.buf);
+	wsaBuf.buf = NULL;
+	PoolFlushThread();
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CopyChunk
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CopyChunk(LPChunkHeader hdr, LPTransferProps props)
+--							LPChunkHeader hdr:		A CHUNK_COPY from the client.
+--							LPTransferProps props:  Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the destination file couldn't be read or written; TRUE otherwise.
+--
+-- NOTES:
+-- Reads one of the blocks signed by SendSignatures back from the destination file and moves it to where the client
+-- says it belongs. The client only refers to blocks at or after the chunk's own offset, which haven't been overwritten
+-- yet. The block is checked against the chunk's CRC either way, so a block that doesn't need to move costs a read but
+-- no write.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL CopyChunk(LPChunkHeader hdr, LPTransferProps props)
+{
+	LPDeltaState	delta	= &props->delta;
+	LARGE_INTEGER	liOffset;
+	ULONGLONG		qwSrc;
+	DWORD			dwDone;
+
+	if (props->nPacketSize == 0)
+		props->nPacketSize = sizeof(ChunkHeader) + hdr->dwWireLen;
+
+	qwSrc = ((LPChunkCopy)(hdr + 1))->qwSrcOffset;
+	props->compress.qwLogicalBytes += hdr->dwLogicalLen;
+	props->compress.qwWireBytes += sizeof(ChunkHeader) + hdr->dwWireLen;
+
+	if (hdr->dwWireLen != sizeof(ChunkCopy) || delta->dwBlockSize == 0 || hdr->dwLogicalLen != delta->dwBlockSize ||
+		qwSrc % delta->dwBlockSize != 0 || qwSrc / delta->dwBlockSize >= delta->dwBlocks || qwSrc < hdr->qwOffset)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Bad Chunk"), TEXT("Chunk %u refers to a block this end doesn't have; the transfer has been abandoned."),
+			hdr->dwSeq);
+		props->dwTimeout = 0;
+		return FALSE;
+	}
+
+	liOffset.QuadPart = qwSrc;
+	if (!SetFilePointerEx(destFile, liOffset, NULL, FILE_BEGIN) ||
+		!ReadFile(destFile, decodeBuf, hdr->dwLogicalLen, &dwDone, NULL) || dwDone != hdr->dwLogicalLen)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("ReadFile Failed"), TEXT("Could not read %s, error %d"), props->szFileName,
+			GetLastError());
+		props->dwTimeout = 0;
+		return FALSE;
+	}
+
+	if (ChecksumChunk(&props->integrity, hdr->qwOffset, decodeBuf, hdr->dwLogicalLen) != hdr->dwCrc)
+	{
+		props->integrity.dwBadChunks++;
+		return TRUE;
+	}
+
+	delta->dwMatches++;
+	delta->qwMatchedBytes += hdr->dwLogicalLen;
+	if (qwSrc == hdr->qwOffset)
+	{
+		delta->qwInPlaceBytes += hdr->dwLogicalLen;
+		return TRUE;
+	}
+
+	liOffset.QuadPart = hdr->qwOffset;
+	if (!SetFilePointerEx(destFile, liOffset, NULL, FILE_BEGIN) ||
+		!TraceWriteFile(destFile, decodeBuf, hdr->dwLogicalLen, &dwDone))
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("WriteFile Failed"), TEXT("Could not write to %s, error %d"), props->szFileName,
+			GetLastError());
+		props->dwTimeout = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ProcessChunk
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ProcessChunk(LPChunkHeader hdr, LPTransferProps props)
+--							LPChunkHeader hdr:		A complete chunk from the client.
+--							LPTransferProps props:  Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the transfer is over (finished or failed), in which case no more receives should be posted; TRUE
+--			otherwise.
+--
+-- NOTES:
+-- Decodes a data chunk, checks its CRC and writes it at its offset in the destination file. The CHUNK_END trims the
+-- file to the size the client sent, since the destination may have held a longer file before, checks the whole-file
+-- digest and ends the transfer. CHUNK_COPYs from a delta transfer are handed to CopyChunk. The chunks of a dedup
+-- transfer must be ones the server asked for, and are added to the chunk store once written.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ProcessChunk(LPChunkHeader hdr, LPTransferProps props)
+{
+	LARGE_INTEGER	liOffset;
+	BYTE			*data;
+	DWORD			dwWritten;
+	DWORD			dwCrc;
+
+	if (hdr->wType == CHUNK_END)
+	{
+		if (hdr->dwWireLen >= sizeof(ChunkEnd))
+		{
+			props->nNumToSend = ((LPChunkEnd)(hdr + 1))->dwChunks;
+			FinishIntegrity(&props->integrity, ((LPChunkEnd)(hdr + 1))->dwChunks, ((LPChunkEnd)(hdr + 1))->qwDigest);
+			if (destFile != INVALID_HANDLE_VALUE)
+			{
+				liOffset.QuadPart = ((LPChunkEnd)(hdr + 1))->qwFileSize;
+				SetFilePointerEx(destFile, liOffset, NULL, FILE_BEGIN);
+				SetEndOfFile(destFile);
+			}
+		}
+
+		// The transfer isn't over until the last file has been written and closed
+		FinishBatchSink(&sink);
+		props->session.bFinished = TRUE;
+		props->control.dwEnd = CONTROL_END_STREAM;
+		GetSystemTime(&props->endTime);
+		props->dwTimeout = 0;
+		return FALSE;
+	}
+
+	if (hdr->wType == CHUNK_COPY)
+		return CopyChunk(hdr, props);
+
+	if (hdr->wType != CHUNK_DATA)
+		return TRUE;
+
+	if (props->nPacketSize == 0)
+		props->nPacketSize = sizeof(ChunkHeader) + hdr->dwWireLen;
+
+	if ((data = DecodeChunk(hdr, decodeBuf, &props->compress)) == NULL)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Bad Chunk"), TEXT("Chunk %u could not be decoded; the transfer has been abandoned."),
+			hdr->dwSeq);
+		props->dwTimeout = 0;
+		return FALSE;
+	}
+
+	// A chunk that fails its CRC isn't written; the digest will no longer match, so the transfer is reported as failed
+	dwCrc = ChecksumChunk(&props->integrity, hdr->qwOffset, data, hdr->dwLogicalLen);
+	if (dwCrc != hdr->dwCrc || (manifest.bitmap != NULL &&
+		hdr->qwOffset != (ULONGLONG)hdr->dwSeq * manifest.hdr.dwChunkSize) ||
+		(offered.bActive && !IsOfferedChunk(&offered, hdr->dwSeq, hdr->qwOffset, hdr->dwLogicalLen)))
+	{
+		props->integrity.dwBadChunks++;
+		return TRUE;
+	}
+
+	if (sink.bActive)
+	{
+		if (!ReceiveBatchData(&sink, hdr->qwOffset, data, hdr->dwLogicalLen))
+		{
+			MessageBoxPrintf(MB_ICONERROR, TEXT("Bad File List"),
+				TEXT("Chunk %u doesn't fit the list of files the client sent; the transfer has been abandoned."), hdr->dwSeq);
+			props->dwTimeout = 0;
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	liOffset.QuadPart = hdr->qwOffset;
+	if (!SetFilePointerEx(destFile, liOffset, NULL, FILE_BEGIN) ||
+		!TraceWriteFile(destFile, data, hdr->dwLogicalLen, &dwWritten))
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("WriteFile Failed"), TEXT("Could not write to %s, error %d"), props->szFileName,
+			GetLastError());
+		props->dwTimeout = 0;
+		return FALSE;
+	}
+
+	if (props->delta.dwBlockSize != 0)
+		props->delta.qwLiteralBytes += hdr->dwLogicalLen;
+	if (offered.bActive)
+		AddToStore(&store, &offered.refs[hdr->dwSeq], data, &props->dedup);
+
+	MarkChunkPresent(&manifest, hdr->dwSeq, dwCrc);
+	CheckpointManifest(&manifest, destFile);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ResumeReply
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ResumeReply(LPTransferProps props)
+--							LPTransferProps props:  Pointer to the TransferProps structure for this transfer.
+--
+-- RETURNS: FALSE if the client's query couldn't be read or answered; TRUE otherwise.
+--
+-- NOTES:
+-- Reads the client's description of the file, loads the manifest left by any earlier attempt to receive the same file,
+-- and sends it back. The chunks already present are added to the digest here since the client won't send them. If the
+-- client asked for a delta transfer, the signatures of the existing file are sent instead; if it offered the hashes
+-- of its chunks, the ones in the chunk store are written and the rest asked for. A multi-file transfer is simply
+-- accepted if the destination is a directory.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ResumeReply(LPTransferProps props)
+{
+	ManifestHeader	query;
+	DWORD			dwTimeout	= COMM_TIMEOUT;
+	DWORD			dwNoTimeout	= 0;
+	DWORD			i;
+
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+	if (!RecvAll(props->socket, (CHAR *)&query, sizeof(query)))
+		query.dwMagic = 0;
+	setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+
+	// A multi-file transfer needs a directory to put the files in; the reply just says it's been accepted
+	if (query.dwMagic == BATCH_MAGIC)
+	{
+		if (destFile != INVALID_HANDLE_VALUE)
+		{
+			MessageBox(NULL, TEXT("The client is sending several files; choose a directory to save them in."),
+				TEXT("Multi-File Transfer Refused"), MB_ICONERROR);
+			return FALSE;
+		}
+		if (!StartBatchSink(&sink, props->szFileName, &props->batch))
+			return FALSE;
+		if (!SendAll(props->socket, (CHAR *)&query, sizeof(query)))
+		{
+			MessageBoxPrintf(MB_ICONERROR, TEXT("Resume Reply Failed"), TEXT("Couldn't accept the file list; error %d"),
+				WSAGetLastError());
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	if (destFile == INVALID_HANDLE_VALUE &&
+		(query.dwMagic == DELTA_MAGIC || query.dwMagic == DEDUP_MAGIC || query.dwMagic == MANIFEST_MAGIC))
+	{
+		MessageBox(NULL, TEXT("The client is sending a single file; choose a file name to save it as."),
+			TEXT("Can't Receive File"), MB_ICONERROR);
+		return FALSE;
+	}
+
+	// A delta transfer rewrites the existing file instead of resuming, so it gets signatures rather than a manifest
+	if (query.dwMagic == DELTA_MAGIC)
+	{
+		if (!SendSignatures(props->socket, destFile, &props->delta))
+		{
+			MessageBoxPrintf(MB_ICONERROR, TEXT("Delta Reply Failed"),
+				TEXT("Couldn't send the signatures of %s; error %d"), props->szFileName, WSAGetLastError());
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	// A dedup transfer takes what it can from the store before the client sends anything
+	if (query.dwMagic == DEDUP_MAGIC)
+	{
+		setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+		if (!RecvDedupOffer(props->socket, &offered, &query, &props->dedup))
+		{
+			MessageBox(NULL, TEXT("The client's list of chunks was cut short or doesn't make up the file."),
+				TEXT("Dedup Query Failed"), MB_ICONERROR);
+			return FALSE;
+		}
+		setsockopt(props->socket, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+
+		if (!OpenDedupStore(&store, props->dedup.szStoreDir, &props->dedup))
+		{
+			MessageBoxPrintf(MB_ICONERROR, TEXT("Can't Open Chunk Store"),
+				TEXT("Could not open the chunk store in %s, error %d"), props->dedup.szStoreDir, GetLastError());
+			return FALSE;
+		}
+		if (!FillFromStore(&store, &offered, destFile, &props->integrity, &props->dedup))
+		{
+			MessageBoxPrintf(MB_ICONERROR, TEXT("WriteFile Failed"), TEXT("Could not write to %s, error %d"),
+				props->szFileName, GetLastError());
+			return FALSE;
+		}
+		if (!SendDedupReply(props->socket, &offered, &props->dedup))
+		{
+			MessageBoxPrintf(MB_ICONERROR, TEXT("Dedup Reply Failed"),
+				TEXT("Couldn't say which chunks are in the store; error %d"), WSAGetLastError());
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	if (query.dwMagic != MANIFEST_MAGIC || query.dwChunkSize == 0 || query.dwChunkSize > CHUNK_MAXPAYLOAD)
+	{
+		MessageBox(NULL, TEXT("The client didn't describe the file it's sending."), TEXT("Resume Query Failed"),
+			MB_ICONERROR);
+		return FALSE;
+	}
+
+	if (!LoadManifest(&manifest, props->szFileName, &query))
+	{
+		MessageBox(NULL, TEXT("Couldn't allocate the chunk manifest."), TEXT("No Memory Allocated"), MB_ICONERROR);
+		return FALSE;
+	}
+
+	for (i = 0; i < manifest.hdr.dwChunks; i++)
+	{
+		if (IsChunkPresent(&manifest, i))
+		{
+			FoldChunkDigest(&props->integrity, (ULONGLONG)i * query.dwChunkSize,
+				(DWORD)min((ULONGLONG)query.dwChunkSize, query.qwFileSize - (ULONGLONG)i * query.dwChunkSize),
+				manifest.crcs[i]);
+			props->integrity.dwResumedChunks++;
+		}
+	}
+
+	if (!SendManifest(props->socket, &manifest))
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("Resume Reply Failed"), TEXT("Couldn't send the chunk manifest; error %d"),
+			WSAGetLastError());
+		return FALSE;
+	}
+	return TRUE;
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------
@@ -318,6 +1094,14 @@ BOOL ListenTCP(LPTransferProps props)
 		return FALSE;
 	}
 
+	// A session keeps the listener so the client can connect again, and every transfer starts with a session header
+	if (props->session.bEnabled)
+	{
+		props->session.listener = props->socket;
+		props->socket = INVALID_SOCKET;
+		return NextSessionTransfer(props);
+	}
+
 	if ((accept = WSAAccept(props->socket, NULL, NULL, NULL, NULL)) == SOCKET_ERROR)
 	{
 		MessageBoxPrintf(MB_ICONERROR, TEXT("WSAAccept Failed"), TEXT("WSAAccept() failed with socket error %d"), WSAGetLastError());
@@ -327,8 +1111,19 @@ BOOL ListenTCP(LPTransferProps props)
 
 	closesocket(props->socket); // close the listening socket
 	props->socket = accept;		// assign the new socket to props->socket
+	NotePeer(props->socket, &props->connect);
+	PlaceTransfer(props);
 
-	WSARecv(props->socket, &wsaBuf, 1, NULL, &flags, (LPOVERLAPPED)props, TCPRecvCompletion);
+	// Accepted sockets don't reliably inherit every option from the listener, so apply the profile again
+	ApplySocketTuning(props->socket, &props->tuning, SOCK_STREAM);
+	AutoTuneSocket(props->socket, &props->tuning, SOCK_STREAM, 0);
+
+	if (props->crypt.bEnabled && !AcceptCryptHello(props))
+		return FALSE;
+	if (props->szFileName[0] != 0 && !ResumeReply(props))
+		return FALSE;
+
+	WSARecv(props->socket, &wsaBuf, 1, NULL, &flags, (LPOVERLAPPED)props, PollPost(props, TCPRecvCompletion));
 
 	error = WSAGetLastError();
 
@@ -341,6 +1136,58 @@ BOOL ListenTCP(LPTransferProps props)
 	return TRUE;
 }
 
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NextSessionTransfer
+-- October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NextSessionTransfer(LPTransferProps props)
+--							LPTransferProps props:  Pointer to the TransferProps structure containing the details for this
+--													transfer.
+--
+-- RETURNS: FALSE if the session has been idle for its timeout or the next transfer couldn't be started; TRUE once
+--			the next transfer is under way.
+--
+-- NOTES:
+-- Clears up after the last transfer and waits for the client to start another on the session connection (or on a new
+-- one; see AwaitSessionTransfer), then prepares the destination and posts the first WSARecv just as ListenTCP does.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL NextSessionTransfer(LPTransferProps props)
+{
+	DWORD flags = 0, error = 0;
+
+	ResetReceive(props);
+	if (!AwaitSessionTransfer(&props->session, &props->socket))
+		return FALSE;
+	GetSystemTime(&props->startTime);
+	NotePeer(props->socket, &props->connect);
+	PlaceTransfer(props);
+
+	// Accepted sockets don't reliably inherit every option from the listener, so apply the profile to each new one
+	if (!props->session.bReused)
+		ApplySocketTuning(props->socket, &props->tuning, SOCK_STREAM);
+	AutoTuneSocket(props->socket, &props->tuning, SOCK_STREAM, 0);
+
+	if (props->crypt.bEnabled && !AcceptCryptHello(props))
+		return FALSE;
+	if (props->szFileName[0] != 0 && (!OpenDestination(props) || !ResumeReply(props)))
+		return FALSE;
+
+	WSARecv(props->socket, &wsaBuf, 1, NULL, &flags, (LPOVERLAPPED)props, PollPost(props, TCPRecvCompletion));
+
+	error = WSAGetLastError();
+	if (error && error != WSA_IO_PENDING)
+	{
+		MessageBoxPrintf(MB_ICONERROR, TEXT("WSARecv Error"), TEXT("WSARecv encountered error %d"), error);
+		props->dwTimeout = 0;
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /*-------------------------------------------------------------------------------------------------------------------------
 -- FUNCTION: ListenUDP
 -- Febrary 10th 2014
@@ -349,27 +1196,26 @@ BOOL ListenTCP(LPTransferProps props)
 --
 -- PROGRAMMER: Shane Spoor
 --
--- INTERFACE: ListenUDP(LPTransferProps props, LPSOCKADDR_IN client)
+-- INTERFACE: ListenUDP(LPTransferProps props)
 --							LPTransferProps props:  Pointer to the TransferProps structure containing the details for this
 --													transfer.
---							LPSOCKADDR_IN	client:	Pointer to a SOCKADDR_IN structure to hold the client's info. This must
---													be passed from the thread to ensure that it's in scope when the
---													completion routine is called.
 --
 -- RETURNS: void
 --
 -- NOTES:
 -- Posts a receive request on the socket to wait for a UDP packet.
 ---------------------------------------------------------------------------------------------------------------------------*/
-BOOL ListenUDP(LPTransferProps props, LPSOCKADDR_IN client)
+BOOL ListenUDP(LPTransferProps props)
 {
 	DWORD		flags = 0, error = 0;
-	INT			client_size = sizeof(*client);
 
 	props->dwTimeout = INFINITE;
+	memset(&props->connect, 0, sizeof(ConnectState));
+	AutoTuneSocket(props->socket, &props->tuning, SOCK_DGRAM, 0);
 
-	WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)client, &client_size, (LPOVERLAPPED)props,
-		UDPRecvCompletion);
+	client_size = sizeof(client);
+	WSARecvFrom(props->socket, &wsaBuf, 1, NULL, &flags, (sockaddr *)&client, &client_size, (LPOVERLAPPED)props,
+		PollPost(props, UDPRecvCompletion));
 
 	error = WSAGetLastError();
 	if (error && error != WSA_IO_PENDING)
@@ -6,6 +6,27 @@
 #include <time.h>
 #include "WinStorage.h"
 #include "Utils.h"
+#include "SocketTuning.h"
+#include "Compress.h"
+#include "Chunk.h"
+#include "Checksum.h"
+#include "Manifest.h"
+#include "Delta.h"
+#include "Dedup.h"
+#include "Batch.h"
+#include "Session.h"
+#include "Connect.h"
+#include "Payload.h"
+#include "Control.h"
+#include "Pmtu.h"
+#include "Duplex.h"
+#include "Multicast.h"
+#include "Pool.h"
+#include "BusyPoll.h"
+#include "Affinity.h"
+#include "Crypt.h"
+#include "Trace.h"
+#include "Capture.h"
 
 #define UDP_MAXPACKET	65535	// The maximum datagram size
 #ifndef COMM_TIMEOUT			// Time to wait before giving up (used mostly for UDP)
@@ -15,8 +36,11 @@
 BOOL ServerInitSocket(LPTransferProps props);
 DWORD WINAPI Serve(VOID *hwnd);
 BOOL ListenTCP(LPTransferProps props);
-BOOL ListenUDP(LPTransferProps props, LPSOCKADDR_IN client);
+BOOL ListenUDP(LPTransferProps props);
 VOID ServerCleanup(LPTransferProps props);
+BOOL ProcessChunk(LPChunkHeader hdr, LPTransferProps props);
+BOOL ResumeReply(LPTransferProps props);
+BOOL NextSessionTransfer(LPTransferProps props);
 
 // Completion routine prototypes
 VOID CALLBACK UDPRecvCompletion(DWORD dwErrorCode, DWORD dwNumberOfBytesTransfered,
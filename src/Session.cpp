@@ -0,0 +1,502 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Session.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID InitSessionState(LPSessionState s);
+-- BOOL ReuseSession(LPSessionState s, LPResolvedHost host);
+-- VOID StartSession(LPSessionState s, SOCKET conn, const SOCKADDR_STORAGE *addr, DWORD dwConnectUs);
+-- BOOL SendSessionHeader(SOCKET conn, LPSessionState s, ULONGLONG qwLength);
+-- BOOL AwaitSessionTransfer(LPSessionState s, SOCKET *pConn);
+-- BOOL SendSessionAck(SOCKET conn, LPSessionState s, ULONGLONG qwReceived);
+-- BOOL RecvSessionAck(SOCKET conn, LPSessionState s, DWORD dwTimeout);
+-- VOID EndSessionTransfer(LPSessionState s, ULONGLONG qwBytes, DWORD dwRttUs);
+-- VOID CloseSession(LPSessionState s);
+-- INT FormatSessionReport(CHAR *buf, size_t size, LPSessionState s, BOOL bReceiver);
+-- static BOOL IsConnectionAlive(SOCKET conn);
+-- static double SlowStartPenalty(ULONGLONG qwBytes, double dSeconds, double dRtt);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file lets one TCP connection carry many transfers. Without it, every transfer pays for a handshake
+--			and then for slow start, which for small files takes longer than sending the data. In session mode the
+--			client keeps its connection after a transfer and the server keeps both the connection and its listening
+--			socket, each for up to the idle timeout.
+--
+--			Every transfer on a session connection opens with a SessionHeader carrying its ID (and, for test
+--			packets, how many bytes follow, since the end of the data can no longer be signalled by closing the
+--			connection). When the transfer is over the receiver answers with an acknowledgement, so the client never
+--			starts a transfer while the last one's bytes are still being read. A transfer that goes wrong leaves the
+--			stream out of step, so its connection is closed rather than reused.
+--
+--			The report estimates what reuse saved: the handshake the transfer didn't need, and the round trips a new
+--			connection would have spent growing its window from SESSION_INITWINDOW segments to the rate that was
+--			actually reached.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Session.h"
+
+#define SESSION_RECV_TIMEOUT	5000	// Time allowed for the rest of a header or acknowledgement to arrive
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitSessionState
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitSessionState(LPSessionState s)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Clears the session with session mode off and no connection or listener held.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID InitSessionState(LPSessionState s)
+{
+	memset(s, 0, sizeof(SessionState));
+	s->conn = INVALID_SOCKET;
+	s->listener = INVALID_SOCKET;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsConnectionAlive
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsConnectionAlive(SOCKET conn)
+--
+-- RETURNS: FALSE if the connection has been closed or reset by the other end; TRUE otherwise.
+--
+-- NOTES:
+-- Nothing should arrive on an idle session connection, so if it's readable the server has either closed it (its idle
+-- timeout may be shorter) or sent something out of step. Either way it can't be used.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL IsConnectionAlive(SOCKET conn)
+{
+	fd_set	readable, failed;
+	timeval	tv = { 0, 0 };
+
+	FD_ZERO(&readable);
+	FD_ZERO(&failed);
+	FD_SET(conn, &readable);
+	FD_SET(conn, &failed);
+	return select(0, &readable, NULL, &failed, &tv) == 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReuseSession
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReuseSession(LPSessionState s, LPResolvedHost host)
+--							LPSessionState s:		The client's session.
+--							LPResolvedHost host:	The addresses of the server the next transfer is going to.
+--
+-- RETURNS: TRUE if the connection kept from the last transfer can carry the next; FALSE if a new one is needed.
+--
+-- NOTES:
+-- A connection to any of the server's addresses will do. A connection to a different server, one that has been idle longer than the timeout, or one the server has closed is
+-- closed here.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ReuseSession(LPSessionState s, LPResolvedHost host)
+{
+	BOOL	bSamePeer = FALSE;
+	DWORD	i;
+
+	for (i = 0; i < host->dwAddrs && !bSamePeer; i++)
+		bSamePeer = SameAddress(&s->peer, &host->addrs[i]);
+
+	s->bReused = s->conn != INVALID_SOCKET && bSamePeer && GetTickCount64() - s->qwLastUsed < s->dwIdleMs &&
+		IsConnectionAlive(s->conn);
+
+	if (!s->bReused)
+		CloseSession(s);
+	return s->bReused;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StartSession
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StartSession(LPSessionState s, SOCKET conn, const SOCKADDR_STORAGE *addr, DWORD dwConnectUs)
+--							LPSessionState s:			The client's session.
+--							SOCKET conn:				The connection just made.
+--							SOCKADDR_STORAGE *addr:		The server address it goes to.
+--							DWORD dwConnectUs:		How long connecting took.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID StartSession(LPSessionState s, SOCKET conn, const SOCKADDR_STORAGE *addr, DWORD dwConnectUs)
+{
+	s->conn = conn;
+	s->peer = *addr;
+	s->dwConnectUs = dwConnectUs;
+	s->dwConnTransfers = 0;
+	s->dTotalSaved = 0.0;
+	s->bReused = FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendSessionHeader
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendSessionHeader(SOCKET conn, LPSessionState s, ULONGLONG qwLength)
+--							SOCKET conn:			The session connection.
+--							LPSessionState s:		The client's session.
+--							ULONGLONG qwLength:		Bytes of test packets to follow, or 0 for a file.
+--
+-- RETURNS: FALSE if the header couldn't be sent; TRUE otherwise.
+--
+-- NOTES:
+-- Starts the next transfer on the connection under a new ID.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SendSessionHeader(SOCKET conn, LPSessionState s, ULONGLONG qwLength)
+{
+	SessionHeader hdr;
+
+	hdr.dwMagic = SESSION_MAGIC;
+	hdr.dwTransferId = ++s->dwTransferId;
+	hdr.qwLength = qwLength;
+
+	s->dwConnTransfers++;
+	s->bFinished = FALSE;
+	s->qwExpected = qwLength;
+	QueryPerformanceCounter(&s->liStart);
+	return SendAll(conn, (CHAR *)&hdr, sizeof(hdr));
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AwaitSessionTransfer
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AwaitSessionTransfer(LPSessionState s, SOCKET *pConn)
+--							LPSessionState s:		The server's session; s->listener must be listening.
+--							SOCKET *pConn:			The current connection (INVALID_SOCKET if there isn't one). It's
+--													replaced if the client connects again.
+--
+-- RETURNS: TRUE once the header of the next transfer has arrived; FALSE if nothing happened within the idle timeout.
+--
+-- NOTES:
+-- Waits on the connection and the listener together. The client only connects again once it has given up on the old
+-- connection, so a new connection replaces it, and a connection the client closes is dropped while the wait goes on.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL AwaitSessionTransfer(LPSessionState s, SOCKET *pConn)
+{
+	SessionHeader	hdr;
+	fd_set			fds;
+	timeval			tv;
+	ULONGLONG		qwDeadline	= GetTickCount64() + s->dwIdleMs;
+	ULONGLONG		qwNow;
+	DWORD			dwTimeout	= SESSION_RECV_TIMEOUT;
+	DWORD			dwNoTimeout	= 0;
+	SOCKET			accepted;
+	BOOL			bOk;
+
+	while ((qwNow = GetTickCount64()) < qwDeadline)
+	{
+		FD_ZERO(&fds);
+		FD_SET(s->listener, &fds);
+		if (*pConn != INVALID_SOCKET)
+			FD_SET(*pConn, &fds);
+
+		tv.tv_sec = (LONG)((qwDeadline - qwNow) / 1000);
+		tv.tv_usec = (LONG)((qwDeadline - qwNow) % 1000 * 1000);
+		if (select(0, &fds, NULL, NULL, &tv) <= 0)
+			return FALSE;
+
+		if (FD_ISSET(s->listener, &fds))
+		{
+			if ((accepted = WSAAccept(s->listener, NULL, NULL, NULL, NULL)) == INVALID_SOCKET)
+				return FALSE;
+			if (*pConn != INVALID_SOCKET)
+				closesocket(*pConn);
+			*pConn = accepted;
+			s->dwConnTransfers = 0;
+			s->dwConnectUs = 0;
+			s->dTotalSaved = 0.0;
+			continue;
+		}
+
+		setsockopt(*pConn, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+		bOk = RecvAll(*pConn, (CHAR *)&hdr, sizeof(hdr));
+		setsockopt(*pConn, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+
+		if (bOk && hdr.dwMagic == SESSION_MAGIC)
+		{
+			s->dwTransferId = hdr.dwTransferId;
+			s->qwExpected = hdr.qwLength;
+			s->bReused = ++s->dwConnTransfers > 1;
+			s->bFinished = FALSE;
+			QueryPerformanceCounter(&s->liStart);
+			return TRUE;
+		}
+
+		if (bOk)
+			MessageBox(NULL, TEXT("The client didn't start a session; run it with -session as well."),
+				TEXT("No Session"), MB_ICONERROR);
+		closesocket(*pConn);
+		*pConn = INVALID_SOCKET;
+	}
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendSessionAck
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendSessionAck(SOCKET conn, LPSessionState s, ULONGLONG qwReceived)
+--							SOCKET conn:			The session connection.
+--							LPSessionState s:		The server's session.
+--							ULONGLONG qwReceived:	Bytes received in the transfer.
+--
+-- RETURNS: FALSE if the transfer didn't finish or the acknowledgement couldn't be sent, in which case the connection
+--			should be closed; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SendSessionAck(SOCKET conn, LPSessionState s, ULONGLONG qwReceived)
+{
+	SessionHeader ack;
+
+	if (!s->bFinished)
+		return FALSE;
+
+	ack.dwMagic = SESSION_ACK_MAGIC;
+	ack.dwTransferId = s->dwTransferId;
+	ack.qwLength = qwReceived;
+	if (!SendAll(conn, (CHAR *)&ack, sizeof(ack)))
+	{
+		s->bFinished = FALSE;
+		return FALSE;
+	}
+	s->qwLastUsed = GetTickCount64();
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RecvSessionAck
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RecvSessionAck(SOCKET conn, LPSessionState s, DWORD dwTimeout)
+--							SOCKET conn:			The session connection.
+--							LPSessionState s:		The client's session.
+--							DWORD dwTimeout:		How long to wait, in milliseconds.
+--
+-- RETURNS: TRUE if the server acknowledged the transfer under way, in which case the connection can be kept; FALSE
+--			otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL RecvSessionAck(SOCKET conn, LPSessionState s, DWORD dwTimeout)
+{
+	SessionHeader	ack;
+	DWORD			dwNoTimeout = 0;
+
+	setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwTimeout, sizeof(DWORD));
+	s->bFinished = RecvAll(conn, (CHAR *)&ack, sizeof(ack)) && ack.dwMagic == SESSION_ACK_MAGIC &&
+		ack.dwTransferId == s->dwTransferId;
+	setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, (CHAR *)&dwNoTimeout, sizeof(DWORD));
+
+	if (s->bFinished)
+	{
+		s->qwPeerBytes = ack.qwLength;
+		s->qwLastUsed = GetTickCount64();
+	}
+	return s->bFinished;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SlowStartPenalty
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SlowStartPenalty(ULONGLONG qwBytes, double dSeconds, double dRtt)
+--							ULONGLONG qwBytes:		Bytes sent.
+--							double dSeconds:		How long they took on the warm connection.
+--							double dRtt:			The round trip time in seconds.
+--
+-- RETURNS: The estimated extra time, in seconds, a new connection would have needed.
+--
+-- NOTES:
+-- A new connection sends SESSION_INITWINDOW segments in its first round trip and doubles that every round trip until
+-- the window covers the rate the warm connection reached. The rest goes at that rate. Connections that sat idle may be
+-- made to slow start again by the stack, so this is an upper bound.
+---------------------------------------------------------------------------------------------------------------------------*/
+static double SlowStartPenalty(ULONGLONG qwBytes, double dSeconds, double dRtt)
+{
+	double dRate, dWindow, dLeft, dCold;
+
+	if (qwBytes == 0 || dSeconds <= 0.0 || dRtt <= 0.0)
+		return 0.0;
+
+	dRate = qwBytes / dSeconds;
+	dWindow = SESSION_INITWINDOW * SESSION_MSS;
+	dLeft = (double)qwBytes;
+	dCold = 0.0;
+	while (dLeft > 0.0 && dWindow < dRate * dRtt)
+	{
+		dLeft -= dWindow;
+		dCold += dRtt;
+		dWindow *= 2.0;
+	}
+	if (dLeft > 0.0)
+		dCold += dLeft / dRate;
+	return dCold > dSeconds ? dCold - dSeconds : 0.0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: EndSessionTransfer
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: EndSessionTransfer(LPSessionState s, ULONGLONG qwBytes, DWORD dwRttUs)
+--							LPSessionState s:		The session.
+--							ULONGLONG qwBytes:		Bytes sent or received in the transfer.
+--							DWORD dwRttUs:			The connection's round trip time (0 if unknown).
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Times the transfer and, if it ran on a reused connection, estimates what reuse saved. The server never sees the
+-- handshake, so it takes the setup cost to be one round trip.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID EndSessionTransfer(LPSessionState s, ULONGLONG qwBytes, DWORD dwRttUs)
+{
+	LARGE_INTEGER	liNow;
+	double			dRtt = (dwRttUs ? dwRttUs : s->dwConnectUs) / 1e6;
+
+	QueryPerformanceCounter(&liNow);
+	s->qwBytes = qwBytes;
+	s->dSeconds = TicksToSeconds(liNow.QuadPart - s->liStart.QuadPart);
+	s->dSetupSaved = 0.0;
+	s->dSlowStartSaved = 0.0;
+
+	if (!s->bReused || !s->bFinished)
+		return;
+
+	s->dSetupSaved = s->dwConnectUs ? s->dwConnectUs / 1e6 : dRtt;
+	s->dSlowStartSaved = SlowStartPenalty(qwBytes, s->dSeconds, dRtt);
+	s->dTotalSaved += s->dSetupSaved + s->dSlowStartSaved;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: CloseSession
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: CloseSession(LPSessionState s)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Closes the connection and listener the session is holding, if any. The settings and transfer IDs are kept.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID CloseSession(LPSessionState s)
+{
+	if (s->conn != INVALID_SOCKET)
+	{
+		closesocket(s->conn);
+		s->conn = INVALID_SOCKET;
+	}
+	if (s->listener != INVALID_SOCKET)
+	{
+		closesocket(s->listener);
+		s->listener = INVALID_SOCKET;
+	}
+	s->dwConnTransfers = 0;
+	s->bReused = FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatSessionReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatSessionReport(CHAR *buf, size_t size, LPSessionState s, BOOL bReceiver)
+--							CHAR *buf:			The buffer to write the report section into.
+--							size_t size:		The space left in buf.
+--							LPSessionState s:	The session at the end of the transfer.
+--							BOOL bReceiver:		Whether this end received the transfer.
+--
+-- RETURNS: The number of characters written.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatSessionReport(CHAR *buf, size_t size, LPSessionState s, BOOL bReceiver)
+{
+	INT		written = 0;
+	double	dWarm	= s->dSeconds > 0.0 ? s->qwBytes / s->dSeconds / 1e6 : 0.0;
+	double	dSaved	= s->dSetupSaved + s->dSlowStartSaved;
+
+	written += sprintf_s(buf, size, "Session: transfer %lu, %lu on this connection (%s), idle timeout %lus\r\n",
+		s->dwTransferId, s->dwConnTransfers, s->bReused ? "reused" : "new", s->dwIdleMs / 1000);
+
+	if (!s->bFinished)
+		return written + sprintf_s(buf + written, size - written,
+			"The transfer didn't finish cleanly; its connection won't be reused\r\n");
+
+	if (!bReceiver)
+		written += sprintf_s(buf + written, size - written, "Receiver acknowledged: %llu bytes\r\n", s->qwPeerBytes);
+
+	if (s->bReused)
+	{
+		written += sprintf_s(buf + written, size - written, "Saved by reuse: %.2fms setup, %.2fms slow start (est.)\r\n",
+			s->dSetupSaved * 1e3, s->dSlowStartSaved * 1e3);
+		written += sprintf_s(buf + written, size - written, "Throughput: %.2f MB/s, est. %.2f MB/s on a new connection\r\n",
+			dWarm, s->qwBytes / (s->dSeconds + dSaved) / 1e6);
+	}
+	written += sprintf_s(buf + written, size - written, "Saved on this connection so far: %.2fms\r\n",
+		s->dTotalSaved * 1e3);
+	return written;
+}
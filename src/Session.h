@@ -0,0 +1,42 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Connect.h"
+
+#define SESSION_MAGIC		0x53534553	// "SESS"
+#define SESSION_ACK_MAGIC	0x4B434153	// "SACK"
+#define SESSION_INITWINDOW	10			// Segments a new connection may send in its first round trip (RFC 6928)
+#define SESSION_MSS			1460		// Segment size assumed by the slow start estimate
+
+#pragma pack(push, 1)
+
+/* Opens every transfer on a session connection; the receiver answers with the same structure (SESSION_ACK_MAGIC)
+   once the transfer is over. */
+typedef struct _SessionHeader
+{
+	DWORD		dwMagic;
+	DWORD		dwTransferId;
+	ULONGLONG	qwLength;		// Header: bytes of test packets that follow (0 for files, which end with a CHUNK_END)
+								// Ack: bytes the receiver got
+} SessionHeader, *LPSessionHeader;
+
+#pragma pack(pop)
+
+VOID InitSessionState(LPSessionState s);
+BOOL ReuseSession(LPSessionState s, LPResolvedHost host);
+VOID StartSession(LPSessionState s, SOCKET conn, const SOCKADDR_STORAGE *addr, DWORD dwConnectUs);
+BOOL SendSessionHeader(SOCKET conn, LPSessionState s, ULONGLONG qwLength);
+BOOL AwaitSessionTransfer(LPSessionState s, SOCKET *pConn);
+BOOL SendSessionAck(SOCKET conn, LPSessionState s, ULONGLONG qwReceived);
+BOOL RecvSessionAck(SOCKET conn, LPSessionState s, DWORD dwTimeout);
+VOID EndSessionTransfer(LPSessionState s, ULONGLONG qwBytes, DWORD dwRttUs);
+VOID CloseSession(LPSessionState s);
+INT FormatSessionReport(CHAR *buf, size_t size, LPSessionState s, BOOL bReceiver);
+
+#endif
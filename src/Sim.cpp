@@ -0,0 +1,1157 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Sim.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- BOOL ParseSimLink(const CHAR *szValue, LPSimState sim);
+-- BOOL RunSimulation(LPSimState sim, DWORD nSockType, DWORD dwPacketSize, DWORD dwPackets, LPSocketTuning tuning);
+-- DWORD WINAPI SimulateTransfer(VOID *params);
+-- INT RunSimSweep(LPTransferProps props);
+-- INT FormatSimReport(CHAR *buf, size_t size, LPSimState sim, DWORD nSockType);
+-- static double SimRandom(LPSimWorld w);
+-- static VOID PushEvent(LPSimWorld w, ULONGLONG qwTime, DWORD dwType, DWORD dwArg, ULONGLONG qwSeq);
+-- static SimEvent PopEvent(LPSimWorld w);
+-- static BOOL SendOnLink(LPSimWorld w, DWORD dwBytes, ULONGLONG *pqwArrive);
+-- static VOID UDPSendNext(LPSimWorld w);
+-- static VOID TCPArmRto(LPSimWorld w);
+-- static VOID TCPSendSegment(LPSimWorld w, ULONGLONG qwSeq, ULONGLONG qwLen);
+-- static VOID TCPTrySend(LPSimWorld w);
+-- static VOID TCPUpdateRtt(LPSimWorld w, ULONGLONG qwSample);
+-- static VOID TCPOnAck(LPSimWorld w, ULONGLONG qwAck, DWORD dwRwnd);
+-- static VOID TCPOnRto(LPSimWorld w, DWORD dwGen);
+-- static VOID TCPSendAck(LPSimWorld w);
+-- static VOID TCPAddRange(LPSimWorld w, ULONGLONG qwStart, ULONGLONG qwEnd);
+-- static VOID TCPOnSegment(LPSimWorld w, ULONGLONG qwSeq, DWORD dwLen);
+-- static DWORD SimBufSize(INT nRequested, ULONGLONG qwBdp);
+-- static VOID SimToSystemTime(const FILETIME *ftBase, ULONGLONG qwNs, LPSYSTEMTIME st);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file is the simulated-network mode. A lossy-link experiment in real time spends most of its time waiting
+--			(the receiver gives up on lost UDP packets only after COMM_TIMEOUT, and TCP sits out retransmission
+--			timeouts), so instead the test-packet transfer is replayed as a discrete-event simulation: the sender, the
+--			link and the receiver are models driven from one queue of timed events on a virtual clock, and a transfer
+--			that would take an hour takes as long as it takes to process its events. Every random decision comes from
+--			the seed, so a run can be replayed exactly, and -simsweep runs a whole file of link profiles unattended.
+--
+--			The sender's NIC runs at the -linkmbps rate and feeds a bottleneck with the simulated rate, a drop-tail
+--			queue, a random loss rate and half the RTT of propagation delay each way; ACKs come back without loss or
+--			queueing. The ends follow the real ones' rules: the UDP sender posts a datagram each time the last one
+--			completes, datagrams bigger than a fragment are split into IP fragments and lost if any fragment is, the
+--			receiver times its transfer from the first datagram to the last, and the sender's end-of-stream markers
+--			follow the data, one every CONTROL_RETRY_MS until one gets through (see Control.cpp). Only if all
+--			CONTROL_TRIES are lost does the receiver wait COMM_TIMEOUT for the datagrams that are missing. TCP is
+--			modelled as NewReno with a ten-segment initial window, Nagle's algorithm unless the tuning profile turns
+--			it off, delayed ACKs, Windows' 300 ms minimum RTO and socket buffers taken from the tuning profile
+--			(autotuned ones get twice the bandwidth-delay product). The receiver times the transfer from the accept
+--			to the last byte of data, as Serve does.
+--
+--			It's a model, not the real stack: there's no SACK, no cross traffic and no loss on the ACK path, and
+--			only test-packet transfers (not files) are simulated.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Sim.h"
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SimRandom
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SimRandom(LPSimWorld w)
+--						LPSimWorld w:	The simulation to draw for.
+--
+-- RETURNS: A uniformly distributed number in [0, 1).
+--
+-- NOTES:
+-- splitmix64, seeded from the simulation's seed; the same seed gives the same sequence on every machine.
+---------------------------------------------------------------------------------------------------------------------------*/
+static double SimRandom(LPSimWorld w)
+{
+	ULONGLONG z = (w->qwRng += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z ^= z >> 31;
+	return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Before
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Before(const SimEvent *a, const SimEvent *b)
+--
+-- RETURNS: TRUE if a happens before b; events at the same time happen in the order they were scheduled.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL Before(const SimEvent *a, const SimEvent *b)
+{
+	return a->qwTime < b->qwTime || (a->qwTime == b->qwTime && a->qwOrder < b->qwOrder);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PushEvent
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PushEvent(LPSimWorld w, ULONGLONG qwTime, DWORD dwType, DWORD dwArg, ULONGLONG qwSeq)
+--						LPSimWorld w:		The simulation.
+--						ULONGLONG qwTime:	When the event happens.
+--						DWORD dwType:		SIM_EV_*.
+--						DWORD dwArg:		See SimEvent.
+--						ULONGLONG qwSeq:	See SimEvent.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- The heap grows as needed; if it can't, the simulation is marked as failed and stops at the next event.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID PushEvent(LPSimWorld w, ULONGLONG qwTime, DWORD dwType, DWORD dwArg, ULONGLONG qwSeq)
+{
+	SimEvent	ev;
+	LPSimEvent	grown;
+	DWORD		i, parent;
+
+	if (w->dwEvents == w->dwEventCap)
+	{
+		if ((grown = (LPSimEvent)realloc(w->events, 2 * w->dwEventCap * sizeof(SimEvent))) == NULL)
+		{
+			w->bFailed = TRUE;
+			return;
+		}
+		w->events = grown;
+		w->dwEventCap *= 2;
+	}
+
+	ev.qwTime	= qwTime;
+	ev.qwOrder	= w->qwOrder++;
+	ev.dwType	= dwType;
+	ev.dwArg	= dwArg;
+	ev.qwSeq	= qwSeq;
+
+	for (i = w->dwEvents++; i > 0 && Before(&ev, &w->events[parent = (i - 1) / 2]); i = parent)
+		w->events[i] = w->events[parent];
+	w->events[i] = ev;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PopEvent
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PopEvent(LPSimWorld w)
+--
+-- RETURNS: The earliest event; the heap mustn't be empty.
+---------------------------------------------------------------------------------------------------------------------------*/
+static SimEvent PopEvent(LPSimWorld w)
+{
+	SimEvent	top		= w->events[0];
+	SimEvent	last	= w->events[--w->dwEvents];
+	DWORD		i		= 0;
+	DWORD		child;
+
+	while ((child = 2 * i + 1) < w->dwEvents)
+	{
+		if (child + 1 < w->dwEvents && Before(&w->events[child + 1], &w->events[child]))
+			child++;
+		if (!Before(&w->events[child], &last))
+			break;
+		w->events[i] = w->events[child];
+		i = child;
+	}
+	w->events[i] = last;
+	return top;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendOnLink
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendOnLink(LPSimWorld w, DWORD dwBytes, ULONGLONG *pqwArrive)
+--						LPSimWorld w:			The simulation.
+--						DWORD dwBytes:			The size of the packet on the wire, headers included.
+--						ULONGLONG *pqwArrive:	Receives when the packet reaches the receiver.
+--
+-- RETURNS: FALSE if the packet was dropped by the bottleneck queue or lost; TRUE otherwise.
+--
+-- NOTES:
+-- The packet is sent now; it's serialised by the NIC, then waits its turn for the bottleneck. The NIC never drops
+-- (the sender's own socket holds packets back instead), but the bottleneck drops packets that arrive to a full queue.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL SendOnLink(LPSimWorld w, DWORD dwBytes, ULONGLONG *pqwArrive)
+{
+	ULONGLONG qwAtLink;
+
+	if (w->qwHostFree < w->qwNow)
+		w->qwHostFree = w->qwNow;
+	w->qwHostFree += (ULONGLONG)(dwBytes * 8e9 / w->dHostBps);
+	qwAtLink = w->qwHostFree;
+
+	if (w->qwLinkFree < qwAtLink)
+		w->qwLinkFree = qwAtLink;
+	if ((w->qwLinkFree - qwAtLink) * w->dRateBps / 8e9 + dwBytes > w->dwQueueBytes)
+	{
+		w->sim->dwQueueDrops++;
+		return FALSE;
+	}
+	w->qwLinkFree += (ULONGLONG)(dwBytes * 8e9 / w->dRateBps);
+
+	if (w->sim->dLoss > 0 && SimRandom(w) < w->sim->dLoss)
+	{
+		w->sim->dwLinkLosses++;
+		return FALSE;
+	}
+	*pqwArrive = w->qwLinkFree + w->qwOneWayNs;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: UDPSendNext
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: UDPSendNext(LPSimWorld w)
+--						LPSimWorld w:	The simulation.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Sends the next datagram as its fragments. The send completes, and the next one is posted, once the NIC has sent the
+-- last fragment, as with UDPSendCompletion.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID UDPSendNext(LPSimWorld w)
+{
+	DWORD		dwLeft	= w->dwPacketSize + 8;	// UDP header
+	DWORD		dwFrag;
+	BOOL		bWhole	= TRUE;
+	ULONGLONG	qwArrive = 0;
+
+	while (dwLeft != 0)
+	{
+		dwFrag = dwLeft < SIM_FRAG_DATA ? dwLeft : SIM_FRAG_DATA;
+		bWhole &= SendOnLink(w, dwFrag + 20, &qwArrive);
+		dwLeft -= dwFrag;
+	}
+	if (bWhole)
+		PushEvent(w, qwArrive, SIM_EV_DGRAM, 0, 0);
+
+	if (++w->dwNextDgram < w->dwPackets)
+		PushEvent(w, w->qwHostFree, SIM_EV_UDPSEND, 0, 0);
+	else
+		w->sim->qwClientEnd = w->qwHostFree;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TCPArmRto
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TCPArmRto(LPSimWorld w)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- (Re)starts the retransmission timer; an earlier timer event is ignored when it goes off.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID TCPArmRto(LPSimWorld w)
+{
+	w->bRtoArmed = TRUE;
+	PushEvent(w, w->qwNow + w->qwRto, SIM_EV_RTO, ++w->dwRtoGen, 0);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TCPSendSegment
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TCPSendSegment(LPSimWorld w, ULONGLONG qwSeq, ULONGLONG qwLen)
+--						LPSimWorld w:		The simulation.
+--						ULONGLONG qwSeq:	The first byte to send.
+--						ULONGLONG qwLen:	How many (at most an MSS).
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Anything below the highest byte already sent is a retransmission, and isn't timed (Karn's algorithm).
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID TCPSendSegment(LPSimWorld w, ULONGLONG qwSeq, ULONGLONG qwLen)
+{
+	ULONGLONG qwArrive;
+
+	if (qwSeq < w->qwSndMax)
+	{
+		w->sim->dwRetransmits++;
+		if (w->bTiming && qwSeq < w->qwRttSeq)
+			w->bTiming = FALSE;
+	}
+	else if (!w->bTiming)
+	{
+		w->bTiming		= TRUE;
+		w->qwRttSeq		= qwSeq + qwLen;
+		w->qwRttStart	= w->qwNow;
+	}
+
+	if (SendOnLink(w, (DWORD)qwLen + 40, &qwArrive))
+		PushEvent(w, qwArrive, SIM_EV_SEG, (DWORD)qwLen, qwSeq);
+	if (qwSeq + qwLen > w->qwSndMax)
+		w->qwSndMax = qwSeq + qwLen;
+	if (!w->bRtoArmed)
+		TCPArmRto(w);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TCPTrySend
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TCPTrySend(LPSimWorld w)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Sends as much as the congestion and receive windows allow. With Nagle's algorithm on, a segment smaller than an MSS
+-- waits until everything sent has been acknowledged.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID TCPTrySend(LPSimWorld w)
+{
+	ULONGLONG qwWnd = w->qwCwnd < w->qwRwnd ? w->qwCwnd : w->qwRwnd;
+	ULONGLONG qwFlight;
+	ULONGLONG qwLen;
+
+	for (;;)
+	{
+		qwFlight	= w->qwSndNxt - w->qwSndUna;
+		qwLen		= w->qwAppWritten - w->qwSndNxt;
+		qwLen		= qwLen < SIM_MSS ? qwLen : SIM_MSS;
+
+		if (qwLen == 0 || qwFlight + qwLen > qwWnd)
+			break;
+		if (qwLen < SIM_MSS && w->bNagle && qwFlight != 0)
+			break;
+
+		TCPSendSegment(w, w->qwSndNxt, qwLen);
+		w->qwSndNxt += qwLen;
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TCPUpdateRtt
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TCPUpdateRtt(LPSimWorld w, ULONGLONG qwSample)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- RFC 6298, with Windows' minimum RTO.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID TCPUpdateRtt(LPSimWorld w, ULONGLONG qwSample)
+{
+	ULONGLONG qwDiff;
+
+	if (!w->bRttValid)
+	{
+		w->qwSrtt		= qwSample;
+		w->qwRttVar		= qwSample / 2;
+		w->bRttValid	= TRUE;
+	}
+	else
+	{
+		qwDiff		= w->qwSrtt > qwSample ? w->qwSrtt - qwSample : qwSample - w->qwSrtt;
+		w->qwRttVar	= (3 * w->qwRttVar + qwDiff) / 4;
+		w->qwSrtt	= (7 * w->qwSrtt + qwSample) / 8;
+	}
+
+	w->qwRto = w->qwSrtt + 4 * w->qwRttVar;
+	if (w->qwRto < SIM_MIN_RTO_NS)
+		w->qwRto = SIM_MIN_RTO_NS;
+	if (w->qwRto > SIM_MAX_RTO_NS)
+		w->qwRto = SIM_MAX_RTO_NS;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TCPOnAck
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TCPOnAck(LPSimWorld w, ULONGLONG qwAck, DWORD dwRwnd)
+--						LPSimWorld w:		The simulation.
+--						ULONGLONG qwAck:	The receiver's next expected byte.
+--						DWORD dwRwnd:		The window it advertised.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- New data acknowledged grows the congestion window (slow start, then congestion avoidance), frees room in the send
+-- buffer for the application's next sends and restarts the retransmission timer. The third duplicate ACK starts a fast
+-- retransmit; partial ACKs during recovery retransmit the next hole (NewReno).
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID TCPOnAck(LPSimWorld w, ULONGLONG qwAck, DWORD dwRwnd)
+{
+	ULONGLONG qwAcked;
+
+	w->qwRwnd = dwRwnd;
+
+	if (qwAck > w->qwSndUna)
+	{
+		qwAcked = qwAck - w->qwSndUna;
+		if (w->bTiming && qwAck >= w->qwRttSeq)
+		{
+			TCPUpdateRtt(w, w->qwNow - w->qwRttStart);
+			w->bTiming = FALSE;
+		}
+		w->qwSndUna = qwAck;
+		if (w->qwSndNxt < qwAck)
+			w->qwSndNxt = qwAck;
+
+		if (w->bRecovery)
+		{
+			if (qwAck >= w->qwRecover)
+			{
+				w->bRecovery	= FALSE;
+				w->qwCwnd		= w->qwSsthresh;
+			}
+			else
+			{
+				TCPSendSegment(w, qwAck, w->qwSndMax - qwAck < SIM_MSS ? w->qwSndMax - qwAck : SIM_MSS);
+				w->qwCwnd = w->qwCwnd > qwAcked ? w->qwCwnd - qwAcked + SIM_MSS : SIM_MSS;
+			}
+		}
+		else if (w->qwCwnd < w->qwSsthresh)
+			w->qwCwnd += qwAcked < 2 * SIM_MSS ? qwAcked : 2 * SIM_MSS;
+		else
+			w->qwCwnd += qwAcked * SIM_MSS / w->qwCwnd + 1;
+		w->dwDupAcks = 0;
+
+		w->bRtoArmed = FALSE;
+		w->dwRtoGen++;
+		if (w->qwSndUna < w->qwSndMax)
+			TCPArmRto(w);
+
+		w->qwAppWritten = w->qwSndUna + w->dwSndBuf < w->qwTotal ? w->qwSndUna + w->dwSndBuf : w->qwTotal;
+		if (w->qwAppWritten == w->qwTotal && w->sim->qwClientEnd == 0)
+			w->sim->qwClientEnd = w->qwNow;
+	}
+	else if (qwAck == w->qwSndUna && w->qwSndMax > w->qwSndUna)
+	{
+		if (++w->dwDupAcks == 3 && !w->bRecovery)
+		{
+			w->qwSsthresh	= (w->qwSndMax - w->qwSndUna) / 2 > 2 * SIM_MSS ? (w->qwSndMax - w->qwSndUna) / 2 : 2 * SIM_MSS;
+			w->qwRecover	= w->qwSndMax;
+			w->bRecovery	= TRUE;
+			w->sim->dwFastRetransmits++;
+			TCPSendSegment(w, w->qwSndUna, w->qwSndMax - w->qwSndUna < SIM_MSS ? w->qwSndMax - w->qwSndUna : SIM_MSS);
+			w->qwCwnd = w->qwSsthresh + 3 * SIM_MSS;
+		}
+		else if (w->bRecovery)
+			w->qwCwnd += SIM_MSS;
+	}
+
+	TCPTrySend(w);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TCPOnRto
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TCPOnRto(LPSimWorld w, DWORD dwGen)
+--						LPSimWorld w:	The simulation.
+--						DWORD dwGen:	The generation of the timer that went off.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Goes back to the first unacknowledged byte with a one-segment window and doubles the timeout.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID TCPOnRto(LPSimWorld w, DWORD dwGen)
+{
+	ULONGLONG qwFlight = w->qwSndMax - w->qwSndUna;
+
+	if (dwGen != w->dwRtoGen || !w->bRtoArmed || qwFlight == 0)
+		return;
+
+	w->sim->dwTimeouts++;
+	w->qwSsthresh	= qwFlight / 2 > 2 * SIM_MSS ? qwFlight / 2 : 2 * SIM_MSS;
+	w->qwCwnd		= SIM_MSS;
+	w->qwSndNxt		= w->qwSndUna;
+	w->bRecovery	= FALSE;
+	w->dwDupAcks	= 0;
+	w->bTiming		= FALSE;
+	w->bRtoArmed	= FALSE;
+	w->qwRto		= 2 * w->qwRto < SIM_MAX_RTO_NS ? 2 * w->qwRto : SIM_MAX_RTO_NS;
+	TCPTrySend(w);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TCPSendAck
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TCPSendAck(LPSimWorld w)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- The application reads everything that arrives in order straight away, so the window advertised is the receive buffer
+-- less the out-of-order data it's holding.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID TCPSendAck(LPSimWorld w)
+{
+	w->dwUnacked	= 0;
+	w->bDelAckArmed	= FALSE;
+	w->dwDelAckGen++;
+	PushEvent(w, w->qwNow + w->qwOneWayNs, SIM_EV_ACK, (DWORD)(w->dwRcvBuf - w->qwRangeBytes), w->qwRcvNxt);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TCPAddRange
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TCPAddRange(LPSimWorld w, ULONGLONG qwStart, ULONGLONG qwEnd)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Records out-of-order data, merging it with the ranges it touches.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID TCPAddRange(LPSimWorld w, ULONGLONG qwStart, ULONGLONG qwEnd)
+{
+	LPSimRange	grown;
+	DWORD		i = 0;
+	DWORD		j;
+
+	while (i < w->dwRanges && w->ranges[i].qwEnd < qwStart)
+		i++;
+
+	// Swallow every range this one overlaps or touches
+	for (j = i; j < w->dwRanges && w->ranges[j].qwStart <= qwEnd; j++)
+	{
+		qwStart	= qwStart < w->ranges[j].qwStart ? qwStart : w->ranges[j].qwStart;
+		qwEnd	= qwEnd > w->ranges[j].qwEnd ? qwEnd : w->ranges[j].qwEnd;
+		w->qwRangeBytes -= w->ranges[j].qwEnd - w->ranges[j].qwStart;
+	}
+
+	if (j == i)
+	{
+		if (w->dwRanges == w->dwRangeCap)
+		{
+			if ((grown = (LPSimRange)realloc(w->ranges, 2 * w->dwRangeCap * sizeof(SimRange))) == NULL)
+			{
+				w->bFailed = TRUE;
+				return;
+			}
+			w->ranges = grown;
+			w->dwRangeCap *= 2;
+		}
+		memmove(&w->ranges[i + 1], &w->ranges[i], (w->dwRanges - i) * sizeof(SimRange));
+		w->dwRanges++;
+	}
+	else if (j > i + 1)
+	{
+		memmove(&w->ranges[i + 1], &w->ranges[j], (w->dwRanges - j) * sizeof(SimRange));
+		w->dwRanges -= j - i - 1;
+	}
+
+	w->ranges[i].qwStart	= qwStart;
+	w->ranges[i].qwEnd		= qwEnd;
+	w->qwRangeBytes			+= qwEnd - qwStart;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TCPOnSegment
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TCPOnSegment(LPSimWorld w, ULONGLONG qwSeq, DWORD dwLen)
+--						LPSimWorld w:		The simulation.
+--						ULONGLONG qwSeq:	The segment's first byte.
+--						DWORD dwLen:		Its length.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- In-order data is acknowledged every second segment or when the delayed ACK timer goes off; out-of-order data,
+-- duplicates and data that fills a hole are acknowledged at once.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID TCPOnSegment(LPSimWorld w, ULONGLONG qwSeq, DWORD dwLen)
+{
+	ULONGLONG	qwEnd	= qwSeq + dwLen;
+	BOOL		bFilled	= w->dwRanges != 0;
+
+	if (qwEnd <= w->qwRcvNxt)
+	{
+		TCPSendAck(w);
+		return;
+	}
+	if (qwSeq > w->qwRcvNxt)
+	{
+		TCPAddRange(w, qwSeq, qwEnd);
+		TCPSendAck(w);
+		return;
+	}
+
+	w->qwRcvNxt = qwEnd;
+	while (w->dwRanges != 0 && w->ranges[0].qwStart <= w->qwRcvNxt)
+	{
+		if (w->ranges[0].qwEnd > w->qwRcvNxt)
+			w->qwRcvNxt = w->ranges[0].qwEnd;
+		w->qwRangeBytes -= w->ranges[0].qwEnd - w->ranges[0].qwStart;
+		memmove(&w->ranges[0], &w->ranges[1], --w->dwRanges * sizeof(SimRange));
+	}
+
+	w->sim->qwDelivered = w->qwRcvNxt;
+	if (w->qwRcvNxt >= w->qwTotal && !w->bServerDone)
+	{
+		w->bServerDone		= TRUE;
+		w->sim->qwServerEnd	= w->qwNow;
+	}
+
+	if (bFilled || ++w->dwUnacked >= 2)
+		TCPSendAck(w);
+	else if (!w->bDelAckArmed)
+	{
+		w->bDelAckArmed = TRUE;
+		PushEvent(w, w->qwNow + SIM_DELACK_NS, SIM_EV_DELACK, ++w->dwDelAckGen, 0);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SimBufSize
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SimBufSize(INT nRequested, ULONGLONG qwBdp)
+--						INT nRequested:		The tuning profile's SO_SNDBUF or SO_RCVBUF.
+--						ULONGLONG qwBdp:	The simulated link's bandwidth-delay product.
+--
+-- RETURNS: The buffer size the simulated socket gets.
+--
+-- NOTES:
+-- A size the profile leaves to the kernel is autotuned, which on a long path lets the window grow to about twice the
+-- bandwidth-delay product; TUNE_AUTO sizes it to the product, as SocketTuning.cpp does.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD SimBufSize(INT nRequested, ULONGLONG qwBdp)
+{
+	ULONGLONG qwSize;
+
+	if (nRequested > 0)
+		return (DWORD)nRequested;
+	qwSize = nRequested == TUNE_AUTO ? qwBdp : 2 * qwBdp;
+	if (qwSize < SIM_MIN_BUF)
+		qwSize = SIM_MIN_BUF;
+	return qwSize > 0x40000000 ? 0x40000000 : (DWORD)qwSize;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ParseSimLink
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ParseSimLink(const CHAR *szValue, LPSimState sim)
+--						const CHAR *szValue:	<Mbit/s>,<RTT ms>[,<loss %>[,<queue KB>]]
+--						LPSimState sim:			Receives the link.
+--
+-- RETURNS: FALSE if the value isn't a link description; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ParseSimLink(const CHAR *szValue, LPSimState sim)
+{
+	double	dRate	= 0;
+	double	dRtt	= 0;
+	double	dLoss	= 0;
+	DWORD	dwQueue	= 0;
+
+	if (sscanf_s(szValue, "%lf,%lf,%lf,%lu", &dRate, &dRtt, &dLoss, &dwQueue) < 2 || dRate <= 0 || dRtt < 0 ||
+		dLoss < 0 || dLoss >= 100)
+		return FALSE;
+
+	sim->dRateMbps		= dRate;
+	sim->dwRttUs		= (DWORD)(dRtt * 1000);
+	sim->dLoss			= dLoss / 100;
+	sim->dwQueueBytes	= dwQueue * 1024;
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RunSimulation
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RunSimulation(LPSimState sim, DWORD nSockType, DWORD dwPacketSize, DWORD dwPackets, LPSocketTuning tuning)
+--						LPSimState sim:				The link and seed; receives the results.
+--						DWORD nSockType:			SOCK_STREAM or SOCK_DGRAM.
+--						DWORD dwPacketSize:			The size of each test packet.
+--						DWORD dwPackets:			How many to send.
+--						LPSocketTuning tuning:		The sender's NIC rate, Nagle and socket buffer settings.
+--
+-- RETURNS: FALSE if the simulation ran out of memory; TRUE otherwise (check bStalled for a transfer that never ended).
+--
+-- NOTES:
+-- Runs the transfer from the sender's first packet until both ends are done. TCP starts with the three-way handshake:
+-- the client sends once the SYN-ACK is back, a round trip in, and the server's transfer starts at the accept, half a
+-- round trip later.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL RunSimulation(LPSimState sim, DWORD nSockType, DWORD dwPacketSize, DWORD dwPackets, LPSocketTuning tuning)
+{
+	SimWorld		w;
+	SimEvent		ev;
+	ULONGLONG		qwBdp;
+	ULONGLONG		qwArrive;
+	LARGE_INTEGER	liStart, liEnd;
+
+	QueryPerformanceCounter(&liStart);
+	memset(&w, 0, sizeof(SimWorld));
+	sim->qwClientStart = sim->qwClientEnd = sim->qwServerStart = sim->qwServerEnd = sim->qwRunEnd = 0;
+	sim->qwDelivered = sim->qwEvents = 0;
+	sim->dwDatagrams = sim->dwQueueDrops = sim->dwLinkLosses = sim->dwRetransmits = 0;
+	sim->dwFastRetransmits = sim->dwTimeouts = sim->dwMarkers = 0;
+	sim->qwMarkerArrive = 0;
+	sim->bStalled = FALSE;
+
+	w.sim			= sim;
+	w.qwRng			= sim->dwSeed;
+	w.dHostBps		= (tuning->dwLinkMbps != 0 ? tuning->dwLinkMbps : 1000) * 1e6;
+	w.dRateBps		= sim->dRateMbps * 1e6;
+	w.qwOneWayNs	= (ULONGLONG)sim->dwRttUs * 500;
+	qwBdp			= (ULONGLONG)(w.dRateBps / 8 * sim->dwRttUs / 1e6);
+	w.dwQueueBytes	= sim->dwQueueBytes != 0 ? sim->dwQueueBytes : (DWORD)(qwBdp > 2 * SIM_MTU ? qwBdp : 2 * SIM_MTU);
+	w.dwPacketSize	= dwPacketSize;
+	w.dwPackets		= dwPackets;
+	w.qwTotal		= (ULONGLONG)dwPacketSize * dwPackets;
+	w.dwEventCap	= 1024;
+	w.dwRangeCap	= 64;
+	w.events		= (LPSimEvent)malloc(w.dwEventCap * sizeof(SimEvent));
+	w.ranges		= (LPSimRange)malloc(w.dwRangeCap * sizeof(SimRange));
+	if (w.events == NULL || w.ranges == NULL)
+	{
+		free(w.events);
+		free(w.ranges);
+		return FALSE;
+	}
+
+	if (nSockType == SOCK_DGRAM)
+	{
+		if (dwPackets != 0)
+			PushEvent(&w, 0, SIM_EV_UDPSEND, 0, 0);
+	}
+	else
+	{
+		w.qwNow				= 2 * w.qwOneWayNs;
+		sim->qwClientStart	= w.qwNow;
+		sim->qwServerStart	= 3 * w.qwOneWayNs;
+		w.bNagle			= tuning->nNoDelay != 1;
+		w.dwSndBuf			= SimBufSize(tuning->nSndBuf, qwBdp);
+		w.dwRcvBuf			= SimBufSize(tuning->nRcvBuf, qwBdp);
+		w.qwCwnd			= SIM_IW * SIM_MSS;
+		w.qwSsthresh		= ~0ULL;
+		w.qwRwnd			= w.dwRcvBuf;
+		w.qwRto				= SIM_INIT_RTO_NS;
+		w.qwAppWritten		= w.dwSndBuf < w.qwTotal ? w.dwSndBuf : w.qwTotal;
+		if (w.qwAppWritten == w.qwTotal)
+			sim->qwClientEnd = w.qwNow;
+		if (w.qwTotal == 0)
+		{
+			w.bServerDone		= TRUE;
+			sim->qwServerEnd	= sim->qwServerStart;
+		}
+		TCPTrySend(&w);
+	}
+
+	while (w.dwEvents != 0 && !w.bFailed)
+	{
+		ev = PopEvent(&w);
+		if (ev.qwTime > SIM_MAX_NS)
+		{
+			sim->bStalled = TRUE;
+			break;
+		}
+		w.qwNow = ev.qwTime;
+		sim->qwEvents++;
+
+		switch (ev.dwType)
+		{
+		case SIM_EV_UDPSEND:
+			UDPSendNext(&w);
+			break;
+		case SIM_EV_DGRAM:
+			if (sim->dwDatagrams++ == 0)
+				sim->qwServerStart = w.qwNow;
+			sim->qwServerEnd = w.qwNow;
+			sim->qwDelivered += dwPacketSize;
+			break;
+		case SIM_EV_SEG:
+			TCPOnSegment(&w, ev.qwSeq, ev.dwArg);
+			break;
+		case SIM_EV_ACK:
+			TCPOnAck(&w, ev.qwSeq, ev.dwArg);
+			break;
+		case SIM_EV_RTO:
+			TCPOnRto(&w, ev.dwArg);
+			break;
+		case SIM_EV_DELACK:
+			if (ev.dwArg == w.dwDelAckGen && w.bDelAckArmed)
+				TCPSendAck(&w);
+			break;
+		}
+
+		// TCP is done once the last byte is delivered and acknowledged; nothing else can change the results
+		if (nSockType == SOCK_STREAM && w.bServerDone && w.qwSndUna >= w.qwTotal)
+			break;
+	}
+
+	if (nSockType == SOCK_DGRAM)
+	{
+		// Nothing else is on the link once the last datagram has gone, so the markers can be sent after the fact
+		w.qwNow = sim->qwClientEnd;
+		for (sim->dwMarkers = 0; sim->dwMarkers < CONTROL_TRIES && sim->qwMarkerArrive == 0; sim->dwMarkers++)
+		{
+			if (SendOnLink(&w, SIM_MARKER_BYTES, &qwArrive))
+				sim->qwMarkerArrive = qwArrive;
+			else
+				w.qwNow += CONTROL_RETRY_MS * 1000000ULL;
+		}
+
+		// The run ends when the receiver's totals reach the sender; without a marker the receiver waits out its
+		// timeout for datagrams that never come, and the sender gives up on hearing from it
+		if (sim->qwMarkerArrive != 0)
+			sim->qwRunEnd = sim->qwMarkerArrive + w.qwOneWayNs;
+		else
+		{
+			sim->qwRunEnd = sim->qwClientEnd + CONTROL_TRIES * CONTROL_RETRY_MS * 1000000ULL;
+			if (sim->dwDatagrams < dwPackets && sim->dwDatagrams != 0 && sim->qwServerEnd + SIM_TIMEOUT_NS > sim->qwRunEnd)
+				sim->qwRunEnd = sim->qwServerEnd + SIM_TIMEOUT_NS;
+		}
+	}
+	else
+	{
+		if (!w.bServerDone && !w.bFailed)
+			sim->bStalled = TRUE;
+		sim->qwRunEnd = w.qwNow;
+	}
+
+	free(w.events);
+	free(w.ranges);
+	QueryPerformanceCounter(&liEnd);
+	sim->dWallMs = TicksToSeconds(liEnd.QuadPart - liStart.QuadPart) * 1000;
+	return !w.bFailed;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SimToSystemTime
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SimToSystemTime(const FILETIME *ftBase, ULONGLONG qwNs, LPSYSTEMTIME st)
+--						const FILETIME *ftBase:		The real time the simulation started at.
+--						ULONGLONG qwNs:				A virtual time.
+--						LPSYSTEMTIME st:			Receives the virtual time as a time of day.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID SimToSystemTime(const FILETIME *ftBase, ULONGLONG qwNs, LPSYSTEMTIME st)
+{
+	ULARGE_INTEGER	ul;
+	FILETIME		ft;
+
+	ul.LowPart		= ftBase->dwLowDateTime;
+	ul.HighPart		= ftBase->dwHighDateTime;
+	ul.QuadPart		+= qwNs / 100;
+	ft.dwLowDateTime	= ul.LowPart;
+	ft.dwHighDateTime	= ul.HighPart;
+	FileTimeToSystemTime(&ft, st);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SimulateTransfer
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SimulateTransfer(VOID *params)
+--						VOID *params:	Handle to the main window.
+--
+-- RETURNS: 0 once the report has been shown, 1 if the simulation couldn't run.
+--
+-- NOTES:
+-- Runs in place of ClientSendData/Serve when -sim is given: simulates a transfer with the dialog's settings and shows
+-- the receiver's report, with its start and end times shifted onto the virtual clock. UDP datagrams are fitted to
+-- SIM_MTU when -pmtu auto or "Path MTU" asks for it.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD WINAPI SimulateTransfer(VOID *params)
+{
+	HWND			hwnd	= (HWND)params;
+	LPTransferProps props	= (LPTransferProps)GetWindowLongPtr(hwnd, GWLP_TRANSFERPROPS);
+	LPSimState		sim		= &props->sim;
+	FILETIME		ftBase;
+	DWORD			dwSize	= props->nPacketSize;
+	DWORD			dwCount	= props->nNumToSend;
+	DWORD			dwFit	= SIM_MTU - PMTU_IPV4_HDR - PMTU_UDP_HDR;
+
+	if (props->szFileName[0] != 0)
+	{
+		MessageBox(NULL, TEXT("Only test packet transfers can be simulated; clear the file name."), TEXT("Simulation"),
+			MB_ICONERROR);
+		return 1;
+	}
+	if (props->duplex.bRequested)
+	{
+		MessageBox(NULL, TEXT("The simulated link only carries one direction; leave out -duplex."), TEXT("Simulation"),
+			MB_ICONERROR);
+		return 1;
+	}
+
+	// The modelled path's MTU is known, so fitting the datagrams to it takes no probing (see ClientTransfer.cpp)
+	props->pmtu.dwProbes = 0;
+	props->pmtu.bFit = props->nSockType == SOCK_DGRAM && (props->pmtu.bPathSize || props->pmtu.dwMode == PMTU_AUTO);
+	if (props->pmtu.bFit && props->pmtu.bPathSize)
+		props->nPacketSize = dwFit;
+	else if (props->pmtu.bFit && props->nPacketSize > dwFit)
+	{
+		props->nNumToSend = (DWORD)(((ULONGLONG)props->nPacketSize * props->nNumToSend + dwFit - 1) / dwFit);
+		props->nPacketSize = dwFit;
+	}
+
+	sim->dwSeed = props->payload.bSeedGiven ? props->payload.dwSeed : SIM_DEF_SEED;
+	if (!RunSimulation(sim, props->nSockType, props->nPacketSize, props->nNumToSend, &props->tuning))
+	{
+		MessageBox(NULL, TEXT("The simulation ran out of memory."), TEXT("Simulation"), MB_ICONERROR);
+		props->nPacketSize = dwSize;
+		props->nNumToSend = dwCount;
+		return 1;
+	}
+
+	GetSystemTimeAsFileTime(&ftBase);
+	SimToSystemTime(&ftBase, sim->qwServerStart, &props->startTime);
+	SimToSystemTime(&ftBase, sim->qwServerEnd, &props->endTime);
+	LogTransferInfo("SimLog.txt", props, sim->qwDelivered, hwnd);
+	props->nPacketSize = dwSize;
+	props->nNumToSend = dwCount;
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RunSimSweep
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RunSimSweep(LPTransferProps props)
+--						LPTransferProps props:	The tuning and seed to use; props->sim.szSweep names the profile file.
+--
+-- RETURNS: The process exit code: 0 once every profile has been run, 1 if the profile or results file couldn't be
+--			opened.
+--
+-- NOTES:
+-- Each line of the profile file is one simulation:
+--		<tcp|udp> <packet size> <packets> <Mbit/s> <RTT ms> <loss %> [<queue KB>]
+-- Blank lines and lines starting with '#' are skipped. Line n is run with the seed plus n, so any row can be replayed on
+-- its own with -sim and -seed. The results go to <profile file>.csv, one row per profile, and nothing is shown, so a
+-- sweep can run unattended.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT RunSimSweep(LPTransferProps props)
+{
+	FILE		*in, *out;
+	CHAR		szLine[256];
+	CHAR		szOut[FILENAME_SIZE + 8];
+	CHAR		szProto[8];
+	SimState	sim;
+	DWORD		dwSize, dwPackets, dwQueue;
+	DWORD		dwLine	= 0;
+	double		dRate, dRtt, dLoss, dSecs;
+	INT			n;
+
+	sprintf_s(szOut, sizeof(szOut), "%s.csv", props->sim.szSweep);
+	if (fopen_s(&in, props->sim.szSweep, "r") != 0 || in == NULL)
+	{
+		MessageBoxA(NULL, props->sim.szSweep, "Couldn't Open Profile File", MB_ICONERROR);
+		return 1;
+	}
+	if (fopen_s(&out, szOut, "w") != 0 || out == NULL)
+	{
+		fclose(in);
+		MessageBoxA(NULL, szOut, "Couldn't Create Results File", MB_ICONERROR);
+		return 1;
+	}
+
+	fprintf(out, "line,proto,packet_size,packets,mbps,rtt_ms,loss_pct,queue_kb,seed,receiver_ms,sender_ms,run_ms,"
+		"goodput_mbps,delivered_bytes,datagrams,queue_drops,link_losses,retransmits,fast_retransmits,timeouts,stalled,"
+		"events,wall_ms\n");
+
+	while (fgets(szLine, sizeof(szLine), in) != NULL)
+	{
+		dwLine++;
+		if (szLine[strspn(szLine, " \t\r\n")] == 0 || szLine[strspn(szLine, " \t")] == '#')
+			continue;
+
+		dwQueue = 0;
+		n = sscanf_s(szLine, "%7s %lu %lu %lf %lf %lf %lu", szProto, (unsigned)sizeof(szProto), &dwSize, &dwPackets,
+			&dRate, &dRtt, &dLoss, &dwQueue);
+		if (n < 6 || (_stricmp(szProto, "tcp") != 0 && _stricmp(szProto, "udp") != 0) || dRate <= 0 || dRtt < 0 ||
+			dLoss < 0 || dLoss >= 100)
+		{
+			fprintf(out, "# line %lu skipped: not <tcp|udp> <size> <packets> <Mbit/s> <RTT ms> <loss %%> [<queue KB>]\n",
+				dwLine);
+			continue;
+		}
+
+		memset(&sim, 0, sizeof(SimState));
+		sim.dRateMbps		= dRate;
+		sim.dwRttUs			= (DWORD)(dRtt * 1000);
+		sim.dLoss			= dLoss / 100;
+		sim.dwQueueBytes	= dwQueue * 1024;
+		sim.dwSeed			= (props->payload.bSeedGiven ? props->payload.dwSeed : SIM_DEF_SEED) + dwLine;
+		if (!RunSimulation(&sim, _stricmp(szProto, "tcp") == 0 ? SOCK_STREAM : SOCK_DGRAM, dwSize, dwPackets,
+			&props->tuning))
+		{
+			fprintf(out, "# line %lu skipped: out of memory\n", dwLine);
+			continue;
+		}
+
+		dSecs = (sim.qwServerEnd - sim.qwServerStart) / 1e9;
+		fprintf(out, "%lu,%s,%lu,%lu,%g,%g,%g,%lu,%lu,%.3f,%.3f,%.3f,%.3f,%llu,%lu,%lu,%lu,%lu,%lu,%lu,%d,%llu,%.3f\n",
+			dwLine, szProto, dwSize, dwPackets, dRate, dRtt, dLoss, dwQueue, sim.dwSeed,
+			(sim.qwServerEnd - sim.qwServerStart) / 1e6, (sim.qwClientEnd - sim.qwClientStart) / 1e6, sim.qwRunEnd / 1e6,
+			dSecs > 0 ? sim.qwDelivered * 8 / dSecs / 1e6 : 0.0, sim.qwDelivered, sim.dwDatagrams, sim.dwQueueDrops,
+			sim.dwLinkLosses, sim.dwRetransmits, sim.dwFastRetransmits, sim.dwTimeouts, sim.bStalled, sim.qwEvents,
+			sim.dWallMs);
+		fflush(out);
+	}
+
+	fclose(in);
+	fclose(out);
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatSimReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatSimReport(CHAR *buf, size_t size, LPSimState sim, DWORD nSockType)
+--							CHAR *buf:			The buffer to write the report section into.
+--							size_t size:		The space left in buf.
+--							LPSimState sim:		The simulated transfer.
+--							DWORD nSockType:	SOCK_STREAM or SOCK_DGRAM.
+--
+-- RETURNS: The number of characters written.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatSimReport(CHAR *buf, size_t size, LPSimState sim, DWORD nSockType)
+{
+	INT		written;
+	CHAR	szQueue[32] = "a one-BDP queue";
+	double	dRunMs = sim->qwRunEnd / 1e6;
+
+	if (sim->dwQueueBytes != 0)
+		sprintf_s(szQueue, sizeof(szQueue), "a %lu KB queue", sim->dwQueueBytes / 1024);
+	written = sprintf_s(buf, size, "Simulated link: %.1f Mbit/s, %.2f ms RTT, %.2f%% loss, %s, seed %lu\r\n",
+		sim->dRateMbps, sim->dwRttUs / 1000.0, sim->dLoss * 100, szQueue, sim->dwSeed);
+	written += sprintf_s(buf + written, size - written,
+		"Simulated: sender %.3f ms, whole run %.3f ms; %llu events in %.1f ms (%.0fx real time)%s\r\n",
+		(sim->qwClientEnd - sim->qwClientStart) / 1e6, dRunMs, sim->qwEvents, sim->dWallMs,
+		sim->dWallMs > 0 ? dRunMs / sim->dWallMs : 0.0, sim->bStalled ? "; the transfer never finished" : "");
+
+	if (nSockType == SOCK_STREAM)
+		written += sprintf_s(buf + written, size - written,
+			"Retransmissions: %lu (%lu fast retransmits, %lu timeouts); %lu queue drops, %lu link losses\r\n",
+			sim->dwRetransmits, sim->dwFastRetransmits, sim->dwTimeouts, sim->dwQueueDrops, sim->dwLinkLosses);
+	else
+		written += sprintf_s(buf + written, size - written,
+			"Datagrams delivered: %lu; fragments dropped: %lu by the queue, %lu lost on the link; %lu end-of-stream "
+			"markers sent%s\r\n", sim->dwDatagrams, sim->dwQueueDrops, sim->dwLinkLosses, sim->dwMarkers,
+			sim->qwMarkerArrive != 0 ? "" : ", none arrived");
+	return written;
+}
@@ -0,0 +1,120 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <WinSock2.h>
+#include <Windows.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Control.h"
+#include "Pmtu.h"
+
+#ifndef COMM_TIMEOUT
+	#define COMM_TIMEOUT 5000
+#endif
+
+#define SIM_MTU				1500
+#define SIM_MSS				1460					// MTU less the IP and TCP headers
+#define SIM_FRAG_DATA		1480					// Datagram bytes per IP fragment
+#define SIM_MARKER_BYTES	(sizeof(ControlMsg) + 28)	// An end-of-stream marker on the wire
+#define SIM_IW				10						// Initial congestion window, in segments
+#define SIM_MIN_BUF			65536					// Smallest socket buffer an autotuned socket has
+#define SIM_DELACK_NS		200000000ULL			// Delayed ACK timer
+#define SIM_INIT_RTO_NS		1000000000ULL
+#define SIM_MIN_RTO_NS		300000000ULL			// Windows' minimum retransmission timeout
+#define SIM_MAX_RTO_NS		60000000000ULL
+#define SIM_TIMEOUT_NS		(COMM_TIMEOUT * 1000000ULL)	// The receiver's UDP timeout
+#define SIM_MAX_NS			(24ULL * 3600 * 1000000000ULL)	// Give up on a transfer that hasn't finished by then
+#define SIM_DEF_SEED		1
+
+#define SIM_EV_UDPSEND		0						// The sender's last datagram has left the NIC
+#define SIM_EV_DGRAM		1						// A whole datagram has reached the receiver
+#define SIM_EV_SEG			2						// A TCP segment has reached the receiver
+#define SIM_EV_ACK			3						// An ACK has reached the sender
+#define SIM_EV_RTO			4						// The retransmission timer has gone off
+#define SIM_EV_DELACK		5						// The delayed ACK timer has gone off
+
+typedef struct _SimEvent
+{
+	ULONGLONG	qwTime;
+	ULONGLONG	qwOrder;		// Breaks ties in the order events were scheduled, so runs repeat exactly
+	DWORD		dwType;
+	DWORD		dwArg;			// Timer generation, segment length or advertised window
+	ULONGLONG	qwSeq;			// Sequence or acknowledgement number
+} SimEvent, *LPSimEvent;
+
+/* A run of bytes the receiver holds beyond a hole. */
+typedef struct _SimRange
+{
+	ULONGLONG	qwStart;
+	ULONGLONG	qwEnd;
+} SimRange, *LPSimRange;
+
+/* Everything one simulation run works on. */
+typedef struct _SimWorld
+{
+	LPSimState	sim;
+	ULONGLONG	qwNow;
+	ULONGLONG	qwOrder;
+	LPSimEvent	events;			// Heap, earliest first
+	DWORD		dwEvents;
+	DWORD		dwEventCap;
+	ULONGLONG	qwRng;
+
+	double		dHostBps;		// The sender's NIC
+	double		dRateBps;		// The bottleneck
+	ULONGLONG	qwOneWayNs;
+	DWORD		dwQueueBytes;
+	ULONGLONG	qwHostFree;		// When the NIC and the bottleneck finish what they've been given
+	ULONGLONG	qwLinkFree;
+
+	DWORD		dwPacketSize;
+	DWORD		dwPackets;
+	ULONGLONG	qwTotal;		// Bytes to transfer
+	DWORD		dwNextDgram;
+
+	ULONGLONG	qwSndUna;		// TCP sender
+	ULONGLONG	qwSndNxt;
+	ULONGLONG	qwSndMax;
+	ULONGLONG	qwAppWritten;	// Bytes the application has handed to the socket
+	ULONGLONG	qwCwnd;
+	ULONGLONG	qwSsthresh;
+	ULONGLONG	qwRwnd;
+	ULONGLONG	qwRecover;
+	DWORD		dwDupAcks;
+	BOOL		bRecovery;
+	BOOL		bNagle;
+	DWORD		dwSndBuf;
+	ULONGLONG	qwSrtt;
+	ULONGLONG	qwRttVar;
+	ULONGLONG	qwRto;
+	BOOL		bRttValid;
+	BOOL		bTiming;		// A segment is being timed for an RTT sample
+	ULONGLONG	qwRttSeq;
+	ULONGLONG	qwRttStart;
+	DWORD		dwRtoGen;		// Timers are cancelled by bumping their generation
+	BOOL		bRtoArmed;
+
+	ULONGLONG	qwRcvNxt;		// TCP receiver
+	LPSimRange	ranges;			// Out-of-order data, in order
+	DWORD		dwRanges;
+	DWORD		dwRangeCap;
+	ULONGLONG	qwRangeBytes;
+	DWORD		dwRcvBuf;
+	DWORD		dwUnacked;		// Segments received since the last ACK
+	DWORD		dwDelAckGen;
+	BOOL		bDelAckArmed;
+
+	BOOL		bServerDone;
+	BOOL		bFailed;		// Out of memory
+} SimWorld, *LPSimWorld;
+
+BOOL ParseSimLink(const CHAR *szValue, LPSimState sim);
+BOOL RunSimulation(LPSimState sim, DWORD nSockType, DWORD dwPacketSize, DWORD dwPackets, LPSocketTuning tuning);
+DWORD WINAPI SimulateTransfer(VOID *params);
+INT RunSimSweep(LPTransferProps props);
+INT FormatSimReport(CHAR *buf, size_t size, LPSimState sim, DWORD nSockType);
+
+#endif
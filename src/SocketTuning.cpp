@@ -0,0 +1,475 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: SocketTuning.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- BOOL LoadTuningProfile(LPSocketTuning tuning, const TCHAR *szProfile);
+-- BOOL ApplySocketTuning(SOCKET s, LPSocketTuning tuning, DWORD nSockType);
+-- VOID AutoTuneSocket(SOCKET s, LPSocketTuning tuning, DWORD nSockType, DWORD dwRttUs);
+-- DWORD QuerySocketRtt(SOCKET s);
+-- VOID ReadEffectiveTuning(SOCKET s, LPSocketTuning tuning, DWORD nSockType);
+-- INT FormatTuningReport(CHAR *buf, size_t size, LPSocketTuning tuning);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file contains the socket tuning profiles. A profile is a named set of socket options (Nagle, buffer
+--			sizes, cork, busy polling and DSCP) which is applied to the transfer socket before it connects/binds. The
+--			"auto" profile sizes the buffers from the bandwidth-delay product once the RTT has been measured. Options
+--			which don't exist on this platform are skipped and reported as unsupported rather than treated as errors.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "SocketTuning.h"
+
+/* A row in the profile table; every value is either a setting or TUNE_KEEP/TUNE_AUTO. */
+typedef struct _TuningProfile
+{
+	const TCHAR	*szName;
+	INT			nNoDelay;
+	INT			nSndBuf;
+	INT			nRcvBuf;
+	INT			nCork;
+	INT			nBusyPoll;
+	INT			nDscp;
+} TuningProfile;
+
+static const TuningProfile profiles[] =
+{
+	//	Name					Nagle off	SO_SNDBUF			SO_RCVBUF			Cork		Busy poll	DSCP
+	{ TEXT("default"),		TUNE_KEEP,	TUNE_KEEP,			TUNE_KEEP,			TUNE_KEEP,	TUNE_KEEP,	TUNE_KEEP },
+	{ TEXT("nonagle"),		1,			TUNE_KEEP,			TUNE_KEEP,			TUNE_KEEP,	TUNE_KEEP,	TUNE_KEEP },
+	{ TEXT("bulk"),			0,			4 * 1024 * 1024,	4 * 1024 * 1024,	1,			TUNE_KEEP,	10 },	// AF11
+	{ TEXT("lowlatency"),	1,			TUNE_KEEP,			TUNE_KEEP,			0,			50,			46 },	// EF
+	{ TEXT("auto"),			TUNE_KEEP,	TUNE_AUTO,			TUNE_AUTO,			TUNE_KEEP,	TUNE_KEEP,	TUNE_KEEP },
+};
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LoadTuningProfile
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LoadTuningProfile(LPSocketTuning tuning, const TCHAR *szProfile)
+--							LPSocketTuning tuning:	The tuning structure to fill.
+--							TCHAR *szProfile:		The profile name (case insensitive).
+--
+-- RETURNS: FALSE if there is no profile with that name (the structure is left untouched); TRUE otherwise.
+--
+-- NOTES:
+-- Copies the requested values for a named profile into the tuning structure and clears the effective values left over
+-- from a previous run. The link rate and last measured RTT are kept, since they describe the link rather than the profile.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL LoadTuningProfile(LPSocketTuning tuning, const TCHAR *szProfile)
+{
+	for (DWORD i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+	{
+		if (_tcsicmp(profiles[i].szName, szProfile) != 0)
+			continue;
+
+		_tcscpy_s(tuning->szProfile, profiles[i].szName);
+		tuning->nNoDelay	= profiles[i].nNoDelay;
+		tuning->nSndBuf		= profiles[i].nSndBuf;
+		tuning->nRcvBuf		= profiles[i].nRcvBuf;
+		tuning->nCork		= profiles[i].nCork;
+		tuning->nBusyPoll	= profiles[i].nBusyPoll;
+		tuning->nDscp		= profiles[i].nDscp;
+		tuning->qwBdp		= 0;
+
+		if (tuning->dwLinkMbps == 0)
+			tuning->dwLinkMbps = TUNE_DEF_LINKMBPS;
+
+		tuning->nEffNoDelay = tuning->nEffSndBuf = tuning->nEffRcvBuf = TUNE_KEEP;
+		tuning->nEffCork = tuning->nEffBusyPoll = tuning->nEffDscp = TUNE_KEEP;
+		tuning->nEffFastPath = TUNE_KEEP;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: BdpBufferSize
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: BdpBufferSize(LPSocketTuning tuning, DWORD dwRttUs)
+--							LPSocketTuning tuning:	The tuning structure holding the link rate; the BDP is stored here.
+--							DWORD dwRttUs:			The round trip time in microseconds (0 to use the last known RTT).
+--
+-- RETURNS: The buffer size to use, clamped to [TUNE_MINBUF, TUNE_MAXBUF].
+--
+-- NOTES:
+-- Mbit/s * us / 8 gives bytes directly, so the product needs no unit conversion beyond the division.
+---------------------------------------------------------------------------------------------------------------------------*/
+static INT BdpBufferSize(LPSocketTuning tuning, DWORD dwRttUs)
+{
+	if (dwRttUs == 0)
+		dwRttUs = tuning->dwRttUs ? tuning->dwRttUs : TUNE_DEF_RTT_US;
+
+	tuning->dwRttUs = dwRttUs;
+	tuning->qwBdp = (ULONGLONG)tuning->dwLinkMbps * dwRttUs / 8;
+
+	if (tuning->qwBdp < TUNE_MINBUF)
+		return TUNE_MINBUF;
+	if (tuning->qwBdp > TUNE_MAXBUF)
+		return TUNE_MAXBUF;
+	return (INT)tuning->qwBdp;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SetIntOption
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SetIntOption(SOCKET s, INT level, INT name, INT value)
+--
+-- RETURNS: TRUE if setsockopt succeeded or the value is TUNE_KEEP; FALSE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL SetIntOption(SOCKET s, INT level, INT name, INT value)
+{
+	if (value == TUNE_KEEP)
+		return TRUE;
+	return setsockopt(s, level, name, (const char *)&value, sizeof(value)) != SOCKET_ERROR;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GetIntOption
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GetIntOption(SOCKET s, INT level, INT name)
+--
+-- RETURNS: The option's value, or TUNE_UNSUPPORTED if the kernel won't report it.
+---------------------------------------------------------------------------------------------------------------------------*/
+static INT GetIntOption(SOCKET s, INT level, INT name)
+{
+	INT value = 0;
+	INT size = sizeof(value);
+
+	if (getsockopt(s, level, name, (char *)&value, &size) == SOCKET_ERROR)
+		return TUNE_UNSUPPORTED;
+	return value;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GetDscpOption
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GetDscpOption(SOCKET s, INT *level, INT *name)
+--							SOCKET s:	The socket whose traffic class is wanted.
+--							INT *level:	Receives IPPROTO_IPV6 or IPPROTO_IP.
+--							INT *name:	Receives IPV6_TCLASS or IP_TOS.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- IPv6 sockets carry the DSCP in the traffic class rather than the TOS byte. The socket isn't bound yet when the
+-- profile is applied, so getsockname fails there and the family comes from the socket's protocol info instead.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID GetDscpOption(SOCKET s, INT *level, INT *name)
+{
+	SOCKADDR_STORAGE	addr;
+	WSAPROTOCOL_INFO	info;
+	INT					size = sizeof(addr);
+	INT					nFamily = AF_INET;
+
+	if (getsockname(s, (struct sockaddr *)&addr, &size) != SOCKET_ERROR)
+		nFamily = addr.ss_family;
+	else
+	{
+		size = sizeof(info);
+		if (getsockopt(s, SOL_SOCKET, SO_PROTOCOL_INFO, (char *)&info, &size) != SOCKET_ERROR)
+			nFamily = info.iAddressFamily;
+	}
+
+	*level = (nFamily == AF_INET6) ? IPPROTO_IPV6 : IPPROTO_IP;
+	*name = (nFamily == AF_INET6) ? IPV6_TCLASS : IP_TOS;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ApplySocketTuning
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ApplySocketTuning(SOCKET s, LPSocketTuning tuning, DWORD nSockType)
+--							SOCKET s:				The socket to tune.
+--							LPSocketTuning tuning:	The profile to apply.
+--							DWORD nSockType:		SOCK_STREAM or SOCK_DGRAM; TCP-only options are skipped for UDP.
+--
+-- RETURNS: FALSE if any supported option was rejected by the kernel; TRUE otherwise.
+--
+-- NOTES:
+-- This must be called before connect/listen so that the receive buffer is in place when the window scale is negotiated.
+-- Auto-sized buffers use the last known RTT here; AutoTuneSocket corrects them once the connection has measured one.
+-- Winsock has no TCP_CORK, so cork falls back to leaving Nagle on, which coalesces small writes in the same way.
+-- Nor has it SO_BUSY_POLL; with -busypoll, TCP sockets ask for the loopback fast path instead, which skips most of the
+-- stack between two ends on the same host (it only takes effect if both ends ask for it before they connect).
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL ApplySocketTuning(SOCKET s, LPSocketTuning tuning, DWORD nSockType)
+{
+	BOOL bOk = TRUE;
+	INT	 nSndBuf = tuning->nSndBuf == TUNE_AUTO ? BdpBufferSize(tuning, 0) : tuning->nSndBuf;
+	INT	 nRcvBuf = tuning->nRcvBuf == TUNE_AUTO ? BdpBufferSize(tuning, 0) : tuning->nRcvBuf;
+	INT	 nBusyPoll = (tuning->nBusyPoll == TUNE_KEEP && tuning->bBusyPoll) ? TUNE_BUSYPOLL_US : tuning->nBusyPoll;
+	INT	 nDscpLevel, nDscpName;
+
+	bOk &= SetIntOption(s, SOL_SOCKET, SO_SNDBUF, nSndBuf);
+	bOk &= SetIntOption(s, SOL_SOCKET, SO_RCVBUF, nRcvBuf);
+
+	if (tuning->nDscp != TUNE_KEEP)
+	{
+		GetDscpOption(s, &nDscpLevel, &nDscpName);
+		bOk &= SetIntOption(s, nDscpLevel, nDscpName, tuning->nDscp << 2);
+	}
+
+#ifdef SO_BUSY_POLL
+	bOk &= SetIntOption(s, SOL_SOCKET, SO_BUSY_POLL, nBusyPoll);
+#endif
+
+	if (nSockType != SOCK_STREAM)
+		return bOk;
+
+	bOk &= SetIntOption(s, IPPROTO_TCP, TCP_NODELAY, tuning->nNoDelay);
+
+#ifdef SIO_LOOPBACK_FAST_PATH
+	// Accepted sockets can't ask for it, but inherit it from the listener
+	if (tuning->bBusyPoll)
+	{
+		INT		nOn = 1;
+		DWORD	dwBytes;
+
+		if (WSAIoctl(s, SIO_LOOPBACK_FAST_PATH, &nOn, sizeof(nOn), NULL, 0, &dwBytes, NULL, NULL) == 0)
+			tuning->nEffFastPath = 1;
+		else if (tuning->nEffFastPath != 1)
+			tuning->nEffFastPath = TUNE_UNSUPPORTED;
+	}
+#endif
+
+#ifdef TCP_CORK
+	bOk &= SetIntOption(s, IPPROTO_TCP, TCP_CORK, tuning->nCork);
+#else
+	if (tuning->nCork == 1 && tuning->nNoDelay != 1)
+		bOk &= SetIntOption(s, IPPROTO_TCP, TCP_NODELAY, 0);
+#endif
+	return bOk;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AutoTuneSocket
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AutoTuneSocket(SOCKET s, LPSocketTuning tuning, DWORD nSockType, DWORD dwRttUs)
+--							SOCKET s:				The connected socket.
+--							LPSocketTuning tuning:	The tuning in effect.
+--							DWORD nSockType:		SOCK_STREAM or SOCK_DGRAM.
+--							DWORD dwRttUs:			The measured RTT, or 0 if none could be measured.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Re-sizes any TUNE_AUTO buffers from RTT x link rate. For TCP the kernel's smoothed RTT is preferred over dwRttUs (which
+-- is normally just the handshake time) when the stack will report it. The effective values are read back afterwards.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID AutoTuneSocket(SOCKET s, LPSocketTuning tuning, DWORD nSockType, DWORD dwRttUs)
+{
+	if (nSockType == SOCK_STREAM)
+	{
+		DWORD dwKernelRtt = QuerySocketRtt(s);
+		if (dwKernelRtt != 0)
+			dwRttUs = dwKernelRtt;
+	}
+
+	if (dwRttUs != 0)
+		tuning->dwRttUs = dwRttUs; // Remember it even if nothing is auto-sized so a later auto run can start from it
+
+	if (tuning->nSndBuf == TUNE_AUTO)
+		SetIntOption(s, SOL_SOCKET, SO_SNDBUF, BdpBufferSize(tuning, dwRttUs));
+	if (tuning->nRcvBuf == TUNE_AUTO)
+		SetIntOption(s, SOL_SOCKET, SO_RCVBUF, BdpBufferSize(tuning, dwRttUs));
+
+	ReadEffectiveTuning(s, tuning, nSockType);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: QuerySocketRtt
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: QuerySocketRtt(SOCKET s)
+--							SOCKET s: A connected TCP socket.
+--
+-- RETURNS: The kernel's smoothed RTT for the connection in microseconds, or 0 if it isn't available.
+--
+-- NOTES:
+-- SIO_TCP_INFO is only available from Windows 10 1703; older stacks simply fail the ioctl.
+---------------------------------------------------------------------------------------------------------------------------*/
+DWORD QuerySocketRtt(SOCKET s)
+{
+#ifdef SIO_TCP_INFO
+	DWORD		dwVersion = 0;
+	DWORD		dwReturned = 0;
+	TCP_INFO_v0	info;
+
+	if (WSAIoctl(s, SIO_TCP_INFO, &dwVersion, sizeof(dwVersion), &info, sizeof(info), &dwReturned, NULL, NULL) == 0)
+		return info.RttUs;
+#endif
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ReadEffectiveTuning
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ReadEffectiveTuning(SOCKET s, LPSocketTuning tuning, DWORD nSockType)
+--							SOCKET s:				The tuned socket.
+--							LPSocketTuning tuning:	Receives the effective values.
+--							DWORD nSockType:		SOCK_STREAM or SOCK_DGRAM.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Reads every option back from the kernel; the kernel may round, clamp or silently ignore what was asked for (Windows
+-- ignores IP_TOS/IPV6_TCLASS unless a QoS policy allows it), so these are the values that go in the report.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID ReadEffectiveTuning(SOCKET s, LPSocketTuning tuning, DWORD nSockType)
+{
+	INT nTos, nDscpLevel, nDscpName;
+
+	tuning->nEffSndBuf = GetIntOption(s, SOL_SOCKET, SO_SNDBUF);
+	tuning->nEffRcvBuf = GetIntOption(s, SOL_SOCKET, SO_RCVBUF);
+
+	GetDscpOption(s, &nDscpLevel, &nDscpName);
+	nTos = GetIntOption(s, nDscpLevel, nDscpName);
+	tuning->nEffDscp = (nTos == TUNE_UNSUPPORTED) ? TUNE_UNSUPPORTED : (nTos >> 2);
+
+#ifdef SO_BUSY_POLL
+	tuning->nEffBusyPoll = GetIntOption(s, SOL_SOCKET, SO_BUSY_POLL);
+#else
+	tuning->nEffBusyPoll = TUNE_UNSUPPORTED;
+#endif
+
+	if (nSockType != SOCK_STREAM)
+	{
+		tuning->nEffNoDelay = TUNE_UNSUPPORTED;
+		tuning->nEffCork = TUNE_UNSUPPORTED;
+		return;
+	}
+
+	// Some stacks report TCP_NODELAY as any non-zero value; only a real answer is folded to 0 or 1
+	tuning->nEffNoDelay = GetIntOption(s, IPPROTO_TCP, TCP_NODELAY);
+	if (tuning->nEffNoDelay != TUNE_UNSUPPORTED)
+		tuning->nEffNoDelay = tuning->nEffNoDelay ? 1 : 0;
+#ifdef TCP_CORK
+	tuning->nEffCork = GetIntOption(s, IPPROTO_TCP, TCP_CORK);
+#else
+	tuning->nEffCork = TUNE_UNSUPPORTED;
+#endif
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatTuningValue
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatTuningValue(CHAR *buf, size_t size, const char *szName, INT value, const char *szUnit)
+--
+-- RETURNS: The number of characters written.
+---------------------------------------------------------------------------------------------------------------------------*/
+static INT FormatTuningValue(CHAR *buf, size_t size, const char *szName, INT value, const char *szUnit)
+{
+	switch (value)
+	{
+	case TUNE_KEEP:
+		return sprintf_s(buf, size, "%s: not set\r\n", szName);
+	case TUNE_UNSUPPORTED:
+		return sprintf_s(buf, size, "%s: unsupported\r\n", szName);
+	default:
+		return sprintf_s(buf, size, "%s: %d%s\r\n", szName, value, szUnit);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatTuningReport
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatTuningReport(CHAR *buf, size_t size, LPSocketTuning tuning)
+--							CHAR *buf:				The buffer to write the report section into.
+--							size_t size:			The space left in buf.
+--							LPSocketTuning tuning:	The tuning in effect for the run.
+--
+-- RETURNS: The number of characters written.
+--
+-- NOTES:
+-- Formats the effective kernel values for the transfer log.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatTuningReport(CHAR *buf, size_t size, LPSocketTuning tuning)
+{
+	INT		written = 0;
+	CHAR	szProfile[PROFILE_SIZE];
+
+	TCHAR_2_CHAR(szProfile, tuning->szProfile, PROFILE_SIZE);
+	written += sprintf_s(buf, size, "Socket profile: %s\r\n", szProfile);
+	written += FormatTuningValue(buf + written, size - written, "TCP_NODELAY", tuning->nEffNoDelay, "");
+	written += FormatTuningValue(buf + written, size - written, "SO_SNDBUF", tuning->nEffSndBuf, " bytes");
+	written += FormatTuningValue(buf + written, size - written, "SO_RCVBUF", tuning->nEffRcvBuf, " bytes");
+	written += FormatTuningValue(buf + written, size - written, "Cork", tuning->nEffCork, "");
+	written += FormatTuningValue(buf + written, size - written, "Busy poll", tuning->nEffBusyPoll, "us");
+	written += FormatTuningValue(buf + written, size - written, "DSCP", tuning->nEffDscp, "");
+	if (tuning->bBusyPoll)
+		written += FormatTuningValue(buf + written, size - written, "Loopback fast path", tuning->nEffFastPath, "");
+
+	if (tuning->qwBdp != 0)
+		written += sprintf_s(buf + written, size - written, "BDP: %llu bytes (%luus RTT x %lu Mbit/s)\r\n",
+			tuning->qwBdp, tuning->dwRttUs, tuning->dwLinkMbps);
+	return written;
+}
@@ -0,0 +1,26 @@
+#ifndef SOCKET_TUNING_H
+#define SOCKET_TUNING_H
+
+#include <WinSock2.h>
+#include <Ws2tcpip.h>
+#include <mstcpip.h>
+#include <Windows.h>
+#include <tchar.h>
+#include <cstdio>
+#include "WinStorage.h"
+#include "Utils.h"
+
+#define TUNE_MINBUF			(64 * 1024)			// Smallest buffer the auto profile will ever pick
+#define TUNE_MAXBUF			(64 * 1024 * 1024)	// Largest buffer the auto profile will ever pick
+#define TUNE_DEF_RTT_US		1000				// RTT assumed by the auto profile when none could be measured
+#define TUNE_DEF_LINKMBPS	1000				// Nominal link rate assumed by the auto profile
+#define TUNE_BUSYPOLL_US	50					// SO_BUSY_POLL asked for by -busypoll when the profile doesn't set it
+
+BOOL LoadTuningProfile(LPSocketTuning tuning, const TCHAR *szProfile);
+BOOL ApplySocketTuning(SOCKET s, LPSocketTuning tuning, DWORD nSockType);
+VOID AutoTuneSocket(SOCKET s, LPSocketTuning tuning, DWORD nSockType, DWORD dwRttUs);
+DWORD QuerySocketRtt(SOCKET s);
+VOID ReadEffectiveTuning(SOCKET s, LPSocketTuning tuning, DWORD nSockType);
+INT FormatTuningReport(CHAR *buf, size_t size, LPSocketTuning tuning);
+
+#endif
@@ -0,0 +1,633 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Trace.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID StartTracing(const CHAR *szFile);
+-- VOID TraceEvent(WORD wEvent, DWORD dwBytes, const VOID *buf);
+-- VOID NameTraceThread(const CHAR *szRole, DWORD dwIndex);
+-- VOID DetachTrace();
+-- BOOL TraceReadFile(HANDLE hFile, VOID *data, DWORD dwLen, LPDWORD pdwRead);
+-- BOOL TraceWriteFile(HANDLE hFile, const VOID *data, DWORD dwLen, LPDWORD pdwWritten);
+-- VOID ExportTrace(LPTraceState state);
+-- INT FormatTraceReport(CHAR *buf, size_t size, LPTraceState state);
+-- static LPTraceRing AttachRing();
+-- static DWORD SnapshotRing(LPTraceRing r, LPDWORD pdwOverwritten);
+-- static double TscPerUs();
+-- static VOID EmitSpan(FILE *file, const CHAR *szName, CHAR cPhase, DWORD dwTid, double dTs, const TraceRecord *rec);
+-- static VOID WriteRing(FILE *file, LPTraceRing r, DWORD dwCount, double dTscPerUs);
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file is the event tracing for -trace, which shows where a slow transfer's time went: posting its
+--			sends and receives, waiting in SleepEx (or busy-polling), the completion routines, ReadFile and WriteFile
+--			of the file, or the network (the time from an I/O being posted to its completion routine starting).
+--
+--			Each thread that records an event gets a ring of TRACE_RING_EVENTS fixed-size records of its own, found
+--			through a thread-local pointer, so recording takes no lock and no interlocked instruction: the time-stamp
+--			counter is read, the record filled in and the ring's head moved on, and when the ring is full the oldest
+--			record is overwritten. With tracing off an event costs a call and a test. The memory is bounded (rings
+--			are reused by later threads once a thread gives its ring up, and no more than TRACE_MAX_RINGS are made),
+--			so -trace can be left on for long runs.
+--
+--			At the end of each transfer every ring is copied out, while its thread carries on, and written as a Chrome
+--			trace-event file that chrome://tracing and Perfetto load: the waits, completion routines and file I/O as
+--			spans on each thread's track, each I/O from post to completion as an async span with its bytes and
+--			buffer, and each thread's outstanding I/O as a counter. A record its thread may have overwritten while
+--			it was being copied is left out. The file holds what the rings held, so it's rewritten each time; with
+--			many threads busy, the earlier transfers' events age out first. Time-stamp counts are converted to
+--			microseconds with the rate measured against the performance counter since tracing started, which
+--			assumes the invariant counter every current x86 processor has.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Trace.h"
+
+static BOOL							bTracing	= FALSE;
+static CHAR							szTraceFile[FILENAME_SIZE];	// Where ExportTrace writes, or empty for no file
+static LPTraceRing volatile			rings		= NULL;
+static volatile LONG				lRings		= 0;
+static volatile LONG				lUntraced	= 0;		// Threads refused a ring
+static __declspec(thread) LPTraceRing ring;					// The calling thread's ring, once it has one
+static __declspec(thread) BOOL		bUntraced;
+static CRITICAL_SECTION				exportLock;				// One export at a time; the copy and counters are shared
+static LARGE_INTEGER				liStartQpc;				// When tracing started, by both clocks
+static ULONGLONG					qwStartTsc;
+static TraceRecord					snapshot[TRACE_RING_EVENTS];	// A ring being exported
+static ULONGLONG					posts[TRACE_MAX_POSTS];	// Post times not yet matched with a completion
+static DWORD						dwNextId	= 0;		// For the async spans
+static DWORD						dwPid;
+static const CHAR					*szSep;					// What goes before the next event in the file
+
+// Span names, indexed by the event that starts them (and one less than the event that ends them)
+static const CHAR *spanNames[] = {
+	NULL, NULL, "send completion", "receive completion", "wait", NULL, "ReadFile", NULL, "WriteFile", NULL, "idle"
+};
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: StartTracing
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: StartTracing(const CHAR *szFile)
+--							const CHAR *szFile:	The timeline to write at the end of each transfer (-trace), or NULL to
+--												record events without writing them (the benchmarks).
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Call before any thread records an event. Calling it again only changes the file.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID StartTracing(const CHAR *szFile)
+{
+	if (szFile != NULL)
+		strncpy_s(szTraceFile, FILENAME_SIZE, szFile, _TRUNCATE);
+	if (bTracing)
+		return;
+
+	InitializeCriticalSection(&exportLock);
+	QueryPerformanceCounter(&liStartQpc);
+	qwStartTsc	= __rdtsc();
+	bTracing	= TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AttachRing
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AttachRing()
+--
+-- RETURNS: The calling thread's new ring, or NULL if it can't have one.
+--
+-- NOTES:
+-- Takes a ring no thread owns, or makes one and pushes it on the list with a compare-exchange. A ring that's taken
+-- over loses its last owner's events; they were exported at the end of its transfer.
+---------------------------------------------------------------------------------------------------------------------------*/
+static LPTraceRing AttachRing()
+{
+	LPTraceRing r, head;
+	BOOL		bNew = FALSE;
+
+	if (bUntraced)
+		return NULL;
+
+	for (r = rings; r != NULL; r = r->next)
+	{
+		if (r->lOwned == 0 && InterlockedCompareExchange(&r->lOwned, 1, 0) == 0)
+			break;
+	}
+
+	if (r != NULL)
+		r->dwFilled = 0;
+	else if (InterlockedIncrement(&lRings) <= TRACE_MAX_RINGS && (r = (LPTraceRing)calloc(1, sizeof(TraceRing))) != NULL)
+	{
+		r->lOwned	= 1;
+		bNew		= TRUE;
+	}
+	else
+	{
+		InterlockedIncrement(&lUntraced);
+		bUntraced = TRUE;
+		return NULL;
+	}
+
+	r->dwThreadId	= GetCurrentThreadId();
+	r->wDepth		= 0;
+	sprintf_s(r->szName, TRACE_NAME_SIZE, "Thread %lu", r->dwThreadId);
+	if (bNew)
+	{
+		do
+			r->next = head = rings;
+		while (InterlockedCompareExchangePointer((PVOID volatile *)&rings, r, head) != head);
+	}
+
+	ring = r;
+	return r;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TraceEvent
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TraceEvent(WORD wEvent, DWORD dwBytes, const VOID *buf)
+--							WORD wEvent:		The TRACE_* event.
+--							DWORD dwBytes:		Bytes sent, received, read or written (0 if the event has none).
+--							const VOID *buf:	The buffer they were in, or NULL.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Records an event in the calling thread's ring, if tracing is on. The record is filled in before the head is moved
+-- past it, so the export never takes a half-written record for a whole one.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID TraceEvent(WORD wEvent, DWORD dwBytes, const VOID *buf)
+{
+	LPTraceRing		r = ring;
+	LPTraceRecord	rec;
+	DWORD			dwHead;
+
+	if (!bTracing)
+		return;
+	if (r == NULL && (r = AttachRing()) == NULL)
+		return;
+
+	if (wEvent == TRACE_POST)
+		r->wDepth++;
+	else if ((wEvent == TRACE_SEND_DONE || wEvent == TRACE_RECV_DONE) && r->wDepth != 0)
+		r->wDepth--;
+
+	dwHead			= r->dwHead;
+	rec				= &r->records[dwHead % TRACE_RING_EVENTS];
+	rec->qwTsc		= __rdtsc();
+	rec->dwBytes	= dwBytes;
+	rec->dwBuf		= (DWORD)(ULONG_PTR)buf;
+	rec->wEvent		= wEvent;
+	rec->wDepth		= r->wDepth;
+	_WriteBarrier();
+	r->dwHead = dwHead + 1;
+	if (r->dwFilled < TRACE_RING_EVENTS)
+		r->dwFilled++;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NameTraceThread
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NameTraceThread(const CHAR *szRole, DWORD dwIndex)
+--							const CHAR *szRole:	What the thread is ("Worker").
+--							DWORD dwIndex:		Which one.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Names the calling thread's track in the timeline; a thread that isn't named shows its ID.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID NameTraceThread(const CHAR *szRole, DWORD dwIndex)
+{
+	LPTraceRing r = ring;
+
+	if (!bTracing)
+		return;
+	if (r == NULL && (r = AttachRing()) == NULL)
+		return;
+	sprintf_s(r->szName, TRACE_NAME_SIZE, "%s %lu", szRole, dwIndex);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: DetachTrace
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: DetachTrace()
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Gives up the calling thread's ring so a later thread can take it over. Call this before a thread that may have
+-- recorded events exits; its events stay in the ring until then.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID DetachTrace()
+{
+	if (ring == NULL)
+		return;
+	InterlockedExchange(&ring->lOwned, 0);
+	ring = NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TraceReadFile
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TraceReadFile(HANDLE hFile, VOID *data, DWORD dwLen, LPDWORD pdwRead)
+--							HANDLE hFile:		A file opened for synchronous reads.
+--							VOID *data:			Where to read to.
+--							DWORD dwLen:		Bytes to read.
+--							LPDWORD pdwRead:	Receives the bytes read.
+--
+-- RETURNS: What ReadFile returned.
+--
+-- NOTES:
+-- ReadFile, recorded as a span.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL TraceReadFile(HANDLE hFile, VOID *data, DWORD dwLen, LPDWORD pdwRead)
+{
+	BOOL bRead;
+
+	TraceEvent(TRACE_READ_BEGIN, dwLen, data);
+	bRead = ReadFile(hFile, data, dwLen, pdwRead, NULL);
+	TraceEvent(TRACE_READ_END, bRead ? *pdwRead : 0, data);
+	return bRead;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TraceWriteFile
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TraceWriteFile(HANDLE hFile, const VOID *data, DWORD dwLen, LPDWORD pdwWritten)
+--							HANDLE hFile:		A file opened for synchronous writes.
+--							const VOID *data:	What to write.
+--							DWORD dwLen:		Bytes to write.
+--							LPDWORD pdwWritten:	Receives the bytes written.
+--
+-- RETURNS: What WriteFile returned.
+--
+-- NOTES:
+-- WriteFile, recorded as a span.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL TraceWriteFile(HANDLE hFile, const VOID *data, DWORD dwLen, LPDWORD pdwWritten)
+{
+	BOOL bWritten;
+
+	TraceEvent(TRACE_WRITE_BEGIN, dwLen, data);
+	bWritten = WriteFile(hFile, data, dwLen, pdwWritten, NULL);
+	TraceEvent(TRACE_WRITE_END, bWritten ? *pdwWritten : 0, data);
+	return bWritten;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SnapshotRing
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SnapshotRing(LPTraceRing r, LPDWORD pdwOverwritten)
+--							LPTraceRing r:			The ring, which its thread may be writing to.
+--							LPDWORD pdwOverwritten:	Incremented by the events written to it since the last export that
+--													are no longer there.
+--
+-- RETURNS: The number of records copied to snapshot, oldest first.
+--
+-- NOTES:
+-- The count of records is read before the head, so none older than the owner's first is taken. The head is read
+-- again after the copy; any record the owner could have reached in the meantime (including the one it may be writing
+-- now) is dropped from the front.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD SnapshotRing(LPTraceRing r, LPDWORD pdwOverwritten)
+{
+	DWORD	dwCount, dwHead, dwEnd, dwNew, i;
+	LONG	lDrop;
+
+	dwCount = r->dwFilled;
+	_ReadBarrier();
+	dwHead = r->dwHead;
+	for (i = 0; i < dwCount; i++)
+		snapshot[i] = r->records[(dwHead - dwCount + i) % TRACE_RING_EVENTS];
+	_ReadBarrier();
+	dwEnd = r->dwHead;
+
+	lDrop = (LONG)(dwEnd - dwHead) + 1 + (LONG)dwCount - TRACE_RING_EVENTS;
+	if (lDrop > 0)
+	{
+		lDrop	= min(lDrop, (LONG)dwCount);
+		dwCount	-= lDrop;
+		memmove(snapshot, snapshot + lDrop, dwCount * sizeof(TraceRecord));
+	}
+
+	dwNew = dwHead - r->dwExported;
+	if (dwNew > dwCount)
+		*pdwOverwritten += dwNew - dwCount;
+	r->dwExported = dwHead;
+	return dwCount;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TscPerUs
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TscPerUs()
+--
+-- RETURNS: Time-stamp counts per microsecond.
+--
+-- NOTES:
+-- Measured against the performance counter over the time since tracing started, waiting a little if that's too short
+-- to measure.
+---------------------------------------------------------------------------------------------------------------------------*/
+static double TscPerUs()
+{
+	LARGE_INTEGER	liNow;
+	ULONGLONG		qwTsc;
+
+	QueryPerformanceCounter(&liNow);
+	if (TicksToSeconds(liNow.QuadPart - liStartQpc.QuadPart) < 0.05)
+	{
+		Sleep(50);
+		QueryPerformanceCounter(&liNow);
+	}
+	qwTsc = __rdtsc();
+	return (qwTsc - qwStartTsc) / (TicksToSeconds(liNow.QuadPart - liStartQpc.QuadPart) * 1e6);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: EmitSpan
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: EmitSpan(FILE *file, const CHAR *szName, CHAR cPhase, DWORD dwTid, double dTs, const TraceRecord *rec)
+--							FILE *file:				The timeline.
+--							const CHAR *szName:		The span's name.
+--							CHAR cPhase:			'B' to start it or 'E' to end it.
+--							DWORD dwTid:			The thread it's on.
+--							double dTs:				When, in microseconds since tracing started.
+--							const TraceRecord *rec:	The event, whose bytes and buffer go in the span's arguments, or NULL.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID EmitSpan(FILE *file, const CHAR *szName, CHAR cPhase, DWORD dwTid, double dTs, const TraceRecord *rec)
+{
+	fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f", szSep, szName, cPhase, dwPid,
+		dwTid, dTs);
+	if (rec != NULL)
+		fprintf(file, ",\"args\":{\"bytes\":%lu,\"buffer\":\"0x%08lx\"}", rec->dwBytes, rec->dwBuf);
+	fputs("}", file);
+	szSep = ",\n";
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: WriteRing
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: WriteRing(FILE *file, LPTraceRing r, DWORD dwCount, double dTscPerUs)
+--							FILE *file:			The timeline.
+--							LPTraceRing r:		The ring snapshot was copied from.
+--							DWORD dwCount:		Records in snapshot.
+--							double dTscPerUs:	Time-stamp counts per microsecond.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Turns one thread's events into trace events. A completion routine is taken to run from its event to the thread's
+-- next post or wait, and each completion is paired with the oldest post not yet paired; the one I/O a transfer keeps
+-- outstanding makes that exact. An end whose start was overwritten is left out.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID WriteRing(FILE *file, LPTraceRing r, DWORD dwCount, double dTscPerUs)
+{
+	const TraceRecord	*rec;
+	const CHAR			*szHandler	= NULL;		// The completion routine that's running
+	BOOL				open[TRACE_IDLE_END + 1];
+	DWORD				dwFirstPost	= 0, dwPosts = 0, i;
+	DWORD				dwTid		= r->dwThreadId;
+	double				dTs;
+
+	memset(open, 0, sizeof(open));
+	fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}", szSep,
+		dwPid, dwTid, r->szName);
+	szSep = ",\n";
+
+	for (i = 0; i < dwCount; i++)
+	{
+		rec = &snapshot[i];
+		dTs = (LONGLONG)(rec->qwTsc - qwStartTsc) / dTscPerUs;
+		if (szHandler != NULL && (rec->wEvent == TRACE_POST || rec->wEvent == TRACE_SEND_DONE ||
+			rec->wEvent == TRACE_RECV_DONE || rec->wEvent == TRACE_WAIT_BEGIN || rec->wEvent == TRACE_WAIT_END))
+		{
+			EmitSpan(file, szHandler, 'E', dwTid, dTs, NULL);
+			szHandler = NULL;
+		}
+
+		switch (rec->wEvent)
+		{
+		case TRACE_POST:
+			if (dwPosts == TRACE_MAX_POSTS)
+			{
+				dwFirstPost = (dwFirstPost + 1) % TRACE_MAX_POSTS;
+				dwPosts--;
+			}
+			posts[(dwFirstPost + dwPosts++) % TRACE_MAX_POSTS] = rec->qwTsc;
+			break;
+
+		case TRACE_SEND_DONE:
+		case TRACE_RECV_DONE:
+			if (dwPosts != 0)
+			{
+				fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"io\",\"ph\":\"b\",\"id\":%lu,\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f}"
+					",\n{\"name\":\"%s\",\"cat\":\"io\",\"ph\":\"e\",\"id\":%lu,\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,"
+					"\"args\":{\"bytes\":%lu,\"buffer\":\"0x%08lx\"}}",
+					rec->wEvent == TRACE_SEND_DONE ? "send" : "receive", dwNextId, dwPid, dwTid,
+					(LONGLONG)(posts[dwFirstPost] - qwStartTsc) / dTscPerUs,
+					rec->wEvent == TRACE_SEND_DONE ? "send" : "receive", dwNextId, dwPid, dwTid, dTs, rec->dwBytes,
+					rec->dwBuf);
+				dwNextId++;
+				dwFirstPost = (dwFirstPost + 1) % TRACE_MAX_POSTS;
+				dwPosts--;
+			}
+			szHandler = spanNames[rec->wEvent];
+			EmitSpan(file, szHandler, 'B', dwTid, dTs, rec);
+			break;
+
+		case TRACE_WAIT_BEGIN:
+		case TRACE_READ_BEGIN:
+		case TRACE_WRITE_BEGIN:
+		case TRACE_IDLE_BEGIN:
+			EmitSpan(file, spanNames[rec->wEvent], 'B', dwTid, dTs, rec->wEvent == TRACE_WAIT_BEGIN ? NULL : rec);
+			open[rec->wEvent] = TRUE;
+			break;
+
+		case TRACE_WAIT_END:
+		case TRACE_READ_END:
+		case TRACE_WRITE_END:
+		case TRACE_IDLE_END:
+			if (open[rec->wEvent - 1])
+				EmitSpan(file, spanNames[rec->wEvent - 1], 'E', dwTid, dTs, rec->wEvent == TRACE_WAIT_END ? NULL : rec);
+			open[rec->wEvent - 1] = FALSE;
+			break;
+		}
+
+		if (rec->wEvent == TRACE_POST || rec->wEvent == TRACE_SEND_DONE || rec->wEvent == TRACE_RECV_DONE)
+			fprintf(file, ",\n{\"name\":\"outstanding I/O, %s\",\"ph\":\"C\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,"
+				"\"args\":{\"depth\":%u}}", r->szName, dwPid, dwTid, dTs, rec->wDepth);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ExportTrace
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ExportTrace(LPTraceState state)
+--							LPTraceState state:	The transfer's trace state, which gets what was written.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Writes every ring's events to the -trace file, replacing what it held. Called at the end of a transfer, after its
+-- times have been taken, so the writing doesn't count against it.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID ExportTrace(LPTraceState state)
+{
+	LARGE_INTEGER	liStart, liEnd;
+	FILE			*file;
+	LPTraceRing		r;
+	DWORD			dwCount;
+	double			dTscPerUs;
+
+	if (!bTracing || szTraceFile[0] == 0)
+		return;
+
+	EnterCriticalSection(&exportLock);
+	QueryPerformanceCounter(&liStart);
+	memset(state, 0, sizeof(TraceState));
+	state->bExported = TRUE;
+	if (fopen_s(&file, szTraceFile, "w") != 0 || file == NULL)
+	{
+		state->bFailed = TRUE;
+		LeaveCriticalSection(&exportLock);
+		return;
+	}
+	setvbuf(file, NULL, _IOFBF, TRACE_FILEBUF);
+
+	dTscPerUs	= TscPerUs();
+	dwPid		= GetCurrentProcessId();
+	szSep		= "";
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+	for (r = rings; r != NULL; r = r->next)
+	{
+		if ((dwCount = SnapshotRing(r, &state->dwOverwritten)) == 0)
+			continue;
+		WriteRing(file, r, dwCount, dTscPerUs);
+		state->dwEvents += dwCount;
+		state->dwThreads++;
+	}
+	fputs("\n]}\n", file);
+	state->bFailed = ferror(file) != 0;
+	if (fclose(file) != 0)
+		state->bFailed = TRUE;
+
+	state->dwUntraced = (DWORD)lUntraced;
+	QueryPerformanceCounter(&liEnd);
+	state->dExportMs = TicksToSeconds(liEnd.QuadPart - liStart.QuadPart) * 1e3;
+	LeaveCriticalSection(&exportLock);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatTraceReport
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatTraceReport(CHAR *buf, size_t size, LPTraceState state)
+--							CHAR *buf:			The buffer to write the report to.
+--							size_t size:		The size of the buffer.
+--							LPTraceState state:	The transfer's trace state.
+--
+-- RETURNS: The number of characters written (0 if nothing was traced).
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatTraceReport(CHAR *buf, size_t size, LPTraceState state)
+{
+	INT written = 0;
+
+	if (!state->bExported)
+		return 0;
+	if (state->bFailed)
+		return sprintf_s(buf, size, "Trace: couldn't write %s\r\n", szTraceFile);
+
+	written += sprintf_s(buf, size, "Trace: %lu events from %lu threads written to %s in %.1fms\r\n", state->dwEvents,
+		state->dwThreads, szTraceFile, state->dExportMs);
+	if (state->dwOverwritten != 0)
+		written += sprintf_s(buf + written, size - written,
+			"Trace: %lu events were overwritten before they could be exported\r\n", state->dwOverwritten);
+	if (state->dwUntraced != 0)
+		written += sprintf_s(buf + written, size - written,
+			"Trace: %lu threads weren't traced; all %d rings were in use\r\n", state->dwUntraced, TRACE_MAX_RINGS);
+	return written;
+}
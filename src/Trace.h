@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Windows.h>
+#include <intrin.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+
+#define TRACE_RING_EVENTS	32768		// Events each thread's ring holds (a power of two); the oldest are overwritten
+#define TRACE_MAX_RINGS		256			// Most threads traced at once; later ones aren't traced
+#define TRACE_NAME_SIZE		32
+#define TRACE_MAX_POSTS		64			// Posted I/O the export pairs with completions, per thread
+#define TRACE_FILEBUF		(1 << 20)	// stdio buffer for writing the timeline
+
+// Events, and the spans the export makes of them
+#define TRACE_POST			1			// A send or receive posted on a transfer's OVERLAPPED
+#define TRACE_SEND_DONE		2			// A send's completion routine started; bytes and the send buffer
+#define TRACE_RECV_DONE		3			// A receive's completion routine started; bytes and the receive buffer
+#define TRACE_WAIT_BEGIN	4			// The transfer thread waiting for its I/O (SleepEx or busy-polling)
+#define TRACE_WAIT_END		5
+#define TRACE_READ_BEGIN	6			// ReadFile of the file being sent; bytes asked for and the buffer
+#define TRACE_READ_END		7			// Bytes read
+#define TRACE_WRITE_BEGIN	8			// WriteFile of received data
+#define TRACE_WRITE_END		9
+#define TRACE_IDLE_BEGIN	10			// A worker waiting for a transfer to run
+#define TRACE_IDLE_END		11
+
+/* One event. Timestamps are processor time-stamp counter readings, converted when the ring is exported. */
+typedef struct _TraceRecord
+{
+	ULONGLONG	qwTsc;
+	DWORD		dwBytes;
+	DWORD		dwBuf;			// The low 32 bits of the buffer's address, to tell buffers apart
+	WORD		wEvent;
+	WORD		wDepth;			// I/O posted by the thread and not yet completed, after this event
+} TraceRecord, *LPTraceRecord;
+
+/* A thread's events. Only the owning thread writes to it; the export reads it while the thread carries on. */
+typedef struct _TraceRing
+{
+	struct _TraceRing	*next;		// Every ring made, newest first; rings are kept for the life of the program
+	volatile LONG		lOwned;		// A thread is writing to it
+	DWORD				dwThreadId;
+	CHAR				szName[TRACE_NAME_SIZE];
+	WORD				wDepth;
+	volatile DWORD		dwHead;		// Events ever written (wrapping); the next goes in records[dwHead % TRACE_RING_EVENTS]
+	volatile DWORD		dwFilled;	// Records holding the current owner's events, up to TRACE_RING_EVENTS
+	DWORD				dwExported;	// dwHead when the ring was last exported
+	TraceRecord			records[TRACE_RING_EVENTS];
+} TraceRing, *LPTraceRing;
+
+VOID StartTracing(const CHAR *szFile);
+VOID TraceEvent(WORD wEvent, DWORD dwBytes, const VOID *buf);
+VOID NameTraceThread(const CHAR *szRole, DWORD dwIndex);
+VOID DetachTrace();
+BOOL TraceReadFile(HANDLE hFile, VOID *data, DWORD dwLen, LPDWORD pdwRead);
+BOOL TraceWriteFile(HANDLE hFile, const VOID *data, DWORD dwLen, LPDWORD pdwWritten);
+VOID ExportTrace(LPTraceState state);
+INT FormatTraceReport(CHAR *buf, size_t size, LPTraceState state);
+
+#endif
@@ -103,7 +103,7 @@ VOID SetDlgDefaults(HWND hwndDlg, DWORD dwHostMode, LPTransferProps props)
 	TCHAR	buf[FILENAME_SIZE];
 
 	// Set port field
-	_stprintf_s(buf, TEXT("%d"), ntohs(props->paddr_in->sin_port));
+	_stprintf_s(buf, TEXT("%d"), props->usPort);
 	SetWindowText(hwndPort, buf);
 
 	// Set radio button to either TCP or UDP
@@ -127,7 +127,10 @@ VOID SetDlgDefaults(HWND hwndDlg, DWORD dwHostMode, LPTransferProps props)
 	SendMessage(hwndSize, CB_ADDSTRING, 0, (LPARAM)TEXT("4096"));
 	SendMessage(hwndSize, CB_ADDSTRING, 0, (LPARAM)TEXT("20480"));
 	SendMessage(hwndSize, CB_ADDSTRING, 0, (LPARAM)TEXT("61440"));
-	if (props->szFileName[0] == 0)
+	SendMessage(hwndSize, CB_ADDSTRING, 0, (LPARAM)TEXT("Path MTU"));
+	if (props->szFileName[0] == 0 && props->pmtu.bPathSize)
+		SendMessage(hwndSize, CB_SETCURSEL, DROPDOWN_PATHMTU, 0);
+	else if (props->szFileName[0] == 0)
 	{
 		_stprintf_s(buf, TEXT("%d"), props->nPacketSize);
 		SetWindowText(hwndSize, buf);
@@ -145,7 +148,7 @@ VOID SetDlgDefaults(HWND hwndDlg, DWORD dwHostMode, LPTransferProps props)
 	// Set the host name field
 	if (props->szHostName[0] == 0)
 	{
-		CHAR_2_TCHAR(buf, inet_ntoa(props->paddr_in->sin_addr), FILENAME_SIZE);
+		AddressToText(&props->addr, buf, FILENAME_SIZE);
 		SetWindowText(hwndIP, buf);
 	}
 	else
@@ -197,21 +200,32 @@ BOOL FillTransferProps(HWND hwndDlg, DWORD dwHostMode, LPTransferProps props)
 	//Get the transfer details: packet size, what file (if any) to use, number of packets to send
 	if (dwDropDownSel == DROPDOWN_USEFILESIZE)
 	{
+		props->pmtu.bPathSize = FALSE;
 		if(buf[0] == 0)
 		{
 			MessageBox(NULL, TEXT("Please specify a file to send."), TEXT("No file"), MB_ICONERROR);
 			return FALSE;
 		}
 	}
+	else if (dwDropDownSel == DROPDOWN_PATHMTU && props->nSockType == SOCK_STREAM)
+	{
+		MessageBox(NULL, TEXT("Only UDP datagrams can be sized to the path MTU."), TEXT("Path MTU"), MB_ICONERROR);
+		return FALSE;
+	}
 	else
 	{
-		ComboBox_GetText(hwndSize, buf, FILENAME_SIZE);
-		if (_stscanf_s(buf, TEXT("%d"), &dwPacketSize) == 0 || dwPacketSize == 0)
+		// "Path MTU" sets the size once the path has been probed (see ClientTransfer.cpp)
+		props->pmtu.bPathSize = dwDropDownSel == DROPDOWN_PATHMTU;
+		if (!props->pmtu.bPathSize)
 		{
-			MessageBox(NULL, TEXT("Please enter a non-zero number for packet size."), TEXT("Invalid byte number"), MB_ICONERROR);
-			return FALSE;
+			ComboBox_GetText(hwndSize, buf, FILENAME_SIZE);
+			if (_stscanf_s(buf, TEXT("%d"), &dwPacketSize) == 0 || dwPacketSize == 0)
+			{
+				MessageBox(NULL, TEXT("Please enter a non-zero number for packet size."), TEXT("Invalid byte number"), MB_ICONERROR);
+				return FALSE;
+			}
+			props->nPacketSize = dwPacketSize;
 		}
-		props->nPacketSize = dwPacketSize;
 
 		ComboBox_GetText(hwndSend, buf, FILENAME_SIZE);
 		if (_stscanf_s(buf, TEXT("%d"), &dwSendNum) == 0 || dwSendNum <= 0)
@@ -241,15 +255,13 @@ BOOL FillTransferProps(HWND hwndDlg, DWORD dwHostMode, LPTransferProps props)
 -- RETURNS: False if one of the conversions fails, true otherwise.
 --
 -- NOTES:
--- Retrieves the port number and IP address/host name of entered by the user and places them in the sock_inaddr struct if
--- there are no errors.
+-- Retrieves the port number and IP address/host name of entered by the user and places them in props if there are no
+-- errors. A host name is looked up in the background from here on (see Connect.cpp).
 ---------------------------------------------------------------------------------------------------------------------------*/
 BOOL GetDlgAddrInfo(HWND hwndDlg, DWORD dwHostMode, LPTransferProps props)
 {
 	TCHAR	buf[HOSTNAME_SIZE];
 	DWORD	usPortNum;
-	DWORD	dwBinaryAddr;
-	char	hostip_string[HOSTNAME_SIZE];
 
 	// Get the information for storage in our in_addr
 	GetDlgItemText(hwndDlg, ID_TEXTBOX_PORT, buf, HOSTNAME_SIZE);
@@ -258,7 +270,7 @@ BOOL GetDlgAddrInfo(HWND hwndDlg, DWORD dwHostMode, LPTransferProps props)
 		MessageBox(NULL, TEXT("The port must be a number."), TEXT("Non-Numeric Port"), MB_ICONERROR);
 		return FALSE;
 	}
-	props->paddr_in->sin_port = htons(usPortNum);
+	props->usPort = (USHORT)usPortNum;
 
 	if (dwHostMode == ID_HOSTTYPE_SERVER)
 		return TRUE;
@@ -270,24 +282,23 @@ BOOL GetDlgAddrInfo(HWND hwndDlg, DWORD dwHostMode, LPTransferProps props)
 		return FALSE;
 	}
 
-	// IP address (maybe)
-	if(isdigit(buf[0]))
+	// IPv4 or IPv6 address
+	if (ParseAddress(buf, &props->addr, &props->nAddrLen))
+		props->szHostName[0] = 0; // Don't check the host name when sending later
+	else if (_tcsspn(buf, TEXT("0123456789.")) == _tcslen(buf) || _tcschr(buf, TEXT(':')) != NULL)
 	{
-		TCHAR_2_CHAR(hostip_string, buf, HOSTNAME_SIZE);
-		if((dwBinaryAddr = inet_addr(hostip_string)) == INADDR_NONE)
-		{
-			MessageBox(NULL, TEXT("IP address must be in the form xxx.xxx.xxx.xxx."), TEXT("Invalid IP"), MB_ICONERROR);
-			return FALSE;
-		}
-		props->paddr_in->sin_addr.s_addr = dwBinaryAddr;
-		props->szHostName[0] = 0; // Don't check the host name when sending later 
+		MessageBox(NULL, TEXT("IP address must be in the form xxx.xxx.xxx.xxx, or an IPv6 address."), TEXT("Invalid IP"),
+			MB_ICONERROR);
+		return FALSE;
 	}
 	else
 	{
-		props->paddr_in->sin_addr.s_addr = 0; // Get rid of current address
+		props->nAddrLen = 0; // Get rid of current address
 
-		// We'll check at connection time whether this is a real host; store it for now
+		// We'll check at connection time whether this is a real host; store it for now, and start looking it up so
+		// the answer is ready by then
 		_tcscpy_s(props->szHostName, buf);
+		StartResolve(props->szHostName);
 	}
 	return TRUE;
 }
@@ -9,6 +9,7 @@
 #include "resource.h"
 #include "WinStorage.h"
 #include "Utils.h"
+#include "Connect.h"
 
 #define ID_RADIO_TCP		IDC_RADIO1
 #define ID_RADIO_UDP		IDC_RADIO2
@@ -20,6 +21,7 @@
 #define ID_BUTTON_BROWSE	IDC_BUTTON1
 
 #define DROPDOWN_USEFILESIZE 0
+#define DROPDOWN_PATHMTU	5		// Fit UDP datagrams to the path MTU (see Pmtu.cpp)
 
 INT_PTR CALLBACK TransferDlgProc(_In_ HWND hwndDlg, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam);
 VOID SetDlgDefaults(HWND hwndDlg, DWORD dwHostMode, LPTransferProps props);
@@ -6,8 +6,12 @@
 -- FUNCTIONS:
 -- int CDECL MessageBoxPrintf(DWORD dwType, TCHAR * szCaption, TCHAR * szFormat, ...);
 -- int CDECL DrawTextPrintf(HWND hwnd, TCHAR * szFormat, ...);
--- VOID LogTransferInfo(const char *filename, LPTransferProps props, DWORD dwSentOrRecvd, DWORD dwHostMode);
+-- INT FormatTransferLog(CHAR *log, size_t size, LPTransferProps props, ULONGLONG qwSentOrRecvd, DWORD dwHostMode);
+-- VOID LogTransferInfo(const char *filename, LPTransferProps props, ULONGLONG qwSentOrRecvd, HWND hwnd);
 -- VOID CreateTimestamp(char *buf, SYSTEMTIME *time);
+-- double TicksToSeconds(ULONGLONG qwTicks);
+-- BOOL SendAll(SOCKET s, const CHAR *buf, DWORD dwLen);
+-- BOOL RecvAll(SOCKET s, CHAR *buf, DWORD dwLen);
 --
 -- DATE: February 7th, 2014
 --
@@ -21,6 +25,29 @@
 -------------------------------------------------------------------------------------------------------------------------*/
 
 #include "Utils.h"
+#include "SocketTuning.h"
+#include "Compress.h"
+#include "Checksum.h"
+#include "Delta.h"
+#include "Dedup.h"
+#include "Batch.h"
+#include "Session.h"
+#include "Connect.h"
+#include "Payload.h"
+#include "Control.h"
+#include "Pmtu.h"
+#include "Duplex.h"
+#include "Multicast.h"
+#include "Chunk.h"
+#include "Pool.h"
+#include "Sim.h"
+#include "Workers.h"
+#include "Sched.h"
+#include "Trace.h"
+#include "BusyPoll.h"
+#include "Affinity.h"
+#include "Crypt.h"
+#include "Capture.h"
 
 /*-------------------------------------------------------------------------------------------------------------------------
 -- FUNCTION: MessageBoxPrintf
@@ -102,36 +129,35 @@ int CDECL DrawTextPrintf(HWND hwnd, CHAR * szFormat, ...)
 }
 
 /*-------------------------------------------------------------------------------------------------------------------------
--- FUNCTION: LogTransferInfo
--- Febrary 9th, 2014
+-- FUNCTION: FormatTransferLog
+-- October 18th, 2026
 --
 -- DESIGNER: Shane Spoor
 --
 -- PROGRAMMER: Shane Spoor
 --
--- INTERFACE: LogTransferInfo(const char *filename, LPTransferProps props, DWORD dwSentOrRecvd, DWORD dwHostMode)
---								char *filename:			The name of the log file.
+-- INTERFACE: FormatTransferLog(CHAR *log, size_t size, LPTransferProps props, ULONGLONG qwSentOrRecvd, DWORD dwHostMode)
+--								CHAR *log:				The buffer to write the report into.
+--								size_t size:			Its size (LOG_SIZE is enough for any report).
 --								LPTransferProps props:	Pointer to the TransferProps structure containing details about this
 --														transfer.
---								DWORD dwSentOrRecvd:	The number of bytes/packets sent or received.
+--								ULONGLONG qwSentOrRecvd:	The number of bytes sent or received.
 --								DWORD dwHostMode:		The host mode (client or server) in which we're operating.
 --
--- RETURNS: void
+-- RETURNS: The number of characters written.
 --
 -- NOTES:
--- Logs information about the transfer: start timestamp, end timestamp, transfer time, number of packets
--- sent/received/expected, packet size, and protocol used.
+-- Formats the transfer report: start timestamp, end timestamp, transfer time, number of packets
+-- sent/received/expected, packet size, and protocol used, then each module's section. A simulated transfer is reported
+-- from the receiver's side, followed by the simulated link and what happened on it.
 ---------------------------------------------------------------------------------------------------------------------------*/
-VOID LogTransferInfo(const char *filename, LPTransferProps props, DWORD dwSentOrRecvd, HWND hwnd)
+INT FormatTransferLog(CHAR *log, size_t size, LPTransferProps props, ULONGLONG qwSentOrRecvd, DWORD dwHostMode)
 {
-	DWORD			dwHostMode = (DWORD)GetWindowLongPtr(hwnd, GWLP_HOSTMODE);
-	//FILE			*file;
 	FILETIME		ftStartTime, ftEndTime;
 	CHAR			startTimestamp[TIMESTAMP_SIZE] = { 0 }, endTimestamp[TIMESTAMP_SIZE] = { 0 };
 	ULARGE_INTEGER	ulStartTime, ulEndTime, ulTransferTime;
-	CHAR			log[512] = { 0 };
 	INT				written = 0;
-	TCHAR			logw[512];
+	DWORD			dwPacketSize = props->nPacketSize ? props->nPacketSize : 1; // An empty file sends no data chunks
 
 	// Jump through the ludicrous amount of hoops to get millisecond resolution on Windows
 	SystemTimeToFileTime(&props->startTime, &ftStartTime);
@@ -147,9 +173,107 @@ VOID LogTransferInfo(const char *filename, LPTransferProps props, DWORD dwSentOr
 
 	ulTransferTime.QuadPart = ulEndTime.QuadPart - ulStartTime.QuadPart;
 
+	// A simulation plays both ends; report what the receiver saw
+	if (props->sim.bEnabled)
+		dwHostMode = ID_HOSTTYPE_SERVER;
+
 	CreateTimestamp(startTimestamp, &props->startTime);
 	CreateTimestamp(endTimestamp, &props->endTime);
 
+	// The division by 10 000 is necessary because Windows gives the times in 100ns intervals. Why would you do that. Seriously.
+	written += sprintf_s(log, size, "Start timestamp: %s\r\nEnd timestamp: %s\r\nTransfer time: %dms\r\n", startTimestamp, endTimestamp,
+		ulTransferTime.QuadPart / 10000);
+	written += sprintf_s((log + written), size - written, "Packet size: %d bytes\r\n", props->nPacketSize);
+	
+	if(dwHostMode == ID_HOSTTYPE_SERVER)
+		written += sprintf_s((log + written), size - written, "Bytes received: %llu\r\nPackets received : %llu\r\nPackets expected : %d\r\n", qwSentOrRecvd,
+		qwSentOrRecvd / dwPacketSize, props->nNumToSend);
+	else
+		written += sprintf_s((log + written), size - written, "Packets sent: %llu\r\nBytes sent: %llu\r\n", qwSentOrRecvd / dwPacketSize, qwSentOrRecvd);
+
+	written += sprintf_s((log + written), size - written, "Protocol: %s\r\n", (props->nSockType == SOCK_DGRAM) ? "UDP" : "TCP");
+	if (props->sim.bEnabled)
+	{
+		written += FormatTuningReport((log + written), size - written, &props->tuning);
+		written += FormatSimReport((log + written), size - written, &props->sim, props->nSockType);
+	}
+	else
+	{
+		written += FormatConnectReport((log + written), size - written, &props->connect, dwHostMode == ID_HOSTTYPE_SERVER);
+		written += FormatTuningReport((log + written), size - written, &props->tuning);
+		if (props->szFileName[0] != 0)
+		{
+			written += FormatCompressReport((log + written), size - written, &props->compress);
+			written += FormatIntegrityReport((log + written), size - written, &props->integrity,
+				dwHostMode == ID_HOSTTYPE_SERVER);
+			if (props->delta.dwBlockSize != 0)
+				written += FormatDeltaReport((log + written), size - written, &props->delta,
+					dwHostMode == ID_HOSTTYPE_SERVER);
+			if (props->dedup.bActive)
+				written += FormatDedupReport((log + written), size - written, &props->dedup,
+					props->compress.qwWireBytes, dwHostMode == ID_HOSTTYPE_SERVER);
+			if (props->batch.bActive)
+				written += FormatBatchReport((log + written), size - written, &props->batch,
+					ulTransferTime.QuadPart / 1e7, dwHostMode == ID_HOSTTYPE_SERVER);
+		}
+		else
+			written += FormatPayloadReport((log + written), size - written, &props->payload,
+				dwHostMode == ID_HOSTTYPE_SERVER);
+		if (props->session.bEnabled && props->nSockType == SOCK_STREAM)
+			written += FormatSessionReport((log + written), size - written, &props->session,
+				dwHostMode == ID_HOSTTYPE_SERVER);
+		else if (!props->multicast.bActive || dwHostMode == ID_HOSTTYPE_SERVER)
+			written += FormatControlReport((log + written), size - written, &props->control, props, qwSentOrRecvd,
+				dwHostMode == ID_HOSTTYPE_SERVER);
+		if (props->nSockType == SOCK_DGRAM)
+			written += FormatPmtuReport((log + written), size - written, &props->pmtu, &props->control,
+				props->szFileName[0] != 0 ? (DWORD)sizeof(ChunkHeader) + props->nPacketSize : props->nPacketSize,
+				dwHostMode == ID_HOSTTYPE_SERVER);
+		written += FormatCryptReport((log + written), size - written, &props->crypt, ulTransferTime.QuadPart / 1e7,
+			dwHostMode == ID_HOSTTYPE_SERVER);
+		written += FormatDuplexReport((log + written), size - written, &props->duplex);
+		written += FormatMulticastReport((log + written), size - written, &props->multicast, qwSentOrRecvd,
+			dwHostMode == ID_HOSTTYPE_SERVER);
+		written += FormatSchedReport((log + written), size - written, &props->sched);
+		written += FormatPollReport((log + written), size - written, &props->poll);
+		written += FormatAffinityReport((log + written), size - written, &props->affinity);
+		written += FormatPoolReport((log + written), size - written);
+		written += FormatTraceReport((log + written), size - written, &props->trace);
+		written += FormatCaptureReport((log + written), size - written, &props->capture);
+		written += FormatReplayReport((log + written), size - written, &props->replay);
+	}
+	written += FormatWorkerReport((log + written), size - written, &props->worker);
+	written += sprintf_s((log + written), size - written, "\r\n");
+	return written;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LogTransferInfo
+-- Febrary 9th, 2014
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LogTransferInfo(const char *filename, LPTransferProps props, ULONGLONG qwSentOrRecvd, HWND hwnd)
+--								char *filename:			The name of the log file.
+--								LPTransferProps props:	Pointer to the TransferProps structure containing details about this
+--														transfer.
+--								ULONGLONG qwSentOrRecvd:	The number of bytes sent or received.
+--								HWND hwnd:				The main window, which holds the host mode (client or server).
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Shows the transfer report (see FormatTransferLog).
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID LogTransferInfo(const char *filename, LPTransferProps props, ULONGLONG qwSentOrRecvd, HWND hwnd)
+{
+	DWORD	dwHostMode = (DWORD)GetWindowLongPtr(hwnd, GWLP_HOSTMODE);
+	//FILE	*file;
+	CHAR	log[LOG_SIZE] = { 0 };
+	TCHAR	logw[LOG_SIZE];
+
 	//errno_t error = fopen_s(&file, filename, "a");
 	/*if (file == NULL)
 	{
@@ -157,22 +281,12 @@ VOID LogTransferInfo(const char *filename, LPTransferProps props, DWORD dwSentOr
 		return;
 	}*/
 
-	// The division by 10 000 is necessary because Windows gives the times in 100ns intervals. Why would you do that. Seriously.
-	written += sprintf_s(log, "Start timestamp: %s\r\nEnd timestamp: %s\r\nTransfer time: %dms\r\n", startTimestamp, endTimestamp,
-		ulTransferTime.QuadPart / 10000);
-	written += sprintf_s((log + written), 256, "Packet size: %d bytes\r\n", props->nPacketSize);
-	
-	if(dwHostMode == ID_HOSTTYPE_SERVER)
-		written += sprintf_s((log + written), 256, "Bytes received: %d\r\nPackets received : %d\r\nPackets expected : %d\r\n", dwSentOrRecvd,
-		dwSentOrRecvd / props->nPacketSize, props->nNumToSend);
-	else
-		written += sprintf_s((log + written), 256, "Packets sent: %d\r\nBytes sent: %d\r\n", dwSentOrRecvd / props->nPacketSize, dwSentOrRecvd);
-
-	written += sprintf_s((log + written), 256, "Protocol: %s\r\n\r\n", (props->nSockType == SOCK_DGRAM) ? "UDP" : "TCP");
+	FormatTransferLog(log, LOG_SIZE, props, qwSentOrRecvd, dwHostMode);
 	//fprintf(file, "%s", "hello");
-	
-	CHAR_2_TCHAR(logw, log, 256);
-	MessageBoxPrintf(MB_OK, TEXT("Stats"), TEXT("%s"), logw);
+
+	// The report is longer than MessageBoxPrintf's buffer, so show it directly
+	CHAR_2_TCHAR(logw, log, LOG_SIZE);
+	MessageBox(NULL, logw, TEXT("Stats"), MB_OK);
 	//fclose(file);
 }
 
@@ -199,3 +313,88 @@ VOID CreateTimestamp(char *buf, SYSTEMTIME *time)
 	sprintf_s(buf, TIMESTAMP_SIZE, "%d-%02d-%02dT%02d:%02d:%02d:%03dTZD", time->wYear, time->wMonth, time->wDay, time->wHour, 
 		time->wMinute, time->wSecond, time->wMilliseconds);
 }
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TicksToSeconds
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TicksToSeconds(ULONGLONG qwTicks)
+--
+-- RETURNS: A QueryPerformanceCounter interval in seconds.
+---------------------------------------------------------------------------------------------------------------------------*/
+double TicksToSeconds(ULONGLONG qwTicks)
+{
+	static LARGE_INTEGER liFreq = { 0 };
+
+	if (liFreq.QuadPart == 0)
+		QueryPerformanceFrequency(&liFreq);
+	return (double)qwTicks / (double)liFreq.QuadPart;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendAll
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendAll(SOCKET s, const CHAR *buf, DWORD dwLen)
+--						SOCKET s:		A connected TCP socket.
+--						CHAR *buf:		The data to send.
+--						DWORD dwLen:	Its length.
+--
+-- RETURNS: FALSE if the connection failed before everything was sent; TRUE otherwise.
+--
+-- NOTES:
+-- A blocking send for the short control exchanges that happen before the overlapped transfer starts.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SendAll(SOCKET s, const CHAR *buf, DWORD dwLen)
+{
+	INT n;
+
+	while (dwLen > 0)
+	{
+		if ((n = send(s, buf, (INT)dwLen, 0)) == SOCKET_ERROR)
+			return FALSE;
+		buf += n;
+		dwLen -= n;
+	}
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RecvAll
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RecvAll(SOCKET s, CHAR *buf, DWORD dwLen)
+--						SOCKET s:		A connected TCP socket.
+--						CHAR *buf:		The buffer to fill.
+--						DWORD dwLen:	How many bytes to read.
+--
+-- RETURNS: FALSE if the connection failed or closed before dwLen bytes arrived; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL RecvAll(SOCKET s, CHAR *buf, DWORD dwLen)
+{
+	INT n;
+
+	while (dwLen > 0)
+	{
+		if ((n = recv(s, buf, (INT)dwLen, 0)) <= 0)
+			return FALSE;
+		buf += n;
+		dwLen -= n;
+	}
+	return TRUE;
+}
@@ -8,6 +8,7 @@
 #include "resource.h"
 
 #define TIMESTAMP_SIZE 27
+#define LOG_SIZE		8192	// The max size of a transfer report (in characters)
 
 // Convert between TCHAR and char
 #ifdef UNICODE
@@ -26,7 +27,11 @@
 
 int CDECL MessageBoxPrintf(DWORD dwType, TCHAR * szCaption, TCHAR * szFormat, ...);
 int CDECL DrawTextPrintf(HWND hwnd, CHAR * szFormat, ...);
-VOID LogTransferInfo(const char *filename, LPTransferProps props, DWORD dwSentOrRecvd, HWND hwnd);
+INT FormatTransferLog(CHAR *log, size_t size, LPTransferProps props, ULONGLONG qwSentOrRecvd, DWORD dwHostMode);
+VOID LogTransferInfo(const char *filename, LPTransferProps props, ULONGLONG qwSentOrRecvd, HWND hwnd);
 VOID CreateTimestamp(char *buf, SYSTEMTIME *time);
+double TicksToSeconds(ULONGLONG qwTicks);
+BOOL SendAll(SOCKET s, const CHAR *buf, DWORD dwLen);
+BOOL RecvAll(SOCKET s, CHAR *buf, DWORD dwLen);
 
 #endif
\ No newline at end of file
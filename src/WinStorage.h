@@ -8,12 +8,570 @@
 #define GWLP_HOSTMODE		sizeof(LPTransferProps)	// Offset value to access the host mode pointer in wndExtra
 #define FILENAME_SIZE		512						// The max file name size (in bytes)
 #define HOSTNAME_SIZE		128						// The max host name size (in bytes)
+#define PROFILE_SIZE		32						// The max socket tuning profile name size (in characters)
+#define TUNE_KEEP			-1						// Leave a socket option at the kernel's default
+#define TUNE_AUTO			-2						// Size a socket buffer from the measured bandwidth-delay product
+#define TUNE_UNSUPPORTED	-3						// The option doesn't exist on this platform/socket type
+
+/* A named set of socket options (see SocketTuning.cpp). The requested values come from the profile; the effective
+   values are read back from the kernel after the options have been applied so the report shows what actually stuck. */
+typedef struct _SocketTuning
+{
+	TCHAR			szProfile[PROFILE_SIZE];
+	INT				nNoDelay;		// TCP_NODELAY: 1 disables Nagle, 0 enables it
+	INT				nSndBuf;		// SO_SNDBUF in bytes
+	INT				nRcvBuf;		// SO_RCVBUF in bytes
+	INT				nCork;			// TCP_CORK (or the closest equivalent)
+	INT				nBusyPoll;		// SO_BUSY_POLL in microseconds
+	BOOL			bBusyPoll;		// -busypoll was given; busy polling is asked of the kernel too where it can
+	INT				nDscp;			// DSCP code point written into the IP TOS byte
+	DWORD			dwLinkMbps;		// Link rate used for the bandwidth-delay product
+	DWORD			dwRttUs;		// RTT used for the bandwidth-delay product (0 until measured)
+	ULONGLONG		qwBdp;			// The bandwidth-delay product, in bytes (0 unless a buffer is TUNE_AUTO)
+	INT				nEffNoDelay;	// Effective values, as reported by getsockopt
+	INT				nEffSndBuf;
+	INT				nEffRcvBuf;
+	INT				nEffCork;
+	INT				nEffBusyPoll;
+	INT				nEffFastPath;	// SIO_LOOPBACK_FAST_PATH, the nearest Windows has to busy polling (loopback TCP)
+	INT				nEffDscp;
+} SocketTuning, *LPSocketTuning;
+
+#define COMPRESS_OFF		0						// Never compress file chunks
+#define COMPRESS_ON			1						// Compress every file chunk
+#define COMPRESS_ADAPTIVE	2						// Compress a chunk only when it makes the transfer faster
+
+/* Compression settings and counters for a file transfer (see Compress.cpp). The running averages are only used by
+   the sender; the counters are kept on both ends. */
+typedef struct _CompressState
+{
+	DWORD			dwMode;			// COMPRESS_OFF, COMPRESS_ON or COMPRESS_ADAPTIVE
+	double			dRatio;			// Running average of compressed size / raw size
+	double			dCostPerByte;	// Running average of compression time per raw byte (seconds)
+	double			dLinkRate;		// Running average of the send rate (bytes/second)
+	DWORD			dwSinceProbe;	// Raw chunks sent since compression was last tried
+	DWORD			dwChunks;		// Data chunks sent or received
+	DWORD			dwCompressed;	// How many of those were compressed
+	ULONGLONG		qwLogicalBytes;	// File bytes, before compression
+	ULONGLONG		qwWireBytes;	// Chunk bytes on the wire, headers included
+	ULONGLONG		qwCodecTicks;	// Time spent compressing or decompressing (QueryPerformanceCounter ticks)
+} CompressState, *LPCompressState;
+
+#define INTEGRITY_UNKNOWN	0						// The transfer ended before the sender's digest arrived
+#define INTEGRITY_VERIFIED	1						// Every chunk and the whole-file digest matched
+#define INTEGRITY_FAILED	2						// A chunk checksum or the digest didn't match
+
+/* Checksum counters for a file transfer (see Checksum.cpp). Each chunk carries the CRC32C of its file data, and the
+   CRCs are folded into a digest of the whole file which the sender puts in the CHUNK_END. */
+typedef struct _IntegrityState
+{
+	DWORD			dwResult;		// INTEGRITY_UNKNOWN, INTEGRITY_VERIFIED or INTEGRITY_FAILED
+	DWORD			dwChunks;		// Chunks checksummed
+	DWORD			dwBadChunks;	// Chunks whose CRC didn't match the one in their header
+	DWORD			dwPeerChunks;	// Data chunks the sender says it sent
+	DWORD			dwResumedChunks;// Chunks the receiver already had from an earlier attempt (see Manifest.cpp)
+	ULONGLONG		qwDigest;		// Digest of the chunks seen here
+	ULONGLONG		qwPeerDigest;	// Digest the sender sent
+	ULONGLONG		qwBytes;		// Bytes checksummed
+	ULONGLONG		qwHashTicks;	// Time spent checksumming (QueryPerformanceCounter ticks)
+} IntegrityState, *LPIntegrityState;
+
+/* Settings and counters for delta transfers (see Delta.cpp), where the receiver's existing copy of the file is
+   updated rather than replaced. */
+typedef struct _DeltaState
+{
+	BOOL			bEnabled;		// The client asked for a delta transfer
+	DWORD			dwBlockSize;	// Zero unless a delta transfer is under way
+	ULONGLONG		qwBasisSize;	// Size of the receiver's existing copy
+	DWORD			dwBlocks;		// Blocks signed
+	DWORD			dwMatches;		// Blocks the receiver already had
+	ULONGLONG		qwMatchedBytes;	// Bytes sent as block references
+	ULONGLONG		qwInPlaceBytes;	// Of those, bytes that were already in the right place
+	ULONGLONG		qwLiteralBytes;	// Bytes sent as data
+	ULONGLONG		qwScanBytes;	// Bytes scanned (sender) or signed (receiver)
+	ULONGLONG		qwScanTicks;	// Time spent scanning or signing (QueryPerformanceCounter ticks)
+} DeltaState, *LPDeltaState;
+
+/* Settings and counters for deduplicated transfers (see Dedup.cpp), where the sender cuts the file into chunks by
+   content and the receiver keeps every chunk it's been sent in a store, so only chunks it's never seen are sent. */
+typedef struct _DedupState
+{
+	BOOL			bEnabled;		// The client offers chunk hashes before sending
+	BOOL			bActive;		// A deduplicated transfer is under way
+	TCHAR			szStoreDir[FILENAME_SIZE];	// Where the receiver keeps its chunks
+	DWORD			dwChunks;		// Chunks the file was cut into
+	DWORD			dwDupChunks;	// Of those, chunks the receiver already had
+	ULONGLONG		qwFileBytes;	// Size of the file
+	ULONGLONG		qwDupBytes;		// Bytes the receiver already had, which weren't sent
+	ULONGLONG		qwOfferBytes;	// Size of the chunk list the sender sent
+	ULONGLONG		qwReplyBytes;	// Size of the receiver's answer
+	DWORD			dwStoreChunks;	// Chunks in the store when the transfer began (receiver)
+	DWORD			dwAddedChunks;	// Chunks added to the store (receiver)
+	ULONGLONG		qwAddedBytes;
+	ULONGLONG		qwWorkBytes;	// Bytes cut and hashed (sender) or copied from the store (receiver)
+	ULONGLONG		qwWorkTicks;	// Time spent doing it (QueryPerformanceCounter ticks)
+} DedupState, *LPDedupState;
+
+/* Counters for multi-file transfers (see Batch.cpp), where a directory or a list of files goes out as one stream. */
+typedef struct _BatchState
+{
+	BOOL			bActive;		// A multi-file transfer is under way
+	DWORD			dwFiles;
+	DWORD			dwDirs;
+	ULONGLONG		qwDataBytes;	// Total size of the files
+	ULONGLONG		qwListBytes;	// Size of the file list sent ahead of them
+	DWORD			dwSharedChunks;	// Chunks that carried data from more than one file
+	DWORD			dwWriters;		// Writer threads (receiver)
+	DWORD			dwFailed;		// Files that couldn't be read or written
+} BatchState, *LPBatchState;
+
+/* Settings and counters for session mode (see Session.cpp), where one TCP connection carries transfer after transfer
+   instead of each "Begin Transfer" setting up its own. */
+typedef struct _SessionState
+{
+	BOOL			bEnabled;		// -session was given
+	DWORD			dwIdleMs;		// How long a connection (or the server's listener) is kept with nothing to do
+	SOCKET			conn;			// The connection kept between transfers (client)
+	SOCKET			listener;		// The listening socket kept between connections (server)
+	SOCKADDR_STORAGE peer;			// Where conn goes (client)
+	ULONGLONG		qwLastUsed;		// GetTickCount64 when conn last finished a transfer
+	DWORD			dwTransferId;	// ID of the transfer under way
+	DWORD			dwConnTransfers;// Transfers carried by the current connection, this one included
+	BOOL			bReused;		// This transfer didn't have to set up a connection
+	BOOL			bFinished;		// This transfer ended cleanly, so the stream is ready for the next
+	ULONGLONG		qwExpected;		// Test packet bytes the receiver expects (0 for files)
+	ULONGLONG		qwPeerBytes;	// Bytes the receiver acknowledged (client)
+	LARGE_INTEGER	liStart;		// When the transfer's header was sent or received
+	DWORD			dwConnectUs;	// How long the current connection took to set up
+	ULONGLONG		qwBytes;		// Bytes the transfer carried
+	double			dSeconds;		// The transfer time, header to acknowledgement
+	double			dSetupSaved;	// Estimated time saved on this transfer by not connecting (seconds)
+	double			dSlowStartSaved;// Estimated time saved by not going through slow start again (seconds)
+	double			dTotalSaved;	// Both, summed over the connection's transfers
+} SessionState, *LPSessionState;
+
+/* How the connection for a transfer was set up (see Connect.cpp). The client resolves the server's name, races
+   connections to its addresses, and times each step from "Begin Transfer" to the first byte of data. */
+typedef struct _ConnectState
+{
+	LARGE_INTEGER	liBegin;		// When the transfer started (client) or the connection was accepted (server)
+	BOOL			bNamed;			// The server was given by name rather than address
+	DWORD			dwResolveUs;	// Time spent waiting for the name to resolve
+	BOOL			bCached;		// The addresses came from the resolver cache
+	DWORD			dwAddrs;		// Addresses the name resolved to
+	DWORD			dwAttempts;		// Connections started before one succeeded
+	INT				nFamily;		// AF_INET or AF_INET6 of the address used
+	DWORD			dwConnectUs;	// Time from the first attempt to the winning connection
+	DWORD			dwTtfbUs;		// Time to the first byte of data: sent (client) or received (server)
+	CHAR			szPeer[64];		// The address used, as text
+} ConnectState, *LPConnectState;
+
+#define PAYLOAD_FILL		0						// Every byte 'a', as the test packets always were (not checked)
+#define PAYLOAD_RANDOM		1						// Incompressible pseudo-random bytes
+#define PAYLOAD_PATTERN		2						// A 16-byte pattern, repeated
+#define PAYLOAD_ENTROPY		3						// Random bytes with only dwBits bits of each one varying
+
+/* Settings and counters for the test packet payload (see Payload.cpp). Every packet is generated from the seed and its
+   sequence number, so the receiver regenerates it to check it rather than keeping a copy. */
+typedef struct _PayloadState
+{
+	DWORD			dwKind;			// PAYLOAD_FILL, PAYLOAD_RANDOM, PAYLOAD_PATTERN or PAYLOAD_ENTROPY
+	DWORD			dwBits;			// Bits of entropy per byte (PAYLOAD_ENTROPY)
+	DWORD			dwFlags;		// PAYLOAD_FLAG_* for the header
+	DWORD			dwSeed;
+	BOOL			bSeedGiven;		// -seed was given; otherwise each transfer picks its own
+	BOOL			bActive;		// The packets carry a payload header (sender), or one has been seen (receiver)
+	ULONGLONG		qwGenBytes;		// Bytes generated (sender)
+	ULONGLONG		qwGenTicks;		// Time spent generating them (QueryPerformanceCounter ticks)
+	DWORD			dwPackets;		// Packets checked (receiver)
+	DWORD			dwBadPackets;	// Of those, packets that didn't match
+	DWORD			dwFirstBad;		// Sequence number of the first that didn't
+	DWORD			dwLastBad;		// Sequence number + 1 of the last that didn't (TCP packets span several receives)
+	ULONGLONG		qwStreamOffset;	// Bytes of the TCP stream seen so far
+	BYTE			head[24];		// The start of the TCP stream, kept until the whole payload header has arrived
+	ULONGLONG		qwCheckBytes;	// Bytes checked
+	ULONGLONG		qwCheckTicks;	// Time spent checking them (QueryPerformanceCounter ticks)
+} PayloadState, *LPPayloadState;
+
+#define CONTROL_END_TIMEOUT	0						// The receiver heard nothing for COMM_TIMEOUT
+#define CONTROL_END_MARKER	1						// The sender's end-of-stream marker arrived
+#define CONTROL_END_COUNT	2						// Every test packet the sender announced arrived
+#define CONTROL_END_STREAM	3						// The TCP stream ended, or the file's CHUNK_END arrived
+
+/* The end of a transfer (see Control.cpp). The sender marks the end of its data and the receiver answers with its
+   totals, so both ends report the same numbers as soon as the data is over. */
+typedef struct _ControlState
+{
+	DWORD			dwTransferId;	// Tags the marker and its answer, so ones left over from another transfer are ignored
+	DWORD			dwEnd;			// How the receiver learned the data was over (CONTROL_END_*)
+	DWORD			dwDatagrams;	// UDP datagrams of data sent or received
+	LARGE_INTEGER	liFirst;		// When the first and last data arrived (receiver)
+	LARGE_INTEGER	liLast;
+	DWORD			dwTries;		// Markers sent (sender) or answered (receiver)
+	DWORD			dwReplyUs;		// Time from the first marker to the receiver's totals (sender)
+	BOOL			bPeer;			// The receiver's totals arrived (sender)
+	ULONGLONG		qwPeerBytes;	// The sender's totals (receiver, UDP only) or the receiver's (sender)
+	DWORD			dwPeerDatagrams;
+	DWORD			dwPeerBad;		// Test packets or chunks the receiver found corrupt
+	DWORD			dwPeerResult;	// The receiver's INTEGRITY_* for a file
+	DWORD			dwPeerElapsedUs;// The receiver's time from the first data to the last
+} ControlState, *LPControlState;
+
+#define PMTU_OFF			0						// Don't probe
+#define PMTU_PROBE			1						// Probe before each UDP transfer and report, but send the size chosen
+#define PMTU_AUTO			2						// Probe and size every UDP transfer's datagrams to fit the path
+
+/* Path MTU discovery before a UDP transfer (see Pmtu.cpp). */
+typedef struct _PmtuState
+{
+	DWORD			dwMode;			// PMTU_* (-pmtu)
+	BOOL			bPathSize;		// "Path MTU" was chosen as the packet size, so probe and fit whatever the mode
+	BOOL			bFit;			// This transfer's datagrams were sized to fit the path
+	DWORD			dwRequested;	// The datagram size before fitting; 0 for "Path MTU"
+	BOOL			bFound;			// The server answered, so dwMtu and dwPayload are valid
+	BOOL			bIPv6;
+	DWORD			dwMtu;			// The largest IP packet that got through
+	DWORD			dwPayload;		// The largest UDP payload that fits in it
+	DWORD			dwProbes;		// Probes sent
+	DWORD			dwUnanswered;	// Probes that went unanswered
+	DWORD			dwTooBig;		// Probes the stack refused to send
+	DWORD			dwRttUs;		// Round trip of the base probe
+	DWORD			dwProbeUs;		// Time spent probing
+	DWORD			dwAnswered;		// Probes answered (receiver)
+} PmtuState, *LPPmtuState;
+
+/* One direction of a duplex transfer, as one end sees it (see Duplex.cpp). The time between events is split by
+   whether the other direction was busy, so the two can be compared. */
+typedef struct _DuplexDir
+{
+	ULONGLONG		qwBytes;
+	DWORD			dwPackets;
+	LARGE_INTEGER	liFirst;		// The first and last send completion or arrival
+	LARGE_INTEGER	liLast;
+	BOOL			bDone;
+	ULONGLONG		qwBinBytes[2];	// Bytes moved while the other direction was idle [0] and busy [1]
+	ULONGLONG		qwBinTicks[2];	// The time they took
+	double			dGapSum[2];		// Gaps between send completions in microseconds, for how bursty they were
+	double			dGapSq[2];
+	DWORD			dwGaps[2];
+} DuplexDir, *LPDuplexDir;
+
+/* Duplex mode, where the server sends test packets back to the client while it receives (see Duplex.cpp). The
+   reverse direction has its own overlapped structure, so ov must come first. */
+typedef struct _DuplexState
+{
+	WSAOVERLAPPED	ov;
+	BOOL			bRequested;		// -duplex (client)
+	BOOL			bActive;		// This transfer is duplex
+	BOOL			bServer;		// This end sends the reverse direction
+	BOOL			bPosted;		// A reverse send (server) or receive (client) is outstanding
+	BOOL			bStop;			// Post no more reverse sends
+	SOCKET			s;
+	DWORD			nSockType;
+	SOCKADDR_STORAGE peer;			// Where reverse datagrams go (server, UDP)
+	INT				nPeerLen;
+	WSABUF			wsaBuf;
+	DWORD			nPacketSize;	// The reverse direction mirrors the forward one
+	DWORD			nNumToSend;
+	DWORD			dwNextSeq;		// The next reverse packet to send (server)
+	ULONGLONG		qwExpected;		// Bytes of reverse data still to come over TCP (client)
+	PayloadState	payload;		// Generates (server) or checks (client) the reverse packets
+	DuplexDir		send;			// The direction this end sends
+	DuplexDir		recv;			// The direction this end receives
+	DWORD			dwPeerStamp;	// The last send time the other end stamped, and when it arrived (for the echo)
+	LARGE_INTEGER	liPeerStamp;
+	BYTE			stamp[8];		// A TCP packet's PayloadStamp, gathered as it arrives
+} DuplexState, *LPDuplexState;
+
+#define MCAST_MAXRECEIVERS	64		// Receivers the multicast sender keeps track of
+
+/* One receiver of a multicast transfer, as the sender knows it from its NACKs and its totals. */
+typedef struct _McastReceiver
+{
+	DWORD			dwId;			// Picked by the receiver; several may share an address and port on one host
+	SOCKADDR_STORAGE addr;
+	DWORD			dwNacks;		// NACKs it sent
+	BOOL			bDone;			// Its totals arrived
+	DWORD			dwDoneUs;		// When, from the start of the data
+	ULONGLONG		qwBytes;		// What it received
+	DWORD			dwBad;
+	DWORD			dwResult;		// INTEGRITY_* for a file
+} McastReceiver, *LPMcastReceiver;
+
+/* Multicast distribution, where one UDP sender reaches every receiver in a group and repairs what they report missing
+   (see Multicast.cpp). Datagrams are told apart by their sequence number: a file chunk's, or a test packet's. */
+typedef struct _MulticastState
+{
+	BOOL			bJoin;			// -multicast was given (server)
+	SOCKADDR_STORAGE group;			// The group to join (server)
+	DWORD			dwHops;			// -mchops: how many routers the datagrams may cross (client)
+	BOOL			bActive;		// This transfer is sent to, or was received from, a group
+	DWORD			dwSeqs;			// Sequence numbers in the transfer; 0 until the receiver knows
+	LARGE_INTEGER	liStart;		// When the sender started
+
+	// Sender
+	DWORD			*lastRepair;	// GetTickCount when each datagram was last resent (0 if never)
+	DWORD			dwRounds;		// End markers sent
+	DWORD			dwRepairUs;		// Time from the end of the data to the end of the repairs
+	DWORD			dwNacksIn;		// NACKs received
+	DWORD			dwRepairs;		// Datagrams resent
+	ULONGLONG		qwRepairBytes;
+	DWORD			dwHeldOff;		// Requests for a datagram that had just been resent, so weren't acted on
+	DWORD			dwReceivers;
+	McastReceiver	receivers[MCAST_MAXRECEIVERS];
+
+	// Receiver
+	DWORD			dwId;			// This receiver's ID
+	DWORD			dwTransferId;	// From the sender's end marker
+	DWORD			dwFinishedId;	// The last transfer this receiver finished, whose markers may still be arriving
+	SOCKET			s;
+	SOCKADDR_STORAGE sender;		// Where NACKs and totals go
+	INT				nSenderLen;
+	BYTE			*bitmap;		// The sequence numbers that have arrived
+	DWORD			dwCap;			// Sequence numbers the bitmap holds
+	DWORD			dwHighest;		// One past the highest that has arrived
+	DWORD			dwHave;			// How many have arrived
+	DWORD			dwDuplicates;	// Datagrams that arrived again and were dropped
+	DWORD			dwMissingAtEnd;	// Missing when the first end marker arrived
+	DWORD			dwLate;			// Arrived after the first end marker (repairs)
+	BOOL			bEnded;			// The sender's end marker has arrived; gaps are NACKed from now on
+	HANDLE			hTimer;			// Fires the next NACK after its random delay
+	BOOL			bNackPending;
+	DWORD			dwPendingMissing;// Missing when that NACK was scheduled
+	DWORD			dwLastNack;		// GetTickCount when the last NACK went
+	DWORD			dwNacksOut;		// NACKs sent
+	DWORD			dwNackedSeqs;	// Datagrams they asked for
+	DWORD			dwSuppressed;	// NACKs dropped because repairs asked for by others had already filled the gaps
+	DWORD			dwSuppressedSeqs;// Datagrams dropped from NACKs that way
+	DWORD			dwRng;
+	BOOL			bEndHeld;		// A file's CHUNK_END, kept until the chunks before it have all arrived
+	BYTE			endChunk[64];
+} MulticastState, *LPMulticastState;
+
+/* How the last transfer was started by the worker pool (see Workers.cpp). */
+typedef struct _WorkerStats
+{
+	volatile LONG	lBusy;			// A transfer for these properties is queued or running
+	LARGE_INTEGER	liQueued;		// When Begin Transfer handed it over
+	DWORD			dwStartUs;		// From then until it began running
+	DWORD			dwWorker;		// The worker that ran it, from 1 (0: a thread of its own, as with -workers 0)
+	BOOL			bStolen;		// It was taken from another worker's queue
+	DWORD			dwThreadId;		// The thread running it, for Stop Transfer
+	DWORD			dwJob;			// Counts the transfers run for these properties
+} WorkerStats, *LPWorkerStats;
+
+/* Posts the send the scheduler held back (see ClientTransfer.cpp). */
+typedef VOID (*SchedResume)(VOID *ctx);
+
+/* The transfer's place in the host's send scheduler and what the scheduler did to it (see Sched.cpp). */
+typedef struct _SchedState
+{
+	DWORD			dwWeight;		// -weight; '+' and '-' in the main window double and halve it
+	DWORD			dwCapKbps;		// -ratecap: this transfer's own limit (0: none)
+	DWORD			dwHostKbps;		// -hostcap: the limit shared by every transfer on the host (0: none; SCHED_HOST_KEEP: not given)
+	volatile BOOL	bPaused;		// 'p' in the main window
+	volatile BOOL	bStopped;		// Transfer > Stop Transfer
+	DWORD			dwStopJob;		// The job Stop Transfer was meant for (see WorkerStats)
+	DWORD			dwKeyJob;		// The job the last 'p', '+' or '-' was meant for
+	BOOL			bJoined;		// The transfer has a slot (or would have, if the table couldn't be opened)
+	INT				nSlot;			// Its slot in the shared table, or -1
+	HANDLE			hTimer;			// Posts a send that was held back
+	SchedResume		resume;
+	VOID			*ctx;
+	double			dTokens;		// Bytes it may send right away
+	LARGE_INTEGER	liRefill;		// When they were last topped up
+	LARGE_INTEGER	liHeld;			// When the send waiting on hTimer was held back
+	DWORD			dwPending;		// Its size
+	DWORD			dwLastSend;		// GetTickCount of the last send, for the trickle while paused
+	DWORD			dwShareKbps;	// Its share of the limits above it (0: unlimited)
+	DWORD			dwShareTick;	// GetTickCount when that was worked out
+	DWORD			dwHeld;			// Sends held back
+	ULONGLONG		qwHeldUs;		// Time they spent held back
+	DWORD			dwPauses;
+	DWORD			dwPauseStart;	// GetTickCount when the current pause began
+	DWORD			dwPausedMs;
+	DWORD			dwReweights;
+	DWORD			dwMinShareKbps;	// Smallest and largest share it was given while sharing a limit
+	DWORD			dwMaxShareKbps;
+	DWORD			dwPeers;		// Most other transfers sending at once
+} SchedState, *LPSchedState;
+
+/* -busypoll, and how long the transfer's completions took to be handled and what the waiting cost in either mode (see
+   BusyPoll.cpp). */
+typedef struct _PollState
+{
+	BOOL			bEnabled;		// -busypoll: spin on the transfer's completions instead of waiting alertably
+	INT				nCpu;			// The processor to pin the transfer's thread to (-1: the highest-numbered one)
+	BOOL			bPinned;
+	DWORD			dwPinnedCpu;
+	DWORD_PTR		dwOldMask;		// The worker's affinity and priority before it was pinned
+	INT				nOldPriority;
+	LPWSAOVERLAPPED_COMPLETION_ROUTINE pending;	// The routine for the I/O outstanding on the transfer's overlapped
+	LARGE_INTEGER	liPosted;		// When that I/O was posted
+	LARGE_INTEGER	liFirst;		// When the first completion was handled
+	ULONGLONG		qwUserFirst;	// The thread's CPU time then (100ns units)
+	ULONGLONG		qwKernelFirst;
+	ULONGLONG		qwCpuUser;		// What the thread used from then until the end of the transfer
+	ULONGLONG		qwCpuKernel;
+	double			dWallUs;		// And the time that took
+	DWORD			dwCompletions;
+	ULONGLONG		qwEmptyPolls;	// Polls that found nothing had completed
+} PollState, *LPPollState;
+
+/* Where the transfer's thread ran relative to the NIC, and how busy each processor was while it did (see Affinity.cpp). */
+typedef struct _AffinityState
+{
+	INT				nNicNode;		// The NUMA node the socket's traffic arrives on (-1: the stack didn't say)
+	DWORD			dwNicCpus;		// Processors receive-side scaling spreads it over
+	BOOL			bPlaced;		// The thread was moved to the NIC's node for this transfer (-iocpus auto)
+	GROUP_AFFINITY	oldAffinity;	// Its affinity before that
+	BOOL			bSampled;		// Processor times were taken when the transfer started
+	PROCESSOR_NUMBER endCpu;		// Where the transfer's thread was running when it ended
+	USHORT			wEndNode;
+	DWORD			dwCpus;			// Processors measured: those in endCpu's group
+	BYTE			busy[MAXIMUM_PROC_PER_GROUP];	// Each one's busy % over the transfer
+	BYTE			nodes[MAXIMUM_PROC_PER_GROUP];	// And its NUMA node
+	double			dWallMs;
+} AffinityState, *LPAffinityState;
+
+#define CRYPT_AESGCM		0x0001					// AES-256-GCM; both ends need AES-NI and PCLMULQDQ
+#define CRYPT_CHACHA		0x0002					// ChaCha20-Poly1305
+#define CRYPT_AUTO			(CRYPT_AESGCM | CRYPT_CHACHA)	// AES-GCM if both ends have the instructions, else ChaCha
+#define CRYPT_PSK_SIZE		128						// The longest pre-shared key, in bytes
+#define CRYPT_KEY_STATE		304						// An expanded key: AES round keys and GHASH powers, or a ChaCha key
+
+/* -psk and -cipher, the key the handshake agreed for this transfer and what sealing or opening its records cost (see
+   Crypt.cpp). Only the client's data is sealed, so each end holds the one key for that direction. */
+typedef struct _CryptState
+{
+	BOOL			bEnabled;		// -psk: seal everything the client sends, and refuse a peer without the key
+	DWORD			dwCiphers;		// -cipher: the CRYPT_* this end will use
+	BYTE			psk[CRYPT_PSK_SIZE];
+	DWORD			dwPskLen;
+	BOOL			bActive;		// The handshake is done; the client seals and the server opens
+	DWORD			dwCipher;		// The one agreed on
+	BYTE			key[CRYPT_KEY_STATE];
+	BYTE			salt[4];		// The fixed part of every record's nonce
+	ULONGLONG		qwNextSeq;		// Client: the next record's counter
+	ULONGLONG		qwTopSeq;		// Server: the highest counter opened so far (plus one; 0 for none)
+	ULONGLONG		qwSeen;			// And which of the 64 before it have been opened
+	BYTE			peerNonce[16];	// UDP server: the hello last answered, and this end's nonce in the answer, so a
+	BYTE			ownNonce[16];	// repeated hello gets the same answer
+	BYTE			*record;		// Server: a TCP test packet being reassembled, with its trailer
+	DWORD			dwRecordLen;	// The packet size (0 if the records aren't test packets)
+	DWORD			dwHave;
+	BOOL			bCorrupt;		// A record failed to open; the stream can't be trusted after it
+	DWORD			dwRecords;		// Records sealed or opened
+	ULONGLONG		qwBytes;		// And the bytes in them, not counting what sealing adds
+	ULONGLONG		qwTicks;		// Time spent sealing or opening them (performance counter ticks)
+	DWORD			dwRejected;		// Records that didn't open or were replayed
+	DWORD			dwHandshakeUs;
+} CryptState, *LPCryptState;
+
+/* -trace, and what the last export of the threads' event rings wrote (see Trace.cpp). */
+typedef struct _TraceState
+{
+	BOOL			bExported;		// The timeline was written (or tried) at the end of this transfer
+	BOOL			bFailed;		// The file couldn't be written
+	DWORD			dwEvents;		// Events in the timeline
+	DWORD			dwThreads;		// Threads they came from
+	DWORD			dwOverwritten;	// Events written since the last export that a ring wrapped over before this one
+	DWORD			dwUntraced;		// Threads that found all TRACE_MAX_RINGS rings in use
+	double			dExportMs;		// Time taken to write the file
+} TraceState, *LPTraceState;
+
+/* -capture, and what the server recorded of the last transfer's arrivals (see Capture.cpp). */
+typedef struct _CaptureState
+{
+	CHAR			szFile[FILENAME_SIZE];	// -capture: where each transfer's arrivals are written, or empty
+	HANDLE			hFile;			// Open while a transfer is being recorded
+	BYTE			*buf;			// Records not yet written
+	DWORD			dwUsed;
+	DWORD			nSockType;
+	LARGE_INTEGER	liFirst;		// When the first arrival was recorded
+	ULONGLONG		qwLastUs;		// And the last, in microseconds after it
+	DWORD			dwRecords;
+	ULONGLONG		qwBytes;
+	ULONGLONG		qwFileBytes;	// Written to the file, header included
+	BOOL			bFull;			// CAPTURE_MAXRECORDS were recorded and the rest weren't
+	BOOL			bFailed;		// The file couldn't be created or written
+	BOOL			bRecorded;		// The last transfer was recorded (or tried)
+} CaptureState, *LPCaptureState;
+
+/* -replay and -replayspeed: a recording the client sends again in place of uniform test packets, and how closely the
+   last transfer kept to its timing (see Capture.cpp). */
+typedef struct _ReplayState
+{
+	CHAR			szFile[FILENAME_SIZE];	// -replay: the recording, or empty
+	double			dSpeed;			// -replayspeed: 1 as recorded, 2 twice as fast, 0 flat out
+	DWORD			*sizes;			// Each arrival's size
+	DWORD			*gaps;			// And the microseconds since the one before it
+	DWORD			dwCount;
+	DWORD			dwMaxSize;
+	ULONGLONG		qwBytes;		// What the recording holds, over how long, and what it was recorded from
+	ULONGLONG		qwDurationUs;
+	DWORD			nSockType;
+	BOOL			bActive;		// This transfer is a replay
+	HANDLE			hTimer;			// Posts a send held back until it's due
+	SchedResume		resume;
+	VOID			*ctx;
+	BOOL			bHeld;			// A send is waiting on hTimer
+	LARGE_INTEGER	liStart;		// When the first send was posted (0: not yet)
+	DWORD			dwNext;			// The next record to send
+	ULONGLONG		qwDueUs;		// When the send being built is due, at the recording's speed
+	ULONGLONG		qwLastUs;		// When the last send was posted
+	DWORD			dwSent;			// Sends posted
+	DWORD			dwResized;		// Records that don't fit a UDP test packet, sent at the nearest size that does
+	DWORD			dwHeld;			// Sends held back on the timer
+	DWORD			dwLate;			// Sends posted more than REPLAY_LATE_US after they were due
+	ULONGLONG		qwLateUs;		// Their lateness in all, and the worst
+	DWORD			dwMaxLateUs;
+} ReplayState, *LPReplayState;
+
+/* The modelled link for -sim/-simsweep and what the last simulated transfer did (see Sim.cpp). Times are in virtual
+   nanoseconds from the start of the simulation. */
+typedef struct _SimState
+{
+	BOOL			bEnabled;		// Begin Transfer runs the simulation instead of a real transfer
+	CHAR			szSweep[FILENAME_SIZE];	// Profile file for -simsweep, or empty
+	double			dRateMbps;		// Bottleneck rate
+	DWORD			dwRttUs;		// Round trip propagation delay
+	double			dLoss;			// Chance of each packet (or IP fragment) being lost on the bottleneck
+	DWORD			dwQueueBytes;	// Bottleneck queue; 0 for one bandwidth-delay product
+	DWORD			dwSeed;
+	ULONGLONG		qwClientStart;	// When the sender started and finished sending, as ClientSendData sees it
+	ULONGLONG		qwClientEnd;
+	ULONGLONG		qwServerStart;	// The receiver's start and end times, as Serve reports them
+	ULONGLONG		qwServerEnd;
+	ULONGLONG		qwRunEnd;		// When both ends would have finished, including the receiver's timeout
+	ULONGLONG		qwDelivered;	// Bytes delivered to the receiver
+	DWORD			dwDatagrams;	// UDP datagrams delivered
+	DWORD			dwMarkers;		// UDP end-of-stream markers sent
+	ULONGLONG		qwMarkerArrive;	// When the first one to get through reached the receiver (0 if none did)
+	DWORD			dwQueueDrops;	// Packets (or fragments) dropped by a full bottleneck queue
+	DWORD			dwLinkLosses;	// Packets (or fragments) lost to the loss model
+	DWORD			dwRetransmits;	// TCP segments sent again
+	DWORD			dwFastRetransmits;
+	DWORD			dwTimeouts;		// Retransmission timeouts
+	ULONGLONG		qwEvents;		// Events processed
+	double			dWallMs;		// Real time the simulation took
+	BOOL			bStalled;		// The transfer hadn't finished by SIM_MAX_NS
+} SimState, *LPSimState;
+
+/* Settings for -bench (see Bench.cpp). */
+typedef struct _BenchState
+{
+	CHAR			szBaseline[FILENAME_SIZE];	// Baseline file, or empty
+	DWORD			dwTolerance;	// Percent slower than its baseline a kernel may get before it's a regression
+} BenchState, *LPBenchState;
 
 /* This structure contains the properties necessary to perform a transfer. */
 typedef struct _TransferProps
 {
 	WSAOVERLAPPED	wsaOverlapped;
-	LPSOCKADDR_IN	paddr_in;
+	SOCKADDR_STORAGE addr;			// The server's address, IPv4 or IPv6 (once a host name has been resolved, the one in use)
+	INT				nAddrLen;		// The length of the sockaddr in addr
+	USHORT			usPort;			// The port, in host byte order
 	SOCKET			socket;
 	DWORD			nSockType;
 	TCHAR			szFileName[FILENAME_SIZE];
@@ -23,6 +581,29 @@ typedef struct _TransferProps
 	SYSTEMTIME		startTime;
 	SYSTEMTIME		endTime;
 	DWORD			dwTimeout;
+	SocketTuning	tuning;
+	CompressState	compress;
+	IntegrityState	integrity;
+	DeltaState		delta;
+	DedupState		dedup;
+	BatchState		batch;
+	SessionState	session;
+	ConnectState	connect;
+	PayloadState	payload;
+	ControlState	control;
+	PmtuState		pmtu;
+	DuplexState		duplex;
+	MulticastState	multicast;
+	WorkerStats		worker;
+	SchedState		sched;
+	PollState		poll;
+	AffinityState	affinity;
+	CryptState		crypt;
+	TraceState		trace;
+	CaptureState	capture;
+	ReplayState		replay;
+	SimState		sim;
+	BenchState		bench;
 } TransferProps, *LPTransferProps;
 
 #endif
\ No newline at end of file
@@ -37,6 +37,9 @@
 --
 -- NOTES:
 -- Handles manipulation of the menu items and the user quitting. All other functions are handled by DefWndProc.
+-- Transfers run on the worker pool (see Workers.cpp), one at a time per window since they share its properties.
+-- Stop Transfer ends the running transfer early, and 'p', '+' and '-' pause it and change its weight in the host's
+-- send scheduler while it runs (see Sched.cpp).
 ---------------------------------------------------------------------------------------------------------------------------*/
 LRESULT CALLBACK WndProc(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam)
 {
@@ -53,20 +56,44 @@ LRESULT CALLBACK WndProc(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In
 			DWORD dwHostMode = (DWORD)GetWindowLongPtr(hwnd, GWLP_HOSTMODE);
 			LPTransferProps props = (LPTransferProps)GetWindowLongPtr(hwnd, GWLP_TRANSFERPROPS);
 
-			if (dwHostMode == ID_HOSTTYPE_CLIENT)
+			if (props->worker.lBusy)
+			{
+				MessageBox(hwnd, TEXT("The last transfer is still running."), TEXT("Transfer Running"), MB_ICONWARNING);
+				break;
+			}
+
+			props->sched.bStopped = FALSE;
+			if (props->sim.bEnabled)
+			{
+				// The simulated link holds no socket, so there's nothing to release if the transfer can't start
+				if (!SubmitTransfer(SimulateTransfer, (VOID *)hwnd, &props->worker))
+					break;
+			}
+			else if (dwHostMode == ID_HOSTTYPE_CLIENT)
 			{
 				if (!ClientInitSocket(props))
 					break;
-				CreateThread(NULL, 0, ClientSendData, (VOID *)hwnd, 0, NULL);
+				if (!SubmitTransfer(ClientSendData, (VOID *)hwnd, &props->worker))
+					closesocket(props->socket);
 			}
 			else
 			{
 				if (!ServerInitSocket(props))
 					break;
-				CreateThread(NULL, 0, Serve, (VOID *)hwnd, 0, NULL);
+				if (!SubmitTransfer(Serve, (VOID *)hwnd, &props->worker))
+					closesocket(props->socket);
 			}
 			break;
 		}
+		case ID_TRANSFER_STOPTRANSFER:
+		{
+			LPTransferProps props = (LPTransferProps)GetWindowLongPtr(hwnd, GWLP_TRANSFERPROPS);
+
+			if (!StopTransfer(props))
+				MessageBox(hwnd, props->worker.lBusy ? TEXT("The transfer hasn't started yet.") :
+					TEXT("No transfer is running."), TEXT("Stop Transfer"), MB_ICONINFORMATION);
+			break;
+		}
 		case ID_TRANSFER_PROPERTIES:
 			DialogBox((HINSTANCE)GetWindowLongPtr(hwnd, GWLP_HINSTANCE), MAKEINTRESOURCE(IDD_DIALOG1), hwnd, TransferDlgProc);
 			break;
@@ -85,6 +112,23 @@ LRESULT CALLBACK WndProc(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In
 		}
 		}
 		return 0;
+	case WM_CHAR:
+	{
+		LPTransferProps props = (LPTransferProps)GetWindowLongPtr(hwnd, GWLP_TRANSFERPROPS);
+
+		switch (wParam)
+		{
+		case 'p':
+		case 'P':
+			SchedTogglePause(props);
+			break;
+		case '+':
+		case '-':
+			SchedReweight(props, wParam == '+');
+			break;
+		}
+		return 0;
+	}
 	case WM_DESTROY:
 		free((void *)GetWindowLongPtr(hwnd, GWLP_TRANSFERPROPS));
 		PostQuitMessage(0);
@@ -6,6 +6,9 @@
 #include "resource.h"
 #include "ClientTransfer.h"
 #include "ServerTransfer.h"
+#include "Sim.h"
+#include "Workers.h"
+#include "Sched.h"
 
 LRESULT CALLBACK WndProc(_In_ HWND hwnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam);
 #endif
\ No newline at end of file
@@ -0,0 +1,489 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Workers.cpp
+--
+-- PROGRAM: Assn2
+--
+-- FUNCTIONS:
+-- VOID SetWorkerCount(DWORD dwCount);
+-- BOOL InitWorkers();
+-- BOOL SubmitTransfer(LPTHREAD_START_ROUTINE lpProc, VOID *lpParam, LPWorkerStats stats);
+-- BOOL SignalTransfer(LPWorkerStats stats, PAPCFUNC pfnApc, ULONG_PTR param);
+-- INT FormatWorkerReport(CHAR *buf, size_t size, LPWorkerStats stats);
+-- static BOOL PushJob(LPWorker w, const WorkerJob *job);
+-- static BOOL PopJob(LPWorker w, LPWorkerJob job, BOOL bSteal);
+-- static BOOL TakeJob(LPWorker w, LPWorkerJob job, LPBOOL pbStolen);
+-- static VOID RunJob(LPWorkerJob job, DWORD dwWorker, BOOL bStolen);
+-- static DWORD WINAPI WorkerProc(VOID *param);
+-- static DWORD WINAPI OwnThreadProc(VOID *param);
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	This file runs transfers on a pool of threads started with the program, one per core (up to WORKER_MAX),
+--			instead of creating a thread for every transfer and letting it exit at the end. A short transfer
+--			no longer pays for a thread being created and torn down, and the pool buffers a thread keeps for itself
+--			(see Pool.cpp) stay warm from one transfer to the next.
+--
+--			Each worker has its own queue. Begin Transfer hands the transfer to an idle worker if there is one, and
+--			otherwise queues it behind the worker with the least waiting; a worker that runs out of its own
+--			transfers takes the newest one waiting for another worker. Completion routines are APCs, and Windows
+--			only runs them on the thread that posted the I/O, so once a transfer has started it stays on its worker
+--			and only transfers still waiting can be stolen. Workers wait alertably between transfers, so completions
+--			for I/O that a transfer left behind when it closed its socket run there and not in the next transfer.
+--
+--			The time from Begin Transfer to the transfer running is reported for each transfer, with the average and
+--			worst over every transfer the program has started. -workers 0 starts a thread per transfer as before, for
+--			comparison.
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Workers.h"
+
+static Worker			workers[WORKER_MAX];
+static DWORD			dwWorkers	= 0;				// Workers running; 0 means a thread per transfer
+static DWORD			dwWanted	= WORKER_DEFAULT;	// -workers
+static volatile LONG	lNext		= 0;				// Where the search for an idle worker starts
+static volatile LONG	lStarted	= 0;				// Transfers started
+static volatile LONG	lStolen		= 0;
+static volatile LONG64	llStartUs	= 0;				// Their total start latency
+static volatile LONG	lWorstUs	= 0;
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SetWorkerCount
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SetWorkerCount(DWORD dwCount)
+--							DWORD dwCount:	Workers to start (-workers), or 0 for a thread per transfer.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Only takes effect if it's called before InitWorkers.
+---------------------------------------------------------------------------------------------------------------------------*/
+VOID SetWorkerCount(DWORD dwCount)
+{
+	dwWanted = min(dwCount, (DWORD)WORKER_MAX);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PushJob
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PushJob(LPWorker w, const WorkerJob *job)
+--							LPWorker w:				The worker to queue the transfer for.
+--							const WorkerJob *job:	The transfer.
+--
+-- RETURNS: FALSE if the worker's queue is full; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL PushJob(LPWorker w, const WorkerJob *job)
+{
+	BOOL bQueued = FALSE;
+
+	EnterCriticalSection(&w->lock);
+	if (w->dwCount < WORKER_QUEUE)
+	{
+		w->queue[(w->dwHead + w->dwCount) % WORKER_QUEUE] = *job;
+		w->dwCount++;
+		bQueued = TRUE;
+	}
+	LeaveCriticalSection(&w->lock);
+	return bQueued;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PopJob
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PopJob(LPWorker w, LPWorkerJob job, BOOL bSteal)
+--							LPWorker w:			The worker whose queue to take from.
+--							LPWorkerJob job:	Receives the transfer.
+--							BOOL bSteal:		Whether another worker is taking it.
+--
+-- RETURNS: FALSE if the queue is empty; TRUE otherwise.
+--
+-- NOTES:
+-- The owner takes transfers in the order they were queued. A thief takes the newest, which has the longest wait ahead
+-- of it where it is.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL PopJob(LPWorker w, LPWorkerJob job, BOOL bSteal)
+{
+	BOOL bTaken = FALSE;
+
+	EnterCriticalSection(&w->lock);
+	if (w->dwCount != 0)
+	{
+		w->dwCount--;
+		if (bSteal)
+			*job = w->queue[(w->dwHead + w->dwCount) % WORKER_QUEUE];
+		else
+		{
+			*job = w->queue[w->dwHead];
+			w->dwHead = (w->dwHead + 1) % WORKER_QUEUE;
+		}
+		bTaken = TRUE;
+	}
+	LeaveCriticalSection(&w->lock);
+	return bTaken;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TakeJob
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TakeJob(LPWorker w, LPWorkerJob job, LPBOOL pbStolen)
+--							LPWorker w:			The worker looking for a transfer.
+--							LPWorkerJob job:	Receives the transfer.
+--							LPBOOL pbStolen:	Set if it came from another worker's queue.
+--
+-- RETURNS: FALSE if no transfer is waiting anywhere; TRUE otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static BOOL TakeJob(LPWorker w, LPWorkerJob job, LPBOOL pbStolen)
+{
+	DWORD i;
+
+	*pbStolen = FALSE;
+	if (PopJob(w, job, FALSE))
+		return TRUE;
+
+	for (i = 1; i < dwWorkers; i++)
+	{
+		if (PopJob(&workers[(w->dwIndex + i) % dwWorkers], job, TRUE))
+		{
+			*pbStolen = TRUE;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RunJob
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RunJob(LPWorkerJob job, DWORD dwWorker, BOOL bStolen)
+--							LPWorkerJob job:	The transfer.
+--							DWORD dwWorker:		The worker running it, from 1, or 0 for a thread of its own.
+--							BOOL bStolen:		Whether it was taken from another worker's queue.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Records how long the transfer waited to start, runs it, and lets the window start another.
+---------------------------------------------------------------------------------------------------------------------------*/
+static VOID RunJob(LPWorkerJob job, DWORD dwWorker, BOOL bStolen)
+{
+	LPWorkerStats	stats	= job->stats;
+	DWORD			dwUs	= ElapsedUs(&stats->liQueued);
+	LONG			lWorst;
+
+	stats->dwStartUs	= dwUs;
+	stats->dwWorker		= dwWorker;
+	stats->bStolen		= bStolen;
+	InterlockedIncrement(&lStarted);
+	InterlockedExchangeAdd64(&llStartUs, dwUs);
+	if (bStolen)
+		InterlockedIncrement(&lStolen);
+	while ((lWorst = lWorstUs) < (LONG)dwUs && InterlockedCompareExchange(&lWorstUs, (LONG)dwUs, lWorst) != lWorst)
+		;
+
+	stats->dwJob++;
+	InterlockedExchange((volatile LONG *)&stats->dwThreadId, (LONG)GetCurrentThreadId());
+	job->lpProc(job->lpParam);
+
+	// Completions of I/O cancelled when the transfer closed its socket run now, rather than during the next one
+	while (SleepEx(0, TRUE) == WAIT_IO_COMPLETION)
+		;
+	InterlockedExchange((volatile LONG *)&stats->dwThreadId, 0);
+	InterlockedExchange(&stats->lBusy, 0);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: WorkerProc
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: WorkerProc(VOID *param)
+--							VOID *param:	The worker.
+--
+-- RETURNS: Never; the workers run until the program exits.
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD WINAPI WorkerProc(VOID *param)
+{
+	LPWorker	w = (LPWorker)param;
+	WorkerJob	job;
+	BOOL		bStolen;
+
+	PlaceThread(AFFINITY_IO, w->dwIndex);
+	NameTraceThread("Worker", w->dwIndex + 1);
+	for (;;)
+	{
+		if (TakeJob(w, &job, &bStolen))
+		{
+			RunJob(&job, w->dwIndex + 1, bStolen);
+			continue;
+		}
+
+		InterlockedExchange(&w->lIdle, 1);
+		TraceEvent(TRACE_IDLE_BEGIN, 0, NULL);
+		WaitForSingleObjectEx(w->hWake, INFINITE, TRUE);
+		TraceEvent(TRACE_IDLE_END, 0, NULL);
+		InterlockedExchange(&w->lIdle, 0);
+	}
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: OwnThreadProc
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: OwnThreadProc(VOID *param)
+--							VOID *param:	The transfer, allocated by SubmitTransfer.
+--
+-- RETURNS: What the transfer returned.
+--
+-- NOTES:
+-- Runs a transfer on a thread of its own, as every transfer was before the pool (-workers 0).
+---------------------------------------------------------------------------------------------------------------------------*/
+static DWORD WINAPI OwnThreadProc(VOID *param)
+{
+	LPWorkerJob job = (LPWorkerJob)param;
+
+	PlaceThread(AFFINITY_IO, AFFINITY_ANY);
+	RunJob(job, 0, FALSE);
+	free(job);
+	DetachTrace();
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitWorkers
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitWorkers()
+--
+-- RETURNS: FALSE if no worker could be started, in which case each transfer gets a thread of its own; TRUE otherwise.
+--
+-- NOTES:
+-- Starts one worker per core (per processor -iocpus gave, if it gave any), or as many as -workers asked for.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL InitWorkers()
+{
+	SYSTEM_INFO	info;
+	DWORD		dwCount = dwWanted;
+	LPWorker	w;
+
+	if (dwCount == WORKER_DEFAULT)
+	{
+		GetSystemInfo(&info);
+		if ((dwCount = AffinityCpus(AFFINITY_IO)) == 0)
+			dwCount = info.dwNumberOfProcessors;
+		dwCount = min(max(dwCount, (DWORD)1), (DWORD)WORKER_MAX);
+	}
+
+	for (dwWorkers = 0; dwWorkers < dwCount; dwWorkers++)
+	{
+		w = &workers[dwWorkers];
+		memset(w, 0, sizeof(Worker));
+		w->dwIndex = dwWorkers;
+		if ((w->hWake = CreateEvent(NULL, FALSE, FALSE, NULL)) == NULL)
+			break;
+		InitializeCriticalSection(&w->lock);
+		if ((w->hThread = CreateThread(NULL, 0, WorkerProc, w, 0, NULL)) == NULL)
+		{
+			DeleteCriticalSection(&w->lock);
+			CloseHandle(w->hWake);
+			break;
+		}
+	}
+	return dwWorkers != 0 || dwCount == 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SubmitTransfer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SubmitTransfer(LPTHREAD_START_ROUTINE lpProc, VOID *lpParam, LPWorkerStats stats)
+--							LPTHREAD_START_ROUTINE lpProc:	The transfer's thread function.
+--							VOID *lpParam:					Its parameter (the main window).
+--							LPWorkerStats stats:			The transfer's worker stats, marked busy until it's done.
+--
+-- RETURNS: FALSE if the transfer couldn't be started; TRUE otherwise.
+--
+-- NOTES:
+-- Wakes an idle worker to run the transfer, or queues it behind the worker with the least waiting, where whichever
+-- worker comes free first may take it. Without workers the transfer gets a thread of its own.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SubmitTransfer(LPTHREAD_START_ROUTINE lpProc, VOID *lpParam, LPWorkerStats stats)
+{
+	WorkerJob	job;
+	LPWorkerJob	own;
+	LPWorker	w			= NULL;
+	DWORD		dwStart		= (DWORD)InterlockedIncrement(&lNext);
+	HANDLE		hThread;
+	DWORD		i;
+
+	job.lpProc	= lpProc;
+	job.lpParam	= lpParam;
+	job.stats	= stats;
+	InterlockedExchange(&stats->lBusy, 1);
+	QueryPerformanceCounter(&stats->liQueued);
+
+	if (dwWorkers == 0)
+	{
+		if ((own = (LPWorkerJob)malloc(sizeof(WorkerJob))) != NULL)
+		{
+			*own = job;
+			if ((hThread = CreateThread(NULL, 0, OwnThreadProc, own, 0, NULL)) != NULL)
+			{
+				CloseHandle(hThread);
+				return TRUE;
+			}
+			free(own);
+		}
+		MessageBox(NULL, TEXT("Could not start a thread for the transfer."), TEXT("No Thread"), MB_ICONERROR);
+		InterlockedExchange(&stats->lBusy, 0);
+		return FALSE;
+	}
+
+	// An idle worker is claimed so two transfers don't both go to it
+	for (i = 0; i < dwWorkers && w == NULL; i++)
+		if (InterlockedCompareExchange(&workers[(dwStart + i) % dwWorkers].lIdle, 0, 1) == 1)
+			w = &workers[(dwStart + i) % dwWorkers];
+	if (w == NULL)
+	{
+		w = &workers[dwStart % dwWorkers];
+		for (i = 1; i < dwWorkers; i++)
+			if (workers[(dwStart + i) % dwWorkers].dwCount < w->dwCount)
+				w = &workers[(dwStart + i) % dwWorkers];
+	}
+
+	if (!PushJob(w, &job))
+	{
+		MessageBox(NULL, TEXT("Every worker has a full queue of transfers; try again once some have finished."),
+			TEXT("Too Many Transfers"), MB_ICONERROR);
+		InterlockedExchange(&stats->lBusy, 0);
+		return FALSE;
+	}
+	SetEvent(w->hWake);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SignalTransfer
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SignalTransfer(LPWorkerStats stats, PAPCFUNC pfnApc, ULONG_PTR param)
+--							LPWorkerStats stats:	The transfer's worker stats.
+--							PAPCFUNC pfnApc:		The function to run on the transfer's thread.
+--							ULONG_PTR param:		Its parameter.
+--
+-- RETURNS: FALSE if the transfer isn't running (a transfer still queued can't be signalled); TRUE otherwise.
+--
+-- NOTES:
+-- Queues pfnApc to the thread running the transfer, where it runs the next time the transfer waits alertably, between
+-- its completion routines. The transfer's state can only be touched safely from there. stats->dwJob, read before the
+-- call, tells pfnApc whether the transfer it was meant for is the one still running.
+---------------------------------------------------------------------------------------------------------------------------*/
+BOOL SignalTransfer(LPWorkerStats stats, PAPCFUNC pfnApc, ULONG_PTR param)
+{
+	DWORD	dwThreadId = stats->dwThreadId;
+	HANDLE	hThread;
+	BOOL	bQueued;
+
+	if (dwThreadId == 0 || (hThread = OpenThread(THREAD_SET_CONTEXT, FALSE, dwThreadId)) == NULL)
+		return FALSE;
+	bQueued = QueueUserAPC(pfnApc, hThread, param) != 0;
+	CloseHandle(hThread);
+	return bQueued;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FormatWorkerReport
+--
+-- DATE: October 19th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FormatWorkerReport(CHAR *buf, size_t size, LPWorkerStats stats)
+--							CHAR *buf:				The buffer to write the report section into.
+--							size_t size:			The space left in buf.
+--							LPWorkerStats stats:	How the transfer was started.
+--
+-- RETURNS: The number of characters written.
+---------------------------------------------------------------------------------------------------------------------------*/
+INT FormatWorkerReport(CHAR *buf, size_t size, LPWorkerStats stats)
+{
+	INT		written	= 0;
+	LONG	lCount	= lStarted;
+
+	// Sweeps and benchmarks format reports without going through the workers
+	if (stats->liQueued.QuadPart == 0)
+		return 0;
+
+	if (stats->dwWorker == 0)
+		written += sprintf_s(buf, size, "Transfer start: %luus from Begin Transfer to running, on a thread of its own\r\n",
+			stats->dwStartUs);
+	else
+		written += sprintf_s(buf, size, "Transfer start: %luus from Begin Transfer to running, on worker %lu of %lu%s\r\n",
+			stats->dwStartUs, stats->dwWorker, dwWorkers,
+			stats->bStolen ? " (taken from another worker's queue)" : "");
+
+	if (lCount != 0)
+		written += sprintf_s(buf + written, size - written,
+			"Transfers started: %ld, %ld stolen; start latency %.1fus average, %ldus worst\r\n", lCount, lStolen,
+			(double)llStartUs / lCount, lWorstUs);
+	return written;
+}
@@ -0,0 +1,45 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <Windows.h>
+#include <cstdio>
+#include <cstring>
+#include "WinStorage.h"
+#include "Utils.h"
+#include "Connect.h"
+#include "Affinity.h"
+#include "Trace.h"
+
+#define WORKER_MAX			16			// Most workers the pool starts, however many cores there are
+#define WORKER_QUEUE		8			// Transfers waiting in each worker's queue
+#define WORKER_DEFAULT		0xFFFFFFFF	// One worker per core
+
+/* A transfer waiting to run. */
+typedef struct _WorkerJob
+{
+	LPTHREAD_START_ROUTINE	lpProc;		// ClientSendData, Serve or SimulateTransfer
+	VOID					*lpParam;	// The main window
+	LPWorkerStats			stats;		// The transfer's properties' worker stats
+} WorkerJob, *LPWorkerJob;
+
+/* One thread of the pool and the transfers queued for it. Its own transfers are taken from the head; other workers
+   steal from the tail. */
+typedef struct _Worker
+{
+	DWORD				dwIndex;
+	HANDLE				hThread;
+	HANDLE				hWake;			// Set when a transfer is queued for it
+	CRITICAL_SECTION	lock;			// Guards the queue
+	WorkerJob			queue[WORKER_QUEUE];
+	DWORD				dwHead;
+	DWORD				dwCount;
+	volatile LONG		lIdle;			// Waiting for a transfer
+} Worker, *LPWorker;
+
+VOID SetWorkerCount(DWORD dwCount);
+BOOL InitWorkers();
+BOOL SubmitTransfer(LPTHREAD_START_ROUTINE lpProc, VOID *lpParam, LPWorkerStats stats);
+BOOL SignalTransfer(LPWorkerStats stats, PAPCFUNC pfnApc, ULONG_PTR param);
+INT FormatWorkerReport(CHAR *buf, size_t size, LPWorkerStats stats);
+
+#endif
@@ -0,0 +1,1522 @@
+/*----------------------------------------------------------------------------------------------------------------------
+-- SOURCE FILE: Impair.cpp
+--
+-- PROGRAM: Impair
+--
+-- FUNCTIONS:
+-- int main(int argc, char **argv);
+-- static int64_t NowNs();
+-- static double RandomUnit(LPDirection d);
+-- static int64_t SampleDelay(LPDirection d);
+-- static int IsLost(LPDirection d);
+-- static LPPacket GetPacket(LPDirection d, uint32_t dwLen);
+-- static void PutPacket(LPDirection d, LPPacket p);
+-- static int Earlier(LPPacket a, LPPacket b);
+-- static void HeapPush(LPDirection d, LPPacket p);
+-- static LPPacket HeapPop(LPDirection d);
+-- static int InitDirection(LPDirection d, int nDir, uint64_t qwSeed, int src, int dst);
+-- static void FreeDirection(LPDirection d);
+-- static int64_t Transmit(LPDirection d, uint32_t dwLen, int64_t llNow, int bCanDrop);
+-- static void Schedule(LPDirection d, LPPacket p, int64_t llRelease, int bReorder);
+-- static void AdmitDatagram(LPDirection d, LPPacket p, int64_t llNow);
+-- static void AdmitStream(LPDirection d, LPPacket p, int64_t llNow);
+-- static void NoteSent(LPDirection d, LPPacket p, int64_t llNow);
+-- static void WaitFor(int fd, short events, LPDirection d);
+-- static void AddStats(LPDirection d);
+-- static void *UdpProc(void *param);
+-- static int SendAll(int fd, const unsigned char *buf, uint32_t dwLen);
+-- static void *TcpProc(void *param);
+-- static int OpenSocket(const struct sockaddr_storage *addr, int nType);
+-- static int RunUdp();
+-- static int RunTcp();
+-- static int ParseAddress(const char *szText, struct sockaddr_storage *addr, socklen_t *pLen, int bPassive);
+-- static int ParseProb(const char *szValue, double *pd);
+-- static int LoadPreset(const char *szName, LPImpairConfig cfg);
+-- static int ParseArgs(int argc, char **argv);
+-- static void PrintStats(FILE *file);
+-- static void OnSignal(int sig);
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- NOTES:	A relay that sits between the client and the server and does to their traffic what a real network would,
+--			so the UDP and TCP comparisons can be rerun on one machine, over loopback, with the same conditions every
+--			time. The client is pointed at the relay's port and the relay passes everything on to the server.
+--
+--			Each direction has its own copy of the impairments. A packet first runs the loss model (Bernoulli, or
+--			Gilbert-Elliott for bursts), then queues for the bottleneck link if there's a rate cap (and is dropped if
+--			the queue is full, as a router would), then is delayed by the base delay plus jitter drawn from a uniform,
+--			normal or Pareto distribution. Jitter alone never reorders packets, since a real path doesn't; -reorder
+--			holds chosen datagrams back so the ones behind them overtake, and -dup sends chosen ones twice. Waiting
+--			packets sit in a heap by release time. All randomness comes from a seeded generator, so a run with the
+--			same seed and the same traffic makes the same decisions.
+--
+--			UDP datagrams are moved in batches with recvmmsg and sendmmsg, datagrams over IMPAIR_SMALL are handed on
+--			in the buffer they were received into rather than copied, and each direction has a thread of its own
+--			which spins instead of sleeping for waits under IMPAIR_SPIN_NS. That keeps the relay well clear of being
+--			the bottleneck at several Gbit/s on loopback.
+--
+--			A TCP relay ends the connection on both sides, so it can't lose, reorder or duplicate the segments the
+--			two ends see. For TCP the relay applies delay, jitter and the rate cap to the byte stream, and models a
+--			lost segment as what it costs the receiver: that part of the stream, and everything behind it, arrives
+--			one round trip (twice the one-way delay, at least 1 ms) late, as after a fast retransmit, and a rate-capped
+--			link sits idle for that round trip. The rate-capped queue pushes back on the sender instead of dropping.
+--			This is a model of what loss costs TCP, not TCP's own congestion control reacting to it.
+--
+--			The relay runs until -duration expires or it gets SIGINT/SIGTERM, then prints one line of key=value
+--			counters per direction (and appends them to the -stats file) for scripts to read. It's built on Linux:
+--				g++ -O2 -pthread -o impair Impair.cpp
+-------------------------------------------------------------------------------------------------------------------------*/
+
+#include "Impair.h"
+
+static ImpairConfig				cfgs[2];				// Per direction
+static ImpairStats				totals[2];
+static pthread_mutex_t			statsLock	= PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t	bStop		= 0;
+static volatile int				nActive		= 0;	// TCP direction threads still running
+static int						bTcp		= 0;
+static struct sockaddr_storage	listenAddr, serverAddr;
+static socklen_t				listenLen, serverLen;
+static struct sockaddr_storage	client;					// Where the UDP client last sent from
+static socklen_t				clientLen	= 0;
+static pthread_mutex_t			clientLock	= PTHREAD_MUTEX_INITIALIZER;
+static uint64_t					qwSeed		= 1;
+static int64_t					llDuration	= 0;		// Run time in ns, 0 to run until signalled
+static int64_t					llStart;
+static const char				*szStatsFile = NULL;
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NowNs
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NowNs()
+--
+-- RETURNS: The monotonic clock in nanoseconds.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int64_t NowNs()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RandomUnit
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RandomUnit(LPDirection d)
+--						LPDirection d:	The direction whose generator to draw from.
+--
+-- RETURNS: A uniformly distributed number in [0, 1).
+--
+-- NOTES:
+-- splitmix64; each direction has its own state so the two directions' decisions don't depend on how their packets
+-- interleave.
+---------------------------------------------------------------------------------------------------------------------------*/
+static double RandomUnit(LPDirection d)
+{
+	uint64_t z = (d->qwRng += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	z ^= z >> 31;
+	return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SampleDelay
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SampleDelay(LPDirection d)
+--						LPDirection d:	The direction a packet is passing through.
+--
+-- RETURNS: The packet's one-way delay in nanoseconds, never less than 0.
+--
+-- NOTES:
+-- Uniform jitter is spread evenly over delay +/- jitter and normal jitter has jitter as its standard deviation. Pareto
+-- jitter only adds: it has shape 3 and a mean of one jitter, so most packets see about the base delay and a few see
+-- several times the jitter on top of it, as on a congested path.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int64_t SampleDelay(LPDirection d)
+{
+	LPImpairConfig	cfg = d->cfg;
+	double			u, v, x;
+
+	if (cfg->llJitterNs == 0)
+		return cfg->llDelayNs;
+
+	switch (cfg->nDist)
+	{
+	case DIST_NORMAL:
+		u = RandomUnit(d);
+		v = RandomUnit(d);
+		x = sqrt(-2.0 * log(1.0 - u)) * cos(2.0 * M_PI * v);
+		break;
+	case DIST_PARETO:
+		x = 2.0 * (pow(1.0 - RandomUnit(d), -1.0 / 3.0) - 1.0);
+		break;
+	default:
+		x = 2.0 * RandomUnit(d) - 1.0;
+		break;
+	}
+
+	x = cfg->llDelayNs + x * cfg->llJitterNs;
+	return x < 0 ? 0 : (int64_t)x;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: IsLost
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: IsLost(LPDirection d)
+--						LPDirection d:	The direction a packet is passing through.
+--
+-- RETURNS: Non-zero if the loss model drops the packet.
+--
+-- NOTES:
+-- The Gilbert-Elliott model moves between its good and bad states once per packet before drawing the loss, so a bad
+-- state lasts 1/r packets on average and the long-run loss rate is p/(p+r) x the bad loss plus r/(p+r) x the good.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int IsLost(LPDirection d)
+{
+	LPImpairConfig cfg = d->cfg;
+
+	if (cfg->nLoss == LOSS_BERNOULLI)
+		return RandomUnit(d) < cfg->dLoss;
+	if (cfg->nLoss == LOSS_GE)
+	{
+		if (RandomUnit(d) < (d->bBad ? cfg->dGeR : cfg->dGeP))
+			d->bBad = !d->bBad;
+		return RandomUnit(d) < (d->bBad ? cfg->dGeLossBad : cfg->dGeLossGood);
+	}
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: GetPacket
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: GetPacket(LPDirection d, uint32_t dwLen)
+--						LPDirection d:		The direction the packet is for.
+--						uint32_t dwLen:		The most bytes it must hold.
+--
+-- RETURNS: A packet from the direction's free list, or a new one; exits if there's no memory.
+--
+-- NOTES:
+-- Packets come in two sizes, IMPAIR_SMALL and IMPAIR_MAXDGRAM, and are kept on the direction's free lists rather
+-- than freed, so a direction's memory only grows to the most it has ever had queued.
+---------------------------------------------------------------------------------------------------------------------------*/
+static LPPacket GetPacket(LPDirection d, uint32_t dwLen)
+{
+	LPPacket	*list	= dwLen <= IMPAIR_SMALL ? &d->freeSmall : &d->freeLarge;
+	uint32_t	dwCap	= dwLen <= IMPAIR_SMALL ? IMPAIR_SMALL : IMPAIR_MAXDGRAM;
+	LPPacket	p		= *list;
+
+	if (p != NULL)
+	{
+		*list = p->next;
+		return p;
+	}
+
+	if ((p = (LPPacket)malloc(offsetof(Packet, data) + dwCap)) == NULL)
+	{
+		fprintf(stderr, "impair: out of memory\n");
+		exit(1);
+	}
+	p->dwCap = dwCap;
+	return p;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PutPacket
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PutPacket(LPDirection d, LPPacket p)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static void PutPacket(LPDirection d, LPPacket p)
+{
+	LPPacket *list = p->dwCap == IMPAIR_SMALL ? &d->freeSmall : &d->freeLarge;
+
+	p->next = *list;
+	*list = p;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Earlier
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Earlier(LPPacket a, LPPacket b)
+--
+-- RETURNS: Non-zero if a is released before b; packets released at the same time go in arrival order.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int Earlier(LPPacket a, LPPacket b)
+{
+	return a->llRelease < b->llRelease || (a->llRelease == b->llRelease && a->qwSeq < b->qwSeq);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: HeapPush
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: HeapPush(LPDirection d, LPPacket p)
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- The caller makes sure there's room.
+---------------------------------------------------------------------------------------------------------------------------*/
+static void HeapPush(LPDirection d, LPPacket p)
+{
+	uint32_t i = d->dwCount++;
+	uint32_t parent;
+
+	while (i > 0 && Earlier(p, d->heap[parent = (i - 1) / 2]))
+	{
+		d->heap[i] = d->heap[parent];
+		i = parent;
+	}
+	d->heap[i] = p;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: HeapPop
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: HeapPop(LPDirection d)
+--
+-- RETURNS: The packet with the earliest release time; the heap mustn't be empty.
+---------------------------------------------------------------------------------------------------------------------------*/
+static LPPacket HeapPop(LPDirection d)
+{
+	LPPacket	top		= d->heap[0];
+	LPPacket	last	= d->heap[--d->dwCount];
+	uint32_t	i		= 0;
+	uint32_t	child;
+
+	while ((child = 2 * i + 1) < d->dwCount)
+	{
+		if (child + 1 < d->dwCount && Earlier(d->heap[child + 1], d->heap[child]))
+			child++;
+		if (!Earlier(d->heap[child], last))
+			break;
+		d->heap[i] = d->heap[child];
+		i = child;
+	}
+	d->heap[i] = last;
+	d->qwQueued -= top->dwLen;
+	return top;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: InitDirection
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: InitDirection(LPDirection d, int nDir, uint64_t qwSeed, int src, int dst)
+--						LPDirection d:		The direction to set up.
+--						int nDir:			DIR_UP or DIR_DOWN.
+--						uint64_t qwSeed:	Seeds the direction's random decisions.
+--						int src:			The socket to read from.
+--						int dst:			The socket to write to.
+--
+-- RETURNS: 0 if the packet heap couldn't be allocated; non-zero otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int InitDirection(LPDirection d, int nDir, uint64_t qwSeed, int src, int dst)
+{
+	memset(d, 0, sizeof(Direction));
+	d->cfg		= &cfgs[nDir];
+	d->nDir		= nDir;
+	d->qwRng	= qwSeed;
+	d->src		= src;
+	d->dst		= dst;
+	d->heap		= (LPPacket *)malloc(IMPAIR_MAXQUEUE * sizeof(LPPacket));
+	return d->heap != NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: FreeDirection
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: FreeDirection(LPDirection d)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static void FreeDirection(LPDirection d)
+{
+	LPPacket p;
+
+	while (d->dwCount != 0)
+		free(HeapPop(d));
+	while ((p = d->freeSmall) != NULL)
+	{
+		d->freeSmall = p->next;
+		free(p);
+	}
+	while ((p = d->freeLarge) != NULL)
+	{
+		d->freeLarge = p->next;
+		free(p);
+	}
+	free(d->heap);
+	d->heap = NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Transmit
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Transmit(LPDirection d, uint32_t dwLen, int64_t llNow, int bCanDrop)
+--						LPDirection d:		The direction a packet is passing through.
+--						uint32_t dwLen:		The packet's length.
+--						int64_t llNow:		When it arrived.
+--						int bCanDrop:		Non-zero to drop the packet if the bottleneck queue is full.
+--
+-- RETURNS: When the packet's last bit leaves the bottleneck, or -1 if it was dropped.
+--
+-- NOTES:
+-- Without a rate cap a packet leaves as soon as it arrives.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int64_t Transmit(LPDirection d, uint32_t dwLen, int64_t llNow, int bCanDrop)
+{
+	LPImpairConfig cfg = d->cfg;
+
+	if (cfg->dRateBps == 0)
+		return llNow;
+
+	if (d->llLinkFree < llNow)
+		d->llLinkFree = llNow;
+	if (bCanDrop && (d->llLinkFree - llNow) * cfg->dRateBps / 8e9 + dwLen > cfg->dwQueueBytes)
+		return -1;
+	d->llLinkFree += (int64_t)(dwLen * 8e9 / cfg->dRateBps);
+	return d->llLinkFree;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: Schedule
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: Schedule(LPDirection d, LPPacket p, int64_t llRelease, int bReorder)
+--						LPDirection d:		The direction the packet is passing through.
+--						LPPacket p:			The packet.
+--						int64_t llRelease:	When its delay says it should be sent on.
+--						int bReorder:		Non-zero to hold it back so the packets behind it overtake.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Packets are never released before one that arrived ahead of them unless that one was picked to be reordered.
+---------------------------------------------------------------------------------------------------------------------------*/
+static void Schedule(LPDirection d, LPPacket p, int64_t llRelease, int bReorder)
+{
+	if (llRelease < d->llLastRelease)
+		llRelease = d->llLastRelease;
+	if (bReorder)
+		llRelease += d->cfg->llReorderNs;
+	else
+		d->llLastRelease = llRelease;
+
+	p->llRelease	= llRelease;
+	p->qwSeq		= d->qwSeq++;
+	HeapPush(d, p);
+	d->qwQueued += p->dwLen;
+	if (d->qwQueued > d->stats.qwMaxQueued)
+		d->stats.qwMaxQueued = d->qwQueued;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AdmitDatagram
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AdmitDatagram(LPDirection d, LPPacket p, int64_t llNow)
+--						LPDirection d:	The direction the datagram arrived on.
+--						LPPacket p:		The datagram; it's queued or given back to the free list.
+--						int64_t llNow:	When it arrived.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static void AdmitDatagram(LPDirection d, LPPacket p, int64_t llNow)
+{
+	LPImpairConfig	cfg = d->cfg;
+	LPPacket		dup;
+	int64_t			llDepart;
+	int				bReorder;
+
+	d->stats.qwPackets++;
+	d->stats.qwBytes += p->dwLen;
+	if (d->stats.llFirstNs == 0)
+		d->stats.llFirstNs = llNow;
+	p->llArrive = llNow;
+
+	if (IsLost(d))
+	{
+		d->stats.qwLost++;
+		PutPacket(d, p);
+		return;
+	}
+	if (d->dwCount + 2 > IMPAIR_MAXQUEUE || (llDepart = Transmit(d, p->dwLen, llNow, 1)) < 0)
+	{
+		d->stats.qwQueueDrops++;
+		PutPacket(d, p);
+		return;
+	}
+
+	if ((bReorder = cfg->dReorder > 0 && RandomUnit(d) < cfg->dReorder))
+		d->stats.qwReordered++;
+	Schedule(d, p, llDepart + SampleDelay(d), bReorder);
+
+	if (cfg->dDup > 0 && RandomUnit(d) < cfg->dDup)
+	{
+		dup = GetPacket(d, p->dwLen);
+		memcpy(dup->data, p->data, p->dwLen);
+		dup->dwLen		= p->dwLen;
+		dup->llArrive	= llNow;
+		d->stats.qwDups++;
+		Schedule(d, dup, Transmit(d, p->dwLen, llNow, 0) + SampleDelay(d), 0);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AdmitStream
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AdmitStream(LPDirection d, LPPacket p, int64_t llNow)
+--						LPDirection d:	The direction the data arrived on.
+--						LPPacket p:		The bytes read from the stream; they're queued.
+--						int64_t llNow:	When they were read.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- The loss model is run once for each segment the bytes would have filled. If any is lost the bytes are held back by a
+-- round trip, and since the stream stays in order everything read after them waits too. With a rate cap the link
+-- also carries nothing else for that round trip, standing in for the sender backing off, so loss costs throughput as
+-- well as latency.
+---------------------------------------------------------------------------------------------------------------------------*/
+static void AdmitStream(LPDirection d, LPPacket p, int64_t llNow)
+{
+	LPImpairConfig	cfg			= d->cfg;
+	uint32_t		dwSegments	= (p->dwLen + cfg->dwMss - 1) / cfg->dwMss;
+	int				bLost		= 0;
+	int64_t			llRelease;
+	int64_t			llRtt;
+
+	d->stats.qwPackets++;
+	d->stats.qwBytes += p->dwLen;
+	if (d->stats.llFirstNs == 0)
+		d->stats.llFirstNs = llNow;
+	p->llArrive = llNow;
+
+	while (dwSegments-- != 0)
+	{
+		if (IsLost(d))
+		{
+			d->stats.qwLost++;
+			bLost = 1;
+		}
+	}
+
+	llRelease = Transmit(d, p->dwLen, llNow, 0) + SampleDelay(d);
+	if (bLost)
+	{
+		llRtt = 2 * cfg->llDelayNs < 1000000 ? 1000000 : 2 * cfg->llDelayNs;
+		llRelease += llRtt;
+		if (cfg->dRateBps != 0)
+			d->llLinkFree += llRtt;
+		d->stats.qwStalls++;
+	}
+	Schedule(d, p, llRelease, 0);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: NoteSent
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: NoteSent(LPDirection d, LPPacket p, int64_t llNow)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static void NoteSent(LPDirection d, LPPacket p, int64_t llNow)
+{
+	int64_t llDelay = llNow - p->llArrive;
+
+	d->stats.qwSent++;
+	d->stats.qwSentBytes += p->dwLen;
+	d->stats.llDelaySumNs += llDelay;
+	d->stats.llLastNs = llNow;
+	if (llDelay > d->stats.llDelayMaxNs)
+		d->stats.llDelayMaxNs = llDelay;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: WaitFor
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: WaitFor(int fd, short events, LPDirection d)
+--						int fd:			The socket to wait on.
+--						short events:	The poll events to wait for; 0 to wait only for the next release.
+--						LPDirection d:	The direction whose next release ends the wait.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- Waits shorter than IMPAIR_SPIN_NS aren't slept at all, since waking from ppoll can take longer than that; the caller
+-- goes round its loop again instead.
+---------------------------------------------------------------------------------------------------------------------------*/
+static void WaitFor(int fd, short events, LPDirection d)
+{
+	struct pollfd	pfd;
+	struct timespec	ts;
+	int64_t			llWait = IMPAIR_IDLE_NS;
+
+	if (d->dwCount != 0 && (llWait = d->heap[0]->llRelease - NowNs()) > IMPAIR_IDLE_NS)
+		llWait = IMPAIR_IDLE_NS;
+	if (llWait <= IMPAIR_SPIN_NS)
+		return;
+
+	llWait -= IMPAIR_SPIN_NS;
+	ts.tv_sec	= llWait / 1000000000LL;
+	ts.tv_nsec	= llWait % 1000000000LL;
+	pfd.fd		= fd;
+	pfd.events	= events;
+	ppoll(&pfd, events != 0 ? 1 : 0, &ts, NULL);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: AddStats
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: AddStats(LPDirection d)
+--						LPDirection d:	A direction that has finished relaying.
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static void AddStats(LPDirection d)
+{
+	LPImpairStats t = &totals[d->nDir];
+
+	pthread_mutex_lock(&statsLock);
+	t->qwPackets	+= d->stats.qwPackets;
+	t->qwBytes		+= d->stats.qwBytes;
+	t->qwLost		+= d->stats.qwLost;
+	t->qwQueueDrops	+= d->stats.qwQueueDrops;
+	t->qwDups		+= d->stats.qwDups;
+	t->qwReordered	+= d->stats.qwReordered;
+	t->qwStalls		+= d->stats.qwStalls;
+	t->qwSent		+= d->stats.qwSent;
+	t->qwSentBytes	+= d->stats.qwSentBytes;
+	t->llDelaySumNs	+= d->stats.llDelaySumNs;
+	if (d->stats.llDelayMaxNs > t->llDelayMaxNs)
+		t->llDelayMaxNs = d->stats.llDelayMaxNs;
+	if (d->stats.qwMaxQueued > t->qwMaxQueued)
+		t->qwMaxQueued = d->stats.qwMaxQueued;
+	if (d->stats.llFirstNs != 0 && (t->llFirstNs == 0 || d->stats.llFirstNs < t->llFirstNs))
+		t->llFirstNs = d->stats.llFirstNs;
+	if (d->stats.llLastNs > t->llLastNs)
+		t->llLastNs = d->stats.llLastNs;
+	pthread_mutex_unlock(&statsLock);
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: UdpProc
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: UdpProc(void *param)
+--						void *param:	The LPDirection to relay.
+--
+-- RETURNS: NULL.
+--
+-- NOTES:
+-- Relays one direction of the UDP flow until the relay is stopped: sends whatever is due, then takes in whatever has
+-- arrived, then waits for more or for the next release. The upstream thread remembers where the client's datagrams
+-- come from; the downstream thread sends there, and drops what the server sends before the client has been heard from.
+---------------------------------------------------------------------------------------------------------------------------*/
+static void *UdpProc(void *param)
+{
+	LPDirection				d		= (LPDirection)param;
+	LPPacket				pkts[IMPAIR_BATCH];
+	LPPacket				recvPkts[IMPAIR_BATCH];
+	struct mmsghdr			msgs[IMPAIR_BATCH];
+	struct iovec			iovs[IMPAIR_BATCH];
+	struct sockaddr_storage	from[IMPAIR_BATCH];
+	struct sockaddr_storage	to;
+	socklen_t				toLen	= 0;
+	int64_t					llNow;
+	int						i, n, r, nSent;
+
+	for (i = 0; i < IMPAIR_BATCH; i++)
+		recvPkts[i] = GetPacket(d, IMPAIR_MAXDGRAM);
+
+	while (!bStop)
+	{
+		llNow = NowNs();
+		for (n = 0; n < IMPAIR_BATCH && d->dwCount != 0 && d->heap[0]->llRelease <= llNow; n++)
+			pkts[n] = HeapPop(d);
+
+		if (n != 0)
+		{
+			if (d->nDir == DIR_DOWN)
+			{
+				pthread_mutex_lock(&clientLock);
+				to		= client;
+				toLen	= clientLen;
+				pthread_mutex_unlock(&clientLock);
+			}
+
+			memset(msgs, 0, n * sizeof(struct mmsghdr));
+			for (i = 0; i < n; i++)
+			{
+				iovs[i].iov_base			= pkts[i]->data;
+				iovs[i].iov_len				= pkts[i]->dwLen;
+				msgs[i].msg_hdr.msg_iov		= &iovs[i];
+				msgs[i].msg_hdr.msg_iovlen	= 1;
+				if (d->nDir == DIR_DOWN)
+				{
+					msgs[i].msg_hdr.msg_name	= &to;
+					msgs[i].msg_hdr.msg_namelen	= toLen;
+				}
+			}
+
+			// A datagram the socket refuses (nowhere to send yet, or the server isn't up) is skipped, not retried
+			for (nSent = 0; nSent < n && (d->nDir == DIR_UP || toLen != 0); )
+			{
+				if ((r = sendmmsg(d->dst, msgs + nSent, n - nSent, 0)) > 0)
+				{
+					for (i = nSent; i < nSent + r; i++)
+						NoteSent(d, pkts[i], llNow);
+					nSent += r;
+				}
+				else if (errno != EINTR)
+					nSent++;
+			}
+
+			for (i = 0; i < n; i++)
+				PutPacket(d, pkts[i]);
+			if (n == IMPAIR_BATCH)
+				continue;
+		}
+
+		memset(msgs, 0, sizeof(msgs));
+		for (i = 0; i < IMPAIR_BATCH; i++)
+		{
+			iovs[i].iov_base				= recvPkts[i]->data;
+			iovs[i].iov_len					= IMPAIR_MAXDGRAM;
+			msgs[i].msg_hdr.msg_iov			= &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen		= 1;
+			msgs[i].msg_hdr.msg_name		= &from[i];
+			msgs[i].msg_hdr.msg_namelen		= sizeof(struct sockaddr_storage);
+		}
+
+		if ((n = recvmmsg(d->src, msgs, IMPAIR_BATCH, MSG_DONTWAIT, NULL)) > 0)
+		{
+			llNow = NowNs();
+			if (d->nDir == DIR_UP)
+			{
+				pthread_mutex_lock(&clientLock);
+				client		= from[n - 1];
+				clientLen	= msgs[n - 1].msg_hdr.msg_namelen;
+				pthread_mutex_unlock(&clientLock);
+			}
+
+			for (i = 0; i < n; i++)
+			{
+				LPPacket p;
+
+				// Big datagrams keep the buffer they arrived in; small ones are copied so it can be reused
+				if (msgs[i].msg_len <= IMPAIR_SMALL)
+				{
+					p = GetPacket(d, msgs[i].msg_len);
+					memcpy(p->data, recvPkts[i]->data, msgs[i].msg_len);
+				}
+				else
+				{
+					p = recvPkts[i];
+					recvPkts[i] = GetPacket(d, IMPAIR_MAXDGRAM);
+				}
+				p->dwLen = msgs[i].msg_len;
+				AdmitDatagram(d, p, llNow);
+			}
+			continue;
+		}
+
+		WaitFor(d->src, POLLIN, d);
+	}
+
+	for (i = 0; i < IMPAIR_BATCH; i++)
+		PutPacket(d, recvPkts[i]);
+	return NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: SendAll
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: SendAll(int fd, const unsigned char *buf, uint32_t dwLen)
+--
+-- RETURNS: 0 if the connection failed; non-zero once every byte has been sent.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int SendAll(int fd, const unsigned char *buf, uint32_t dwLen)
+{
+	ssize_t r;
+
+	while (dwLen != 0)
+	{
+		if ((r = send(fd, buf, dwLen, MSG_NOSIGNAL)) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return 0;
+		}
+		buf		+= r;
+		dwLen	-= (uint32_t)r;
+	}
+	return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: TcpProc
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: TcpProc(void *param)
+--						void *param:	The LPDirection to relay, one of its flow's pair.
+--
+-- RETURNS: NULL.
+--
+-- NOTES:
+-- Relays one direction of a TCP connection until its source closes and everything read has been sent on, then shuts
+-- down the destination's sending side. With a rate cap, reads are limited to about a millisecond of the link's data so
+-- the stream trickles out at the capped rate, and reading stops while the bottleneck queue is full so the sender feels
+-- the back pressure. The last of a connection's two directions to finish closes both sockets and frees the flow.
+---------------------------------------------------------------------------------------------------------------------------*/
+static void *TcpProc(void *param)
+{
+	LPDirection		d		= (LPDirection)param;
+	LPFlow			flow	= d->flow;
+	LPImpairConfig	cfg		= d->cfg;
+	uint32_t		dwChunk	= IMPAIR_TCPREAD;
+	int				bEof	= 0;
+	int				bFailed	= 0;
+	int				bRoom;
+	int64_t			llNow;
+	ssize_t			r;
+	LPPacket		p;
+
+	if (cfg->dRateBps != 0)
+	{
+		dwChunk = (uint32_t)(cfg->dRateBps / 8000);
+		dwChunk = dwChunk < cfg->dwMss ? cfg->dwMss : dwChunk > IMPAIR_TCPREAD ? IMPAIR_TCPREAD : dwChunk;
+	}
+
+	while (!bStop && !bFailed)
+	{
+		llNow = NowNs();
+		while (d->dwCount != 0 && d->heap[0]->llRelease <= llNow)
+		{
+			p = HeapPop(d);
+			if (SendAll(d->dst, p->data, p->dwLen))
+				NoteSent(d, p, llNow);
+			else
+				bFailed = 1;
+			PutPacket(d, p);
+		}
+		if (bEof && d->dwCount == 0)
+			break;
+
+		bRoom = !bEof && d->dwCount < IMPAIR_MAXQUEUE && (cfg->dRateBps == 0 ||
+			(d->llLinkFree - llNow) * cfg->dRateBps / 8e9 < cfg->dwQueueBytes);
+		if (bRoom)
+		{
+			p = GetPacket(d, IMPAIR_TCPREAD);
+			if ((r = recv(d->src, p->data, dwChunk, MSG_DONTWAIT)) > 0)
+			{
+				p->dwLen = (uint32_t)r;
+				AdmitStream(d, p, NowNs());
+				continue;
+			}
+			PutPacket(d, p);
+			if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+			{
+				bEof = 1;
+				continue;
+			}
+		}
+		WaitFor(d->src, bRoom ? POLLIN : 0, d);
+	}
+
+	shutdown(d->dst, SHUT_WR);
+	if (bFailed)
+		shutdown(d->src, SHUT_RD);
+	AddStats(d);
+	FreeDirection(d);
+
+	if (__sync_sub_and_fetch(&flow->nLeft, 1) == 0)
+	{
+		close(flow->client);
+		close(flow->server);
+		free(flow);
+	}
+	__sync_sub_and_fetch(&nActive, 1);
+	return NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: OpenSocket
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: OpenSocket(const struct sockaddr_storage *addr, int nType)
+--						const struct sockaddr_storage *addr:	An address of the family the socket is for.
+--						int nType:								SOCK_STREAM or SOCK_DGRAM.
+--
+-- RETURNS: The socket, with large buffers, or -1 if it couldn't be created.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int OpenSocket(const struct sockaddr_storage *addr, int nType)
+{
+	int s		= socket(addr->ss_family, nType, 0);
+	int nBuf	= IMPAIR_SOCKBUF;
+	int nOn		= 1;
+
+	if (s < 0)
+		return -1;
+	setsockopt(s, SOL_SOCKET, SO_SNDBUF, &nBuf, sizeof(nBuf));
+	setsockopt(s, SOL_SOCKET, SO_RCVBUF, &nBuf, sizeof(nBuf));
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &nOn, sizeof(nOn));
+	if (nType == SOCK_STREAM)
+		setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &nOn, sizeof(nOn));
+	return s;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RunUdp
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RunUdp()
+--
+-- RETURNS: The process exit code: 0 once the relay has been stopped, 1 if it couldn't start.
+--
+-- NOTES:
+-- The relay's socket towards the server is connected to it, so only the server's datagrams come back on it.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int RunUdp()
+{
+	Direction	dirs[2];
+	pthread_t	threads[2];
+	int			lsock, ssock;
+	int			i;
+
+	if ((lsock = OpenSocket(&listenAddr, SOCK_DGRAM)) < 0 || bind(lsock, (struct sockaddr *)&listenAddr, listenLen) < 0)
+	{
+		perror("impair: bind");
+		return 1;
+	}
+	if ((ssock = OpenSocket(&serverAddr, SOCK_DGRAM)) < 0 || connect(ssock, (struct sockaddr *)&serverAddr, serverLen) < 0)
+	{
+		perror("impair: connect");
+		return 1;
+	}
+
+	if (!InitDirection(&dirs[DIR_UP], DIR_UP, qwSeed, lsock, ssock) ||
+		!InitDirection(&dirs[DIR_DOWN], DIR_DOWN, qwSeed ^ 0x5DEECE66DULL, ssock, lsock))
+	{
+		fprintf(stderr, "impair: out of memory\n");
+		return 1;
+	}
+
+	for (i = 0; i < 2; i++)
+		pthread_create(&threads[i], NULL, UdpProc, &dirs[i]);
+	while (!bStop && (llDuration == 0 || NowNs() - llStart < llDuration))
+		usleep(100000);
+	bStop = 1;
+
+	for (i = 0; i < 2; i++)
+	{
+		pthread_join(threads[i], NULL);
+		AddStats(&dirs[i]);
+		FreeDirection(&dirs[i]);
+	}
+	close(lsock);
+	close(ssock);
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: RunTcp
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: RunTcp()
+--
+-- RETURNS: The process exit code: 0 once the relay has been stopped, 1 if it couldn't start.
+--
+-- NOTES:
+-- Each connection accepted is matched with a new connection to the server and gets a thread per direction. Each
+-- connection's directions are seeded differently, but in the order the connections arrive, so a run is repeatable
+-- as long as the client opens its connections in the same order.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int RunTcp()
+{
+	struct pollfd	pfd;
+	pthread_t		thread;
+	uint64_t		qwConn	= 0;
+	int				nOn		= 1;
+	int				lsock, c, s;
+	int				i;
+	LPFlow			flow;
+
+	if ((lsock = OpenSocket(&listenAddr, SOCK_STREAM)) < 0 ||
+		bind(lsock, (struct sockaddr *)&listenAddr, listenLen) < 0 || listen(lsock, SOMAXCONN) < 0)
+	{
+		perror("impair: listen");
+		return 1;
+	}
+
+	pfd.fd		= lsock;
+	pfd.events	= POLLIN;
+	while (!bStop && (llDuration == 0 || NowNs() - llStart < llDuration))
+	{
+		if (poll(&pfd, 1, 100) <= 0 || (c = accept(lsock, NULL, NULL)) < 0)
+			continue;
+
+		if ((s = OpenSocket(&serverAddr, SOCK_STREAM)) < 0 || connect(s, (struct sockaddr *)&serverAddr, serverLen) < 0)
+		{
+			perror("impair: connect");
+			if (s >= 0)
+				close(s);
+			close(c);
+			continue;
+		}
+		setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &nOn, sizeof(nOn));
+
+		if ((flow = (LPFlow)malloc(sizeof(Flow))) == NULL ||
+			!InitDirection(&flow->dirs[DIR_UP], DIR_UP, qwSeed + 2 * qwConn, c, s) ||
+			!InitDirection(&flow->dirs[DIR_DOWN], DIR_DOWN, (qwSeed + 2 * qwConn + 1) ^ 0x5DEECE66DULL, s, c))
+		{
+			fprintf(stderr, "impair: out of memory\n");
+			exit(1);
+		}
+		qwConn++;
+		flow->client	= c;
+		flow->server	= s;
+		flow->nLeft		= 2;
+		for (i = 0; i < 2; i++)
+		{
+			flow->dirs[i].flow = flow;
+			__sync_add_and_fetch(&nActive, 1);
+			pthread_create(&thread, NULL, TcpProc, &flow->dirs[i]);
+			pthread_detach(thread);
+		}
+	}
+	bStop = 1;
+	close(lsock);
+
+	// Give the connections a moment to see the stop and add their counts in
+	for (i = 0; i < 20 && nActive != 0; i++)
+		usleep(50000);
+	return 0;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ParseAddress
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ParseAddress(const char *szText, struct sockaddr_storage *addr, socklen_t *pLen, int bPassive)
+--						const char *szText:				host:port, [IPv6 address]:port, or (to listen on) just port.
+--						struct sockaddr_storage *addr:	Receives the address.
+--						socklen_t *pLen:				Receives its length.
+--						int bPassive:					Non-zero for an address to listen on.
+--
+-- RETURNS: 0 if the address couldn't be parsed or the host couldn't be found; non-zero otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int ParseAddress(const char *szText, struct sockaddr_storage *addr, socklen_t *pLen, int bPassive)
+{
+	char			szHost[256];
+	const char		*szPort	= strrchr(szText, ':');
+	struct addrinfo	hints, *res;
+	size_t			len;
+
+	szHost[0] = 0;
+	if (szPort == NULL)
+		szPort = szText;
+	else
+	{
+		len = szPort - szText;
+		if (szText[0] == '[' && len >= 2 && szText[len - 1] == ']')
+		{
+			szText++;
+			len -= 2;
+		}
+		if (len >= sizeof(szHost))
+			return 0;
+		memcpy(szHost, szText, len);
+		szHost[len] = 0;
+		szPort++;
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_flags	= bPassive ? AI_PASSIVE : 0;
+	if (getaddrinfo(szHost[0] != 0 ? szHost : bPassive ? NULL : "localhost", szPort, &hints, &res) != 0)
+		return 0;
+	memcpy(addr, res->ai_addr, res->ai_addrlen);
+	*pLen = (socklen_t)res->ai_addrlen;
+	freeaddrinfo(res);
+	return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ParseProb
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ParseProb(const char *szValue, double *pd)
+--						const char *szValue:	A percentage from 0 to 100.
+--						double *pd:				Receives it as a probability.
+--
+-- RETURNS: 0 if the value isn't a percentage; non-zero otherwise.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int ParseProb(const char *szValue, double *pd)
+{
+	char *end;
+
+	*pd = strtod(szValue, &end) / 100.0;
+	return end != szValue && *pd >= 0 && *pd <= 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: LoadPreset
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: LoadPreset(const char *szName, LPImpairConfig cfg)
+--						const char *szName:		lan, wlan or wan.
+--						LPImpairConfig cfg:		The settings to fill in.
+--
+-- RETURNS: 0 if there's no such preset; non-zero otherwise.
+--
+-- NOTES:
+-- Rough stand-ins for the networks the logs in data/ were taken on, fitted to their throughput, transfer times and UDP
+-- loss: the LAN ran at about 80 Mbit/s without loss, the WLAN at about 65 Mbit/s losing half a percent of datagrams
+-- in short bursts, and the WAN at about 12 Mbit/s with a round trip of about 50 ms. Most of the WAN's UDP loss came
+-- from large datagrams being fragmented, which the relay doesn't reproduce.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int LoadPreset(const char *szName, LPImpairConfig cfg)
+{
+	if (strcmp(szName, "lan") == 0)
+	{
+		cfg->dRateBps	= 100e6;
+		cfg->llDelayNs	= 200000;
+		cfg->llJitterNs	= 50000;
+		cfg->nDist		= DIST_NORMAL;
+	}
+	else if (strcmp(szName, "wlan") == 0)
+	{
+		cfg->dRateBps		= 65e6;
+		cfg->llDelayNs		= 1500000;
+		cfg->llJitterNs		= 1000000;
+		cfg->nDist			= DIST_NORMAL;
+		cfg->nLoss			= LOSS_GE;
+		cfg->dGeP			= 0.0025;
+		cfg->dGeR			= 0.5;
+		cfg->dGeLossBad		= 1.0;
+		cfg->dGeLossGood	= 0;
+	}
+	else if (strcmp(szName, "wan") == 0)
+	{
+		cfg->dRateBps		= 12e6;
+		cfg->llDelayNs		= 25000000;
+		cfg->llJitterNs		= 3000000;
+		cfg->nDist			= DIST_PARETO;
+		cfg->nLoss			= LOSS_GE;
+		cfg->dGeP			= 0.001;
+		cfg->dGeR			= 0.2;
+		cfg->dGeLossBad		= 1.0;
+		cfg->dGeLossGood	= 0;
+	}
+	else
+		return 0;
+	return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: ParseArgs
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: ParseArgs(int argc, char **argv)
+--
+-- RETURNS: 0 if an option is unknown or has a bad value; non-zero otherwise.
+--
+-- NOTES:
+-- Reads the options:
+--		-proto udp|tcp			What to relay (default udp).
+--		-listen [host:]port		Where the client sends to.
+--		-server host:port		Where the relay sends to.
+--		-preset lan|wlan|wan	Start from an approximation of one of the networks in data/.
+--		-delay <ms>				One-way delay.
+--		-jitter <ms>			Jitter; see SampleDelay.
+--		-dist <name>			Jitter distribution: uniform (default), normal or pareto.
+--		-rate <Mbit/s>			Bottleneck rate.
+--		-queue <KB>				Bottleneck queue (default 1024).
+--		-loss <%>				Bernoulli loss.
+--		-ge p,r[,bad[,good]]	Gilbert-Elliott loss: the good-to-bad and bad-to-good transition chances and the loss in
+--								each state, all in percent; the bad state loses everything and the good state nothing
+--								unless given.
+--		-reorder <%>			Datagrams held back so later ones overtake them.
+--		-gap <ms>				How long reordered datagrams are held back (default 1).
+--		-dup <%>				Datagrams sent twice.
+--		-mss <bytes>			TCP: the segment size loss is drawn per (default 1448).
+--		-dir both|up|down		The directions to impair (default both); the other passes traffic straight through.
+--		-seed <n>				Seed for the random decisions.
+--		-duration <s>			Stop after this long.
+--		-stats <file>			Append the counters to this file on exit.
+-- Times may be fractions of a millisecond.
+---------------------------------------------------------------------------------------------------------------------------*/
+static int ParseArgs(int argc, char **argv)
+{
+	ImpairConfig	cfg;
+	const char		*szOpt;
+	const char		*szValue;
+	int				nDirs	= 3;	// Bit per direction
+	int				bListen	= 0;
+	int				bServer	= 0;
+	int				i;
+
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.dwQueueBytes	= IMPAIR_DEF_QUEUE;
+	cfg.llReorderNs		= 1000000;
+	cfg.dwMss			= IMPAIR_DEF_MSS;
+
+	for (i = 1; i < argc; i++)
+	{
+		szOpt = argv[i];
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "impair: %s needs a value\n", szOpt);
+			return 0;
+		}
+		szValue = argv[++i];
+
+		if (strcmp(szOpt, "-proto") == 0 && (strcmp(szValue, "udp") == 0 || strcmp(szValue, "tcp") == 0))
+			bTcp = strcmp(szValue, "tcp") == 0;
+		else if (strcmp(szOpt, "-listen") == 0)
+			bListen = ParseAddress(szValue, &listenAddr, &listenLen, 1);
+		else if (strcmp(szOpt, "-server") == 0)
+			bServer = ParseAddress(szValue, &serverAddr, &serverLen, 0);
+		else if (strcmp(szOpt, "-preset") == 0 && LoadPreset(szValue, &cfg))
+			;
+		else if (strcmp(szOpt, "-delay") == 0)
+			cfg.llDelayNs = (int64_t)(atof(szValue) * 1e6);
+		else if (strcmp(szOpt, "-jitter") == 0)
+			cfg.llJitterNs = (int64_t)(atof(szValue) * 1e6);
+		else if (strcmp(szOpt, "-dist") == 0 && strcmp(szValue, "uniform") == 0)
+			cfg.nDist = DIST_UNIFORM;
+		else if (strcmp(szOpt, "-dist") == 0 && strcmp(szValue, "normal") == 0)
+			cfg.nDist = DIST_NORMAL;
+		else if (strcmp(szOpt, "-dist") == 0 && strcmp(szValue, "pareto") == 0)
+			cfg.nDist = DIST_PARETO;
+		else if (strcmp(szOpt, "-rate") == 0)
+			cfg.dRateBps = atof(szValue) * 1e6;
+		else if (strcmp(szOpt, "-queue") == 0 && atoi(szValue) > 0)
+			cfg.dwQueueBytes = (uint32_t)atoi(szValue) * 1024;
+		else if (strcmp(szOpt, "-loss") == 0 && ParseProb(szValue, &cfg.dLoss))
+			cfg.nLoss = cfg.dLoss > 0 ? LOSS_BERNOULLI : LOSS_NONE;
+		else if (strcmp(szOpt, "-ge") == 0)
+		{
+			double	d[4]	= { 0, 0, 100, 0 };
+			int		n		= sscanf(szValue, "%lf,%lf,%lf,%lf", &d[0], &d[1], &d[2], &d[3]);
+
+			if (n < 2 || d[0] < 0 || d[0] > 100 || d[1] <= 0 || d[1] > 100 || d[2] < 0 || d[2] > 100 || d[3] < 0 ||
+				d[3] > 100)
+			{
+				fprintf(stderr, "impair: -ge needs p,r[,bad[,good]] in percent, with r above 0\n");
+				return 0;
+			}
+			cfg.nLoss		= LOSS_GE;
+			cfg.dGeP		= d[0] / 100;
+			cfg.dGeR		= d[1] / 100;
+			cfg.dGeLossBad	= d[2] / 100;
+			cfg.dGeLossGood	= d[3] / 100;
+		}
+		else if (strcmp(szOpt, "-reorder") == 0 && ParseProb(szValue, &cfg.dReorder))
+			;
+		else if (strcmp(szOpt, "-gap") == 0)
+			cfg.llReorderNs = (int64_t)(atof(szValue) * 1e6);
+		else if (strcmp(szOpt, "-dup") == 0 && ParseProb(szValue, &cfg.dDup))
+			;
+		else if (strcmp(szOpt, "-mss") == 0 && atoi(szValue) > 0)
+			cfg.dwMss = (uint32_t)atoi(szValue);
+		else if (strcmp(szOpt, "-dir") == 0 && strcmp(szValue, "both") == 0)
+			nDirs = 3;
+		else if (strcmp(szOpt, "-dir") == 0 && strcmp(szValue, "up") == 0)
+			nDirs = 1 << DIR_UP;
+		else if (strcmp(szOpt, "-dir") == 0 && strcmp(szValue, "down") == 0)
+			nDirs = 1 << DIR_DOWN;
+		else if (strcmp(szOpt, "-seed") == 0)
+			qwSeed = strtoull(szValue, NULL, 0);
+		else if (strcmp(szOpt, "-duration") == 0)
+			llDuration = (int64_t)(atof(szValue) * 1e9);
+		else if (strcmp(szOpt, "-stats") == 0)
+			szStatsFile = szValue;
+		else
+		{
+			fprintf(stderr, "impair: bad option %s %s\n", szOpt, szValue);
+			return 0;
+		}
+	}
+
+	if (!bListen || !bServer)
+	{
+		fprintf(stderr, "impair: -listen and -server are needed, and the server must be found\n");
+		return 0;
+	}
+	if (bTcp && (cfg.dReorder > 0 || cfg.dDup > 0))
+		fprintf(stderr, "impair: TCP is relayed as a stream; -reorder and -dup are ignored\n");
+
+	for (i = 0; i < 2; i++)
+	{
+		memset(&cfgs[i], 0, sizeof(ImpairConfig));
+		cfgs[i].dwQueueBytes	= IMPAIR_DEF_QUEUE;
+		cfgs[i].dwMss			= IMPAIR_DEF_MSS;
+		if (nDirs & (1 << i))
+			cfgs[i] = cfg;
+	}
+	return 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: PrintStats
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: PrintStats(FILE *file)
+--						FILE *file:		Where to write the counters.
+--
+-- RETURNS: void
+--
+-- NOTES:
+-- One line per direction of space-separated key=value pairs. "lost" counts TCP segments the loss model dropped, which
+-- the relay turned into "stalls". The rate is over the time from the first packet in to the last one out.
+---------------------------------------------------------------------------------------------------------------------------*/
+static void PrintStats(FILE *file)
+{
+	double	dSecs = (NowNs() - llStart) / 1e9;
+	double	dActive;
+	int		i;
+
+	for (i = 0; i < 2; i++)
+	{
+		LPImpairStats t = &totals[i];
+
+		dActive = (t->llLastNs - t->llFirstNs) / 1e9;
+
+		fprintf(file, "proto=%s dir=%s seed=%llu packets=%llu bytes=%llu lost=%llu queue_drops=%llu duplicated=%llu "
+			"reordered=%llu stalls=%llu sent=%llu sent_bytes=%llu avg_delay_ms=%.3f max_delay_ms=%.3f max_queued_kb=%.1f "
+			"mbps=%.1f secs=%.2f\n", bTcp ? "tcp" : "udp", i == DIR_UP ? "up" : "down", (unsigned long long)qwSeed,
+			(unsigned long long)t->qwPackets, (unsigned long long)t->qwBytes, (unsigned long long)t->qwLost,
+			(unsigned long long)t->qwQueueDrops, (unsigned long long)t->qwDups, (unsigned long long)t->qwReordered,
+			(unsigned long long)t->qwStalls, (unsigned long long)t->qwSent, (unsigned long long)t->qwSentBytes,
+			t->qwSent != 0 ? t->llDelaySumNs / 1e6 / t->qwSent : 0.0, t->llDelayMaxNs / 1e6, t->qwMaxQueued / 1024.0,
+			dActive > 0 ? t->qwSentBytes * 8 / 1e6 / dActive : 0.0, dSecs);
+	}
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: OnSignal
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: OnSignal(int)
+--
+-- RETURNS: void
+---------------------------------------------------------------------------------------------------------------------------*/
+static void OnSignal(int)
+{
+	bStop = 1;
+}
+
+/*-------------------------------------------------------------------------------------------------------------------------
+-- FUNCTION: main
+--
+-- DATE: October 18th, 2026
+--
+-- DESIGNER: Shane Spoor
+--
+-- PROGRAMMER: Shane Spoor
+--
+-- INTERFACE: main(int argc, char **argv)
+--
+-- RETURNS: 0 after a run, 1 if the relay couldn't start, 2 for bad options.
+---------------------------------------------------------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+	FILE	*file;
+	int		nRet;
+
+	if (!ParseArgs(argc, argv))
+		return 2;
+
+	signal(SIGINT, OnSignal);
+	signal(SIGTERM, OnSignal);
+	signal(SIGPIPE, SIG_IGN);
+
+	llStart	= NowNs();
+	nRet	= bTcp ? RunTcp() : RunUdp();
+	if (nRet != 0)
+		return nRet;
+
+	PrintStats(stdout);
+	if (szStatsFile != NULL && (file = fopen(szStatsFile, "a")) != NULL)
+	{
+		PrintStats(file);
+		fclose(file);
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+#ifndef IMPAIR_H
+#define IMPAIR_H
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <stdint.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define IMPAIR_BATCH		64				// Datagrams moved per recvmmsg/sendmmsg call
+#define IMPAIR_MAXDGRAM		65536			// Largest datagram relayed
+#define IMPAIR_SMALL		2048			// Datagrams up to this size are copied into small buffers
+#define IMPAIR_TCPREAD		65536			// Most bytes read from a TCP stream at a time
+#define IMPAIR_MAXQUEUE		262144			// Most packets a direction can hold
+#define IMPAIR_SPIN_NS		50000			// Waits shorter than this are spun instead of slept
+#define IMPAIR_IDLE_NS		100000000LL		// Longest wait, so a stop request is seen
+#define IMPAIR_SOCKBUF		(8 << 20)		// SO_SNDBUF/SO_RCVBUF asked for on every socket
+#define IMPAIR_DEF_QUEUE	(1 << 20)		// Bottleneck queue (bytes) when -queue isn't given
+#define IMPAIR_DEF_MSS		1448			// Segment size TCP loss is drawn per
+
+#define DIR_UP				0				// Client to server
+#define DIR_DOWN			1				// Server to client
+
+#define DIST_UNIFORM		0
+#define DIST_NORMAL			1
+#define DIST_PARETO			2
+
+#define LOSS_NONE			0
+#define LOSS_BERNOULLI		1
+#define LOSS_GE				2				// Gilbert-Elliott
+
+/* What one direction does to the traffic passing through it. */
+typedef struct _ImpairConfig
+{
+	int64_t		llDelayNs;		// Base one-way delay
+	int64_t		llJitterNs;		// Spread of the delay; its meaning depends on nDist
+	int			nDist;			// DIST_*
+	double		dRateBps;		// Bottleneck rate in bits/s, 0 for none
+	uint32_t	dwQueueBytes;	// Bottleneck queue; datagrams arriving to a full queue are dropped
+	int			nLoss;			// LOSS_*
+	double		dLoss;			// Bernoulli loss probability
+	double		dGeP;			// Gilbert-Elliott: P(good -> bad) per packet
+	double		dGeR;			// P(bad -> good)
+	double		dGeLossBad;		// Loss probability in the bad state
+	double		dGeLossGood;	// Loss probability in the good state
+	double		dReorder;		// Probability a datagram is held back by llReorderNs
+	int64_t		llReorderNs;
+	double		dDup;			// Probability a datagram is sent twice
+	uint32_t	dwMss;			// TCP: segment size loss is drawn per
+} ImpairConfig, *LPImpairConfig;
+
+/* A datagram or a piece of a stream waiting for its release time. */
+typedef struct _Packet
+{
+	int64_t			llRelease;
+	int64_t			llArrive;
+	uint64_t		qwSeq;			// Breaks release time ties in arrival order
+	uint32_t		dwLen;
+	uint32_t		dwCap;
+	struct _Packet	*next;			// Free list link
+	unsigned char	data[1];
+} Packet, *LPPacket;
+
+/* The counters reported for a direction. */
+typedef struct _ImpairStats
+{
+	uint64_t	qwPackets;		// Arrived
+	uint64_t	qwBytes;
+	uint64_t	qwLost;			// Dropped by the loss model
+	uint64_t	qwQueueDrops;	// Dropped because the bottleneck queue was full
+	uint64_t	qwDups;
+	uint64_t	qwReordered;
+	uint64_t	qwStalls;		// TCP: reads held back for a modelled retransmission
+	uint64_t	qwSent;
+	uint64_t	qwSentBytes;
+	int64_t		llDelaySumNs;	// Time spent in the relay by sent packets
+	int64_t		llDelayMaxNs;
+	uint64_t	qwMaxQueued;	// Most bytes held at once
+	int64_t		llFirstNs;		// First arrival, 0 if none
+	int64_t		llLastNs;		// Last send
+} ImpairStats, *LPImpairStats;
+
+/* One direction of one relayed flow. */
+typedef struct _Direction
+{
+	struct _Flow	*flow;
+	LPImpairConfig	cfg;
+	int				nDir;
+	int				src;			// Socket read from
+	int				dst;			// Socket written to
+	uint64_t		qwRng;			// splitmix64 state
+	int				bBad;			// Gilbert-Elliott state
+	int64_t			llLinkFree;		// When the bottleneck finishes sending what it has
+	int64_t			llLastRelease;	// Keeps unreordered packets in order
+	uint64_t		qwSeq;
+	LPPacket		*heap;			// Waiting packets, earliest release first
+	uint32_t		dwCount;
+	uint64_t		qwQueued;		// Bytes waiting
+	LPPacket		freeSmall;
+	LPPacket		freeLarge;
+	ImpairStats		stats;
+} Direction, *LPDirection;
+
+/* A relayed TCP connection. */
+typedef struct _Flow
+{
+	Direction		dirs[2];
+	int				client;			// The accepted connection
+	int				server;			// The relay's connection to the server
+	volatile int	nLeft;			// Directions still relaying
+} Flow, *LPFlow;
+
+#endif